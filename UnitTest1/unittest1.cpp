@@ -48,6 +48,34 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(picohash_grow)
+        {
+            int ret = picohash_grow_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(picohash_bench)
+        {
+            int ret = picohash_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(picoheap)
+        {
+            int ret = picoheap_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(picoheap_bench)
+        {
+            int ret = picoheap_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(bytestream)
         {
             int ret = bytestream_test();
@@ -90,6 +118,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(mpsc)
+        {
+            int ret = util_mpsc_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(random_tester)
         {
             int ret = random_tester_test();
@@ -167,6 +202,48 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(sockloop_thread_command)
+        {
+            int ret = sockloop_thread_command_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_recv_batch)
+        {
+            int ret = sockloop_recv_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_recv_gro)
+        {
+            int ret = sockloop_recv_gro_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_send_batch)
+        {
+            int ret = sockloop_send_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_shard_cid)
+        {
+            int ret = sockloop_shard_cid_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_sharded_server)
+        {
+            int ret = sockloop_sharded_server_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(splay)
         {
             int ret = splay_test();
@@ -188,6 +265,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(wake_scheduler)
+        {
+            int ret = wake_scheduler_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(parse_header)
         {
             int ret = parseheadertest();
@@ -293,6 +377,34 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(binlog_index)
+        {
+            int ret = binlog_index_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(binlog_async)
+        {
+            int ret = binlog_async_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(qlog_multi)
+        {
+            int ret = qlog_multi_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(picolog_batch)
+        {
+            int ret = picolog_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(app_message_overflow)
         {
             int ret = app_message_overflow_test();
@@ -327,6 +439,13 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(stream_ready_queue)
+        {
+            int ret = stream_ready_queue_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         TEST_METHOD(stream_retransmit_copy)
         {
             int ret = test_copy_for_retransmit();
@@ -509,6 +628,12 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+        TEST_METHOD(async_sign)
+        {
+            int ret = async_sign_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         TEST_METHOD(null_sni)
         {
             int ret = null_sni_test();
@@ -670,6 +795,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(initial_flood)
+        {
+            int ret = initial_flood_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(initial_flood_prefixes)
+        {
+            int ret = initial_flood_prefixes_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(blackhole)
         {
             int ret = blackhole_test();
@@ -914,6 +1053,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(packet_mask)
+        {
+            int ret = packet_mask_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(header_mask_batch)
+        {
+            int ret = header_mask_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(test_multiple_versions)
         {
             int ret = tls_api_multiple_versions_test();
@@ -1529,6 +1682,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(cnx_attach)
+        {
+            int ret = cnx_attach_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(migration_long)
         {
             int ret = migration_test_long();
@@ -1606,6 +1766,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(memory_budget)
+        {
+            int ret = memory_budget_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(quic_metrics)
+        {
+            int ret = quic_metrics_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(initial_close)
         {
             int ret = initial_close_test();
@@ -2176,6 +2350,27 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(stream_owned)
+        {
+            int ret = stream_owned_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(compact_retransmit)
+        {
+            int ret = compact_retransmit_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(pending_ring)
+        {
+            int ret = pending_ring_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(stream_ack) {
             int ret = stream_ack_test();
 
@@ -2188,6 +2383,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(queue_network_fragments)
+        {
+            int ret = queue_network_fragments_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(pacing_update) {
             int ret = pacing_update_test();
 
@@ -2725,6 +2927,18 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qpack_huffman_encode) {
+            int ret = qpack_huffman_encode_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(qpack_huffman_bench) {
+            int ret = qpack_huffman_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(h3zero_parse_qpack) {
             int ret = h3zero_parse_qpack_test();
 
@@ -2743,6 +2957,18 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(h3zero_qpack_dynamic) {
+            int ret = h3zero_qpack_dynamic_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(h3zero_file_cache) {
+            int ret = h3zero_file_cache_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(h3zero_uri) {
             int ret = h3zero_uri_test();
 
@@ -75,10 +75,11 @@ int cidset_has_cid(picohash_table * cids, const picoquic_connection_id_t * cid)
 int cidset_iterate(const picohash_table * cids, int(*cb)(const picoquic_connection_id_t *, void *), void * cbptr)
 {
     int ret = 0;
-    for (size_t i = 0; ret == 0 && i < cids->nb_bin; i++) {
-        for (picohash_item* item = cids->hash_bin[i]; ret == 0 && item != NULL; item = item->next_in_bin) {
-            ret = cb((const picoquic_connection_id_t *)(item->key), cbptr);
-        }
+    size_t cursor = 0;
+    picohash_item* item;
+
+    while (ret == 0 && (item = picohash_next_item(cids, &cursor)) != NULL) {
+        ret = cb((const picoquic_connection_id_t *)(item->key), cbptr);
     }
     return ret;
 }
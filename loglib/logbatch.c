@@ -0,0 +1,498 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "picoquic_internal.h"
+#include "bytestream.h"
+#include "csv.h"
+#include "svg.h"
+#include "qlog.h"
+#include "cidset.h"
+#include "logreader.h"
+#include "logbatch.h"
+
+typedef struct st_picolog_batch_t {
+    const app_conversion_context_t * options;
+    const picoquic_connection_id_t * cid;
+    const picolog_file_list_t * files;
+    picoquic_mutex_t mutex;
+    size_t next_file;
+    size_t nb_converted;
+    size_t nb_errors;
+} picolog_batch_t;
+
+int picolog_add_file(picolog_file_list_t * files, const char * name)
+{
+    int ret = 0;
+
+    if (files->nb_names >= files->nb_names_max) {
+        size_t new_max = (files->nb_names_max == 0) ? 16 : 2 * files->nb_names_max;
+        char ** new_names = (char **)realloc(files->names, new_max * sizeof(char *));
+        if (new_names == NULL) {
+            ret = -1;
+        }
+        else {
+            files->names = new_names;
+            files->nb_names_max = new_max;
+        }
+    }
+
+    if (ret == 0) {
+        size_t len = strlen(name);
+        char * copy = (char *)malloc(len + 1);
+        if (copy == NULL) {
+            ret = -1;
+        }
+        else {
+            memcpy(copy, name, len + 1);
+            files->names[files->nb_names++] = copy;
+        }
+    }
+
+    return ret;
+}
+
+void picolog_free_files(picolog_file_list_t * files)
+{
+    for (size_t i = 0; i < files->nb_names; i++) {
+        free(files->names[i]);
+    }
+    free(files->names);
+    memset(files, 0, sizeof(picolog_file_list_t));
+}
+
+/* Convert a single binary log. In batch mode, a file that does not contain the
+ * requested connection is skipped silently, and the list of connections is not
+ * printed since the output of the workers would be interleaved. */
+int convert_binlog_file(const app_conversion_context_t * options, const char * binlog_name,
+    const picoquic_connection_id_t * cid, int is_batch)
+{
+    int ret = 0;
+    app_conversion_context_t appctx = *options;
+    picohash_table * cids = cidset_create();
+    char out_name[512];
+
+    appctx.binlog_name = binlog_name;
+    appctx.f_binlog = NULL;
+    appctx.f_template = NULL;
+
+    if (cids == NULL) {
+        fprintf(stderr, "Fatal: failed to create resources.\n");
+        return 1;
+    }
+
+    if (is_batch) {
+        /* Name the outputs after the log file, without directory and ".log" extension */
+        const char * base = binlog_name;
+        const char * x = binlog_name;
+        size_t base_len;
+
+        while (*x != 0) {
+            if (*x == '/' || *x == '\\') {
+                base = x + 1;
+            }
+            x++;
+        }
+        base_len = strlen(base);
+        if (base_len > 4 && strcmp(base + base_len - 4, ".log") == 0) {
+            base_len -= 4;
+        }
+        ret = picoquic_sprintf(out_name, sizeof(out_name), NULL, "%.*s", (int)base_len, base);
+        appctx.out_name = out_name;
+    }
+
+    if (ret == 0) {
+        appctx.f_binlog = picoquic_open_cc_log_file_for_read(appctx.binlog_name, &appctx.flags, &appctx.log_time);
+        if (appctx.f_binlog == NULL) {
+            fprintf(stderr, "Could not open log file %s\n", appctx.binlog_name);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        if (strcmp(appctx.out_format, "dump") == 0) {
+            char dump_file_name[512];
+            FILE* bin_dump = NULL;
+            size_t name_len = 0;
+
+            if (is_batch) {
+                ret = picoquic_sprintf(dump_file_name, sizeof(dump_file_name), &name_len, "%s%s%s.dump",
+                    appctx.out_dir, PICOQUIC_FILE_SEPARATOR, appctx.out_name);
+            }
+            else {
+                ret = picoquic_sprintf(dump_file_name, sizeof(dump_file_name), &name_len, "%s.dump", appctx.binlog_name);
+            }
+            if (ret == 0) {
+                bin_dump = picoquic_file_open(dump_file_name, "w");
+                if (bin_dump == NULL) {
+                    fprintf(stderr, "Could not open dump file %s\n", dump_file_name);
+                    ret = -1;
+                }
+                else {
+                    ret = filedump_binlog(appctx.f_binlog, bin_dump);
+                    (void)picoquic_file_close(bin_dump);
+                }
+            }
+        }
+        else {
+            if (appctx.template_name != NULL) {
+                appctx.f_template = picoquic_file_open(appctx.template_name, "r");
+                if (appctx.f_template == NULL) {
+                    fprintf(stderr, "Could not open template file %s\n", appctx.template_name);
+                    ret = -1;
+                }
+            }
+
+            if (ret == 0) {
+                binlog_list_cids(appctx.f_binlog, cids);
+
+                if (!is_batch) {
+                    fprintf(stderr, "%s contains %"PRIst" connection(s):\n\n", appctx.binlog_name, cids->count);
+                    cidset_print(stderr, cids);
+                    fprintf(stderr, "\n");
+                }
+
+                if (!picoquic_is_connection_id_null(cid)) {
+                    if (!cidset_has_cid(cids, cid)) {
+                        if (!is_batch) {
+                            char cid_text[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+                            (void)picoquic_print_connection_id_hexa(cid_text, sizeof(cid_text), cid);
+                            fprintf(stderr, "%s does not contain connection %s\n", appctx.binlog_name, cid_text);
+                            ret = -1;
+                        }
+                        else {
+                            cidset_delete(cids);
+                            cids = cidset_create();
+                            if (cids == NULL) {
+                                ret = -1;
+                            }
+                        }
+                    }
+                    else {
+                        (void)cidset_delete(cids);
+                        cids = cidset_create();
+                        if (cids != NULL) {
+                            cidset_insert(cids, cid);
+                        }
+                        else {
+                            ret = -1;
+                        }
+                    }
+                }
+                if (cids != NULL) {
+                    appctx.nb_cids = cids->count;
+                }
+            }
+
+            if (ret == 0) {
+                if (strcmp(appctx.out_format, "csv") == 0) {
+                    ret = cidset_iterate(cids, convert_csv, &appctx);
+                }
+                else if (strcmp(appctx.out_format, "svg") == 0) {
+                    if (appctx.f_template == NULL) {
+                        fprintf(stderr, "The svg format conversion requires a template file specified by parameter -t\n");
+                        ret = -1;
+                    }
+                    else {
+                        ret = cidset_iterate(cids, convert_svg, &appctx);
+                    }
+                }
+                else if (strcmp(appctx.out_format, "qlog") == 0) {
+                    ret = cidset_iterate(cids, convert_qlog, &appctx);
+                }
+                else {
+                    fprintf(stderr, "Invalid output format '%s'. Valid formats are\n\n", appctx.out_format);
+                    usage_formats();
+                    ret = 1;
+                }
+            }
+        }
+    }
+
+    if (is_batch) {
+        fprintf(stderr, "%s: %s, %" PRIst " connection(s)\n", binlog_name,
+            (ret == 0) ? "converted" : "failed", appctx.nb_cids);
+    }
+
+    (void)picoquic_file_close(appctx.f_binlog);
+    (void)picoquic_file_close(appctx.f_template);
+    (void)cidset_delete(cids);
+    return ret;
+}
+
+static picoquic_thread_return_t convert_batch_thread(void * arg)
+{
+    picolog_batch_t * batch = (picolog_batch_t *)arg;
+
+    while (1) {
+        size_t file_index;
+        int ret;
+
+        picoquic_lock_mutex(&batch->mutex);
+        file_index = batch->next_file++;
+        picoquic_unlock_mutex(&batch->mutex);
+
+        if (file_index >= batch->files->nb_names) {
+            break;
+        }
+
+        ret = convert_binlog_file(batch->options, batch->files->names[file_index], batch->cid, 1);
+
+        picoquic_lock_mutex(&batch->mutex);
+        if (ret == 0) {
+            batch->nb_converted++;
+        }
+        else {
+            batch->nb_errors++;
+        }
+        picoquic_unlock_mutex(&batch->mutex);
+    }
+
+    picoquic_thread_do_return;
+}
+
+/* Convert a list of files on a pool of worker threads. The files are handed
+ * out one at a time, so that a few large logs do not leave the other workers
+ * idle. Each conversion uses its own file handles and connection set, the
+ * log library keeps no shared state. */
+int convert_batch(const app_conversion_context_t * options, const picoquic_connection_id_t * cid,
+    const picolog_file_list_t * files, int nb_threads)
+{
+    int ret = 0;
+    picolog_batch_t batch;
+    picoquic_thread_t * threads = NULL;
+    int nb_started = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.options = options;
+    batch.cid = cid;
+    batch.files = files;
+
+    if ((size_t)nb_threads > files->nb_names) {
+        nb_threads = (int)files->nb_names;
+    }
+
+    if (picoquic_create_mutex(&batch.mutex) != 0) {
+        fprintf(stderr, "Fatal: failed to create resources.\n");
+        return 1;
+    }
+
+    if (nb_threads > 1) {
+        threads = (picoquic_thread_t *)malloc(sizeof(picoquic_thread_t) * nb_threads);
+        if (threads != NULL) {
+            while (nb_started < nb_threads &&
+                picoquic_create_thread(&threads[nb_started], convert_batch_thread, &batch) == 0) {
+                nb_started++;
+            }
+        }
+    }
+
+    if (nb_started == 0) {
+        /* Single thread, or threads not available: convert in the main thread. */
+        (void)convert_batch_thread(&batch);
+    }
+
+    for (int i = 0; i < nb_started; i++) {
+        (void)picoquic_wait_thread(threads[i]);
+    }
+
+    if (threads != NULL) {
+        free(threads);
+    }
+    (void)picoquic_delete_mutex(&batch.mutex);
+
+    fprintf(stderr, "Converted %" PRIst " of %" PRIst " file(s) using %d thread(s).\n",
+        batch.nb_converted, files->nb_names, (nb_started == 0) ? 1 : nb_started);
+
+    if (batch.nb_errors > 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+void usage_formats()
+{
+    fprintf(stderr, "                        -f csv  : generate CC csv file\n");
+    fprintf(stderr, "                        -f svg  : generate svg packet flow diagram.\n");
+    fprintf(stderr, "                                  requires a template specified by -t\n");
+    fprintf(stderr, "                        -f qlog : generate IETF QLOG file\n");
+}
+
+/* Batch mode output file name: "<log name>.<ext>", or "<log name>.<cid>.<ext>"
+ * if the log contains several connections. */
+static int picolog_batch_file_name(char * name, size_t name_max, const app_conversion_context_t * appctx,
+    const char * cid_name, const char * out_ext)
+{
+    if (appctx->nb_cids > 1) {
+        return picoquic_sprintf(name, name_max, NULL, "%s%s%s.%s.%s",
+            appctx->out_dir, PICOQUIC_FILE_SEPARATOR, appctx->out_name, cid_name, out_ext);
+    }
+    else {
+        return picoquic_sprintf(name, name_max, NULL, "%s%s%s.%s",
+            appctx->out_dir, PICOQUIC_FILE_SEPARATOR, appctx->out_name, out_ext);
+    }
+}
+
+int convert_csv(const picoquic_connection_id_t * cid, void * ptr)
+{
+    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
+    int ret = 0;
+
+    char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+    if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid) != 0) {
+        DBG_PRINTF("Cannot convert connection id for %s", appctx->binlog_name);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        if (appctx->out_name == NULL) {
+            ret = picoquic_cc_bin_to_csv(appctx->f_binlog,
+                open_outfile(cid_name, appctx->binlog_name, appctx->out_dir, "csv"));
+        }
+        else {
+            char csv_name[512];
+            FILE* f_csvlog = NULL;
+
+            ret = picolog_batch_file_name(csv_name, sizeof(csv_name), appctx, cid_name, "csv");
+            if (ret == 0) {
+                f_csvlog = picoquic_file_open(csv_name, "w");
+                if (f_csvlog == NULL) {
+                    fprintf(stderr, "Could not open '%s' for writing\n", csv_name);
+                    ret = -1;
+                }
+                else {
+                    ret = picoquic_cc_bin_to_csv(appctx->f_binlog, f_csvlog);
+                    (void)picoquic_file_close(f_csvlog);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+int convert_svg(const picoquic_connection_id_t * cid, void * ptr)
+{
+    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
+    int ret = 0;
+    char svg_name[512];
+    const char* txt_name = NULL;
+
+    if (appctx->out_name != NULL) {
+        char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+
+        ret = picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid);
+        if (ret == 0) {
+            ret = picolog_batch_file_name(svg_name, sizeof(svg_name), appctx, cid_name, "svg");
+            txt_name = svg_name;
+        }
+    }
+
+    if (ret == 0) {
+        ret = svg_convert_ex(cid, appctx->f_binlog, appctx->f_template, appctx->binlog_name, txt_name, appctx->out_dir);
+    }
+
+    return ret;
+}
+
+int convert_qlog(const picoquic_connection_id_t * cid, void * ptr)
+{
+    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
+    uint64_t start_time = appctx->log_time + appctx->window_start * 1000;
+    uint64_t end_time = (appctx->window_end > (UINT64_MAX - appctx->log_time) / 1000) ? UINT64_MAX :
+        appctx->log_time + appctx->window_end * 1000;
+
+    int ret = 0;
+    char qlog_name[512];
+    const char* txt_name = NULL;
+
+    if (appctx->out_name != NULL) {
+        char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+
+        ret = picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid);
+        if (ret == 0) {
+            ret = picolog_batch_file_name(qlog_name, sizeof(qlog_name), appctx, cid_name, "qlog");
+            txt_name = qlog_name;
+        }
+    }
+
+    if (ret == 0) {
+        ret = qlog_convert_ex(cid, appctx->f_binlog, appctx->binlog_name, txt_name, appctx->out_dir, appctx->flags,
+            start_time, end_time);
+    }
+
+    return ret;
+}
+
+int filedump_binlog(FILE* bin_log, FILE* bin_dump)
+{
+    int ret = 0;
+    uint8_t head[4];
+    bytestream_buf stream_msg;
+
+    fseek(bin_log, 16, SEEK_SET);
+
+    fprintf(bin_dump, "MSG-len, I-CID, Time, ID, Comment\n");
+
+    while (ret == 0 && fread(head, sizeof(head), 1, bin_log) > 0) {
+
+        uint32_t len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
+        if (len > sizeof(stream_msg.buf)) {
+            fprintf(bin_dump, "%d, x, 0, 0, \"Message larger than buffer[%d]\"\n", len, (int)sizeof(stream_msg.buf));
+            ret = -1;
+        }
+
+        if (ret == 0 && fread(stream_msg.buf, len, 1, bin_log) <= 0) {
+            fprintf(bin_dump, "%d, x, 0, 0, \"Message cannot be read from file\n", len);
+            ret = -1;
+        }
+
+        if (ret == 0) {
+            bytestream* s = bytestream_buf_init(&stream_msg, len);
+
+            picoquic_connection_id_t cid;
+            ret |= byteread_cid(s, &cid);
+
+            uint64_t time = 0;
+            ret |= byteread_vint(s, &time);
+
+            uint64_t id = 0;
+            ret |= byteread_vint(s, &id);
+
+            if (ret != 0) {
+                fprintf(bin_dump, "%d, x, 0, 0, \"cannot read CID, Time and ID\n", len);
+            }
+            else {
+                fprintf(bin_dump, "%d, x", len);
+                for (uint8_t x = 0; x < cid.id_len; x++) {
+                    fprintf(bin_dump, "%02x", cid.id[x]);
+                }
+                fprintf(bin_dump, ", %" PRIu64 ", %" PRIu64 ",\n", time, id);
+            }
+        }
+    }
+
+    return ret;
+}
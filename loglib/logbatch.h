@@ -0,0 +1,84 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef LOGBATCH_H
+#define LOGBATCH_H
+
+/* Conversion of binary log files, as done by picolog. A batch of files can
+ * be converted in parallel by a pool of worker threads.
+ */
+#include <stdio.h>
+#include "picoquic_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct app_conversion_context_st
+{
+    const char * out_format;
+    const char * out_dir;
+
+    const char * binlog_name;
+    FILE * f_binlog;
+
+    const char * template_name;
+    FILE * f_template;
+
+    uint64_t log_time;
+    uint16_t flags;
+    uint64_t window_start; /* milliseconds since the start of the log */
+    uint64_t window_end;
+
+    /* In batch mode, output files are named after the log file rather than
+     * after the connection id, because the client and server logs of the
+     * same connection carry the same id. */
+    const char * out_name;
+    size_t nb_cids;
+} app_conversion_context_t;
+
+typedef struct st_picolog_file_list_t {
+    char ** names;
+    size_t nb_names;
+    size_t nb_names_max;
+} picolog_file_list_t;
+
+int picolog_add_file(picolog_file_list_t * files, const char * name);
+void picolog_free_files(picolog_file_list_t * files);
+
+int convert_csv(const picoquic_connection_id_t * cid, void * ptr);
+int convert_svg(const picoquic_connection_id_t * cid, void * ptr);
+int convert_qlog(const picoquic_connection_id_t * cid, void * ptr);
+int filedump_binlog(FILE* bin_log, FILE* bin_dump);
+void usage_formats();
+
+/* Convert the connections found in a binary log. In batch mode, outputs are
+ * placed in options->out_dir and named after the log file. */
+int convert_binlog_file(const app_conversion_context_t * options, const char * binlog_name,
+    const picoquic_connection_id_t * cid, int is_batch);
+/* Convert a list of files in batch mode, using up to nb_threads threads. */
+int convert_batch(const app_conversion_context_t * options, const picoquic_connection_id_t * cid,
+    const picolog_file_list_t * files, int nb_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOGBATCH_H */
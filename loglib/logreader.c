@@ -23,6 +23,14 @@
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WINDOWS
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 
 #include "picoquic_internal.h"
 #include "bytestream.h"
@@ -32,37 +40,363 @@
 
 static int byteread_packet_header(bytestream * s, picoquic_packet_header * ph);
 
-int fileread_binlog(FILE* bin_log, int(*cb)(bytestream*, void*), void* cbptr)
+/* Map the log file in memory if possible, so events can be read in place.
+ * If the file cannot be mapped, events are read with fseek and fread.
+ */
+static int binlog_reader_map(binlog_reader_t* reader)
+{
+    int ret = -1;
+#ifdef _WINDOWS
+    struct __stat64 st;
+
+    if (_fstat64(_fileno(reader->f), &st) == 0) {
+        HANDLE h_file = (HANDLE)_get_osfhandle(_fileno(reader->f));
+
+        reader->file_length = (uint64_t)st.st_size;
+        if (h_file != INVALID_HANDLE_VALUE && reader->file_length > 0 && reader->file_length <= (uint64_t)SIZE_MAX) {
+            reader->h_mapping = CreateFileMapping(h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (reader->h_mapping != NULL) {
+                reader->bytes = (const uint8_t*)MapViewOfFile(reader->h_mapping, FILE_MAP_READ, 0, 0, 0);
+                if (reader->bytes == NULL) {
+                    CloseHandle(reader->h_mapping);
+                    reader->h_mapping = NULL;
+                }
+            }
+        }
+        ret = 0;
+    }
+#else
+    struct stat st;
+
+    if (fstat(fileno(reader->f), &st) == 0) {
+        reader->file_length = (uint64_t)st.st_size;
+        if (reader->file_length > 0 && reader->file_length <= (uint64_t)SIZE_MAX) {
+            void* mapping = mmap(NULL, (size_t)reader->file_length, PROT_READ, MAP_PRIVATE, fileno(reader->f), 0);
+            if (mapping != MAP_FAILED) {
+                reader->bytes = (const uint8_t*)mapping;
+            }
+        }
+        ret = 0;
+    }
+#endif
+    return ret;
+}
+
+static int binlog_reader_read_bytes(binlog_reader_t* reader, uint64_t offset, uint8_t* buffer, size_t length)
 {
     int ret = 0;
-    uint8_t head[4];
-    bytestream_buf stream_msg;
 
-    fseek(bin_log, 16, SEEK_SET);
+    if (offset + length > reader->file_length) {
+        ret = -1;
+    }
+    else if (reader->bytes != NULL) {
+        memcpy(buffer, reader->bytes + offset, length);
+    }
+#ifdef _WINDOWS
+    else if (_fseeki64(reader->f, (__int64)offset, SEEK_SET) != 0 ||
+#else
+    else if (fseeko(reader->f, (off_t)offset, SEEK_SET) != 0 ||
+#endif
+        fread(buffer, length, 1, reader->f) != 1) {
+        ret = -1;
+    }
+
+    return ret;
+}
 
-    while (ret == 0 && fread(head, sizeof(head), 1, bin_log) > 0) {
+/* Obtain the event at the specified offset, and the offset of the next event.
+ * Events are read in place if the file is mapped, or copied into the buffer.
+ */
+static int binlog_reader_get_event(binlog_reader_t* reader, uint64_t offset, uint64_t end_offset,
+    bytestream_buf* stream_msg, bytestream* stream_ref, bytestream** s, uint64_t* next_offset)
+{
+    int ret = 0;
+    uint8_t head[4];
+    uint32_t len = 0;
 
-        uint32_t len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
-        if (len > sizeof(stream_msg.buf)) {
+    if (offset + sizeof(head) > end_offset || binlog_reader_read_bytes(reader, offset, head, sizeof(head)) != 0) {
+        ret = -1;
+    }
+    else {
+        len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
+        offset += sizeof(head);
+        if (offset + len > end_offset) {
+            ret = -1;
+        }
+        else if (reader->bytes != NULL) {
+            *s = bytestream_ref_init(stream_ref, reader->bytes + offset, len);
+        }
+        else if (len > sizeof(stream_msg->buf) || binlog_reader_read_bytes(reader, offset, stream_msg->buf, len) != 0) {
             ret = -1;
         }
+        else {
+            *s = bytestream_buf_init(stream_msg, len);
+        }
+        *next_offset = offset + len;
+    }
+
+    return ret;
+}
 
-        if (ret == 0 && fread(stream_msg.buf, len, 1, bin_log) <= 0) {
+/* Load the index at the end of the file, as described in picoquic_binlog.h.
+ * If the index is absent or malformed, the file will be read sequentially.
+ */
+static int binlog_reader_load_index(binlog_reader_t* reader)
+{
+    int ret = 0;
+    uint8_t last[8];
+    uint64_t index_offset = 0;
+    uint64_t offset;
+    int is_complete = 0;
+    size_t nb_cids_max = 0;
+    size_t nb_syncs_max = 0;
+
+    if (reader->file_length < 16 + sizeof(last) ||
+        binlog_reader_read_bytes(reader, reader->file_length - sizeof(last), last, sizeof(last)) != 0) {
+        ret = -1;
+    }
+    else {
+        index_offset = PICOPARSE_64(last);
+        if (index_offset < 16 || index_offset >= reader->file_length - sizeof(last)) {
             ret = -1;
         }
+    }
+
+    offset = index_offset;
+    while (ret == 0 && !is_complete) {
+        bytestream_buf stream_msg;
+        bytestream stream_ref;
+        bytestream* s = NULL;
+        picoquic_connection_id_t cid;
+        uint64_t time = 0;
+        uint64_t path_id = 0;
+        uint64_t id = 0;
+        uint64_t kind = 0;
+
+        if ((ret = binlog_reader_get_event(reader, offset, reader->file_length, &stream_msg, &stream_ref, &s, &offset)) == 0 &&
+            (ret = byteread_cid(s, &cid)) == 0 && (ret = byteread_vint(s, &time)) == 0 &&
+            (ret = byteread_vint(s, &path_id)) == 0 && (ret = byteread_vint(s, &id)) == 0) {
+            if (id == picoquic_log_event_index_end) {
+                uint64_t end_offset = 0;
+                if (byteread_int64(s, &end_offset) != 0 || end_offset != index_offset || offset != reader->file_length) {
+                    ret = -1;
+                }
+                is_complete = 1;
+            }
+            else if (id != picoquic_log_event_index || byteread_vint(s, &kind) != 0) {
+                ret = -1;
+            }
+            else if (kind == PICOQUIC_BINLOG_INDEX_KIND_CID) {
+                if (reader->nb_cids >= nb_cids_max) {
+                    size_t new_max = (nb_cids_max == 0) ? 4 : 2 * nb_cids_max;
+                    binlog_index_cid_t* new_cids = (binlog_index_cid_t*)realloc(reader->cids, new_max * sizeof(binlog_index_cid_t));
+                    if (new_cids == NULL) {
+                        ret = -1;
+                    }
+                    else {
+                        reader->cids = new_cids;
+                        nb_cids_max = new_max;
+                    }
+                }
+                if (ret == 0 && (byteread_cid(s, &reader->cids[reader->nb_cids].cid) != 0 ||
+                    byteread_vint(s, &reader->cids[reader->nb_cids].first_offset) != 0)) {
+                    ret = -1;
+                }
+                if (ret == 0) {
+                    reader->nb_cids++;
+                }
+            }
+            else if (kind == PICOQUIC_BINLOG_INDEX_KIND_SYNC) {
+                uint64_t nb_syncs = 0;
+
+                if (byteread_vint(s, &nb_syncs) != 0 || nb_syncs > PICOQUIC_BINLOG_SYNC_PER_EVENT) {
+                    ret = -1;
+                }
+                else if (reader->nb_syncs + nb_syncs > nb_syncs_max) {
+                    size_t new_max = 2 * nb_syncs_max + (size_t)nb_syncs;
+                    binlog_sync_t* new_syncs = (binlog_sync_t*)realloc(reader->syncs, new_max * sizeof(binlog_sync_t));
+                    if (new_syncs == NULL) {
+                        ret = -1;
+                    }
+                    else {
+                        reader->syncs = new_syncs;
+                        nb_syncs_max = new_max;
+                    }
+                }
+                for (uint64_t i = 0; ret == 0 && i < nb_syncs; i++) {
+                    binlog_sync_t* sync = &reader->syncs[reader->nb_syncs];
+                    if (byteread_vint(s, &sync->time) != 0 || byteread_vint(s, &sync->offset) != 0 ||
+                        sync->offset < 16 || sync->offset >= index_offset ||
+                        (reader->nb_syncs > 0 && sync->time < reader->syncs[reader->nb_syncs - 1].time)) {
+                        ret = -1;
+                    }
+                    else {
+                        reader->nb_syncs++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (ret == 0) {
+        reader->has_index = 1;
+        reader->events_end = index_offset;
+    }
+    else {
+        if (reader->cids != NULL) {
+            free(reader->cids);
+            reader->cids = NULL;
+        }
+        if (reader->syncs != NULL) {
+            free(reader->syncs);
+            reader->syncs = NULL;
+        }
+        reader->nb_cids = 0;
+        reader->nb_syncs = 0;
+    }
+
+    return ret;
+}
+
+int binlog_reader_open(binlog_reader_t* reader, FILE* f_binlog)
+{
+    int ret = 0;
+
+    memset(reader, 0, sizeof(binlog_reader_t));
+    reader->f = f_binlog;
+
+    if (binlog_reader_map(reader) != 0) {
+        ret = -1;
+    }
+    else {
+        reader->events_end = reader->file_length;
+        (void)binlog_reader_load_index(reader);
+    }
 
+    return ret;
+}
+
+void binlog_reader_close(binlog_reader_t* reader)
+{
+#ifdef _WINDOWS
+    if (reader->bytes != NULL) {
+        UnmapViewOfFile(reader->bytes);
+    }
+    if (reader->h_mapping != NULL) {
+        CloseHandle(reader->h_mapping);
+    }
+#else
+    if (reader->bytes != NULL) {
+        (void)munmap((void*)reader->bytes, (size_t)reader->file_length);
+    }
+#endif
+    if (reader->cids != NULL) {
+        free(reader->cids);
+    }
+    if (reader->syncs != NULL) {
+        free(reader->syncs);
+    }
+    memset(reader, 0, sizeof(binlog_reader_t));
+}
+
+static int binlog_reader_read_event(binlog_reader_t* reader, uint64_t offset, uint64_t end_offset,
+    int(*cb)(bytestream*, void*), void* cbptr)
+{
+    bytestream_buf stream_msg;
+    bytestream stream_ref;
+    bytestream* s = NULL;
+    uint64_t next_offset = 0;
+    int ret = binlog_reader_get_event(reader, offset, end_offset, &stream_msg, &stream_ref, &s, &next_offset);
+
+    if (ret == 0) {
+        ret = cb(s, cbptr);
+    }
+
+    return ret;
+}
+
+int binlog_reader_read(binlog_reader_t* reader, uint64_t start_offset, uint64_t end_offset,
+    int(*cb)(bytestream*, void*), void* cbptr)
+{
+    int ret = 0;
+    uint64_t offset = start_offset;
+
+    if (end_offset > reader->events_end) {
+        end_offset = reader->events_end;
+    }
+
+    while (ret == 0 && offset + 4 <= end_offset) {
+        bytestream_buf stream_msg;
+        bytestream stream_ref;
+        bytestream* s = NULL;
+
+        ret = binlog_reader_get_event(reader, offset, end_offset, &stream_msg, &stream_ref, &s, &offset);
         if (ret == 0) {
-            bytestream* s = bytestream_buf_init(&stream_msg, len);
-            ret |= cb(s, cbptr);
+            ret = cb(s, cbptr);
         }
     }
 
     return ret;
 }
 
+void binlog_reader_find_window(binlog_reader_t* reader, uint64_t start_time, uint64_t end_time,
+    uint64_t* start_offset, uint64_t* end_offset)
+{
+    *start_offset = 16;
+    *end_offset = reader->events_end;
+
+    if (reader->has_index && reader->nb_syncs > 0) {
+        /* Start at the last sync point before the start time */
+        size_t low = 0;
+        size_t high = reader->nb_syncs;
+
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (reader->syncs[middle].time < start_time) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        if (low > 0) {
+            *start_offset = reader->syncs[low - 1].offset;
+        }
+        /* Stop at the first sync point after the end time */
+        high = reader->nb_syncs;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (reader->syncs[middle].time <= end_time) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        if (low < reader->nb_syncs) {
+            *end_offset = reader->syncs[low].offset;
+        }
+    }
+}
+
+int fileread_binlog(FILE* bin_log, int(*cb)(bytestream*, void*), void* cbptr)
+{
+    binlog_reader_t reader;
+    int ret = binlog_reader_open(&reader, bin_log);
+
+    if (ret == 0) {
+        ret = binlog_reader_read(&reader, 16, reader.events_end, cb, cbptr);
+    }
+    binlog_reader_close(&reader);
+
+    return ret;
+}
+
 typedef struct convert_log_file_event_st {
 
     const picoquic_connection_id_t * cid;
+    uint64_t start_time;
+    uint64_t end_time;
     binlog_convert_cb_t * callbacks;
 
 } convert_log_file_event_t;
@@ -90,6 +424,11 @@ static int binlog_convert_event(bytestream * s, void * ptr)
     uint64_t id = 0;
     ret |= byteread_vint(s, &id);
 
+    /* filter for time window, the connection start is always reported */
+    if (ret != 0 || ((time < ctx->start_time || time > ctx->end_time) && id != picoquic_log_event_new_connection)) {
+        return ret;
+    }
+
     switch (id) {
     case picoquic_log_event_new_connection: {
 
@@ -200,13 +539,56 @@ static int binlog_convert_event(bytestream * s, void * ptr)
     return ret;
 }
 
-int binlog_convert(FILE * f_binlog, const picoquic_connection_id_t * cid, binlog_convert_cb_t * callbacks)
+int binlog_convert_ex(FILE* f_binlog, const picoquic_connection_id_t* cid, uint64_t start_time, uint64_t end_time,
+    binlog_convert_cb_t* callbacks)
 {
     convert_log_file_event_t ctx;
+    binlog_reader_t reader;
+    int ret = binlog_reader_open(&reader, f_binlog);
+
     ctx.cid = cid;
+    ctx.start_time = start_time;
+    ctx.end_time = end_time;
     ctx.callbacks = callbacks;
 
-    return fileread_binlog(f_binlog, binlog_convert_event, &ctx);
+    if (ret == 0) {
+        if (!reader.has_index) {
+            ret = binlog_reader_read(&reader, 16, reader.events_end, binlog_convert_event, &ctx);
+        }
+        else {
+            const binlog_index_cid_t* cid_entry = NULL;
+
+            for (size_t i = 0; i < reader.nb_cids; i++) {
+                if (picoquic_compare_connection_id(&reader.cids[i].cid, cid) == 0) {
+                    cid_entry = &reader.cids[i];
+                    break;
+                }
+            }
+
+            /* Connections absent from the index are not in the file */
+            if (cid_entry != NULL) {
+                uint64_t start_offset;
+                uint64_t end_offset;
+
+                binlog_reader_find_window(&reader, start_time, end_time, &start_offset, &end_offset);
+                if (start_offset > cid_entry->first_offset) {
+                    /* Report the connection start, which precedes the selected window */
+                    ret = binlog_reader_read_event(&reader, cid_entry->first_offset, start_offset, binlog_convert_event, &ctx);
+                }
+                if (ret == 0) {
+                    ret = binlog_reader_read(&reader, start_offset, end_offset, binlog_convert_event, &ctx);
+                }
+            }
+        }
+    }
+    binlog_reader_close(&reader);
+
+    return ret;
+}
+
+int binlog_convert(FILE * f_binlog, const picoquic_connection_id_t * cid, binlog_convert_cb_t * callbacks)
+{
+    return binlog_convert_ex(f_binlog, cid, 0, UINT64_MAX, callbacks);
 }
 
 static int binlog_list_cids_cb(bytestream * s, void * cbptr)
@@ -223,7 +605,22 @@ static int binlog_list_cids_cb(bytestream * s, void * cbptr)
 
 int binlog_list_cids(FILE * binlog, picohash_table * cids)
 {
-    return fileread_binlog(binlog, binlog_list_cids_cb, cids);
+    binlog_reader_t reader;
+    int ret = binlog_reader_open(&reader, binlog);
+
+    if (ret == 0) {
+        if (reader.has_index) {
+            for (size_t i = 0; ret == 0 && i < reader.nb_cids; i++) {
+                ret = cidset_insert(cids, &reader.cids[i].cid);
+            }
+        }
+        else {
+            ret = binlog_reader_read(&reader, 16, reader.events_end, binlog_list_cids_cb, cids);
+        }
+    }
+    binlog_reader_close(&reader);
+
+    return ret;
 }
 
 static int byteread_packet_header(bytestream * s, picoquic_packet_header * ph)
@@ -321,7 +718,7 @@ FILE * picoquic_open_cc_log_file_for_read(char const * bin_cc_log_name, uint16_t
             ret = -1;
             DBG_PRINTF("Header for file %s does include flags.\n", bin_cc_log_name);
         }
-        else if (byteread_int16(ps, &version) != 0 || version != 0x01) {
+        else if (byteread_int16(ps, &version) != 0 || version < 0x01 || version > PICOQUIC_BINLOG_VERSION) {
             ret = -1;
             DBG_PRINTF("Header for file %s requires unsupported version.\n", bin_cc_log_name);
         }
@@ -32,6 +32,62 @@
 extern "C" {
 #endif
 
+/*! \brief Sync point of a binary log index: time of an event and offset
+ *         of that event in the file.
+ */
+typedef struct st_binlog_sync_t {
+    uint64_t time;
+    uint64_t offset;
+} binlog_sync_t;
+
+/*! \brief Connection listed in a binary log index, with the offset of
+ *         its first event.
+ */
+typedef struct st_binlog_index_cid_t {
+    picoquic_connection_id_t cid;
+    uint64_t first_offset;
+} binlog_index_cid_t;
+
+/*! \brief Reader of a binary log file.
+ *
+ *  The file is mapped in memory when possible, and read with fseek and
+ *  fread otherwise. If the file ends with an index (see picoquic_binlog.h),
+ *  the index is loaded and events_end is set to the start of the index.
+ */
+typedef struct st_binlog_reader_t {
+    FILE* f;
+    const uint8_t* bytes;
+    uint64_t file_length;
+    uint64_t events_end;
+    int has_index;
+    binlog_index_cid_t* cids;
+    size_t nb_cids;
+    binlog_sync_t* syncs;
+    size_t nb_syncs;
+#ifdef _WINDOWS
+    HANDLE h_mapping;
+#endif
+} binlog_reader_t;
+
+/*! \brief Prepare reading a binary log file, mapping it and loading its index.
+ *         The reader shall be closed with binlog_reader_close, even on error.
+ */
+int binlog_reader_open(binlog_reader_t* reader, FILE* f_binlog);
+
+void binlog_reader_close(binlog_reader_t* reader);
+
+/*! \brief Call the callback function for each event starting between
+ *         start_offset and end_offset.
+ */
+int binlog_reader_read(binlog_reader_t* reader, uint64_t start_offset, uint64_t end_offset,
+    int (*cb)(bytestream*, void*), void* cbptr);
+
+/*! \brief Find the range of offsets that contains the events between
+ *         start_time and end_time. Without index, this is the whole file.
+ */
+void binlog_reader_find_window(binlog_reader_t* reader, uint64_t start_time, uint64_t end_time,
+    uint64_t* start_offset, uint64_t* end_offset);
+
 /*! \brief Read the contents of a binary log file and call the callback
  *         function for each event found in the file.
  *
@@ -77,6 +133,13 @@ typedef struct binlog_convert_cb_st {
  */
 int binlog_convert(FILE * f_binlog, const picoquic_connection_id_t * cid, binlog_convert_cb_t * callbacks);
 
+/*! \brief Same as binlog_convert, but only report the events between start_time
+ *         and end_time, in addition to the connection start. If the file has an
+ *         index, reading starts at the closest sync point before start_time.
+ */
+int binlog_convert_ex(FILE* f_binlog, const picoquic_connection_id_t* cid, uint64_t start_time, uint64_t end_time,
+    binlog_convert_cb_t* callbacks);
+
 /*! \brief Write all connection ids contained in a binary log file into a
  *         picohash_table.
  *
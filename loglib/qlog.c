@@ -63,22 +63,99 @@ typedef struct qlog_context_st {
     int state;
 } qlog_context_t;
 
-int qlog_string(FILE* f, bytestream* s, uint64_t l)
+/* Output helpers. The qlog file is written through a large stdio buffer,
+ * and locked once for the whole conversion. The helpers copy strings and
+ * format numbers directly into that buffer, which is much faster than
+ * parsing a fprintf format and locking the file for each element.
+ */
+#define QLOG_OUTPUT_BUFFER_SIZE 0x40000
+
+#ifdef _WINDOWS
+#define qlog_fwrite(bytes, length, f) _fwrite_nolock(bytes, 1, length, f)
+#define qlog_lock_file(f) _lock_file(f)
+#define qlog_unlock_file(f) _unlock_file(f)
+#else
+#ifdef __GLIBC__
+#define qlog_fwrite(bytes, length, f) fwrite_unlocked(bytes, 1, length, f)
+#else
+#define qlog_fwrite(bytes, length, f) fwrite(bytes, 1, length, f)
+#endif
+#define qlog_lock_file(f) flockfile(f)
+#define qlog_unlock_file(f) funlockfile(f)
+#endif
+
+static void qlog_puts(FILE* f, const char* text)
 {
-    uint64_t x;
-    int error_found = (s->ptr + (size_t)l > s->size);
+    (void)qlog_fwrite(text, strlen(text), f);
+}
+
+static void qlog_uint(FILE* f, uint64_t v)
+{
+    char digits[20];
+    size_t nb_digits = 0;
 
-    fprintf(f, "\"");
+    do {
+        digits[sizeof(digits) - 1 - nb_digits] = (char)('0' + v % 10);
+        v /= 10;
+        nb_digits++;
+    } while (v != 0);
 
-    for (x = 0; x < l && s->ptr < s->size; x++) {
-        fprintf(f, "%02x", s->data[s->ptr++]);
+    (void)qlog_fwrite(digits + sizeof(digits) - nb_digits, nb_digits, f);
+}
+
+static void qlog_int(FILE* f, int64_t v)
+{
+    if (v < 0) {
+        (void)qlog_fwrite("-", 1, f);
+        qlog_uint(f, (uint64_t)0 - (uint64_t)v);
+    }
+    else {
+        qlog_uint(f, (uint64_t)v);
+    }
+}
+
+static void qlog_hex(FILE* f, const uint8_t* bytes, size_t length)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    char hex[128];
+
+    while (length > 0) {
+        size_t nb_bytes = (length > sizeof(hex) / 2) ? sizeof(hex) / 2 : length;
+
+        for (size_t i = 0; i < nb_bytes; i++) {
+            hex[2 * i] = hex_digits[bytes[i] >> 4];
+            hex[2 * i + 1] = hex_digits[bytes[i] & 0x0f];
+        }
+        (void)qlog_fwrite(hex, 2 * nb_bytes, f);
+        bytes += nb_bytes;
+        length -= nb_bytes;
+    }
+}
+
+static void qlog_event_separator(FILE* f, qlog_context_t* ctx)
+{
+    if (ctx->event_count != 0) {
+        qlog_puts(f, ",\n");
+    }
+    else {
+        qlog_puts(f, "\n");
     }
+}
+
+int qlog_string(FILE* f, bytestream* s, uint64_t l)
+{
+    int error_found = (s->ptr + (size_t)l > s->size);
+    size_t length = (error_found) ? s->size - s->ptr : (size_t)l;
+
+    qlog_puts(f, "\"");
+    qlog_hex(f, s->data + s->ptr, length);
+    s->ptr += length;
 
     if (error_found) {
-        fprintf(f, "... coding error!");
+        qlog_puts(f, "... coding error!");
     }
 
-    fprintf(f, "\"");
+    qlog_puts(f, "\"");
     return (error_found) ? -1 : 0;
 }
 
@@ -87,26 +164,28 @@ int qlog_chars(FILE* f, bytestream* s, uint64_t l)
     uint64_t x;
     int error_found = (s->ptr + (size_t)l > s->size);
 
-    fprintf(f, "\"");
+    qlog_puts(f, "\"");
 
     for (x = 0; x < l && s->ptr < s->size; x++) {
-        int c = s->data[s->ptr++];
+        uint8_t c = s->data[s->ptr++];
         if (c == '"' || c == '\\') {
-            fprintf(f, "\\%c", c);
+            char escaped[2] = { '\\', (char)c };
+            (void)qlog_fwrite(escaped, 2, f);
         }
         else if (c >= ' ' && c < 127) {
-            fprintf(f, "%c", c);
+            (void)qlog_fwrite(&c, 1, f);
         }
         else {
-            fprintf(f, "\\%02x", c);
+            (void)qlog_fwrite("\\", 1, f);
+            qlog_hex(f, &c, 1);
         }
     }
 
     if (error_found) {
-        fprintf(f, "... coding error!");
+        qlog_puts(f, "... coding error!");
     }
 
-    fprintf(f, "\"");
+    qlog_puts(f, "\"");
     return (error_found) ? -1 : 0;
 }
 
@@ -143,11 +222,18 @@ static void qlog_log_addr(FILE* f, struct sockaddr* addr_peer)
 
 void qlog_event_header(FILE * f, qlog_context_t* ctx, int64_t delta_time, uint64_t path_id, char const * event_class, char const * event_name)
 {
-    fprintf(f, "[%"PRId64", ", delta_time);
+    qlog_puts(f, "[");
+    qlog_int(f, delta_time);
+    qlog_puts(f, ", ");
     if (ctx->trace_flow_id) {
-        fprintf(f, "%"PRId64", ", path_id);
-    }
-    fprintf(f, "\"%s\", \"%s\", {", event_class, event_name);
+        qlog_int(f, (int64_t)path_id);
+        qlog_puts(f, ", ");
+    }
+    qlog_puts(f, "\"");
+    qlog_puts(f, event_class);
+    qlog_puts(f, "\", \"");
+    qlog_puts(f, event_name);
+    qlog_puts(f, "\", {");
 }
 
 void qlog_vint_transport_extension(FILE* f, char const* ext_name, bytestream* s, uint64_t len)
@@ -388,12 +474,7 @@ int qlog_alpn_update(uint64_t time, bytestream* s, void* ptr)
 
     ret |= byteread_vint(s, &owner);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     ret |= byteread_vint(s, &sni_length);
     qlog_event_header(f, ctx, delta_time, 0, "transport", "parameters_set");
@@ -444,12 +525,7 @@ int qlog_param_update(uint64_t time, bytestream* s, void* ptr)
 
     ret |= byteread_vint(s, &owner);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, 0, "transport", "parameters_set");
 
@@ -484,12 +560,7 @@ int qlog_packet_lost(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
     ret |= byteread_vint(s, &sequence);
     ret |= byteread_vint(s, &trigger_length);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, path_id, "recovery", "packet_lost");
     fprintf(f, "\n    \"packet_type\" : \"%s\"", ptype2str((picoquic_packet_type_enum)packet_type));
@@ -534,12 +605,7 @@ int qlog_packet_dropped(uint64_t time, uint64_t path_id, bytestream* s, void* pt
     ret |= byteread_vint(s, &err_code);
     ret |= byteread_vint(s, &raw_len);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, path_id, "transport", "packet_dropped");
     fprintf(f, "\n    \"packet_type\" : \"%s\"", ptype2str((picoquic_packet_type_enum)packet_type));
@@ -598,12 +664,7 @@ int qlog_packet_buffered(uint64_t time, uint64_t path_id, bytestream* s, void* p
     ret |= byteread_vint(s, &packet_type);
     ret |= byteread_vint(s, &trigger_length);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, path_id, "transport", "packet_buffered");
 
@@ -632,16 +693,12 @@ int qlog_pdu(uint64_t time, int rxtx, bytestream* s, void * ptr)
     byteread_vint(s, &byte_length);
     ret_local = byteread_addr(s, &addr_local);
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, 0, "transport", (rxtx == 0) ? "datagram_sent" : "datagram_received");
 
-    fprintf(f, " \"byte_length\": %" PRIu64, byte_length);
+    qlog_puts(f, " \"byte_length\": ");
+    qlog_uint(f, byte_length);
 
     if (addr_peer.ss_family != 0 &&
         picoquic_compare_addr((struct sockaddr*)&addr_peer, (struct sockaddr*) & ctx->addr_peer) != 0) {
@@ -659,7 +716,7 @@ int qlog_pdu(uint64_t time, int rxtx, bytestream* s, void * ptr)
         picoquic_store_addr(&ctx->addr_local, (struct sockaddr*) & addr_local);
     }
 
-    fprintf(f, "}]");
+    qlog_puts(f, "}]");
     ctx->event_count++;
     return 0;
 }
@@ -670,11 +727,7 @@ int qlog_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const pico
     FILE * f = ctx->f_txtlog;
     int64_t delta_time = time - ctx->start_time;
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    } else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     if (ph->ptype == picoquic_packet_1rtt_protected && rxtx == 0) {
         if (ctx->spin_bit_sent && (ctx->spin_bit_sent_last != ph->spin)) {
@@ -686,11 +739,15 @@ int qlog_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const pico
     }
 
     qlog_event_header(f, ctx, delta_time, path_id, "transport", (rxtx == 0) ? "packet_sent" : "packet_received");
-    fprintf(f, " \"packet_type\": \"%s\", \"header\": { \"packet_size\": %"PRIu64 , ptype2str(ph->ptype), size);
+    qlog_puts(f, " \"packet_type\": \"");
+    qlog_puts(f, ptype2str(ph->ptype));
+    qlog_puts(f, "\", \"header\": { \"packet_size\": ");
+    qlog_uint(f, size);
 
     if (ph->ptype != picoquic_packet_version_negotiation &&
         ph->ptype != picoquic_packet_retry) {
-        fprintf(f, ", \"packet_number\": %"PRIu64, ph->pn64);
+        qlog_puts(f, ", \"packet_number\": ");
+        qlog_uint(f, ph->pn64);
     }
 
     if (ph->ptype != picoquic_packet_1rtt_protected) {
@@ -712,9 +769,9 @@ int qlog_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const pico
     }
 
     if (ph->dest_cnx_id.id_len > 0) {
-        char dcid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
-        picoquic_print_connection_id_hexa(dcid_name, sizeof(dcid_name), &ph->dest_cnx_id);
-        fprintf(f, ", \"dcid\": \"%s\"", dcid_name);
+        qlog_puts(f, ", \"dcid\": \"");
+        qlog_hex(f, ph->dest_cnx_id.id, ph->dest_cnx_id.id_len);
+        qlog_puts(f, "\"");
     }
 
     if (ph->ptype == picoquic_packet_initial && ph->token_length > 0) {
@@ -738,7 +795,7 @@ int qlog_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const pico
             ctx->key_phase_received = 1;
         }
         if (need_key_phase) {
-            fprintf(f, ", \"key_phase\": %d", ph->key_phase);
+            qlog_puts(f, (ph->key_phase) ? ", \"key_phase\": 1" : ", \"key_phase\": 0");
         }
     }
 
@@ -750,10 +807,10 @@ int qlog_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const pico
 
     if (ctx->packet_type == picoquic_packet_version_negotiation ||
         ctx->packet_type == picoquic_packet_retry) {
-        fprintf(f, " }");
+        qlog_puts(f, " }");
     }
     else {
-        fprintf(f, " }, \"frames\": [");
+        qlog_puts(f, " }, \"frames\": [");
     }
 
     ctx->frame_count = 0;
@@ -1048,9 +1105,10 @@ void qlog_ack_frame(uint64_t ftype, FILE * f, bytestream* s)
     }
     byteread_vint(s, &largest);
     byteread_vint(s, &ack_delay);
-    fprintf(f, ", \"ack_delay\": %"PRIu64"", ack_delay);
+    qlog_puts(f, ", \"ack_delay\": ");
+    qlog_uint(f, ack_delay);
     byteread_vint(s, &num);
-    fprintf(f, ", \"acked_ranges\": [");
+    qlog_puts(f, ", \"acked_ranges\": [");
     for (uint64_t i = 0; i <= num; i++) {
         uint64_t skip = 0;
         int64_t start_range;
@@ -1061,18 +1119,22 @@ void qlog_ack_frame(uint64_t ftype, FILE * f, bytestream* s)
             skip++;
 
             largest -= skip;
-            fprintf(f, ", ");
+            qlog_puts(f, ", ");
         }
         uint64_t range = 0;
         byteread_vint(s, &range);
 
         start_range = largest - range;
         end_range = (int64_t)largest;
-        fprintf(f, "[%"PRId64", %"PRId64"]", start_range, end_range);
+        qlog_puts(f, "[");
+        qlog_int(f, start_range);
+        qlog_puts(f, ", ");
+        qlog_int(f, end_range);
+        qlog_puts(f, "]");
 
         largest -= range + 1;
     }
-    fprintf(f, "]");
+    qlog_puts(f, "]");
     if (ftype == picoquic_frame_type_ack_ecn || ftype == picoquic_frame_type_path_ack_ecn) {
         char const* ecn_name[3] = { "ect0", "ect1", "ce" };
         for (int ecnx = 0; ecnx < 3; ecnx++) {
@@ -1186,16 +1248,18 @@ int qlog_packet_frame(bytestream * s, void * ptr)
     }
 
     if (ctx->frame_count != 0) {
-        fprintf(f, ", ");
+        qlog_puts(f, ", ");
     }
 
-    fprintf(f, "{ ");
+    qlog_puts(f, "{ ");
 
     uint64_t ftype = 0;
     size_t ptr_before_type = s->ptr;
     byteread_vint(s, &ftype);
 
-    fprintf(f, "\n    \"frame_type\": \"%s\"", ftype2str((picoquic_frame_type_enum_t)ftype));
+    qlog_puts(f, "\n    \"frame_type\": \"");
+    qlog_puts(f, ftype2str((picoquic_frame_type_enum_t)ftype));
+    qlog_puts(f, "\"");
 
     if (ftype >= picoquic_frame_type_stream_range_min &&
         ftype <= picoquic_frame_type_stream_range_max) {
@@ -1207,14 +1271,19 @@ int qlog_packet_frame(bytestream * s, void * ptr)
         }
         uint64_t length = 0;
         byteread_vint(s, &length);
-        fprintf(f, ", \"id\": %"PRIu64", \"offset\": %"PRIu64", \"length\": %"PRIu64", \"fin\": %s ",
-            stream_id, offset, length, (ftype & 1) ? "true":"false");
+        qlog_puts(f, ", \"id\": ");
+        qlog_uint(f, stream_id);
+        qlog_puts(f, ", \"offset\": ");
+        qlog_uint(f, offset);
+        qlog_puts(f, ", \"length\": ");
+        qlog_uint(f, length);
+        qlog_puts(f, (ftype & 1) ? ", \"fin\": true " : ", \"fin\": false ");
         if ((ftype & 2) == 0) {
-            fprintf(f, ", \"has_length\": false");
+            qlog_puts(f, ", \"has_length\": false");
         }
         uint64_t extra_bytes = bytestream_remain(s);
         if (extra_bytes > 0) {
-            fprintf(f, ", \"begins_with\": ");
+            qlog_puts(f, ", \"begins_with\": ");
             qlog_string(f, s, extra_bytes);
         }
 
@@ -1319,7 +1388,7 @@ int qlog_packet_frame(bytestream * s, void * ptr)
         break;
     }
 
-    fprintf(f, "}");
+    qlog_puts(f, "}");
     ctx->frame_count++;
     return 0;
 }
@@ -1331,10 +1400,10 @@ int qlog_packet_end(void * ptr)
 
     if (ctx->packet_type == picoquic_packet_version_negotiation ||
         ctx->packet_type == picoquic_packet_retry) {
-        fprintf(f, "}]");
+        qlog_puts(f, "}]");
     }
     else {
-        fprintf(f, "]}]");
+        qlog_puts(f, "]}]");
     }
 
     ctx->packet_count++; 
@@ -1416,17 +1485,14 @@ int qlog_cc_update(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
         int64_t delta_time = time - ctx->start_time;
         char* comma = "";
 
-        if (ctx->event_count != 0) {
-            fprintf(f, ",\n");
-        }
-        else {
-            fprintf(f, "\n");
-        }
+        qlog_event_separator(f, ctx);
 
         qlog_event_header(f, ctx, delta_time, path_id, "recovery", "metrics_updated");
 
         if (cwin != ctx->cwin) {
-            fprintf(f, "%s\"cwnd\": %" PRIu64, comma, cwin);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"cwnd\": ");
+            qlog_uint(f, cwin);
             ctx->cwin = cwin;
             comma = ",";
         }
@@ -1434,41 +1500,53 @@ int qlog_cc_update(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
         if (pacing_packet_time != ctx->pacing_packet_time && pacing_packet_time > 0) {
             double bps = ((double)Send_MTU * 8) * 1000000.0 / pacing_packet_time;
             uint64_t bits_per_second = (uint64_t)bps;
-            fprintf(f, "%s\"pacing_rate\": %" PRIu64, comma, bits_per_second);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"pacing_rate\": ");
+            qlog_uint(f, bits_per_second);
             ctx->pacing_packet_time = pacing_packet_time;
             comma = ",";
         }
 
         if (bytes_in_transit != ctx->bytes_in_transit) {
-            fprintf(f, "%s\"bytes_in_flight\": %" PRIu64, comma, bytes_in_transit);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"bytes_in_flight\": ");
+            qlog_uint(f, bytes_in_transit);
             ctx->bytes_in_transit = bytes_in_transit;
             comma = ",";
         }
 
         if (SRTT != ctx->SRTT) {
-            fprintf(f, "%s\"smoothed_rtt\": %" PRIu64, comma, SRTT);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"smoothed_rtt\": ");
+            qlog_uint(f, SRTT);
             comma = ",";
         }
 
         if (RTT_min != ctx->RTT_min) {
-            fprintf(f, "%s\"min_rtt\": %" PRIu64, comma, RTT_min);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"min_rtt\": ");
+            qlog_uint(f, RTT_min);
             ctx->RTT_min = RTT_min;
             comma = ",";
         }
 
         if (rtt_sample != ctx->rtt_sample) {
-            fprintf(f, "%s\"latest_rtt\": %" PRIu64, comma, rtt_sample);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"latest_rtt\": ");
+            qlog_uint(f, rtt_sample);
             ctx->rtt_sample = rtt_sample;
             comma = ",";
         }
 
         if (app_limited != ctx->app_limited) {
-            fprintf(f, "%s\"app_limited\": %" PRIu64, comma, app_limited);
+            qlog_puts(f, comma);
+            qlog_puts(f, "\"app_limited\": ");
+            qlog_uint(f, app_limited);
             ctx->app_limited = (app_limited != 0);
             /* comma = ","; (not useful since last block of function) */
         }
 
-        fprintf(f, "}]");
+        qlog_puts(f, "}]");
         ctx->event_count++;
     }
 
@@ -1484,12 +1562,7 @@ int qlog_info_message(uint64_t time, bytestream* s, void* ptr)
     uint8_t message[BYTESTREAM_MAX_BUFFER_SIZE];
     size_t message_length = 0;
 
-    if (ctx->event_count != 0) {
-        fprintf(f, ",\n");
-    }
-    else {
-        fprintf(f, "\n");
-    }
+    qlog_event_separator(f, ctx);
 
     qlog_event_header(f, ctx, delta_time, 0, "info", "message");
 
@@ -1568,7 +1641,8 @@ int qlog_connection_end(uint64_t time, void * ptr)
     return 0;
 }
 
-int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char* binlog_name, const char* txt_name, const char* out_dir, uint16_t flags)
+int qlog_convert_ex(const picoquic_connection_id_t* cid, FILE* f_binlog, const char* binlog_name, const char* txt_name, const char* out_dir, uint16_t flags,
+    uint64_t start_time, uint64_t end_time)
 {
     int ret = 0;
     FILE* f_txtlog = NULL;
@@ -1592,6 +1666,11 @@ int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char
 
         qlog_context_t qlog;
 
+        if (f_txtlog != stdout) {
+            (void)setvbuf(f_txtlog, NULL, _IOFBF, QLOG_OUTPUT_BUFFER_SIZE);
+        }
+        qlog_lock_file(f_txtlog);
+
         memset(&qlog, 0, sizeof(qlog_context_t));
 
         qlog.f_txtlog = f_txtlog;
@@ -1617,14 +1696,20 @@ int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char
         ctx.info_message = qlog_info_message;
         ctx.ptr = &qlog;
 
-        ret = binlog_convert(f_binlog, cid, &ctx);
+        ret = binlog_convert_ex(f_binlog, cid, start_time, end_time, &ctx);
 
         if (qlog.state == 1) {
             qlog_connection_end(0, &qlog);
         }
 
+        qlog_unlock_file(f_txtlog);
         picoquic_file_close(f_txtlog);
     }
 
     return ret;
 }
+
+int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char* binlog_name, const char* txt_name, const char* out_dir, uint16_t flags)
+{
+    return qlog_convert_ex(cid, f_binlog, binlog_name, txt_name, out_dir, flags, 0, UINT64_MAX);
+}
@@ -36,6 +36,8 @@ int qlog_connection_start(uint64_t time, const picoquic_connection_id_t * cid, i
 int qlog_connection_end(uint64_t time, void * ptr);
 
 int qlog_convert(const picoquic_connection_id_t* cid, FILE * f_binlog, const char * binlog_name, const char* txt_name, const char * out_dir, uint16_t flags);
+int qlog_convert_ex(const picoquic_connection_id_t* cid, FILE* f_binlog, const char* binlog_name, const char* txt_name, const char* out_dir, uint16_t flags,
+    uint64_t start_time, uint64_t end_time);
 
 #ifdef __cplusplus
 }
@@ -198,48 +198,76 @@ int svg_info_message(uint64_t time, bytestream* s, void* ptr)
     return 0;
 }
 
-int svg_convert(const picoquic_connection_id_t * cid, FILE * f_binlog, FILE * f_template, const char * binlog_name, const char * out_dir)
+int svg_convert_ex(const picoquic_connection_id_t * cid, FILE * f_binlog, FILE * f_template, const char * binlog_name,
+    const char * txt_name, const char * out_dir)
 {
     int ret = 0;
+    FILE * f_txtlog = NULL;
 
     char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
     if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid) != 0) {
         DBG_PRINTF("Cannot convert connection id for %s", binlog_name);
         ret = -1;
     }
+    else if (txt_name == NULL) {
+        f_txtlog = open_outfile(cid_name, binlog_name, out_dir, "svg");
+    }
+    else {
+        f_txtlog = picoquic_file_open(txt_name, "w");
+        if (f_txtlog == NULL) {
+            fprintf(stderr, "Could not open '%s' for writing\n", txt_name);
+        }
+    }
+
+    if (f_txtlog == NULL) {
+        ret = -1;
+    }
+    else {
+        svg_context_t svg;
+        svg.f_txtlog = f_txtlog;
+        svg.f_template = f_template;
+        svg.cid_name = cid_name;
+        svg.start_time = 0;
+        svg.packet_count = 0;
+
+        binlog_convert_cb_t ctx;
+        ctx.connection_start = svg_connection_start;
+        ctx.connection_end = svg_connection_end;
+        ctx.param_update = svg_alpn_update;
+        ctx.param_update = svg_param_update;
+        ctx.pdu = svg_pdu;
+        ctx.packet_start = svg_packet_start;
+        ctx.packet_frame = svg_packet_frame;
+        ctx.packet_end = svg_packet_end;
+        ctx.packet_lost = svg_packet_lost;
+        ctx.packet_dropped = svg_packet_dropped;
+        ctx.packet_buffered = svg_packet_buffered;
+        ctx.cc_update = svg_cc_update;
+        ctx.info_message = svg_info_message;
+        ctx.ptr = &svg;
+
+        /* The template is copied once per connection */
+        fseek(f_template, 0, SEEK_SET);
+
+        char line[256];
+        while (fgets(line, sizeof(line), f_template) != NULL) /* read a line */ {
+            if (strcmp(line, "#\n") != 0) {
+                /* Copy the template to the SVG file */
+                fprintf(svg.f_txtlog, "%s", line);
+            } else {
+                ret = binlog_convert(f_binlog, cid, &ctx);
+            }
+        }
 
-    svg_context_t svg;
-    svg.f_txtlog = open_outfile(cid_name, binlog_name, out_dir, "svg");
-    svg.f_template = f_template;
-    svg.cid_name = cid_name;
-    svg.start_time = 0;
-    svg.packet_count = 0;
-
-    binlog_convert_cb_t ctx;
-    ctx.connection_start = svg_connection_start;
-    ctx.connection_end = svg_connection_end;
-    ctx.param_update = svg_alpn_update;
-    ctx.param_update = svg_param_update;
-    ctx.pdu = svg_pdu;
-    ctx.packet_start = svg_packet_start;
-    ctx.packet_frame = svg_packet_frame;
-    ctx.packet_end = svg_packet_end;
-    ctx.packet_lost = svg_packet_lost;
-    ctx.packet_dropped = svg_packet_dropped;
-    ctx.packet_buffered = svg_packet_buffered;
-    ctx.cc_update = svg_cc_update;
-    ctx.info_message = svg_info_message;
-    ctx.ptr = &svg;
-
-    char line[256];
-    while (fgets(line, sizeof(line), f_template) != NULL) /* read a line */ {
-        if (strcmp(line, "#\n") != 0) {
-            /* Copy the template to the SVG file */
-            fprintf(svg.f_txtlog, "%s", line);
-        } else {
-            ret = binlog_convert(f_binlog, cid, &ctx);
+        if (f_txtlog != stdout) {
+            (void)picoquic_file_close(f_txtlog);
         }
     }
 
     return ret;
 }
+
+int svg_convert(const picoquic_connection_id_t * cid, FILE * f_binlog, FILE * f_template, const char * binlog_name, const char * out_dir)
+{
+    return svg_convert_ex(cid, f_binlog, f_template, binlog_name, NULL, out_dir);
+}
@@ -53,6 +53,8 @@ int svg_packet_frame(bytestream * s, void * ptr);
 int svg_packet_end(void * ptr);
 
 int svg_convert(const picoquic_connection_id_t * cid, FILE * f_binlog, FILE * f_template, const char * binlog_name, const char * out_dir);
+int svg_convert_ex(const picoquic_connection_id_t * cid, FILE * f_binlog, FILE * f_template, const char * binlog_name,
+    const char * txt_name, const char * out_dir);
 
 #ifdef __cplusplus
 }
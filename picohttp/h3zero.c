@@ -27,9 +27,10 @@
  * - Generate the corresponding document in memory
  * The "request" is expected to be an H3 request header frame, encoded with QPACK
  * The "response" will include a response header frame and one or several data frames.
- * QPACK encoding only uses the static dictionary.
+ * QPACK encoding uses the static dictionary, and if the peer allows it a
+ * dynamic table for repeated values such as authority, user agent or server.
  * The server will start the connection by sending a setting frame, which will
- * specify a zero-length dynamic dictionary for QPACK.
+ * specify the size of the dynamic table that the peer may use.
  */
 #include <string.h>
 #include <stdlib.h>
@@ -273,8 +274,245 @@ h3zero_qpack_static_t qpack_static[] = {
 
 size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_static_t);
 
+/*
+ * Names of the headers, in the order of http_header_enum_t. The names are
+ * needed when inserting an entry in the dynamic table with a reference to
+ * the static table, because the size of a dynamic entry is computed as the
+ * length of the name plus the length of the value plus 32.
+ */
+static char const* h3zero_header_name[] = {
+    "", ":authority", ":path", "age", "content-disposition", "content-length",
+    "cookie", "date", "etag", "if-modified-since", "if-none-match", "last-modified",
+    "link", "location", "referer", "set-cookie", ":method", ":scheme", ":status",
+    ":protocol", "accept", "accept-encoding", "accept-ranges",
+    "access-control-allow-headers", "access-control-allow-origin", "cache-control",
+    "content-encoding", "content-type", "range", "strict-transport-security", "vary",
+    "x-content-type-options", "x-xss-protection", "accept-language",
+    "access-control-allow-credentials", "access-control-allow-methods",
+    "access-control-expose-headers", "access-control-request-headers",
+    "access-control-request-method", "alt-svc", "authorization",
+    "content-security-policy", "early-data", "expect-ct", "forwarded", "if-range",
+    "origin", "purpose", "server", "timing-allow-origin", "upgrade-insecure-requests",
+    "user-agent", "x-forwarded-for", "x-frame-options"
+};
+
+static char const* h3zero_get_header_name(http_header_enum_t header)
+{
+    return (header > http_header_unknown && header < http_header_max) ? h3zero_header_name[header] : "";
+}
+
+/*
+ * Buffers used to accumulate the instructions exchanged on the encoder
+ * and decoder streams.
+ */
+static uint8_t* h3zero_qpack_buffer_reserve(h3zero_qpack_buffer_t* buffer, size_t needed)
+{
+    if (buffer->length + needed > buffer->size) {
+        size_t new_size = (buffer->size == 0) ? 256 : 2 * buffer->size;
+        uint8_t* new_bytes;
+
+        while (new_size < buffer->length + needed) {
+            new_size *= 2;
+        }
+        new_bytes = (uint8_t*)realloc(buffer->bytes, new_size);
+        if (new_bytes == NULL) {
+            return NULL;
+        }
+        buffer->bytes = new_bytes;
+        buffer->size = new_size;
+    }
+
+    return buffer->bytes + buffer->length;
+}
+
+static int h3zero_qpack_buffer_append(h3zero_qpack_buffer_t* buffer, const uint8_t* bytes, size_t length)
+{
+    int ret = 0;
+
+    if (length > 0) {
+        uint8_t* next = h3zero_qpack_buffer_reserve(buffer, length);
+
+        if (next == NULL) {
+            ret = -1;
+        }
+        else {
+            memcpy(next, bytes, length);
+            buffer->length += length;
+        }
+    }
+
+    return ret;
+}
+
+static void h3zero_qpack_buffer_consume(h3zero_qpack_buffer_t* buffer, size_t consumed)
+{
+    if (consumed >= buffer->length) {
+        buffer->length = 0;
+    }
+    else if (consumed > 0) {
+        memmove(buffer->bytes, buffer->bytes + consumed, buffer->length - consumed);
+        buffer->length -= consumed;
+    }
+}
+
+static void h3zero_qpack_buffer_release(h3zero_qpack_buffer_t* buffer)
+{
+    if (buffer->bytes != NULL) {
+        free(buffer->bytes);
+    }
+    memset(buffer, 0, sizeof(h3zero_qpack_buffer_t));
+}
+
+/*
+ * Management of the dynamic tables.
+ */
+static int h3zero_qpack_table_init(h3zero_qpack_table_t* table, uint64_t max_capacity)
+{
+    int ret = 0;
+
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+    table->max_capacity = max_capacity;
+    table->max_entries = (size_t)(max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD);
+    if (table->max_entries > 0) {
+        table->entries = (h3zero_qpack_entry_t*)malloc(table->max_entries * sizeof(h3zero_qpack_entry_t));
+        if (table->entries == NULL) {
+            table->max_capacity = 0;
+            table->max_entries = 0;
+            ret = -1;
+        }
+        else {
+            memset(table->entries, 0, table->max_entries * sizeof(h3zero_qpack_entry_t));
+        }
+    }
+
+    return ret;
+}
+
+static void h3zero_qpack_table_evict_oldest(h3zero_qpack_table_t* table)
+{
+    h3zero_qpack_entry_t* entry = &table->entries[(table->insert_count - table->nb_entries) % table->max_entries];
+
+    table->size -= entry->name_length + entry->value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+    free(entry->name);
+    memset(entry, 0, sizeof(h3zero_qpack_entry_t));
+    table->nb_entries--;
+}
+
+static void h3zero_qpack_table_release(h3zero_qpack_table_t* table)
+{
+    while (table->nb_entries > 0) {
+        h3zero_qpack_table_evict_oldest(table);
+    }
+    if (table->entries != NULL) {
+        free(table->entries);
+    }
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+}
+
+h3zero_qpack_entry_t* h3zero_qpack_table_get(h3zero_qpack_table_t* table, uint64_t absolute_index)
+{
+    h3zero_qpack_entry_t* entry = NULL;
+
+    if (absolute_index < table->insert_count && absolute_index + table->nb_entries >= table->insert_count) {
+        entry = &table->entries[absolute_index % table->max_entries];
+    }
+
+    return entry;
+}
+
+static int h3zero_qpack_table_set_capacity(h3zero_qpack_table_t* table, uint64_t capacity)
+{
+    int ret = 0;
+
+    if (capacity > table->max_capacity) {
+        ret = -1;
+    }
+    else {
+        while (table->size > capacity) {
+            h3zero_qpack_table_evict_oldest(table);
+        }
+        table->capacity = capacity;
+    }
+
+    return ret;
+}
+
+/* Insert an entry in a dynamic table, evicting the oldest entries if needed.
+ * Only the entries with an absolute index lower than evict_limit can be evicted.
+ * The name and value are copied before any eviction, because they may point
+ * to an existing entry, e.g., when duplicating it.
+ */
+static int h3zero_qpack_table_insert(h3zero_qpack_table_t* table, http_header_enum_t header,
+    uint8_t const* name, size_t name_length, uint8_t const* value, size_t value_length, uint64_t evict_limit)
+{
+    int ret = 0;
+    uint64_t entry_size = name_length + value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+    uint64_t available = table->capacity - table->size;
+    uint64_t nb_evicted = 0;
+    uint8_t* stored = NULL;
+
+    while (available < entry_size && nb_evicted < table->nb_entries) {
+        uint64_t absolute_index = table->insert_count - table->nb_entries + nb_evicted;
+        h3zero_qpack_entry_t* entry = &table->entries[absolute_index % table->max_entries];
+
+        if (absolute_index >= evict_limit) {
+            break;
+        }
+        available += entry->name_length + entry->value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+        nb_evicted++;
+    }
+
+    if (available < entry_size || (stored = (uint8_t*)malloc(name_length + value_length + 1)) == NULL) {
+        ret = -1;
+    }
+    else {
+        h3zero_qpack_entry_t* entry;
+
+        memcpy(stored, name, name_length);
+        memcpy(stored + name_length, value, value_length);
+        while (nb_evicted > 0) {
+            h3zero_qpack_table_evict_oldest(table);
+            nb_evicted--;
+        }
+        entry = &table->entries[table->insert_count % table->max_entries];
+        entry->header = header;
+        entry->name = stored;
+        entry->name_length = name_length;
+        entry->value = stored + name_length;
+        entry->value_length = value_length;
+        table->size += entry_size;
+        table->insert_count++;
+        table->nb_entries++;
+    }
+
+    return ret;
+}
+
+int h3zero_qpack_init(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity)
+{
+    memset(qpack, 0, sizeof(h3zero_qpack_ctx_t));
+
+    return h3zero_qpack_table_init(&qpack->decoder_table, max_capacity);
+}
+
+void h3zero_qpack_release(h3zero_qpack_ctx_t* qpack)
+{
+    h3zero_qpack_table_release(&qpack->encoder_table);
+    h3zero_qpack_table_release(&qpack->decoder_table);
+    if (qpack->sections != NULL) {
+        free(qpack->sections);
+        qpack->sections = NULL;
+    }
+    qpack->nb_sections = 0;
+    qpack->sections_max = 0;
+    h3zero_qpack_buffer_release(&qpack->encoder_out);
+    h3zero_qpack_buffer_release(&qpack->decoder_in);
+    h3zero_qpack_buffer_release(&qpack->decoder_out);
+    h3zero_qpack_buffer_release(&qpack->encoder_in);
+}
+
 /* 
- * Minimal QPACK parsing.
+ * QPACK parsing.
  *
  * This is used for header frames, which start with:
  *
@@ -290,9 +528,12 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * |      Compressed Headers     ...
  * +-------------------------------+
  *
- * Since H3zero only support static entries, we expect the required
- * Insert count to be zero, and we always ignore the Base delta.
- * The Base is encoded as sign-and-modulus integer (on 1 byte?)
+ * If the required insert count is zero, the section only references the
+ * static table and the Base delta is ignored. Otherwise, the required insert
+ * count is decoded as specified in RFC 9204, and the Base is computed from
+ * the sign bit S and the delta. Since h3zero does not accept blocked streams,
+ * the required insert count shall not exceed the number of entries already
+ * received on the encoder stream.
  *
  * We expect the following types of compressed content:
  *
@@ -301,8 +542,17 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * | 1 | S |      Index (6+)       |
  * +---+---+-----------------------+
  *
- * Index reference with static bit S set to 1, and the index describing an entry
- * in the static table.
+ * Index reference. If the static bit S is set to 1, the index describes an entry
+ * in the static table. If it is set to 0, the index is relative to the Base, and
+ * describes the dynamic entry of absolute index (Base - 1 - Index).
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 0 | 1 |  Index (4+)   |
+ * +---+---+---+---+---------------+
+ *
+ * Index reference with post-base index, describing the dynamic entry of
+ * absolute index (Base + Index).
  *
  *   0   1   2   3   4   5   6   7
  * +---+---+---+---+---+---+---+---+
@@ -313,8 +563,21 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * |  Value String (Length bytes)  |
  * +-------------------------------+
  *
- * Literal header field with name reference, expecting S bit to 1. Set N bits
- * to 0, ignore on read. 
+ * Literal header field with name reference. If the S bit is set to 1, the
+ * index describes an entry in the static table; if it is 0, the index is
+ * relative to the Base, as for index references. Set N bits to 0, ignore on read.
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 0 | 0 | N |NameIdx(3+)|
+ * +---+---+---+---+---+-----------+
+ * | H |     Value Length (7+)     |
+ * +---+---------------------------+
+ * |  Value String (Length bytes)  |
+ * +-------------------------------+
+ *
+ * Literal header field with post-base name reference.
+ *
  *   0   1   2   3   4   5   6   7
  * +---+---+---+---+---+---+---+---+
  * | 0 | 0 | 1 | N | H |NameLen(3+)|
@@ -327,8 +590,8 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * +-------------------------------+
  *
  * Literal Header Field Without Name Reference. The N bit is set to zero on write,
- * ignored on read. The H bit is always zero, since we do not implement Huffman
- * encoding.
+ * ignored on read. The H bit is set on write if the Huffman encoding of the
+ * string is shorter than the string itself.
  */
 
 h3zero_method_enum h3zero_get_method_by_name(uint8_t * name, size_t name_length) {
@@ -381,17 +644,19 @@ int h3zero_parse_status(uint8_t * content, size_t content_length)
     return val;
 }
 
-uint8_t* h3zero_parse_qpack_header_value_string(uint8_t * bytes, uint8_t* decoded,
+static int h3zero_parse_qpack_header_value_string(uint8_t* decoded,
     size_t decoded_length, const uint8_t ** field, size_t * length)
 {
+    int ret = 0;
+
     if (*field != NULL) {
         /* Duplicate field! */
-        bytes = NULL;
+        ret = -1;
     }
     else {
         *field = malloc(decoded_length + 1);
         if (*field == NULL) {
-            bytes = 0;
+            ret = -1;
             *length = 0;
         }
         else {
@@ -400,7 +665,64 @@ uint8_t* h3zero_parse_qpack_header_value_string(uint8_t * bytes, uint8_t* decode
             *length = (size_t)decoded_length;
         }
     }
-    return bytes;
+    return ret;
+}
+
+/* Document the header parts from the decoded value of a header field.
+ * This is used both for literal values, and for values found in the
+ * dynamic table.
+ */
+static int h3zero_parse_qpack_header_set_value(http_header_enum_t header,
+    uint8_t* decoded, size_t decoded_length, h3zero_header_parts_t* parts)
+{
+    int ret = 0;
+
+    switch (header) {
+    case http_pseudo_header_method:
+        if (parts->method != h3zero_method_none) {
+            /* Duplicate method! */
+            ret = -1;
+        }
+        else {
+            parts->method = h3zero_get_method_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_header_content_type:
+        if (parts->content_type != h3zero_content_type_none) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_status:
+        if (parts->status != 0) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            /* TODO: decimal to binary */
+            parts->status = h3zero_parse_status(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_path:
+        ret = h3zero_parse_qpack_header_value_string(decoded, decoded_length,
+            &parts->path, &parts->path_length);
+        break;
+    case http_header_range:
+        ret = h3zero_parse_qpack_header_value_string(decoded, decoded_length,
+            &parts->range, &parts->range_length);
+        break;
+    case http_pseudo_header_protocol:
+        ret = h3zero_parse_qpack_header_value_string(decoded, decoded_length,
+            &parts->protocol, &parts->protocol_length);
+        break;
+    default:
+        break;
+    }
+
+    return ret;
 }
 
 uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
@@ -409,8 +731,9 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
     uint64_t v_length = 0;
     int is_huffman = 0;
     uint8_t * decoded = NULL;
-    size_t decoded_length;
+    size_t decoded_length = 0;
     uint8_t deHuff[256];
+    uint8_t* deHuff_alloc = NULL;
 
     if (bytes >= bytes_max || bytes == NULL) {
         bytes = NULL;
@@ -423,77 +746,27 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
         if (bytes + v_length > bytes_max) {
             bytes = NULL;
         } else {
-            if (is_huffman && hzero_qpack_huffman_decode(
-                bytes, bytes + v_length, deHuff, sizeof(deHuff), &decoded_length) == 0)
-            {
+            if (is_huffman) {
+                /* The shortest Huffman code is 5 bits, which bounds the decoded length */
+                size_t max_decoded = (size_t)((v_length * 8) / 5);
+
                 decoded = deHuff;
+                if (max_decoded > sizeof(deHuff)) {
+                    decoded = deHuff_alloc = (uint8_t*)malloc(max_decoded);
+                }
+                if (decoded == NULL ||
+                    hzero_qpack_huffman_decode(bytes, bytes + v_length, decoded, max_decoded, &decoded_length) != 0) {
+                    bytes = NULL;
+                }
             }
             else {
                 decoded = bytes;
                 decoded_length = (size_t) v_length;
             }
 
-            switch (header) {
-            case http_pseudo_header_method:
-                if (parts->method != h3zero_method_none) {
-                    /* Duplicate method! */
-                    bytes = 0;
-                }
-                else {
-                    parts->method = h3zero_get_method_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_header_content_type:
-                if (parts->content_type != h3zero_content_type_none) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_status:
-                if (parts->status != 0) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    /* TODO: decimal to binary */
-                    parts->status = h3zero_parse_status(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_path:
-                if (parts->path != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->path, &parts->path_length);
-                }
-                break;
-            case http_header_range:
-                if (parts->range != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->range, &parts->range_length);
-                }
-                break;
-            case http_pseudo_header_protocol:
-                if (parts->protocol != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->protocol, &parts->protocol_length);
-                }
-                break;
-            default:
-                break;
+            if (bytes != NULL &&
+                h3zero_parse_qpack_header_set_value(header, decoded, decoded_length, parts) != 0) {
+                bytes = NULL;
             }
 
             if (bytes != NULL) {
@@ -502,6 +775,10 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
         }
     }
 
+    if (deHuff_alloc != NULL) {
+        free(deHuff_alloc);
+    }
+
     return bytes;
 }
 
@@ -537,23 +814,88 @@ int h3zero_get_interesting_header_type(uint8_t * name, size_t name_length, int i
     return val;
 }
 
+/* Decode the required insert count, as specified in section 4.5.1.1 of RFC 9204.
+ * Returns 0 if the encoded value is invalid.
+ */
+static uint64_t h3zero_qpack_decode_insert_count(h3zero_qpack_table_t* table, uint64_t encoded_insert_count)
+{
+    uint64_t max_entries = table->max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD;
+    uint64_t full_range = 2 * max_entries;
+    uint64_t required_insert_count = 0;
+
+    if (encoded_insert_count <= full_range) {
+        uint64_t max_value = table->insert_count + max_entries;
+        uint64_t max_wrapped = (max_value / full_range) * full_range;
+
+        required_insert_count = max_wrapped + encoded_insert_count - 1;
+        if (required_insert_count > max_value) {
+            if (required_insert_count <= full_range) {
+                required_insert_count = 0;
+            }
+            else {
+                required_insert_count -= full_range;
+            }
+        }
+    }
+
+    return required_insert_count;
+}
+
+static h3zero_qpack_entry_t* h3zero_qpack_get_referenced_entry(h3zero_qpack_ctx_t* qpack,
+    uint64_t required_insert_count, uint64_t absolute_index)
+{
+    h3zero_qpack_entry_t* entry = NULL;
+
+    if (qpack != NULL && absolute_index < required_insert_count) {
+        entry = h3zero_qpack_table_get(&qpack->decoder_table, absolute_index);
+    }
+
+    return entry;
+}
+
 uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max, 
     h3zero_header_parts_t * parts)
 {
+    return h3zero_parse_qpack_header_frame_ex(bytes, bytes_max, NULL, 0, parts);
+}
+
+uint8_t* h3zero_parse_qpack_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_qpack_ctx_t* qpack, uint64_t stream_id, h3zero_header_parts_t* parts)
+{
+    uint64_t required_insert_count = 0;
+    uint64_t base = 0;
+
     memset(parts, 0, sizeof(h3zero_header_parts_t));
 
     if (bytes == NULL || bytes >= bytes_max) {
         return NULL;
     }
 
-    /* parse base, expect 0 insert */
-    if (bytes[0] != 0) {
-        /* unexpected value */
-        bytes = NULL;
+    /* parse the required insert count, then the base */
+    bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0xFF, &required_insert_count);
+    if (bytes != NULL && required_insert_count != 0) {
+        if (qpack == NULL ||
+            (required_insert_count = h3zero_qpack_decode_insert_count(&qpack->decoder_table, required_insert_count)) == 0 ||
+            required_insert_count > qpack->decoder_table.insert_count) {
+            /* unexpected value, or stream would be blocked */
+            bytes = NULL;
+        }
     }
-    else {
+    if (bytes != NULL) {
+        int is_negative = (bytes < bytes_max && (bytes[0] & 0x80) != 0);
         uint64_t delta_base;
-        bytes = h3zero_qpack_int_decode(bytes + 1, bytes_max, 0x7F, &delta_base);
+        bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x7F, &delta_base);
+        if (bytes != NULL && required_insert_count > 0) {
+            if (!is_negative) {
+                base = required_insert_count + delta_base;
+            }
+            else if (delta_base < required_insert_count) {
+                base = required_insert_count - delta_base - 1;
+            }
+            else {
+                bytes = NULL;
+            }
+        }
     }
 
     while (bytes != NULL && bytes < bytes_max) {
@@ -563,7 +905,7 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
 
             bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x3F, &s_index);
 
-            if (s_index > h3zero_qpack_nb_static) {
+            if (bytes == NULL || s_index >= h3zero_qpack_nb_static) {
                 /* Index out of range */
                 bytes = NULL;
             }
@@ -624,13 +966,33 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
                 }
             }
         }
+        else if ((bytes[0] & 0xC0) == 0x80 || (bytes[0] & 0xF0) == 0x10) {
+            /* Index reference to the dynamic table, relative or post-base */
+            int is_post_base = (bytes[0] & 0x80) == 0;
+            uint64_t d_index;
+            h3zero_qpack_entry_t* entry = NULL;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, (is_post_base) ? 0x0F : 0x3F, &d_index);
+            if (bytes != NULL) {
+                if (is_post_base) {
+                    entry = h3zero_qpack_get_referenced_entry(qpack, required_insert_count, base + d_index);
+                }
+                else if (d_index < base) {
+                    entry = h3zero_qpack_get_referenced_entry(qpack, required_insert_count, base - 1 - d_index);
+                }
+                if (entry == NULL ||
+                    h3zero_parse_qpack_header_set_value(entry->header, entry->value, entry->value_length, parts) != 0) {
+                    bytes = NULL;
+                }
+            }
+        }
         else if ((bytes[0] & 0xD0) == 0x50) {
             /* Literal header field with name reference, static encoding */
             uint64_t s_index;
 
             bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &s_index);
             if (bytes != NULL) {
-                if (s_index > h3zero_qpack_nb_static) {
+                if (s_index >= h3zero_qpack_nb_static) {
                     /* Index out of range */
                     bytes = NULL;
                 } else {
@@ -639,6 +1001,28 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
                 }
             }
         }
+        else if ((bytes[0] & 0xD0) == 0x40 || (bytes[0] & 0xF0) == 0x00) {
+            /* Literal header field with name reference to the dynamic table, relative or post-base */
+            int is_post_base = (bytes[0] & 0x40) == 0;
+            uint64_t d_index;
+            h3zero_qpack_entry_t* entry = NULL;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, (is_post_base) ? 0x07 : 0x0F, &d_index);
+            if (bytes != NULL) {
+                if (is_post_base) {
+                    entry = h3zero_qpack_get_referenced_entry(qpack, required_insert_count, base + d_index);
+                }
+                else if (d_index < base) {
+                    entry = h3zero_qpack_get_referenced_entry(qpack, required_insert_count, base - 1 - d_index);
+                }
+                if (entry == NULL) {
+                    bytes = NULL;
+                }
+                else {
+                    bytes = h3zero_parse_qpack_header_value(bytes, bytes_max, entry->header, parts);
+                }
+            }
+        }
         else if ((bytes[0] & 0xE0) == 0x20) {
             /* Literal Header Field Without Name Reference */
             uint64_t n_length;
@@ -663,6 +1047,27 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
         }
     }
 
+    if (bytes != NULL && required_insert_count > 0) {
+        /* Acknowledge the section on the decoder stream */
+        uint8_t* ack = h3zero_qpack_buffer_reserve(&qpack->decoder_out, 16);
+
+        if (ack == NULL) {
+            bytes = NULL;
+        }
+        else {
+            *ack = 0x80;
+            if ((ack = h3zero_qpack_int_encode(ack, qpack->decoder_out.bytes + qpack->decoder_out.size, 0x7F, stream_id)) == NULL) {
+                bytes = NULL;
+            }
+            else {
+                qpack->decoder_out.length = ack - qpack->decoder_out.bytes;
+                if (required_insert_count > qpack->decoder_acked_count) {
+                    qpack->decoder_acked_count = required_insert_count;
+                }
+            }
+        }
+    }
+
     return bytes;
 }
 
@@ -701,99 +1106,662 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
  * 405, with header "allow GET"
  */
 
-static uint8_t * h3zero_qpack_code_encode(uint8_t * bytes, uint8_t * bytes_max,
-    uint8_t prefix, uint8_t mask, uint64_t code) 
+static uint8_t * h3zero_qpack_code_encode(uint8_t * bytes, uint8_t * bytes_max,
+    uint8_t prefix, uint8_t mask, uint64_t code) 
+{
+    if (bytes != NULL) {
+        if (bytes + 1 > bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            *bytes = prefix;
+            bytes = h3zero_qpack_int_encode(bytes, bytes_max, mask, code);
+        }
+    }
+
+    return bytes;
+}
+
+/* Encode a string literal, preceded by its length:
+ * +---+---+---+---+---+---+---+---+
+ * |  prefix   | H |  Length (N+)  |
+ * +---+---+---+---+---+---+---+---+
+ * |  String (Length bytes)        |
+ * +-------------------------------+
+ * The Huffman encoding is used if it is shorter than the string itself.
+ */
+static uint8_t* h3zero_qpack_string_encode(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t prefix, uint8_t huffman_bit, uint8_t mask, uint8_t const* val, size_t val_length)
+{
+    if (bytes != NULL) {
+        size_t huffman_length = h3zero_qpack_huffman_encoded_length(val, val_length);
+
+        if (huffman_length < val_length) {
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix | huffman_bit, mask, huffman_length);
+            if (bytes != NULL) {
+                bytes = h3zero_qpack_huffman_encode(bytes, bytes_max, val, val_length);
+            }
+        }
+        else {
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix, mask, val_length);
+            if (bytes != NULL && val_length > 0) {
+                if (bytes + val_length > bytes_max) {
+                    bytes = NULL;
+                }
+                else {
+                    memcpy(bytes, val, val_length);
+                    bytes += val_length;
+                }
+            }
+        }
+    }
+
+    return bytes;
+}
+
+static uint8_t * h3zero_qpack_literal_plus_ref_encode(uint8_t * bytes, uint8_t * bytes_max,
+    uint64_t code, uint8_t const * val, size_t val_length)
+{
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, code);
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x80, 0x7F, val, val_length);
+
+    return bytes;
+}
+
+/* Example of literal plus literal: 
+0x20 | QPACK_TEST_HEADER_PATH_LEN, QPACK_TEST_HEADER_PATH,
+QPACK_TEST_HEADER_INDEX_HTML_LEN, QPACK_TEST_HEADER_INDEX_HTML
+This supposes that the literal is less than 127 bytes.
+
+*   0   1   2   3   4   5   6   7
+* +---+---+---+---+---+---+---+---+
+* | 0 | 0 | 1 | N | H |NameLen(3+)|
+* +---+---+---+---+---+-----------+
+* |  Name String (Length bytes)   |
+* +---+---------------------------+
+* | H |     Value Length (7+)     |
+* +---+---------------------------+
+* |  Value String (Length bytes)  |
+* +-------------------------------+
+*/
+
+static uint8_t * h3zero_qpack_literal_plus_name_encode(uint8_t * bytes, uint8_t * bytes_max,
+    uint8_t const * name, size_t name_length, uint8_t const * val, size_t val_length)
+{
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x20, 0x08, 0x07, name, name_length);
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x80, 0x7F, val, val_length);
+
+    return bytes;
+}
+
+/*
+ * Use of the dynamic table by the encoder.
+ *
+ * When the peer's settings allow a dynamic table, header values that are
+ * expected to repeat on every request or response (authority, user agent,
+ * server) are inserted in the encoder table. The insertion instructions are
+ * queued in the encoder_out buffer, to be sent on the encoder stream.
+ *
+ * A section can reference an entry if the peer has acknowledged it, or if
+ * the section is allowed to block: either the stream is already blocked, or
+ * the number of blocked streams is lower than the limit set by the peer.
+ * Otherwise the value is sent as a literal, and the entry will be used by
+ * later sections once acknowledged.
+ *
+ * Sections that reference dynamic entries are remembered until the peer
+ * acknowledges them. Entries that they reference cannot be evicted.
+ */
+
+static void h3zero_qpack_section_start(h3zero_qpack_ctx_t* qpack, uint64_t stream_id, h3zero_qpack_section_t* section)
+{
+    memset(section, 0, sizeof(h3zero_qpack_section_t));
+    section->stream_id = stream_id;
+    section->min_reference = UINT64_MAX;
+
+    if (qpack != NULL && qpack->encoder_table.capacity > 0 && qpack->nb_sections < H3ZERO_QPACK_MAX_SECTIONS) {
+        uint64_t nb_blocked = 0;
+        int is_blocking = 0;
+
+        section->base = qpack->encoder_table.insert_count;
+        section->use_dynamic = 1;
+
+        for (size_t i = 0; i < qpack->nb_sections; i++) {
+            if (qpack->sections[i].required_insert_count > qpack->known_received_count) {
+                if (qpack->sections[i].stream_id == stream_id) {
+                    is_blocking = 1;
+                }
+                else {
+                    int is_counted = 0;
+                    for (size_t j = 0; j < i; j++) {
+                        if (qpack->sections[j].stream_id == qpack->sections[i].stream_id &&
+                            qpack->sections[j].required_insert_count > qpack->known_received_count) {
+                            is_counted = 1;
+                            break;
+                        }
+                    }
+                    if (!is_counted) {
+                        nb_blocked++;
+                    }
+                }
+            }
+        }
+        section->can_block = is_blocking || nb_blocked < qpack->peer_blocked_streams;
+    }
+}
+
+/* Entries can only be evicted if the decoder acknowledged them, and if no
+ * outstanding section references them (RFC 9204, section 2.1.1) */
+static uint64_t h3zero_qpack_evict_limit(h3zero_qpack_ctx_t* qpack, h3zero_qpack_section_t* section)
+{
+    uint64_t evict_limit = qpack->known_received_count;
+
+    if (section->min_reference < evict_limit) {
+        evict_limit = section->min_reference;
+    }
+
+    for (size_t i = 0; i < qpack->nb_sections; i++) {
+        if (qpack->sections[i].min_reference < evict_limit) {
+            evict_limit = qpack->sections[i].min_reference;
+        }
+    }
+
+    return evict_limit;
+}
+
+static uint64_t h3zero_qpack_find_entry(h3zero_qpack_table_t* table, http_header_enum_t header,
+    uint8_t const* val, size_t val_length)
+{
+    for (uint64_t i = table->insert_count; i > table->insert_count - table->nb_entries; i--) {
+        h3zero_qpack_entry_t* entry = &table->entries[(i - 1) % table->max_entries];
+        if (entry->header == header && entry->value_length == val_length &&
+            memcmp(entry->value, val, val_length) == 0) {
+            return i - 1;
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+/* Insert With Name Reference, using a static name:
+ * +---+---+---+---+---+---+---+---+
+ * | 1 | T |    Name Index (6+)    |
+ * +---+---+-----------------------+
+ * | H |     Value Length (7+)     |
+ * +---+---------------------------+
+ * |  Value String (Length bytes)  |
+ * +-------------------------------+
+ */
+static int h3zero_qpack_insert_static_ref(h3zero_qpack_ctx_t* qpack, uint64_t code,
+    uint8_t const* val, size_t val_length, uint64_t evict_limit)
+{
+    int ret = 0;
+    http_header_enum_t header = qpack_static[code].header;
+    char const* name = h3zero_get_header_name(header);
+    uint8_t* bytes = h3zero_qpack_buffer_reserve(&qpack->encoder_out, val_length + 32);
+
+    if (bytes == NULL || h3zero_qpack_table_insert(&qpack->encoder_table, header,
+        (uint8_t const*)name, strlen(name), val, val_length, evict_limit) != 0) {
+        ret = -1;
+    }
+    else {
+        uint8_t* bytes_max = qpack->encoder_out.bytes + qpack->encoder_out.size;
+
+        bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, code);
+        bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x80, 0x7F, val, val_length);
+        if (bytes == NULL) {
+            /* Cannot happen, since enough space was reserved */
+            ret = -1;
+        }
+        else {
+            qpack->encoder_out.length = bytes - qpack->encoder_out.bytes;
+        }
+    }
+
+    return ret;
+}
+
+/* Encode a header field that is expected to repeat, using the dynamic table if possible,
+ * or a literal with static name reference otherwise. */
+static uint8_t* h3zero_qpack_field_encode(uint8_t* bytes, uint8_t* bytes_max, h3zero_qpack_ctx_t* qpack,
+    h3zero_qpack_section_t* section, uint64_t code, uint8_t const* val, size_t val_length)
 {
-    if (bytes != NULL) {
-        if (bytes + 1 > bytes_max) {
-            bytes = NULL;
+    uint64_t d_index = UINT64_MAX;
+
+    if (bytes != NULL && qpack != NULL && section->use_dynamic) {
+        d_index = h3zero_qpack_find_entry(&qpack->encoder_table, qpack_static[code].header, val, val_length);
+        if (d_index == UINT64_MAX &&
+            h3zero_qpack_insert_static_ref(qpack, code, val, val_length, h3zero_qpack_evict_limit(qpack, section)) == 0) {
+            d_index = qpack->encoder_table.insert_count - 1;
+        }
+        if (d_index != UINT64_MAX && d_index >= qpack->known_received_count && !section->can_block) {
+            d_index = UINT64_MAX;
+        }
+    }
+
+    if (d_index == UINT64_MAX) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, code, val, val_length);
+    }
+    else {
+        if (d_index < section->base) {
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x80, 0x3F, section->base - 1 - d_index);
         }
         else {
-            *bytes = prefix;
-            bytes = h3zero_qpack_int_encode(bytes, bytes_max, mask, code);
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x10, 0x0F, d_index - section->base);
+        }
+        if (d_index + 1 > section->required_insert_count) {
+            section->required_insert_count = d_index + 1;
+        }
+        if (d_index < section->min_reference) {
+            section->min_reference = d_index;
         }
     }
 
     return bytes;
 }
 
-static uint8_t * h3zero_qpack_literal_plus_ref_encode(uint8_t * bytes, uint8_t * bytes_max,
-    uint64_t code, uint8_t const * val, size_t val_length)
+/* Write the section prefix once all fields are encoded. The section starts
+ * with two placeholder bytes, which are sufficient if no dynamic entry is
+ * referenced. Otherwise, the prefix is encoded and the fields are moved if
+ * the prefix is longer than two bytes.
+ */
+static uint8_t* h3zero_qpack_section_finish(uint8_t* section_start, uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_qpack_ctx_t* qpack, h3zero_qpack_section_t* section)
 {
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, code);
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F, val_length);
-    if (bytes != NULL && val_length > 0) {
-        if (bytes + val_length > bytes_max) {
+    if (bytes != NULL && qpack != NULL && section->required_insert_count > 0) {
+        uint8_t prefix[32];
+        uint8_t* prefix_end;
+        uint64_t max_entries = qpack->peer_max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD;
+        size_t fields_length = bytes - (section_start + 2);
+
+        prefix[0] = 0;
+        prefix_end = h3zero_qpack_int_encode(prefix, prefix + sizeof(prefix), 0xFF,
+            (section->required_insert_count % (2 * max_entries)) + 1);
+        if (prefix_end != NULL) {
+            if (section->base >= section->required_insert_count) {
+                *prefix_end = 0;
+                prefix_end = h3zero_qpack_int_encode(prefix_end, prefix + sizeof(prefix), 0x7F,
+                    section->base - section->required_insert_count);
+            }
+            else {
+                *prefix_end = 0x80;
+                prefix_end = h3zero_qpack_int_encode(prefix_end, prefix + sizeof(prefix), 0x7F,
+                    section->required_insert_count - section->base - 1);
+            }
+        }
+
+        if (prefix_end == NULL || section_start + (prefix_end - prefix) + fields_length > bytes_max) {
             bytes = NULL;
         }
         else {
-            memcpy(bytes, val, val_length);
-            bytes += val_length;
+            size_t prefix_length = prefix_end - prefix;
+
+            memmove(section_start + prefix_length, section_start + 2, fields_length);
+            memcpy(section_start, prefix, prefix_length);
+            bytes = section_start + prefix_length + fields_length;
+
+            /* Remember the section until it is acknowledged */
+            if (qpack->nb_sections >= qpack->sections_max) {
+                size_t new_max = (qpack->sections_max == 0) ? 16 : 2 * qpack->sections_max;
+                h3zero_qpack_section_t* new_sections = (h3zero_qpack_section_t*)realloc(qpack->sections,
+                    new_max * sizeof(h3zero_qpack_section_t));
+                if (new_sections == NULL) {
+                    bytes = NULL;
+                }
+                else {
+                    qpack->sections = new_sections;
+                    qpack->sections_max = new_max;
+                }
+            }
+            if (bytes != NULL) {
+                qpack->sections[qpack->nb_sections++] = *section;
+            }
         }
     }
 
     return bytes;
 }
 
-/* Example of literal plus literal: 
-0x20 | QPACK_TEST_HEADER_PATH_LEN, QPACK_TEST_HEADER_PATH,
-QPACK_TEST_HEADER_INDEX_HTML_LEN, QPACK_TEST_HEADER_INDEX_HTML
-This supposes that the literal is less than 127 bytes.
+int h3zero_qpack_set_peer_settings(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity, uint64_t blocked_streams)
+{
+    int ret = 0;
+    uint64_t capacity = (max_capacity < H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) ? max_capacity : H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY;
+
+    qpack->peer_max_capacity = max_capacity;
+    qpack->peer_blocked_streams = blocked_streams;
+
+    if (capacity > 0 && qpack->encoder_table.entries == NULL) {
+        /* Set Dynamic Table Capacity:
+         * +---+---+---+---+---+---+---+---+
+         * | 0 | 0 | 1 |   Capacity (5+)   |
+         * +---+---+---+-------------------+
+         */
+        uint8_t* bytes = h3zero_qpack_buffer_reserve(&qpack->encoder_out, 16);
+
+        if (bytes == NULL ||
+            h3zero_qpack_table_init(&qpack->encoder_table, capacity) != 0 ||
+            h3zero_qpack_table_set_capacity(&qpack->encoder_table, capacity) != 0) {
+            ret = -1;
+        }
+        else {
+            *bytes = 0x20;
+            bytes = h3zero_qpack_int_encode(bytes, qpack->encoder_out.bytes + qpack->encoder_out.size, 0x1F, capacity);
+            qpack->encoder_out.length = bytes - qpack->encoder_out.bytes;
+        }
+    }
 
-*   0   1   2   3   4   5   6   7
-* +---+---+---+---+---+---+---+---+
-* | 0 | 0 | 1 | N | H |NameLen(3+)|
-* +---+---+---+---+---+-----------+
-* |  Name String (Length bytes)   |
-* +---+---------------------------+
-* | H |     Value Length (7+)     |
-* +---+---------------------------+
-* |  Value String (Length bytes)  |
-* +-------------------------------+
-*/
+    return ret;
+}
+
+/* Parse an integer in an encoder or decoder stream instruction. A NULL
+ * return with is_error not set means that more bytes are needed.
+ */
+static uint8_t* h3zero_qpack_instruction_int(uint8_t* bytes, uint8_t* bytes_max, uint8_t mask,
+    uint64_t* val, int* is_error)
+{
+    uint8_t* next = h3zero_qpack_int_decode(bytes, bytes_max, mask, val);
+
+    if (next == NULL && bytes_max - bytes > 10) {
+        /* Not a valid 62 bit integer */
+        *is_error = 1;
+    }
+
+    return next;
+}
 
-static uint8_t * h3zero_qpack_name_encode(uint8_t * bytes, uint8_t * bytes_max,
-    uint8_t prefix, uint8_t mask, uint8_t const * name, size_t name_length) 
+/* Parse a string in an encoder stream instruction. On success, the decoded
+ * string is allocated and must be freed by the caller.
+ */
+static uint8_t* h3zero_qpack_instruction_string(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t huffman_bit, uint8_t mask, uint64_t max_length, uint8_t** decoded, size_t* decoded_length, int* is_error)
 {
+    uint64_t length = 0;
+    int is_huffman = 0;
+
+    *decoded = NULL;
+    *decoded_length = 0;
+
+    if (bytes == NULL || bytes >= bytes_max) {
+        return NULL;
+    }
+
+    is_huffman = (bytes[0] & huffman_bit) != 0;
+    bytes = h3zero_qpack_instruction_int(bytes, bytes_max, mask, &length, is_error);
     if (bytes != NULL) {
-        if (bytes + 1 > bytes_max) {
+        if (length > max_length) {
+            *is_error = 1;
+            bytes = NULL;
+        }
+        else if (bytes + length > bytes_max) {
+            /* Wait for more bytes */
             bytes = NULL;
         }
         else {
-            *bytes = prefix;
-            bytes = h3zero_qpack_int_encode(bytes, bytes_max, mask, name_length);
-            if (bytes != NULL && name_length > 0) {
-                if (bytes + name_length > bytes_max) {
+            size_t max_decoded = (size_t)((is_huffman) ? (length * 8) / 5 : length);
+
+            if ((*decoded = (uint8_t*)malloc(max_decoded + 1)) == NULL) {
+                *is_error = 1;
+                bytes = NULL;
+            }
+            else if (is_huffman) {
+                if (hzero_qpack_huffman_decode(bytes, bytes + length, *decoded, max_decoded, decoded_length) != 0) {
+                    free(*decoded);
+                    *decoded = NULL;
+                    *is_error = 1;
                     bytes = NULL;
                 }
+            }
+            else {
+                memcpy(*decoded, bytes, (size_t)length);
+                *decoded_length = (size_t)length;
+            }
+            if (bytes != NULL) {
+                bytes += length;
+            }
+        }
+    }
+
+    return bytes;
+}
+
+/* Process the instructions received on the peer's encoder stream, and update
+ * the decoder table. Incomplete instructions are kept until the next call.
+ * After the instructions are processed, an Insert Count Increment is queued
+ * in decoder_out, so the peer can start referencing the new entries.
+ */
+int h3zero_qpack_receive_encoder_stream(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length)
+{
+    int ret = 0;
+    h3zero_qpack_table_t* table = &qpack->decoder_table;
+
+    if (h3zero_qpack_buffer_append(&qpack->encoder_in, bytes, length) != 0) {
+        ret = H3ZERO_INTERNAL_ERROR;
+    }
+    else {
+        uint8_t* p = qpack->encoder_in.bytes;
+        uint8_t* p_max = p + qpack->encoder_in.length;
+
+        while (ret == 0 && p < p_max) {
+            uint8_t* next = NULL;
+            uint8_t* name = NULL;
+            uint8_t* value = NULL;
+            size_t name_length = 0;
+            size_t value_length = 0;
+            uint64_t val = 0;
+            int is_error = 0;
+
+            if ((p[0] & 0x80) != 0) {
+                /* Insert with name reference */
+                int is_static = (p[0] & 0x40) != 0;
+                http_header_enum_t header = http_header_unknown;
+                uint8_t const* ref_name = NULL;
+                size_t ref_name_length = 0;
+
+                next = h3zero_qpack_instruction_int(p, p_max, 0x3F, &val, &is_error);
+                if (next != NULL) {
+                    if (is_static) {
+                        if (val >= h3zero_qpack_nb_static) {
+                            is_error = 1;
+                        }
+                        else {
+                            header = qpack_static[val].header;
+                            ref_name = (uint8_t const*)h3zero_get_header_name(header);
+                            ref_name_length = strlen((char const*)ref_name);
+                        }
+                    }
+                    else {
+                        h3zero_qpack_entry_t* entry = (val < table->insert_count) ?
+                            h3zero_qpack_table_get(table, table->insert_count - 1 - val) : NULL;
+                        if (entry == NULL) {
+                            is_error = 1;
+                        }
+                        else {
+                            header = entry->header;
+                            ref_name = entry->name;
+                            ref_name_length = entry->name_length;
+                        }
+                    }
+                }
+                if (next != NULL && !is_error) {
+                    next = h3zero_qpack_instruction_string(next, p_max, 0x80, 0x7F, table->capacity,
+                        &value, &value_length, &is_error);
+                    if (next != NULL && h3zero_qpack_table_insert(table, header, ref_name, ref_name_length,
+                        value, value_length, UINT64_MAX) != 0) {
+                        is_error = 1;
+                    }
+                }
+            }
+            else if ((p[0] & 0x40) != 0) {
+                /* Insert with literal name */
+                next = h3zero_qpack_instruction_string(p, p_max, 0x20, 0x1F, table->capacity,
+                    &name, &name_length, &is_error);
+                if (next != NULL) {
+                    next = h3zero_qpack_instruction_string(next, p_max, 0x80, 0x7F, table->capacity,
+                        &value, &value_length, &is_error);
+                    if (next != NULL && h3zero_qpack_table_insert(table,
+                        h3zero_get_interesting_header_type(name, name_length, 0), name, name_length,
+                        value, value_length, UINT64_MAX) != 0) {
+                        is_error = 1;
+                    }
+                }
+            }
+            else if ((p[0] & 0x20) != 0) {
+                /* Set dynamic table capacity */
+                next = h3zero_qpack_instruction_int(p, p_max, 0x1F, &val, &is_error);
+                if (next != NULL && h3zero_qpack_table_set_capacity(table, val) != 0) {
+                    is_error = 1;
+                }
+            }
+            else {
+                /* Duplicate */
+                next = h3zero_qpack_instruction_int(p, p_max, 0x1F, &val, &is_error);
+                if (next != NULL) {
+                    h3zero_qpack_entry_t* entry = (val < table->insert_count) ?
+                        h3zero_qpack_table_get(table, table->insert_count - 1 - val) : NULL;
+                    if (entry == NULL || h3zero_qpack_table_insert(table, entry->header, entry->name, entry->name_length,
+                        entry->value, entry->value_length, UINT64_MAX) != 0) {
+                        is_error = 1;
+                    }
+                }
+            }
+
+            if (name != NULL) {
+                free(name);
+            }
+            if (value != NULL) {
+                free(value);
+            }
+
+            if (is_error) {
+                ret = H3ZERO_QPACK_ENCODER_STREAM_ERROR;
+            }
+            else if (next == NULL) {
+                /* Incomplete instruction */
+                break;
+            }
+            else {
+                p = next;
+            }
+        }
+
+        if (ret == 0) {
+            h3zero_qpack_buffer_consume(&qpack->encoder_in, p - qpack->encoder_in.bytes);
+            if (table->insert_count > qpack->decoder_acked_count) {
+                /* Insert Count Increment:
+                 * +---+---+---+---+---+---+---+---+
+                 * | 0 | 0 |     Increment (6+)    |
+                 * +---+---+-----------------------+
+                 */
+                uint8_t* o_bytes = h3zero_qpack_buffer_reserve(&qpack->decoder_out, 16);
+
+                if (o_bytes == NULL) {
+                    ret = H3ZERO_INTERNAL_ERROR;
+                }
                 else {
-                    memcpy(bytes, name, name_length);
-                    bytes += name_length;
+                    *o_bytes = 0;
+                    o_bytes = h3zero_qpack_int_encode(o_bytes, qpack->decoder_out.bytes + qpack->decoder_out.size, 0x3F,
+                        table->insert_count - qpack->decoder_acked_count);
+                    qpack->decoder_out.length = o_bytes - qpack->decoder_out.bytes;
+                    qpack->decoder_acked_count = table->insert_count;
                 }
             }
         }
     }
 
-    return bytes;
+    return ret;
 }
 
-static uint8_t * h3zero_qpack_literal_plus_name_encode(uint8_t * bytes, uint8_t * bytes_max,
-    uint8_t const * name, size_t name_length, uint8_t const * val, size_t val_length)
+/* Forget the header sections sent on a stream, either because the peer
+ * cancelled the stream or because the stream was reset locally. Sections that
+ * will never be acknowledged must not keep counting against H3ZERO_QPACK_MAX_SECTIONS.
+ */
+void h3zero_qpack_cancel_stream(h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
 {
+    size_t nb_kept = 0;
+    for (size_t i = 0; i < qpack->nb_sections; i++) {
+        if (qpack->sections[i].stream_id != stream_id) {
+            qpack->sections[nb_kept++] = qpack->sections[i];
+        }
+    }
+    qpack->nb_sections = nb_kept;
+}
 
-    bytes = h3zero_qpack_name_encode(bytes, bytes_max, 0x20, 0x07, name, name_length);
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F, val_length);
-    if (bytes != NULL && val_length > 0) {
-        if (bytes + val_length > bytes_max) {
-            bytes = NULL;
+/* Process the instructions received on the peer's decoder stream:
+ * section acknowledgements, stream cancellations and insert count increments.
+ */
+int h3zero_qpack_receive_decoder_stream(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length)
+{
+    int ret = 0;
+
+    if (h3zero_qpack_buffer_append(&qpack->decoder_in, bytes, length) != 0) {
+        ret = H3ZERO_INTERNAL_ERROR;
+    }
+    else {
+        uint8_t* p = qpack->decoder_in.bytes;
+        uint8_t* p_max = p + qpack->decoder_in.length;
+
+        while (ret == 0 && p < p_max) {
+            uint8_t* next;
+            uint64_t val = 0;
+            int is_error = 0;
+
+            if ((p[0] & 0x80) != 0) {
+                /* Section acknowledgement: the oldest section on this stream is acknowledged */
+                next = h3zero_qpack_instruction_int(p, p_max, 0x7F, &val, &is_error);
+                if (next != NULL) {
+                    size_t i = 0;
+                    while (i < qpack->nb_sections && qpack->sections[i].stream_id != val) {
+                        i++;
+                    }
+                    if (i >= qpack->nb_sections) {
+                        is_error = 1;
+                    }
+                    else {
+                        if (qpack->sections[i].required_insert_count > qpack->known_received_count) {
+                            qpack->known_received_count = qpack->sections[i].required_insert_count;
+                        }
+                        qpack->nb_sections--;
+                        memmove(&qpack->sections[i], &qpack->sections[i + 1], (qpack->nb_sections - i) * sizeof(h3zero_qpack_section_t));
+                    }
+                }
+            }
+            else if ((p[0] & 0x40) != 0) {
+                /* Stream cancellation: forget all sections on this stream */
+                next = h3zero_qpack_instruction_int(p, p_max, 0x3F, &val, &is_error);
+                if (next != NULL) {
+                    h3zero_qpack_cancel_stream(qpack, val);
+                }
+            }
+            else {
+                /* Insert count increment */
+                next = h3zero_qpack_instruction_int(p, p_max, 0x3F, &val, &is_error);
+                if (next != NULL) {
+                    if (val == 0 || val > qpack->encoder_table.insert_count - qpack->known_received_count) {
+                        is_error = 1;
+                    }
+                    else {
+                        qpack->known_received_count += val;
+                    }
+                }
+            }
+
+            if (is_error) {
+                ret = H3ZERO_QPACK_DECODER_STREAM_ERROR;
+            }
+            else if (next == NULL) {
+                /* Incomplete instruction */
+                break;
+            }
+            else {
+                p = next;
+            }
         }
-        else {
-            memcpy(bytes, val, val_length);
-            bytes += val_length;
+
+        if (ret == 0) {
+            h3zero_qpack_buffer_consume(&qpack->decoder_in, p - qpack->decoder_in.bytes);
         }
     }
 
-    return bytes;
+    return ret;
 }
 
 uint8_t * h3zero_encode_content_type(uint8_t * bytes, uint8_t * bytes_max, h3zero_content_type_enum content_type)
@@ -821,13 +1789,17 @@ uint8_t * h3zero_encode_content_type(uint8_t * bytes, uint8_t * bytes_max, h3zer
     return bytes;
 }
 
-uint8_t* h3zero_create_connect_header_frame(uint8_t* bytes, uint8_t* bytes_max,
+uint8_t* h3zero_create_connect_header_frame_qpack(uint8_t* bytes, uint8_t* bytes_max,
     char const * authority, uint8_t const* path, size_t path_length, char const* protocol,
-    char const * origin, char const* ua_string)
+    char const * origin, char const* ua_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
 {
+    uint8_t* section_start = bytes;
+    h3zero_qpack_section_t section;
+
     if (bytes == NULL || bytes + 2 > bytes_max) {
         return NULL;
     }
+    h3zero_qpack_section_start(qpack, stream_id, &section);
     /* Push 2 NULL bytes for request header: base, and delta */
     *bytes++ = 0;
     *bytes++ = 0;
@@ -841,9 +1813,9 @@ uint8_t* h3zero_create_connect_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     if (protocol != NULL) {
         bytes = h3zero_qpack_literal_plus_name_encode(bytes, bytes_max, (uint8_t*)":protocol", 9, (uint8_t*)protocol, strlen(protocol));
     }
-    /* Authority. Use literal plus reference format */
+    /* Authority. Use the dynamic table if possible */
     if (authority != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_AUTHORITY, (uint8_t const*)authority, strlen(authority));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_AUTHORITY, (uint8_t const*)authority, strlen(authority));
     }
     /* Origin. Use literal plus ref format */
     if (origin != NULL) {
@@ -851,18 +1823,33 @@ uint8_t* h3zero_create_connect_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     }
     /* User Agent */
     if (ua_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
     }
+    /* Section prefix, if dynamic entries are referenced */
+    bytes = h3zero_qpack_section_finish(section_start, bytes, bytes_max, qpack, &section);
+
     return bytes;
 }
 
-uint8_t * h3zero_create_post_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+uint8_t* h3zero_create_connect_header_frame(uint8_t* bytes, uint8_t* bytes_max,
+    char const * authority, uint8_t const* path, size_t path_length, char const* protocol,
+    char const * origin, char const* ua_string)
+{
+    return h3zero_create_connect_header_frame_qpack(bytes, bytes_max, authority, path, path_length,
+        protocol, origin, ua_string, NULL, 0);
+}
+
+uint8_t * h3zero_create_post_header_frame_qpack(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, uint8_t const * range, size_t range_length, char const* host,
-    h3zero_content_type_enum content_type, char const* ua_string)
+    h3zero_content_type_enum content_type, char const* ua_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
 {
+    uint8_t* section_start = bytes;
+    h3zero_qpack_section_t section;
+
     if (bytes == NULL || bytes + 2 > bytes_max) {
         return NULL;
     }
+    h3zero_qpack_section_start(qpack, stream_id, &section);
     /* Push 2 NULL bytes for request header: base, and delta */
     *bytes++ = 0;
     *bytes++ = 0;
@@ -872,9 +1859,9 @@ uint8_t * h3zero_create_post_header_frame_ex(uint8_t * bytes, uint8_t * bytes_ma
     bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_SCHEME_HTTPS);
     /* Path: doc_name. Use literal plus reference format */
     bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_CODE_PATH, path, path_length);
-    /* Authority: host. Use literal plus reference format */
+    /* Authority: host. Use the dynamic table if possible */
     if (host != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
     }
     /* Optional: range. Use literal plus reference format */
     if (range_length > 0) {
@@ -882,14 +1869,24 @@ uint8_t * h3zero_create_post_header_frame_ex(uint8_t * bytes, uint8_t * bytes_ma
     }
     /* User Agent */
     if (ua_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
     }
     /* Document type */
     bytes = h3zero_encode_content_type(bytes, bytes_max, content_type);
+    /* Section prefix, if dynamic entries are referenced */
+    bytes = h3zero_qpack_section_finish(section_start, bytes, bytes_max, qpack, &section);
 
     return bytes;
 }
 
+uint8_t * h3zero_create_post_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+    uint8_t const * path, size_t path_length, uint8_t const * range, size_t range_length, char const* host,
+    h3zero_content_type_enum content_type, char const* ua_string)
+{
+    return h3zero_create_post_header_frame_qpack(bytes, bytes_max, path, path_length, range, range_length, host,
+        content_type, ua_string, NULL, 0);
+}
+
 uint8_t* h3zero_create_post_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     uint8_t const* path, size_t path_length, char const* host, h3zero_content_type_enum content_type)
 {
@@ -897,13 +1894,17 @@ uint8_t* h3zero_create_post_header_frame(uint8_t* bytes, uint8_t* bytes_max,
         content_type, H3ZERO_USER_AGENT_STRING);
 }
 
-uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+uint8_t * h3zero_create_request_header_frame_qpack(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, uint8_t const * range, size_t range_length,
-    char const * host, char const* ua_string)
+    char const * host, char const* ua_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
 {
+    uint8_t* section_start = bytes;
+    h3zero_qpack_section_t section;
+
     if (bytes == NULL || bytes + 2 > bytes_max) {
         return NULL;
     }
+    h3zero_qpack_section_start(qpack, stream_id, &section);
     /* Push 2 NULL bytes for request header: base, and delta */
     *bytes++ = 0;
     *bytes++ = 0;
@@ -913,9 +1914,9 @@ uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes
     bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_SCHEME_HTTPS);
     /* Path: doc_name. Use literal plus reference format */
     bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_CODE_PATH, path, path_length);
-    /* Authority: host. Use literal plus reference format */
+    /* Authority: host. Use the dynamic table if possible */
     if (host != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
     }
     /* Optional: range. Use literal plus reference format */
     if (range_length > 0) {
@@ -923,11 +1924,22 @@ uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes
     }
     /* User Agent */
     if (ua_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
     }
+    /* Section prefix, if dynamic entries are referenced */
+    bytes = h3zero_qpack_section_finish(section_start, bytes, bytes_max, qpack, &section);
+
     return bytes;
 }
 
+uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+    uint8_t const * path, size_t path_length, uint8_t const * range, size_t range_length,
+    char const * host, char const* ua_string)
+{
+    return h3zero_create_request_header_frame_qpack(bytes, bytes_max, path, path_length,
+        range, range_length, host, ua_string, NULL, 0);
+}
+
 uint8_t* h3zero_create_request_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     uint8_t const* path, size_t path_length, char const* host)
 {
@@ -935,13 +1947,16 @@ uint8_t* h3zero_create_request_header_frame(uint8_t* bytes, uint8_t* bytes_max,
         NULL, 0, host, H3ZERO_USER_AGENT_STRING);
 }
 
-uint8_t * h3zero_create_response_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
-    h3zero_content_type_enum doc_type, char const* server_string)
+uint8_t * h3zero_create_response_header_frame_qpack(uint8_t * bytes, uint8_t * bytes_max,
+    h3zero_content_type_enum doc_type, char const* server_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
 {
+    uint8_t* section_start = bytes;
+    h3zero_qpack_section_t section;
 
     if (bytes == NULL || bytes + 2 > bytes_max) {
         return NULL;
     }
+    h3zero_qpack_section_start(qpack, stream_id, &section);
     /* Push 2 NULL bytes for request header: base, and delta */
     *bytes++ = 0;
     *bytes++ = 0;
@@ -951,17 +1966,25 @@ uint8_t * h3zero_create_response_header_frame_ex(uint8_t * bytes, uint8_t * byte
 
     /* Server string */
     if (server_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+        bytes = h3zero_qpack_field_encode(bytes, bytes_max, qpack, &section, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
     }
 
     if (doc_type != h3zero_content_type_none) {
         /* Content type header */
         bytes = h3zero_encode_content_type(bytes, bytes_max, doc_type);
     }
+    /* Section prefix, if dynamic entries are referenced */
+    bytes = h3zero_qpack_section_finish(section_start, bytes, bytes_max, qpack, &section);
 
     return bytes;
 }
 
+uint8_t * h3zero_create_response_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+    h3zero_content_type_enum doc_type, char const* server_string)
+{
+    return h3zero_create_response_header_frame_qpack(bytes, bytes_max, doc_type, server_string, NULL, 0);
+}
+
 uint8_t* h3zero_create_response_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     h3zero_content_type_enum doc_type)
 {
@@ -1125,659 +2148,639 @@ uint8_t const * h3zero_default_setting_frame = h3zero_default_setting_frame_val;
 
 const size_t h3zero_default_setting_frame_size = sizeof(h3zero_default_setting_frame_val);
 
-/* There is no way in QPACK to prevent sender from using Huffman 
- * encoding. We use a simple decoding function with two tables:
- * - h3zero_qpack_huffman_bit, 64 bytes, 512 bits
- * - h3zero_qpack_huffman_val, 512 bytes.
- * If the bit at position "i" is set in the "bit" table, the code decoded so
- * far is an index. Increase "i" by one if the input byte is zero, by the
- * value in the "val" table if 1.
- * If the bit at position "i" is set in the "bit" table, the code decoded so
- * far is a terminal. Add the value in "val" to the decoded octet list, and
- * reset the index "i" to zero.
+/* QPACK Huffman coding, using the static code defined in RFC 7541, Appendix B.
+ *
+ * The encoder uses the table h3zero_qpack_huffman_code, which gives the code
+ * and its length in bits for each octet value.
+ *
+ * The decoder processes the input four bits at a time. The decoding state is
+ * the position in the Huffman tree, identified by the rank of the internal
+ * node; there are 256 internal nodes, the root being 0. For each state and
+ * each nibble value, the table h3zero_qpack_huffman_transition gives the
+ * next state, whether a symbol was decoded and its value, and whether the
+ * transition is valid. Since the shortest code is 5 bits long, at most one
+ * symbol can be decoded per nibble. The string can end in any state reached
+ * through a sequence of "1" bits after the last symbol, i.e., padding with
+ * the most significant bits of the EOS code. The padding must be shorter than
+ * 8 bits, which means that a symbol must end in the last octet of the string.
+ * Reaching the EOS code is an error.
+ *
+ * Both tables are generated from the code table in RFC 7541.
  */
 
-const uint8_t h3zero_qpack_huffman_bit[64] = {
-    249,
-    50,
-    115,
-    39,
-    38,
-    79,
-    147,
-    39,
-    38,
-    100,
-    249,
-    50,
-    114,
-    100,
-    242,
-    100,
-    228,
-    228,
-    206,
-    77,
-    52,
-    228,
-    204,
-    203,
-    202,
-    114,
-    102,
-    79,
-    147,
-    39,
-    76,
-    156,
-    153,
-    62,
-    76,
-    156,
-    156,
-    153,
-    62,
-    76,
-    156,
-    153,
-    60,
-    154,
-    100,
-    242,
-    102,
-    79,
-    147,
-    39,
-    38,
-    83,
-    228,
-    201,
-    201,
-    147,
-    211,
-    39,
-    38,
-    79,
-    38,
-    78,
-    76,
-    178
+typedef struct st_h3zero_qpack_huffman_code_t {
+    uint32_t code;
+    uint8_t length;
+} h3zero_qpack_huffman_code_t;
+
+#define H3ZERO_QPACK_HUFFMAN_SYMBOL 1 /* the transition decodes a symbol */
+#define H3ZERO_QPACK_HUFFMAN_ACCEPT 2 /* the string can end after this transition */
+#define H3ZERO_QPACK_HUFFMAN_FAIL 4 /* the transition reaches the EOS code */
+
+typedef struct st_h3zero_qpack_huffman_transition_t {
+    uint8_t next_state;
+    uint8_t flags;
+    uint8_t symbol;
+} h3zero_qpack_huffman_transition_t;
+
+const h3zero_qpack_huffman_code_t h3zero_qpack_huffman_code[256] = {
+    { 0x1ff8, 13 } /*   0 */,
+    { 0x7fffd8, 23 } /*   1 */,
+    { 0xfffffe2, 28 } /*   2 */,
+    { 0xfffffe3, 28 } /*   3 */,
+    { 0xfffffe4, 28 } /*   4 */,
+    { 0xfffffe5, 28 } /*   5 */,
+    { 0xfffffe6, 28 } /*   6 */,
+    { 0xfffffe7, 28 } /*   7 */,
+    { 0xfffffe8, 28 } /*   8 */,
+    { 0xffffea, 24 } /*   9 */,
+    { 0x3ffffffc, 30 } /*  10 */,
+    { 0xfffffe9, 28 } /*  11 */,
+    { 0xfffffea, 28 } /*  12 */,
+    { 0x3ffffffd, 30 } /*  13 */,
+    { 0xfffffeb, 28 } /*  14 */,
+    { 0xfffffec, 28 } /*  15 */,
+    { 0xfffffed, 28 } /*  16 */,
+    { 0xfffffee, 28 } /*  17 */,
+    { 0xfffffef, 28 } /*  18 */,
+    { 0xffffff0, 28 } /*  19 */,
+    { 0xffffff1, 28 } /*  20 */,
+    { 0xffffff2, 28 } /*  21 */,
+    { 0x3ffffffe, 30 } /*  22 */,
+    { 0xffffff3, 28 } /*  23 */,
+    { 0xffffff4, 28 } /*  24 */,
+    { 0xffffff5, 28 } /*  25 */,
+    { 0xffffff6, 28 } /*  26 */,
+    { 0xffffff7, 28 } /*  27 */,
+    { 0xffffff8, 28 } /*  28 */,
+    { 0xffffff9, 28 } /*  29 */,
+    { 0xffffffa, 28 } /*  30 */,
+    { 0xffffffb, 28 } /*  31 */,
+    { 0x14, 6 } /*  32 */,
+    { 0x3f8, 10 } /* '!' */,
+    { 0x3f9, 10 } /* '"' */,
+    { 0xffa, 12 } /* '#' */,
+    { 0x1ff9, 13 } /* '$' */,
+    { 0x15, 6 } /* '%' */,
+    { 0xf8, 8 } /* '&' */,
+    { 0x7fa, 11 } /*  39 */,
+    { 0x3fa, 10 } /* '(' */,
+    { 0x3fb, 10 } /* ')' */,
+    { 0xf9, 8 } /* '*' */,
+    { 0x7fb, 11 } /* '+' */,
+    { 0xfa, 8 } /* ',' */,
+    { 0x16, 6 } /* '-' */,
+    { 0x17, 6 } /* '.' */,
+    { 0x18, 6 } /* '/' */,
+    { 0x0, 5 } /* '0' */,
+    { 0x1, 5 } /* '1' */,
+    { 0x2, 5 } /* '2' */,
+    { 0x19, 6 } /* '3' */,
+    { 0x1a, 6 } /* '4' */,
+    { 0x1b, 6 } /* '5' */,
+    { 0x1c, 6 } /* '6' */,
+    { 0x1d, 6 } /* '7' */,
+    { 0x1e, 6 } /* '8' */,
+    { 0x1f, 6 } /* '9' */,
+    { 0x5c, 7 } /* ':' */,
+    { 0xfb, 8 } /* ';' */,
+    { 0x7ffc, 15 } /* '<' */,
+    { 0x20, 6 } /* '=' */,
+    { 0xffb, 12 } /* '>' */,
+    { 0x3fc, 10 } /* '?' */,
+    { 0x1ffa, 13 } /* '@' */,
+    { 0x21, 6 } /* 'A' */,
+    { 0x5d, 7 } /* 'B' */,
+    { 0x5e, 7 } /* 'C' */,
+    { 0x5f, 7 } /* 'D' */,
+    { 0x60, 7 } /* 'E' */,
+    { 0x61, 7 } /* 'F' */,
+    { 0x62, 7 } /* 'G' */,
+    { 0x63, 7 } /* 'H' */,
+    { 0x64, 7 } /* 'I' */,
+    { 0x65, 7 } /* 'J' */,
+    { 0x66, 7 } /* 'K' */,
+    { 0x67, 7 } /* 'L' */,
+    { 0x68, 7 } /* 'M' */,
+    { 0x69, 7 } /* 'N' */,
+    { 0x6a, 7 } /* 'O' */,
+    { 0x6b, 7 } /* 'P' */,
+    { 0x6c, 7 } /* 'Q' */,
+    { 0x6d, 7 } /* 'R' */,
+    { 0x6e, 7 } /* 'S' */,
+    { 0x6f, 7 } /* 'T' */,
+    { 0x70, 7 } /* 'U' */,
+    { 0x71, 7 } /* 'V' */,
+    { 0x72, 7 } /* 'W' */,
+    { 0xfc, 8 } /* 'X' */,
+    { 0x73, 7 } /* 'Y' */,
+    { 0xfd, 8 } /* 'Z' */,
+    { 0x1ffb, 13 } /* '[' */,
+    { 0x7fff0, 19 } /*  92 */,
+    { 0x1ffc, 13 } /* ']' */,
+    { 0x3ffc, 14 } /* '^' */,
+    { 0x22, 6 } /* '_' */,
+    { 0x7ffd, 15 } /* '`' */,
+    { 0x3, 5 } /* 'a' */,
+    { 0x23, 6 } /* 'b' */,
+    { 0x4, 5 } /* 'c' */,
+    { 0x24, 6 } /* 'd' */,
+    { 0x5, 5 } /* 'e' */,
+    { 0x25, 6 } /* 'f' */,
+    { 0x26, 6 } /* 'g' */,
+    { 0x27, 6 } /* 'h' */,
+    { 0x6, 5 } /* 'i' */,
+    { 0x74, 7 } /* 'j' */,
+    { 0x75, 7 } /* 'k' */,
+    { 0x28, 6 } /* 'l' */,
+    { 0x29, 6 } /* 'm' */,
+    { 0x2a, 6 } /* 'n' */,
+    { 0x7, 5 } /* 'o' */,
+    { 0x2b, 6 } /* 'p' */,
+    { 0x76, 7 } /* 'q' */,
+    { 0x2c, 6 } /* 'r' */,
+    { 0x8, 5 } /* 's' */,
+    { 0x9, 5 } /* 't' */,
+    { 0x2d, 6 } /* 'u' */,
+    { 0x77, 7 } /* 'v' */,
+    { 0x78, 7 } /* 'w' */,
+    { 0x79, 7 } /* 'x' */,
+    { 0x7a, 7 } /* 'y' */,
+    { 0x7b, 7 } /* 'z' */,
+    { 0x7ffe, 15 } /* '{' */,
+    { 0x7fc, 11 } /* '|' */,
+    { 0x3ffd, 14 } /* '}' */,
+    { 0x1ffd, 13 } /* '~' */,
+    { 0xffffffc, 28 } /* 127 */,
+    { 0xfffe6, 20 } /* 128 */,
+    { 0x3fffd2, 22 } /* 129 */,
+    { 0xfffe7, 20 } /* 130 */,
+    { 0xfffe8, 20 } /* 131 */,
+    { 0x3fffd3, 22 } /* 132 */,
+    { 0x3fffd4, 22 } /* 133 */,
+    { 0x3fffd5, 22 } /* 134 */,
+    { 0x7fffd9, 23 } /* 135 */,
+    { 0x3fffd6, 22 } /* 136 */,
+    { 0x7fffda, 23 } /* 137 */,
+    { 0x7fffdb, 23 } /* 138 */,
+    { 0x7fffdc, 23 } /* 139 */,
+    { 0x7fffdd, 23 } /* 140 */,
+    { 0x7fffde, 23 } /* 141 */,
+    { 0xffffeb, 24 } /* 142 */,
+    { 0x7fffdf, 23 } /* 143 */,
+    { 0xffffec, 24 } /* 144 */,
+    { 0xffffed, 24 } /* 145 */,
+    { 0x3fffd7, 22 } /* 146 */,
+    { 0x7fffe0, 23 } /* 147 */,
+    { 0xffffee, 24 } /* 148 */,
+    { 0x7fffe1, 23 } /* 149 */,
+    { 0x7fffe2, 23 } /* 150 */,
+    { 0x7fffe3, 23 } /* 151 */,
+    { 0x7fffe4, 23 } /* 152 */,
+    { 0x1fffdc, 21 } /* 153 */,
+    { 0x3fffd8, 22 } /* 154 */,
+    { 0x7fffe5, 23 } /* 155 */,
+    { 0x3fffd9, 22 } /* 156 */,
+    { 0x7fffe6, 23 } /* 157 */,
+    { 0x7fffe7, 23 } /* 158 */,
+    { 0xffffef, 24 } /* 159 */,
+    { 0x3fffda, 22 } /* 160 */,
+    { 0x1fffdd, 21 } /* 161 */,
+    { 0xfffe9, 20 } /* 162 */,
+    { 0x3fffdb, 22 } /* 163 */,
+    { 0x3fffdc, 22 } /* 164 */,
+    { 0x7fffe8, 23 } /* 165 */,
+    { 0x7fffe9, 23 } /* 166 */,
+    { 0x1fffde, 21 } /* 167 */,
+    { 0x7fffea, 23 } /* 168 */,
+    { 0x3fffdd, 22 } /* 169 */,
+    { 0x3fffde, 22 } /* 170 */,
+    { 0xfffff0, 24 } /* 171 */,
+    { 0x1fffdf, 21 } /* 172 */,
+    { 0x3fffdf, 22 } /* 173 */,
+    { 0x7fffeb, 23 } /* 174 */,
+    { 0x7fffec, 23 } /* 175 */,
+    { 0x1fffe0, 21 } /* 176 */,
+    { 0x1fffe1, 21 } /* 177 */,
+    { 0x3fffe0, 22 } /* 178 */,
+    { 0x1fffe2, 21 } /* 179 */,
+    { 0x7fffed, 23 } /* 180 */,
+    { 0x3fffe1, 22 } /* 181 */,
+    { 0x7fffee, 23 } /* 182 */,
+    { 0x7fffef, 23 } /* 183 */,
+    { 0xfffea, 20 } /* 184 */,
+    { 0x3fffe2, 22 } /* 185 */,
+    { 0x3fffe3, 22 } /* 186 */,
+    { 0x3fffe4, 22 } /* 187 */,
+    { 0x7ffff0, 23 } /* 188 */,
+    { 0x3fffe5, 22 } /* 189 */,
+    { 0x3fffe6, 22 } /* 190 */,
+    { 0x7ffff1, 23 } /* 191 */,
+    { 0x3ffffe0, 26 } /* 192 */,
+    { 0x3ffffe1, 26 } /* 193 */,
+    { 0xfffeb, 20 } /* 194 */,
+    { 0x7fff1, 19 } /* 195 */,
+    { 0x3fffe7, 22 } /* 196 */,
+    { 0x7ffff2, 23 } /* 197 */,
+    { 0x3fffe8, 22 } /* 198 */,
+    { 0x1ffffec, 25 } /* 199 */,
+    { 0x3ffffe2, 26 } /* 200 */,
+    { 0x3ffffe3, 26 } /* 201 */,
+    { 0x3ffffe4, 26 } /* 202 */,
+    { 0x7ffffde, 27 } /* 203 */,
+    { 0x7ffffdf, 27 } /* 204 */,
+    { 0x3ffffe5, 26 } /* 205 */,
+    { 0xfffff1, 24 } /* 206 */,
+    { 0x1ffffed, 25 } /* 207 */,
+    { 0x7fff2, 19 } /* 208 */,
+    { 0x1fffe3, 21 } /* 209 */,
+    { 0x3ffffe6, 26 } /* 210 */,
+    { 0x7ffffe0, 27 } /* 211 */,
+    { 0x7ffffe1, 27 } /* 212 */,
+    { 0x3ffffe7, 26 } /* 213 */,
+    { 0x7ffffe2, 27 } /* 214 */,
+    { 0xfffff2, 24 } /* 215 */,
+    { 0x1fffe4, 21 } /* 216 */,
+    { 0x1fffe5, 21 } /* 217 */,
+    { 0x3ffffe8, 26 } /* 218 */,
+    { 0x3ffffe9, 26 } /* 219 */,
+    { 0xffffffd, 28 } /* 220 */,
+    { 0x7ffffe3, 27 } /* 221 */,
+    { 0x7ffffe4, 27 } /* 222 */,
+    { 0x7ffffe5, 27 } /* 223 */,
+    { 0xfffec, 20 } /* 224 */,
+    { 0xfffff3, 24 } /* 225 */,
+    { 0xfffed, 20 } /* 226 */,
+    { 0x1fffe6, 21 } /* 227 */,
+    { 0x3fffe9, 22 } /* 228 */,
+    { 0x1fffe7, 21 } /* 229 */,
+    { 0x1fffe8, 21 } /* 230 */,
+    { 0x7ffff3, 23 } /* 231 */,
+    { 0x3fffea, 22 } /* 232 */,
+    { 0x3fffeb, 22 } /* 233 */,
+    { 0x1ffffee, 25 } /* 234 */,
+    { 0x1ffffef, 25 } /* 235 */,
+    { 0xfffff4, 24 } /* 236 */,
+    { 0xfffff5, 24 } /* 237 */,
+    { 0x3ffffea, 26 } /* 238 */,
+    { 0x7ffff4, 23 } /* 239 */,
+    { 0x3ffffeb, 26 } /* 240 */,
+    { 0x7ffffe6, 27 } /* 241 */,
+    { 0x3ffffec, 26 } /* 242 */,
+    { 0x3ffffed, 26 } /* 243 */,
+    { 0x7ffffe7, 27 } /* 244 */,
+    { 0x7ffffe8, 27 } /* 245 */,
+    { 0x7ffffe9, 27 } /* 246 */,
+    { 0x7ffffea, 27 } /* 247 */,
+    { 0x7ffffeb, 27 } /* 248 */,
+    { 0xffffffe, 28 } /* 249 */,
+    { 0x7ffffec, 27 } /* 250 */,
+    { 0x7ffffed, 27 } /* 251 */,
+    { 0x7ffffee, 27 } /* 252 */,
+    { 0x7ffffef, 27 } /* 253 */,
+    { 0x7fffff0, 27 } /* 254 */,
+    { 0x3ffffee, 26 } /* 255 */
 };
 
-const uint8_t h3zero_qpack_huffman_val[512] = {
-    /* 0: |  X: 44 */ 44,
-    /* 1: |0  X: 17 */ 16,
-    /* 2: |00  X: 10 */ 8,
-    /* 3: |000  X: 7 */ 4,
-    /* 4: |0000  X: 6 */ 2,
-    /* 5: |00000  V: 48 */ 48,
-    /* 6: |00001  V: 49 */ 49,
-    /* 7: |0001  X: 9 */ 2,
-    /* 8: |00010  V: 50 */ 50,
-    /* 9: |00011  V: 97 */ 97,
-    /* 10: |001  X: 14 */ 4,
-    /* 11: |0010  X: 13 */ 2,
-    /* 12: |00100  V: 99 */ 99,
-    /* 13: |00101  V: 101 */ 101,
-    /* 14: |0011  X: 16 */ 2,
-    /* 15: |00110  V: 105 */ 105,
-    /* 16: |00111  V: 111 */ 111,
-    /* 17: |01  X: 29 */ 12,
-    /* 18: |010  X: 22 */ 4,
-    /* 19: |0100  X: 21 */ 2,
-    /* 20: |01000  V: 115 */ 115,
-    /* 21: |01001  V: 116 */ 116,
-    /* 22: |0101  X: 26 */ 4,
-    /* 23: |01010  X: 25 */ 2,
-    /* 24: |010100  V: 32 */ 32,
-    /* 25: |010101  V: 37 */ 37,
-    /* 26: |01011  X: 28 */ 2,
-    /* 27: |010110  V: 45 */ 45,
-    /* 28: |010111  V: 46 */ 46,
-    /* 29: |011  X: 37 */ 8,
-    /* 30: |0110  X: 34 */ 4,
-    /* 31: |01100  X: 33 */ 2,
-    /* 32: |011000  V: 47 */ 47,
-    /* 33: |011001  V: 51 */ 51,
-    /* 34: |01101  X: 36 */ 2,
-    /* 35: |011010  V: 52 */ 52,
-    /* 36: |011011  V: 53 */ 53,
-    /* 37: |0111  X: 41 */ 4,
-    /* 38: |01110  X: 40 */ 2,
-    /* 39: |011100  V: 54 */ 54,
-    /* 40: |011101  V: 55 */ 55,
-    /* 41: |01111  X: 43 */ 2,
-    /* 42: |011110  V: 56 */ 56,
-    /* 43: |011111  V: 57 */ 57,
-    /* 44: |1  X: 80 */ 36,
-    /* 45: |10  X: 61 */ 16,
-    /* 46: |100  X: 54 */ 8,
-    /* 47: |1000  X: 51 */ 4,
-    /* 48: |10000  X: 50 */ 2,
-    /* 49: |100000  V: 61 */ 61,
-    /* 50: |100001  V: 65 */ 65,
-    /* 51: |10001  X: 53 */ 2,
-    /* 52: |100010  V: 95 */ 95,
-    /* 53: |100011  V: 98 */ 98,
-    /* 54: |1001  X: 58 */ 4,
-    /* 55: |10010  X: 57 */ 2,
-    /* 56: |100100  V: 100 */ 100,
-    /* 57: |100101  V: 102 */ 102,
-    /* 58: |10011  X: 60 */ 2,
-    /* 59: |100110  V: 103 */ 103,
-    /* 60: |100111  V: 104 */ 104,
-    /* 61: |101  X: 69 */ 8,
-    /* 62: |1010  X: 66 */ 4,
-    /* 63: |10100  X: 65 */ 2,
-    /* 64: |101000  V: 108 */ 108,
-    /* 65: |101001  V: 109 */ 109,
-    /* 66: |10101  X: 68 */ 2,
-    /* 67: |101010  V: 110 */ 110,
-    /* 68: |101011  V: 112 */ 112,
-    /* 69: |1011  X: 73 */ 4,
-    /* 70: |10110  X: 72 */ 2,
-    /* 71: |101100  V: 114 */ 114,
-    /* 72: |101101  V: 117 */ 117,
-    /* 73: |10111  X: 77 */ 4,
-    /* 74: |101110  X: 76 */ 2,
-    /* 75: |1011100  V: 58 */ 58,
-    /* 76: |1011101  V: 66 */ 66,
-    /* 77: |101111  X: 79 */ 2,
-    /* 78: |1011110  V: 67 */ 67,
-    /* 79: |1011111  V: 68 */ 68,
-    /* 80: |11  X: 112 */ 32,
-    /* 81: |110  X: 97 */ 16,
-    /* 82: |1100  X: 90 */ 8,
-    /* 83: |11000  X: 87 */ 4,
-    /* 84: |110000  X: 86 */ 2,
-    /* 85: |1100000  V: 69 */ 69,
-    /* 86: |1100001  V: 70 */ 70,
-    /* 87: |110001  X: 89 */ 2,
-    /* 88: |1100010  V: 71 */ 71,
-    /* 89: |1100011  V: 72 */ 72,
-    /* 90: |11001  X: 94 */ 4,
-    /* 91: |110010  X: 93 */ 2,
-    /* 92: |1100100  V: 73 */ 73,
-    /* 93: |1100101  V: 74 */ 74,
-    /* 94: |110011  X: 96 */ 2,
-    /* 95: |1100110  V: 75 */ 75,
-    /* 96: |1100111  V: 76 */ 76,
-    /* 97: |1101  X: 105 */ 8,
-    /* 98: |11010  X: 102 */ 4,
-    /* 99: |110100  X: 101 */ 2,
-    /* 100: |1101000  V: 77 */ 77,
-    /* 101: |1101001  V: 78 */ 78,
-    /* 102: |110101  X: 104 */ 2,
-    /* 103: |1101010  V: 79 */ 79,
-    /* 104: |1101011  V: 80 */ 80,
-    /* 105: |11011  X: 109 */ 4,
-    /* 106: |110110  X: 108 */ 2,
-    /* 107: |1101100  V: 81 */ 81,
-    /* 108: |1101101  V: 82 */ 82,
-    /* 109: |110111  X: 111 */ 2,
-    /* 110: |1101110  V: 83 */ 83,
-    /* 111: |1101111  V: 84 */ 84,
-    /* 112: |111  X: 128 */ 16,
-    /* 113: |1110  X: 121 */ 8,
-    /* 114: |11100  X: 118 */ 4,
-    /* 115: |111000  X: 117 */ 2,
-    /* 116: |1110000  V: 85 */ 85,
-    /* 117: |1110001  V: 86 */ 86,
-    /* 118: |111001  X: 120 */ 2,
-    /* 119: |1110010  V: 87 */ 87,
-    /* 120: |1110011  V: 89 */ 89,
-    /* 121: |11101  X: 125 */ 4,
-    /* 122: |111010  X: 124 */ 2,
-    /* 123: |1110100  V: 106 */ 106,
-    /* 124: |1110101  V: 107 */ 107,
-    /* 125: |111011  X: 127 */ 2,
-    /* 126: |1110110  V: 113 */ 113,
-    /* 127: |1110111  V: 118 */ 118,
-    /* 128: |1111  X: 136 */ 8,
-    /* 129: |11110  X: 133 */ 4,
-    /* 130: |111100  X: 132 */ 2,
-    /* 131: |1111000  V: 119 */ 119,
-    /* 132: |1111001  V: 120 */ 120,
-    /* 133: |111101  X: 135 */ 2,
-    /* 134: |1111010  V: 121 */ 121,
-    /* 135: |1111011  V: 122 */ 122,
-    /* 136: |11111  X: 144 */ 8,
-    /* 137: |111110  X: 141 */ 4,
-    /* 138: |1111100  X: 140 */ 2,
-    /* 139: |11111000  V: 38 */ 38,
-    /* 140: |11111001  V: 42 */ 42,
-    /* 141: |1111101  X: 143 */ 2,
-    /* 142: |11111010  V: 44 */ 44,
-    /* 143: |11111011  V: 59 */ 59,
-    /* 144: |111111  X: 148 */ 4,
-    /* 145: |1111110  X: 147 */ 2,
-    /* 146: |11111100  V: 88 */ 88,
-    /* 147: |11111101  V: 90 */ 90,
-    /* 148: |1111111  X: 156 */ 8,
-    /* 149: |11111110  X: 153 */ 4,
-    /* 150: |11111110|0  X: 152 */ 2,
-    /* 151: |11111110|00  V: 33 */ 33,
-    /* 152: |11111110|01  V: 34 */ 34,
-    /* 153: |11111110|1  X: 155 */ 2,
-    /* 154: |11111110|10  V: 40 */ 40,
-    /* 155: |11111110|11  V: 41 */ 41,
-    /* 156: |11111111|  X: 162 */ 6,
-    /* 157: |11111111|0  X: 159 */ 2,
-    /* 158: |11111111|00  V: 63 */ 63,
-    /* 159: |11111111|01  X: 161 */ 2,
-    /* 160: |11111111|010  V: 39 */ 39,
-    /* 161: |11111111|011  V: 43 */ 43,
-    /* 162: |11111111|1  X: 168 */ 6,
-    /* 163: |11111111|10  X: 165 */ 2,
-    /* 164: |11111111|100  V: 124 */ 124,
-    /* 165: |11111111|101  X: 167 */ 2,
-    /* 166: |11111111|1010  V: 35 */ 35,
-    /* 167: |11111111|1011  V: 62 */ 62,
-    /* 168: |11111111|11  X: 176 */ 8,
-    /* 169: |11111111|110  X: 173 */ 4,
-    /* 170: |11111111|1100  X: 172 */ 2,
-    /* 171: |11111111|11000  V: 0 */ 0,
-    /* 172: |11111111|11001  V: 36 */ 36,
-    /* 173: |11111111|1101  X: 175 */ 2,
-    /* 174: |11111111|11010  V: 64 */ 64,
-    /* 175: |11111111|11011  V: 91 */ 91,
-    /* 176: |11111111|111  X: 180 */ 4,
-    /* 177: |11111111|1110  X: 179 */ 2,
-    /* 178: |11111111|11100  V: 93 */ 93,
-    /* 179: |11111111|11101  V: 126 */ 126,
-    /* 180: |11111111|1111  X: 184 */ 4,
-    /* 181: |11111111|11110  X: 183 */ 2,
-    /* 182: |11111111|111100  V: 94 */ 94,
-    /* 183: |11111111|111101  V: 125 */ 125,
-    /* 184: |11111111|11111  X: 188 */ 4,
-    /* 185: |11111111|111110  X: 187 */ 2,
-    /* 186: |11111111|1111100  V: 60 */ 60,
-    /* 187: |11111111|1111101  V: 96 */ 96,
-    /* 188: |11111111|111111  X: 190 */ 2,
-    /* 189: |11111111|1111110  V: 123 */ 123,
-    /* 190: |11111111|1111111  X: 220 */ 30,
-    /* 191: |11111111|11111110|  X: 201 */ 10,
-    /* 192: |11111111|11111110|0  X: 196 */ 4,
-    /* 193: |11111111|11111110|00  X: 195 */ 2,
-    /* 194: |11111111|11111110|000  V: 92 */ 92,
-    /* 195: |11111111|11111110|001  V: 195 */ 195,
-    /* 196: |11111111|11111110|01  X: 198 */ 2,
-    /* 197: |11111111|11111110|010  V: 208 */ 208,
-    /* 198: |11111111|11111110|011  X: 200 */ 2,
-    /* 199: |11111111|11111110|0110  V: 128 */ 128,
-    /* 200: |11111111|11111110|0111  V: 130 */ 130,
-    /* 201: |11111111|11111110|1  X: 209 */ 8,
-    /* 202: |11111111|11111110|10  X: 206 */ 4,
-    /* 203: |11111111|11111110|100  X: 205 */ 2,
-    /* 204: |11111111|11111110|1000  V: 131 */ 131,
-    /* 205: |11111111|11111110|1001  V: 162 */ 162,
-    /* 206: |11111111|11111110|101  X: 208 */ 2,
-    /* 207: |11111111|11111110|1010  V: 184 */ 184,
-    /* 208: |11111111|11111110|1011  V: 194 */ 194,
-    /* 209: |11111111|11111110|11  X: 213 */ 4,
-    /* 210: |11111111|11111110|110  X: 212 */ 2,
-    /* 211: |11111111|11111110|1100  V: 224 */ 224,
-    /* 212: |11111111|11111110|1101  V: 226 */ 226,
-    /* 213: |11111111|11111110|111  X: 217 */ 4,
-    /* 214: |11111111|11111110|1110  X: 216 */ 2,
-    /* 215: |11111111|11111110|11100  V: 153 */ 153,
-    /* 216: |11111111|11111110|11101  V: 161 */ 161,
-    /* 217: |11111111|11111110|1111  X: 219 */ 2,
-    /* 218: |11111111|11111110|11110  V: 167 */ 167,
-    /* 219: |11111111|11111110|11111  V: 172 */ 172,
-    /* 220: |11111111|11111111|  X: 266 */ 46,
-    /* 221: |11111111|11111111|0  X: 237 */ 16,
-    /* 222: |11111111|11111111|00  X: 230 */ 8,
-    /* 223: |11111111|11111111|000  X: 227 */ 4,
-    /* 224: |11111111|11111111|0000  X: 226 */ 2,
-    /* 225: |11111111|11111111|00000  V: 176 */ 176,
-    /* 226: |11111111|11111111|00001  V: 177 */ 177,
-    /* 227: |11111111|11111111|0001  X: 229 */ 2,
-    /* 228: |11111111|11111111|00010  V: 179 */ 179,
-    /* 229: |11111111|11111111|00011  V: 209 */ 209,
-    /* 230: |11111111|11111111|001  X: 234 */ 4,
-    /* 231: |11111111|11111111|0010  X: 233 */ 2,
-    /* 232: |11111111|11111111|00100  V: 216 */ 216,
-    /* 233: |11111111|11111111|00101  V: 217 */ 217,
-    /* 234: |11111111|11111111|0011  X: 236 */ 2,
-    /* 235: |11111111|11111111|00110  V: 227 */ 227,
-    /* 236: |11111111|11111111|00111  V: 229 */ 229,
-    /* 237: |11111111|11111111|01  X: 251 */ 14,
-    /* 238: |11111111|11111111|010  X: 244 */ 6,
-    /* 239: |11111111|11111111|0100  X: 241 */ 2,
-    /* 240: |11111111|11111111|01000  V: 230 */ 230,
-    /* 241: |11111111|11111111|01001  X: 243 */ 2,
-    /* 242: |11111111|11111111|010010  V: 129 */ 129,
-    /* 243: |11111111|11111111|010011  V: 132 */ 132,
-    /* 244: |11111111|11111111|0101  X: 248 */ 4,
-    /* 245: |11111111|11111111|01010  X: 247 */ 2,
-    /* 246: |11111111|11111111|010100  V: 133 */ 133,
-    /* 247: |11111111|11111111|010101  V: 134 */ 134,
-    /* 248: |11111111|11111111|01011  X: 250 */ 2,
-    /* 249: |11111111|11111111|010110  V: 136 */ 136,
-    /* 250: |11111111|11111111|010111  V: 146 */ 146,
-    /* 251: |11111111|11111111|011  X: 259 */ 8,
-    /* 252: |11111111|11111111|0110  X: 256 */ 4,
-    /* 253: |11111111|11111111|01100  X: 255 */ 2,
-    /* 254: |11111111|11111111|011000  V: 154 */ 154,
-    /* 255: |11111111|11111111|011001  V: 156 */ 156,
-    /* 256: |11111111|11111111|01101  X: 257 */ 2,
-    /* 257: |11111111|11111111|011010  V: 160 */ 160,
-    /* 258: |11111111|11111111|011011  V: 163 */ 163,
-    /* 259: |11111111|11111111|0111  X: 263 */ 4,
-    /* 260: |11111111|11111111|01110  X: 262 */ 2,
-    /* 261: |11111111|11111111|011100  V: 164 */ 164,
-    /* 262: |11111111|11111111|011101  V: 169 */ 169,
-    /* 263: |11111111|11111111|01111  X: 265 */ 2,
-    /* 264: |11111111|11111111|011110  V: 170 */ 170,
-    /* 265: |11111111|11111111|011111  V: 173 */ 173,
-    /* 266: |11111111|11111111|1  X: 306 */ 40,
-    /* 267: |11111111|11111111|10  X: 283 */ 16,
-    /* 268: |11111111|11111111|100  X: 276 */ 8,
-    /* 269: |11111111|11111111|1000  X: 273 */ 4,
-    /* 270: |11111111|11111111|10000  X: 272 */ 2,
-    /* 271: |11111111|11111111|100000  V: 178 */ 178,
-    /* 272: |11111111|11111111|100001  V: 181 */ 181,
-    /* 273: |11111111|11111111|10001  X: 275 */ 2,
-    /* 274: |11111111|11111111|100010  V: 185 */ 185,
-    /* 275: |11111111|11111111|100011  V: 186 */ 186,
-    /* 276: |11111111|11111111|1001  X: 280 */ 4,
-    /* 277: |11111111|11111111|10010  X: 279 */ 2,
-    /* 278: |11111111|11111111|100100  V: 187 */ 187,
-    /* 279: |11111111|11111111|100101  V: 189 */ 189,
-    /* 280: |11111111|11111111|10011  X: 282 */ 2,
-    /* 281: |11111111|11111111|100110  V: 190 */ 190,
-    /* 282: |11111111|11111111|100111  V: 196 */ 196,
-    /* 283: |11111111|11111111|101  X: 291 */ 8,
-    /* 284: |11111111|11111111|1010  X: 288 */ 4,
-    /* 285: |11111111|11111111|10100  X: 287 */ 2,
-    /* 286: |11111111|11111111|101000  V: 198 */ 198,
-    /* 287: |11111111|11111111|101001  V: 228 */ 228,
-    /* 288: |11111111|11111111|10101  X: 290 */ 2,
-    /* 289: |11111111|11111111|101010  V: 232 */ 232,
-    /* 290: |11111111|11111111|101011  V: 233 */ 233,
-    /* 291: |11111111|11111111|1011  X: 299 */ 8,
-    /* 292: |11111111|11111111|10110  X: 296 */ 4,
-    /* 293: |11111111|11111111|101100  X: 295 */ 2,
-    /* 294: |11111111|11111111|1011000  V: 1 */ 1,
-    /* 295: |11111111|11111111|1011001  V: 135 */ 135,
-    /* 296: |11111111|11111111|101101  X: 298 */ 2,
-    /* 297: |11111111|11111111|1011010  V: 137 */ 137,
-    /* 298: |11111111|11111111|1011011  V: 138 */ 138,
-    /* 299: |11111111|11111111|10111  X: 303 */ 4,
-    /* 300: |11111111|11111111|101110  X: 302 */ 2,
-    /* 301: |11111111|11111111|1011100  V: 139 */ 139,
-    /* 302: |11111111|11111111|1011101  V: 140 */ 140,
-    /* 303: |11111111|11111111|101111  X: 305 */ 2,
-    /* 304: |11111111|11111111|1011110  V: 141 */ 141,
-    /* 305: |11111111|11111111|1011111  V: 143 */ 143,
-    /* 306: |11111111|11111111|11  X: 338 */ 32,
-    /* 307: |11111111|11111111|110  X: 323 */ 16,
-    /* 308: |11111111|11111111|1100  X: 316 */ 8,
-    /* 309: |11111111|11111111|11000  X: 313 */ 4,
-    /* 310: |11111111|11111111|110000  X: 312 */ 2,
-    /* 311: |11111111|11111111|1100000  V: 147 */ 147,
-    /* 312: |11111111|11111111|1100001  V: 149 */ 149,
-    /* 313: |11111111|11111111|110001  X: 315 */ 2,
-    /* 314: |11111111|11111111|1100010  V: 150 */ 150,
-    /* 315: |11111111|11111111|1100011  V: 151 */ 151,
-    /* 316: |11111111|11111111|11001  X: 320 */ 4,
-    /* 317: |11111111|11111111|110010  X: 319 */ 2,
-    /* 318: |11111111|11111111|1100100  V: 152 */ 152,
-    /* 319: |11111111|11111111|1100101  V: 155 */ 155,
-    /* 320: |11111111|11111111|110011  X: 322 */ 2,
-    /* 321: |11111111|11111111|1100110  V: 157 */ 157,
-    /* 322: |11111111|11111111|1100111  V: 158 */ 158,
-    /* 323: |11111111|11111111|1101  X: 331 */ 8,
-    /* 324: |11111111|11111111|11010  X: 328 */ 4,
-    /* 325: |11111111|11111111|110100  X: 327 */ 2,
-    /* 326: |11111111|11111111|1101000  V: 165 */ 165,
-    /* 327: |11111111|11111111|1101001  V: 166 */ 166,
-    /* 328: |11111111|11111111|110101  X: 330 */ 2,
-    /* 329: |11111111|11111111|1101010  V: 168 */ 168,
-    /* 330: |11111111|11111111|1101011  V: 174 */ 174,
-    /* 331: |11111111|11111111|11011  X: 335 */ 4,
-    /* 332: |11111111|11111111|110110  X: 334 */ 2,
-    /* 333: |11111111|11111111|1101100  V: 175 */ 175,
-    /* 334: |11111111|11111111|1101101  V: 180 */ 180,
-    /* 335: |11111111|11111111|110111  X: 337 */ 2,
-    /* 336: |11111111|11111111|1101110  V: 182 */ 182,
-    /* 337: |11111111|11111111|1101111  V: 183 */ 183,
-    /* 338: |11111111|11111111|111  X: 360 */ 22,
-    /* 339: |11111111|11111111|1110  X: 347 */ 8,
-    /* 340: |11111111|11111111|11100  X: 344 */ 4,
-    /* 341: |11111111|11111111|111000  X: 343 */ 2,
-    /* 342: |11111111|11111111|1110000  V: 188 */ 188,
-    /* 343: |11111111|11111111|1110001  V: 191 */ 191,
-    /* 344: |11111111|11111111|111001  X: 346 */ 2,
-    /* 345: |11111111|11111111|1110010  V: 197 */ 197,
-    /* 346: |11111111|11111111|1110011  V: 231 */ 231,
-    /* 347: |11111111|11111111|11101  X: 353 */ 6,
-    /* 348: |11111111|11111111|111010  X: 350 */ 2,
-    /* 349: |11111111|11111111|1110100  V: 239 */ 239,
-    /* 350: |11111111|11111111|1110101  X: 352 */ 2,
-    /* 351: |11111111|11111111|11101010  V: 9 */ 9,
-    /* 352: |11111111|11111111|11101011  V: 142 */ 142,
-    /* 353: |11111111|11111111|111011  X: 357 */ 4,
-    /* 354: |11111111|11111111|1110110  X: 356 */ 2,
-    /* 355: |11111111|11111111|11101100  V: 144 */ 144,
-    /* 356: |11111111|11111111|11101101  V: 145 */ 145,
-    /* 357: |11111111|11111111|1110111  X: 359 */ 2,
-    /* 358: |11111111|11111111|11101110  V: 148 */ 148,
-    /* 359: |11111111|11111111|11101111  V: 159 */ 159,
-    /* 360: |11111111|11111111|1111  X: 380 */ 20,
-    /* 361: |11111111|11111111|11110  X: 369 */ 8,
-    /* 362: |11111111|11111111|111100  X: 366 */ 4,
-    /* 363: |11111111|11111111|1111000  X: 365 */ 2,
-    /* 364: |11111111|11111111|11110000  V: 171 */ 171,
-    /* 365: |11111111|11111111|11110001  V: 206 */ 206,
-    /* 366: |11111111|11111111|1111001  X: 368 */ 2,
-    /* 367: |11111111|11111111|11110010  V: 215 */ 215,
-    /* 368: |11111111|11111111|11110011  V: 225 */ 225,
-    /* 369: |11111111|11111111|111101  X: 373 */ 4,
-    /* 370: |11111111|11111111|1111010  X: 372 */ 2,
-    /* 371: |11111111|11111111|11110100  V: 236 */ 236,
-    /* 372: |11111111|11111111|11110101  V: 237 */ 237,
-    /* 373: |11111111|11111111|1111011  X: 377 */ 4,
-    /* 374: |11111111|11111111|11110110|  X: 376 */ 2,
-    /* 375: |11111111|11111111|11110110|0  V: 199 */ 199,
-    /* 376: |11111111|11111111|11110110|1  V: 207 */ 207,
-    /* 377: |11111111|11111111|11110111|  X: 379 */ 2,
-    /* 378: |11111111|11111111|11110111|0  V: 234 */ 234,
-    /* 379: |11111111|11111111|11110111|1  V: 235 */ 235,
-    /* 380: |11111111|11111111|11111  X: 414 */ 34,
-    /* 381: |11111111|11111111|111110  X: 397 */ 16,
-    /* 382: |11111111|11111111|1111100  X: 390 */ 8,
-    /* 383: |11111111|11111111|11111000|  X: 387 */ 4,
-    /* 384: |11111111|11111111|11111000|0  X: 386 */ 2,
-    /* 385: |11111111|11111111|11111000|00  V: 192 */ 192,
-    /* 386: |11111111|11111111|11111000|01  V: 193 */ 193,
-    /* 387: |11111111|11111111|11111000|1  X: 389 */ 2,
-    /* 388: |11111111|11111111|11111000|10  V: 200 */ 200,
-    /* 389: |11111111|11111111|11111000|11  V: 201 */ 201,
-    /* 390: |11111111|11111111|11111001|  X: 394 */ 4,
-    /* 391: |11111111|11111111|11111001|0  X: 393 */ 2,
-    /* 392: |11111111|11111111|11111001|00  V: 202 */ 202,
-    /* 393: |11111111|11111111|11111001|01  V: 205 */ 205,
-    /* 394: |11111111|11111111|11111001|1  X: 396 */ 2,
-    /* 395: |11111111|11111111|11111001|10  V: 210 */ 210,
-    /* 396: |11111111|11111111|11111001|11  V: 213 */ 213,
-    /* 397: |11111111|11111111|1111101  X: 405 */ 8,
-    /* 398: |11111111|11111111|11111010|  X: 402 */ 4,
-    /* 399: |11111111|11111111|11111010|0  X: 401 */ 2,
-    /* 400: |11111111|11111111|11111010|00  V: 218 */ 218,
-    /* 401: |11111111|11111111|11111010|01  V: 219 */ 219,
-    /* 402: |11111111|11111111|11111010|1  X: 404 */ 2,
-    /* 403: |11111111|11111111|11111010|10  V: 238 */ 238,
-    /* 404: |11111111|11111111|11111010|11  V: 240 */ 240,
-    /* 405: |11111111|11111111|11111011|  X: 409 */ 4,
-    /* 406: |11111111|11111111|11111011|0  X: 408 */ 2,
-    /* 407: |11111111|11111111|11111011|00  V: 242 */ 242,
-    /* 408: |11111111|11111111|11111011|01  V: 243 */ 243,
-    /* 409: |11111111|11111111|11111011|1  X: 411 */ 2,
-    /* 410: |11111111|11111111|11111011|10  V: 255 */ 255,
-    /* 411: |11111111|11111111|11111011|11  X: 413 */ 2,
-    /* 412: |11111111|11111111|11111011|110  V: 203 */ 203,
-    /* 413: |11111111|11111111|11111011|111  V: 204 */ 204,
-    /* 414: |11111111|11111111|111111  X: 446 */ 32,
-    /* 415: |11111111|11111111|1111110  X: 431 */ 16,
-    /* 416: |11111111|11111111|11111100|  X: 424 */ 8,
-    /* 417: |11111111|11111111|11111100|0  X: 421 */ 4,
-    /* 418: |11111111|11111111|11111100|00  X: 420 */ 2,
-    /* 419: |11111111|11111111|11111100|000  V: 211 */ 211,
-    /* 420: |11111111|11111111|11111100|001  V: 212 */ 212,
-    /* 421: |11111111|11111111|11111100|01  X: 423 */ 2,
-    /* 422: |11111111|11111111|11111100|010  V: 214 */ 214,
-    /* 423: |11111111|11111111|11111100|011  V: 221 */ 221,
-    /* 424: |11111111|11111111|11111100|1  X: 428 */ 4,
-    /* 425: |11111111|11111111|11111100|10  X: 427 */ 2,
-    /* 426: |11111111|11111111|11111100|100  V: 222 */ 222,
-    /* 427: |11111111|11111111|11111100|101  V: 223 */ 223,
-    /* 428: |11111111|11111111|11111100|11  X: 430 */ 2,
-    /* 429: |11111111|11111111|11111100|110  V: 241 */ 241,
-    /* 430: |11111111|11111111|11111100|111  V: 244 */ 244,
-    /* 431: |11111111|11111111|11111101|  X: 439 */ 8,
-    /* 432: |11111111|11111111|11111101|0  X: 436 */ 4,
-    /* 433: |11111111|11111111|11111101|00  X: 435 */ 2,
-    /* 434: |11111111|11111111|11111101|000  V: 245 */ 245,
-    /* 435: |11111111|11111111|11111101|001  V: 246 */ 246,
-    /* 436: |11111111|11111111|11111101|01  X: 438 */ 2,
-    /* 437: |11111111|11111111|11111101|010  V: 247 */ 247,
-    /* 438: |11111111|11111111|11111101|011  V: 248 */ 248,
-    /* 439: |11111111|11111111|11111101|1  X: 443 */ 4,
-    /* 440: |11111111|11111111|11111101|10  X: 442 */ 2,
-    /* 441: |11111111|11111111|11111101|100  V: 250 */ 250,
-    /* 442: |11111111|11111111|11111101|101  V: 251 */ 251,
-    /* 443: |11111111|11111111|11111101|11  X: 445 */ 2,
-    /* 444: |11111111|11111111|11111101|110  V: 252 */ 252,
-    /* 445: |11111111|11111111|11111101|111  V: 253 */ 253,
-    /* 446: |11111111|11111111|1111111  X: 476 */ 30,
-    /* 447: |11111111|11111111|11111110|  X: 461 */ 14,
-    /* 448: |11111111|11111111|11111110|0  X: 454 */ 6,
-    /* 449: |11111111|11111111|11111110|00  X: 451 */ 2,
-    /* 450: |11111111|11111111|11111110|000  V: 254 */ 254,
-    /* 451: |11111111|11111111|11111110|001  X: 453 */ 2,
-    /* 452: |11111111|11111111|11111110|0010  V: 2 */ 2,
-    /* 453: |11111111|11111111|11111110|0011  V: 3 */ 3,
-    /* 454: |11111111|11111111|11111110|01  X: 458 */ 4,
-    /* 455: |11111111|11111111|11111110|010  X: 457 */ 2,
-    /* 456: |11111111|11111111|11111110|0100  V: 4 */ 4,
-    /* 457: |11111111|11111111|11111110|0101  V: 5 */ 5,
-    /* 458: |11111111|11111111|11111110|011  X: 460 */ 2,
-    /* 459: |11111111|11111111|11111110|0110  V: 6 */ 6,
-    /* 460: |11111111|11111111|11111110|0111  V: 7 */ 7,
-    /* 461: |11111111|11111111|11111110|1  X: 469 */ 8,
-    /* 462: |11111111|11111111|11111110|10  X: 466 */ 4,
-    /* 463: |11111111|11111111|11111110|100  X: 465 */ 2,
-    /* 464: |11111111|11111111|11111110|1000  V: 8 */ 8,
-    /* 465: |11111111|11111111|11111110|1001  V: 11 */ 11,
-    /* 466: |11111111|11111111|11111110|101  X: 468 */ 2,
-    /* 467: |11111111|11111111|11111110|1010  V: 12 */ 12,
-    /* 468: |11111111|11111111|11111110|1011  V: 14 */ 14,
-    /* 469: |11111111|11111111|11111110|11  X: 473 */ 4,
-    /* 470: |11111111|11111111|11111110|110  X: 472 */ 2,
-    /* 471: |11111111|11111111|11111110|1100  V: 15 */ 15,
-    /* 472: |11111111|11111111|11111110|1101  V: 16 */ 16,
-    /* 473: |11111111|11111111|11111110|111  X: 475 */ 2,
-    /* 474: |11111111|11111111|11111110|1110  V: 17 */ 17,
-    /* 475: |11111111|11111111|11111110|1111  V: 18 */ 18,
-    /* 476: |11111111|11111111|11111111|  X: 492 */ 16,
-    /* 477: |11111111|11111111|11111111|0  X: 485 */ 8,
-    /* 478: |11111111|11111111|11111111|00  X: 482 */ 4,
-    /* 479: |11111111|11111111|11111111|000  X: 481 */ 2,
-    /* 480: |11111111|11111111|11111111|0000  V: 19 */ 19,
-    /* 481: |11111111|11111111|11111111|0001  V: 20 */ 20,
-    /* 482: |11111111|11111111|11111111|001  X: 484 */ 2,
-    /* 483: |11111111|11111111|11111111|0010  V: 21 */ 21,
-    /* 484: |11111111|11111111|11111111|0011  V: 23 */ 23,
-    /* 485: |11111111|11111111|11111111|01  X: 489 */ 4,
-    /* 486: |11111111|11111111|11111111|010  X: 488 */ 2,
-    /* 487: |11111111|11111111|11111111|0100  V: 24 */ 24,
-    /* 488: |11111111|11111111|11111111|0101  V: 25 */ 25,
-    /* 489: |11111111|11111111|11111111|011  X: 491 */ 2,
-    /* 490: |11111111|11111111|11111111|0110  V: 26 */ 26,
-    /* 491: |11111111|11111111|11111111|0111  V: 27 */ 27,
-    /* 492: |11111111|11111111|11111111|1  X: 500 */ 8,
-    /* 493: |11111111|11111111|11111111|10  X: 497 */ 4,
-    /* 494: |11111111|11111111|11111111|100  X: 496 */ 2,
-    /* 495: |11111111|11111111|11111111|1000  V: 28 */ 28,
-    /* 496: |11111111|11111111|11111111|1001  V: 29 */ 29,
-    /* 497: |11111111|11111111|11111111|101  X: 499 */ 2,
-    /* 498: |11111111|11111111|11111111|1010  V: 30 */ 30,
-    /* 499: |11111111|11111111|11111111|1011  V: 31 */ 31,
-    /* 500: |11111111|11111111|11111111|11  X: 504 */ 4,
-    /* 501: |11111111|11111111|11111111|110  X: 503 */ 2,
-    /* 502: |11111111|11111111|11111111|1100  V: 127 */ 127,
-    /* 503: |11111111|11111111|11111111|1101  V: 220 */ 220,
-    /* 504: |11111111|11111111|11111111|111  X: 506 */ 2,
-    /* 505: |11111111|11111111|11111111|1110  V: 249 */ 249,
-    /* 506: |11111111|11111111|11111111|1111  X: 510 */ 4,
-    /* 507: |11111111|11111111|11111111|11110  X: 509 */ 2,
-    /* 508: |11111111|11111111|11111111|111100  V: 10 */ 10,
-    /* 509: |11111111|11111111|11111111|111101  V: 13 */ 13,
-    /* 510: |11111111|11111111|11111111|11111  X: 512 */ 2,
-    /* 511: |11111111|11111111|11111111|111110  V: 22 */ 22
+const h3zero_qpack_huffman_transition_t h3zero_qpack_huffman_transition[256][16] = {
+    /*   0 */ { {15,0,0}, {16,0,0}, {17,0,0}, {18,0,0}, {19,0,0}, {20,0,0}, {21,0,0}, {22,0,0}, {23,0,0}, {24,0,0}, {25,0,0}, {26,0,0}, {27,0,0}, {28,0,0}, {29,0,0}, {30,2,0} },
+    /*   1 */ { {0,3,48}, {0,3,49}, {0,3,50}, {0,3,97}, {0,3,99}, {0,3,101}, {0,3,105}, {0,3,111}, {0,3,115}, {0,3,116}, {31,0,0}, {32,0,0}, {33,0,0}, {34,0,0}, {35,0,0}, {36,0,0} },
+    /*   2 */ { {37,0,0}, {38,0,0}, {39,0,0}, {40,0,0}, {41,0,0}, {42,0,0}, {43,0,0}, {44,0,0}, {45,0,0}, {46,0,0}, {47,0,0}, {48,0,0}, {49,0,0}, {50,0,0}, {51,0,0}, {52,2,0} },
+    /*   3 */ { {1,1,48}, {2,3,48}, {1,1,49}, {2,3,49}, {1,1,50}, {2,3,50}, {1,1,97}, {2,3,97}, {1,1,99}, {2,3,99}, {1,1,101}, {2,3,101}, {1,1,105}, {2,3,105}, {1,1,111}, {2,3,111} },
+    /*   4 */ { {1,1,115}, {2,3,115}, {1,1,116}, {2,3,116}, {0,3,32}, {0,3,37}, {0,3,45}, {0,3,46}, {0,3,47}, {0,3,51}, {0,3,52}, {0,3,53}, {0,3,54}, {0,3,55}, {0,3,56}, {0,3,57} },
+    /*   5 */ { {0,3,61}, {0,3,65}, {0,3,95}, {0,3,98}, {0,3,100}, {0,3,102}, {0,3,103}, {0,3,104}, {0,3,108}, {0,3,109}, {0,3,110}, {0,3,112}, {0,3,114}, {0,3,117}, {53,0,0}, {54,0,0} },
+    /*   6 */ { {55,0,0}, {56,0,0}, {57,0,0}, {58,0,0}, {59,0,0}, {60,0,0}, {61,0,0}, {62,0,0}, {63,0,0}, {64,0,0}, {65,0,0}, {66,0,0}, {67,0,0}, {68,0,0}, {69,0,0}, {70,2,0} },
+    /*   7 */ { {3,1,48}, {4,1,48}, {5,1,48}, {6,3,48}, {3,1,49}, {4,1,49}, {5,1,49}, {6,3,49}, {3,1,50}, {4,1,50}, {5,1,50}, {6,3,50}, {3,1,97}, {4,1,97}, {5,1,97}, {6,3,97} },
+    /*   8 */ { {3,1,99}, {4,1,99}, {5,1,99}, {6,3,99}, {3,1,101}, {4,1,101}, {5,1,101}, {6,3,101}, {3,1,105}, {4,1,105}, {5,1,105}, {6,3,105}, {3,1,111}, {4,1,111}, {5,1,111}, {6,3,111} },
+    /*   9 */ { {3,1,115}, {4,1,115}, {5,1,115}, {6,3,115}, {3,1,116}, {4,1,116}, {5,1,116}, {6,3,116}, {1,1,32}, {2,3,32}, {1,1,37}, {2,3,37}, {1,1,45}, {2,3,45}, {1,1,46}, {2,3,46} },
+    /*  10 */ { {1,1,47}, {2,3,47}, {1,1,51}, {2,3,51}, {1,1,52}, {2,3,52}, {1,1,53}, {2,3,53}, {1,1,54}, {2,3,54}, {1,1,55}, {2,3,55}, {1,1,56}, {2,3,56}, {1,1,57}, {2,3,57} },
+    /*  11 */ { {1,1,61}, {2,3,61}, {1,1,65}, {2,3,65}, {1,1,95}, {2,3,95}, {1,1,98}, {2,3,98}, {1,1,100}, {2,3,100}, {1,1,102}, {2,3,102}, {1,1,103}, {2,3,103}, {1,1,104}, {2,3,104} },
+    /*  12 */ { {1,1,108}, {2,3,108}, {1,1,109}, {2,3,109}, {1,1,110}, {2,3,110}, {1,1,112}, {2,3,112}, {1,1,114}, {2,3,114}, {1,1,117}, {2,3,117}, {0,3,58}, {0,3,66}, {0,3,67}, {0,3,68} },
+    /*  13 */ { {0,3,69}, {0,3,70}, {0,3,71}, {0,3,72}, {0,3,73}, {0,3,74}, {0,3,75}, {0,3,76}, {0,3,77}, {0,3,78}, {0,3,79}, {0,3,80}, {0,3,81}, {0,3,82}, {0,3,83}, {0,3,84} },
+    /*  14 */ { {0,3,85}, {0,3,86}, {0,3,87}, {0,3,89}, {0,3,106}, {0,3,107}, {0,3,113}, {0,3,118}, {0,3,119}, {0,3,120}, {0,3,121}, {0,3,122}, {71,0,0}, {72,0,0}, {73,0,0}, {74,2,0} },
+    /*  15 */ { {7,1,48}, {8,1,48}, {9,1,48}, {10,1,48}, {11,1,48}, {12,1,48}, {13,1,48}, {14,3,48}, {7,1,49}, {8,1,49}, {9,1,49}, {10,1,49}, {11,1,49}, {12,1,49}, {13,1,49}, {14,3,49} },
+    /*  16 */ { {7,1,50}, {8,1,50}, {9,1,50}, {10,1,50}, {11,1,50}, {12,1,50}, {13,1,50}, {14,3,50}, {7,1,97}, {8,1,97}, {9,1,97}, {10,1,97}, {11,1,97}, {12,1,97}, {13,1,97}, {14,3,97} },
+    /*  17 */ { {7,1,99}, {8,1,99}, {9,1,99}, {10,1,99}, {11,1,99}, {12,1,99}, {13,1,99}, {14,3,99}, {7,1,101}, {8,1,101}, {9,1,101}, {10,1,101}, {11,1,101}, {12,1,101}, {13,1,101}, {14,3,101} },
+    /*  18 */ { {7,1,105}, {8,1,105}, {9,1,105}, {10,1,105}, {11,1,105}, {12,1,105}, {13,1,105}, {14,3,105}, {7,1,111}, {8,1,111}, {9,1,111}, {10,1,111}, {11,1,111}, {12,1,111}, {13,1,111}, {14,3,111} },
+    /*  19 */ { {7,1,115}, {8,1,115}, {9,1,115}, {10,1,115}, {11,1,115}, {12,1,115}, {13,1,115}, {14,3,115}, {7,1,116}, {8,1,116}, {9,1,116}, {10,1,116}, {11,1,116}, {12,1,116}, {13,1,116}, {14,3,116} },
+    /*  20 */ { {3,1,32}, {4,1,32}, {5,1,32}, {6,3,32}, {3,1,37}, {4,1,37}, {5,1,37}, {6,3,37}, {3,1,45}, {4,1,45}, {5,1,45}, {6,3,45}, {3,1,46}, {4,1,46}, {5,1,46}, {6,3,46} },
+    /*  21 */ { {3,1,47}, {4,1,47}, {5,1,47}, {6,3,47}, {3,1,51}, {4,1,51}, {5,1,51}, {6,3,51}, {3,1,52}, {4,1,52}, {5,1,52}, {6,3,52}, {3,1,53}, {4,1,53}, {5,1,53}, {6,3,53} },
+    /*  22 */ { {3,1,54}, {4,1,54}, {5,1,54}, {6,3,54}, {3,1,55}, {4,1,55}, {5,1,55}, {6,3,55}, {3,1,56}, {4,1,56}, {5,1,56}, {6,3,56}, {3,1,57}, {4,1,57}, {5,1,57}, {6,3,57} },
+    /*  23 */ { {3,1,61}, {4,1,61}, {5,1,61}, {6,3,61}, {3,1,65}, {4,1,65}, {5,1,65}, {6,3,65}, {3,1,95}, {4,1,95}, {5,1,95}, {6,3,95}, {3,1,98}, {4,1,98}, {5,1,98}, {6,3,98} },
+    /*  24 */ { {3,1,100}, {4,1,100}, {5,1,100}, {6,3,100}, {3,1,102}, {4,1,102}, {5,1,102}, {6,3,102}, {3,1,103}, {4,1,103}, {5,1,103}, {6,3,103}, {3,1,104}, {4,1,104}, {5,1,104}, {6,3,104} },
+    /*  25 */ { {3,1,108}, {4,1,108}, {5,1,108}, {6,3,108}, {3,1,109}, {4,1,109}, {5,1,109}, {6,3,109}, {3,1,110}, {4,1,110}, {5,1,110}, {6,3,110}, {3,1,112}, {4,1,112}, {5,1,112}, {6,3,112} },
+    /*  26 */ { {3,1,114}, {4,1,114}, {5,1,114}, {6,3,114}, {3,1,117}, {4,1,117}, {5,1,117}, {6,3,117}, {1,1,58}, {2,3,58}, {1,1,66}, {2,3,66}, {1,1,67}, {2,3,67}, {1,1,68}, {2,3,68} },
+    /*  27 */ { {1,1,69}, {2,3,69}, {1,1,70}, {2,3,70}, {1,1,71}, {2,3,71}, {1,1,72}, {2,3,72}, {1,1,73}, {2,3,73}, {1,1,74}, {2,3,74}, {1,1,75}, {2,3,75}, {1,1,76}, {2,3,76} },
+    /*  28 */ { {1,1,77}, {2,3,77}, {1,1,78}, {2,3,78}, {1,1,79}, {2,3,79}, {1,1,80}, {2,3,80}, {1,1,81}, {2,3,81}, {1,1,82}, {2,3,82}, {1,1,83}, {2,3,83}, {1,1,84}, {2,3,84} },
+    /*  29 */ { {1,1,85}, {2,3,85}, {1,1,86}, {2,3,86}, {1,1,87}, {2,3,87}, {1,1,89}, {2,3,89}, {1,1,106}, {2,3,106}, {1,1,107}, {2,3,107}, {1,1,113}, {2,3,113}, {1,1,118}, {2,3,118} },
+    /*  30 */ { {1,1,119}, {2,3,119}, {1,1,120}, {2,3,120}, {1,1,121}, {2,3,121}, {1,1,122}, {2,3,122}, {0,3,38}, {0,3,42}, {0,3,44}, {0,3,59}, {0,3,88}, {0,3,90}, {75,0,0}, {76,2,0} },
+    /*  31 */ { {7,1,32}, {8,1,32}, {9,1,32}, {10,1,32}, {11,1,32}, {12,1,32}, {13,1,32}, {14,3,32}, {7,1,37}, {8,1,37}, {9,1,37}, {10,1,37}, {11,1,37}, {12,1,37}, {13,1,37}, {14,3,37} },
+    /*  32 */ { {7,1,45}, {8,1,45}, {9,1,45}, {10,1,45}, {11,1,45}, {12,1,45}, {13,1,45}, {14,3,45}, {7,1,46}, {8,1,46}, {9,1,46}, {10,1,46}, {11,1,46}, {12,1,46}, {13,1,46}, {14,3,46} },
+    /*  33 */ { {7,1,47}, {8,1,47}, {9,1,47}, {10,1,47}, {11,1,47}, {12,1,47}, {13,1,47}, {14,3,47}, {7,1,51}, {8,1,51}, {9,1,51}, {10,1,51}, {11,1,51}, {12,1,51}, {13,1,51}, {14,3,51} },
+    /*  34 */ { {7,1,52}, {8,1,52}, {9,1,52}, {10,1,52}, {11,1,52}, {12,1,52}, {13,1,52}, {14,3,52}, {7,1,53}, {8,1,53}, {9,1,53}, {10,1,53}, {11,1,53}, {12,1,53}, {13,1,53}, {14,3,53} },
+    /*  35 */ { {7,1,54}, {8,1,54}, {9,1,54}, {10,1,54}, {11,1,54}, {12,1,54}, {13,1,54}, {14,3,54}, {7,1,55}, {8,1,55}, {9,1,55}, {10,1,55}, {11,1,55}, {12,1,55}, {13,1,55}, {14,3,55} },
+    /*  36 */ { {7,1,56}, {8,1,56}, {9,1,56}, {10,1,56}, {11,1,56}, {12,1,56}, {13,1,56}, {14,3,56}, {7,1,57}, {8,1,57}, {9,1,57}, {10,1,57}, {11,1,57}, {12,1,57}, {13,1,57}, {14,3,57} },
+    /*  37 */ { {7,1,61}, {8,1,61}, {9,1,61}, {10,1,61}, {11,1,61}, {12,1,61}, {13,1,61}, {14,3,61}, {7,1,65}, {8,1,65}, {9,1,65}, {10,1,65}, {11,1,65}, {12,1,65}, {13,1,65}, {14,3,65} },
+    /*  38 */ { {7,1,95}, {8,1,95}, {9,1,95}, {10,1,95}, {11,1,95}, {12,1,95}, {13,1,95}, {14,3,95}, {7,1,98}, {8,1,98}, {9,1,98}, {10,1,98}, {11,1,98}, {12,1,98}, {13,1,98}, {14,3,98} },
+    /*  39 */ { {7,1,100}, {8,1,100}, {9,1,100}, {10,1,100}, {11,1,100}, {12,1,100}, {13,1,100}, {14,3,100}, {7,1,102}, {8,1,102}, {9,1,102}, {10,1,102}, {11,1,102}, {12,1,102}, {13,1,102}, {14,3,102} },
+    /*  40 */ { {7,1,103}, {8,1,103}, {9,1,103}, {10,1,103}, {11,1,103}, {12,1,103}, {13,1,103}, {14,3,103}, {7,1,104}, {8,1,104}, {9,1,104}, {10,1,104}, {11,1,104}, {12,1,104}, {13,1,104}, {14,3,104} },
+    /*  41 */ { {7,1,108}, {8,1,108}, {9,1,108}, {10,1,108}, {11,1,108}, {12,1,108}, {13,1,108}, {14,3,108}, {7,1,109}, {8,1,109}, {9,1,109}, {10,1,109}, {11,1,109}, {12,1,109}, {13,1,109}, {14,3,109} },
+    /*  42 */ { {7,1,110}, {8,1,110}, {9,1,110}, {10,1,110}, {11,1,110}, {12,1,110}, {13,1,110}, {14,3,110}, {7,1,112}, {8,1,112}, {9,1,112}, {10,1,112}, {11,1,112}, {12,1,112}, {13,1,112}, {14,3,112} },
+    /*  43 */ { {7,1,114}, {8,1,114}, {9,1,114}, {10,1,114}, {11,1,114}, {12,1,114}, {13,1,114}, {14,3,114}, {7,1,117}, {8,1,117}, {9,1,117}, {10,1,117}, {11,1,117}, {12,1,117}, {13,1,117}, {14,3,117} },
+    /*  44 */ { {3,1,58}, {4,1,58}, {5,1,58}, {6,3,58}, {3,1,66}, {4,1,66}, {5,1,66}, {6,3,66}, {3,1,67}, {4,1,67}, {5,1,67}, {6,3,67}, {3,1,68}, {4,1,68}, {5,1,68}, {6,3,68} },
+    /*  45 */ { {3,1,69}, {4,1,69}, {5,1,69}, {6,3,69}, {3,1,70}, {4,1,70}, {5,1,70}, {6,3,70}, {3,1,71}, {4,1,71}, {5,1,71}, {6,3,71}, {3,1,72}, {4,1,72}, {5,1,72}, {6,3,72} },
+    /*  46 */ { {3,1,73}, {4,1,73}, {5,1,73}, {6,3,73}, {3,1,74}, {4,1,74}, {5,1,74}, {6,3,74}, {3,1,75}, {4,1,75}, {5,1,75}, {6,3,75}, {3,1,76}, {4,1,76}, {5,1,76}, {6,3,76} },
+    /*  47 */ { {3,1,77}, {4,1,77}, {5,1,77}, {6,3,77}, {3,1,78}, {4,1,78}, {5,1,78}, {6,3,78}, {3,1,79}, {4,1,79}, {5,1,79}, {6,3,79}, {3,1,80}, {4,1,80}, {5,1,80}, {6,3,80} },
+    /*  48 */ { {3,1,81}, {4,1,81}, {5,1,81}, {6,3,81}, {3,1,82}, {4,1,82}, {5,1,82}, {6,3,82}, {3,1,83}, {4,1,83}, {5,1,83}, {6,3,83}, {3,1,84}, {4,1,84}, {5,1,84}, {6,3,84} },
+    /*  49 */ { {3,1,85}, {4,1,85}, {5,1,85}, {6,3,85}, {3,1,86}, {4,1,86}, {5,1,86}, {6,3,86}, {3,1,87}, {4,1,87}, {5,1,87}, {6,3,87}, {3,1,89}, {4,1,89}, {5,1,89}, {6,3,89} },
+    /*  50 */ { {3,1,106}, {4,1,106}, {5,1,106}, {6,3,106}, {3,1,107}, {4,1,107}, {5,1,107}, {6,3,107}, {3,1,113}, {4,1,113}, {5,1,113}, {6,3,113}, {3,1,118}, {4,1,118}, {5,1,118}, {6,3,118} },
+    /*  51 */ { {3,1,119}, {4,1,119}, {5,1,119}, {6,3,119}, {3,1,120}, {4,1,120}, {5,1,120}, {6,3,120}, {3,1,121}, {4,1,121}, {5,1,121}, {6,3,121}, {3,1,122}, {4,1,122}, {5,1,122}, {6,3,122} },
+    /*  52 */ { {1,1,38}, {2,3,38}, {1,1,42}, {2,3,42}, {1,1,44}, {2,3,44}, {1,1,59}, {2,3,59}, {1,1,88}, {2,3,88}, {1,1,90}, {2,3,90}, {77,0,0}, {78,0,0}, {79,0,0}, {80,2,0} },
+    /*  53 */ { {7,1,58}, {8,1,58}, {9,1,58}, {10,1,58}, {11,1,58}, {12,1,58}, {13,1,58}, {14,3,58}, {7,1,66}, {8,1,66}, {9,1,66}, {10,1,66}, {11,1,66}, {12,1,66}, {13,1,66}, {14,3,66} },
+    /*  54 */ { {7,1,67}, {8,1,67}, {9,1,67}, {10,1,67}, {11,1,67}, {12,1,67}, {13,1,67}, {14,3,67}, {7,1,68}, {8,1,68}, {9,1,68}, {10,1,68}, {11,1,68}, {12,1,68}, {13,1,68}, {14,3,68} },
+    /*  55 */ { {7,1,69}, {8,1,69}, {9,1,69}, {10,1,69}, {11,1,69}, {12,1,69}, {13,1,69}, {14,3,69}, {7,1,70}, {8,1,70}, {9,1,70}, {10,1,70}, {11,1,70}, {12,1,70}, {13,1,70}, {14,3,70} },
+    /*  56 */ { {7,1,71}, {8,1,71}, {9,1,71}, {10,1,71}, {11,1,71}, {12,1,71}, {13,1,71}, {14,3,71}, {7,1,72}, {8,1,72}, {9,1,72}, {10,1,72}, {11,1,72}, {12,1,72}, {13,1,72}, {14,3,72} },
+    /*  57 */ { {7,1,73}, {8,1,73}, {9,1,73}, {10,1,73}, {11,1,73}, {12,1,73}, {13,1,73}, {14,3,73}, {7,1,74}, {8,1,74}, {9,1,74}, {10,1,74}, {11,1,74}, {12,1,74}, {13,1,74}, {14,3,74} },
+    /*  58 */ { {7,1,75}, {8,1,75}, {9,1,75}, {10,1,75}, {11,1,75}, {12,1,75}, {13,1,75}, {14,3,75}, {7,1,76}, {8,1,76}, {9,1,76}, {10,1,76}, {11,1,76}, {12,1,76}, {13,1,76}, {14,3,76} },
+    /*  59 */ { {7,1,77}, {8,1,77}, {9,1,77}, {10,1,77}, {11,1,77}, {12,1,77}, {13,1,77}, {14,3,77}, {7,1,78}, {8,1,78}, {9,1,78}, {10,1,78}, {11,1,78}, {12,1,78}, {13,1,78}, {14,3,78} },
+    /*  60 */ { {7,1,79}, {8,1,79}, {9,1,79}, {10,1,79}, {11,1,79}, {12,1,79}, {13,1,79}, {14,3,79}, {7,1,80}, {8,1,80}, {9,1,80}, {10,1,80}, {11,1,80}, {12,1,80}, {13,1,80}, {14,3,80} },
+    /*  61 */ { {7,1,81}, {8,1,81}, {9,1,81}, {10,1,81}, {11,1,81}, {12,1,81}, {13,1,81}, {14,3,81}, {7,1,82}, {8,1,82}, {9,1,82}, {10,1,82}, {11,1,82}, {12,1,82}, {13,1,82}, {14,3,82} },
+    /*  62 */ { {7,1,83}, {8,1,83}, {9,1,83}, {10,1,83}, {11,1,83}, {12,1,83}, {13,1,83}, {14,3,83}, {7,1,84}, {8,1,84}, {9,1,84}, {10,1,84}, {11,1,84}, {12,1,84}, {13,1,84}, {14,3,84} },
+    /*  63 */ { {7,1,85}, {8,1,85}, {9,1,85}, {10,1,85}, {11,1,85}, {12,1,85}, {13,1,85}, {14,3,85}, {7,1,86}, {8,1,86}, {9,1,86}, {10,1,86}, {11,1,86}, {12,1,86}, {13,1,86}, {14,3,86} },
+    /*  64 */ { {7,1,87}, {8,1,87}, {9,1,87}, {10,1,87}, {11,1,87}, {12,1,87}, {13,1,87}, {14,3,87}, {7,1,89}, {8,1,89}, {9,1,89}, {10,1,89}, {11,1,89}, {12,1,89}, {13,1,89}, {14,3,89} },
+    /*  65 */ { {7,1,106}, {8,1,106}, {9,1,106}, {10,1,106}, {11,1,106}, {12,1,106}, {13,1,106}, {14,3,106}, {7,1,107}, {8,1,107}, {9,1,107}, {10,1,107}, {11,1,107}, {12,1,107}, {13,1,107}, {14,3,107} },
+    /*  66 */ { {7,1,113}, {8,1,113}, {9,1,113}, {10,1,113}, {11,1,113}, {12,1,113}, {13,1,113}, {14,3,113}, {7,1,118}, {8,1,118}, {9,1,118}, {10,1,118}, {11,1,118}, {12,1,118}, {13,1,118}, {14,3,118} },
+    /*  67 */ { {7,1,119}, {8,1,119}, {9,1,119}, {10,1,119}, {11,1,119}, {12,1,119}, {13,1,119}, {14,3,119}, {7,1,120}, {8,1,120}, {9,1,120}, {10,1,120}, {11,1,120}, {12,1,120}, {13,1,120}, {14,3,120} },
+    /*  68 */ { {7,1,121}, {8,1,121}, {9,1,121}, {10,1,121}, {11,1,121}, {12,1,121}, {13,1,121}, {14,3,121}, {7,1,122}, {8,1,122}, {9,1,122}, {10,1,122}, {11,1,122}, {12,1,122}, {13,1,122}, {14,3,122} },
+    /*  69 */ { {3,1,38}, {4,1,38}, {5,1,38}, {6,3,38}, {3,1,42}, {4,1,42}, {5,1,42}, {6,3,42}, {3,1,44}, {4,1,44}, {5,1,44}, {6,3,44}, {3,1,59}, {4,1,59}, {5,1,59}, {6,3,59} },
+    /*  70 */ { {3,1,88}, {4,1,88}, {5,1,88}, {6,3,88}, {3,1,90}, {4,1,90}, {5,1,90}, {6,3,90}, {0,3,33}, {0,3,34}, {0,3,40}, {0,3,41}, {0,3,63}, {81,0,0}, {82,0,0}, {83,2,0} },
+    /*  71 */ { {7,1,38}, {8,1,38}, {9,1,38}, {10,1,38}, {11,1,38}, {12,1,38}, {13,1,38}, {14,3,38}, {7,1,42}, {8,1,42}, {9,1,42}, {10,1,42}, {11,1,42}, {12,1,42}, {13,1,42}, {14,3,42} },
+    /*  72 */ { {7,1,44}, {8,1,44}, {9,1,44}, {10,1,44}, {11,1,44}, {12,1,44}, {13,1,44}, {14,3,44}, {7,1,59}, {8,1,59}, {9,1,59}, {10,1,59}, {11,1,59}, {12,1,59}, {13,1,59}, {14,3,59} },
+    /*  73 */ { {7,1,88}, {8,1,88}, {9,1,88}, {10,1,88}, {11,1,88}, {12,1,88}, {13,1,88}, {14,3,88}, {7,1,90}, {8,1,90}, {9,1,90}, {10,1,90}, {11,1,90}, {12,1,90}, {13,1,90}, {14,3,90} },
+    /*  74 */ { {1,1,33}, {2,3,33}, {1,1,34}, {2,3,34}, {1,1,40}, {2,3,40}, {1,1,41}, {2,3,41}, {1,1,63}, {2,3,63}, {0,3,39}, {0,3,43}, {0,3,124}, {84,0,0}, {85,0,0}, {86,2,0} },
+    /*  75 */ { {3,1,33}, {4,1,33}, {5,1,33}, {6,3,33}, {3,1,34}, {4,1,34}, {5,1,34}, {6,3,34}, {3,1,40}, {4,1,40}, {5,1,40}, {6,3,40}, {3,1,41}, {4,1,41}, {5,1,41}, {6,3,41} },
+    /*  76 */ { {3,1,63}, {4,1,63}, {5,1,63}, {6,3,63}, {1,1,39}, {2,3,39}, {1,1,43}, {2,3,43}, {1,1,124}, {2,3,124}, {0,3,35}, {0,3,62}, {87,0,0}, {88,0,0}, {89,0,0}, {90,2,0} },
+    /*  77 */ { {7,1,33}, {8,1,33}, {9,1,33}, {10,1,33}, {11,1,33}, {12,1,33}, {13,1,33}, {14,3,33}, {7,1,34}, {8,1,34}, {9,1,34}, {10,1,34}, {11,1,34}, {12,1,34}, {13,1,34}, {14,3,34} },
+    /*  78 */ { {7,1,40}, {8,1,40}, {9,1,40}, {10,1,40}, {11,1,40}, {12,1,40}, {13,1,40}, {14,3,40}, {7,1,41}, {8,1,41}, {9,1,41}, {10,1,41}, {11,1,41}, {12,1,41}, {13,1,41}, {14,3,41} },
+    /*  79 */ { {7,1,63}, {8,1,63}, {9,1,63}, {10,1,63}, {11,1,63}, {12,1,63}, {13,1,63}, {14,3,63}, {3,1,39}, {4,1,39}, {5,1,39}, {6,3,39}, {3,1,43}, {4,1,43}, {5,1,43}, {6,3,43} },
+    /*  80 */ { {3,1,124}, {4,1,124}, {5,1,124}, {6,3,124}, {1,1,35}, {2,3,35}, {1,1,62}, {2,3,62}, {0,3,0}, {0,3,36}, {0,3,64}, {0,3,91}, {0,3,93}, {0,3,126}, {91,0,0}, {92,2,0} },
+    /*  81 */ { {7,1,39}, {8,1,39}, {9,1,39}, {10,1,39}, {11,1,39}, {12,1,39}, {13,1,39}, {14,3,39}, {7,1,43}, {8,1,43}, {9,1,43}, {10,1,43}, {11,1,43}, {12,1,43}, {13,1,43}, {14,3,43} },
+    /*  82 */ { {7,1,124}, {8,1,124}, {9,1,124}, {10,1,124}, {11,1,124}, {12,1,124}, {13,1,124}, {14,3,124}, {3,1,35}, {4,1,35}, {5,1,35}, {6,3,35}, {3,1,62}, {4,1,62}, {5,1,62}, {6,3,62} },
+    /*  83 */ { {1,1,0}, {2,3,0}, {1,1,36}, {2,3,36}, {1,1,64}, {2,3,64}, {1,1,91}, {2,3,91}, {1,1,93}, {2,3,93}, {1,1,126}, {2,3,126}, {0,3,94}, {0,3,125}, {93,0,0}, {94,2,0} },
+    /*  84 */ { {7,1,35}, {8,1,35}, {9,1,35}, {10,1,35}, {11,1,35}, {12,1,35}, {13,1,35}, {14,3,35}, {7,1,62}, {8,1,62}, {9,1,62}, {10,1,62}, {11,1,62}, {12,1,62}, {13,1,62}, {14,3,62} },
+    /*  85 */ { {3,1,0}, {4,1,0}, {5,1,0}, {6,3,0}, {3,1,36}, {4,1,36}, {5,1,36}, {6,3,36}, {3,1,64}, {4,1,64}, {5,1,64}, {6,3,64}, {3,1,91}, {4,1,91}, {5,1,91}, {6,3,91} },
+    /*  86 */ { {3,1,93}, {4,1,93}, {5,1,93}, {6,3,93}, {3,1,126}, {4,1,126}, {5,1,126}, {6,3,126}, {1,1,94}, {2,3,94}, {1,1,125}, {2,3,125}, {0,3,60}, {0,3,96}, {0,3,123}, {95,2,0} },
+    /*  87 */ { {7,1,0}, {8,1,0}, {9,1,0}, {10,1,0}, {11,1,0}, {12,1,0}, {13,1,0}, {14,3,0}, {7,1,36}, {8,1,36}, {9,1,36}, {10,1,36}, {11,1,36}, {12,1,36}, {13,1,36}, {14,3,36} },
+    /*  88 */ { {7,1,64}, {8,1,64}, {9,1,64}, {10,1,64}, {11,1,64}, {12,1,64}, {13,1,64}, {14,3,64}, {7,1,91}, {8,1,91}, {9,1,91}, {10,1,91}, {11,1,91}, {12,1,91}, {13,1,91}, {14,3,91} },
+    /*  89 */ { {7,1,93}, {8,1,93}, {9,1,93}, {10,1,93}, {11,1,93}, {12,1,93}, {13,1,93}, {14,3,93}, {7,1,126}, {8,1,126}, {9,1,126}, {10,1,126}, {11,1,126}, {12,1,126}, {13,1,126}, {14,3,126} },
+    /*  90 */ { {3,1,94}, {4,1,94}, {5,1,94}, {6,3,94}, {3,1,125}, {4,1,125}, {5,1,125}, {6,3,125}, {1,1,60}, {2,3,60}, {1,1,96}, {2,3,96}, {1,1,123}, {2,3,123}, {96,0,0}, {97,2,0} },
+    /*  91 */ { {7,1,94}, {8,1,94}, {9,1,94}, {10,1,94}, {11,1,94}, {12,1,94}, {13,1,94}, {14,3,94}, {7,1,125}, {8,1,125}, {9,1,125}, {10,1,125}, {11,1,125}, {12,1,125}, {13,1,125}, {14,3,125} },
+    /*  92 */ { {3,1,60}, {4,1,60}, {5,1,60}, {6,3,60}, {3,1,96}, {4,1,96}, {5,1,96}, {6,3,96}, {3,1,123}, {4,1,123}, {5,1,123}, {6,3,123}, {98,0,0}, {99,0,0}, {100,0,0}, {101,2,0} },
+    /*  93 */ { {7,1,60}, {8,1,60}, {9,1,60}, {10,1,60}, {11,1,60}, {12,1,60}, {13,1,60}, {14,3,60}, {7,1,96}, {8,1,96}, {9,1,96}, {10,1,96}, {11,1,96}, {12,1,96}, {13,1,96}, {14,3,96} },
+    /*  94 */ { {7,1,123}, {8,1,123}, {9,1,123}, {10,1,123}, {11,1,123}, {12,1,123}, {13,1,123}, {14,3,123}, {102,0,0}, {103,0,0}, {104,0,0}, {105,0,0}, {106,0,0}, {107,0,0}, {108,0,0}, {109,2,0} },
+    /*  95 */ { {0,3,92}, {0,3,195}, {0,3,208}, {110,0,0}, {111,0,0}, {112,0,0}, {113,0,0}, {114,0,0}, {115,0,0}, {116,0,0}, {117,0,0}, {118,0,0}, {119,0,0}, {120,0,0}, {121,0,0}, {122,2,0} },
+    /*  96 */ { {1,1,92}, {2,3,92}, {1,1,195}, {2,3,195}, {1,1,208}, {2,3,208}, {0,3,128}, {0,3,130}, {0,3,131}, {0,3,162}, {0,3,184}, {0,3,194}, {0,3,224}, {0,3,226}, {123,0,0}, {124,0,0} },
+    /*  97 */ { {125,0,0}, {126,0,0}, {127,0,0}, {128,0,0}, {129,0,0}, {130,0,0}, {131,0,0}, {132,0,0}, {133,0,0}, {134,0,0}, {135,0,0}, {136,0,0}, {137,0,0}, {138,0,0}, {139,0,0}, {140,2,0} },
+    /*  98 */ { {3,1,92}, {4,1,92}, {5,1,92}, {6,3,92}, {3,1,195}, {4,1,195}, {5,1,195}, {6,3,195}, {3,1,208}, {4,1,208}, {5,1,208}, {6,3,208}, {1,1,128}, {2,3,128}, {1,1,130}, {2,3,130} },
+    /*  99 */ { {1,1,131}, {2,3,131}, {1,1,162}, {2,3,162}, {1,1,184}, {2,3,184}, {1,1,194}, {2,3,194}, {1,1,224}, {2,3,224}, {1,1,226}, {2,3,226}, {0,3,153}, {0,3,161}, {0,3,167}, {0,3,172} },
+    /* 100 */ { {0,3,176}, {0,3,177}, {0,3,179}, {0,3,209}, {0,3,216}, {0,3,217}, {0,3,227}, {0,3,229}, {0,3,230}, {141,0,0}, {142,0,0}, {143,0,0}, {144,0,0}, {145,0,0}, {146,0,0}, {147,0,0} },
+    /* 101 */ { {148,0,0}, {149,0,0}, {150,0,0}, {151,0,0}, {152,0,0}, {153,0,0}, {154,0,0}, {155,0,0}, {156,0,0}, {157,0,0}, {158,0,0}, {159,0,0}, {160,0,0}, {161,0,0}, {162,0,0}, {163,2,0} },
+    /* 102 */ { {7,1,92}, {8,1,92}, {9,1,92}, {10,1,92}, {11,1,92}, {12,1,92}, {13,1,92}, {14,3,92}, {7,1,195}, {8,1,195}, {9,1,195}, {10,1,195}, {11,1,195}, {12,1,195}, {13,1,195}, {14,3,195} },
+    /* 103 */ { {7,1,208}, {8,1,208}, {9,1,208}, {10,1,208}, {11,1,208}, {12,1,208}, {13,1,208}, {14,3,208}, {3,1,128}, {4,1,128}, {5,1,128}, {6,3,128}, {3,1,130}, {4,1,130}, {5,1,130}, {6,3,130} },
+    /* 104 */ { {3,1,131}, {4,1,131}, {5,1,131}, {6,3,131}, {3,1,162}, {4,1,162}, {5,1,162}, {6,3,162}, {3,1,184}, {4,1,184}, {5,1,184}, {6,3,184}, {3,1,194}, {4,1,194}, {5,1,194}, {6,3,194} },
+    /* 105 */ { {3,1,224}, {4,1,224}, {5,1,224}, {6,3,224}, {3,1,226}, {4,1,226}, {5,1,226}, {6,3,226}, {1,1,153}, {2,3,153}, {1,1,161}, {2,3,161}, {1,1,167}, {2,3,167}, {1,1,172}, {2,3,172} },
+    /* 106 */ { {1,1,176}, {2,3,176}, {1,1,177}, {2,3,177}, {1,1,179}, {2,3,179}, {1,1,209}, {2,3,209}, {1,1,216}, {2,3,216}, {1,1,217}, {2,3,217}, {1,1,227}, {2,3,227}, {1,1,229}, {2,3,229} },
+    /* 107 */ { {1,1,230}, {2,3,230}, {0,3,129}, {0,3,132}, {0,3,133}, {0,3,134}, {0,3,136}, {0,3,146}, {0,3,154}, {0,3,156}, {0,3,160}, {0,3,163}, {0,3,164}, {0,3,169}, {0,3,170}, {0,3,173} },
+    /* 108 */ { {0,3,178}, {0,3,181}, {0,3,185}, {0,3,186}, {0,3,187}, {0,3,189}, {0,3,190}, {0,3,196}, {0,3,198}, {0,3,228}, {0,3,232}, {0,3,233}, {164,0,0}, {165,0,0}, {166,0,0}, {167,0,0} },
+    /* 109 */ { {168,0,0}, {169,0,0}, {170,0,0}, {171,0,0}, {172,0,0}, {173,0,0}, {174,0,0}, {175,0,0}, {176,0,0}, {177,0,0}, {178,0,0}, {179,0,0}, {180,0,0}, {181,0,0}, {182,0,0}, {183,2,0} },
+    /* 110 */ { {7,1,128}, {8,1,128}, {9,1,128}, {10,1,128}, {11,1,128}, {12,1,128}, {13,1,128}, {14,3,128}, {7,1,130}, {8,1,130}, {9,1,130}, {10,1,130}, {11,1,130}, {12,1,130}, {13,1,130}, {14,3,130} },
+    /* 111 */ { {7,1,131}, {8,1,131}, {9,1,131}, {10,1,131}, {11,1,131}, {12,1,131}, {13,1,131}, {14,3,131}, {7,1,162}, {8,1,162}, {9,1,162}, {10,1,162}, {11,1,162}, {12,1,162}, {13,1,162}, {14,3,162} },
+    /* 112 */ { {7,1,184}, {8,1,184}, {9,1,184}, {10,1,184}, {11,1,184}, {12,1,184}, {13,1,184}, {14,3,184}, {7,1,194}, {8,1,194}, {9,1,194}, {10,1,194}, {11,1,194}, {12,1,194}, {13,1,194}, {14,3,194} },
+    /* 113 */ { {7,1,224}, {8,1,224}, {9,1,224}, {10,1,224}, {11,1,224}, {12,1,224}, {13,1,224}, {14,3,224}, {7,1,226}, {8,1,226}, {9,1,226}, {10,1,226}, {11,1,226}, {12,1,226}, {13,1,226}, {14,3,226} },
+    /* 114 */ { {3,1,153}, {4,1,153}, {5,1,153}, {6,3,153}, {3,1,161}, {4,1,161}, {5,1,161}, {6,3,161}, {3,1,167}, {4,1,167}, {5,1,167}, {6,3,167}, {3,1,172}, {4,1,172}, {5,1,172}, {6,3,172} },
+    /* 115 */ { {3,1,176}, {4,1,176}, {5,1,176}, {6,3,176}, {3,1,177}, {4,1,177}, {5,1,177}, {6,3,177}, {3,1,179}, {4,1,179}, {5,1,179}, {6,3,179}, {3,1,209}, {4,1,209}, {5,1,209}, {6,3,209} },
+    /* 116 */ { {3,1,216}, {4,1,216}, {5,1,216}, {6,3,216}, {3,1,217}, {4,1,217}, {5,1,217}, {6,3,217}, {3,1,227}, {4,1,227}, {5,1,227}, {6,3,227}, {3,1,229}, {4,1,229}, {5,1,229}, {6,3,229} },
+    /* 117 */ { {3,1,230}, {4,1,230}, {5,1,230}, {6,3,230}, {1,1,129}, {2,3,129}, {1,1,132}, {2,3,132}, {1,1,133}, {2,3,133}, {1,1,134}, {2,3,134}, {1,1,136}, {2,3,136}, {1,1,146}, {2,3,146} },
+    /* 118 */ { {1,1,154}, {2,3,154}, {1,1,156}, {2,3,156}, {1,1,160}, {2,3,160}, {1,1,163}, {2,3,163}, {1,1,164}, {2,3,164}, {1,1,169}, {2,3,169}, {1,1,170}, {2,3,170}, {1,1,173}, {2,3,173} },
+    /* 119 */ { {1,1,178}, {2,3,178}, {1,1,181}, {2,3,181}, {1,1,185}, {2,3,185}, {1,1,186}, {2,3,186}, {1,1,187}, {2,3,187}, {1,1,189}, {2,3,189}, {1,1,190}, {2,3,190}, {1,1,196}, {2,3,196} },
+    /* 120 */ { {1,1,198}, {2,3,198}, {1,1,228}, {2,3,228}, {1,1,232}, {2,3,232}, {1,1,233}, {2,3,233}, {0,3,1}, {0,3,135}, {0,3,137}, {0,3,138}, {0,3,139}, {0,3,140}, {0,3,141}, {0,3,143} },
+    /* 121 */ { {0,3,147}, {0,3,149}, {0,3,150}, {0,3,151}, {0,3,152}, {0,3,155}, {0,3,157}, {0,3,158}, {0,3,165}, {0,3,166}, {0,3,168}, {0,3,174}, {0,3,175}, {0,3,180}, {0,3,182}, {0,3,183} },
+    /* 122 */ { {0,3,188}, {0,3,191}, {0,3,197}, {0,3,231}, {0,3,239}, {184,0,0}, {185,0,0}, {186,0,0}, {187,0,0}, {188,0,0}, {189,0,0}, {190,0,0}, {191,0,0}, {192,0,0}, {193,0,0}, {194,2,0} },
+    /* 123 */ { {7,1,153}, {8,1,153}, {9,1,153}, {10,1,153}, {11,1,153}, {12,1,153}, {13,1,153}, {14,3,153}, {7,1,161}, {8,1,161}, {9,1,161}, {10,1,161}, {11,1,161}, {12,1,161}, {13,1,161}, {14,3,161} },
+    /* 124 */ { {7,1,167}, {8,1,167}, {9,1,167}, {10,1,167}, {11,1,167}, {12,1,167}, {13,1,167}, {14,3,167}, {7,1,172}, {8,1,172}, {9,1,172}, {10,1,172}, {11,1,172}, {12,1,172}, {13,1,172}, {14,3,172} },
+    /* 125 */ { {7,1,176}, {8,1,176}, {9,1,176}, {10,1,176}, {11,1,176}, {12,1,176}, {13,1,176}, {14,3,176}, {7,1,177}, {8,1,177}, {9,1,177}, {10,1,177}, {11,1,177}, {12,1,177}, {13,1,177}, {14,3,177} },
+    /* 126 */ { {7,1,179}, {8,1,179}, {9,1,179}, {10,1,179}, {11,1,179}, {12,1,179}, {13,1,179}, {14,3,179}, {7,1,209}, {8,1,209}, {9,1,209}, {10,1,209}, {11,1,209}, {12,1,209}, {13,1,209}, {14,3,209} },
+    /* 127 */ { {7,1,216}, {8,1,216}, {9,1,216}, {10,1,216}, {11,1,216}, {12,1,216}, {13,1,216}, {14,3,216}, {7,1,217}, {8,1,217}, {9,1,217}, {10,1,217}, {11,1,217}, {12,1,217}, {13,1,217}, {14,3,217} },
+    /* 128 */ { {7,1,227}, {8,1,227}, {9,1,227}, {10,1,227}, {11,1,227}, {12,1,227}, {13,1,227}, {14,3,227}, {7,1,229}, {8,1,229}, {9,1,229}, {10,1,229}, {11,1,229}, {12,1,229}, {13,1,229}, {14,3,229} },
+    /* 129 */ { {7,1,230}, {8,1,230}, {9,1,230}, {10,1,230}, {11,1,230}, {12,1,230}, {13,1,230}, {14,3,230}, {3,1,129}, {4,1,129}, {5,1,129}, {6,3,129}, {3,1,132}, {4,1,132}, {5,1,132}, {6,3,132} },
+    /* 130 */ { {3,1,133}, {4,1,133}, {5,1,133}, {6,3,133}, {3,1,134}, {4,1,134}, {5,1,134}, {6,3,134}, {3,1,136}, {4,1,136}, {5,1,136}, {6,3,136}, {3,1,146}, {4,1,146}, {5,1,146}, {6,3,146} },
+    /* 131 */ { {3,1,154}, {4,1,154}, {5,1,154}, {6,3,154}, {3,1,156}, {4,1,156}, {5,1,156}, {6,3,156}, {3,1,160}, {4,1,160}, {5,1,160}, {6,3,160}, {3,1,163}, {4,1,163}, {5,1,163}, {6,3,163} },
+    /* 132 */ { {3,1,164}, {4,1,164}, {5,1,164}, {6,3,164}, {3,1,169}, {4,1,169}, {5,1,169}, {6,3,169}, {3,1,170}, {4,1,170}, {5,1,170}, {6,3,170}, {3,1,173}, {4,1,173}, {5,1,173}, {6,3,173} },
+    /* 133 */ { {3,1,178}, {4,1,178}, {5,1,178}, {6,3,178}, {3,1,181}, {4,1,181}, {5,1,181}, {6,3,181}, {3,1,185}, {4,1,185}, {5,1,185}, {6,3,185}, {3,1,186}, {4,1,186}, {5,1,186}, {6,3,186} },
+    /* 134 */ { {3,1,187}, {4,1,187}, {5,1,187}, {6,3,187}, {3,1,189}, {4,1,189}, {5,1,189}, {6,3,189}, {3,1,190}, {4,1,190}, {5,1,190}, {6,3,190}, {3,1,196}, {4,1,196}, {5,1,196}, {6,3,196} },
+    /* 135 */ { {3,1,198}, {4,1,198}, {5,1,198}, {6,3,198}, {3,1,228}, {4,1,228}, {5,1,228}, {6,3,228}, {3,1,232}, {4,1,232}, {5,1,232}, {6,3,232}, {3,1,233}, {4,1,233}, {5,1,233}, {6,3,233} },
+    /* 136 */ { {1,1,1}, {2,3,1}, {1,1,135}, {2,3,135}, {1,1,137}, {2,3,137}, {1,1,138}, {2,3,138}, {1,1,139}, {2,3,139}, {1,1,140}, {2,3,140}, {1,1,141}, {2,3,141}, {1,1,143}, {2,3,143} },
+    /* 137 */ { {1,1,147}, {2,3,147}, {1,1,149}, {2,3,149}, {1,1,150}, {2,3,150}, {1,1,151}, {2,3,151}, {1,1,152}, {2,3,152}, {1,1,155}, {2,3,155}, {1,1,157}, {2,3,157}, {1,1,158}, {2,3,158} },
+    /* 138 */ { {1,1,165}, {2,3,165}, {1,1,166}, {2,3,166}, {1,1,168}, {2,3,168}, {1,1,174}, {2,3,174}, {1,1,175}, {2,3,175}, {1,1,180}, {2,3,180}, {1,1,182}, {2,3,182}, {1,1,183}, {2,3,183} },
+    /* 139 */ { {1,1,188}, {2,3,188}, {1,1,191}, {2,3,191}, {1,1,197}, {2,3,197}, {1,1,231}, {2,3,231}, {1,1,239}, {2,3,239}, {0,3,9}, {0,3,142}, {0,3,144}, {0,3,145}, {0,3,148}, {0,3,159} },
+    /* 140 */ { {0,3,171}, {0,3,206}, {0,3,215}, {0,3,225}, {0,3,236}, {0,3,237}, {195,0,0}, {196,0,0}, {197,0,0}, {198,0,0}, {199,0,0}, {200,0,0}, {201,0,0}, {202,0,0}, {203,0,0}, {204,2,0} },
+    /* 141 */ { {7,1,129}, {8,1,129}, {9,1,129}, {10,1,129}, {11,1,129}, {12,1,129}, {13,1,129}, {14,3,129}, {7,1,132}, {8,1,132}, {9,1,132}, {10,1,132}, {11,1,132}, {12,1,132}, {13,1,132}, {14,3,132} },
+    /* 142 */ { {7,1,133}, {8,1,133}, {9,1,133}, {10,1,133}, {11,1,133}, {12,1,133}, {13,1,133}, {14,3,133}, {7,1,134}, {8,1,134}, {9,1,134}, {10,1,134}, {11,1,134}, {12,1,134}, {13,1,134}, {14,3,134} },
+    /* 143 */ { {7,1,136}, {8,1,136}, {9,1,136}, {10,1,136}, {11,1,136}, {12,1,136}, {13,1,136}, {14,3,136}, {7,1,146}, {8,1,146}, {9,1,146}, {10,1,146}, {11,1,146}, {12,1,146}, {13,1,146}, {14,3,146} },
+    /* 144 */ { {7,1,154}, {8,1,154}, {9,1,154}, {10,1,154}, {11,1,154}, {12,1,154}, {13,1,154}, {14,3,154}, {7,1,156}, {8,1,156}, {9,1,156}, {10,1,156}, {11,1,156}, {12,1,156}, {13,1,156}, {14,3,156} },
+    /* 145 */ { {7,1,160}, {8,1,160}, {9,1,160}, {10,1,160}, {11,1,160}, {12,1,160}, {13,1,160}, {14,3,160}, {7,1,163}, {8,1,163}, {9,1,163}, {10,1,163}, {11,1,163}, {12,1,163}, {13,1,163}, {14,3,163} },
+    /* 146 */ { {7,1,164}, {8,1,164}, {9,1,164}, {10,1,164}, {11,1,164}, {12,1,164}, {13,1,164}, {14,3,164}, {7,1,169}, {8,1,169}, {9,1,169}, {10,1,169}, {11,1,169}, {12,1,169}, {13,1,169}, {14,3,169} },
+    /* 147 */ { {7,1,170}, {8,1,170}, {9,1,170}, {10,1,170}, {11,1,170}, {12,1,170}, {13,1,170}, {14,3,170}, {7,1,173}, {8,1,173}, {9,1,173}, {10,1,173}, {11,1,173}, {12,1,173}, {13,1,173}, {14,3,173} },
+    /* 148 */ { {7,1,178}, {8,1,178}, {9,1,178}, {10,1,178}, {11,1,178}, {12,1,178}, {13,1,178}, {14,3,178}, {7,1,181}, {8,1,181}, {9,1,181}, {10,1,181}, {11,1,181}, {12,1,181}, {13,1,181}, {14,3,181} },
+    /* 149 */ { {7,1,185}, {8,1,185}, {9,1,185}, {10,1,185}, {11,1,185}, {12,1,185}, {13,1,185}, {14,3,185}, {7,1,186}, {8,1,186}, {9,1,186}, {10,1,186}, {11,1,186}, {12,1,186}, {13,1,186}, {14,3,186} },
+    /* 150 */ { {7,1,187}, {8,1,187}, {9,1,187}, {10,1,187}, {11,1,187}, {12,1,187}, {13,1,187}, {14,3,187}, {7,1,189}, {8,1,189}, {9,1,189}, {10,1,189}, {11,1,189}, {12,1,189}, {13,1,189}, {14,3,189} },
+    /* 151 */ { {7,1,190}, {8,1,190}, {9,1,190}, {10,1,190}, {11,1,190}, {12,1,190}, {13,1,190}, {14,3,190}, {7,1,196}, {8,1,196}, {9,1,196}, {10,1,196}, {11,1,196}, {12,1,196}, {13,1,196}, {14,3,196} },
+    /* 152 */ { {7,1,198}, {8,1,198}, {9,1,198}, {10,1,198}, {11,1,198}, {12,1,198}, {13,1,198}, {14,3,198}, {7,1,228}, {8,1,228}, {9,1,228}, {10,1,228}, {11,1,228}, {12,1,228}, {13,1,228}, {14,3,228} },
+    /* 153 */ { {7,1,232}, {8,1,232}, {9,1,232}, {10,1,232}, {11,1,232}, {12,1,232}, {13,1,232}, {14,3,232}, {7,1,233}, {8,1,233}, {9,1,233}, {10,1,233}, {11,1,233}, {12,1,233}, {13,1,233}, {14,3,233} },
+    /* 154 */ { {3,1,1}, {4,1,1}, {5,1,1}, {6,3,1}, {3,1,135}, {4,1,135}, {5,1,135}, {6,3,135}, {3,1,137}, {4,1,137}, {5,1,137}, {6,3,137}, {3,1,138}, {4,1,138}, {5,1,138}, {6,3,138} },
+    /* 155 */ { {3,1,139}, {4,1,139}, {5,1,139}, {6,3,139}, {3,1,140}, {4,1,140}, {5,1,140}, {6,3,140}, {3,1,141}, {4,1,141}, {5,1,141}, {6,3,141}, {3,1,143}, {4,1,143}, {5,1,143}, {6,3,143} },
+    /* 156 */ { {3,1,147}, {4,1,147}, {5,1,147}, {6,3,147}, {3,1,149}, {4,1,149}, {5,1,149}, {6,3,149}, {3,1,150}, {4,1,150}, {5,1,150}, {6,3,150}, {3,1,151}, {4,1,151}, {5,1,151}, {6,3,151} },
+    /* 157 */ { {3,1,152}, {4,1,152}, {5,1,152}, {6,3,152}, {3,1,155}, {4,1,155}, {5,1,155}, {6,3,155}, {3,1,157}, {4,1,157}, {5,1,157}, {6,3,157}, {3,1,158}, {4,1,158}, {5,1,158}, {6,3,158} },
+    /* 158 */ { {3,1,165}, {4,1,165}, {5,1,165}, {6,3,165}, {3,1,166}, {4,1,166}, {5,1,166}, {6,3,166}, {3,1,168}, {4,1,168}, {5,1,168}, {6,3,168}, {3,1,174}, {4,1,174}, {5,1,174}, {6,3,174} },
+    /* 159 */ { {3,1,175}, {4,1,175}, {5,1,175}, {6,3,175}, {3,1,180}, {4,1,180}, {5,1,180}, {6,3,180}, {3,1,182}, {4,1,182}, {5,1,182}, {6,3,182}, {3,1,183}, {4,1,183}, {5,1,183}, {6,3,183} },
+    /* 160 */ { {3,1,188}, {4,1,188}, {5,1,188}, {6,3,188}, {3,1,191}, {4,1,191}, {5,1,191}, {6,3,191}, {3,1,197}, {4,1,197}, {5,1,197}, {6,3,197}, {3,1,231}, {4,1,231}, {5,1,231}, {6,3,231} },
+    /* 161 */ { {3,1,239}, {4,1,239}, {5,1,239}, {6,3,239}, {1,1,9}, {2,3,9}, {1,1,142}, {2,3,142}, {1,1,144}, {2,3,144}, {1,1,145}, {2,3,145}, {1,1,148}, {2,3,148}, {1,1,159}, {2,3,159} },
+    /* 162 */ { {1,1,171}, {2,3,171}, {1,1,206}, {2,3,206}, {1,1,215}, {2,3,215}, {1,1,225}, {2,3,225}, {1,1,236}, {2,3,236}, {1,1,237}, {2,3,237}, {0,3,199}, {0,3,207}, {0,3,234}, {0,3,235} },
+    /* 163 */ { {205,0,0}, {206,0,0}, {207,0,0}, {208,0,0}, {209,0,0}, {210,0,0}, {211,0,0}, {212,0,0}, {213,0,0}, {214,0,0}, {215,0,0}, {216,0,0}, {217,0,0}, {218,0,0}, {219,0,0}, {220,2,0} },
+    /* 164 */ { {7,1,1}, {8,1,1}, {9,1,1}, {10,1,1}, {11,1,1}, {12,1,1}, {13,1,1}, {14,3,1}, {7,1,135}, {8,1,135}, {9,1,135}, {10,1,135}, {11,1,135}, {12,1,135}, {13,1,135}, {14,3,135} },
+    /* 165 */ { {7,1,137}, {8,1,137}, {9,1,137}, {10,1,137}, {11,1,137}, {12,1,137}, {13,1,137}, {14,3,137}, {7,1,138}, {8,1,138}, {9,1,138}, {10,1,138}, {11,1,138}, {12,1,138}, {13,1,138}, {14,3,138} },
+    /* 166 */ { {7,1,139}, {8,1,139}, {9,1,139}, {10,1,139}, {11,1,139}, {12,1,139}, {13,1,139}, {14,3,139}, {7,1,140}, {8,1,140}, {9,1,140}, {10,1,140}, {11,1,140}, {12,1,140}, {13,1,140}, {14,3,140} },
+    /* 167 */ { {7,1,141}, {8,1,141}, {9,1,141}, {10,1,141}, {11,1,141}, {12,1,141}, {13,1,141}, {14,3,141}, {7,1,143}, {8,1,143}, {9,1,143}, {10,1,143}, {11,1,143}, {12,1,143}, {13,1,143}, {14,3,143} },
+    /* 168 */ { {7,1,147}, {8,1,147}, {9,1,147}, {10,1,147}, {11,1,147}, {12,1,147}, {13,1,147}, {14,3,147}, {7,1,149}, {8,1,149}, {9,1,149}, {10,1,149}, {11,1,149}, {12,1,149}, {13,1,149}, {14,3,149} },
+    /* 169 */ { {7,1,150}, {8,1,150}, {9,1,150}, {10,1,150}, {11,1,150}, {12,1,150}, {13,1,150}, {14,3,150}, {7,1,151}, {8,1,151}, {9,1,151}, {10,1,151}, {11,1,151}, {12,1,151}, {13,1,151}, {14,3,151} },
+    /* 170 */ { {7,1,152}, {8,1,152}, {9,1,152}, {10,1,152}, {11,1,152}, {12,1,152}, {13,1,152}, {14,3,152}, {7,1,155}, {8,1,155}, {9,1,155}, {10,1,155}, {11,1,155}, {12,1,155}, {13,1,155}, {14,3,155} },
+    /* 171 */ { {7,1,157}, {8,1,157}, {9,1,157}, {10,1,157}, {11,1,157}, {12,1,157}, {13,1,157}, {14,3,157}, {7,1,158}, {8,1,158}, {9,1,158}, {10,1,158}, {11,1,158}, {12,1,158}, {13,1,158}, {14,3,158} },
+    /* 172 */ { {7,1,165}, {8,1,165}, {9,1,165}, {10,1,165}, {11,1,165}, {12,1,165}, {13,1,165}, {14,3,165}, {7,1,166}, {8,1,166}, {9,1,166}, {10,1,166}, {11,1,166}, {12,1,166}, {13,1,166}, {14,3,166} },
+    /* 173 */ { {7,1,168}, {8,1,168}, {9,1,168}, {10,1,168}, {11,1,168}, {12,1,168}, {13,1,168}, {14,3,168}, {7,1,174}, {8,1,174}, {9,1,174}, {10,1,174}, {11,1,174}, {12,1,174}, {13,1,174}, {14,3,174} },
+    /* 174 */ { {7,1,175}, {8,1,175}, {9,1,175}, {10,1,175}, {11,1,175}, {12,1,175}, {13,1,175}, {14,3,175}, {7,1,180}, {8,1,180}, {9,1,180}, {10,1,180}, {11,1,180}, {12,1,180}, {13,1,180}, {14,3,180} },
+    /* 175 */ { {7,1,182}, {8,1,182}, {9,1,182}, {10,1,182}, {11,1,182}, {12,1,182}, {13,1,182}, {14,3,182}, {7,1,183}, {8,1,183}, {9,1,183}, {10,1,183}, {11,1,183}, {12,1,183}, {13,1,183}, {14,3,183} },
+    /* 176 */ { {7,1,188}, {8,1,188}, {9,1,188}, {10,1,188}, {11,1,188}, {12,1,188}, {13,1,188}, {14,3,188}, {7,1,191}, {8,1,191}, {9,1,191}, {10,1,191}, {11,1,191}, {12,1,191}, {13,1,191}, {14,3,191} },
+    /* 177 */ { {7,1,197}, {8,1,197}, {9,1,197}, {10,1,197}, {11,1,197}, {12,1,197}, {13,1,197}, {14,3,197}, {7,1,231}, {8,1,231}, {9,1,231}, {10,1,231}, {11,1,231}, {12,1,231}, {13,1,231}, {14,3,231} },
+    /* 178 */ { {7,1,239}, {8,1,239}, {9,1,239}, {10,1,239}, {11,1,239}, {12,1,239}, {13,1,239}, {14,3,239}, {3,1,9}, {4,1,9}, {5,1,9}, {6,3,9}, {3,1,142}, {4,1,142}, {5,1,142}, {6,3,142} },
+    /* 179 */ { {3,1,144}, {4,1,144}, {5,1,144}, {6,3,144}, {3,1,145}, {4,1,145}, {5,1,145}, {6,3,145}, {3,1,148}, {4,1,148}, {5,1,148}, {6,3,148}, {3,1,159}, {4,1,159}, {5,1,159}, {6,3,159} },
+    /* 180 */ { {3,1,171}, {4,1,171}, {5,1,171}, {6,3,171}, {3,1,206}, {4,1,206}, {5,1,206}, {6,3,206}, {3,1,215}, {4,1,215}, {5,1,215}, {6,3,215}, {3,1,225}, {4,1,225}, {5,1,225}, {6,3,225} },
+    /* 181 */ { {3,1,236}, {4,1,236}, {5,1,236}, {6,3,236}, {3,1,237}, {4,1,237}, {5,1,237}, {6,3,237}, {1,1,199}, {2,3,199}, {1,1,207}, {2,3,207}, {1,1,234}, {2,3,234}, {1,1,235}, {2,3,235} },
+    /* 182 */ { {0,3,192}, {0,3,193}, {0,3,200}, {0,3,201}, {0,3,202}, {0,3,205}, {0,3,210}, {0,3,213}, {0,3,218}, {0,3,219}, {0,3,238}, {0,3,240}, {0,3,242}, {0,3,243}, {0,3,255}, {221,0,0} },
+    /* 183 */ { {222,0,0}, {223,0,0}, {224,0,0}, {225,0,0}, {226,0,0}, {227,0,0}, {228,0,0}, {229,0,0}, {230,0,0}, {231,0,0}, {232,0,0}, {233,0,0}, {234,0,0}, {235,0,0}, {236,0,0}, {237,2,0} },
+    /* 184 */ { {7,1,9}, {8,1,9}, {9,1,9}, {10,1,9}, {11,1,9}, {12,1,9}, {13,1,9}, {14,3,9}, {7,1,142}, {8,1,142}, {9,1,142}, {10,1,142}, {11,1,142}, {12,1,142}, {13,1,142}, {14,3,142} },
+    /* 185 */ { {7,1,144}, {8,1,144}, {9,1,144}, {10,1,144}, {11,1,144}, {12,1,144}, {13,1,144}, {14,3,144}, {7,1,145}, {8,1,145}, {9,1,145}, {10,1,145}, {11,1,145}, {12,1,145}, {13,1,145}, {14,3,145} },
+    /* 186 */ { {7,1,148}, {8,1,148}, {9,1,148}, {10,1,148}, {11,1,148}, {12,1,148}, {13,1,148}, {14,3,148}, {7,1,159}, {8,1,159}, {9,1,159}, {10,1,159}, {11,1,159}, {12,1,159}, {13,1,159}, {14,3,159} },
+    /* 187 */ { {7,1,171}, {8,1,171}, {9,1,171}, {10,1,171}, {11,1,171}, {12,1,171}, {13,1,171}, {14,3,171}, {7,1,206}, {8,1,206}, {9,1,206}, {10,1,206}, {11,1,206}, {12,1,206}, {13,1,206}, {14,3,206} },
+    /* 188 */ { {7,1,215}, {8,1,215}, {9,1,215}, {10,1,215}, {11,1,215}, {12,1,215}, {13,1,215}, {14,3,215}, {7,1,225}, {8,1,225}, {9,1,225}, {10,1,225}, {11,1,225}, {12,1,225}, {13,1,225}, {14,3,225} },
+    /* 189 */ { {7,1,236}, {8,1,236}, {9,1,236}, {10,1,236}, {11,1,236}, {12,1,236}, {13,1,236}, {14,3,236}, {7,1,237}, {8,1,237}, {9,1,237}, {10,1,237}, {11,1,237}, {12,1,237}, {13,1,237}, {14,3,237} },
+    /* 190 */ { {3,1,199}, {4,1,199}, {5,1,199}, {6,3,199}, {3,1,207}, {4,1,207}, {5,1,207}, {6,3,207}, {3,1,234}, {4,1,234}, {5,1,234}, {6,3,234}, {3,1,235}, {4,1,235}, {5,1,235}, {6,3,235} },
+    /* 191 */ { {1,1,192}, {2,3,192}, {1,1,193}, {2,3,193}, {1,1,200}, {2,3,200}, {1,1,201}, {2,3,201}, {1,1,202}, {2,3,202}, {1,1,205}, {2,3,205}, {1,1,210}, {2,3,210}, {1,1,213}, {2,3,213} },
+    /* 192 */ { {1,1,218}, {2,3,218}, {1,1,219}, {2,3,219}, {1,1,238}, {2,3,238}, {1,1,240}, {2,3,240}, {1,1,242}, {2,3,242}, {1,1,243}, {2,3,243}, {1,1,255}, {2,3,255}, {0,3,203}, {0,3,204} },
+    /* 193 */ { {0,3,211}, {0,3,212}, {0,3,214}, {0,3,221}, {0,3,222}, {0,3,223}, {0,3,241}, {0,3,244}, {0,3,245}, {0,3,246}, {0,3,247}, {0,3,248}, {0,3,250}, {0,3,251}, {0,3,252}, {0,3,253} },
+    /* 194 */ { {0,3,254}, {238,0,0}, {239,0,0}, {240,0,0}, {241,0,0}, {242,0,0}, {243,0,0}, {244,0,0}, {245,0,0}, {246,0,0}, {247,0,0}, {248,0,0}, {249,0,0}, {250,0,0}, {251,0,0}, {252,2,0} },
+    /* 195 */ { {7,1,199}, {8,1,199}, {9,1,199}, {10,1,199}, {11,1,199}, {12,1,199}, {13,1,199}, {14,3,199}, {7,1,207}, {8,1,207}, {9,1,207}, {10,1,207}, {11,1,207}, {12,1,207}, {13,1,207}, {14,3,207} },
+    /* 196 */ { {7,1,234}, {8,1,234}, {9,1,234}, {10,1,234}, {11,1,234}, {12,1,234}, {13,1,234}, {14,3,234}, {7,1,235}, {8,1,235}, {9,1,235}, {10,1,235}, {11,1,235}, {12,1,235}, {13,1,235}, {14,3,235} },
+    /* 197 */ { {3,1,192}, {4,1,192}, {5,1,192}, {6,3,192}, {3,1,193}, {4,1,193}, {5,1,193}, {6,3,193}, {3,1,200}, {4,1,200}, {5,1,200}, {6,3,200}, {3,1,201}, {4,1,201}, {5,1,201}, {6,3,201} },
+    /* 198 */ { {3,1,202}, {4,1,202}, {5,1,202}, {6,3,202}, {3,1,205}, {4,1,205}, {5,1,205}, {6,3,205}, {3,1,210}, {4,1,210}, {5,1,210}, {6,3,210}, {3,1,213}, {4,1,213}, {5,1,213}, {6,3,213} },
+    /* 199 */ { {3,1,218}, {4,1,218}, {5,1,218}, {6,3,218}, {3,1,219}, {4,1,219}, {5,1,219}, {6,3,219}, {3,1,238}, {4,1,238}, {5,1,238}, {6,3,238}, {3,1,240}, {4,1,240}, {5,1,240}, {6,3,240} },
+    /* 200 */ { {3,1,242}, {4,1,242}, {5,1,242}, {6,3,242}, {3,1,243}, {4,1,243}, {5,1,243}, {6,3,243}, {3,1,255}, {4,1,255}, {5,1,255}, {6,3,255}, {1,1,203}, {2,3,203}, {1,1,204}, {2,3,204} },
+    /* 201 */ { {1,1,211}, {2,3,211}, {1,1,212}, {2,3,212}, {1,1,214}, {2,3,214}, {1,1,221}, {2,3,221}, {1,1,222}, {2,3,222}, {1,1,223}, {2,3,223}, {1,1,241}, {2,3,241}, {1,1,244}, {2,3,244} },
+    /* 202 */ { {1,1,245}, {2,3,245}, {1,1,246}, {2,3,246}, {1,1,247}, {2,3,247}, {1,1,248}, {2,3,248}, {1,1,250}, {2,3,250}, {1,1,251}, {2,3,251}, {1,1,252}, {2,3,252}, {1,1,253}, {2,3,253} },
+    /* 203 */ { {1,1,254}, {2,3,254}, {0,3,2}, {0,3,3}, {0,3,4}, {0,3,5}, {0,3,6}, {0,3,7}, {0,3,8}, {0,3,11}, {0,3,12}, {0,3,14}, {0,3,15}, {0,3,16}, {0,3,17}, {0,3,18} },
+    /* 204 */ { {0,3,19}, {0,3,20}, {0,3,21}, {0,3,23}, {0,3,24}, {0,3,25}, {0,3,26}, {0,3,27}, {0,3,28}, {0,3,29}, {0,3,30}, {0,3,31}, {0,3,127}, {0,3,220}, {0,3,249}, {253,2,0} },
+    /* 205 */ { {7,1,192}, {8,1,192}, {9,1,192}, {10,1,192}, {11,1,192}, {12,1,192}, {13,1,192}, {14,3,192}, {7,1,193}, {8,1,193}, {9,1,193}, {10,1,193}, {11,1,193}, {12,1,193}, {13,1,193}, {14,3,193} },
+    /* 206 */ { {7,1,200}, {8,1,200}, {9,1,200}, {10,1,200}, {11,1,200}, {12,1,200}, {13,1,200}, {14,3,200}, {7,1,201}, {8,1,201}, {9,1,201}, {10,1,201}, {11,1,201}, {12,1,201}, {13,1,201}, {14,3,201} },
+    /* 207 */ { {7,1,202}, {8,1,202}, {9,1,202}, {10,1,202}, {11,1,202}, {12,1,202}, {13,1,202}, {14,3,202}, {7,1,205}, {8,1,205}, {9,1,205}, {10,1,205}, {11,1,205}, {12,1,205}, {13,1,205}, {14,3,205} },
+    /* 208 */ { {7,1,210}, {8,1,210}, {9,1,210}, {10,1,210}, {11,1,210}, {12,1,210}, {13,1,210}, {14,3,210}, {7,1,213}, {8,1,213}, {9,1,213}, {10,1,213}, {11,1,213}, {12,1,213}, {13,1,213}, {14,3,213} },
+    /* 209 */ { {7,1,218}, {8,1,218}, {9,1,218}, {10,1,218}, {11,1,218}, {12,1,218}, {13,1,218}, {14,3,218}, {7,1,219}, {8,1,219}, {9,1,219}, {10,1,219}, {11,1,219}, {12,1,219}, {13,1,219}, {14,3,219} },
+    /* 210 */ { {7,1,238}, {8,1,238}, {9,1,238}, {10,1,238}, {11,1,238}, {12,1,238}, {13,1,238}, {14,3,238}, {7,1,240}, {8,1,240}, {9,1,240}, {10,1,240}, {11,1,240}, {12,1,240}, {13,1,240}, {14,3,240} },
+    /* 211 */ { {7,1,242}, {8,1,242}, {9,1,242}, {10,1,242}, {11,1,242}, {12,1,242}, {13,1,242}, {14,3,242}, {7,1,243}, {8,1,243}, {9,1,243}, {10,1,243}, {11,1,243}, {12,1,243}, {13,1,243}, {14,3,243} },
+    /* 212 */ { {7,1,255}, {8,1,255}, {9,1,255}, {10,1,255}, {11,1,255}, {12,1,255}, {13,1,255}, {14,3,255}, {3,1,203}, {4,1,203}, {5,1,203}, {6,3,203}, {3,1,204}, {4,1,204}, {5,1,204}, {6,3,204} },
+    /* 213 */ { {3,1,211}, {4,1,211}, {5,1,211}, {6,3,211}, {3,1,212}, {4,1,212}, {5,1,212}, {6,3,212}, {3,1,214}, {4,1,214}, {5,1,214}, {6,3,214}, {3,1,221}, {4,1,221}, {5,1,221}, {6,3,221} },
+    /* 214 */ { {3,1,222}, {4,1,222}, {5,1,222}, {6,3,222}, {3,1,223}, {4,1,223}, {5,1,223}, {6,3,223}, {3,1,241}, {4,1,241}, {5,1,241}, {6,3,241}, {3,1,244}, {4,1,244}, {5,1,244}, {6,3,244} },
+    /* 215 */ { {3,1,245}, {4,1,245}, {5,1,245}, {6,3,245}, {3,1,246}, {4,1,246}, {5,1,246}, {6,3,246}, {3,1,247}, {4,1,247}, {5,1,247}, {6,3,247}, {3,1,248}, {4,1,248}, {5,1,248}, {6,3,248} },
+    /* 216 */ { {3,1,250}, {4,1,250}, {5,1,250}, {6,3,250}, {3,1,251}, {4,1,251}, {5,1,251}, {6,3,251}, {3,1,252}, {4,1,252}, {5,1,252}, {6,3,252}, {3,1,253}, {4,1,253}, {5,1,253}, {6,3,253} },
+    /* 217 */ { {3,1,254}, {4,1,254}, {5,1,254}, {6,3,254}, {1,1,2}, {2,3,2}, {1,1,3}, {2,3,3}, {1,1,4}, {2,3,4}, {1,1,5}, {2,3,5}, {1,1,6}, {2,3,6}, {1,1,7}, {2,3,7} },
+    /* 218 */ { {1,1,8}, {2,3,8}, {1,1,11}, {2,3,11}, {1,1,12}, {2,3,12}, {1,1,14}, {2,3,14}, {1,1,15}, {2,3,15}, {1,1,16}, {2,3,16}, {1,1,17}, {2,3,17}, {1,1,18}, {2,3,18} },
+    /* 219 */ { {1,1,19}, {2,3,19}, {1,1,20}, {2,3,20}, {1,1,21}, {2,3,21}, {1,1,23}, {2,3,23}, {1,1,24}, {2,3,24}, {1,1,25}, {2,3,25}, {1,1,26}, {2,3,26}, {1,1,27}, {2,3,27} },
+    /* 220 */ { {1,1,28}, {2,3,28}, {1,1,29}, {2,3,29}, {1,1,30}, {2,3,30}, {1,1,31}, {2,3,31}, {1,1,127}, {2,3,127}, {1,1,220}, {2,3,220}, {1,1,249}, {2,3,249}, {254,0,0}, {255,2,0} },
+    /* 221 */ { {7,1,203}, {8,1,203}, {9,1,203}, {10,1,203}, {11,1,203}, {12,1,203}, {13,1,203}, {14,3,203}, {7,1,204}, {8,1,204}, {9,1,204}, {10,1,204}, {11,1,204}, {12,1,204}, {13,1,204}, {14,3,204} },
+    /* 222 */ { {7,1,211}, {8,1,211}, {9,1,211}, {10,1,211}, {11,1,211}, {12,1,211}, {13,1,211}, {14,3,211}, {7,1,212}, {8,1,212}, {9,1,212}, {10,1,212}, {11,1,212}, {12,1,212}, {13,1,212}, {14,3,212} },
+    /* 223 */ { {7,1,214}, {8,1,214}, {9,1,214}, {10,1,214}, {11,1,214}, {12,1,214}, {13,1,214}, {14,3,214}, {7,1,221}, {8,1,221}, {9,1,221}, {10,1,221}, {11,1,221}, {12,1,221}, {13,1,221}, {14,3,221} },
+    /* 224 */ { {7,1,222}, {8,1,222}, {9,1,222}, {10,1,222}, {11,1,222}, {12,1,222}, {13,1,222}, {14,3,222}, {7,1,223}, {8,1,223}, {9,1,223}, {10,1,223}, {11,1,223}, {12,1,223}, {13,1,223}, {14,3,223} },
+    /* 225 */ { {7,1,241}, {8,1,241}, {9,1,241}, {10,1,241}, {11,1,241}, {12,1,241}, {13,1,241}, {14,3,241}, {7,1,244}, {8,1,244}, {9,1,244}, {10,1,244}, {11,1,244}, {12,1,244}, {13,1,244}, {14,3,244} },
+    /* 226 */ { {7,1,245}, {8,1,245}, {9,1,245}, {10,1,245}, {11,1,245}, {12,1,245}, {13,1,245}, {14,3,245}, {7,1,246}, {8,1,246}, {9,1,246}, {10,1,246}, {11,1,246}, {12,1,246}, {13,1,246}, {14,3,246} },
+    /* 227 */ { {7,1,247}, {8,1,247}, {9,1,247}, {10,1,247}, {11,1,247}, {12,1,247}, {13,1,247}, {14,3,247}, {7,1,248}, {8,1,248}, {9,1,248}, {10,1,248}, {11,1,248}, {12,1,248}, {13,1,248}, {14,3,248} },
+    /* 228 */ { {7,1,250}, {8,1,250}, {9,1,250}, {10,1,250}, {11,1,250}, {12,1,250}, {13,1,250}, {14,3,250}, {7,1,251}, {8,1,251}, {9,1,251}, {10,1,251}, {11,1,251}, {12,1,251}, {13,1,251}, {14,3,251} },
+    /* 229 */ { {7,1,252}, {8,1,252}, {9,1,252}, {10,1,252}, {11,1,252}, {12,1,252}, {13,1,252}, {14,3,252}, {7,1,253}, {8,1,253}, {9,1,253}, {10,1,253}, {11,1,253}, {12,1,253}, {13,1,253}, {14,3,253} },
+    /* 230 */ { {7,1,254}, {8,1,254}, {9,1,254}, {10,1,254}, {11,1,254}, {12,1,254}, {13,1,254}, {14,3,254}, {3,1,2}, {4,1,2}, {5,1,2}, {6,3,2}, {3,1,3}, {4,1,3}, {5,1,3}, {6,3,3} },
+    /* 231 */ { {3,1,4}, {4,1,4}, {5,1,4}, {6,3,4}, {3,1,5}, {4,1,5}, {5,1,5}, {6,3,5}, {3,1,6}, {4,1,6}, {5,1,6}, {6,3,6}, {3,1,7}, {4,1,7}, {5,1,7}, {6,3,7} },
+    /* 232 */ { {3,1,8}, {4,1,8}, {5,1,8}, {6,3,8}, {3,1,11}, {4,1,11}, {5,1,11}, {6,3,11}, {3,1,12}, {4,1,12}, {5,1,12}, {6,3,12}, {3,1,14}, {4,1,14}, {5,1,14}, {6,3,14} },
+    /* 233 */ { {3,1,15}, {4,1,15}, {5,1,15}, {6,3,15}, {3,1,16}, {4,1,16}, {5,1,16}, {6,3,16}, {3,1,17}, {4,1,17}, {5,1,17}, {6,3,17}, {3,1,18}, {4,1,18}, {5,1,18}, {6,3,18} },
+    /* 234 */ { {3,1,19}, {4,1,19}, {5,1,19}, {6,3,19}, {3,1,20}, {4,1,20}, {5,1,20}, {6,3,20}, {3,1,21}, {4,1,21}, {5,1,21}, {6,3,21}, {3,1,23}, {4,1,23}, {5,1,23}, {6,3,23} },
+    /* 235 */ { {3,1,24}, {4,1,24}, {5,1,24}, {6,3,24}, {3,1,25}, {4,1,25}, {5,1,25}, {6,3,25}, {3,1,26}, {4,1,26}, {5,1,26}, {6,3,26}, {3,1,27}, {4,1,27}, {5,1,27}, {6,3,27} },
+    /* 236 */ { {3,1,28}, {4,1,28}, {5,1,28}, {6,3,28}, {3,1,29}, {4,1,29}, {5,1,29}, {6,3,29}, {3,1,30}, {4,1,30}, {5,1,30}, {6,3,30}, {3,1,31}, {4,1,31}, {5,1,31}, {6,3,31} },
+    /* 237 */ { {3,1,127}, {4,1,127}, {5,1,127}, {6,3,127}, {3,1,220}, {4,1,220}, {5,1,220}, {6,3,220}, {3,1,249}, {4,1,249}, {5,1,249}, {6,3,249}, {0,3,10}, {0,3,13}, {0,3,22}, {0,4,0} },
+    /* 238 */ { {7,1,2}, {8,1,2}, {9,1,2}, {10,1,2}, {11,1,2}, {12,1,2}, {13,1,2}, {14,3,2}, {7,1,3}, {8,1,3}, {9,1,3}, {10,1,3}, {11,1,3}, {12,1,3}, {13,1,3}, {14,3,3} },
+    /* 239 */ { {7,1,4}, {8,1,4}, {9,1,4}, {10,1,4}, {11,1,4}, {12,1,4}, {13,1,4}, {14,3,4}, {7,1,5}, {8,1,5}, {9,1,5}, {10,1,5}, {11,1,5}, {12,1,5}, {13,1,5}, {14,3,5} },
+    /* 240 */ { {7,1,6}, {8,1,6}, {9,1,6}, {10,1,6}, {11,1,6}, {12,1,6}, {13,1,6}, {14,3,6}, {7,1,7}, {8,1,7}, {9,1,7}, {10,1,7}, {11,1,7}, {12,1,7}, {13,1,7}, {14,3,7} },
+    /* 241 */ { {7,1,8}, {8,1,8}, {9,1,8}, {10,1,8}, {11,1,8}, {12,1,8}, {13,1,8}, {14,3,8}, {7,1,11}, {8,1,11}, {9,1,11}, {10,1,11}, {11,1,11}, {12,1,11}, {13,1,11}, {14,3,11} },
+    /* 242 */ { {7,1,12}, {8,1,12}, {9,1,12}, {10,1,12}, {11,1,12}, {12,1,12}, {13,1,12}, {14,3,12}, {7,1,14}, {8,1,14}, {9,1,14}, {10,1,14}, {11,1,14}, {12,1,14}, {13,1,14}, {14,3,14} },
+    /* 243 */ { {7,1,15}, {8,1,15}, {9,1,15}, {10,1,15}, {11,1,15}, {12,1,15}, {13,1,15}, {14,3,15}, {7,1,16}, {8,1,16}, {9,1,16}, {10,1,16}, {11,1,16}, {12,1,16}, {13,1,16}, {14,3,16} },
+    /* 244 */ { {7,1,17}, {8,1,17}, {9,1,17}, {10,1,17}, {11,1,17}, {12,1,17}, {13,1,17}, {14,3,17}, {7,1,18}, {8,1,18}, {9,1,18}, {10,1,18}, {11,1,18}, {12,1,18}, {13,1,18}, {14,3,18} },
+    /* 245 */ { {7,1,19}, {8,1,19}, {9,1,19}, {10,1,19}, {11,1,19}, {12,1,19}, {13,1,19}, {14,3,19}, {7,1,20}, {8,1,20}, {9,1,20}, {10,1,20}, {11,1,20}, {12,1,20}, {13,1,20}, {14,3,20} },
+    /* 246 */ { {7,1,21}, {8,1,21}, {9,1,21}, {10,1,21}, {11,1,21}, {12,1,21}, {13,1,21}, {14,3,21}, {7,1,23}, {8,1,23}, {9,1,23}, {10,1,23}, {11,1,23}, {12,1,23}, {13,1,23}, {14,3,23} },
+    /* 247 */ { {7,1,24}, {8,1,24}, {9,1,24}, {10,1,24}, {11,1,24}, {12,1,24}, {13,1,24}, {14,3,24}, {7,1,25}, {8,1,25}, {9,1,25}, {10,1,25}, {11,1,25}, {12,1,25}, {13,1,25}, {14,3,25} },
+    /* 248 */ { {7,1,26}, {8,1,26}, {9,1,26}, {10,1,26}, {11,1,26}, {12,1,26}, {13,1,26}, {14,3,26}, {7,1,27}, {8,1,27}, {9,1,27}, {10,1,27}, {11,1,27}, {12,1,27}, {13,1,27}, {14,3,27} },
+    /* 249 */ { {7,1,28}, {8,1,28}, {9,1,28}, {10,1,28}, {11,1,28}, {12,1,28}, {13,1,28}, {14,3,28}, {7,1,29}, {8,1,29}, {9,1,29}, {10,1,29}, {11,1,29}, {12,1,29}, {13,1,29}, {14,3,29} },
+    /* 250 */ { {7,1,30}, {8,1,30}, {9,1,30}, {10,1,30}, {11,1,30}, {12,1,30}, {13,1,30}, {14,3,30}, {7,1,31}, {8,1,31}, {9,1,31}, {10,1,31}, {11,1,31}, {12,1,31}, {13,1,31}, {14,3,31} },
+    /* 251 */ { {7,1,127}, {8,1,127}, {9,1,127}, {10,1,127}, {11,1,127}, {12,1,127}, {13,1,127}, {14,3,127}, {7,1,220}, {8,1,220}, {9,1,220}, {10,1,220}, {11,1,220}, {12,1,220}, {13,1,220}, {14,3,220} },
+    /* 252 */ { {7,1,249}, {8,1,249}, {9,1,249}, {10,1,249}, {11,1,249}, {12,1,249}, {13,1,249}, {14,3,249}, {1,1,10}, {2,3,10}, {1,1,13}, {2,3,13}, {1,1,22}, {2,3,22}, {0,4,0}, {0,4,0} },
+    /* 253 */ { {3,1,10}, {4,1,10}, {5,1,10}, {6,3,10}, {3,1,13}, {4,1,13}, {5,1,13}, {6,3,13}, {3,1,22}, {4,1,22}, {5,1,22}, {6,3,22}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0} },
+    /* 254 */ { {7,1,10}, {8,1,10}, {9,1,10}, {10,1,10}, {11,1,10}, {12,1,10}, {13,1,10}, {14,3,10}, {7,1,13}, {8,1,13}, {9,1,13}, {10,1,13}, {11,1,13}, {12,1,13}, {13,1,13}, {14,3,13} },
+    /* 255 */ { {7,1,22}, {8,1,22}, {9,1,22}, {10,1,22}, {11,1,22}, {12,1,22}, {13,1,22}, {14,3,22}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0}, {0,4,0} }
 };
 
+size_t h3zero_qpack_huffman_encoded_length(const uint8_t* data, size_t length)
+{
+    uint64_t nb_bits = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        nb_bits += h3zero_qpack_huffman_code[data[i]].length;
+    }
+
+    return (size_t)((nb_bits + 7) >> 3);
+}
+
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, const uint8_t* data, size_t length)
+{
+    uint64_t val_out = 0;
+    int bits_out = 0;
+
+    for (size_t i = 0; bytes != NULL && i < length; i++) {
+        const h3zero_qpack_huffman_code_t* code = &h3zero_qpack_huffman_code[data[i]];
+
+        val_out = (val_out << code->length) | code->code;
+        bits_out += code->length;
+        while (bits_out >= 8) {
+            if (bytes >= bytes_max) {
+                bytes = NULL;
+                break;
+            }
+            bits_out -= 8;
+            *bytes++ = (uint8_t)(val_out >> bits_out);
+        }
+    }
+
+    if (bytes != NULL && bits_out > 0) {
+        /* Pad with the most significant bits of EOS, i.e., ones */
+        if (bytes >= bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            *bytes++ = (uint8_t)((val_out << (8 - bits_out)) | (0xFF >> bits_out));
+        }
+    }
+
+    return bytes;
+}
+
 int hzero_qpack_huffman_decode(uint8_t* bytes, uint8_t* bytes_max, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
 {
     int ret = 0;
-    uint64_t val_in = 0;
-    int bits_in = 0;
     size_t decoded_index = 0;
-    int index = 0;
-    int was_all_ones = 1;
-
-    while (1) {
-        /* Refill the registry */
-        int bit;
-        int index_64 = index >> 3;
-        int b_index = 7 - (index & 7);
-
-        while (bits_in < 57 && bytes < bytes_max) {
-            uint64_t added = *bytes++;
-            int shift = 64 - bits_in - 8;
-            added <<= shift;
-            val_in |= added;
-            bits_in += 8;
-        }
-
-        if ((h3zero_qpack_huffman_bit[index_64] >> b_index) & 1) {
-            /* This is an index location */
-            if (bits_in <= 0) {
-                /* Reached the end of the input! */
+    uint8_t state = 0;
+    int is_accepted = 1;
+    int has_symbol = 1;
+
+    while (ret == 0 && bytes < bytes_max) {
+        has_symbol = 0;
+        for (int shift = 4; shift >= 0; shift -= 4) {
+            const h3zero_qpack_huffman_transition_t* t = &h3zero_qpack_huffman_transition[state][(*bytes >> shift) & 0x0F];
+
+            if ((t->flags & H3ZERO_QPACK_HUFFMAN_FAIL) != 0) {
+                /* EOS in the middle of the string */
+                ret = -1;
                 break;
             }
-            bit = (val_in >> 63) & 1;
-            val_in <<= 1;
-            bits_in--;
-            if (bit) {
-                index += h3zero_qpack_huffman_val[index];
-            }
-            else {
-                index++;
-                was_all_ones = 0;
-            }
-            if (index >= 512) {
-                /* End of string marked by all ones */
-                break;
+            if ((t->flags & H3ZERO_QPACK_HUFFMAN_SYMBOL) != 0) {
+                if (decoded_index >= max_decoded) {
+                    /* output is too long */
+                    ret = -1;
+                    break;
+                }
+                decoded[decoded_index++] = t->symbol;
+                has_symbol = 1;
             }
+            state = t->next_state;
+            is_accepted = (t->flags & H3ZERO_QPACK_HUFFMAN_ACCEPT) != 0;
         }
-        else if (decoded_index < max_decoded){
-            decoded[decoded_index++] = h3zero_qpack_huffman_val[index];
-            index = 0;
-            was_all_ones = 1;
-        }
-        else
-        {
-            /* input is too long */
-            was_all_ones = 1;
-            break;
-        }
+        bytes++;
     }
 
-    /* Error if break and not all ones before that */
-    if (!was_all_ones) {
+    /* Error if the last bits were not all ones, or if a whole octet of padding
+     * was added after the last symbol */
+    if (!is_accepted || !has_symbol) {
         ret = -1;
     }
 
@@ -69,8 +69,8 @@ typedef enum {
 typedef enum {
     h3zero_stream_type_control = 0,
     h3zero_stream_type_push = 1, /* Push type not supported in h3zero settings */
-    h3zero_stream_type_qpack_encoder = 2, /* not required since not using dynamic table */
-    h3zero_stream_type_qpack_decoder = 3, /* not required since not using dynamic table */
+    h3zero_stream_type_qpack_encoder = 2, /* carries the insertions in the QPACK dynamic table */
+    h3zero_stream_type_qpack_decoder = 3, /* carries the QPACK acknowledgements */
     h3zero_stream_type_webtransport = 0x54 /* unidir stream is used as specified in web transport */
 } h3zero_stream_type_enum;
 
@@ -223,6 +223,90 @@ extern uint8_t const * h3zero_default_setting_frame;
 
 extern const size_t h3zero_default_setting_frame_size;
 
+/* QPACK dynamic table.
+ * Each connection manages two tables: the encoder table, in which we insert
+ * entries and that the peer's decoder mirrors, and the decoder table,
+ * mirroring the entries inserted by the peer's encoder. Entries are kept in
+ * a circular buffer, the entry of absolute index i being at position
+ * (i % max_entries).
+ *
+ * We advertise a "blocked streams" value of zero, because h3zero parses a
+ * header frame as soon as it is received and cannot put it on hold until
+ * the encoder stream catches up. As an encoder, we only reference entries not
+ * yet acknowledged by the peer if that does not exceed the number of blocked
+ * streams allowed by the peer's settings.
+ *
+ * The header frame builders ending in "_qpack" use the encoder table for the
+ * authority, user agent and server fields, for requests and responses alike.
+ * The other builders only use the static table.
+ */
+#define H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY 4096
+#define H3ZERO_QPACK_ENTRY_OVERHEAD 32
+#define H3ZERO_QPACK_MAX_SECTIONS 256
+
+typedef struct st_h3zero_qpack_entry_t {
+    http_header_enum_t header;
+    uint8_t* name;
+    size_t name_length;
+    uint8_t* value;
+    size_t value_length;
+} h3zero_qpack_entry_t;
+
+typedef struct st_h3zero_qpack_table_t {
+    h3zero_qpack_entry_t* entries;
+    size_t max_entries;
+    uint64_t max_capacity;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t insert_count;
+    uint64_t nb_entries;
+} h3zero_qpack_table_t;
+
+typedef struct st_h3zero_qpack_section_t {
+    uint64_t stream_id;
+    uint64_t base;
+    uint64_t required_insert_count;
+    uint64_t min_reference;
+    unsigned int use_dynamic : 1; /* Dynamic entries may be referenced in this section */
+    unsigned int can_block : 1; /* Unacknowledged entries may be referenced in this section */
+} h3zero_qpack_section_t;
+
+typedef struct st_h3zero_qpack_buffer_t {
+    uint8_t* bytes;
+    size_t length;
+    size_t size;
+} h3zero_qpack_buffer_t;
+
+typedef struct st_h3zero_qpack_ctx_t {
+    /* Encoder side */
+    h3zero_qpack_table_t encoder_table;
+    uint64_t peer_max_capacity;
+    uint64_t peer_blocked_streams;
+    uint64_t known_received_count;
+    h3zero_qpack_section_t* sections; /* Sections with references, not yet acknowledged */
+    size_t nb_sections;
+    size_t sections_max;
+    h3zero_qpack_buffer_t encoder_out; /* Instructions to send on the encoder stream */
+    h3zero_qpack_buffer_t decoder_in; /* Partial instruction received on the peer's decoder stream */
+    /* Decoder side */
+    h3zero_qpack_table_t decoder_table;
+    uint64_t decoder_acked_count;
+    h3zero_qpack_buffer_t decoder_out; /* Instructions to send on the decoder stream */
+    h3zero_qpack_buffer_t encoder_in; /* Partial instruction received on the peer's encoder stream */
+    /* Local unidirectional streams */
+    uint64_t encoder_stream_id;
+    uint64_t decoder_stream_id;
+    unsigned int are_streams_ready : 1;
+} h3zero_qpack_ctx_t;
+
+int h3zero_qpack_init(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity);
+void h3zero_qpack_release(h3zero_qpack_ctx_t* qpack);
+int h3zero_qpack_set_peer_settings(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity, uint64_t blocked_streams);
+int h3zero_qpack_receive_encoder_stream(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length);
+int h3zero_qpack_receive_decoder_stream(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length);
+void h3zero_qpack_cancel_stream(h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
+h3zero_qpack_entry_t* h3zero_qpack_table_get(h3zero_qpack_table_t* table, uint64_t absolute_index);
+
 uint8_t * h3zero_qpack_int_encode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t mask, uint64_t val);
 uint8_t * h3zero_qpack_int_decode(uint8_t * bytes, uint8_t * bytes_max,
@@ -230,28 +314,40 @@ uint8_t * h3zero_qpack_int_decode(uint8_t * bytes, uint8_t * bytes_max,
 
 uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_header_parts_t * parts);
+uint8_t* h3zero_parse_qpack_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_qpack_ctx_t* qpack, uint64_t stream_id, h3zero_header_parts_t* parts);
 uint8_t * h3zero_create_request_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, char const * host);
 uint8_t* h3zero_create_request_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
     uint8_t const* path, size_t path_length, uint8_t const* range, size_t range_length,
     char const* host, char const* ua_string);
+uint8_t* h3zero_create_request_header_frame_qpack(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t const* path, size_t path_length, uint8_t const* range, size_t range_length,
+    char const* host, char const* ua_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
 uint8_t * h3zero_create_post_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, char const * host,
     h3zero_content_type_enum content_type);
-uint8_t* h3zero_create_request_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
-    uint8_t const* path, size_t path_length, uint8_t const* range, size_t range_length,
-    char const* host, char const* ua_string);
 uint8_t* h3zero_create_connect_header_frame(uint8_t* bytes, uint8_t* bytes_max,
     char const* authority, uint8_t const* path, size_t path_length, char const* protocol,
     char const* origin, char const* ua_string);
+uint8_t* h3zero_create_connect_header_frame_qpack(uint8_t* bytes, uint8_t* bytes_max,
+    char const* authority, uint8_t const* path, size_t path_length, char const* protocol,
+    char const* origin, char const* ua_string, h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
 uint8_t* h3zero_create_post_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
     uint8_t const* path, size_t path_length, uint8_t const* range, size_t range_length,
     char const* host, h3zero_content_type_enum content_type, char const* ua_string);
+uint8_t* h3zero_create_post_header_frame_qpack(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t const* path, size_t path_length, uint8_t const* range, size_t range_length,
+    char const* host, h3zero_content_type_enum content_type, char const* ua_string,
+    h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
 uint8_t * h3zero_create_response_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_content_type_enum doc_type);
 uint8_t* h3zero_create_error_frame(uint8_t* bytes, uint8_t* bytes_max, char const* error_code, char const* server_string);
 uint8_t* h3zero_create_response_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
     h3zero_content_type_enum doc_type, char const* server_string);
+uint8_t* h3zero_create_response_header_frame_qpack(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_content_type_enum doc_type, char const* server_string,
+    h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
 uint8_t * h3zero_create_not_found_header_frame(uint8_t * bytes, uint8_t * bytes_max);
 uint8_t* h3zero_create_not_found_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max, char const* server_string);
 uint8_t * h3zero_create_bad_method_header_frame(uint8_t * bytes, uint8_t * bytes_max);
@@ -267,6 +363,7 @@ typedef struct st_h3zero_data_stream_state_t {
     uint64_t current_frame_length;
     uint64_t current_frame_read;
     uint64_t control_stream_id;
+    uint64_t stream_id;
     uint8_t frame_header[16];
     size_t frame_header_read;
     unsigned int is_upgrade_requested:1;
@@ -303,6 +400,8 @@ void h3zero_release_header_parts(h3zero_header_parts_t* header);
 
 int hzero_qpack_huffman_decode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t * decoded, size_t max_decoded, size_t * nb_decoded);
+size_t h3zero_qpack_huffman_encoded_length(const uint8_t* data, size_t length);
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, const uint8_t* data, size_t length);
 
 /* TLV_Buffer_accumulator 
 */
@@ -63,6 +63,10 @@ static void picohttp_clear_stream_ctx(h3zero_stream_ctx_t* stream_ctx)
 	if (stream_ctx->F != NULL) {
 		stream_ctx->F = picoquic_file_close(stream_ctx->F);
 	}
+	if (stream_ctx->file_entry != NULL) {
+		h3zero_file_cache_release(stream_ctx->file_entry);
+		stream_ctx->file_entry = NULL;
+	}
 
 	if (stream_ctx->path_callback != NULL) {
 		(void)stream_ctx->path_callback(stream_ctx->cnx, NULL, 0, picohttp_callback_free, stream_ctx, stream_ctx->path_callback_ctx);
@@ -133,6 +137,7 @@ h3zero_stream_ctx_t * h3zero_find_or_create_stream(
 			stream_ctx->cnx = cnx;
 			if (is_h3) {
 				stream_ctx->ps.stream_state.h3_ctx = ctx;
+				stream_ctx->ps.stream_state.stream_id = stream_id;
 				stream_ctx->ps.stream_state.stream_type = UINT64_MAX;
 				stream_ctx->ps.stream_state.control_stream_id = UINT64_MAX;
 				if (!IS_BIDIR_STREAM_ID(stream_id)) {
@@ -275,11 +280,13 @@ uint64_t h3zero_parse_stream_prefix(uint8_t* buffer_8, size_t* nb_in_buffer, uin
 	return prefix;
 }
 
-int h3zero_protocol_init(picoquic_cnx_t* cnx)
+int h3zero_protocol_init_ex(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx)
 {
 	uint8_t decoder_stream_head = (uint8_t)h3zero_stream_type_qpack_decoder;
 	uint8_t encoder_stream_head = (uint8_t)h3zero_stream_type_qpack_encoder;
 	uint64_t settings_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
+	uint64_t encoder_stream_id = UINT64_MAX;
+	uint64_t decoder_stream_id = UINT64_MAX;
 	/* Some of the setting values depend on the presence of connection parameters */
 	uint8_t settings_buffer[256];
 	uint8_t* settings_last = 0;
@@ -295,6 +302,13 @@ int h3zero_protocol_init(picoquic_cnx_t* cnx)
 		settings.webtransport_max_sessions = 1;
 	}
 
+	/* The dynamic table is only enabled if there is a context to manage it.
+	 * Blocked streams are not supported.
+	 */
+	if (ctx != NULL) {
+		settings.table_size = ctx->qpack.decoder_table.max_capacity;
+	}
+
 	settings_buffer[0] = (uint8_t)h3zero_stream_type_control;
 	if ((settings_last = h3zero_settings_encode(settings_buffer + 1, settings_buffer + sizeof(settings_buffer), &settings)) == NULL) {
 		ret = H3ZERO_INTERNAL_ERROR;
@@ -309,8 +323,8 @@ int h3zero_protocol_init(picoquic_cnx_t* cnx)
 	}
 
 	if (ret == 0) {
-		uint64_t encoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
-		/* set the encoder stream, although we do not actually create dynamic codes. */
+		encoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
+		/* set the encoder stream, used for insertions in the dynamic table. */
 		ret = picoquic_add_to_stream(cnx, encoder_stream_id, &encoder_stream_head, 1, 0);
 		if (ret == 0) {
 			ret = picoquic_set_stream_priority(cnx, encoder_stream_id, 1);
@@ -318,13 +332,48 @@ int h3zero_protocol_init(picoquic_cnx_t* cnx)
 	}
 
 	if (ret == 0) {
-		uint64_t decoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
-		/* set the the decoder stream, although we do not actually create dynamic codes. */
+		decoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
+		/* set the the decoder stream, used for acknowledging dynamic table entries. */
 		ret = picoquic_add_to_stream(cnx, decoder_stream_id, &decoder_stream_head, 1, 0);
 		if (ret == 0) {
 			ret = picoquic_set_stream_priority(cnx, decoder_stream_id, 1);
 		}
 	}
+
+	if (ret == 0 && ctx != NULL) {
+		ctx->qpack.encoder_stream_id = encoder_stream_id;
+		ctx->qpack.decoder_stream_id = decoder_stream_id;
+		ctx->qpack.are_streams_ready = 1;
+		ret = h3zero_send_qpack_instructions(cnx, ctx);
+	}
+	return ret;
+}
+
+int h3zero_protocol_init(picoquic_cnx_t* cnx)
+{
+	return h3zero_protocol_init_ex(cnx, NULL);
+}
+
+/* Send the QPACK instructions queued by the encoder or decoder on
+ * the corresponding streams.
+ */
+int h3zero_send_qpack_instructions(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx)
+{
+	int ret = 0;
+
+	if (ctx->qpack.are_streams_ready) {
+		if (ctx->qpack.encoder_out.length > 0) {
+			ret = picoquic_add_to_stream(cnx, ctx->qpack.encoder_stream_id,
+				ctx->qpack.encoder_out.bytes, ctx->qpack.encoder_out.length, 0);
+			ctx->qpack.encoder_out.length = 0;
+		}
+		if (ret == 0 && ctx->qpack.decoder_out.length > 0) {
+			ret = picoquic_add_to_stream(cnx, ctx->qpack.decoder_stream_id,
+				ctx->qpack.decoder_out.bytes, ctx->qpack.decoder_out.length, 0);
+			ctx->qpack.decoder_out.length = 0;
+		}
+	}
+
 	return ret;
 }
 
@@ -466,6 +515,10 @@ static uint8_t* h3zero_parse_control_stream(uint8_t* bytes, uint8_t* bytes_max,
 					}
 					else {
 						ctx->settings.settings_received = 1;
+						if (h3zero_qpack_set_peer_settings(&ctx->qpack, ctx->settings.table_size, ctx->settings.blocked_streams) != 0) {
+							*error_found = H3ZERO_INTERNAL_ERROR;
+							bytes = NULL;
+						}
 					}
 				}
 				h3zero_reset_control_stream_state(stream_state);
@@ -560,11 +613,21 @@ uint8_t* h3zero_parse_remote_unidir_stream(
 	case h3zero_stream_type_push: /* Push type not supported in current implementation */
 		bytes = bytes_max;
 		break;
-	case h3zero_stream_type_qpack_encoder: /* not required since not using dynamic table */
-		bytes = bytes_max;
+	case h3zero_stream_type_qpack_encoder: /* insertions in the peer's dynamic table */
+		if ((*error_found = h3zero_qpack_receive_encoder_stream(&ctx->qpack, bytes, bytes_max - bytes)) != 0) {
+			bytes = NULL;
+		}
+		else {
+			bytes = bytes_max;
+		}
 		break;
-	case h3zero_stream_type_qpack_decoder: /* not required since not using dynamic table */
-		bytes = bytes_max;
+	case h3zero_stream_type_qpack_decoder: /* acknowledgements of our dynamic table entries */
+		if ((*error_found = h3zero_qpack_receive_decoder_stream(&ctx->qpack, bytes, bytes_max - bytes)) != 0) {
+			bytes = NULL;
+		}
+		else {
+			bytes = bytes_max;
+		}
 		break;
 	case h3zero_stream_type_webtransport: /* unidir stream is used as specified in web transport */
 		bytes = h3zero_parse_control_stream_id(bytes, bytes_max, stream_state, stream_ctx, ctx);
@@ -740,8 +803,10 @@ uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
 						stream_state->trailer_found = stream_state->header_found;
 						stream_state->header_found = 1;
 						/* parse */
-						parsed = h3zero_parse_qpack_header_frame(stream_state->current_frame,
-							stream_state->current_frame + stream_state->current_frame_length, parts);
+						parsed = h3zero_parse_qpack_header_frame_ex(stream_state->current_frame,
+							stream_state->current_frame + stream_state->current_frame_length,
+							(stream_state->h3_ctx == NULL) ? NULL : &stream_state->h3_ctx->qpack,
+							stream_state->stream_id, parts);
 						if (parsed == NULL || (size_t)(parsed - stream_state->current_frame) != stream_state->current_frame_length) {
 							/* protocol error */
 							*error_found = H3ZERO_FRAME_ERROR;
@@ -797,10 +862,27 @@ h3zero_callback_ctx_t* h3zero_callback_create_context(picohttp_server_parameters
 
 		h3zero_init_stream_tree(&ctx->h3_stream_tree);
 
-		if (param != NULL) {
+		if (h3zero_qpack_init(&ctx->qpack, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0) {
+			h3zero_qpack_release(&ctx->qpack);
+			free(ctx);
+			ctx = NULL;
+		}
+		else if (param != NULL) {
 			ctx->path_table = param->path_table;
 			ctx->path_table_nb = param->path_table_nb;
 			ctx->web_folder = param->web_folder;
+			ctx->file_cache = param->file_cache;
+			if (ctx->file_cache == NULL && ctx->web_folder != NULL) {
+				/* Without a cache shared by the server, share files between the streams of this connection,
+				 * but do not keep idle files open: with many connections, the descriptors would add up. */
+				ctx->file_cache = h3zero_file_cache_create(0, 1);
+				ctx->is_file_cache_owned = 1;
+				if (ctx->file_cache == NULL) {
+					h3zero_qpack_release(&ctx->qpack);
+					free(ctx);
+					ctx = NULL;
+				}
+			}
 		}
 	}
 
@@ -811,6 +893,10 @@ void h3zero_callback_delete_context(picoquic_cnx_t* cnx, h3zero_callback_ctx_t*
 {
 	h3zero_delete_all_stream_prefixes(cnx, ctx);
 	picosplay_empty_tree(&ctx->h3_stream_tree);
+	h3zero_qpack_release(&ctx->qpack);
+	if (ctx->file_cache != NULL && ctx->is_file_cache_owned) {
+		h3zero_file_cache_delete(ctx->file_cache);
+	}
 	free(ctx);
 }
 
@@ -1007,9 +1093,10 @@ int h3zero_process_request_frame(
 		else {
 			response_length = (stream_ctx->echo_length == 0) ?
 				strlen(h3zero_server_default_page) : stream_ctx->echo_length;
-			o_bytes = h3zero_create_response_header_frame(o_bytes, o_bytes_max,
+			o_bytes = h3zero_create_response_header_frame_qpack(o_bytes, o_bytes_max,
 				(stream_ctx->echo_length == 0) ? h3zero_content_type_text_html :
-				h3zero_get_content_type_by_path(stream_ctx->file_path));
+				h3zero_get_content_type_by_path(stream_ctx->file_path), H3ZERO_USER_AGENT_STRING,
+				&app_ctx->qpack, stream_ctx->stream_id);
 			/* TODO handle query string
 			 * Currently picoquic doesn't support query strings.
 			 */
@@ -1039,9 +1126,10 @@ int h3zero_process_request_frame(
 
 		/* If known, create response header frame */
 		/* POST-TODO: provide content type of response as part of context */
-		o_bytes = h3zero_create_response_header_frame(o_bytes, o_bytes_max,
+		o_bytes = h3zero_create_response_header_frame_qpack(o_bytes, o_bytes_max,
 			(stream_ctx->echo_length == 0) ? h3zero_content_type_text_html :
-			h3zero_content_type_text_plain);
+			h3zero_content_type_text_plain, H3ZERO_USER_AGENT_STRING,
+			&app_ctx->qpack, stream_ctx->stream_id);
 	}
 	else if (stream_ctx->ps.stream_state.header.method == h3zero_method_connect) {
 		/* The connect handling depends on the requested protocol */
@@ -1059,7 +1147,8 @@ int h3zero_process_request_frame(
 				else {
 					/* Create a connect accept frame */
 					picoquic_log_app_message(cnx, "Connect accepted on stream: %"PRIu64 ", path:%s", stream_ctx->stream_id, app_ctx->path_table[path_item].path);
-					o_bytes = h3zero_create_response_header_frame(o_bytes, o_bytes_max, h3zero_content_type_none);
+					o_bytes = h3zero_create_response_header_frame_qpack(o_bytes, o_bytes_max, h3zero_content_type_none,
+						H3ZERO_USER_AGENT_STRING, &app_ctx->qpack, stream_ctx->stream_id);
 					stream_ctx->is_upgraded = 1;
 				}
 			}
@@ -1086,6 +1175,7 @@ int h3zero_process_request_frame(
 
 	if (o_bytes == NULL) {
 		picoquic_log_app_message(cnx, "Error, resetting stream: %"PRIu64, stream_ctx->stream_id);
+		h3zero_qpack_cancel_stream(&app_ctx->qpack, stream_ctx->stream_id);
 		ret = picoquic_reset_stream(cnx, stream_ctx->stream_id, H3ZERO_INTERNAL_ERROR);
 	}
 	else {
@@ -1138,6 +1228,8 @@ int h3zero_process_request_frame(
 		}
 
 		if (o_bytes == NULL) {
+			/* The peer will not acknowledge the header section of a reset stream */
+			h3zero_qpack_cancel_stream(&app_ctx->qpack, stream_ctx->stream_id);
 			ret = picoquic_reset_stream(cnx, stream_ctx->stream_id, H3ZERO_INTERNAL_ERROR);
 		}
 		else if (stream_ctx->echo_length != 0 || response_length > sizeof(post_response)) {
@@ -1460,7 +1552,7 @@ int h3zero_callback_data(picoquic_cnx_t* cnx,
 /* Prepare to send. This is the same code as on the client side, except for the
 * delayed opening of the data file */
 int h3zero_prepare_to_send_buffer(void* context, size_t space,
-	uint64_t echo_length, uint64_t* echo_sent, FILE* F)
+	uint64_t echo_length, uint64_t* echo_sent, FILE* F, h3zero_file_entry_t* file_entry)
 {
 	int ret = 0;
 
@@ -1476,7 +1568,14 @@ int h3zero_prepare_to_send_buffer(void* context, size_t space,
 
 		buffer = picoquic_provide_stream_data_buffer(context, (size_t)available, is_fin, !is_fin);
 		if (buffer != NULL) {
-			if (F) {
+			if (file_entry != NULL) {
+				/* Read at the stream offset, the entry is shared with other streams */
+				ret = h3zero_file_entry_read(file_entry, *echo_sent, buffer, (size_t)available);
+				if (ret == 0) {
+					*echo_sent += available;
+				}
+			}
+			else if (F) {
 				size_t nb_read = fread(buffer, 1, (size_t)available, F);
 
 				if (nb_read != available) {
@@ -1503,24 +1602,34 @@ int h3zero_prepare_to_send_buffer(void* context, size_t space,
 }
 
 int h3zero_prepare_to_send(int client_mode, void* context, size_t space,
-	h3zero_stream_ctx_t* stream_ctx)
+	h3zero_stream_ctx_t* stream_ctx, h3zero_file_cache_t* file_cache)
 {
 	int ret = 0;
 
-	if (!client_mode && stream_ctx->F == NULL && stream_ctx->file_path != NULL) {
-		stream_ctx->F = picoquic_file_open(stream_ctx->file_path, "rb");
-		if (stream_ctx->F == NULL) {
-			ret = -1;
+	if (!client_mode && stream_ctx->file_path != NULL) {
+		if (file_cache != NULL) {
+			if (stream_ctx->file_entry == NULL) {
+				stream_ctx->file_entry = h3zero_file_cache_open(file_cache, stream_ctx->file_path);
+				if (stream_ctx->file_entry == NULL) {
+					ret = -1;
+				}
+			}
+		}
+		else if (stream_ctx->F == NULL) {
+			stream_ctx->F = picoquic_file_open(stream_ctx->file_path, "rb");
+			if (stream_ctx->F == NULL) {
+				ret = -1;
+			}
 		}
 	}
 
 	if (ret == 0) {
 		if (client_mode) {
-			ret = h3zero_prepare_to_send_buffer(context, space, stream_ctx->post_size, &stream_ctx->post_sent, NULL);
+			ret = h3zero_prepare_to_send_buffer(context, space, stream_ctx->post_size, &stream_ctx->post_sent, NULL, NULL);
 		}
 		else {
 			ret = h3zero_prepare_to_send_buffer(context, space, stream_ctx->echo_length, &stream_ctx->echo_sent,
-				stream_ctx->F);
+				stream_ctx->F, stream_ctx->file_entry);
 		}
 	}
 	return ret;
@@ -1547,7 +1656,7 @@ int h3zero_callback_prepare_to_send(picoquic_cnx_t* cnx,
 		}
 		else {
 			/* default reply for known URL */
-			ret = h3zero_prepare_to_send(cnx->client_mode, context, space, stream_ctx);
+			ret = h3zero_prepare_to_send(cnx->client_mode, context, space, stream_ctx, ctx->file_cache);
 			/* if finished sending on server, delete stream */
 			if (!cnx->client_mode) {
 				if (stream_ctx->echo_sent >= stream_ctx->echo_length) {
@@ -1773,7 +1882,7 @@ int h3zero_callback(picoquic_cnx_t* cnx,
 		}
 		else {
 			picoquic_set_callback(cnx, h3zero_callback, ctx);
-			ret = h3zero_protocol_init(cnx);
+			ret = h3zero_protocol_init_ex(cnx, ctx);
 		}
 	} else{
 		ctx = (h3zero_callback_ctx_t*)callback_ctx;
@@ -1786,10 +1895,16 @@ int h3zero_callback(picoquic_cnx_t* cnx,
 			/* Data arrival on stream #x, maybe with fin mark */
 			ret = h3zero_callback_data(cnx, stream_id, bytes, length,
 				fin_or_event, ctx, stream_ctx, &fin_stream_id);
+			if (ret == 0) {
+				/* Send the QPACK instructions triggered by the incoming data */
+				ret = h3zero_send_qpack_instructions(cnx, ctx);
+			}
 			break;
 		case picoquic_callback_stream_reset: /* Peer reset stream #x */
 		case picoquic_callback_stop_sending: /* Peer asks server to reset stream #x */
 											 /* TODO: special case for uni streams. */
+			/* Header sections sent on a reset stream may never be acknowledged */
+			h3zero_qpack_cancel_stream(&ctx->qpack, stream_id);
 			if (stream_ctx == NULL) {
 				stream_ctx = h3zero_find_stream(ctx, stream_id);
 			}
@@ -23,6 +23,7 @@
 
 #include "picosplay.h"
 #include "h3zero.h"
+#include "h3zero_file_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -113,6 +114,7 @@ extern "C" {
         uint8_t frame[PICOHTTP_SERVER_FRAME_MAX];
         char* file_path;
         FILE* F;
+        h3zero_file_entry_t* file_entry;
         picohttp_post_data_cb_fn path_callback;
         void* path_callback_ctx;
     } h3zero_stream_ctx_t;
@@ -181,6 +183,8 @@ extern "C" {
     } h3zero_stream_prefixes_t;
 
     int h3zero_protocol_init(picoquic_cnx_t* cnx);
+    int h3zero_protocol_init_ex(picoquic_cnx_t* cnx, struct st_h3zero_callback_ctx_t* ctx);
+    int h3zero_send_qpack_instructions(picoquic_cnx_t* cnx, struct st_h3zero_callback_ctx_t* ctx);
 
     /* CLIENT DEFINITIONS 
      */
@@ -188,12 +192,18 @@ extern "C" {
         uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, const char* range, size_t range_len, uint64_t post_size, const char* host, size_t* consumed);
     int h3zero_client_create_stream_request(
         uint8_t * buffer, size_t max_bytes, uint8_t const * path, size_t path_len, uint64_t post_size, const char * host, size_t * consumed);
+    /* Same, using the dynamic table of the QPACK context if not NULL. The instructions
+     * queued for the encoder stream are sent by h3zero_send_qpack_instructions */
+    int h3zero_client_create_stream_request_qpack(
+        uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, const char* range, size_t range_len, uint64_t post_size, const char* host, size_t* consumed,
+        h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
 
     /* Common callback definitions */
     typedef struct st_picohttp_server_parameters_t {
         char const* web_folder;
         picohttp_server_path_item_t* path_table;
         size_t path_table_nb;
+        h3zero_file_cache_t* file_cache; /* Optional, shared by all connections. */
     } picohttp_server_parameters_t;
 
     typedef struct st_h3zero_callback_ctx_t {
@@ -201,8 +211,13 @@ extern "C" {
         picohttp_server_path_item_t * path_table;
         size_t path_table_nb;
         char const* web_folder;
+        /* Open files shared by the streams serving content from web_folder */
+        h3zero_file_cache_t* file_cache;
+        unsigned int is_file_cache_owned : 1;
         /* Settings */
         h3zero_settings_t settings;
+        /* QPACK dynamic tables and encoder/decoder streams */
+        h3zero_qpack_ctx_t qpack;
         /* connection wide tracking of stream prefixes */
         h3zero_stream_prefixes_t stream_prefixes;
         uint64_t last_datagram_prefix;
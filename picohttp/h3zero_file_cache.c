@@ -0,0 +1,352 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Cache of open files used when serving static content.
+ * See h3zero_file_cache.h for the description of the sharing and
+ * eviction policy.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "picoquic_utils.h"
+#include "picohash.h"
+#include "h3zero_file_cache.h"
+
+static uint64_t h3zero_file_entry_hash(const void* key)
+{
+    const h3zero_file_entry_t* entry = (const h3zero_file_entry_t*)key;
+
+    return picohash_bytes((const uint8_t*)entry->file_path, (uint32_t)strlen(entry->file_path));
+}
+
+static int h3zero_file_entry_compare(const void* key1, const void* key2)
+{
+    const h3zero_file_entry_t* entry1 = (const h3zero_file_entry_t*)key1;
+    const h3zero_file_entry_t* entry2 = (const h3zero_file_entry_t*)key2;
+
+    return strcmp(entry1->file_path, entry2->file_path);
+}
+
+static picohash_item* h3zero_file_entry_to_item(const void* key)
+{
+    h3zero_file_entry_t* entry = (h3zero_file_entry_t*)key;
+
+    return &entry->hash_item;
+}
+
+/* Obtain the size and modification time of the file, without opening it. */
+static int h3zero_file_stat(char const* file_path, uint64_t* file_length, int64_t* modification_time)
+{
+    int ret = 0;
+#ifdef _WINDOWS
+    struct __stat64 st;
+
+    if (_stat64(file_path, &st) != 0) {
+        ret = -1;
+    }
+#else
+    struct stat st;
+
+    if (stat(file_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ret = -1;
+    }
+#endif
+    else {
+        *file_length = (uint64_t)st.st_size;
+        *modification_time = (int64_t)st.st_mtime;
+    }
+
+    return ret;
+}
+
+static void h3zero_file_lru_remove(h3zero_file_cache_t* cache, h3zero_file_entry_t* entry)
+{
+    if (entry->lru_previous == NULL) {
+        cache->lru_first = entry->lru_next;
+    }
+    else {
+        entry->lru_previous->lru_next = entry->lru_next;
+    }
+    if (entry->lru_next == NULL) {
+        cache->lru_last = entry->lru_previous;
+    }
+    else {
+        entry->lru_next->lru_previous = entry->lru_previous;
+    }
+    entry->lru_previous = NULL;
+    entry->lru_next = NULL;
+}
+
+static void h3zero_file_lru_append(h3zero_file_cache_t* cache, h3zero_file_entry_t* entry)
+{
+    entry->lru_next = NULL;
+    entry->lru_previous = cache->lru_last;
+    if (cache->lru_last == NULL) {
+        cache->lru_first = entry;
+    }
+    else {
+        cache->lru_last->lru_next = entry;
+    }
+    cache->lru_last = entry;
+}
+
+static void h3zero_file_entry_delete(h3zero_file_entry_t* entry)
+{
+#ifdef _WINDOWS
+    if (entry->F != NULL) {
+        entry->F = picoquic_file_close(entry->F);
+    }
+#else
+    if (entry->mapping != NULL) {
+        (void)munmap(entry->mapping, (size_t)entry->file_length);
+    }
+    if (entry->fd >= 0) {
+        (void)close(entry->fd);
+    }
+#endif
+    if (entry->cache != NULL) {
+        entry->cache->nb_open_files--;
+    }
+    if (entry->file_path != NULL) {
+        free(entry->file_path);
+    }
+    free(entry);
+}
+
+/* Close an unreferenced entry, removing it from the LRU list and from the hash table */
+static void h3zero_file_entry_close(h3zero_file_cache_t* cache, h3zero_file_entry_t* entry)
+{
+    h3zero_file_lru_remove(cache, entry);
+    if (!entry->is_stale) {
+        picohash_delete_item(cache->table, &entry->hash_item, 0);
+    }
+    h3zero_file_entry_delete(entry);
+}
+
+static h3zero_file_entry_t* h3zero_file_entry_create(h3zero_file_cache_t* cache, char const* file_path)
+{
+    h3zero_file_entry_t* entry = (h3zero_file_entry_t*)malloc(sizeof(h3zero_file_entry_t));
+
+    if (entry != NULL) {
+        size_t path_length = strlen(file_path);
+        int ret = 0;
+
+        memset(entry, 0, sizeof(h3zero_file_entry_t));
+#ifndef _WINDOWS
+        entry->fd = -1;
+#endif
+        entry->file_path = (char*)malloc(path_length + 1);
+        if (entry->file_path == NULL) {
+            ret = -1;
+        }
+        else {
+            memcpy(entry->file_path, file_path, path_length + 1);
+#ifdef _WINDOWS
+            entry->F = picoquic_file_open(file_path, "rb");
+            if (entry->F == NULL ||
+                h3zero_file_stat(file_path, &entry->file_length, &entry->modification_time) != 0) {
+                ret = -1;
+            }
+#else
+            struct stat st;
+
+            entry->fd = open(file_path, O_RDONLY);
+            if (entry->fd < 0 || fstat(entry->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                ret = -1;
+            }
+            else {
+                entry->file_length = (uint64_t)st.st_size;
+                entry->modification_time = (int64_t)st.st_mtime;
+                if (cache->use_mmap && entry->file_length > 0 && entry->file_length <= (uint64_t)SIZE_MAX) {
+                    void* mapping = mmap(NULL, (size_t)entry->file_length, PROT_READ, MAP_SHARED, entry->fd, 0);
+                    /* If the file cannot be mapped, it is read with pread instead */
+                    if (mapping != MAP_FAILED) {
+                        entry->mapping = (uint8_t*)mapping;
+                    }
+                }
+            }
+#endif
+        }
+
+        if (ret == 0) {
+            entry->cache = cache;
+            cache->nb_open_files++;
+        }
+        else {
+            h3zero_file_entry_delete(entry);
+            entry = NULL;
+        }
+    }
+
+    return entry;
+}
+
+/* Close the least recently used entries until the number of open files is within bounds */
+static void h3zero_file_cache_trim(h3zero_file_cache_t* cache)
+{
+    while (cache->nb_open_files > cache->max_open_files && cache->lru_first != NULL) {
+        h3zero_file_entry_close(cache, cache->lru_first);
+    }
+}
+
+h3zero_file_cache_t* h3zero_file_cache_create(size_t max_open_files, int use_mmap)
+{
+    h3zero_file_cache_t* cache = (h3zero_file_cache_t*)malloc(sizeof(h3zero_file_cache_t));
+
+    if (cache != NULL) {
+        memset(cache, 0, sizeof(h3zero_file_cache_t));
+        cache->max_open_files = max_open_files;
+#ifndef _WINDOWS
+        cache->use_mmap = (use_mmap) ? 1 : 0;
+#else
+        (void)use_mmap;
+#endif
+        cache->table = picohash_create_ex((max_open_files == 0) ? H3ZERO_FILE_CACHE_DEFAULT_MAX_OPEN : max_open_files, h3zero_file_entry_hash,
+            h3zero_file_entry_compare, h3zero_file_entry_to_item);
+        if (cache->table == NULL) {
+            free(cache);
+            cache = NULL;
+        }
+    }
+
+    return cache;
+}
+
+void h3zero_file_cache_delete(h3zero_file_cache_t* cache)
+{
+    /* Streams shall have released their entries before the cache is deleted,
+     * so all remaining entries are in the LRU list. */
+    while (cache->lru_first != NULL) {
+        h3zero_file_entry_close(cache, cache->lru_first);
+    }
+    picohash_delete(cache->table, 0);
+    free(cache);
+}
+
+h3zero_file_entry_t* h3zero_file_cache_open(h3zero_file_cache_t* cache, char const* file_path)
+{
+    h3zero_file_entry_t key;
+    h3zero_file_entry_t* entry = NULL;
+    picohash_item* item;
+
+    key.file_path = (char*)file_path;
+    item = picohash_retrieve(cache->table, &key);
+
+    if (item != NULL) {
+        uint64_t file_length = 0;
+        int64_t modification_time = 0;
+
+        entry = (h3zero_file_entry_t*)item->key;
+        if (h3zero_file_stat(file_path, &file_length, &modification_time) != 0 ||
+            file_length != entry->file_length || modification_time != entry->modification_time) {
+            /* The file changed since it was opened. Streams that use the old
+             * entry keep reading the old content. */
+            picohash_delete_item(cache->table, item, 0);
+            entry->is_stale = 1;
+            if (entry->ref_count == 0) {
+                h3zero_file_entry_close(cache, entry);
+            }
+            entry = NULL;
+        }
+    }
+
+    if (entry == NULL && (entry = h3zero_file_entry_create(cache, file_path)) != NULL &&
+        picohash_insert(cache->table, entry) != 0) {
+        h3zero_file_entry_delete(entry);
+        entry = NULL;
+    }
+
+    if (entry != NULL) {
+        if (entry->ref_count == 0 && (entry->lru_previous != NULL || cache->lru_first == entry)) {
+            h3zero_file_lru_remove(cache, entry);
+        }
+        entry->ref_count++;
+        h3zero_file_cache_trim(cache);
+    }
+
+    return entry;
+}
+
+void h3zero_file_cache_release(h3zero_file_entry_t* entry)
+{
+    h3zero_file_cache_t* cache = entry->cache;
+
+    entry->ref_count--;
+    if (entry->ref_count <= 0) {
+        entry->ref_count = 0;
+        if (entry->is_stale || cache == NULL) {
+            h3zero_file_entry_delete(entry);
+        }
+        else {
+            h3zero_file_lru_append(cache, entry);
+            h3zero_file_cache_trim(cache);
+        }
+    }
+}
+
+int h3zero_file_entry_read(h3zero_file_entry_t* entry, uint64_t offset, uint8_t* buffer, size_t length)
+{
+    int ret = 0;
+
+    if (offset > entry->file_length || (uint64_t)length > entry->file_length - offset) {
+        ret = -1;
+    }
+#ifdef _WINDOWS
+    else if (_fseeki64(entry->F, (__int64)offset, SEEK_SET) != 0 ||
+        fread(buffer, 1, length, entry->F) != length) {
+        ret = -1;
+    }
+#else
+    else if (entry->mapping != NULL) {
+        memcpy(buffer, entry->mapping + offset, length);
+    }
+    else {
+        size_t nb_read = 0;
+
+        while (ret == 0 && nb_read < length) {
+            ssize_t r = pread(entry->fd, buffer + nb_read, length - nb_read, (off_t)(offset + nb_read));
+
+            if (r > 0) {
+                nb_read += (size_t)r;
+            }
+            else if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            else {
+                /* End of file reached before the expected length */
+                ret = -1;
+            }
+        }
+    }
+#endif
+
+    return ret;
+}
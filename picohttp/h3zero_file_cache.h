@@ -0,0 +1,103 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef H3ZERO_FILE_CACHE_H
+#define H3ZERO_FILE_CACHE_H
+/* Cache of open files, used when serving static content.
+ *
+ * Streams that serve the same file share a single entry, which holds
+ * one file descriptor and, if memory mapping is enabled, one mapping of
+ * the whole file. The content is read at an explicit offset, either
+ * copied from the mapping or obtained with pread, so the entry carries no
+ * file position and there is no stdio buffering or locking.
+ *
+ * Entries are reference counted. When the last stream releases an entry,
+ * it stays open in a least recently used list so that the next request
+ * for the same file does not reopen it. Unreferenced entries are closed
+ * when the number of open files exceeds the configured maximum. Entries
+ * in use are never closed, so the maximum may be exceeded temporarily.
+ * With a maximum of zero, files are closed as soon as the last stream
+ * releases them, and only concurrent streams share an entry.
+ *
+ * On each open, the size and modification time of the file are compared
+ * to those of the cached entry. If the file changed, a new entry is
+ * created, and the old one is closed when its last user releases it.
+ * Files should be replaced by renaming a new version, not rewritten in
+ * place, because a mapped file that is truncated cannot be read safely.
+ *
+ * The cache is not thread safe. It can be shared by all the connections
+ * of a QUIC context, and shall be deleted after the last stream using it.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "picohash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H3ZERO_FILE_CACHE_DEFAULT_MAX_OPEN 64
+
+typedef struct st_h3zero_file_entry_t {
+    picohash_item hash_item;
+    struct st_h3zero_file_cache_t* cache;
+    struct st_h3zero_file_entry_t* lru_previous;
+    struct st_h3zero_file_entry_t* lru_next;
+    char* file_path;
+    uint64_t file_length;
+    int64_t modification_time;
+    int ref_count;
+    unsigned int is_stale : 1; /* File changed on disk, entry no longer in the hash table */
+#ifdef _WINDOWS
+    FILE* F;
+#else
+    int fd;
+    uint8_t* mapping;
+#endif
+} h3zero_file_entry_t;
+
+typedef struct st_h3zero_file_cache_t {
+    picohash_table* table;
+    h3zero_file_entry_t* lru_first; /* Least recently released entry */
+    h3zero_file_entry_t* lru_last;
+    size_t max_open_files;
+    size_t nb_open_files;
+    unsigned int use_mmap : 1;
+} h3zero_file_cache_t;
+
+h3zero_file_cache_t* h3zero_file_cache_create(size_t max_open_files, int use_mmap);
+void h3zero_file_cache_delete(h3zero_file_cache_t* cache);
+
+/* Obtain a reference to the entry for the file, opening it if needed.
+ * Returns NULL if the file cannot be opened. */
+h3zero_file_entry_t* h3zero_file_cache_open(h3zero_file_cache_t* cache, char const* file_path);
+void h3zero_file_cache_release(h3zero_file_entry_t* entry);
+
+/* Copy length bytes starting at offset. Returns -1 if the requested
+ * range extends past the end of the file. */
+int h3zero_file_entry_read(h3zero_file_entry_t* entry, uint64_t offset, uint8_t* buffer, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H3ZERO_FILE_CACHE_H */
@@ -224,7 +224,7 @@ int picowt_prepare_client_cnx(picoquic_quic_t* quic, struct sockaddr* server_add
             else {
                 /* Perform the initialization, settings and QPACK streams
                  */
-                ret = h3zero_protocol_init(*p_cnx);
+                ret = h3zero_protocol_init_ex(*p_cnx, *p_h3_ctx);
             }
         }
     }
@@ -261,8 +261,8 @@ int picowt_connect(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,  h3zero_stre
         *bytes++ = h3zero_frame_header;
         bytes += 2; /* reserve two bytes for frame length */
 
-        bytes = h3zero_create_connect_header_frame(bytes, bytes_max, authority, (const uint8_t*)path, strlen(path), "webtransport", NULL,
-            H3ZERO_USER_AGENT_STRING);
+        bytes = h3zero_create_connect_header_frame_qpack(bytes, bytes_max, authority, (const uint8_t*)path, strlen(path), "webtransport", NULL,
+            H3ZERO_USER_AGENT_STRING, &ctx->qpack, stream_ctx->stream_id);
 
         if (bytes == NULL) {
             ret = -1;
@@ -283,10 +283,14 @@ int picowt_connect(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,  h3zero_stre
             stream_ctx->ps.stream_state.is_upgrade_requested = 1;
             ret = picoquic_add_to_stream_with_ctx(cnx, stream_ctx->stream_id, buffer, connect_length,
                     0, stream_ctx);
+            if (ret == 0) {
+                ret = h3zero_send_qpack_instructions(cnx, ctx);
+            }
         }
 
         if (ret != 0) {
-            /* remove the stream prefix */
+            /* remove the stream prefix, and forget the references made by the header */
+            h3zero_qpack_cancel_stream(&ctx->qpack, stream_ctx->stream_id);
             h3zero_delete_stream_prefix(cnx, ctx, stream_ctx->stream_id);
         }
     }
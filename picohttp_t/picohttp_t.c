@@ -50,9 +50,13 @@ static const picoquic_test_def_t test_table[] = {
     { "h3zero_incoming_unidir", h3zero_incoming_unidir_test },
     { "qpack_huffman", qpack_huffman_test },
     { "qpack_huffman_base", qpack_huffman_base_test},
+    { "qpack_huffman_encode", qpack_huffman_encode_test },
+    { "qpack_huffman_bench", qpack_huffman_bench_test },
     { "h3zero_parse_qpack", h3zero_parse_qpack_test },
     { "h3zero_prepare_qpack", h3zero_prepare_qpack_test },
     { "h3zero_user_agent", h3zero_user_agent_test },
+    { "h3zero_qpack_dynamic", h3zero_qpack_dynamic_test },
+    { "h3zero_file_cache", h3zero_file_cache_test },
     { "h3zero_uri", h3zero_uri_test },
     { "h3zero_null_sni", h3zero_null_sni_test },
     { "h3zero_qpack_fuzz", h3zero_qpack_fuzz_test },
@@ -25,38 +25,152 @@
 #include <errno.h>
 
 #include "picoquic_internal.h"
-#include "bytestream.h"
-#include "csv.h"
-#include "svg.h"
-#include "qlog.h"
-#include "cidset.h"
-#include "logreader.h"
+#include "logbatch.h"
 #ifdef _WINDOWS
 #include "../picoquicfirst/getopt.h"
 #endif
 
-typedef struct app_conversion_context_st
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#endif
+
+int usage();
+
+static int picolog_has_wildcard(const char * input)
+{
+    return strchr(input, '*') != NULL || strchr(input, '?') != NULL;
+}
+
+/* Add the files designated by an input argument: a directory is replaced by the
+ * ".log" files that it contains, a pattern by the matching files. Patterns are
+ * expanded here so that they work when quoted, or when the shell does not
+ * expand them. */
+#ifdef _WINDOWS
+static int picolog_add_input(picolog_file_list_t * files, const char * input, int * is_batch)
 {
-    const char * out_format;
-    const char * out_dir;
+    int ret = 0;
+    char pattern[512];
+    char prefix[512];
+    DWORD attributes = GetFileAttributesA(input);
+
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        ret = picoquic_sprintf(pattern, sizeof(pattern), NULL, "%s\\*.log", input);
+        if (ret == 0) {
+            ret = picoquic_sprintf(prefix, sizeof(prefix), NULL, "%s\\", input);
+        }
+    }
+    else if (picolog_has_wildcard(input)) {
+        /* FindFirstFile only returns the file names, keep the directory part of the pattern. */
+        size_t prefix_len = 0;
+        for (size_t i = 0; input[i] != 0; i++) {
+            if (input[i] == '\\' || input[i] == '/' || input[i] == ':') {
+                prefix_len = i + 1;
+            }
+        }
+        ret = picoquic_sprintf(pattern, sizeof(pattern), NULL, "%s", input);
+        if (ret == 0) {
+            ret = picoquic_sprintf(prefix, sizeof(prefix), NULL, "%.*s", (int)prefix_len, input);
+        }
+    }
+    else {
+        return picolog_add_file(files, input);
+    }
 
-    const char * binlog_name;
-    FILE * f_binlog;
+    *is_batch = 1;
 
-    const char * template_name;
-    FILE * f_template;
+    if (ret == 0) {
+        WIN32_FIND_DATAA find_data;
+        HANDLE h_find = FindFirstFileA(pattern, &find_data);
+
+        if (h_find != INVALID_HANDLE_VALUE) {
+            do {
+                if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+                    char file_name[512];
+                    if (picoquic_sprintf(file_name, sizeof(file_name), NULL, "%s%s", prefix, find_data.cFileName) == 0) {
+                        ret = picolog_add_file(files, file_name);
+                    }
+                }
+            } while (ret == 0 && FindNextFileA(h_find, &find_data));
+            FindClose(h_find);
+        }
+    }
 
-    uint64_t log_time;
-    uint16_t flags;
-} app_conversion_context_t;
+    return ret;
+}
+#else
+static int picolog_compare_names(const void * a, const void * b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
 
-int convert_csv(const picoquic_connection_id_t * cid, void * ptr);
-int convert_svg(const picoquic_connection_id_t * cid, void * ptr);
-int convert_qlog(const picoquic_connection_id_t * cid, void * ptr);
-int filedump_binlog(FILE* bin_log, FILE* bin_dump);
+static int picolog_add_input(picolog_file_list_t * files, const char * input, int * is_batch)
+{
+    int ret = 0;
+    struct stat st;
 
-int usage();
-void usage_formats();
+    if (stat(input, &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR * dir = opendir(input);
+
+        *is_batch = 1;
+        if (dir == NULL) {
+            fprintf(stderr, "Could not open directory %s\n", input);
+            ret = -1;
+        }
+        else {
+            size_t nb_before = files->nb_names;
+            struct dirent * entry;
+
+            while (ret == 0 && (entry = readdir(dir)) != NULL) {
+                size_t len = strlen(entry->d_name);
+                if (len > 4 && strcmp(entry->d_name + len - 4, ".log") == 0) {
+                    char file_name[512];
+                    if (picoquic_sprintf(file_name, sizeof(file_name), NULL, "%s%s%s",
+                        input, PICOQUIC_FILE_SEPARATOR, entry->d_name) == 0) {
+                        ret = picolog_add_file(files, file_name);
+                    }
+                }
+            }
+            (void)closedir(dir);
+            /* Directory order is arbitrary, sort for a predictable report. */
+            qsort(files->names + nb_before, files->nb_names - nb_before, sizeof(char *), picolog_compare_names);
+        }
+    }
+    else if (picolog_has_wildcard(input)) {
+        glob_t matches;
+
+        *is_batch = 1;
+        memset(&matches, 0, sizeof(matches));
+        if (glob(input, 0, NULL, &matches) == 0) {
+            for (size_t i = 0; ret == 0 && i < matches.gl_pathc; i++) {
+                ret = picolog_add_file(files, matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    }
+    else {
+        ret = picolog_add_file(files, input);
+    }
+
+    return ret;
+}
+#endif
+
+static int picolog_nb_processors()
+{
+#ifdef _WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long nb_proc = sysconf(_SC_NPROCESSORS_ONLN);
+    return (nb_proc > 0) ? (int)nb_proc : 1;
+#endif
+}
 
 /* - Open binary log file and find all connection ids it contains by:
  *   - read each event
@@ -68,22 +182,27 @@ void usage_formats();
  *   with a new hashtable only containing the user provided connection id.
  * - Iterate over all connection ids in the hashtable and for each connection id
  *   convert all events for that connection id into the specified format.
+ *
+ * If several inputs are given, or if an input is a directory or a wildcard
+ * pattern, picolog runs in batch mode: the files are converted in parallel
+ * by a pool of worker threads, each worker processing one file at a time.
  */
-
 int main(int argc, char ** argv)
 {
     int ret = 0;
 
-    picohash_table * cids = cidset_create();
-
     const char * cid_name = NULL;
     picoquic_connection_id_t cid = picoquic_null_connection_id;
+    picolog_file_list_t files = { 0 };
+    int nb_threads = 0;
+    int is_batch = 0;
 
     app_conversion_context_t appctx = { 0 };
     appctx.out_format = "csv";
+    appctx.window_end = UINT64_MAX;
 
     int opt;
-    while ((opt = getopt(argc, argv, "o:f:t:c:h")) != -1) {
+    while ((opt = getopt(argc, argv, "o:f:t:c:b:e:j:h")) != -1) {
         switch (opt) {
         case 'o':
             appctx.out_dir = optarg;
@@ -97,6 +216,20 @@ int main(int argc, char ** argv)
         case 'c':
             cid_name = optarg;
             break;
+        case 'b':
+            appctx.window_start = strtoull(optarg, NULL, 10);
+            break;
+        case 'e':
+            appctx.window_end = strtoull(optarg, NULL, 10);
+            break;
+        case 'j':
+            nb_threads = atoi(optarg);
+            if (nb_threads <= 0) {
+                fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                return usage();
+            }
+            is_batch = 1;
+            break;
         case 'h':
         default:
             return usage();
@@ -104,118 +237,53 @@ int main(int argc, char ** argv)
         }
     }
 
-    if (optind < argc) {
-        appctx.binlog_name = argv[optind++];
-    } else {
+    if (optind >= argc) {
         return usage();
     }
 
-    if (cids == NULL) {
-        fprintf(stderr, "Fatal: failed to create resources.\n");
-        return 1;
-    }
-
     if (cid_name != NULL && picoquic_parse_connection_id_hexa(cid_name, strlen(cid_name), &cid) == 0) {
         fprintf(stderr, "Could not parse connection id: %s\n", cid_name);
         ret = -1;
     }
 
-    debug_printf_push_stream(stderr);
+    if (argc - optind > 1) {
+        is_batch = 1;
+    }
+
+    while (ret == 0 && optind < argc) {
+        ret = picolog_add_input(&files, argv[optind++], &is_batch);
+    }
 
-    appctx.f_binlog = picoquic_open_cc_log_file_for_read(appctx.binlog_name, &appctx.flags, &appctx.log_time);
-    if (appctx.f_binlog == NULL) {
-        fprintf(stderr, "Could not open log file %s\n", appctx.binlog_name);
+    if (ret == 0 && files.nb_names == 0) {
+        fprintf(stderr, "No log file to convert.\n");
         ret = -1;
     }
 
-    if (ret == 0) {
-        if (strcmp(appctx.out_format, "dump") == 0) {
-            char dump_file_name[512];
-            FILE* bin_dump = NULL;
-            size_t name_len = 0;
+    debug_printf_push_stream(stderr);
 
-            ret = picoquic_sprintf(dump_file_name, sizeof(dump_file_name), &name_len, "%s.dump", appctx.binlog_name);
-            if (ret == 0) {
-                bin_dump = picoquic_file_open(dump_file_name, "w");
-                if (bin_dump == NULL) {
-                    fprintf(stderr, "Could not open dump file %s\n", dump_file_name);
-                    ret = -1;
-                }
-                else {
-                    ret = filedump_binlog(appctx.f_binlog, bin_dump);
-                    (void)picoquic_file_close(bin_dump);
-                }
-            }
+    if (ret == 0) {
+        if (!is_batch) {
+            ret = convert_binlog_file(&appctx, files.names[0], &cid, 0);
         }
         else {
-            if (appctx.template_name != NULL) {
-                appctx.f_template = picoquic_file_open(appctx.template_name, "r");
-                if (appctx.f_template == NULL) {
-                    fprintf(stderr, "Could not open template file %s\n", appctx.binlog_name);
-                    ret = -1;
-                }
+            if (appctx.out_dir == NULL) {
+                appctx.out_dir = ".";
             }
-
-            if (ret == 0) {
-                binlog_list_cids(appctx.f_binlog, cids);
-
-                fprintf(stderr, "%s contains %"PRIst" connection(s):\n\n", appctx.binlog_name, cids->count);
-                cidset_print(stderr, cids);
-                fprintf(stderr, "\n");
-
-                if (!picoquic_is_connection_id_null(&cid)) {
-                    if (!cidset_has_cid(cids, &cid)) {
-                        fprintf(stderr, "%s does not contain connection %s\n", appctx.binlog_name, cid_name);
-                        ret = -1;
-                    }
-                    else {
-                        (void)cidset_delete(cids);
-                        cids = cidset_create();
-                        if (cids != NULL) {
-                            cidset_insert(cids, &cid);
-                        }
-                        else {
-                            ret = -1;
-                        }
-                    }
-                }
-            }
-
-            if (ret == 0) {
-                if (strcmp(appctx.out_format, "csv") == 0) {
-                    ret = cidset_iterate(cids, convert_csv, &appctx);
-                }
-                else if (strcmp(appctx.out_format, "svg") == 0) {
-                    if (appctx.f_template == NULL) {
-                        fprintf(stderr, "The svg format conversion requires a template file specified by parameter -t\n");
-                        ret = -1;
-                    }
-                    else {
-                        ret = cidset_iterate(cids, convert_svg, &appctx);
-                    }
-                }
-                else if (strcmp(appctx.out_format, "qlog") == 0) {
-                    ret = cidset_iterate(cids, convert_qlog, &appctx);
-                }
-                else {
-                    fprintf(stderr, "Invalid output format '%s'. Valid formats are\n\n", appctx.out_format);
-                    usage_formats();
-                    ret = 1;
-                }
+            if (nb_threads == 0) {
+                nb_threads = picolog_nb_processors();
             }
+            ret = convert_batch(&appctx, &cid, &files, nb_threads);
         }
     }
 
-    (void)picoquic_file_close(appctx.f_binlog);
-    (void)picoquic_file_close(appctx.f_template);
-    (void)cidset_delete(cids);
+    picolog_free_files(&files);
     return ret;
 }
 
 int usage()
 {
     fprintf(stderr, "PicoQUIC log file converter\n");
-    fprintf(stderr, "Usage: picolog <options> input \n");
+    fprintf(stderr, "Usage: picolog <options> input [input ...]\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -o directory          output directory name\n");
@@ -224,6 +292,12 @@ int usage()
     usage_formats();
     fprintf(stderr, "  -t template-file      template file for svg format conversion\n");
     fprintf(stderr, "  -c connection-id      only convert logs of specified connection id\n");
+    fprintf(stderr, "  -b milliseconds       qlog format: only convert events after this time\n");
+    fprintf(stderr, "  -e milliseconds       qlog format: only convert events before this time\n");
+    fprintf(stderr, "                        times are relative to the start of the log. Logs\n");
+    fprintf(stderr, "                        with an index are read from the closest sync point.\n");
+    fprintf(stderr, "  -j threads            number of files converted in parallel in batch mode\n");
+    fprintf(stderr, "                        default is the number of processors\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "picolog converts binary log files into the format specified. Output files are\n");
     fprintf(stderr, "placed in the specified directory with their connection-id as file name.\n");
@@ -231,95 +305,10 @@ int usage()
     fprintf(stderr, "If no connection id is specified all connections contained in the binary file\n");
     fprintf(stderr, "are converted producing as many output files as connections are found in the\n");
     fprintf(stderr, "binary file.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Batch mode is used if several inputs are given, if an input is a directory\n");
+    fprintf(stderr, "(all its .log files are converted) or a pattern such as \"logs/*.log\", or if\n");
+    fprintf(stderr, "-j is specified. Files are then converted in parallel, and output files are\n");
+    fprintf(stderr, "named after the input file, e.g. <cid>.client.qlog for <cid>.client.log.\n");
     return 1;
 }
-
-void usage_formats()
-{
-    fprintf(stderr, "                        -f csv  : generate CC csv file\n");
-    fprintf(stderr, "                        -f svg  : generate svg packet flow diagram.\n");
-    fprintf(stderr, "                                  requires a template specified by -t\n");
-    fprintf(stderr, "                        -f qlog : generate IETF QLOG file\n");
-}
-
-int convert_csv(const picoquic_connection_id_t * cid, void * ptr)
-{
-    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
-    int ret = 0;
-
-    char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
-    if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid) != 0) {
-        DBG_PRINTF("Cannot convert connection id for %s", appctx->binlog_name);
-        ret = -1;
-    }
-
-    if (ret == 0) {
-        ret = picoquic_cc_bin_to_csv(appctx->f_binlog,
-            open_outfile(cid_name, appctx->binlog_name, appctx->out_dir, "csv"));
-    }
-
-    return ret;
-}
-
-int convert_svg(const picoquic_connection_id_t * cid, void * ptr)
-{
-    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
-    return svg_convert(cid, appctx->f_binlog, appctx->f_template, appctx->binlog_name, appctx->out_dir);
-}
-
-int convert_qlog(const picoquic_connection_id_t * cid, void * ptr)
-{
-    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
-    return qlog_convert(cid, appctx->f_binlog, appctx->binlog_name, NULL, appctx->out_dir, appctx->flags);
-}
-
-int filedump_binlog(FILE* bin_log, FILE* bin_dump)
-{
-    int ret = 0;
-    uint8_t head[4];
-    bytestream_buf stream_msg;
-
-    fseek(bin_log, 16, SEEK_SET);
-
-    fprintf(bin_dump, "MSG-len, I-CID, Time, ID, Comment\n");
-
-    while (ret == 0 && fread(head, sizeof(head), 1, bin_log) > 0) {
-
-        uint32_t len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
-        if (len > sizeof(stream_msg.buf)) {
-            fprintf(bin_dump, "%d, x, 0, 0, \"Message larger than buffer[%d]\"\n", len, (int)sizeof(stream_msg.buf));
-            ret = -1;
-        }
-
-        if (ret == 0 && fread(stream_msg.buf, len, 1, bin_log) <= 0) {
-            fprintf(bin_dump, "%d, x, 0, 0, \"Message cannot be read from file\n", len);
-            ret = -1;
-        }
-
-        if (ret == 0) {
-            bytestream* s = bytestream_buf_init(&stream_msg, len);
-
-            picoquic_connection_id_t cid;
-            ret |= byteread_cid(s, &cid);
-
-            uint64_t time = 0;
-            ret |= byteread_vint(s, &time);
-
-            uint64_t id = 0;
-            ret |= byteread_vint(s, &id);
-
-            if (ret != 0) {
-                fprintf(bin_dump, "%d, x, 0, 0, \"cannot read CID, Time and ID\n", len);
-            }
-            else {
-                fprintf(bin_dump, "%d, x", len);
-                for (uint8_t x = 0; x < cid.id_len; x++) {
-                    fprintf(bin_dump, "%02x", cid.id[x]);
-                }
-                fprintf(bin_dump, ", %" PRIu64 ", %" PRIu64 ",\n", time, id);
-            }
-        }
-    }
-
-    return ret;
-}
\ No newline at end of file
@@ -170,6 +170,9 @@ void picoquic_update_stream_initial_remote(picoquic_cnx_t* cnx)
                 stream->maxdata_remote = cnx->remote_parameters.initial_max_stream_data_bidi_local;
             }
         }
+        if (stream->is_ready_blocked) {
+            picoquic_queue_ready_stream(cnx, stream);
+        }
         stream = picoquic_next_stream(stream);
     };
 }
@@ -240,15 +243,7 @@ uint8_t * picoquic_format_stream_reset_frame(picoquic_cnx_t* cnx, picoquic_strea
             picoquic_update_max_stream_ID_local(cnx, stream);
 
             /* Free the queued data */
-            while (stream->send_queue != NULL) {
-                picoquic_stream_queue_node_t* next = stream->send_queue->next_stream_data;
-
-                if (stream->send_queue->bytes != NULL) {
-                    free(stream->send_queue->bytes);
-                }
-                free(stream->send_queue);
-                stream->send_queue = next;
-            }
+            picoquic_stream_queue_free(stream);
             (void)picoquic_delete_stream_if_closed(cnx, stream);
         }
         else {
@@ -1081,16 +1076,54 @@ void picoquic_stream_data_callback(picoquic_cnx_t* cnx, picoquic_stream_head_t*
     picoquic_stream_data_chunk_callback(cnx, stream, NULL, 0);
 }
 
-static int add_chunk_node(picoquic_quic_t * quic, picosplay_tree_t* tree, uint64_t offset,
-    size_t length, int is_last_frame, 
+/* Out of order fragments up to that size are copied in compact nodes,
+ * instead of keeping a full size packet node while waiting for the gap
+ * to be filled. */
+#define PICOQUIC_DATA_NODE_COPY_MAX 768
+
+static int add_chunk_node(picoquic_quic_t * quic, picosplay_tree_t* tree, uint64_t consumed_offset,
+    picoquic_stream_data_node_t* previous, uint64_t offset, size_t length, int is_last_frame,
     const uint8_t* bytes, int* chunk_added, picoquic_stream_data_node_t * received_data)
 {
     int ret = 0;
+    picoquic_stream_data_node_t* node = NULL;
+    int is_zero_copy = (received_data != NULL && received_data->bytes == NULL && is_last_frame);
 
-    picoquic_stream_data_node_t* node = received_data;
-    
-    if (received_data == NULL || received_data->bytes != NULL || !is_last_frame) {
-        node = picoquic_stream_data_node_alloc(quic);
+    if (is_zero_copy && offset > consumed_offset && length <= PICOQUIC_DATA_NODE_COPY_MAX) {
+        is_zero_copy = 0;
+    }
+
+    if (is_zero_copy) {
+        /* The pointer "bytes" is inside the received data packet. */
+        node = received_data;
+        node->bytes = bytes;
+        node->offset = offset;
+        node->length = length;
+    }
+    else if (previous != NULL && previous->bytes == previous->data &&
+        previous->offset + previous->length == offset &&
+        previous->length + length <= PICOQUIC_MAX_PACKET_SIZE) {
+        /* The chunk extends a copied fragment. Append to it if there is room,
+         * or else move both to a node of a larger size class. */
+        if (previous->length + length <= previous->data_size) {
+            memmove(previous->data + previous->length, bytes, length);
+            previous->length += length;
+            *chunk_added = 1;
+        }
+        else if ((node = picoquic_stream_data_node_alloc_ex(quic, previous->length + length)) == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            memcpy(node->data, previous->data, previous->length);
+            memmove(node->data + previous->length, bytes, length);
+            node->bytes = node->data;
+            node->offset = previous->offset;
+            node->length = previous->length + length;
+            picosplay_delete_hint(tree, &previous->stream_data_node);
+        }
+    }
+    else {
+        node = picoquic_stream_data_node_alloc_ex(quic, length);
         if (node == NULL) {
             ret = PICOQUIC_ERROR_MEMORY;
         }
@@ -1103,12 +1136,6 @@ static int add_chunk_node(picoquic_quic_t * quic, picosplay_tree_t* tree, uint64
             node->length = length;
         }
     }
-    else {
-        /* The pointer "bytes" is inside the received data packet. */
-        node->bytes = bytes;
-        node->offset = offset;
-        node->length = length;
-    }
 
     if (node != NULL){
         picosplay_insert(tree, node);
@@ -1150,6 +1177,8 @@ int picoquic_queue_network_input(picoquic_quic_t * quic, picosplay_tree_t* tree,
         picoquic_stream_data_node_t* next = (prev == NULL) ?
             (picoquic_stream_data_node_t*)picosplay_first(tree) :
             (picoquic_stream_data_node_t*)picosplay_next(&prev->stream_data_node);
+        /* Chunk preceding the data being added, which can be extended if adjacent */
+        picoquic_stream_data_node_t* previous = prev;
 
         /* Check whether parts of the new frame are covered by already received chunks */
         while (ret == 0 && frame_data_offset < input_end && next != NULL && next->offset < input_end) {
@@ -1160,11 +1189,12 @@ int picoquic_queue_network_input(picoquic_quic_t * quic, picosplay_tree_t* tree,
 
             if (chunk_len > 0) {
                 /* There is a gap between previous and next frame, and it will be at least partially filled */
-                ret = add_chunk_node(quic, tree, chunk_ofs, (size_t)chunk_len, is_last_frame,
+                ret = add_chunk_node(quic, tree, consumed_offset, previous, chunk_ofs, (size_t)chunk_len, is_last_frame,
                     bytes + frame_data_offset - input_begin, new_data_available, received_data);
             }
 
             frame_data_offset = next->offset + next->length;
+            previous = next;
             next = (picoquic_stream_data_node_t*)picosplay_next(&next->stream_data_node);
         }
 
@@ -1172,7 +1202,7 @@ int picoquic_queue_network_input(picoquic_quic_t * quic, picosplay_tree_t* tree,
         if (ret == 0 && frame_data_offset < input_end) {
             const uint64_t chunk_ofs = frame_data_offset;
             const uint64_t chunk_len = input_end - frame_data_offset;
-            ret = add_chunk_node(quic, tree, chunk_ofs, (size_t)chunk_len, is_last_frame,
+            ret = add_chunk_node(quic, tree, consumed_offset, previous, chunk_ofs, (size_t)chunk_len, is_last_frame,
                 bytes + frame_data_offset - input_begin, new_data_available, received_data);
         }
     }
@@ -1334,75 +1364,78 @@ const uint8_t* picoquic_decode_stream_frame(picoquic_cnx_t* cnx, const uint8_t*
     return bytes;
 }
 
+/* Find the next stream to serve.
+ * Priority levels are examined in order. Within a level, streams with a pending
+ * RESET_STREAM or STOP_SENDING take precedence. Otherwise, the ready queue is
+ * sorted so that its first sendable stream is the one to serve, whether the
+ * level uses FIFO or round robin processing. Streams found idle or waiting for
+ * flow control credit on the way are removed from the queue, so in steady
+ * state the search only looks at the head of the first non empty level.
+ */
 picoquic_stream_head_t* picoquic_find_ready_stream_path(picoquic_cnx_t* cnx, picoquic_path_t * path_x)
 {
-    picoquic_stream_head_t* first_stream = cnx->first_output_stream;
-    picoquic_stream_head_t* stream = first_stream;
+    picoquic_stream_ready_level_t* level = picoquic_first_ready_level(cnx);
     picoquic_stream_head_t* found_stream = NULL;
+    int is_flow_blocked = (cnx->maxdata_remote <= cnx->data_sent);
 
+    while (level != NULL && found_stream == NULL) {
+        picoquic_stream_head_t* stream;
 
-    /* Look for a ready stream */
-    while (stream != NULL) {
-        int has_data = 0;
-        picoquic_stream_head_t* next_stream = stream->next_output_stream;
+        while ((stream = level->first_urgent_stream) != NULL) {
+            if ((stream->reset_requested && !stream->reset_sent) ||
+                (stream->stop_sending_requested && !stream->stop_sending_sent)) {
+                /* urgent action is needed, this takes precedence over FIFO vs round-robin processing */
+                found_stream = stream;
+                break;
+            }
+            else if (picoquic_is_stream_exhausted(stream)) {
+                /* If stream is exhausted, remove from output list */
+                picoquic_remove_output_stream(cnx, stream);
 
-        if (found_stream != NULL && stream->stream_priority > found_stream->stream_priority) {
-            /* All the streams at that priority level have been examined,
-             * the current selection is validated */
-            break;
-        }
-        has_data = (cnx->maxdata_remote > cnx->data_sent && stream->sent_offset < stream->maxdata_remote && (stream->is_active ||
-                (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
-                (stream->fin_requested && !stream->fin_sent)));
-        if (has_data && path_x != NULL && stream->affinity_path != path_x && stream->affinity_path != NULL) {
-            /* Only consider the streams that meet path affinity requirements */
-            has_data = 0;
-        }
-        if ((stream->reset_requested && !stream->reset_sent) ||
-            (stream->stop_sending_requested && !stream->stop_sending_sent)) {
-            /* urgent action is needed, this takes precedence over FIFO vs round-robin processing */
-            found_stream = stream;
-            break;
-        } else if (has_data) {
-            /* Check that this stream is actually available for sending data */
-            if (stream->sent_offset == 0) {
-                if (IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode) {
-                    if (stream->stream_id > ((IS_BIDIR_STREAM_ID(stream->stream_id)) ? cnx->max_stream_id_bidir_remote : cnx->max_stream_id_unidir_remote)) {
-                        has_data = 0;
-                    }
-                }
+                picoquic_delete_stream_if_closed(cnx, stream);
             }
-            if (has_data) {
-                /* Something can be sent */
-                if ((stream->stream_priority & 1) != 0) {
-                    /* This priority level requests FIFO processing, so we return the first available stream */
-                    found_stream = stream;
-                    break;
-                }
-                else if (found_stream == NULL || stream->last_time_data_sent < found_stream->last_time_data_sent) {
-                    /* Select this stream, but need to check if another stream should go before in round robin order */
-                    found_stream = stream;
-                }
+            else {
+                /* Move to the ready queue, or out of the queues if nothing left to send */
+                picoquic_queue_ready_stream(cnx, stream);
             }
         }
-        else if (((stream->fin_requested && stream->fin_sent) || (stream->reset_requested && stream->reset_sent)) && (!stream->stop_sending_requested || stream->stop_sending_sent)) {
-            /* If stream is exhausted, remove from output list */
-            picoquic_remove_output_stream(cnx, stream);
 
-            picoquic_delete_stream_if_closed(cnx, stream);
+        stream = (found_stream == NULL) ? level->first_ready_stream : NULL;
+
+        if (stream != NULL && is_flow_blocked) {
+            cnx->flow_blocked = 1;
+            stream = NULL;
         }
-        else {
-            if (stream->is_active ||
-                (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset)) {
-                if (stream->sent_offset >= stream->maxdata_remote) {
-                    cnx->stream_blocked = 1;
-                }
-                else if (cnx->maxdata_remote <= cnx->data_sent) {
-                    cnx->flow_blocked = 1;
-                }
+
+        while (stream != NULL) {
+            picoquic_stream_head_t* next_stream = stream->next_ready_stream;
+
+            if (picoquic_is_stream_exhausted(stream)) {
+                picoquic_remove_output_stream(cnx, stream);
+
+                picoquic_delete_stream_if_closed(cnx, stream);
             }
+            else if (!picoquic_stream_has_pending_data(stream)) {
+                picoquic_dequeue_ready_stream(cnx, stream);
+            }
+            else if (stream->sent_offset >= stream->maxdata_remote) {
+                cnx->stream_blocked = 1;
+                picoquic_block_ready_stream(cnx, stream);
+            }
+            else if (stream->sent_offset == 0 && IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode &&
+                stream->stream_id > ((IS_BIDIR_STREAM_ID(stream->stream_id)) ? cnx->max_stream_id_bidir_remote : cnx->max_stream_id_unidir_remote)) {
+                /* Not yet allowed by the stream limit. Will be queued again by picoquic_add_output_streams */
+                picoquic_dequeue_ready_stream(cnx, stream);
+            }
+            else if (path_x == NULL || stream->affinity_path == path_x || stream->affinity_path == NULL) {
+                /* Only consider the streams that meet path affinity requirements */
+                found_stream = stream;
+                break;
+            }
+            stream = next_stream;
         }
-        stream = next_stream;
+
+        level = picoquic_next_ready_level(cnx, level);
     }
 
     return found_stream;
@@ -1622,6 +1655,38 @@ uint8_t* picoquic_format_stream_frame_header(uint8_t* bytes, uint8_t* bytes_max,
     return bytes;
 }
 
+/* Stream reference frames are only used in the compact copies of sent packets,
+ * see picoquic_compact_sent_packets. They are never sent on the wire. They
+ * describe a stream frame whose data can be found in the stream send queue
+ * or retained list: flags (0x02 if the original frame had a length field),
+ * stream ID, offset and length.
+ */
+uint8_t* picoquic_format_stream_reference_frame(uint8_t* bytes, const uint8_t* bytes_max,
+    uint8_t flags, uint64_t stream_id, uint64_t offset, uint64_t length)
+{
+    if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, picoquic_frame_type_stream_reference)) != NULL &&
+        (bytes = picoquic_frames_uint8_encode(bytes, bytes_max, flags)) != NULL &&
+        (bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id)) != NULL &&
+        (bytes = picoquic_frames_varint_encode(bytes, bytes_max, offset)) != NULL) {
+        bytes = picoquic_frames_varint_encode(bytes, bytes_max, length);
+    }
+    return bytes;
+}
+
+const uint8_t* picoquic_parse_stream_reference_frame(const uint8_t* bytes, const uint8_t* bytes_max,
+    uint8_t* flags, uint64_t* stream_id, uint64_t* offset, uint64_t* length)
+{
+    uint64_t ftype = 0;
+
+    if ((bytes = picoquic_frames_varint_decode(bytes, bytes_max, &ftype)) != NULL &&
+        (bytes = picoquic_frames_uint8_decode(bytes, bytes_max, flags)) != NULL &&
+        (bytes = picoquic_frames_varint_decode(bytes, bytes_max, stream_id)) != NULL &&
+        (bytes = picoquic_frames_varint_decode(bytes, bytes_max, offset)) != NULL) {
+        bytes = picoquic_frames_varint_decode(bytes, bytes_max, length);
+    }
+    return bytes;
+}
+
 uint8_t * picoquic_format_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream,
     uint8_t* bytes, uint8_t* bytes_max, int * more_data, int * is_pure_ack, int* is_still_active, int * ret)
 {
@@ -1706,6 +1771,7 @@ uint8_t * picoquic_format_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head
                     stream->sent_offset += stream_data_context.length;
                     stream->last_time_data_sent = picoquic_get_quic_time(cnx->quic);
                     cnx->data_sent += stream_data_context.length;
+                    picoquic_queue_ready_stream(cnx, stream);
 
                     if (stream_data_context.length > 0) {
                         if (stream_data_context.app_buffer == NULL ||
@@ -1765,15 +1831,13 @@ uint8_t * picoquic_format_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head
 
                     stream->send_queue->offset += length;
                     if (stream->send_queue->offset >= stream->send_queue->length) {
-                        picoquic_stream_queue_node_t* next = stream->send_queue->next_stream_data;
-                        free(stream->send_queue->bytes);
-                        free(stream->send_queue);
-                        stream->send_queue = next;
+                        picoquic_stream_queue_pop(stream, cnx->quic->use_compact_retransmit);
                     }
 
                     stream->sent_offset += length;
                     stream->last_time_data_sent = picoquic_get_quic_time(cnx->quic);
                     cnx->data_sent += length;
+                    picoquic_queue_ready_stream(cnx, stream);
                 }
 
                 bytes = bytes0 + byte_index;
@@ -2412,10 +2476,7 @@ uint8_t* picoquic_format_crypto_hs_frame(picoquic_stream_head_t* stream, uint8_t
 
                     stream->send_queue->offset += length;
                     if (stream->send_queue->offset >= stream->send_queue->length) {
-                        picoquic_stream_queue_node_t* next = stream->send_queue->next_stream_data;
-                        free(stream->send_queue->bytes);
-                        free(stream->send_queue);
-                        stream->send_queue = next;
+                        picoquic_stream_queue_pop(stream, 0);
                     }
 
                     stream->sent_offset += length;
@@ -2969,9 +3030,7 @@ static picoquic_packet_t* picoquic_find_acked_packet(picoquic_cnx_t* cnx, picoqu
         pkt_ctx->ack_of_ack_requested = 0;
         *is_new_ack = 1;
 
-        while (packet != NULL && packet->packet_next != NULL && packet->sequence_number < largest) {
-            packet = packet->packet_next;
-        }
+        packet = picoquic_pending_ring_ceiling(pkt_ctx, largest);
     }
 
     return packet;
@@ -3415,6 +3474,37 @@ int picoquic_process_ack_of_stream_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
         if (stream != NULL) {
             (void)picoquic_update_sack_list(&stream->sack_list,
                 offset, offset + data_length - ((fin) ? 0 : 1), 0);
+            picoquic_stream_release_acked_data(stream);
+
+            picoquic_delete_stream_if_closed(cnx, stream);
+        }
+    }
+
+    return ret;
+}
+
+static int picoquic_process_ack_of_stream_reference_frame(picoquic_cnx_t* cnx, const uint8_t* bytes,
+    size_t bytes_max, size_t* consumed)
+{
+    int ret = 0;
+    uint8_t flags = 0;
+    uint64_t stream_id = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    const uint8_t* bytes_next = picoquic_parse_stream_reference_frame(bytes, bytes + bytes_max,
+        &flags, &stream_id, &offset, &length);
+
+    if (bytes_next == NULL) {
+        *consumed = bytes_max;
+        ret = -1;
+    }
+    else {
+        picoquic_stream_head_t* stream = picoquic_find_stream(cnx, stream_id);
+
+        *consumed = bytes_next - bytes;
+        if (stream != NULL && length > 0) {
+            (void)picoquic_update_sack_list(&stream->sack_list, offset, offset + length - 1, 0);
+            picoquic_stream_release_acked_data(stream);
 
             picoquic_delete_stream_if_closed(cnx, stream);
         }
@@ -3433,6 +3523,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
     size_t byte_index;
     int frame_is_pure_ack = 0;
     size_t frame_length = 0;
+    size_t frames_length = (p->is_compacted) ? p->compacted_length : p->length;
 
     if (p->ptype == picoquic_packet_0rtt_protected) {
         cnx->nb_zero_rtt_acked++;
@@ -3440,9 +3531,9 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
 
     byte_index = p->offset;
 
-    while (ret == 0 && byte_index < p->length) {
+    while (ret == 0 && byte_index < frames_length) {
         uint64_t ftype;
-        size_t l_ftype = picoquic_varint_decode(&p->bytes[byte_index], p->length - byte_index, &ftype);
+        size_t l_ftype = picoquic_varint_decode(&p->bytes[byte_index], frames_length - byte_index, &ftype);
         if (l_ftype == 0) {
             break;
         }
@@ -3450,20 +3541,20 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
         switch (ftype) {
         case picoquic_frame_type_ack:
             ret = picoquic_process_ack_of_ack_frame(&cnx->ack_ctx[p->pc].sack_list,
-                &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+                &p->bytes[byte_index], frames_length - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_ack_ecn:
             ret = picoquic_process_ack_of_ack_frame(&cnx->ack_ctx[p->pc].sack_list,
-                &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+                &p->bytes[byte_index], frames_length - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_ack:
-            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_ack_ecn:
-            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_handshake_done:
@@ -3471,64 +3562,71 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
             byte_index += l_ftype;
             break;
         case picoquic_frame_type_new_connection_id:
-            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], p->length - byte_index, 0, &frame_length);
+            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, 0, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_new_connection_id:
-            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], p->length - byte_index, 1, &frame_length);
+            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, 1, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_retire_connection_id:
-            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_retire_connection_id:
-            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_crypto_hs:
-            ret = picoquic_process_ack_of_crypto_frame(cnx, &p->bytes[byte_index], p->length - byte_index, p->ptype, &frame_length);
+            ret = picoquic_process_ack_of_crypto_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, p->ptype, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_new_token:
             ret = picoquic_skip_frame(&p->bytes[byte_index],
-                p->length - byte_index, &frame_length, &frame_is_pure_ack);
+                frames_length - byte_index, &frame_length, &frame_is_pure_ack);
             byte_index += frame_length;
             cnx->is_new_token_acked = 1;
             break;
         case picoquic_frame_type_max_data:
-            ret = picoquic_process_ack_of_max_data_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_data_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_stream_data:
-            ret = picoquic_process_ack_of_max_stream_data_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_stream_data_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_streams_bidir:
         case picoquic_frame_type_max_streams_unidir:
-            ret = picoquic_process_ack_of_max_streams_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_streams_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_reset_stream:
-            ret = picoquic_process_ack_of_reset_stream_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_reset_stream_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_path_id:
-            ret = picoquic_process_ack_of_max_path_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_path_id_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_blocked:
-            ret = picoquic_process_ack_of_path_blocked_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_path_blocked_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_observed_address_v4:
         case picoquic_frame_type_observed_address_v6:
-            ret = picoquic_process_ack_of_observed_address_frame(cnx, p->send_path, &p->bytes[byte_index], p->length - byte_index, ftype, &frame_length);
+            ret = picoquic_process_ack_of_observed_address_frame(cnx, p->send_path, &p->bytes[byte_index], frames_length - byte_index, ftype, &frame_length);
+            byte_index += frame_length;
+            break;
+        case picoquic_frame_type_stream_reference:
+            ret = picoquic_process_ack_of_stream_reference_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
             byte_index += frame_length;
+            if (p->send_path != NULL && p->send_time > p->send_path->last_time_acked_data_frame_sent) {
+                p->send_path->last_time_acked_data_frame_sent = p->send_time;
+            }
             break;
         default:
             if (PICOQUIC_IN_RANGE(ftype, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-                ret = picoquic_process_ack_of_stream_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+                ret = picoquic_process_ack_of_stream_frame(cnx, &p->bytes[byte_index], frames_length - byte_index, &frame_length);
                 byte_index += frame_length;
                 if (p->send_path != NULL) {
                     if (p->send_time > p->send_path->last_time_acked_data_frame_sent) {
@@ -3547,7 +3645,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
                         uint8_t* content_bytes;
 
                         /* Parse and skip type and length */
-                        content_bytes = picoquic_decode_datagram_frame_header(&p->bytes[byte_index], &p->bytes[p->length],
+                        content_bytes = picoquic_decode_datagram_frame_header(&p->bytes[byte_index], &p->bytes[frames_length],
                             &frame_id, &content_length);
 
                         ret = (cnx->callback_fn)(cnx, p->send_time, content_bytes, (size_t)content_length,
@@ -3557,7 +3655,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
                 }
 
                 ret = picoquic_skip_frame(&p->bytes[byte_index],
-                    p->length - byte_index, &frame_length, &frame_is_pure_ack);
+                    frames_length - byte_index, &frame_length, &frame_is_pure_ack);
                 byte_index += frame_length;
             }
             break;
@@ -3571,62 +3669,69 @@ static int picoquic_process_ack_range(
     uint64_t current_time, picoquic_packet_data_t* packet_data)
 {
     picoquic_packet_t* p = *ppacket;
+    uint64_t lowest = highest + 1 - range;
     int ret = 0;
 
-    /* Compare the range to the retransmit queue */
-    while (p != NULL && range > 0) {
-        if (p->sequence_number > highest) {
-            p = p->packet_previous;
-        } else {
-            if (p->sequence_number == highest) {
-                picoquic_packet_t* next = p->packet_previous;
-                picoquic_path_t * old_path = p->send_path;
+    /* Skip the pending packets above the range, jumping directly to
+     * the highest packet in the range if it is still pending. */
+    if (p != NULL && p->sequence_number > highest) {
+        picoquic_packet_t* p_highest = picoquic_pending_ring_get(pkt_ctx, highest);
 
-                if (p->is_ack_trap) {
-                    ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, picoquic_frame_type_ack);
-                    break;
-                }
+        if (p_highest != NULL) {
+            p = p_highest;
+        }
+        else {
+            while (p != NULL && p->sequence_number > highest) {
+                p = p->packet_previous;
+            }
+        }
+    }
 
-                if (old_path != NULL) {
-                    old_path->delivered += p->length;
-                    /* Reset the flags tracking loss of ack only packets and corresponding ping */
-                    old_path->is_ack_lost = 0;
-                    old_path->is_ack_expected = 0;
-                    /* Track timer for the packet */
-                    if (p->sequence_number >= picoquic_get_ack_number(cnx, old_path, pc)) {
-                        old_path->nb_retransmit = 0;
-                    }
+    /* Only visit the pending packets that are in the range */
+    while (p != NULL && p->sequence_number >= lowest) {
+        picoquic_packet_t* next = p->packet_previous;
+        picoquic_path_t * old_path = p->send_path;
 
-                    picoquic_record_ack_packet_data(packet_data, p);
-                    /* If packet is larger than the current MTU, update the MTU */
-                    if ((p->length + p->checksum_overhead) == old_path->send_mtu) {
-                        old_path->nb_mtu_losses = 0;
-                    } else if ((p->length + p->checksum_overhead) > old_path->send_mtu) {
-                        old_path->send_mtu = p->length + p->checksum_overhead;
-                        old_path->mtu_probe_sent = 0;
-                    }
-                }
+        if (p->is_ack_trap) {
+            ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, picoquic_frame_type_ack);
+            break;
+        }
 
-                /* If the packet contained an ACK frame, perform the ACK of ACK pruning logic.
-                 * Record stream data as acknowledged, signal datagram frames as acknowledged.
-                 */
-                picoquic_process_ack_of_frames(cnx, p, 0, current_time);
-
-                /* Keep track of reception of ACK of 1RTT data */
-                if (p->ptype == picoquic_packet_1rtt_protected &&
-                    (cnx->cnx_state == picoquic_state_client_ready_start ||
-                        cnx->cnx_state == picoquic_state_server_false_start)) {
-                    /* Transition to client ready state.
-                     * The handshake is complete, all the handshake packets are implicitly acknowledged */
-                    picoquic_ready_state_transition(cnx, current_time);
-                }
-                (void)picoquic_dequeue_retransmit_packet(cnx, pkt_ctx, p, 1, 0);
-                p = next;
+        if (old_path != NULL) {
+            old_path->delivered += p->length;
+            /* Reset the flags tracking loss of ack only packets and corresponding ping */
+            old_path->is_ack_lost = 0;
+            old_path->is_ack_expected = 0;
+            /* Track timer for the packet */
+            if (p->sequence_number >= picoquic_get_ack_number(cnx, old_path, pc)) {
+                old_path->nb_retransmit = 0;
             }
 
-            range--;
-            highest--;
+            picoquic_record_ack_packet_data(packet_data, p);
+            /* If packet is larger than the current MTU, update the MTU */
+            if ((p->length + p->checksum_overhead) == old_path->send_mtu) {
+                old_path->nb_mtu_losses = 0;
+            } else if ((p->length + p->checksum_overhead) > old_path->send_mtu) {
+                old_path->send_mtu = p->length + p->checksum_overhead;
+                old_path->mtu_probe_sent = 0;
+            }
+        }
+
+        /* If the packet contained an ACK frame, perform the ACK of ACK pruning logic.
+         * Record stream data as acknowledged, signal datagram frames as acknowledged.
+         */
+        picoquic_process_ack_of_frames(cnx, p, 0, current_time);
+
+        /* Keep track of reception of ACK of 1RTT data */
+        if (p->ptype == picoquic_packet_1rtt_protected &&
+            (cnx->cnx_state == picoquic_state_client_ready_start ||
+                cnx->cnx_state == picoquic_state_server_false_start)) {
+            /* Transition to client ready state.
+             * The handshake is complete, all the handshake packets are implicitly acknowledged */
+            picoquic_ready_state_transition(cnx, current_time);
         }
+        (void)picoquic_dequeue_retransmit_packet(cnx, pkt_ctx, p, 1, 0);
+        p = next;
     }
 
     *ppacket = p;
@@ -4270,6 +4375,7 @@ const uint8_t* picoquic_decode_max_stream_data_frame(picoquic_cnx_t* cnx, const
     if (stream != NULL && maxdata > stream->maxdata_remote) {
         /* TODO: call back if the stream was blocked? */
         stream->maxdata_remote = maxdata;
+        picoquic_queue_ready_stream(cnx, stream);
         if (maxdata > cnx->max_stream_data_remote) {
             cnx->max_stream_data_remote = maxdata;
         }
@@ -4316,9 +4422,14 @@ uint8_t * picoquic_format_required_max_stream_data_frames(picoquic_cnx_t* cnx,
 
     while (stream != NULL) {
         if (!stream->fin_received) {
-            uint64_t new_window = picoquic_cc_increased_window(cnx, stream->maxdata_local);
-
             if (!stream->reset_received && 2 * stream->consumed_offset > stream->maxdata_local) {
+                uint64_t new_window = picoquic_receive_window_increase(cnx, stream->maxdata_local);
+
+                if (new_window == 0) {
+                    /* Over the memory budget. Keep max_stream_data_needed set to retry later. */
+                    break;
+                }
+
                 bytes0 = bytes;
 
                 if ((bytes = picoquic_format_max_stream_data_frame(cnx, stream, bytes, bytes_max, more_data, is_pure_ack, stream->maxdata_local + new_window)) == bytes0) {
@@ -6158,8 +6269,397 @@ uint8_t* picoquic_format_bdp_frame(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t*
 /*
  * Decoding of the received frames.
  *
- * In some cases, the expected frames are "restricted" to only ACK, STREAM 0 and PADDING.
+ * Frames are dispatched on their first byte through a 256 entry table. Each
+ * entry lists the epochs in which the frame is allowed, the decoding and
+ * skipping functions, and whether the frame elicits an ACK, is a path probing
+ * frame, or can be part of a "pure ACK" packet. Entries without decoding
+ * function correspond to multi-byte or unassigned frame types, which are
+ * processed by the extension frame decoder after parsing the full type.
+ */
+
+#define PICOQUIC_FRAME_ACK_ELICITING 1
+#define PICOQUIC_FRAME_PATH_PROBING 2
+#define PICOQUIC_FRAME_PURE_ACK 4
+
+#define PICOQUIC_EPOCH_BIT_INITIAL (1 << picoquic_epoch_initial)
+#define PICOQUIC_EPOCH_BIT_0RTT (1 << picoquic_epoch_0rtt)
+#define PICOQUIC_EPOCH_BIT_HANDSHAKE (1 << picoquic_epoch_handshake)
+#define PICOQUIC_EPOCH_BIT_1RTT (1 << picoquic_epoch_1rtt)
+#define PICOQUIC_EPOCH_BIT_ALL 0x0f
+#define PICOQUIC_EPOCH_BIT_APP (PICOQUIC_EPOCH_BIT_0RTT | PICOQUIC_EPOCH_BIT_1RTT)
+#define PICOQUIC_EPOCH_BIT_NOT_0RTT (PICOQUIC_EPOCH_BIT_INITIAL | PICOQUIC_EPOCH_BIT_HANDSHAKE | PICOQUIC_EPOCH_BIT_1RTT)
+
+typedef struct st_picoquic_frame_decode_ctx_t {
+    picoquic_cnx_t* cnx;
+    picoquic_path_t* path_x;
+    picoquic_stream_data_node_t* received_data;
+    int epoch;
+    struct sockaddr* addr_from;
+    struct sockaddr* addr_to;
+    int path_is_not_allocated;
+    uint64_t current_time;
+    picoquic_packet_data_t* packet_data;
+    /* Set by the extension frame decoder */
+    int ack_needed;
+    int is_path_probing_frame;
+} picoquic_frame_decode_ctx_t;
+
+typedef const uint8_t* (*picoquic_frame_decode_fn)(const uint8_t* bytes, const uint8_t* bytes_max,
+    picoquic_frame_decode_ctx_t* ctx);
+typedef const uint8_t* (*picoquic_frame_skip_fn)(const uint8_t* bytes, const uint8_t* bytes_max);
+
+typedef struct st_picoquic_frame_dispatch_t {
+    picoquic_frame_decode_fn decode_fn;
+    picoquic_frame_skip_fn skip_fn;
+    uint8_t epoch_mask;
+    uint8_t flags;
+} picoquic_frame_dispatch_t;
+
+/* Skip functions defined with picoquic_skip_frame */
+static const uint8_t* picoquic_skip_stream_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_crypto_hs_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_connection_close_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_application_close_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_ack_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_ack_ecn_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_stream_reset_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_max_stream_data_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+static const uint8_t* picoquic_skip_stream_blocked_frame(const uint8_t* bytes, const uint8_t* bytes_max);
+
+static const uint8_t* picoquic_skip_1varint_frame(const uint8_t* bytes, const uint8_t* bytes_max)
+{
+    return picoquic_frames_varint_skip(bytes + 1, bytes_max);
+}
+
+static const uint8_t* picoquic_skip_1byte_frame(const uint8_t* bytes, const uint8_t* bytes_max)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(bytes_max);
+#endif
+    return bytes + 1;
+}
+
+static const uint8_t* picoquic_skip_path_challenge_frame(const uint8_t* bytes, const uint8_t* bytes_max)
+{
+    return picoquic_frames_fixed_skip(bytes + 1, bytes_max, challenge_length);
+}
+
+static const uint8_t* picoquic_skip_new_cid_frame(const uint8_t* bytes, const uint8_t* bytes_max)
+{
+    return picoquic_skip_new_connection_id_frame(bytes, bytes_max, 0);
+}
+
+static const uint8_t* picoquic_skip_retire_cid_frame(const uint8_t* bytes, const uint8_t* bytes_max)
+{
+    return picoquic_skip_retire_connection_id_frame(bytes, bytes_max, 0);
+}
+
+/* Adapters from the dispatch table to the frame decoding functions */
+static const uint8_t* picoquic_dispatch_padding_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(ctx);
+#endif
+    return picoquic_skip_0len_frame(bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_ack_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_ack_frame(ctx->cnx, bytes, bytes_max, ctx->current_time, ctx->epoch, 0, 0, ctx->packet_data);
+}
+
+static const uint8_t* picoquic_dispatch_ack_ecn_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_ack_frame(ctx->cnx, bytes, bytes_max, ctx->current_time, ctx->epoch, 1, 0, ctx->packet_data);
+}
+
+static const uint8_t* picoquic_dispatch_reset_stream_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_stream_reset_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_stop_sending_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_stop_sending_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_crypto_hs_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_crypto_hs_frame(ctx->cnx, bytes, bytes_max, ctx->received_data, ctx->epoch);
+}
+
+static const uint8_t* picoquic_dispatch_new_token_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_new_token_frame(ctx->cnx, bytes, bytes_max, ctx->current_time, ctx->addr_to);
+}
+
+static const uint8_t* picoquic_dispatch_stream_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_stream_frame(ctx->cnx, bytes, bytes_max, ctx->received_data, ctx->current_time);
+}
+
+static const uint8_t* picoquic_dispatch_max_data_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_max_data_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_max_stream_data_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_max_stream_data_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_max_streams_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_max_streams_frame(ctx->cnx, bytes, bytes_max, bytes[0]);
+}
+
+static const uint8_t* picoquic_dispatch_data_blocked_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_blocked_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_stream_data_blocked_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_stream_blocked_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_streams_blocked_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_streams_blocked_frame(ctx->cnx, bytes, bytes_max, bytes[0]);
+}
+
+static const uint8_t* picoquic_dispatch_new_connection_id_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_new_connection_id_frame(ctx->cnx, bytes, bytes_max, ctx->current_time, 0);
+}
+
+static const uint8_t* picoquic_dispatch_retire_connection_id_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_retire_connection_id_frame(ctx->cnx, bytes, bytes_max, ctx->current_time, ctx->path_x, 0);
+}
+
+static const uint8_t* picoquic_dispatch_path_challenge_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_path_challenge_frame(ctx->cnx, bytes, bytes_max,
+        (ctx->path_is_not_allocated) ? NULL : ctx->path_x, ctx->addr_from, ctx->addr_to);
+}
+
+static const uint8_t* picoquic_dispatch_path_response_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_path_response_frame(ctx->cnx, bytes, bytes_max,
+        (ctx->path_is_not_allocated) ? NULL : ctx->path_x, ctx->current_time);
+}
+
+static const uint8_t* picoquic_dispatch_connection_close_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_connection_close_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_application_close_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    return picoquic_decode_application_close_frame(ctx->cnx, bytes, bytes_max);
+}
+
+static const uint8_t* picoquic_dispatch_handshake_done_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(bytes_max);
+#endif
+    return picoquic_decode_handshake_done_frame(ctx->cnx, bytes, ctx->current_time);
+}
+
+static const uint8_t* picoquic_dispatch_datagram_frame(const uint8_t* bytes, const uint8_t* bytes_max, picoquic_frame_decode_ctx_t* ctx)
+{
+    /* Datagram carrying packets are acked, but not repeated */
+    return picoquic_decode_datagram_frame(ctx->cnx, ctx->path_x, bytes, bytes_max);
+}
+
+#define PICOQUIC_FRAME_DISPATCH_STREAM { picoquic_dispatch_stream_frame, picoquic_skip_stream_frame, \
+    PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING }
+#define PICOQUIC_FRAME_DISPATCH_EXTENSION { NULL, NULL, PICOQUIC_EPOCH_BIT_APP, 0 }
+#define PICOQUIC_FRAME_DISPATCH_EXTENSION_4 PICOQUIC_FRAME_DISPATCH_EXTENSION, PICOQUIC_FRAME_DISPATCH_EXTENSION, \
+    PICOQUIC_FRAME_DISPATCH_EXTENSION, PICOQUIC_FRAME_DISPATCH_EXTENSION
+#define PICOQUIC_FRAME_DISPATCH_EXTENSION_16 PICOQUIC_FRAME_DISPATCH_EXTENSION_4, PICOQUIC_FRAME_DISPATCH_EXTENSION_4, \
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_4, PICOQUIC_FRAME_DISPATCH_EXTENSION_4
+
+static const picoquic_frame_dispatch_t picoquic_frame_dispatch_table[256] = {
+    /* 0x00 padding */
+    { picoquic_dispatch_padding_frame, picoquic_skip_0len_frame, PICOQUIC_EPOCH_BIT_ALL,
+        PICOQUIC_FRAME_PATH_PROBING | PICOQUIC_FRAME_PURE_ACK },
+    /* 0x01 ping */
+    { picoquic_dispatch_padding_frame, picoquic_skip_0len_frame, PICOQUIC_EPOCH_BIT_ALL, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x02 ack */
+    { picoquic_dispatch_ack_frame, picoquic_skip_ack_frame, PICOQUIC_EPOCH_BIT_NOT_0RTT, PICOQUIC_FRAME_PURE_ACK },
+    /* 0x03 ack ecn */
+    { picoquic_dispatch_ack_ecn_frame, picoquic_skip_ack_ecn_frame, PICOQUIC_EPOCH_BIT_NOT_0RTT, PICOQUIC_FRAME_PURE_ACK },
+    /* 0x04 reset stream */
+    { picoquic_dispatch_reset_stream_frame, picoquic_skip_stream_reset_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x05 stop sending */
+    { picoquic_dispatch_stop_sending_frame, picoquic_skip_stop_sending_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x06 crypto */
+    { picoquic_dispatch_crypto_hs_frame, picoquic_skip_crypto_hs_frame, PICOQUIC_EPOCH_BIT_NOT_0RTT, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x07 new token */
+    { picoquic_dispatch_new_token_frame, picoquic_skip_new_token_frame, PICOQUIC_EPOCH_BIT_1RTT, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x08 - 0x0f stream */
+    PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM,
+    PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM, PICOQUIC_FRAME_DISPATCH_STREAM,
+    /* 0x10 max data */
+    { picoquic_dispatch_max_data_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x11 max stream data */
+    { picoquic_dispatch_max_stream_data_frame, picoquic_skip_max_stream_data_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x12 max streams bidir */
+    { picoquic_dispatch_max_streams_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x13 max streams unidir */
+    { picoquic_dispatch_max_streams_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x14 data blocked */
+    { picoquic_dispatch_data_blocked_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x15 stream data blocked */
+    { picoquic_dispatch_stream_data_blocked_frame, picoquic_skip_stream_blocked_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x16 streams blocked bidir */
+    { picoquic_dispatch_streams_blocked_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x17 streams blocked unidir */
+    { picoquic_dispatch_streams_blocked_frame, picoquic_skip_1varint_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x18 new connection id */
+    { picoquic_dispatch_new_connection_id_frame, picoquic_skip_new_cid_frame, PICOQUIC_EPOCH_BIT_APP,
+        PICOQUIC_FRAME_ACK_ELICITING | PICOQUIC_FRAME_PATH_PROBING },
+    /* 0x19 retire connection id */
+    { picoquic_dispatch_retire_connection_id_frame, picoquic_skip_retire_cid_frame, PICOQUIC_EPOCH_BIT_1RTT, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x1a path challenge */
+    { picoquic_dispatch_path_challenge_frame, picoquic_skip_path_challenge_frame, PICOQUIC_EPOCH_BIT_APP,
+        PICOQUIC_FRAME_PATH_PROBING | PICOQUIC_FRAME_PURE_ACK },
+    /* 0x1b path response */
+    { picoquic_dispatch_path_response_frame, picoquic_skip_path_challenge_frame, PICOQUIC_EPOCH_BIT_1RTT,
+        PICOQUIC_FRAME_PATH_PROBING | PICOQUIC_FRAME_PURE_ACK },
+    /* 0x1c connection close */
+    { picoquic_dispatch_connection_close_frame, picoquic_skip_connection_close_frame, PICOQUIC_EPOCH_BIT_ALL, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x1d application close */
+    { picoquic_dispatch_application_close_frame, picoquic_skip_application_close_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x1e handshake done */
+    { picoquic_dispatch_handshake_done_frame, picoquic_skip_1byte_frame, PICOQUIC_EPOCH_BIT_1RTT, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x1f - 0x2f, extensions and unassigned */
+    PICOQUIC_FRAME_DISPATCH_EXTENSION, PICOQUIC_FRAME_DISPATCH_EXTENSION_16,
+    /* 0x30 datagram */
+    { picoquic_dispatch_datagram_frame, picoquic_skip_datagram_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x31 datagram with length */
+    { picoquic_dispatch_datagram_frame, picoquic_skip_datagram_frame, PICOQUIC_EPOCH_BIT_APP, PICOQUIC_FRAME_ACK_ELICITING },
+    /* 0x32 - 0x3f, extensions and unassigned */
+    PICOQUIC_FRAME_DISPATCH_EXTENSION, PICOQUIC_FRAME_DISPATCH_EXTENSION,
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_4, PICOQUIC_FRAME_DISPATCH_EXTENSION_4, PICOQUIC_FRAME_DISPATCH_EXTENSION_4,
+    /* 0x40 - 0xff, first byte of multi-byte frame types */
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16,
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16,
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16,
+    PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16, PICOQUIC_FRAME_DISPATCH_EXTENSION_16
+};
+
+/* Decoding of frames whose type is not a single byte value listed in the
+ * dispatch table. These are not expected in 0-RTT packets, except for the BDP frame.
  */
+static const uint8_t* picoquic_decode_extension_frame(const uint8_t* bytes, const uint8_t* bytes_max,
+    picoquic_frame_decode_ctx_t* ctx)
+{
+    picoquic_cnx_t* cnx = ctx->cnx;
+    picoquic_path_t* path_x = ctx->path_x;
+    uint64_t current_time = ctx->current_time;
+    int epoch = ctx->epoch;
+    uint8_t first_byte = bytes[0];
+    uint64_t frame_id64;
+    const uint8_t* bytes0 = bytes;
+
+    if ((bytes = picoquic_frames_varint_decode(bytes, bytes_max, &frame_id64)) != NULL) {
+        if (epoch == picoquic_epoch_0rtt &&
+            frame_id64 != picoquic_frame_type_bdp) {
+            /* By default, extension frames should not be used in 0rtt */
+            picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
+            bytes = NULL;
+        }
+        else {
+            switch (frame_id64) {
+            case picoquic_frame_type_ack_frequency:
+                bytes = picoquic_decode_ack_frequency_frame(bytes, bytes_max, cnx);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_immediate_ack:
+                bytes = picoquic_decode_immediate_ack_frame(bytes, bytes_max, cnx, path_x, current_time);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_time_stamp:
+                bytes = picoquic_decode_time_stamp_frame(bytes, bytes_max, cnx, ctx->packet_data);
+                break;
+            case picoquic_frame_type_path_ack: {
+                bytes = picoquic_decode_ack_frame(cnx, bytes0, bytes_max, current_time, epoch, 0, 1, ctx->packet_data);
+                break;
+            }
+            case picoquic_frame_type_path_ack_ecn: {
+                bytes = picoquic_decode_ack_frame(cnx, bytes0, bytes_max, current_time, epoch, 1, 1, ctx->packet_data);
+                break;
+            }
+            case picoquic_frame_type_path_abandon:
+                bytes = picoquic_decode_path_abandon_frame(bytes, bytes_max, cnx, current_time);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_path_backup:
+            case picoquic_frame_type_path_available:
+                bytes = picoquic_decode_path_available_or_standby_frame(bytes, bytes_max, frame_id64, cnx, current_time);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_max_path_id:
+                bytes = picoquic_decode_max_path_id_frame(bytes, bytes_max, cnx);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_path_blocked:
+                bytes = picoquic_decode_path_blocked_frame(bytes, bytes_max, cnx);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_path_new_connection_id:
+                ctx->is_path_probing_frame = 1;
+                bytes = picoquic_decode_new_connection_id_frame(cnx, bytes0, bytes_max, current_time, 1);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_path_retire_connection_id:
+                bytes = picoquic_decode_retire_connection_id_frame(cnx, bytes0, bytes_max, current_time, path_x, 1);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_bdp:
+                if (cnx->client_mode && epoch != picoquic_epoch_1rtt) {
+                    DBG_PRINTF("BDP frame (0x%x) is expected in 1-RTT packet", first_byte);
+                    picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
+                    bytes = NULL;
+                    break;
+                }
+                if (!cnx->client_mode && epoch != picoquic_epoch_0rtt && epoch != picoquic_epoch_1rtt) {
+                    DBG_PRINTF("BDP frame (0x%x) is expected in 0-RTT packet", first_byte);
+                    picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
+                    bytes = NULL;
+                    break;
+                }
+                if (cnx->client_mode && cnx->local_parameters.enable_bdp_frame == 0) {
+                    DBG_PRINTF("BDP frame (0x%x) not expected", first_byte);
+                    picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
+                    bytes = NULL;
+                    break;
+                }
+
+                bytes = picoquic_decode_bdp_frame(cnx, bytes, bytes_max, current_time, ctx->addr_from, path_x);
+                ctx->ack_needed = 1;
+                break;
+            case picoquic_frame_type_observed_address_v4:
+            case picoquic_frame_type_observed_address_v6:
+                ctx->is_path_probing_frame = 1;
+                ctx->ack_needed = 1;
+                bytes = picoquic_decode_observed_address_frame(cnx, bytes, bytes_max, path_x, frame_id64);
+                break;
+            default:
+                /* Not implemented yet! */
+                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_FRAME_FORMAT_ERROR, frame_id64);
+                bytes = NULL;
+                break;
+            }
+        }
+    }
+
+    return bytes;
+}
 
 int picoquic_decode_frames(picoquic_cnx_t* cnx, picoquic_path_t * path_x, const uint8_t* bytes,
     size_t bytes_maxsize,
@@ -6175,255 +6675,80 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, picoquic_path_t * path_x, const
     int is_path_probing_packet = 1; /* Will be set to zero if non probing frame received */
     picoquic_packet_context_enum pc = picoquic_context_from_epoch(epoch);
     picoquic_packet_data_t packet_data;
+    picoquic_frame_decode_ctx_t ctx;
+    uint8_t epoch_bit = (uint8_t)(1 << epoch);
 
     memset(&packet_data, 0, sizeof(packet_data));
 
-    while (bytes != NULL && bytes < bytes_max) {
-        uint8_t first_byte = bytes[0];
-        int is_path_probing_frame = 0;
-
-        if (PICOQUIC_IN_RANGE(first_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-            if (epoch != picoquic_epoch_0rtt && epoch != picoquic_epoch_1rtt) {
-                DBG_PRINTF("Data frame (0x%x), when only TLS stream is expected", first_byte);
-                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                bytes = NULL;
-                break;
-            }
+    if (epoch == picoquic_epoch_1rtt) {
+        /* Fast path for the most common packets, which only carry ACK and STREAM
+         * frames. Both are allowed in 1-RTT packets and neither is a path probing
+         * frame, so there is no need for table lookups or epoch checks. The general
+         * loop below takes over at the first frame of any other type. */
+        const uint8_t* bytes_first = bytes;
 
-            bytes = picoquic_decode_stream_frame(cnx, bytes, bytes_max, received_data, current_time);
-            ack_needed = 1;
+        while (bytes < bytes_max) {
+            uint8_t first_byte = bytes[0];
 
-        }
-        else if (first_byte == picoquic_frame_type_ack) {
-            if (epoch == picoquic_epoch_0rtt) {
-                DBG_PRINTF("Ack frame (0x%x) not expected in 0-RTT packet", first_byte);
-                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                bytes = NULL;
+            if (PICOQUIC_IN_RANGE(first_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+                bytes = picoquic_decode_stream_frame(cnx, bytes, bytes_max, received_data, current_time);
+                ack_needed = 1;
+            }
+            else if (first_byte == picoquic_frame_type_ack) {
+                bytes = picoquic_decode_ack_frame(cnx, bytes, bytes_max, current_time, epoch, 0, 0, &packet_data);
+            }
+            else {
                 break;
             }
-            bytes = picoquic_decode_ack_frame(cnx, bytes, bytes_max, current_time, epoch, 0, 0, &packet_data);
-        }
-        else if (first_byte == picoquic_frame_type_ack_ecn) {
-            if (epoch == picoquic_epoch_0rtt) {
-                DBG_PRINTF("Ack-ECN frame (0x%x) not expected in 0-RTT packet", first_byte);
-                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                bytes = NULL;
+            if (bytes == NULL) {
                 break;
             }
-            bytes = picoquic_decode_ack_frame(cnx, bytes, bytes_max, current_time, epoch, 1, 0, &packet_data);
         }
-        else if (epoch != picoquic_epoch_0rtt && epoch != picoquic_epoch_1rtt && first_byte != picoquic_frame_type_padding
-            && first_byte != picoquic_frame_type_ping
-            && first_byte != picoquic_frame_type_connection_close
-            && first_byte != picoquic_frame_type_crypto_hs) {
-            picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-            bytes = NULL;
-            break;
+        if (bytes != bytes_first) {
+            is_path_probing_packet = 0;
         }
-        else if (epoch == picoquic_epoch_0rtt && (first_byte == picoquic_frame_type_crypto_hs
-            || first_byte == picoquic_frame_type_handshake_done
-            || first_byte == picoquic_frame_type_new_token
-            || first_byte == picoquic_frame_type_path_response
-            || first_byte == picoquic_frame_type_retire_connection_id)) {
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.cnx = cnx;
+    ctx.path_x = path_x;
+    ctx.received_data = received_data;
+    ctx.epoch = epoch;
+    ctx.addr_from = addr_from;
+    ctx.addr_to = addr_to;
+    ctx.path_is_not_allocated = path_is_not_allocated;
+    ctx.current_time = current_time;
+    ctx.packet_data = &packet_data;
+
+    while (bytes != NULL && bytes < bytes_max) {
+        uint8_t first_byte = bytes[0];
+        const picoquic_frame_dispatch_t* dispatch = &picoquic_frame_dispatch_table[first_byte];
+        int is_path_probing_frame = 0;
+
+        if ((dispatch->epoch_mask & epoch_bit) == 0) {
             /* From draft-31:
              * Note that it is not possible to send the following frames in 0-RTT
              * packets for various reasons : ACK, CRYPTO, HANDSHAKE_DONE, NEW_TOKEN,
              * PATH_RESPONSE, and RETIRE_CONNECTION_ID.A server MAY treat receipt
              * of these frames in 0 - RTT packets as a connection error of type
              * PROTOCOL_VIOLATION.
+             * Only PADDING, PING, ACK, CRYPTO and CONNECTION_CLOSE are expected
+             * in Initial and Handshake packets.
              */
+            DBG_PRINTF("Frame (0x%x) not expected in epoch %d", first_byte, epoch);
             picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
             bytes = NULL;
             break;
         }
+        else if (dispatch->decode_fn != NULL) {
+            bytes = dispatch->decode_fn(bytes, bytes_max, &ctx);
+            ack_needed |= dispatch->flags & PICOQUIC_FRAME_ACK_ELICITING;
+            is_path_probing_frame = (dispatch->flags & PICOQUIC_FRAME_PATH_PROBING) != 0;
+        }
         else {
-            switch (first_byte) {
-            case picoquic_frame_type_padding:
-                is_path_probing_frame = 1;
-                bytes = picoquic_skip_0len_frame(bytes, bytes_max);
-                break;
-            case picoquic_frame_type_reset_stream:
-                bytes = picoquic_decode_stream_reset_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_connection_close:
-                bytes = picoquic_decode_connection_close_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_application_close:
-                bytes = picoquic_decode_application_close_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_max_data:
-                bytes = picoquic_decode_max_data_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_max_stream_data:
-                bytes = picoquic_decode_max_stream_data_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_max_streams_bidir:
-            case picoquic_frame_type_max_streams_unidir:
-                bytes = picoquic_decode_max_streams_frame(cnx, bytes, bytes_max, first_byte);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_ping:
-                bytes = picoquic_skip_0len_frame(bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_data_blocked:
-                bytes = picoquic_decode_blocked_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_stream_data_blocked:
-                bytes = picoquic_decode_stream_blocked_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_streams_blocked_unidir:
-            case picoquic_frame_type_streams_blocked_bidir:
-                bytes = picoquic_decode_streams_blocked_frame(cnx, bytes, bytes_max, first_byte);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_new_connection_id:
-                is_path_probing_frame = 1;
-                bytes = picoquic_decode_new_connection_id_frame(cnx, bytes, bytes_max, current_time, 0);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_stop_sending:
-                bytes = picoquic_decode_stop_sending_frame(cnx, bytes, bytes_max);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_path_challenge:
-                is_path_probing_frame = 1;
-                bytes = picoquic_decode_path_challenge_frame(cnx, bytes, bytes_max, 
-                    (path_is_not_allocated)?NULL:path_x, addr_from, addr_to);
-                break;
-            case picoquic_frame_type_path_response:
-                is_path_probing_frame = 1;
-                bytes = picoquic_decode_path_response_frame(cnx, bytes, bytes_max,
-                    (path_is_not_allocated) ? NULL : path_x, current_time);
-                break;
-            case picoquic_frame_type_crypto_hs:
-                bytes = picoquic_decode_crypto_hs_frame(cnx, bytes, bytes_max, received_data, epoch);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_new_token:
-                bytes = picoquic_decode_new_token_frame(cnx, bytes, bytes_max, current_time, addr_to);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_retire_connection_id:
-                /* the old code point for ACK frames, but this is taken care of in the ACK tests above */
-                bytes = picoquic_decode_retire_connection_id_frame(cnx, bytes, bytes_max, current_time, path_x, 0);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_handshake_done:
-                bytes = picoquic_decode_handshake_done_frame(cnx, bytes, current_time);
-                ack_needed = 1;
-                break;
-            case picoquic_frame_type_datagram:
-            case picoquic_frame_type_datagram_l:
-                /* Datagram carrying packets are acked, but not repeated */
-                ack_needed = 1;
-                bytes = picoquic_decode_datagram_frame(cnx, path_x, bytes, bytes_max);
-                break;
-            default: {
-                uint64_t frame_id64;
-                const uint8_t* bytes0 = bytes;
-
-                if ((bytes = picoquic_frames_varint_decode(bytes, bytes_max, &frame_id64)) != NULL) {
-                    if (epoch == picoquic_epoch_0rtt &&
-                        frame_id64 != picoquic_frame_type_bdp) {
-                        /* By default, extension frames should not be used in 0rtt */
-                        picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                        bytes = NULL;
-                    }
-                    else {
-                        switch (frame_id64) {
-                        case picoquic_frame_type_ack_frequency:
-                            bytes = picoquic_decode_ack_frequency_frame(bytes, bytes_max, cnx);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_immediate_ack:
-                            bytes = picoquic_decode_immediate_ack_frame(bytes, bytes_max, cnx, path_x, current_time);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_time_stamp:
-                            bytes = picoquic_decode_time_stamp_frame(bytes, bytes_max, cnx, &packet_data);
-                            break;
-                        case picoquic_frame_type_path_ack: {
-                            bytes = picoquic_decode_ack_frame(cnx, bytes0, bytes_max, current_time, epoch, 0, 1, &packet_data);
-                            break;
-                        }
-                        case picoquic_frame_type_path_ack_ecn: {
-                            bytes = picoquic_decode_ack_frame(cnx, bytes0, bytes_max, current_time, epoch, 1, 1, &packet_data);
-                            break;
-                        }
-                        case picoquic_frame_type_path_abandon:
-                            bytes = picoquic_decode_path_abandon_frame(bytes, bytes_max, cnx, current_time);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_path_backup:
-                        case picoquic_frame_type_path_available:
-                            bytes = picoquic_decode_path_available_or_standby_frame(bytes, bytes_max, frame_id64, cnx, current_time);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_max_path_id:
-                            bytes = picoquic_decode_max_path_id_frame(bytes, bytes_max, cnx);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_path_blocked:
-                            bytes = picoquic_decode_path_blocked_frame(bytes, bytes_max, cnx);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_path_new_connection_id:
-                            is_path_probing_frame = 1;
-                            bytes = picoquic_decode_new_connection_id_frame(cnx, bytes0, bytes_max, current_time, 1);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_path_retire_connection_id:
-                            bytes = picoquic_decode_retire_connection_id_frame(cnx, bytes0, bytes_max, current_time, path_x, 1);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_bdp:
-                            if (cnx->client_mode && epoch != picoquic_epoch_1rtt) {
-                                DBG_PRINTF("BDP frame (0x%x) is expected in 1-RTT packet", first_byte);
-                                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                                bytes = NULL;
-                                break;
-                            }
-                            if (!cnx->client_mode && epoch != picoquic_epoch_0rtt && epoch != picoquic_epoch_1rtt) {
-                                DBG_PRINTF("BDP frame (0x%x) is expected in 0-RTT packet", first_byte);
-                                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, first_byte);
-                                bytes = NULL;
-                                break;
-                            }
-                            if (cnx->client_mode && cnx->local_parameters.enable_bdp_frame == 0) {
-                                DBG_PRINTF("BDP frame (0x%x) not expected", first_byte);
-                                picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
-                                bytes = NULL;
-                                break;
-                            }
-
-                            bytes = picoquic_decode_bdp_frame(cnx, bytes, bytes_max, current_time, addr_from, path_x);
-                            ack_needed = 1;
-                            break;
-                        case picoquic_frame_type_observed_address_v4:
-                        case picoquic_frame_type_observed_address_v6:
-                            is_path_probing_frame = 1;
-                            ack_needed = 1;
-                            bytes = picoquic_decode_observed_address_frame(cnx, bytes, bytes_max, path_x, frame_id64);
-                            break;
-                        default:
-                            /* Not implemented yet! */
-                            picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_FRAME_FORMAT_ERROR, frame_id64);
-                            bytes = NULL;
-                            break;
-                        }
-                    }
-                }
-                break;
-            }
-            }
+            ctx.is_path_probing_frame = 0;
+            bytes = picoquic_decode_extension_frame(bytes, bytes_max, &ctx);
+            is_path_probing_frame = ctx.is_path_probing_frame;
         }
         is_path_probing_packet &= is_path_probing_frame;
     }
@@ -6431,7 +6756,7 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, picoquic_path_t * path_x, const
     if (bytes != NULL) {
         process_decoded_packet_data(cnx, path_x, epoch, current_time, &packet_data);
 
-        if (ack_needed) {
+        if (ack_needed || ctx.ack_needed) {
             cnx->latest_receive_time = current_time;
             picoquic_set_ack_needed(cnx, current_time, pc, path_x, 0);
         }
@@ -6583,166 +6908,74 @@ static const uint8_t* picoquic_skip_stream_blocked_frame(const uint8_t* bytes, c
 int picoquic_skip_frame(const uint8_t* bytes, size_t bytes_maxsize, size_t* consumed, int* pure_ack)
 {
     const uint8_t *bytes_max = bytes + bytes_maxsize;
-    uint8_t first_byte = bytes[0];
+    const picoquic_frame_dispatch_t* dispatch = &picoquic_frame_dispatch_table[bytes[0]];
 
-    *pure_ack = 1;
-
-    if (PICOQUIC_IN_RANGE(first_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-        *pure_ack = 0;
-        bytes = picoquic_skip_stream_frame(bytes, bytes_max);
-    } else {
-        switch (first_byte) {
-        case picoquic_frame_type_ack:
-            bytes = picoquic_skip_ack_frame(bytes, bytes_max);
-            break;
-        case picoquic_frame_type_ack_ecn:
-            bytes = picoquic_skip_ack_ecn_frame(bytes, bytes_max);
-            break;
-        case picoquic_frame_type_padding:
-            bytes = picoquic_skip_0len_frame(bytes, bytes_max);
-            break;
-        case picoquic_frame_type_reset_stream:
-            bytes = picoquic_skip_stream_reset_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_connection_close: {
-            bytes = picoquic_skip_connection_close_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        }
-        case picoquic_frame_type_application_close: {
-            bytes = picoquic_skip_application_close_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        }
-        case picoquic_frame_type_max_data:
-            bytes = picoquic_frames_varint_skip(bytes+1, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_max_stream_data:
-            bytes = picoquic_skip_max_stream_data_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_max_streams_bidir:
-        case picoquic_frame_type_max_streams_unidir:
-            bytes = picoquic_frames_varint_skip(bytes+1, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_ping:
-            bytes = picoquic_skip_0len_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_data_blocked:
-            bytes = picoquic_frames_varint_skip(bytes+1, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_stream_data_blocked:
-            bytes = picoquic_skip_stream_blocked_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_streams_blocked_bidir:
-        case picoquic_frame_type_streams_blocked_unidir:
-            bytes = picoquic_frames_varint_skip(bytes+1, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_new_connection_id:
-            bytes = picoquic_skip_new_connection_id_frame(bytes, bytes_max, 0);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_stop_sending:
-            bytes = picoquic_skip_stop_sending_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_path_challenge:
-            bytes = picoquic_frames_fixed_skip(bytes+1, bytes_max, challenge_length);
-            break;
-        case picoquic_frame_type_path_response:
-            bytes = picoquic_frames_fixed_skip(bytes+1, bytes_max, challenge_length);
-            break;
-        case picoquic_frame_type_crypto_hs:
-            bytes = picoquic_skip_crypto_hs_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_new_token:
-            bytes = picoquic_skip_new_token_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_retire_connection_id:
-            bytes = picoquic_skip_retire_connection_id_frame(bytes, bytes_max, 0);
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_handshake_done:
-            bytes = bytes + 1;
-            *pure_ack = 0;
-            break;
-        case picoquic_frame_type_datagram:
-        case picoquic_frame_type_datagram_l:
-            bytes = picoquic_skip_datagram_frame(bytes, bytes_max);
-            *pure_ack = 0;
-            break;
-        default: {
-            uint64_t frame_id64;
-            const uint8_t * bytes_before_type = bytes;
-            if ((bytes = picoquic_frames_varint_decode(bytes, bytes_max, &frame_id64)) != NULL) {
-                switch (frame_id64) {
-                case picoquic_frame_type_ack_frequency:
-                    bytes = picoquic_skip_ack_frequency_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_immediate_ack:
-                    bytes = picoquic_skip_immediate_ack_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_time_stamp:
-                    bytes = picoquic_skip_time_stamp_frame(bytes, bytes_max);
-                    break;
-                case picoquic_frame_type_path_ack:
-                    bytes = picoquic_skip_ack_frame_maybe_ecn(bytes_before_type, bytes_max, 0, 1);
-                    break;
-                case picoquic_frame_type_path_ack_ecn:
-                    bytes = picoquic_skip_ack_frame_maybe_ecn(bytes_before_type, bytes_max, 1, 1);
-                    break;
-                case picoquic_frame_type_path_abandon:
-                    bytes = picoquic_skip_path_abandon_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_path_backup:
-                case picoquic_frame_type_path_available:
-                    bytes = picoquic_skip_path_available_or_standby_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_max_path_id:
-                    bytes = picoquic_skip_max_path_id_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_path_blocked:
-                    bytes = picoquic_skip_path_blocked_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_bdp:
-                    bytes = picoquic_skip_bdp_frame(bytes, bytes_max);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_path_new_connection_id:
-                    bytes = picoquic_skip_new_connection_id_frame(bytes_before_type, bytes_max, 1);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_path_retire_connection_id:
-                    bytes = picoquic_skip_retire_connection_id_frame(bytes_before_type, bytes_max, 1);
-                    *pure_ack = 0;
-                    break;
-                case picoquic_frame_type_observed_address_v4:
-                case picoquic_frame_type_observed_address_v6:
-                    bytes = picoquic_skip_observed_address_frame(bytes, bytes_max, frame_id64);
-                    *pure_ack = 0;
-                    break;
-                default:
-                    /* Not implemented yet! */
-                    bytes = NULL;
-                }
+    if (dispatch->skip_fn != NULL) {
+        *pure_ack = (dispatch->flags & PICOQUIC_FRAME_PURE_ACK) != 0;
+        bytes = dispatch->skip_fn(bytes, bytes_max);
+    }
+    else {
+        uint64_t frame_id64;
+        const uint8_t * bytes_before_type = bytes;
+
+        *pure_ack = 1;
+        if ((bytes = picoquic_frames_varint_decode(bytes, bytes_max, &frame_id64)) != NULL) {
+            switch (frame_id64) {
+            case picoquic_frame_type_ack_frequency:
+                bytes = picoquic_skip_ack_frequency_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_immediate_ack:
+                bytes = picoquic_skip_immediate_ack_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_time_stamp:
+                bytes = picoquic_skip_time_stamp_frame(bytes, bytes_max);
+                break;
+            case picoquic_frame_type_path_ack:
+                bytes = picoquic_skip_ack_frame_maybe_ecn(bytes_before_type, bytes_max, 0, 1);
+                break;
+            case picoquic_frame_type_path_ack_ecn:
+                bytes = picoquic_skip_ack_frame_maybe_ecn(bytes_before_type, bytes_max, 1, 1);
+                break;
+            case picoquic_frame_type_path_abandon:
+                bytes = picoquic_skip_path_abandon_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_path_backup:
+            case picoquic_frame_type_path_available:
+                bytes = picoquic_skip_path_available_or_standby_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_max_path_id:
+                bytes = picoquic_skip_max_path_id_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_path_blocked:
+                bytes = picoquic_skip_path_blocked_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_bdp:
+                bytes = picoquic_skip_bdp_frame(bytes, bytes_max);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_path_new_connection_id:
+                bytes = picoquic_skip_new_connection_id_frame(bytes_before_type, bytes_max, 1);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_path_retire_connection_id:
+                bytes = picoquic_skip_retire_connection_id_frame(bytes_before_type, bytes_max, 1);
+                *pure_ack = 0;
+                break;
+            case picoquic_frame_type_observed_address_v4:
+            case picoquic_frame_type_observed_address_v6:
+                bytes = picoquic_skip_observed_address_frame(bytes, bytes_max, frame_id64);
+                *pure_ack = 0;
+                break;
+            default:
+                /* Not implemented yet! */
+                bytes = NULL;
             }
-            break;
-        }
         }
     }
 
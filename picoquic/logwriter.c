@@ -24,6 +24,7 @@
 */
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include "picoquic_binlog.h"
 #include "bytestream.h"
 #include "tls_api.h"
@@ -58,18 +59,21 @@ static const uint8_t* picoquic_log_length(const uint8_t* bytes, const uint8_t* b
     return (len == 0 || *nsz != n64) ? NULL : bytes + len;
 }
 
-static void picoquic_binlog_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static void picoquic_binlog_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     if (bytes != NULL && bytes_max != NULL) {
         size_t len = bytes_max - bytes;
         uint8_t varlen[8];
         size_t l_varlen = picoquic_varint_encode(varlen, 8, len);
-        fwrite(varlen, 1, l_varlen, f);
-        fwrite(bytes, 1, len, f);
+        /* Frames that do not fit are skipped, so the event remains well formed */
+        if (l_varlen > 0 && l_varlen + len <= bytestream_remain(s)) {
+            (void)bytewrite_buffer(s, varlen, l_varlen);
+            (void)bytewrite_buffer(s, bytes, len);
+        }
     }
 }
 
-static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stream_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint8_t ftype = bytes[0];
@@ -101,7 +105,7 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
             extra_bytes = length;
         }
         if (has_length) {
-            picoquic_binlog_frame(f, bytes_begin, bytes + extra_bytes);
+            picoquic_binlog_frame(s, bytes_begin, bytes + extra_bytes);
         }
         else {
             uint8_t* log_next = log_buffer;
@@ -112,10 +116,10 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
             if ((log_next = picoquic_frames_varint_encode(log_next, log_buffer + 256, length)) != NULL) {
                 memcpy(log_next, bytes, extra_bytes);
                 log_next += extra_bytes;
-                picoquic_binlog_frame(f, log_buffer, log_next);
+                picoquic_binlog_frame(s, log_buffer, log_next);
             }
             else {
-                picoquic_binlog_frame(f, log_buffer, log_buffer + l_head);
+                picoquic_binlog_frame(s, log_buffer, log_buffer + l_head);
             }
         }
 
@@ -127,12 +131,12 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
         if (length > 26) {
             length = 26;
         }
-        picoquic_binlog_frame(f, bytes_begin, bytes_begin + length);
+        picoquic_binlog_frame(s, bytes_begin, bytes_begin + length);
     }
     return bytes;
 }
 
-static const uint8_t* picoquic_log_ack_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_ack_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint64_t ftype = 0;
@@ -163,11 +167,11 @@ static const uint8_t* picoquic_log_ack_frame(FILE* f, const uint8_t* bytes, cons
         bytes = picoquic_log_varint_skip(bytes, bytes_max);
     }
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_reset_stream_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_reset_stream_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t * bytes_begin = bytes;
 
@@ -176,11 +180,11 @@ static const uint8_t* picoquic_log_reset_stream_frame(FILE* f, const uint8_t* by
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_stop_sending_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stop_sending_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -188,11 +192,11 @@ static const uint8_t* picoquic_log_stop_sending_frame(FILE* f, const uint8_t* by
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_close_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_close_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -203,11 +207,11 @@ static const uint8_t* picoquic_log_close_frame(FILE* f, const uint8_t* bytes, co
     bytes = picoquic_log_length(bytes, bytes_max, &length);
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_app_close_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_app_close_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -217,22 +221,22 @@ static const uint8_t* picoquic_log_app_close_frame(FILE* f, const uint8_t* bytes
     bytes = picoquic_log_length(bytes, bytes_max, &length);
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_data_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_data_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_stream_data_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_stream_data_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -240,33 +244,33 @@ static const uint8_t* picoquic_log_max_stream_data_frame(FILE* f, const uint8_t*
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_stream_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_stream_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_stream_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stream_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -274,22 +278,22 @@ static const uint8_t* picoquic_log_stream_blocked_frame(FILE* f, const uint8_t*
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_streams_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_streams_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_new_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_new_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -302,11 +306,11 @@ static const uint8_t* picoquic_log_new_connection_id_frame(FILE* f, const uint8_
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, PICOQUIC_RESET_SECRET_SIZE);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_new_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_new_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -320,22 +324,22 @@ static const uint8_t* picoquic_log_path_new_connection_id_frame(FILE* f, const u
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, PICOQUIC_RESET_SECRET_SIZE);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_retire_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_retire_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_retire_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_retire_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -343,11 +347,11 @@ static const uint8_t* picoquic_log_path_retire_connection_id_frame(FILE* f, cons
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_new_token_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_new_token_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -357,21 +361,21 @@ static const uint8_t* picoquic_log_new_token_frame(FILE* f, const uint8_t* bytes
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1 + 8);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_crypto_hs_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_crypto_hs_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -380,24 +384,24 @@ static const uint8_t* picoquic_log_crypto_hs_frame(FILE* f, const uint8_t* bytes
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_length(bytes, bytes_max, &length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
     return bytes;
 }
 
 
-static const uint8_t* picoquic_log_handshake_done_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_handshake_done_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_datagram_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_datagram_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint8_t ftype = bytes[0];
@@ -411,46 +415,46 @@ static const uint8_t* picoquic_log_datagram_frame(FILE* f, const uint8_t* bytes,
         length = bytes_max - bytes;
     }
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_time_stamp_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_time_stamp_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* time stamp as varint */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_abandon_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_abandon_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
     bytes = picoquic_skip_path_abandon_frame(bytes, bytes_max); /* skip abandon frame */
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_available_or_backup_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_available_or_backup_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
     bytes = picoquic_skip_path_available_or_standby_frame(bytes, bytes_max); /* skip available or standby frame */
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
 
-static const uint8_t* picoquic_log_ack_frequency_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_ack_frequency_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -460,34 +464,34 @@ static const uint8_t* picoquic_log_ack_frequency_frame(FILE* f, const uint8_t* b
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* Max ACK delay */
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* Reordering threshold */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_immediate_ack_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_immediate_ack_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_erroring_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_erroring_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     size_t frame_size = bytes_max - bytes;
     size_t copied = (frame_size > 8) ? 8 : frame_size;
 
-    picoquic_binlog_frame(f, bytes, bytes + copied);
+    picoquic_binlog_frame(s, bytes, bytes + copied);
 
     return NULL;
 }
 
-static const uint8_t* picoquic_log_padding(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_padding(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
-    picoquic_binlog_frame(f, bytes, bytes + 1);
+    picoquic_binlog_frame(s, bytes, bytes + 1);
 
     uint8_t ftype = bytes[0];
     while (bytes < bytes_max && bytes[0] == ftype) {
@@ -497,7 +501,7 @@ static const uint8_t* picoquic_log_padding(FILE* f, const uint8_t* bytes, const
     return bytes;
 }
 
-static const uint8_t* picoquic_log_bdp_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_bdp_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t ip_len = 0;
@@ -509,12 +513,12 @@ static const uint8_t* picoquic_log_bdp_frame(FILE* f, const uint8_t* bytes, cons
     bytes = picoquic_log_length(bytes, bytes_max, &ip_len); /*  IP Address length */
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, ip_len); /* IP address value */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_observed_address_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max, uint64_t ftype)
+static const uint8_t* picoquic_log_observed_address_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max, uint64_t ftype)
 {
     const uint8_t* bytes_begin = bytes;
     size_t ip_len = ((ftype & 1) == 0) ? 4 : 16;
@@ -525,12 +529,12 @@ static const uint8_t* picoquic_log_observed_address_frame(FILE* f, const uint8_t
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* Sequence number */
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, data_len); /* IP address and port */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
+static void binlog_frames_compose(bytestream* s, const uint8_t* bytes, size_t length)
 {
     const uint8_t* bytes_max = bytes + length;
 
@@ -550,7 +554,7 @@ void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
         }
 
         if (PICOQUIC_IN_RANGE(ftype, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-            bytes = picoquic_log_stream_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stream_frame(s, bytes, bytes_max);
             continue;
         }
 
@@ -559,103 +563,120 @@ void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
         case picoquic_frame_type_ack_ecn:
         case picoquic_frame_type_path_ack:
         case picoquic_frame_type_path_ack_ecn:
-            bytes = picoquic_log_ack_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_ack_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_retire_connection_id:
-            bytes = picoquic_log_retire_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_retire_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_retire_connection_id:
-            bytes = picoquic_log_path_retire_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_retire_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_padding:
         case picoquic_frame_type_ping:
-            bytes = picoquic_log_padding(f, bytes, bytes_max);
+            bytes = picoquic_log_padding(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_reset_stream:
-            bytes = picoquic_log_reset_stream_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_reset_stream_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_connection_close:
-            bytes = picoquic_log_close_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_close_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_application_close:
-            bytes = picoquic_log_app_close_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_app_close_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_data:
-            bytes = picoquic_log_max_data_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_data_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_stream_data:
-            bytes = picoquic_log_max_stream_data_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_stream_data_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_streams_bidir:
         case picoquic_frame_type_max_streams_unidir:
-            bytes = picoquic_log_max_stream_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_stream_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_data_blocked:
-            bytes = picoquic_log_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_stream_data_blocked:
-            bytes = picoquic_log_stream_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stream_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_streams_blocked_bidir:
         case picoquic_frame_type_streams_blocked_unidir:
-            bytes = picoquic_log_streams_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_streams_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_new_connection_id:
-            bytes = picoquic_log_new_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_new_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_new_connection_id:
-            bytes = picoquic_log_path_new_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_new_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_stop_sending:
-            bytes = picoquic_log_stop_sending_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stop_sending_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_challenge:
         case picoquic_frame_type_path_response:
-            bytes = picoquic_log_path_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_crypto_hs:
-            bytes = picoquic_log_crypto_hs_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_crypto_hs_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_new_token:
-            bytes = picoquic_log_new_token_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_new_token_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_handshake_done:
-            bytes = picoquic_log_handshake_done_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_handshake_done_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_datagram:
         case picoquic_frame_type_datagram_l:
-            bytes = picoquic_log_datagram_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_datagram_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_ack_frequency:
-            bytes = picoquic_log_ack_frequency_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_ack_frequency_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_immediate_ack:
-            bytes = picoquic_log_immediate_ack_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_immediate_ack_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_time_stamp:
-            bytes = picoquic_log_time_stamp_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_time_stamp_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_abandon:
-            bytes = picoquic_log_path_abandon_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_abandon_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_backup:
         case picoquic_frame_type_path_available:
-            bytes = picoquic_log_path_available_or_backup_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_available_or_backup_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_bdp:
-            bytes = picoquic_log_bdp_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_bdp_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_observed_address_v4:
         case picoquic_frame_type_observed_address_v6:
-            bytes = picoquic_log_observed_address_frame(f, bytes, bytes_max, ftype);
+            bytes = picoquic_log_observed_address_frame(s, bytes, bytes_max, ftype);
             break;
         default:
-            bytes = picoquic_log_erroring_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_erroring_frame(s, bytes, bytes_max);
             break;
         }
     }
 }
 
+void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
+{
+    /* Each frame is logged with a length prefix, so the log of a series of
+     * single byte frames can be about twice as large as the frames. */
+    size_t log_size = 2 * length + 16;
+    uint8_t* log_buffer = (uint8_t*)malloc(log_size);
+
+    if (log_buffer != NULL) {
+        bytestream stream;
+        bytestream* s = bytestream_ref_init(&stream, log_buffer, log_size);
+
+        binlog_frames_compose(s, bytes, length);
+        (void)fwrite(bytestream_data(s), bytestream_length(s), 1, f);
+        free(log_buffer);
+    }
+}
+
 static void binlog_compose_event_header(bytestream* msg, const picoquic_connection_id_t* cid, uint64_t current_time,
     uint64_t path_id, picoquic_log_event_type event_type)
 {
@@ -677,12 +698,603 @@ static uint64_t binlog_get_path_id(picoquic_cnx_t* cnx, picoquic_path_t* path_x)
     return path_id;
 }
 
-void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
-    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+/*
+ * Asynchronous writer.
+ *
+ * Each QUIC context using the writer appends events to its own ring. The
+ * context runs on a single thread, so the ring has a single producer and
+ * a single consumer, the writer thread, and needs no lock: the producer
+ * advances the head after copying a record, the consumer advances the
+ * tail after writing it to the file. The positions are never wrapped, and
+ * records are aligned on 16 bytes so that the space left at the end of
+ * the ring can always hold a padding record.
+ *
+ * Files are closed through the ring, after their last events. Some space
+ * is reserved for these close records, so that they are not blocked by
+ * a burst of events.
+ */
+#define BINLOG_RECORD_ALIGN 16
+#define BINLOG_RECORD_HEADER_SIZE ((sizeof(picoquic_binlog_record_t) + BINLOG_RECORD_ALIGN - 1) & ~((size_t)BINLOG_RECORD_ALIGN - 1))
+#define BINLOG_RECORD_SIZE(length) (BINLOG_RECORD_HEADER_SIZE + (((length) + BINLOG_RECORD_ALIGN - 1) & ~((uint64_t)BINLOG_RECORD_ALIGN - 1)))
+#define BINLOG_RING_SIZE_MIN 0x10000
+#define BINLOG_RING_SIZE_MAX 0x40000000
+#define BINLOG_RING_CLOSE_RESERVE 0x1000
+#define BINLOG_WRITER_WAIT 10000
+
+typedef enum {
+    binlog_record_data = 0,
+    binlog_record_close,
+    binlog_record_padding
+} binlog_record_type_enum;
+
+typedef struct st_picoquic_binlog_record_t {
+    FILE* f;
+    uint32_t length;
+    uint32_t record_type;
+} picoquic_binlog_record_t;
+
+typedef struct st_picoquic_binlog_ring_t {
+    struct st_picoquic_binlog_ring_t* next_ring;
+    picoquic_binlog_writer_t* writer;
+    uint8_t* buffer;
+    uint64_t size;
+    volatile uint64_t head;
+    volatile uint64_t tail;
+    volatile uint64_t nb_events_dropped;
+    volatile uint64_t nb_bytes_dropped;
+    int is_attached;
+} picoquic_binlog_ring_t;
+
+struct st_picoquic_binlog_writer_t {
+    picoquic_thread_t thread;
+    picoquic_mutex_t ring_mutex;
+    picoquic_event_t wake_event;
+    picoquic_event_t drained_event;
+    picoquic_binlog_ring_t* first_ring;
+    size_t ring_size;
+    volatile int should_stop;
+    volatile int is_paused;
+    volatile uint64_t nb_events_written;
+    volatile uint64_t nb_bytes_written;
+};
+
+/* Copy a record to the ring. Data records are dropped if the ring is
+ * full, other records fail and the caller retries after the writer
+ * made some room. */
+static int binlog_ring_push(picoquic_binlog_ring_t* ring, FILE* f, binlog_record_type_enum record_type,
+    const uint8_t* data1, size_t length1, const uint8_t* data2, size_t length2)
+{
+    int ret = 0;
+    size_t length = length1 + length2;
+    uint64_t record_size = BINLOG_RECORD_SIZE(length);
+    uint64_t head = ring->head;
+    uint64_t tail = picoquic_atomic_load_uint64(&ring->tail);
+    uint64_t ring_offset = head & (ring->size - 1);
+    uint64_t padding = (ring_offset + record_size > ring->size) ? ring->size - ring_offset : 0;
+    uint64_t reserve = (record_type == binlog_record_data) ? BINLOG_RING_CLOSE_RESERVE : 0;
+
+    if (head - tail + padding + record_size + reserve > ring->size) {
+        if (record_type == binlog_record_data) {
+            picoquic_atomic_store_uint64(&ring->nb_events_dropped, ring->nb_events_dropped + 1);
+            picoquic_atomic_store_uint64(&ring->nb_bytes_dropped, ring->nb_bytes_dropped + length);
+        }
+        ret = -1;
+    }
+    else {
+        picoquic_binlog_record_t* record;
+        int should_wake = (head - tail < ring->size / 2 && head + padding + record_size - tail >= ring->size / 2);
+
+        if (padding > 0) {
+            record = (picoquic_binlog_record_t*)(ring->buffer + ring_offset);
+            record->f = NULL;
+            record->length = (uint32_t)(padding - BINLOG_RECORD_HEADER_SIZE);
+            record->record_type = binlog_record_padding;
+            head += padding;
+            ring_offset = 0;
+        }
+        record = (picoquic_binlog_record_t*)(ring->buffer + ring_offset);
+        record->f = f;
+        record->length = (uint32_t)length;
+        record->record_type = record_type;
+        if (length1 > 0) {
+            memcpy(ring->buffer + ring_offset + BINLOG_RECORD_HEADER_SIZE, data1, length1);
+        }
+        if (length2 > 0) {
+            memcpy(ring->buffer + ring_offset + BINLOG_RECORD_HEADER_SIZE + length1, data2, length2);
+        }
+        picoquic_atomic_store_uint64(&ring->head, head + record_size);
+        /* The writer polls the rings, it is only woken up if the ring fills up */
+        if (should_wake) {
+            (void)picoquic_signal_event(&ring->writer->wake_event);
+        }
+    }
+
+    return ret;
+}
+
+/* Wait until the writer thread has processed the ring up to the position.
+ * This is only used when closing a file if the log is converted immediately,
+ * when a connection changes ring, or if the ring has no room for a close. */
+static void binlog_ring_wait(picoquic_binlog_ring_t* ring, uint64_t position)
+{
+    while (picoquic_atomic_load_uint64(&ring->tail) < position) {
+        (void)picoquic_signal_event(&ring->writer->wake_event);
+        (void)picoquic_wait_for_event(&ring->writer->drained_event, 1000);
+    }
+}
+
+/* Write the records queued in the ring. Called by the writer thread */
+static int binlog_ring_drain(picoquic_binlog_writer_t* writer, picoquic_binlog_ring_t* ring)
+{
+    int nb_records = 0;
+    uint64_t tail = ring->tail;
+    uint64_t head = picoquic_atomic_load_uint64(&ring->head);
+    uint64_t nb_events = 0;
+    uint64_t nb_bytes = 0;
+
+    while (tail < head) {
+        picoquic_binlog_record_t* record = (picoquic_binlog_record_t*)(ring->buffer + (tail & (ring->size - 1)));
+
+        if (record->record_type == binlog_record_data) {
+            if (record->length > 0) {
+                (void)fwrite((uint8_t*)record + BINLOG_RECORD_HEADER_SIZE, record->length, 1, record->f);
+            }
+            nb_events++;
+            nb_bytes += record->length;
+        }
+        else if (record->record_type == binlog_record_close) {
+            (void)picoquic_file_close(record->f);
+        }
+        tail += BINLOG_RECORD_SIZE(record->length);
+        picoquic_atomic_store_uint64(&ring->tail, tail);
+        nb_records++;
+    }
+
+    if (nb_events > 0) {
+        picoquic_atomic_store_uint64(&writer->nb_events_written, writer->nb_events_written + nb_events);
+        picoquic_atomic_store_uint64(&writer->nb_bytes_written, writer->nb_bytes_written + nb_bytes);
+    }
+
+    return nb_records;
+}
+
+static picoquic_thread_return_t binlog_writer_thread(void* arg)
+{
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)arg;
+
+    while (1) {
+        int should_stop = writer->should_stop;
+        int nb_records = 0;
+
+        if (writer->is_paused && !should_stop) {
+            (void)picoquic_wait_for_event(&writer->wake_event, BINLOG_WRITER_WAIT);
+            continue;
+        }
+
+        (void)picoquic_lock_mutex(&writer->ring_mutex);
+        for (picoquic_binlog_ring_t* ring = writer->first_ring; ring != NULL; ring = ring->next_ring) {
+            nb_records += binlog_ring_drain(writer, ring);
+        }
+        (void)picoquic_unlock_mutex(&writer->ring_mutex);
+
+        if (nb_records > 0) {
+            (void)picoquic_signal_event(&writer->drained_event);
+        }
+        else if (should_stop) {
+            /* All records queued before the stop request are written */
+            break;
+        }
+        else {
+            (void)picoquic_wait_for_event(&writer->wake_event, BINLOG_WRITER_WAIT);
+        }
+    }
+
+    picoquic_thread_do_return;
+}
+
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size)
+{
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)malloc(sizeof(picoquic_binlog_writer_t));
+
+    if (writer != NULL) {
+        int has_mutex = 0;
+        int has_wake_event = 0;
+        int has_drained_event = 0;
+
+        memset(writer, 0, sizeof(picoquic_binlog_writer_t));
+        writer->ring_size = BINLOG_RING_SIZE_MIN;
+        while (writer->ring_size < ring_size && writer->ring_size < BINLOG_RING_SIZE_MAX) {
+            writer->ring_size <<= 1;
+        }
+
+        if ((has_mutex = (picoquic_create_mutex(&writer->ring_mutex) == 0)) == 0 ||
+            (has_wake_event = (picoquic_create_event(&writer->wake_event) == 0)) == 0 ||
+            (has_drained_event = (picoquic_create_event(&writer->drained_event) == 0)) == 0 ||
+            picoquic_create_thread(&writer->thread, binlog_writer_thread, writer) != 0) {
+            DBG_PRINTF("%s", "Cannot start the binlog writer thread.\n");
+            if (has_drained_event) {
+                picoquic_delete_event(&writer->drained_event);
+            }
+            if (has_wake_event) {
+                picoquic_delete_event(&writer->wake_event);
+            }
+            if (has_mutex) {
+                (void)picoquic_delete_mutex(&writer->ring_mutex);
+            }
+            free(writer);
+            writer = NULL;
+        }
+    }
+
+    return writer;
+}
+
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer)
 {
+    if (writer != NULL) {
+        (void)picoquic_atomic_exchange_int(&writer->should_stop, 1);
+        (void)picoquic_signal_event(&writer->wake_event);
+        (void)picoquic_wait_thread(writer->thread);
+
+        while (writer->first_ring != NULL) {
+            picoquic_binlog_ring_t* ring = writer->first_ring;
+            writer->first_ring = ring->next_ring;
+            free(ring->buffer);
+            free(ring);
+        }
+        picoquic_delete_event(&writer->drained_event);
+        picoquic_delete_event(&writer->wake_event);
+        (void)picoquic_delete_mutex(&writer->ring_mutex);
+        free(writer);
+    }
+}
+
+void picoquic_binlog_writer_get_stats(picoquic_binlog_writer_t* writer, picoquic_binlog_writer_stats_t* stats)
+{
+    memset(stats, 0, sizeof(picoquic_binlog_writer_stats_t));
+    stats->nb_events_written = picoquic_atomic_load_uint64(&writer->nb_events_written);
+    stats->nb_bytes_written = picoquic_atomic_load_uint64(&writer->nb_bytes_written);
+
+    (void)picoquic_lock_mutex(&writer->ring_mutex);
+    for (picoquic_binlog_ring_t* ring = writer->first_ring; ring != NULL; ring = ring->next_ring) {
+        stats->nb_events_dropped += picoquic_atomic_load_uint64(&ring->nb_events_dropped);
+        stats->nb_bytes_dropped += picoquic_atomic_load_uint64(&ring->nb_bytes_dropped);
+    }
+    (void)picoquic_unlock_mutex(&writer->ring_mutex);
+}
+
+void picoquic_binlog_writer_pause(picoquic_binlog_writer_t* writer, int is_paused)
+{
+    (void)picoquic_atomic_exchange_int(&writer->is_paused, is_paused);
+    (void)picoquic_signal_event(&writer->wake_event);
+}
+
+/* Attach a ring of the writer to the context. Rings are only freed with
+ * the writer, because connections may still refer to the ring of a context
+ * that was freed. Rings that are detached and empty are reused. */
+static picoquic_binlog_ring_t* binlog_writer_attach_ring(picoquic_binlog_writer_t* writer)
+{
+    picoquic_binlog_ring_t* ring;
+
+    (void)picoquic_lock_mutex(&writer->ring_mutex);
+    for (ring = writer->first_ring; ring != NULL; ring = ring->next_ring) {
+        if (!ring->is_attached && ring->tail == ring->head) {
+            break;
+        }
+    }
+    if (ring == NULL && (ring = (picoquic_binlog_ring_t*)malloc(sizeof(picoquic_binlog_ring_t))) != NULL) {
+        memset(ring, 0, sizeof(picoquic_binlog_ring_t));
+        if ((ring->buffer = (uint8_t*)malloc(writer->ring_size)) == NULL) {
+            free(ring);
+            ring = NULL;
+        }
+        else {
+            ring->writer = writer;
+            ring->size = writer->ring_size;
+            ring->next_ring = writer->first_ring;
+            writer->first_ring = ring;
+        }
+    }
+    if (ring != NULL) {
+        ring->is_attached = 1;
+    }
+    (void)picoquic_unlock_mutex(&writer->ring_mutex);
+
+    return ring;
+}
+
+static void binlog_writer_detach_ring(picoquic_binlog_ring_t* ring)
+{
+    (void)picoquic_lock_mutex(&ring->writer->ring_mutex);
+    ring->is_attached = 0;
+    (void)picoquic_unlock_mutex(&ring->writer->ring_mutex);
+}
+
+/* Select the ring used for the log of the connection. A connection that
+ * moved to another context, or whose context changed writer, keeps using
+ * the previous ring until the events queued there are written, so the
+ * events are never reordered in the file. */
+static void binlog_check_ring(picoquic_cnx_t* cnx)
+{
+    picoquic_binlog_ring_t* ring = cnx->quic->binlog_ring;
+
+    if (cnx->binlog_ring != ring) {
+        if (cnx->binlog_ring != NULL) {
+            binlog_ring_wait(cnx->binlog_ring, cnx->binlog_ring_position);
+        }
+        else if (cnx->f_binlog != NULL) {
+            long offset = ftell(cnx->f_binlog);
+            cnx->binlog_file_offset = (offset > 0) ? (uint64_t)offset : 0;
+        }
+        cnx->binlog_ring = ring;
+        cnx->binlog_ring_position = 0;
+    }
+}
+
+/* Offset in the log file of the next event of the connection */
+static uint64_t binlog_get_offset(picoquic_cnx_t* cnx)
+{
+    uint64_t offset = cnx->binlog_file_offset;
+
+    if (cnx->binlog_ring == NULL) {
+        long file_offset = ftell(cnx->f_binlog);
+        offset = (file_offset > 0) ? (uint64_t)file_offset : 0;
+    }
+
+    return offset;
+}
+
+/* Queue an event in the ring of the connection */
+static int binlog_push_event(picoquic_cnx_t* cnx, const uint8_t* head, size_t head_length,
+    const uint8_t* msg, size_t msg_length)
+{
+    int ret = binlog_ring_push(cnx->binlog_ring, cnx->f_binlog, binlog_record_data,
+        head, head_length, msg, msg_length);
+
+    if (ret == 0) {
+        cnx->binlog_ring_position = cnx->binlog_ring->head;
+        cnx->binlog_file_offset += head_length + msg_length;
+    }
+
+    return ret;
+}
+
+/* Queue an info message with the number of events dropped since the
+ * last event queued for the connection. */
+static int binlog_push_drop_marker(picoquic_cnx_t* cnx)
+{
+    int ret;
     bytestream_buf stream_msg;
-    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    bytestream* msg = bytestream_buf_init(&stream_msg, 128);
+    char text[64];
+    size_t text_length = 0;
+
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_info_message);
+    (void)picoquic_sprintf(text, sizeof(text), &text_length, "%" PRIu64 " events dropped", cnx->binlog_nb_dropped);
+    bytewrite_buffer(msg, text, text_length);
 
+    bytestream_buf stream_head;
+    bytestream* head = bytestream_buf_init(&stream_head, 8);
+    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
+
+    if ((ret = binlog_push_event(cnx, bytestream_data(head), bytestream_length(head),
+        bytestream_data(msg), bytestream_length(msg))) == 0) {
+        cnx->binlog_nb_dropped = 0;
+    }
+
+    return ret;
+}
+
+/* Write an event to the log of the connection, either directly or through
+ * the ring of the context. The event is passed in one or two parts. */
+static void binlog_write_event(picoquic_cnx_t* cnx, const uint8_t* head, size_t head_length,
+    const uint8_t* msg, size_t msg_length)
+{
+    binlog_check_ring(cnx);
+
+    if (cnx->binlog_ring == NULL) {
+        if (head_length > 0) {
+            (void)fwrite(head, head_length, 1, cnx->f_binlog);
+        }
+        (void)fwrite(msg, msg_length, 1, cnx->f_binlog);
+    }
+    else if ((cnx->binlog_nb_dropped > 0 && binlog_push_drop_marker(cnx) != 0) ||
+        binlog_push_event(cnx, head, head_length, msg, msg_length) != 0) {
+        cnx->binlog_nb_dropped++;
+    }
+}
+
+/* Close the log file of the connection. With the asynchronous writer, the
+ * file is closed by the writer thread after writing the pending events. */
+static void binlog_close_file(picoquic_cnx_t* cnx, int wait_until_closed)
+{
+    if (cnx->f_binlog != NULL) {
+        binlog_check_ring(cnx);
+        if (cnx->binlog_ring == NULL) {
+            (void)fflush(cnx->f_binlog);
+            (void)picoquic_file_close(cnx->f_binlog);
+        }
+        else {
+            picoquic_binlog_ring_t* ring = cnx->binlog_ring;
+
+            if (binlog_ring_push(ring, cnx->f_binlog, binlog_record_close, NULL, 0, NULL, 0) != 0) {
+                binlog_ring_wait(ring, ring->head);
+                (void)binlog_ring_push(ring, cnx->f_binlog, binlog_record_close, NULL, 0, NULL, 0);
+            }
+            if (wait_until_closed) {
+                binlog_ring_wait(ring, ring->head);
+            }
+        }
+        cnx->f_binlog = NULL;
+    }
+    cnx->binlog_ring = NULL;
+    cnx->binlog_ring_position = 0;
+    cnx->binlog_file_offset = 0;
+    cnx->binlog_nb_dropped = 0;
+}
+
+/* Record a sync point in the index before writing an event, if enough
+ * events were written or enough time elapsed since the previous one.
+ * Event times are not always increasing, so each sync point keeps the
+ * lowest and highest time of the events written after it, until the next
+ * sync point. The time written in the index is computed when the log is
+ * closed, see binlog_index_finalize.
+ */
+static void binlog_index_event(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_binlog_index_t* index = &cnx->binlog_index;
+
+    if (index->nb_syncs == 0 || index->nb_events_since_sync >= PICOQUIC_BINLOG_SYNC_EVENTS ||
+        current_time >= index->next_sync_time) {
+        uint64_t offset;
+
+        binlog_check_ring(cnx);
+        offset = binlog_get_offset(cnx);
+
+        if (offset > 0 && index->nb_syncs >= index->nb_syncs_max) {
+            size_t new_max = (index->nb_syncs_max == 0) ? 64 : 2 * index->nb_syncs_max;
+            picoquic_binlog_sync_t* new_syncs = (picoquic_binlog_sync_t*)realloc(index->syncs,
+                new_max * sizeof(picoquic_binlog_sync_t));
+            if (new_syncs != NULL) {
+                index->syncs = new_syncs;
+                index->nb_syncs_max = new_max;
+            }
+        }
+        if (offset > 0 && index->nb_syncs < index->nb_syncs_max) {
+            index->syncs[index->nb_syncs].time = current_time;
+            index->syncs[index->nb_syncs].max_time = current_time;
+            index->syncs[index->nb_syncs].offset = offset;
+            index->nb_syncs++;
+            index->next_sync_time = current_time + PICOQUIC_BINLOG_SYNC_INTERVAL;
+            index->nb_events_since_sync = 0;
+        }
+    }
+    if (index->nb_syncs > 0) {
+        picoquic_binlog_sync_t* last_sync = &index->syncs[index->nb_syncs - 1];
+
+        if (current_time < last_sync->time) {
+            last_sync->time = current_time;
+        }
+        if (current_time > last_sync->max_time) {
+            last_sync->max_time = current_time;
+        }
+    }
+    index->nb_events_since_sync++;
+}
+
+/* Set the time of each sync point to the lowest time of the events that
+ * follow it, and drop the sync points preceded by an event with a higher
+ * time. Readers can then start at the last sync point before a time window
+ * and stop at the first sync point after it without missing any event.
+ */
+static void binlog_index_finalize(picoquic_binlog_index_t* index)
+{
+    uint64_t max_before = 0;
+    size_t nb_kept = 0;
+
+    for (size_t i = index->nb_syncs; i > 1; i--) {
+        if (index->syncs[i - 1].time < index->syncs[i - 2].time) {
+            index->syncs[i - 2].time = index->syncs[i - 1].time;
+        }
+    }
+    for (size_t i = 0; i < index->nb_syncs; i++) {
+        uint64_t max_time = index->syncs[i].max_time;
+
+        if (max_before <= index->syncs[i].time) {
+            index->syncs[nb_kept++] = index->syncs[i];
+        }
+        if (max_time > max_before) {
+            max_before = max_time;
+        }
+    }
+    index->nb_syncs = nb_kept;
+}
+
+static void binlog_index_release(picoquic_cnx_t* cnx)
+{
+    if (cnx->binlog_index.syncs != NULL) {
+        free(cnx->binlog_index.syncs);
+    }
+    memset(&cnx->binlog_index, 0, sizeof(picoquic_binlog_index_t));
+}
+
+static size_t binlog_start_index_event(bytestream* msg, picoquic_cnx_t* cnx, picoquic_log_event_type event_type)
+{
+    size_t event_start = bytestream_length(msg);
+
+    bytewrite_int32(msg, 0);
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, 0, 0, event_type);
+
+    return event_start;
+}
+
+static void binlog_end_index_event(bytestream* msg, size_t event_start)
+{
+    /* write the event length at the reserved spot */
+    picoformat_32(msg->data + event_start, (uint32_t)(msg->ptr - event_start - 4));
+}
+
+/* Append the index at the end of the log, see picoquic_binlog.h for the format.
+ * The index events are written in one piece, so that the asynchronous writer
+ * either writes all of them or none.
+ */
+static void binlog_write_index(picoquic_cnx_t* cnx)
+{
+    picoquic_binlog_index_t* index = &cnx->binlog_index;
+    uint64_t index_offset = binlog_get_offset(cnx);
+    size_t index_size = 256 + 2 * 8 * index->nb_syncs +
+        64 * (index->nb_syncs / PICOQUIC_BINLOG_SYNC_PER_EVENT + 1);
+    uint8_t* index_buffer = (index_offset > 0) ? (uint8_t*)malloc(index_size) : NULL;
+
+    binlog_index_finalize(index);
+
+    if (index_buffer != NULL) {
+        bytestream stream_msg;
+        bytestream* msg = bytestream_ref_init(&stream_msg, index_buffer, index_size);
+        size_t event_start = binlog_start_index_event(msg, cnx, picoquic_log_event_index);
+        size_t i = 0;
+
+        bytewrite_vint(msg, PICOQUIC_BINLOG_INDEX_KIND_CID);
+        bytewrite_cid(msg, &cnx->initial_cnxid);
+        bytewrite_vint(msg, (index->nb_syncs > 0) ? index->syncs[0].offset : 16);
+        binlog_end_index_event(msg, event_start);
+
+        while (i < index->nb_syncs) {
+            size_t nb_in_event = index->nb_syncs - i;
+
+            if (nb_in_event > PICOQUIC_BINLOG_SYNC_PER_EVENT) {
+                nb_in_event = PICOQUIC_BINLOG_SYNC_PER_EVENT;
+            }
+            event_start = binlog_start_index_event(msg, cnx, picoquic_log_event_index);
+            bytewrite_vint(msg, PICOQUIC_BINLOG_INDEX_KIND_SYNC);
+            bytewrite_vint(msg, nb_in_event);
+            for (size_t j = 0; j < nb_in_event; j++, i++) {
+                bytewrite_vint(msg, index->syncs[i].time);
+                bytewrite_vint(msg, index->syncs[i].offset);
+            }
+            binlog_end_index_event(msg, event_start);
+        }
+
+        event_start = binlog_start_index_event(msg, cnx, picoquic_log_event_index_end);
+        bytewrite_int64(msg, index_offset);
+        binlog_end_index_event(msg, event_start);
+
+        binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
+        free(index_buffer);
+    }
+}
+
+/* Write the frame length at the reserved spot, and save to log file */
+static void binlog_write_chunk(picoquic_cnx_t* cnx, bytestream* msg)
+{
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+    binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
+}
+
+static void binlog_pdu_compose(bytestream* msg, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
+    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+{
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, cid, current_time, 0, picoquic_log_event_pdu_sent + receiving);
 
@@ -691,10 +1303,16 @@ void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uin
     bytewrite_vint(msg, packet_length);
     bytewrite_addr(msg, addr_local);
 
-    uint8_t head[4] = { 0 };
-    picoformat_32(head, (uint32_t)bytestream_length(msg));
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+}
 
-    (void)fwrite(head, sizeof(head), 1, f);
+void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
+    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+{
+    bytestream_buf stream_msg;
+    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+    binlog_pdu_compose(msg, cid, receiving, current_time, addr_peer, addr_local, packet_length);
     (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
 }
 
@@ -702,20 +1320,23 @@ static void binlog_pdu_ex(picoquic_cnx_t* cnx, int receiving, uint64_t current_t
     const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
 {
     if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_pdu(cnx->f_binlog, &cnx->initial_cnxid, receiving, current_time, addr_peer, addr_local, packet_length);
+        bytestream_buf stream_msg;
+        bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+        binlog_index_event(cnx, current_time);
+        binlog_pdu_compose(msg, &cnx->initial_cnxid, receiving, current_time, addr_peer, addr_local, packet_length);
+        binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
     }
 }
 
-void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving, uint64_t current_time,
-    const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
-{
-    long fpos0 = ftell(f);
-
-    uint8_t head[4] = { 0 };
-    (void)fwrite(head, 4, 1, f);
+/* The frames of a packet are logged in a buffer large enough for the
+ * worst case of a series of single byte frames, see picoquic_binlog_frames */
+#define BINLOG_PACKET_BUFFER_SIZE (3 * PICOQUIC_MAX_PACKET_SIZE)
 
-    bytestream_buf stream_msg;
-    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+static void binlog_packet_compose(bytestream* msg, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving,
+    uint64_t current_time, const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
+{
+    bytewrite_int32(msg, 0);
 
     /* Common chunk header */
     binlog_compose_event_header(msg, cid, current_time, path_id, picoquic_log_event_packet_sent + receiving);
@@ -742,32 +1363,41 @@ void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_i
         bytewrite_buffer(msg, ph->token_bytes, ph->token_length);
     }
 
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
-
     /* frame information */
     if (ph->ptype == picoquic_packet_version_negotiation || ph->ptype == picoquic_packet_retry) {
-        picoquic_binlog_frame(f, bytes + ph->offset, bytes + bytes_max);
+        picoquic_binlog_frame(msg, bytes + ph->offset, bytes + bytes_max);
     }
     else if (ph->ptype != picoquic_packet_error) {
-        picoquic_binlog_frames(f, bytes + ph->offset, ph->payload_length);
+        binlog_frames_compose(msg, bytes + ph->offset, ph->payload_length);
     }
 
-    /* re-write chunk size field */
-    long fpos1 = ftell(f);
+    /* write the chunk size at the reserved spot */
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+}
 
-    picoformat_32(head, (uint32_t)(fpos1 - fpos0 - 4));
+void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving, uint64_t current_time,
+    const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
+{
+    uint8_t log_buffer[BINLOG_PACKET_BUFFER_SIZE];
+    bytestream stream_msg;
+    bytestream* msg = bytestream_ref_init(&stream_msg, log_buffer, sizeof(log_buffer));
 
-    (void)fseek(f, fpos0, SEEK_SET);
-    (void)fwrite(head, 4, 1, f);
-    (void)fseek(f, 0, SEEK_END);
+    binlog_packet_compose(msg, cid, path_id, receiving, current_time, ph, bytes, bytes_max);
+    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
 }
 
 static void binlog_packet_ex(picoquic_cnx_t* cnx, picoquic_path_t * path_x, int receiving, uint64_t current_time,
     picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
 {
     if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_packet(cnx->f_binlog, &cnx->initial_cnxid, binlog_get_path_id(cnx, path_x),
+        uint8_t log_buffer[BINLOG_PACKET_BUFFER_SIZE];
+        bytestream stream_msg;
+        bytestream* msg = bytestream_ref_init(&stream_msg, log_buffer, sizeof(log_buffer));
+
+        binlog_index_event(cnx, current_time);
+        binlog_packet_compose(msg, &cnx->initial_cnxid, binlog_get_path_id(cnx, path_x),
             receiving, current_time, ph, bytes, bytes_max);
+        binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
     }
 }
 
@@ -775,11 +1405,12 @@ void binlog_dropped_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     picoquic_packet_header* ph,  size_t packet_size, int err,
     uint8_t * raw_data, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
     size_t raw_size = packet_size;
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
+    binlog_index_event(cnx, current_time);
+
     if (err == PICOQUIC_ERROR_AEAD_CHECK) {
         /* Do not log on decryption error, because the buffer was randomized by decryption */
         raw_size = 0;
@@ -798,18 +1429,16 @@ void binlog_dropped_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     bytewrite_vint(msg, raw_size);
     (void)bytewrite_buffer(msg, raw_data, raw_size);
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 void binlog_buffered_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x, 
     picoquic_packet_type_enum ptype, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
+    binlog_index_event(cnx, current_time);
     bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx->initial_cnxid, current_time, binlog_get_path_id(cnx, path_x),
@@ -818,9 +1447,7 @@ void binlog_buffered_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     bytewrite_vint(msg, ptype);
     (void)bytewrite_cstr(msg, "keys_unavailable");
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 
@@ -828,8 +1455,6 @@ void binlog_outgoing_packet(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
     uint8_t * bytes, uint64_t sequence_number, size_t pn_length, size_t length,
     uint8_t* send_buffer, size_t send_length, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
-
     picoquic_cnx_t* pcnx = cnx;
     picoquic_packet_header ph;
     size_t checksum_length = 16;
@@ -870,7 +1495,13 @@ void binlog_outgoing_packet(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
         }
     }
 
-    binlog_packet(f, cnxid, binlog_get_path_id(cnx, path_x),  0, current_time, &ph, bytes, length);
+    uint8_t log_buffer[BINLOG_PACKET_BUFFER_SIZE];
+    bytestream stream_msg;
+    bytestream* msg = bytestream_ref_init(&stream_msg, log_buffer, sizeof(log_buffer));
+
+    binlog_index_event(cnx, current_time);
+    binlog_packet_compose(msg, cnxid, binlog_get_path_id(cnx, path_x), 0, current_time, &ph, bytes, length);
+    binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
 }
 
 void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
@@ -878,11 +1509,10 @@ void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     picoquic_connection_id_t * dcid, size_t packet_size,
     uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
+    binlog_index_event(cnx, current_time);
     bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx->initial_cnxid, current_time, binlog_get_path_id(cnx, path_x), picoquic_log_event_packet_lost);
@@ -898,9 +1528,7 @@ void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     }
     bytewrite_vint(msg, packet_size);
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 
@@ -908,12 +1536,13 @@ void binlog_negotiated_alpn(picoquic_cnx_t* cnx, int is_local,
     uint8_t const * sni, size_t sni_len, uint8_t const* alpn, size_t alpn_len,
     const ptls_iovec_t* alpn_list, size_t alpn_count)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+    binlog_index_event(cnx, current_time);
     /* Common chunk header */
-    binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_alpn_update);
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, current_time, 0, picoquic_log_event_alpn_update);
     /* Event header */
     bytewrite_vint(msg, is_local);
     bytewrite_vint(msg, sni_len);
@@ -938,19 +1567,19 @@ void binlog_negotiated_alpn(picoquic_cnx_t* cnx, int is_local,
     bytestream* head = bytestream_buf_init(&stream_head, 4);
     bytewrite_int32(head, (uint32_t)bytestream_length(msg));
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_event(cnx, bytestream_data(head), bytestream_length(head), bytestream_data(msg), bytestream_length(msg));
 }
 
 void binlog_transport_extension(picoquic_cnx_t* cnx, int is_local,
     size_t param_length, uint8_t* params)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+    binlog_index_event(cnx, current_time);
     /* Common chunk header */
-    binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_param_update);
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, current_time, 0, picoquic_log_event_param_update);
     /* Event header */
     bytewrite_vint(msg, is_local);
     bytewrite_vint(msg, param_length);
@@ -963,26 +1592,29 @@ void binlog_transport_extension(picoquic_cnx_t* cnx, int is_local,
     bytestream* head = bytestream_buf_init(&stream_head, 4);
     bytewrite_int32(head, (uint32_t)bytestream_length(msg));
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_event(cnx, bytestream_data(head), bytestream_length(head), bytestream_data(msg), bytestream_length(msg));
 }
 
-void binlog_picotls_ticket(FILE* f, picoquic_connection_id_t cnx_id,
+static void binlog_picotls_ticket_compose(bytestream* msg, picoquic_connection_id_t cnx_id,
     uint8_t* ticket, uint16_t ticket_length)
 {
-    bytestream_buf stream_msg;
-    bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx_id, 0, 0, picoquic_log_event_tls_key_update);
 
     bytewrite_vint(msg, ticket_length);
     bytewrite_buffer(msg, ticket, ticket_length);
 
-    bytestream_buf stream_head;
-    bytestream * head = bytestream_buf_init(&stream_head, 8);
-    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+}
+
+void binlog_picotls_ticket(FILE* f, picoquic_connection_id_t cnx_id,
+    uint8_t* ticket, uint16_t ticket_length)
+{
+    bytestream_buf stream_msg;
+    bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
+    binlog_picotls_ticket_compose(msg, cnx_id, ticket, ticket_length);
     (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
 }
 
@@ -990,7 +1622,12 @@ static void binlog_picotls_ticket_ex(picoquic_cnx_t* cnx,
     uint8_t* ticket, uint16_t ticket_length)
 {
     if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_picotls_ticket(cnx->f_binlog, cnx->initial_cnxid, ticket, ticket_length);
+        bytestream_buf stream_msg;
+        bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+        binlog_index_event(cnx, picoquic_get_quic_time(cnx->quic));
+        binlog_picotls_ticket_compose(msg, cnx->initial_cnxid, ticket, ticket_length);
+        binlog_write_event(cnx, NULL, 0, bytestream_data(msg), bytestream_length(msg));
     }
 }
 
@@ -1010,7 +1647,7 @@ void binlog_new_connection(picoquic_cnx_t * cnx)
 
     int ret = 0;
 
-    cnx->f_binlog = picoquic_file_close(cnx->f_binlog);
+    binlog_close_file(cnx, 0);
     
     char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
     if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->initial_cnxid) != 0) {
@@ -1051,6 +1688,12 @@ void binlog_new_connection(picoquic_cnx_t * cnx)
         }
     }
 
+    binlog_index_release(cnx);
+
+    if (ret == 0) {
+        binlog_index_event(cnx, cnx->start_time);
+    }
+
     if (ret == 0) {
         bytestream_buf stream_msg;
         bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
@@ -1069,35 +1712,45 @@ void binlog_new_connection(picoquic_cnx_t * cnx)
         bytestream * head = bytestream_buf_init(&stream_head, 8);
         bytewrite_int32(head, (uint32_t)bytestream_length(msg));
 
-        (void)fwrite(bytestream_data(head), bytestream_length(head), 1, cnx->f_binlog);
-        (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, cnx->f_binlog);
+        binlog_write_event(cnx, bytestream_data(head), bytestream_length(head), bytestream_data(msg), bytestream_length(msg));
     }
 }
 
 void binlog_close_connection(picoquic_cnx_t * cnx)
 {
-    FILE * f = cnx->f_binlog;
-    if (f == NULL) {
+    int is_converted = (cnx->quic->qlog_dir != NULL && cnx->quic->autoqlog_fn != NULL);
+
+    if (cnx->f_binlog == NULL) {
+        binlog_index_release(cnx);
         return;
     }
 
     bytestream_buf stream_msg;
     bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+    binlog_index_event(cnx, current_time);
+    binlog_check_ring(cnx);
+    if (cnx->binlog_ring != NULL && cnx->binlog_nb_dropped > 0) {
+        /* Make room for the drop marker, the close event and the index */
+        binlog_ring_wait(cnx->binlog_ring, cnx->binlog_ring->head);
+    }
     /* Common chunk header */
-    binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_connection_close);
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, current_time, 0, picoquic_log_event_connection_close);
 
     bytestream_buf stream_head;
     bytestream * head = bytestream_buf_init(&stream_head, 8);
     bytewrite_int32(head, (uint32_t)bytestream_length(msg));
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_event(cnx, bytestream_data(head), bytestream_length(head), bytestream_data(msg), bytestream_length(msg));
 
-    fflush(f);
+    binlog_write_index(cnx);
+    binlog_index_release(cnx);
 
-    cnx->f_binlog = picoquic_file_close(cnx->f_binlog);
+    /* The log file must be complete before it is converted */
+    binlog_close_file(cnx, is_converted);
 
-    if (cnx->quic->qlog_dir != NULL && cnx->quic->autoqlog_fn != NULL) {
+    if (is_converted) {
         (void)cnx->quic->autoqlog_fn(cnx);
     }
     cnx->binlog_file_name = picoquic_string_free(cnx->binlog_file_name);
@@ -1118,7 +1771,7 @@ FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned in
         bytestream* ps = bytestream_buf_init(&stream, 16);
         bytewrite_int32(ps, FOURCC('q', 'l', 'o', 'g'));
         bytewrite_int16(ps, (is_multipath_supported) ? 0x01 : 0); /* flags */
-        bytewrite_int16(ps, 0x01); /* version */
+        bytewrite_int16(ps, PICOQUIC_BINLOG_VERSION); /* version */
         bytewrite_int64(ps, creation_time);
 
         if (fwrite(bytestream_data(ps), bytestream_length(ps), 1, f_binlog) <= 0) {
@@ -1165,6 +1818,7 @@ void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
          * all available paths, and write the data for each path if multipath is enabled.
          * verify that it works for CSV and QLOG formats.
          */
+        binlog_index_event(cnx, current_time);
         binlog_compose_event_header(ps_msg, &cnx->initial_cnxid, current_time, 
             binlog_get_path_id(cnx, path), picoquic_log_event_cc_update);
 
@@ -1225,8 +1879,8 @@ void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
 
         bytewrite_int32(ps_head, (uint32_t)bytestream_length(ps_msg));
 
-        (void)fwrite(bytestream_data(ps_head), bytestream_length(ps_head), 1, cnx->f_binlog);
-        (void)fwrite(bytestream_data(ps_msg), bytestream_length(ps_msg), 1, cnx->f_binlog);
+        binlog_write_event(cnx, bytestream_data(ps_head), bytestream_length(ps_head),
+            bytestream_data(ps_msg), bytestream_length(ps_msg));
     }
 }
 
@@ -1244,8 +1898,11 @@ void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list var
     size_t message_len;
     char* message_text;
     int written = -1;
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+    binlog_index_event(cnx, current_time);
     /* Common chunk header */
-    binlog_compose_event_header(ps_msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_info_message);
+    binlog_compose_event_header(ps_msg, &cnx->initial_cnxid, current_time, 0, picoquic_log_event_info_message);
 
     message_text = (char*)(ps_msg->data + ps_msg->ptr);
 #ifdef _WINDOWS
@@ -1267,8 +1924,8 @@ void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list var
 
     bytewrite_int32(ps_head, (uint32_t)bytestream_length(ps_msg));
 
-    (void)fwrite(bytestream_data(ps_head), bytestream_length(ps_head), 1, cnx->f_binlog);
-    (void)fwrite(bytestream_data(ps_msg), bytestream_length(ps_msg), 1, cnx->f_binlog);
+    binlog_write_event(cnx, bytestream_data(ps_head), bytestream_length(ps_head),
+        bytestream_data(ps_msg), bytestream_length(ps_msg));
 }
 
 /* Log an event that cannot be attached to a specific connection */
@@ -1303,12 +1960,13 @@ static void binlog_app_message(picoquic_cnx_t* cnx, const char* fmt, va_list var
     }
 }
 
-/* Return from close with nothing, as this is per connection only */
+/* The logs are per connection, only release the ring of the asynchronous writer */
 void binlog_close(picoquic_quic_t* quic)
 {
-#ifdef _WINDOWS
-    UNREFERENCED_PARAMETER(quic);
-#endif
+    if (quic->binlog_ring != NULL) {
+        binlog_writer_detach_ring(quic->binlog_ring);
+        quic->binlog_ring = NULL;
+    }
 }
 
 struct st_picoquic_unified_logging_t binlog_functions = {
@@ -1344,3 +2002,22 @@ void picoquic_enable_binlog(picoquic_quic_t* quic)
 {
     quic->bin_log_fns = &binlog_functions;
 }
+
+int picoquic_set_binlog_writer(picoquic_quic_t* quic, picoquic_binlog_writer_t* writer)
+{
+    int ret = 0;
+    picoquic_binlog_ring_t* ring = NULL;
+
+    if (writer != NULL && (ring = binlog_writer_attach_ring(writer)) == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        if (quic->binlog_ring != NULL) {
+            binlog_writer_detach_ring(quic->binlog_ring);
+        }
+        quic->binlog_ring = ring;
+        quic->bin_log_fns = &binlog_functions;
+    }
+
+    return ret;
+}
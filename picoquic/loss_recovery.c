@@ -672,6 +672,24 @@ static void picoquic_set_wake_up_from_packet_retransmit(
  *    if "force queue" is set, the frame is queued in "misc" file
  *    else, the frame is copied in the repeated packet.
  */
+/* Compacted packets must be expanded before their content can be repeated.
+ * If that fails, the stream data cannot be repeated, and the connection
+ * has to be closed.
+ */
+static picoquic_packet_t* picoquic_expand_lost_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx,
+    picoquic_packet_t* old_p)
+{
+    picoquic_packet_t* new_p = picoquic_expand_compacted_packet(cnx, pkt_ctx, old_p);
+
+    if (new_p == NULL) {
+        (void)picoquic_connection_error_ex(cnx, PICOQUIC_TRANSPORT_INTERNAL_ERROR, 0,
+            "Cannot expand compacted packet");
+        picoquic_dequeue_retransmit_packet(cnx, pkt_ctx, old_p, 1, 0);
+    }
+
+    return new_p;
+}
+
 int picoquic_copy_before_retransmit(picoquic_packet_t * old_p,
     picoquic_cnx_t * cnx,
     uint8_t * new_bytes,
@@ -796,6 +814,10 @@ static picoquic_packet_t* picoquic_process_lost_packet(picoquic_cnx_t* cnx, pico
     int ret = 0;
     int force_queue = 0;
 
+    if (old_p->is_compacted && (old_p = picoquic_expand_lost_packet(cnx, pkt_ctx, old_p)) == NULL) {
+        return NULL;
+    }
+
     /* Manage the path MTU issues */
     picoquic_check_path_mtu_on_losses(cnx, old_p, is_timer_expired);
     /* Report loss to application, update counts */
@@ -902,6 +924,7 @@ static void picoquic_count_and_notify_loss(
 
         if (!old_p->is_preemptive_repeat) {
             cnx->nb_retransmission_total++;
+            picoquic_counter_add_uint64(&cnx->quic->metrics.nb_retransmissions, 1);
         }
     }
 
@@ -979,6 +1002,10 @@ static void picoquic_retransmit_path_packet_queue(picoquic_cnx_t* cnx, picoquic_
         int add_to_data_repeat_queue = 0;
         size_t length = 0;
 
+        if (old_p->is_compacted && (old_p = picoquic_expand_lost_packet(cnx, pkt_ctx, old_p)) == NULL) {
+            old_p = next_packet;
+            continue;
+        }
         /* Report loss to application, update counts */
         picoquic_count_and_notify_loss(cnx, old_p, 0, current_time);
         /* Call the copy routine but force it to not put anything in the copy */
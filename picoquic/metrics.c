@@ -0,0 +1,306 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Metrics of a QUIC context.
+ * The counters are kept in quic->metrics, and only updated by the thread
+ * running the context, using picoquic_counter_add_uint64. Other threads read
+ * them with atomic loads, so that taking a snapshot requires no lock and
+ * does not slow down the network thread.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic.h"
+#include "picoquic_utils.h"
+#include "picoquic_internal.h"
+
+#define PICOQUIC_METRICS_EXPORTER_POLL 100000 /* Check for stop requests every 100 ms */
+
+void picoquic_get_quic_metrics(picoquic_quic_t* quic, picoquic_quic_metrics_t* metrics)
+{
+    /* The metrics structure only contains uint64_t values */
+    volatile uint64_t* source = (volatile uint64_t*)&quic->metrics;
+    uint64_t* target = (uint64_t*)metrics;
+
+    for (size_t i = 0; i < sizeof(picoquic_quic_metrics_t) / sizeof(uint64_t); i++) {
+        target[i] = picoquic_atomic_load_uint64(&source[i]);
+    }
+}
+
+/* Formatting in the Prometheus text exposition format */
+typedef struct st_picoquic_metric_def_t {
+    char const* name;
+    char const* type;
+    char const* help;
+    size_t offset;
+    int is_time; /* Value in microseconds, printed in seconds */
+} picoquic_metric_def_t;
+
+static const picoquic_metric_def_t picoquic_metric_defs[] = {
+    { "picoquic_packets_received_total", "counter", "UDP datagrams received.",
+        offsetof(picoquic_quic_metrics_t, nb_packets_received), 0 },
+    { "picoquic_bytes_received_total", "counter", "Bytes received in UDP datagrams.",
+        offsetof(picoquic_quic_metrics_t, nb_bytes_received), 0 },
+    { "picoquic_packets_sent_total", "counter", "UDP datagrams sent.",
+        offsetof(picoquic_quic_metrics_t, nb_packets_sent), 0 },
+    { "picoquic_bytes_sent_total", "counter", "Bytes sent in UDP datagrams.",
+        offsetof(picoquic_quic_metrics_t, nb_bytes_sent), 0 },
+    { "picoquic_retransmissions_total", "counter", "Packets declared lost and retransmitted.",
+        offsetof(picoquic_quic_metrics_t, nb_retransmissions), 0 },
+    { "picoquic_stateless_packets_sent_total", "counter", "Retry, version negotiation, busy and reset packets sent.",
+        offsetof(picoquic_quic_metrics_t, nb_stateless_packets_sent), 0 },
+    { "picoquic_stateless_packets_dropped_total", "counter", "Stateless packets not sent because too many were queued.",
+        offsetof(picoquic_quic_metrics_t, nb_stateless_packets_dropped), 0 },
+    { "picoquic_initial_rate_limited_total", "counter", "Initial packets dropped by the rate limit per prefix.",
+        offsetof(picoquic_quic_metrics_t, nb_initial_rate_limited), 0 },
+    { "picoquic_initial_early_retry_total", "counter", "Initial packets answered with a Retry before creating a connection.",
+        offsetof(picoquic_quic_metrics_t, nb_initial_early_retry), 0 },
+    { "picoquic_initial_refused_memory_total", "counter", "Connections refused because the memory budget was exceeded.",
+        offsetof(picoquic_quic_metrics_t, nb_initial_refused_memory), 0 },
+    { "picoquic_receive_seconds_total", "counter", "Time spent processing received packets.",
+        offsetof(picoquic_quic_metrics_t, time_receive), 1 },
+    { "picoquic_prepare_seconds_total", "counter", "Time spent preparing packets.",
+        offsetof(picoquic_quic_metrics_t, time_prepare), 1 },
+    { "picoquic_syscall_seconds_total", "counter", "Time spent in socket system calls, excluding waits.",
+        offsetof(picoquic_quic_metrics_t, time_syscalls), 1 },
+    { "picoquic_connections", "gauge", "Connections in the context.",
+        offsetof(picoquic_quic_metrics_t, nb_connections), 0 },
+    { "picoquic_half_open_connections", "gauge", "Server connections with handshake in progress.",
+        offsetof(picoquic_quic_metrics_t, nb_half_open), 0 },
+    { "picoquic_memory_bytes", "gauge", "Memory used by pooled objects, see picoquic_get_memory_usage.",
+        offsetof(picoquic_quic_metrics_t, memory_bytes), 0 }
+};
+
+static const size_t picoquic_nb_metric_defs = sizeof(picoquic_metric_defs) / sizeof(picoquic_metric_def_t);
+
+static char const* picoquic_drop_reason_names[picoquic_drop_reason_nb] = {
+    "decryption", "version", "malformed", "unknown_cid", "duplicate", "refused", "other" };
+
+static char const* picoquic_memory_type_names[picoquic_memory_nb_types] = {
+    "packets", "data_nodes", "stateless_packets", "streams", "paths", "cnx_ids", "cnx" };
+
+static int picoquic_metrics_print(char* text, size_t text_size, size_t* length, char const* name,
+    char const* type, char const* help)
+{
+    size_t nb_chars = 0;
+    int ret = picoquic_sprintf(text + *length, text_size - *length, &nb_chars,
+        "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+
+    if (ret == 0) {
+        *length += nb_chars;
+    }
+    return ret;
+}
+
+static int picoquic_metrics_print_labeled(char* text, size_t text_size, size_t* length, char const* name,
+    char const* label_name, char const* const* labels, const uint64_t* values, int nb_values)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < nb_values; i++) {
+        size_t nb_chars = 0;
+        if ((ret = picoquic_sprintf(text + *length, text_size - *length, &nb_chars,
+            "%s{%s=\"%s\"} %" PRIu64 "\n", name, label_name, labels[i], values[i])) == 0) {
+            *length += nb_chars;
+        }
+    }
+    return ret;
+}
+
+int picoquic_format_quic_metrics(const picoquic_quic_metrics_t* metrics, char* text, size_t text_size,
+    size_t* text_length)
+{
+    int ret = 0;
+    size_t length = 0;
+
+    for (size_t i = 0; ret == 0 && i < picoquic_nb_metric_defs; i++) {
+        const picoquic_metric_def_t* def = &picoquic_metric_defs[i];
+        uint64_t value = *(const uint64_t*)((const uint8_t*)metrics + def->offset);
+        size_t nb_chars = 0;
+
+        if ((ret = picoquic_metrics_print(text, text_size, &length, def->name, def->type, def->help)) == 0) {
+            if (def->is_time) {
+                ret = picoquic_sprintf(text + length, text_size - length, &nb_chars, "%s %" PRIu64 ".%06" PRIu64 "\n",
+                    def->name, value / 1000000, value % 1000000);
+            }
+            else {
+                ret = picoquic_sprintf(text + length, text_size - length, &nb_chars, "%s %" PRIu64 "\n", def->name, value);
+            }
+            if (ret == 0) {
+                length += nb_chars;
+            }
+        }
+    }
+
+    if (ret == 0 && (ret = picoquic_metrics_print(text, text_size, &length, "picoquic_packets_dropped_total", "counter",
+        "Received packets dropped, by reason.")) == 0) {
+        ret = picoquic_metrics_print_labeled(text, text_size, &length, "picoquic_packets_dropped_total", "reason",
+            picoquic_drop_reason_names, metrics->nb_packets_dropped, picoquic_drop_reason_nb);
+    }
+
+    if (ret == 0 && (ret = picoquic_metrics_print(text, text_size, &length, "picoquic_pool_allocated", "gauge",
+        "Objects allocated, in use or kept in a pool, by type.")) == 0) {
+        ret = picoquic_metrics_print_labeled(text, text_size, &length, "picoquic_pool_allocated", "type",
+            picoquic_memory_type_names, metrics->nb_allocated, picoquic_memory_nb_types);
+    }
+
+    if (ret == 0 && (ret = picoquic_metrics_print(text, text_size, &length, "picoquic_pool_available", "gauge",
+        "Objects kept in a pool for reuse, by type.")) == 0) {
+        ret = picoquic_metrics_print_labeled(text, text_size, &length, "picoquic_pool_available", "type",
+            picoquic_memory_type_names, metrics->nb_in_pool, picoquic_memory_nb_types);
+    }
+
+    if (ret != 0) {
+        ret = -1;
+    }
+    else if (text_length != NULL) {
+        *text_length = length;
+    }
+
+    return ret;
+}
+
+/* Exporter thread.
+ * The metrics are written to a temporary file, which then replaces the
+ * target file, so that readers only see complete files.
+ */
+struct st_picoquic_metrics_exporter_t {
+    picoquic_quic_t* quic;
+    char* file_name;
+    char* temp_file_name;
+    uint64_t interval;
+    volatile int should_stop;
+    picoquic_event_t wake_event;
+    picoquic_thread_t thread;
+    char text[PICOQUIC_METRICS_TEXT_SIZE];
+};
+
+static int picoquic_metrics_exporter_write(picoquic_metrics_exporter_t* exporter)
+{
+    int ret = 0;
+    picoquic_quic_metrics_t metrics;
+    size_t length = 0;
+    FILE* F;
+
+    picoquic_get_quic_metrics(exporter->quic, &metrics);
+
+    if ((ret = picoquic_format_quic_metrics(&metrics, exporter->text, sizeof(exporter->text), &length)) == 0) {
+        if ((F = picoquic_file_open(exporter->temp_file_name, "w")) == NULL) {
+            ret = -1;
+        }
+        else {
+            if (fwrite(exporter->text, 1, length, F) != length) {
+                ret = -1;
+            }
+            (void)picoquic_file_close(F);
+        }
+    }
+
+    if (ret == 0) {
+#ifdef _WINDOWS
+        /* Rename does not replace existing files on Windows */
+        (void)picoquic_file_delete(exporter->file_name, NULL);
+#endif
+        if (rename(exporter->temp_file_name, exporter->file_name) != 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+static picoquic_thread_return_t picoquic_metrics_exporter_thread(void* arg)
+{
+    picoquic_metrics_exporter_t* exporter = (picoquic_metrics_exporter_t*)arg;
+
+    /* The metrics are written at least once, even if the exporter is deleted immediately */
+    do {
+        uint64_t next_time = picoquic_current_time() + exporter->interval;
+        uint64_t current_time;
+
+        if (picoquic_metrics_exporter_write(exporter) != 0) {
+            DBG_PRINTF("Cannot write metrics to %s\n", exporter->file_name);
+        }
+
+        while (!exporter->should_stop && (current_time = picoquic_current_time()) < next_time) {
+            uint64_t wait_time = next_time - current_time;
+            if (wait_time > PICOQUIC_METRICS_EXPORTER_POLL) {
+                wait_time = PICOQUIC_METRICS_EXPORTER_POLL;
+            }
+            (void)picoquic_wait_for_event(&exporter->wake_event, wait_time);
+        }
+    } while (!exporter->should_stop);
+
+    picoquic_thread_do_return;
+}
+
+picoquic_metrics_exporter_t* picoquic_metrics_exporter_create(picoquic_quic_t* quic, char const* file_name,
+    uint64_t interval_microsec)
+{
+    picoquic_metrics_exporter_t* exporter = (picoquic_metrics_exporter_t*)malloc(sizeof(picoquic_metrics_exporter_t));
+
+    if (exporter != NULL) {
+        int has_wake_event = 0;
+        size_t name_length = strlen(file_name);
+
+        memset(exporter, 0, sizeof(picoquic_metrics_exporter_t));
+        exporter->quic = quic;
+        exporter->interval = interval_microsec;
+        exporter->file_name = picoquic_string_duplicate(file_name);
+        exporter->temp_file_name = (char*)malloc(name_length + 5);
+        if (exporter->temp_file_name != NULL) {
+            memcpy(exporter->temp_file_name, file_name, name_length);
+            memcpy(exporter->temp_file_name + name_length, ".tmp", 5);
+        }
+
+        if (exporter->file_name == NULL || exporter->temp_file_name == NULL ||
+            (has_wake_event = (picoquic_create_event(&exporter->wake_event) == 0)) == 0 ||
+            picoquic_create_thread(&exporter->thread, picoquic_metrics_exporter_thread, exporter) != 0) {
+            DBG_PRINTF("%s", "Cannot start the metrics exporter thread.\n");
+            if (has_wake_event) {
+                picoquic_delete_event(&exporter->wake_event);
+            }
+            exporter->file_name = picoquic_string_free(exporter->file_name);
+            if (exporter->temp_file_name != NULL) {
+                free(exporter->temp_file_name);
+            }
+            free(exporter);
+            exporter = NULL;
+        }
+    }
+
+    return exporter;
+}
+
+void picoquic_metrics_exporter_delete(picoquic_metrics_exporter_t* exporter)
+{
+    if (exporter != NULL) {
+        (void)picoquic_atomic_exchange_int(&exporter->should_stop, 1);
+        (void)picoquic_signal_event(&exporter->wake_event);
+        (void)picoquic_wait_thread(exporter->thread);
+
+        picoquic_delete_event(&exporter->wake_event);
+        exporter->file_name = picoquic_string_free(exporter->file_name);
+        free(exporter->temp_file_name);
+        free(exporter);
+    }
+}
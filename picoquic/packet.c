@@ -86,6 +86,192 @@ picoquic_packet_type_enum picoquic_parse_long_packet_type(uint8_t flags, int ver
     return pt;
 }
 
+/*
+ * Admission of new connections.
+ *
+ * The admission checks run on Initial packets that do not match an existing
+ * connection, before the Initial keys are derived and before any connection
+ * context is allocated, so that a flood of Initial packets costs as little
+ * as possible:
+ *
+ * - if a rate limit is set, Initial packets from a source prefix that
+ *   exceeds its rate are dropped, using a token bucket per prefix;
+ * - if the server requires address validation, because it is configured to
+ *   always do so or because too many connections are half open, packets
+ *   without a valid token are answered immediately with a Retry, and packets
+ *   carrying an invalid Retry token are dropped.
+ *
+ * The bucket table is set associative, indexed by a hash of the prefix keyed
+ * with the retry secret. A new prefix takes the least recently used bucket of
+ * its set that is empty or fully refilled, since such a bucket carries no
+ * state. If all the buckets of the set are in use, the packet is charged to
+ * the least recently used one: a flood spread over more prefixes than the
+ * table holds is then limited as a whole, at the cost of also limiting
+ * prefixes that share the set. Tokens accepted here are verified again once
+ * the packet is authenticated, with the packet number and reuse checks.
+ */
+typedef struct st_picoquic_admission_bucket_t {
+    uint64_t prefix_hash;
+    uint64_t last_time;
+    uint64_t credit; /* One Initial packet costs 1000000 units */
+} picoquic_admission_bucket_t;
+
+static uint64_t picoquic_admission_prefix_hash(picoquic_quic_t* quic, const struct sockaddr* addr_from)
+{
+    uint8_t key[32];
+    size_t key_length = 16;
+    uint64_t hash;
+
+    memcpy(key, quic->retry_seed, key_length);
+    if (addr_from->sa_family == AF_INET) {
+        memcpy(key + key_length, &((struct sockaddr_in*)addr_from)->sin_addr, PICOQUIC_ADMISSION_PREFIX_IPV4);
+        key_length += PICOQUIC_ADMISSION_PREFIX_IPV4;
+    }
+    else {
+        memcpy(key + key_length, &((struct sockaddr_in6*)addr_from)->sin6_addr, PICOQUIC_ADMISSION_PREFIX_IPV6);
+        key_length += PICOQUIC_ADMISSION_PREFIX_IPV6;
+    }
+
+    /* picohash_bytes is linear in the key bits, so prefixes that differ in a few
+     * bits would only reach a fraction of the sets. Finish with a multiplicative
+     * mix to spread them over the whole table. */
+    hash = picohash_bytes(key, (uint32_t)key_length);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    /* Never return zero, which marks the empty buckets */
+    return hash | 1;
+}
+
+static uint64_t picoquic_admission_credit(picoquic_quic_t* quic, picoquic_admission_bucket_t* bucket,
+    uint64_t max_credit, uint64_t current_time)
+{
+    uint64_t credit = bucket->credit;
+
+    if (current_time > bucket->last_time) {
+        uint64_t delta_t = current_time - bucket->last_time;
+
+        if (delta_t >= max_credit / quic->initial_rate_per_prefix) {
+            credit = max_credit;
+        }
+        else {
+            credit += delta_t * quic->initial_rate_per_prefix;
+            if (credit > max_credit) {
+                credit = max_credit;
+            }
+        }
+    }
+
+    return credit;
+}
+
+static int picoquic_admission_check_rate(picoquic_quic_t* quic, const struct sockaddr* addr_from, uint64_t current_time)
+{
+    int is_admitted = 1;
+    uint64_t max_credit = ((uint64_t)quic->initial_burst_per_prefix) * 1000000;
+
+    if (quic->admission_table == NULL) {
+        quic->admission_table = (picoquic_admission_bucket_t*)malloc(
+            sizeof(picoquic_admission_bucket_t) * PICOQUIC_ADMISSION_TABLE_SIZE);
+        if (quic->admission_table != NULL) {
+            memset(quic->admission_table, 0, sizeof(picoquic_admission_bucket_t) * PICOQUIC_ADMISSION_TABLE_SIZE);
+        }
+    }
+
+    if (quic->admission_table != NULL) {
+        uint64_t prefix_hash = picoquic_admission_prefix_hash(quic, addr_from);
+        /* The low bit of the hash is always set, do not use it to select the set */
+        size_t set_index = (size_t)((prefix_hash >> 1) % (PICOQUIC_ADMISSION_TABLE_SIZE / PICOQUIC_ADMISSION_TABLE_WAYS));
+        picoquic_admission_bucket_t* set = &quic->admission_table[set_index * PICOQUIC_ADMISSION_TABLE_WAYS];
+        picoquic_admission_bucket_t* bucket = NULL;
+        picoquic_admission_bucket_t* free_bucket = NULL;
+        picoquic_admission_bucket_t* oldest_bucket = NULL;
+
+        for (int i = 0; i < PICOQUIC_ADMISSION_TABLE_WAYS; i++) {
+            picoquic_admission_bucket_t* candidate = &set[i];
+
+            if (candidate->prefix_hash == prefix_hash) {
+                bucket = candidate;
+                break;
+            }
+            if ((candidate->prefix_hash == 0 ||
+                picoquic_admission_credit(quic, candidate, max_credit, current_time) >= max_credit) &&
+                (free_bucket == NULL || candidate->last_time < free_bucket->last_time)) {
+                free_bucket = candidate;
+            }
+            if (oldest_bucket == NULL || candidate->last_time < oldest_bucket->last_time) {
+                oldest_bucket = candidate;
+            }
+        }
+
+        if (bucket == NULL) {
+            if (free_bucket != NULL) {
+                bucket = free_bucket;
+                bucket->prefix_hash = prefix_hash;
+                bucket->credit = max_credit;
+            }
+            else {
+                /* All buckets of the set are in use: fail closed */
+                bucket = oldest_bucket;
+            }
+        }
+        bucket->credit = picoquic_admission_credit(quic, bucket, max_credit, current_time);
+        bucket->last_time = current_time;
+
+        if (bucket->credit >= 1000000) {
+            bucket->credit -= 1000000;
+        }
+        else {
+            is_admitted = 0;
+        }
+    }
+
+    return is_admitted;
+}
+
+static int picoquic_admit_initial_packet(picoquic_quic_t* quic, picoquic_packet_header* ph,
+    const struct sockaddr* addr_from, uint64_t current_time)
+{
+    int ret = 0;
+
+    if (quic->enforce_client_only || quic->server_busy) {
+        /* The packet will be refused after authentication */
+    }
+    else if (quic->initial_rate_per_prefix > 0 && !picoquic_admission_check_rate(quic, addr_from, current_time)) {
+        picoquic_counter_add_uint64(&quic->metrics.nb_initial_rate_limited, 1);
+        ret = PICOQUIC_ERROR_INITIAL_RATE_LIMITED;
+    }
+    else if (quic->force_check_token || quic->max_half_open_before_retry <= quic->current_number_half_open ||
+        (!quic->is_port_blocking_disabled && picoquic_check_addr_blocked(addr_from))) {
+        int has_good_token = 0;
+
+        if (ph->token_length > 0) {
+            int is_new_token = 0;
+            picoquic_connection_id_t original_cnxid = { 0 };
+
+            /* The packet number is not decrypted yet, and reuse is checked later */
+            if (picoquic_verify_retry_token(quic, addr_from, current_time,
+                &is_new_token, &original_cnxid, &ph->dest_cnx_id, UINT32_MAX,
+                ph->token_bytes, ph->token_length, 0) == 0) {
+                has_good_token = 1;
+            }
+            else if (!is_new_token) {
+                ret = PICOQUIC_ERROR_INVALID_TOKEN;
+            }
+        }
+
+        if (ret == 0 && !has_good_token) {
+            picoquic_counter_add_uint64(&quic->metrics.nb_initial_early_retry, 1);
+            ret = PICOQUIC_ERROR_RETRY_NEEDED;
+        }
+    }
+
+    return ret;
+}
+
 int picoquic_screen_initial_packet(
     picoquic_quic_t* quic,
     const uint8_t* bytes,
@@ -118,7 +304,10 @@ int picoquic_screen_initial_packet(
         uint8_t decrypted_bytes[PICOQUIC_MAX_PACKET_SIZE];
         picoquic_packet_header dph = *ph;
 
-        if (picoquic_get_initial_aead_context(quic, ph->version_index, &ph->dest_cnx_id,
+        if ((ret = picoquic_admit_initial_packet(quic, ph, addr_from, current_time)) != 0) {
+            /* Dropped or sent to retry without deriving the Initial keys */
+        }
+        else if (picoquic_get_initial_aead_context(quic, ph->version_index, &ph->dest_cnx_id,
             0 /* is_client=0 */, 0 /* is_enc = 0 */, &aead_ctx, &pn_dec_ctx) == 0) {
             ret = picoquic_remove_header_protection_inner((uint8_t *)bytes, ph->offset + ph->payload_length,
                 decrypted_bytes, &dph, pn_dec_ctx, 0 /* is_loss_bit_enabled_incoming */, 0 /* sack_list_last*/);
@@ -154,6 +343,11 @@ int picoquic_screen_initial_packet(
                 /* Cannot create a client connection now, send immediate close. */
                 ret = PICOQUIC_ERROR_SERVER_BUSY;
             }
+            else if (picoquic_memory_pressure(quic) >= 2) {
+                /* Over the memory budget, refuse the connection as if busy. */
+                picoquic_counter_add_uint64(&quic->metrics.nb_initial_refused_memory, 1);
+                ret = PICOQUIC_ERROR_SERVER_BUSY;
+            }
             else {
                 int is_address_blocked = !quic->is_port_blocking_disabled && picoquic_check_addr_blocked(addr_from);
                 int is_new_token = 0;
@@ -572,6 +766,53 @@ void picoquic_log_pn_dec_trial(picoquic_cnx_t* cnx)
 /*
  * Remove header protection 
  */
+static void picoquic_apply_header_protection_mask(
+    uint8_t* bytes,
+    uint8_t* decrypted_bytes,
+    picoquic_packet_header* ph,
+    const uint8_t* mask_bytes,
+    unsigned int is_loss_bit_enabled_incoming,
+    uint64_t sack_list_last)
+{
+    uint8_t first_byte = bytes[0];
+    uint8_t first_mask = ((first_byte & 0x80) == 0x80) ? 0x0F : (is_loss_bit_enabled_incoming)?0x07:0x1F;
+    uint8_t pn_l;
+    uint32_t pn_val = 0;
+
+    memcpy(decrypted_bytes, bytes, ph->pn_offset);
+    /* Decode the first byte */
+    first_byte ^= (mask_bytes[0] & first_mask);
+    pn_l = (first_byte & 3) + 1;
+    ph->pnmask = (0xFFFFFFFFFFFFFFFFull);
+    decrypted_bytes[0] = first_byte;
+
+    /* Packet encoding is 1 to 4 bytes */
+    for (uint8_t i = 1; i <= pn_l; i++) {
+        pn_val <<= 8;
+        decrypted_bytes[ph->offset] = bytes[ph->offset]^mask_bytes[i];
+        pn_val += decrypted_bytes[ph->offset++];
+        ph->pnmask <<= 8;
+    }
+
+    ph->pn = pn_val;
+    ph->payload_length -= pn_l;
+    /* Only set the key phase byte if short header */
+    if (ph->ptype == picoquic_packet_1rtt_protected) {
+        ph->key_phase = ((first_byte >> 2) & 1);
+    }
+
+    /* Build a packet number to 64 bits */
+    ph->pn64 = picoquic_get_packet_number64(sack_list_last, ph->pnmask, ph->pn);
+
+    /* Check the reserved bits */
+    if ((first_byte & 0x80) == 0) {
+        ph->has_reserved_bit_set = !is_loss_bit_enabled_incoming && (first_byte & 0x18) != 0;
+    }
+    else{
+        ph->has_reserved_bit_set = (first_byte & 0x0c) != 0;
+    }
+}
+
 int picoquic_remove_header_protection_inner(
     uint8_t* bytes,
     size_t length,
@@ -604,44 +845,9 @@ int picoquic_remove_header_protection_inner(
         }
         else
         {   /* Decode */
-            uint8_t first_byte = bytes[0];
-            uint8_t first_mask = ((first_byte & 0x80) == 0x80) ? 0x0F : (is_loss_bit_enabled_incoming)?0x07:0x1F;
-            uint8_t pn_l;
-            uint32_t pn_val = 0;
-
-            memcpy(decrypted_bytes, bytes, ph->pn_offset);
             picoquic_pn_encrypt(pn_enc, bytes + sample_offset, mask_bytes, mask_bytes, mask_length);
-            /* Decode the first byte */
-            first_byte ^= (mask_bytes[0] & first_mask);
-            pn_l = (first_byte & 3) + 1;
-            ph->pnmask = (0xFFFFFFFFFFFFFFFFull);
-            decrypted_bytes[0] = first_byte;
-
-            /* Packet encoding is 1 to 4 bytes */
-            for (uint8_t i = 1; i <= pn_l; i++) {
-                pn_val <<= 8;
-                decrypted_bytes[ph->offset] = bytes[ph->offset]^mask_bytes[i];
-                pn_val += decrypted_bytes[ph->offset++];
-                ph->pnmask <<= 8;
-            }
-
-            ph->pn = pn_val;
-            ph->payload_length -= pn_l;
-            /* Only set the key phase byte if short header */
-            if (ph->ptype == picoquic_packet_1rtt_protected) {
-                ph->key_phase = ((first_byte >> 2) & 1);
-            }
-
-            /* Build a packet number to 64 bits */
-            ph->pn64 = picoquic_get_packet_number64(sack_list_last, ph->pnmask, ph->pn);
-
-            /* Check the reserved bits */
-            if ((first_byte & 0x80) == 0) {
-                ph->has_reserved_bit_set = !is_loss_bit_enabled_incoming && (first_byte & 0x18) != 0;
-            }
-            else{
-                ph->has_reserved_bit_set = (first_byte & 0x0c) != 0;
-            }
+            picoquic_apply_header_protection_mask(bytes, decrypted_bytes, ph, mask_bytes,
+                is_loss_bit_enabled_incoming, sack_list_last);
         }
     }
     else {
@@ -660,6 +866,79 @@ int picoquic_remove_header_protection_inner(
     return ret;
 }
 
+/* Batch computation of header protection masks.
+ * Only short header packets are considered, for connections identified by
+ * their CID and using an AES cipher suite. The sample is copied when the packet
+ * is added, and the masks of consecutive packets using the same key are then
+ * computed with a single ECB call.
+ */
+void picoquic_header_mask_batch_add(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch, const uint8_t* bytes, size_t length)
+{
+    size_t sample_offset = (size_t)1 + quic->local_cnxid_length + 4;
+
+    if (batch->nb_masks < PICOQUIC_HEADER_MASK_BATCH_MAX && quic->local_cnxid_length > 0 &&
+        length >= sample_offset + 16 && (bytes[0] & 0x80) == 0) {
+        picoquic_connection_id_t cnx_id;
+        picoquic_cnx_t* cnx;
+
+        (void)picoquic_parse_connection_id(bytes + 1, quic->local_cnxid_length, &cnx_id);
+        cnx = picoquic_cnx_by_id(quic, cnx_id, NULL);
+        if (cnx != NULL && cnx->crypto_context[picoquic_epoch_1rtt].pn_dec_ecb != NULL) {
+            batch->sample[batch->nb_masks] = bytes + sample_offset;
+            batch->pn_dec_ecb[batch->nb_masks] = cnx->crypto_context[picoquic_epoch_1rtt].pn_dec_ecb;
+            memcpy(batch->samples + 16 * batch->nb_masks, bytes + sample_offset, 16);
+            batch->nb_masks++;
+        }
+    }
+}
+
+void picoquic_header_mask_batch_compute(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch)
+{
+    size_t i = 0;
+
+    while (i < batch->nb_masks) {
+        size_t j = i + 1;
+
+        while (j < batch->nb_masks && batch->pn_dec_ecb[j] == batch->pn_dec_ecb[i]) {
+            j++;
+        }
+        picoquic_aes128_ecb_encrypt(batch->pn_dec_ecb[i], batch->masks + 16 * i, batch->samples + 16 * i, 16 * (j - i));
+        i = j;
+    }
+    batch->next_mask = 0;
+    quic->header_mask_batch = batch;
+}
+
+void picoquic_header_mask_batch_clear(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch)
+{
+    batch->nb_masks = 0;
+    batch->next_mask = 0;
+    if (quic->header_mask_batch == batch) {
+        quic->header_mask_batch = NULL;
+    }
+}
+
+/* Find the precomputed mask for the packet. Packets are processed in the order
+ * in which they were added, so the search normally stops at the next mask.
+ * The key is checked, because the connection keys may have changed since the
+ * batch was computed. */
+static const uint8_t* picoquic_header_mask_batch_find(picoquic_header_mask_batch_t* batch, const uint8_t* sample, void* pn_dec_ecb)
+{
+    const uint8_t* mask = NULL;
+
+    for (size_t i = batch->next_mask; i < batch->nb_masks; i++) {
+        if (batch->sample[i] == sample) {
+            if (batch->pn_dec_ecb[i] == pn_dec_ecb) {
+                mask = batch->masks + 16 * i;
+            }
+            batch->next_mask = i + 1;
+            break;
+        }
+    }
+
+    return mask;
+}
+
 int picoquic_remove_header_protection(picoquic_cnx_t* cnx,
     uint8_t* bytes,
     uint8_t * decrypted_bytes,
@@ -668,10 +947,23 @@ int picoquic_remove_header_protection(picoquic_cnx_t* cnx,
     int ret = 0;
     size_t length = ph->offset + ph->payload_length; /* this may change after decrypting the PN */
     void * pn_enc = cnx->crypto_context[ph->epoch].pn_dec;
-
     picoquic_sack_list_t* sack_list = picoquic_sack_list_from_cnx_context(cnx, ph->pc, ph->l_cid);
-    ret = picoquic_remove_header_protection_inner(bytes, length, decrypted_bytes, ph,
-        pn_enc, cnx->is_loss_bit_enabled_incoming, picoquic_sack_list_last(sack_list));
+    const uint8_t* mask_bytes = NULL;
+
+    if (cnx->quic->header_mask_batch != NULL && ph->epoch == picoquic_epoch_1rtt && pn_enc != NULL &&
+        ph->pn_offset + 4 + 16 <= length) {
+        mask_bytes = picoquic_header_mask_batch_find(cnx->quic->header_mask_batch, bytes + ph->pn_offset + 4,
+            cnx->crypto_context[picoquic_epoch_1rtt].pn_dec_ecb);
+    }
+
+    if (mask_bytes != NULL) {
+        picoquic_apply_header_protection_mask(bytes, decrypted_bytes, ph, mask_bytes,
+            cnx->is_loss_bit_enabled_incoming, picoquic_sack_list_last(sack_list));
+    }
+    else {
+        ret = picoquic_remove_header_protection_inner(bytes, length, decrypted_bytes, ph,
+            pn_enc, cnx->is_loss_bit_enabled_incoming, picoquic_sack_list_last(sack_list));
+    }
 
     return ret;
 }
@@ -2421,8 +2713,10 @@ int  picoquic_incoming_not_decrypted(
 
             if (length <= PICOQUIC_MAX_PACKET_SIZE &&
                 ((ph->ptype == picoquic_packet_handshake && cnx->client_mode) || ph->ptype == picoquic_packet_1rtt_protected)) {
-                /* stash a copy of the incoming message for processing once the keys are available */
-                picoquic_stateless_packet_t* packet = picoquic_create_stateless_packet(cnx->quic);
+                /* stash a copy of the incoming message for processing once the keys are available.
+                 * The copy is held by the connection, and is allocated from the heap rather
+                 * than from the stateless packet ring of the context. */
+                picoquic_stateless_packet_t* packet = picoquic_create_stateless_packet(NULL);
 
                 if (packet != NULL) {
                     packet->length = length;
@@ -2444,6 +2738,50 @@ int  picoquic_incoming_not_decrypted(
     return buffered;
 }
 
+/* Account for a dropped packet in the metrics of the context */
+static void picoquic_count_dropped_packet(picoquic_quic_t* quic, int ret)
+{
+    picoquic_drop_reason_enum reason;
+
+    switch (ret) {
+    case PICOQUIC_ERROR_AEAD_CHECK:
+    case PICOQUIC_ERROR_AEAD_NOT_READY:
+        reason = picoquic_drop_reason_decryption;
+        break;
+    case PICOQUIC_ERROR_PACKET_WRONG_VERSION:
+    case PICOQUIC_ERROR_VERSION_NOT_SUPPORTED:
+        reason = picoquic_drop_reason_version;
+        break;
+    case PICOQUIC_ERROR_INITIAL_TOO_SHORT:
+    case PICOQUIC_ERROR_INITIAL_CID_TOO_SHORT:
+    case PICOQUIC_ERROR_PACKET_TOO_LONG:
+        reason = picoquic_drop_reason_malformed;
+        break;
+    case PICOQUIC_ERROR_DETECTED: /* Mostly packets for unknown connections, also invalid VN packets */
+    case PICOQUIC_ERROR_UNEXPECTED_PACKET:
+    case PICOQUIC_ERROR_CNXID_CHECK:
+    case PICOQUIC_ERROR_CNXID_SEGMENT:
+    case PICOQUIC_ERROR_CONNECTION_DELETED:
+        reason = picoquic_drop_reason_unknown_cid;
+        break;
+    case PICOQUIC_ERROR_DUPLICATE:
+        reason = picoquic_drop_reason_duplicate;
+        break;
+    case PICOQUIC_ERROR_PORT_BLOCKED:
+    case PICOQUIC_ERROR_RETRY:
+    case PICOQUIC_ERROR_RETRY_NEEDED:
+    case PICOQUIC_ERROR_SERVER_BUSY:
+    case PICOQUIC_ERROR_INITIAL_RATE_LIMITED:
+        reason = picoquic_drop_reason_refused;
+        break;
+    default:
+        reason = picoquic_drop_reason_other;
+        break;
+    }
+
+    picoquic_counter_add_uint64(&quic->metrics.nb_packets_dropped[reason], 1);
+}
+
 /*
 * Processing of the packet that was just received from the network.
 */
@@ -2715,6 +3053,7 @@ int picoquic_incoming_segment(
         ret == PICOQUIC_ERROR_CNXID_CHECK || 
         ret == PICOQUIC_ERROR_RETRY || ret == PICOQUIC_ERROR_DETECTED ||
         ret == PICOQUIC_ERROR_SERVER_BUSY ||
+        ret == PICOQUIC_ERROR_INITIAL_RATE_LIMITED ||
         ret == PICOQUIC_ERROR_CONNECTION_DELETED ||
         ret == PICOQUIC_ERROR_CNXID_SEGMENT ||
         ret == PICOQUIC_ERROR_VERSION_NOT_SUPPORTED ||
@@ -2722,13 +3061,15 @@ int picoquic_incoming_segment(
         ret == PICOQUIC_ERROR_DUPLICATE ||
         ret == PICOQUIC_ERROR_AEAD_NOT_READY) {
         /* Bad packets are dropped silently */
+        picoquic_count_dropped_packet(quic, ret);
         if (ret == PICOQUIC_ERROR_AEAD_CHECK ||
             ret == PICOQUIC_ERROR_PACKET_WRONG_VERSION ||
             ret == PICOQUIC_ERROR_AEAD_NOT_READY ||
             ret == PICOQUIC_ERROR_PACKET_TOO_LONG ||
             ret == PICOQUIC_ERROR_VERSION_NOT_SUPPORTED ||
             ret == PICOQUIC_ERROR_RETRY ||
-            ret == PICOQUIC_ERROR_SERVER_BUSY) {
+            ret == PICOQUIC_ERROR_SERVER_BUSY ||
+            ret == PICOQUIC_ERROR_INITIAL_RATE_LIMITED) {
             ret = 0;
         }
         else {
@@ -2739,11 +3080,13 @@ int picoquic_incoming_segment(
         }
     } else if (ret == 1) {
         /* wonder what happened ! */
+        picoquic_count_dropped_packet(quic, ret);
         DBG_PRINTF("Packet (%d) get ret=1, t: %d, e: %d, pc: %d, pn: %d, l: %zu\n",
             (cnx == NULL) ? -1 : cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn, length);
         ret = -1;
     }
     else if (ret != 0) {
+        picoquic_count_dropped_packet(quic, ret);
         DBG_PRINTF("Packet (%d) error, t: %d, e: %d, pc: %d, pn: %d, l: %zu, ret : 0x%x\n",
             (cnx == NULL) ? -1 : cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn, length, ret);
         ret = -1;
@@ -2771,6 +3114,9 @@ int picoquic_incoming_packet_ex(
     int ret = 0;
     picoquic_connection_id_t previous_destid = picoquic_null_connection_id;
 
+    picoquic_counter_add_uint64(&quic->metrics.nb_packets_received, 1);
+    picoquic_counter_add_uint64(&quic->metrics.nb_bytes_received, packet_length);
+
     while (consumed_index < packet_length) {
         size_t consumed = 0;
 
@@ -20,34 +20,192 @@
 */
 
 /*
- * Basic hash implementation, like we have seen tons off already.
+ * Open addressing hash table, using Robin Hood linear probing and
+ * incremental resizing. Items are not copied in the table: the slots
+ * point to either embedded items (see picohash_key_to_item) or to
+ * items allocated on insert. Item pointers thus stay valid across
+ * resizes, which lets the callers keep references to them.
  */
 #include "picohash.h"
 #include <stdlib.h>
 #include <string.h>
 
+#define PICOHASH_MIN_SLOTS 8
+#define PICOHASH_MIGRATE_STEP 16
+
+/* Fibonacci hashing spreads hash values whose entropy is concentrated in a
+ * few bits, and maps them to a slot index without a division. */
+static size_t picohash_home_slot(uint64_t hash, int slot_shift)
+{
+    return (size_t)((hash * 0x9E3779B97F4A7C15ull) >> slot_shift);
+}
+
+static picohash_slot_t* picohash_slots_alloc(size_t nb_slots)
+{
+    picohash_slot_t* slots = NULL;
+    size_t slots_length = sizeof(picohash_slot_t) * nb_slots;
+
+    if ((slots_length / sizeof(picohash_slot_t)) == nb_slots) {
+        slots = (picohash_slot_t*)malloc(slots_length);
+        if (slots != NULL) {
+            memset(slots, 0, slots_length);
+        }
+    }
+
+    return slots;
+}
+
+static void picohash_slots_insert(picohash_slot_t* slots, size_t nb_slots, int slot_shift, uint64_t hash, picohash_item* item)
+{
+    size_t mask = nb_slots - 1;
+    size_t i = picohash_home_slot(hash, slot_shift);
+    size_t dist = 0;
+
+    while (slots[i].item != NULL) {
+        size_t slot_dist = (i - picohash_home_slot(slots[i].hash, slot_shift)) & mask;
+        if (slot_dist < dist) {
+            /* Take the slot from the richer item, continue with that one. */
+            picohash_slot_t displaced = slots[i];
+            slots[i].hash = hash;
+            slots[i].item = item;
+            hash = displaced.hash;
+            item = displaced.item;
+            dist = slot_dist;
+        }
+        i = (i + 1) & mask;
+        dist++;
+    }
+    slots[i].hash = hash;
+    slots[i].item = item;
+}
+
+/* Find the slot holding the item. If the item is NULL, match by key. */
+static picohash_slot_t* picohash_slots_find(const picohash_table* hash_table, picohash_slot_t* slots,
+    size_t nb_slots, int slot_shift, uint64_t hash, const void* key, const picohash_item* item)
+{
+    size_t mask = nb_slots - 1;
+    size_t i = picohash_home_slot(hash, slot_shift);
+    size_t dist = 0;
+    picohash_slot_t* found = NULL;
+
+    while (slots[i].item != NULL) {
+        if (((i - picohash_home_slot(slots[i].hash, slot_shift)) & mask) < dist) {
+            /* The key would have displaced this item, so it is not in the table */
+            break;
+        }
+        if (slots[i].hash == hash) {
+            if (item != NULL) {
+                if (slots[i].item == item) {
+                    found = &slots[i];
+                    break;
+                }
+            }
+            else if (hash_table->picohash_compare(key, slots[i].item->key) == 0) {
+                found = &slots[i];
+                break;
+            }
+        }
+        i = (i + 1) & mask;
+        dist++;
+    }
+
+    return found;
+}
+
+/* Remove a slot content using backward shift, so that probe sequences stay contiguous. */
+static void picohash_slots_remove(picohash_slot_t* slots, size_t nb_slots, int slot_shift, picohash_slot_t* slot)
+{
+    size_t mask = nb_slots - 1;
+    size_t i = (size_t)(slot - slots);
+    size_t next = (i + 1) & mask;
+
+    while (slots[next].item != NULL &&
+        ((next - picohash_home_slot(slots[next].hash, slot_shift)) & mask) != 0) {
+        slots[i] = slots[next];
+        i = next;
+        next = (next + 1) & mask;
+    }
+    slots[i].hash = 0;
+    slots[i].item = NULL;
+}
+
+/* Move a few items from the old slots to the new ones. Items are removed
+ * from the old slots with a regular delete, so the old slots remain a
+ * valid table for lookups during the whole migration. */
+static void picohash_migrate(picohash_table* hash_table, size_t nb_steps)
+{
+    while (hash_table->old_slots != NULL && nb_steps > 0) {
+        picohash_slot_t* slot = &hash_table->old_slots[hash_table->migrate_index];
+
+        if (slot->item != NULL) {
+            picohash_slots_insert(hash_table->slots, hash_table->nb_slots, hash_table->slot_shift, slot->hash, slot->item);
+            picohash_slots_remove(hash_table->old_slots, hash_table->old_nb_slots, hash_table->old_slot_shift, slot);
+        }
+        else {
+            hash_table->migrate_index++;
+            if (hash_table->migrate_index >= hash_table->old_nb_slots) {
+                free(hash_table->old_slots);
+                hash_table->old_slots = NULL;
+                hash_table->old_nb_slots = 0;
+                hash_table->migrate_index = 0;
+            }
+        }
+        nb_steps--;
+    }
+}
+
+static int picohash_grow(picohash_table* hash_table)
+{
+    int ret = 0;
+    picohash_slot_t* slots = NULL;
+
+    /* A previous migration must complete before starting a new one. This only
+     * happens if the table grows by more than 50% during the migration. */
+    picohash_migrate(hash_table, SIZE_MAX);
+
+    if (hash_table->nb_slots > SIZE_MAX / 2 ||
+        (slots = picohash_slots_alloc(hash_table->nb_slots * 2)) == NULL) {
+        ret = -1;
+    }
+    else {
+        hash_table->old_slots = hash_table->slots;
+        hash_table->old_nb_slots = hash_table->nb_slots;
+        hash_table->old_slot_shift = hash_table->slot_shift;
+        hash_table->migrate_index = 0;
+        hash_table->slots = slots;
+        hash_table->nb_slots *= 2;
+        hash_table->slot_shift--;
+    }
+
+    return ret;
+}
+
 picohash_table* picohash_create_ex(size_t nb_bin,
     uint64_t (*picohash_hash)(const void*),
     int (*picohash_compare)(const void*, const void*),
     picohash_item * (*picohash_key_to_item)(const void*))
 {
     picohash_table* t = (picohash_table*)malloc(sizeof(picohash_table));
-    size_t items_length = sizeof(picohash_item*) * nb_bin;
-    t->hash_bin = NULL;
-    if (t != NULL && (items_length / sizeof(picohash_item*)) == nb_bin) {
-        t->hash_bin = (picohash_item**)malloc(sizeof(picohash_item*) * nb_bin);
-    }
 
-    if (t->hash_bin == NULL) {
-        free(t);
-        t = NULL;
-    } else {
-        (void)memset(t->hash_bin, 0, sizeof(picohash_item*) * nb_bin);
-        t->nb_bin = nb_bin;
-        t->count = 0;
-        t->picohash_hash = picohash_hash;
-        t->picohash_compare = picohash_compare;
-        t->picohash_key_to_item = picohash_key_to_item;
+    if (t != NULL) {
+        memset(t, 0, sizeof(picohash_table));
+        /* The number of bins is only a sizing hint, rounded to a power of 2 */
+        t->nb_slots = PICOHASH_MIN_SLOTS;
+        t->slot_shift = 61;
+        while (t->nb_slots < nb_bin && t->nb_slots <= SIZE_MAX / 2 && t->slot_shift > 1) {
+            t->nb_slots *= 2;
+            t->slot_shift--;
+        }
+        t->slots = picohash_slots_alloc(t->nb_slots);
+        if (t->slots == NULL) {
+            free(t);
+            t = NULL;
+        }
+        else {
+            t->picohash_hash = picohash_hash;
+            t->picohash_compare = picohash_compare;
+            t->picohash_key_to_item = picohash_key_to_item;
+        }
     }
 
     return t;
@@ -63,15 +221,16 @@ picohash_table* picohash_create(size_t nb_bin,
 picohash_item* picohash_retrieve(picohash_table* hash_table, const void* key)
 {
     uint64_t hash = hash_table->picohash_hash(key);
-    uint32_t bin = (uint32_t)(hash % hash_table->nb_bin);
-    picohash_item* item = hash_table->hash_bin[bin];
+    picohash_item* item = NULL;
+    picohash_slot_t* slot = picohash_slots_find(hash_table, hash_table->slots, hash_table->nb_slots,
+        hash_table->slot_shift, hash, key, NULL);
 
-    while (item != NULL) {
-        if (hash_table->picohash_compare(key, item->key) == 0) {
-            break;
-        } else {
-            item = item->next_in_bin;
-        }
+    if (slot == NULL && hash_table->old_slots != NULL) {
+        slot = picohash_slots_find(hash_table, hash_table->old_slots, hash_table->old_nb_slots,
+            hash_table->old_slot_shift, hash, key, NULL);
+    }
+    if (slot != NULL) {
+        item = slot->item;
     }
 
     return item;
@@ -80,25 +239,33 @@ picohash_item* picohash_retrieve(picohash_table* hash_table, const void* key)
 int picohash_insert(picohash_table* hash_table, const void* key)
 {
     uint64_t hash = hash_table->picohash_hash(key);
-    uint32_t bin = (uint32_t)(hash % hash_table->nb_bin);
     int ret = 0;
     picohash_item* item;
-    
-    if (hash_table->picohash_key_to_item == NULL) {
-        item = (picohash_item*)malloc(sizeof(picohash_item));
+
+    picohash_migrate(hash_table, PICOHASH_MIGRATE_STEP);
+
+    if (hash_table->count + 1 > hash_table->nb_slots - (hash_table->nb_slots / 4) &&
+        picohash_grow(hash_table) != 0 && hash_table->count + 1 >= hash_table->nb_slots) {
+        /* Could not grow, and no free slot left */
+        ret = -1;
     }
     else {
-        item = hash_table->picohash_key_to_item(key);
-    }
+        if (hash_table->picohash_key_to_item == NULL) {
+            item = (picohash_item*)malloc(sizeof(picohash_item));
+        }
+        else {
+            item = hash_table->picohash_key_to_item(key);
+        }
 
-    if (item == NULL) {
-        ret = -1;
-    } else {
-        item->hash = hash;
-        item->key = key;
-        item->next_in_bin = hash_table->hash_bin[bin];
-        hash_table->hash_bin[bin] = item;
-        hash_table->count++;
+        if (item == NULL) {
+            ret = -1;
+        }
+        else {
+            item->hash = hash;
+            item->key = key;
+            picohash_slots_insert(hash_table->slots, hash_table->nb_slots, hash_table->slot_shift, hash, item);
+            hash_table->count++;
+        }
     }
 
     return ret;
@@ -106,24 +273,21 @@ int picohash_insert(picohash_table* hash_table, const void* key)
 
 void picohash_delete_item(picohash_table* hash_table, picohash_item* item, int delete_key_too)
 {
-    uint32_t bin = (uint32_t)(item->hash % hash_table->nb_bin);
-    picohash_item* previous = hash_table->hash_bin[bin];
     const void* shall_delete = NULL;
+    picohash_slot_t* slot = picohash_slots_find(hash_table, hash_table->slots, hash_table->nb_slots,
+        hash_table->slot_shift, item->hash, NULL, item);
 
-    if (previous == item) {
-        hash_table->hash_bin[bin] = item->next_in_bin;
+    if (slot != NULL) {
+        picohash_slots_remove(hash_table->slots, hash_table->nb_slots, hash_table->slot_shift, slot);
         hash_table->count--;
-    } else {
-        while (previous != NULL) {
-            if (previous->next_in_bin == item) {
-                previous->next_in_bin = item->next_in_bin;
-                hash_table->count--;
-                break;
-            } else {
-                previous = previous->next_in_bin;
-            }
-        }
     }
+    else if (hash_table->old_slots != NULL && (slot = picohash_slots_find(hash_table, hash_table->old_slots,
+        hash_table->old_nb_slots, hash_table->old_slot_shift, item->hash, NULL, item)) != NULL) {
+        picohash_slots_remove(hash_table->old_slots, hash_table->old_nb_slots, hash_table->old_slot_shift, slot);
+        hash_table->count--;
+    }
+
+    picohash_migrate(hash_table, PICOHASH_MIGRATE_STEP);
 
     shall_delete = item->key;
 
@@ -148,26 +312,44 @@ void picohash_delete_key(picohash_table* hash_table, void* key, int delete_key_t
     }
 }
 
+picohash_item* picohash_next_item(const picohash_table* hash_table, size_t* cursor)
+{
+    picohash_item* item = NULL;
+
+    /* The cursor runs through the current slots, then through the old slots */
+    while (item == NULL && *cursor < hash_table->nb_slots + hash_table->old_nb_slots) {
+        if (*cursor < hash_table->nb_slots) {
+            item = hash_table->slots[*cursor].item;
+        }
+        else {
+            item = hash_table->old_slots[*cursor - hash_table->nb_slots].item;
+        }
+        (*cursor)++;
+    }
+
+    return item;
+}
+
 void picohash_delete(picohash_table* hash_table, int delete_key_too)
 {
-    for (uint32_t i = 0; i < hash_table->nb_bin; i++) {
-        picohash_item* item = hash_table->hash_bin[i];
-        while (item != NULL) {
-            picohash_item* tmp = item;
-            const void* key_to_delete = tmp->key;
+    size_t cursor = 0;
+    picohash_item* item;
 
-            item = item->next_in_bin;
+    while ((item = picohash_next_item(hash_table, &cursor)) != NULL) {
+        const void* key_to_delete = item->key;
 
-            if (hash_table->picohash_key_to_item == NULL) {
-                free(tmp);
-            }
-            if (delete_key_too) {
-                free((void*)key_to_delete);
-            }
+        if (hash_table->picohash_key_to_item == NULL) {
+            free(item);
+        }
+        if (delete_key_too) {
+            free((void*)key_to_delete);
         }
     }
 
-    free(hash_table->hash_bin);
+    free(hash_table->slots);
+    if (hash_table->old_slots != NULL) {
+        free(hash_table->old_slots);
+    }
     free(hash_table);
 }
 
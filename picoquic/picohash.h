@@ -35,14 +35,32 @@ extern "C" {
 
 typedef struct _picohash_item {
     uint64_t hash;
-    struct _picohash_item* next_in_bin;
     const void* key;
 } picohash_item;
 
+/*
+ * The table uses open addressing with Robin Hood linear probing. Each slot
+ * holds the full hash of the item inline, so that most mismatches are
+ * rejected without calling the compare function or touching the key.
+ * The table doubles when the load exceeds 3/4. Growth is incremental:
+ * the previous slot array is kept until all its items have been moved,
+ * a few slots at a time, by subsequent inserts and deletes. Lookups check
+ * both arrays while the migration is in progress.
+ */
+typedef struct st_picohash_slot_t {
+    uint64_t hash;
+    picohash_item* item;
+} picohash_slot_t;
+
 typedef struct picohash_table {
     /* TODO: lock ! */
-    picohash_item** hash_bin;
-    size_t nb_bin;
+    picohash_slot_t* slots;
+    size_t nb_slots;
+    int slot_shift;
+    picohash_slot_t* old_slots;
+    size_t old_nb_slots;
+    int old_slot_shift;
+    size_t migrate_index;
     size_t count;
     uint64_t (*picohash_hash)(const void*);
     int (*picohash_compare)(const void*, const void*);
@@ -68,6 +86,11 @@ void picohash_delete_key(picohash_table* hash_table, void* key, int delete_key_t
 
 void picohash_delete(picohash_table* hash_table, int delete_key_too);
 
+/* Iterate through all items in the table. The cursor shall be set to 0
+ * before the first call. Returns NULL when all items have been visited.
+ * The table shall not be modified during the iteration. */
+picohash_item* picohash_next_item(const picohash_table* hash_table, size_t* cursor);
+
 uint64_t picohash_hash_mix(uint64_t hash, uint64_t h2);
 
 uint64_t picohash_bytes(const uint8_t* key, uint32_t length);
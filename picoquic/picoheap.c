@@ -0,0 +1,177 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoheap.h"
+
+#define PICOHEAP_ARITY 4
+#define PICOHEAP_MIN_SIZE 16
+
+void picoheap_init(picoheap_t* heap)
+{
+    memset(heap, 0, sizeof(picoheap_t));
+}
+
+void picoheap_clear(picoheap_t* heap)
+{
+    for (size_t i = 0; i < heap->size; i++) {
+        heap->entries[i].node->index = 0;
+    }
+    if (heap->entries != NULL) {
+        free(heap->entries);
+    }
+    picoheap_init(heap);
+}
+
+/* Make sure that the heap can hold at least size_min entries. Returns -1 if
+ * the memory cannot be allocated, in which case the heap is unchanged.
+ */
+int picoheap_reserve(picoheap_t* heap, size_t size_min)
+{
+    int ret = 0;
+
+    if (size_min > heap->size_max) {
+        size_t new_size = (heap->size_max < PICOHEAP_MIN_SIZE) ? PICOHEAP_MIN_SIZE : heap->size_max;
+        picoheap_entry_t* new_entries;
+
+        while (new_size < size_min) {
+            new_size *= 2;
+        }
+        if (new_size > SIZE_MAX / sizeof(picoheap_entry_t) ||
+            (new_entries = (picoheap_entry_t*)realloc(heap->entries, new_size * sizeof(picoheap_entry_t))) == NULL) {
+            ret = -1;
+        }
+        else {
+            heap->entries = new_entries;
+            heap->size_max = new_size;
+        }
+    }
+
+    return ret;
+}
+
+static void picoheap_set_entry(picoheap_t* heap, size_t position, uint64_t key, picoheap_node_t* node)
+{
+    heap->entries[position].key = key;
+    heap->entries[position].node = node;
+    node->index = position + 1;
+}
+
+static void picoheap_sift_up(picoheap_t* heap, size_t position, uint64_t key, picoheap_node_t* node)
+{
+    while (position > 0) {
+        size_t parent = (position - 1) / PICOHEAP_ARITY;
+
+        if (heap->entries[parent].key <= key) {
+            break;
+        }
+        picoheap_set_entry(heap, position, heap->entries[parent].key, heap->entries[parent].node);
+        position = parent;
+    }
+    picoheap_set_entry(heap, position, key, node);
+}
+
+static void picoheap_sift_down(picoheap_t* heap, size_t position, uint64_t key, picoheap_node_t* node)
+{
+    for (;;) {
+        size_t first_child = position * PICOHEAP_ARITY + 1;
+        size_t last_child = first_child + PICOHEAP_ARITY;
+        size_t best = position;
+        uint64_t best_key = key;
+
+        if (first_child >= heap->size) {
+            break;
+        }
+        if (last_child > heap->size) {
+            last_child = heap->size;
+        }
+        for (size_t child = first_child; child < last_child; child++) {
+            if (heap->entries[child].key < best_key) {
+                best = child;
+                best_key = heap->entries[child].key;
+            }
+        }
+        if (best == position) {
+            break;
+        }
+        picoheap_set_entry(heap, position, best_key, heap->entries[best].node);
+        position = best;
+    }
+    picoheap_set_entry(heap, position, key, node);
+}
+
+/* Place the entry at the specified position, moving it up or down as needed */
+static void picoheap_place(picoheap_t* heap, size_t position, uint64_t key, picoheap_node_t* node)
+{
+    if (position > 0 && heap->entries[(position - 1) / PICOHEAP_ARITY].key > key) {
+        picoheap_sift_up(heap, position, key, node);
+    }
+    else {
+        picoheap_sift_down(heap, position, key, node);
+    }
+}
+
+int picoheap_insert(picoheap_t* heap, picoheap_node_t* node, uint64_t key)
+{
+    int ret = 0;
+
+    if (picoheap_is_in_heap(node)) {
+        picoheap_update(heap, node, key);
+    }
+    else if ((ret = picoheap_reserve(heap, heap->size + 1)) == 0) {
+        heap->size++;
+        picoheap_sift_up(heap, heap->size - 1, key, node);
+    }
+
+    return ret;
+}
+
+void picoheap_update(picoheap_t* heap, picoheap_node_t* node, uint64_t key)
+{
+    if (picoheap_is_in_heap(node)) {
+        picoheap_place(heap, node->index - 1, key, node);
+    }
+}
+
+void picoheap_remove(picoheap_t* heap, picoheap_node_t* node)
+{
+    if (picoheap_is_in_heap(node)) {
+        size_t position = node->index - 1;
+
+        node->index = 0;
+        heap->size--;
+        if (position < heap->size) {
+            /* Move the last entry in the hole */
+            picoheap_place(heap, position, heap->entries[heap->size].key, heap->entries[heap->size].node);
+        }
+    }
+}
+
+picoheap_node_t* picoheap_first(const picoheap_t* heap)
+{
+    return (heap->size > 0) ? heap->entries[0].node : NULL;
+}
+
+uint64_t picoheap_first_key(const picoheap_t* heap)
+{
+    return (heap->size > 0) ? heap->entries[0].key : UINT64_MAX;
+}
@@ -0,0 +1,68 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Min heap of objects sorted by a 64 bit key, e.g., a wake up time.
+ * The heap is 4-ary, and stored in an array of (key, node) entries, so that
+ * comparisons do not need to touch the objects themselves. The heap node is
+ * embedded in the object, and records the position of the object in the heap,
+ * which allows updating or removing an object in O(log N) without search.
+ */
+#ifndef PICOHEAP_H
+#define PICOHEAP_H
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct st_picoheap_node_t {
+    size_t index; /* 1 + position of the entry in the heap, 0 if not in the heap */
+} picoheap_node_t;
+
+typedef struct st_picoheap_entry_t {
+    uint64_t key;
+    picoheap_node_t* node;
+} picoheap_entry_t;
+
+typedef struct st_picoheap_t {
+    picoheap_entry_t* entries;
+    size_t size;
+    size_t size_max;
+} picoheap_t;
+
+void picoheap_init(picoheap_t* heap);
+void picoheap_clear(picoheap_t* heap);
+int picoheap_reserve(picoheap_t* heap, size_t size_min);
+int picoheap_insert(picoheap_t* heap, picoheap_node_t* node, uint64_t key);
+void picoheap_update(picoheap_t* heap, picoheap_node_t* node, uint64_t key);
+void picoheap_remove(picoheap_t* heap, picoheap_node_t* node);
+picoheap_node_t* picoheap_first(const picoheap_t* heap);
+uint64_t picoheap_first_key(const picoheap_t* heap);
+
+#define picoheap_is_in_heap(node) ((node)->index != 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOHEAP_H */
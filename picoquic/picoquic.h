@@ -104,6 +104,7 @@ extern "C" {
 #define PICOQUIC_ERROR_PATH_ID_INVALID (PICOQUIC_ERROR_CLASS + 60)
 #define PICOQUIC_ERROR_RETRY_NEEDED (PICOQUIC_ERROR_CLASS + 61)
 #define PICOQUIC_ERROR_SERVER_BUSY (PICOQUIC_ERROR_CLASS + 62)
+#define PICOQUIC_ERROR_INITIAL_RATE_LIMITED (PICOQUIC_ERROR_CLASS + 63)
 
 /*
  * Protocol errors defined in the QUIC spec
@@ -515,6 +516,118 @@ uint32_t picoquic_current_number_connections(picoquic_quic_t * quic);
 void picoquic_set_max_half_open_retry_threshold(picoquic_quic_t* quic, uint32_t max_half_open_before_retry);
 uint32_t picoquic_get_max_half_open_retry_threshold(picoquic_quic_t* quic);
 
+/* Limit the rate of Initial packets that may create new connections from
+ * a source prefix (/24 for IPv4, /56 for IPv6). Each prefix may send up to
+ * max_burst such packets at once, refilled at max_per_second. Packets above
+ * that rate are dropped before any connection context is allocated or
+ * any key is derived. Setting max_per_second to 0 removes the limit,
+ * which is the default. */
+void picoquic_set_initial_rate_limit(picoquic_quic_t* quic, uint32_t max_per_second, uint32_t max_burst);
+
+/* Memory usage of a QUIC context, per type of object. The counts include
+ * the objects in use and those kept in the context's free lists for reuse.
+ * Sizes are approximate: compacted packets are counted at full size, and
+ * the allocator overhead is not counted.
+ */
+typedef enum {
+    picoquic_memory_packets = 0,
+    picoquic_memory_data_nodes,
+    picoquic_memory_stateless_packets,
+    picoquic_memory_streams,
+    picoquic_memory_paths,
+    picoquic_memory_cnx_ids,
+    picoquic_memory_cnx,
+    picoquic_memory_nb_types
+} picoquic_memory_type_enum;
+
+typedef struct st_picoquic_memory_usage_t {
+    size_t nb_allocated[picoquic_memory_nb_types];
+    size_t nb_in_pool[picoquic_memory_nb_types];
+    size_t bytes[picoquic_memory_nb_types];
+    size_t total_bytes;
+    size_t in_pool_bytes; /* Part of total_bytes kept in free lists */
+} picoquic_memory_usage_t;
+
+void picoquic_get_memory_usage(picoquic_quic_t* quic, picoquic_memory_usage_t* usage);
+
+/* Set a memory budget for the QUIC context, in bytes, as measured by
+ * picoquic_get_memory_usage, not counting the objects kept in free lists
+ * since these are reused before allocating new ones. Above 3/4 of the
+ * budget, receive windows grow more slowly and objects released by
+ * connections are freed instead of being kept for reuse. Above the budget,
+ * new connections are refused as if the server was busy, and no new flow
+ * control credit is granted until memory is released. Setting the budget
+ * to 0 removes it, which is the default. */
+void picoquic_set_memory_budget(picoquic_quic_t* quic, size_t max_bytes);
+
+/* Metrics of a QUIC context, updated continuously by the thread that runs
+ * the context. The counters are totals since the context was created. The
+ * times are in microseconds, and are only measured by the socket loop.
+ * The gauges are refreshed when packets are prepared, at most once per
+ * PICOQUIC_METRICS_GAUGE_INTERVAL.
+ *
+ * picoquic_get_quic_metrics can be called from any thread, without locks.
+ * Each value is read atomically, but the snapshot as a whole is not: the
+ * values may come from slightly different times.
+ */
+#define PICOQUIC_METRICS_GAUGE_INTERVAL 100000 /* 100 ms */
+
+typedef enum {
+    picoquic_drop_reason_decryption = 0, /* Decryption failed, or keys not available yet */
+    picoquic_drop_reason_version, /* Unexpected or unsupported version */
+    picoquic_drop_reason_malformed, /* Invalid length or header */
+    picoquic_drop_reason_unknown_cid, /* No matching connection */
+    picoquic_drop_reason_duplicate, /* Packet number already received */
+    picoquic_drop_reason_refused, /* Server busy, rate limited, blocked port or retry */
+    picoquic_drop_reason_other,
+    picoquic_drop_reason_nb
+} picoquic_drop_reason_enum;
+
+typedef struct st_picoquic_quic_metrics_t {
+    uint64_t nb_packets_received;
+    uint64_t nb_bytes_received;
+    uint64_t nb_packets_sent;
+    uint64_t nb_bytes_sent;
+    uint64_t nb_packets_dropped[picoquic_drop_reason_nb];
+    uint64_t nb_retransmissions;
+    uint64_t nb_stateless_packets_sent;
+    uint64_t nb_stateless_packets_dropped; /* Not sent, too many stateless packets queued */
+    uint64_t nb_initial_rate_limited;
+    uint64_t nb_initial_early_retry;
+    uint64_t nb_initial_refused_memory;
+    uint64_t time_receive;
+    uint64_t time_prepare;
+    uint64_t time_syscalls;
+    /* Gauges */
+    uint64_t nb_connections;
+    uint64_t nb_half_open;
+    uint64_t memory_bytes;
+    uint64_t nb_allocated[picoquic_memory_nb_types];
+    uint64_t nb_in_pool[picoquic_memory_nb_types];
+} picoquic_quic_metrics_t;
+
+void picoquic_get_quic_metrics(picoquic_quic_t* quic, picoquic_quic_metrics_t* metrics);
+
+/* Format the metrics in the Prometheus text exposition format. Returns 0 and
+ * sets text_length if successful, -1 if the text does not fit in text_size
+ * bytes. PICOQUIC_METRICS_TEXT_SIZE is always sufficient. */
+#define PICOQUIC_METRICS_TEXT_SIZE 8192
+
+int picoquic_format_quic_metrics(const picoquic_quic_metrics_t* metrics, char* text, size_t text_size,
+    size_t* text_length);
+
+/* The metrics exporter is a background thread that writes the metrics of a
+ * context to a file every interval, in Prometheus text format, for example
+ * in the directory of the node exporter's textfile collector. The file is
+ * written under a temporary name, then renamed, so readers never see a
+ * partial file. The exporter must be deleted before the QUIC context.
+ */
+typedef struct st_picoquic_metrics_exporter_t picoquic_metrics_exporter_t;
+
+picoquic_metrics_exporter_t* picoquic_metrics_exporter_create(picoquic_quic_t* quic, char const* file_name,
+    uint64_t interval_microsec);
+void picoquic_metrics_exporter_delete(picoquic_metrics_exporter_t* exporter);
+
 /* Obtain the reasons why a connection was closed */
 void picoquic_get_close_reasons(picoquic_cnx_t* cnx, uint64_t* local_reason,
     uint64_t* remote_reason, uint64_t* local_application_reason,
@@ -620,6 +733,29 @@ void picoquic_set_null_verifier(picoquic_quic_t* quic);
 /* Set the TLS private key(DER format) for the QUIC context. The caller is responsible for cleaning up the pointer. */
 int picoquic_set_tls_key(picoquic_quic_t* quic, const uint8_t* data, size_t len);
 
+/* Sign the server certificate in a pool of worker threads, instead of in the
+ * network thread. While the signature is computed, the handshake of the
+ * connection is parked; the network thread resumes it when calling
+ * picoquic_process_async_sign, which is done automatically when preparing
+ * packets. The wake up function is called by the worker threads when a
+ * signature is ready, e.g., to wake up the network thread; the socket loop
+ * sets it if wake up is supported. Without wake up function, the next wake
+ * time is set to poll for completed signatures every millisecond.
+ * Must be called after setting the private key. A key set afterwards
+ * replaces the asynchronous signer, and is used on the network thread.
+ * Returns 0 if successful,
+ * PICOQUIC_ERROR_TLS_SERVER_CON_WITHOUT_CERT if no key is set, or
+ * PICOQUIC_ERROR_UNEXPECTED_STATE if already enabled or if the TLS stack
+ * does not support asynchronous operations.
+ * picoquic_wait_async_sign waits until all submitted signatures are
+ * computed, or until the maximum wait time expires; it is mostly
+ * useful in tests. */
+typedef void (*picoquic_async_sign_wake_up_fn)(void* wake_up_ctx);
+int picoquic_enable_async_sign(picoquic_quic_t* quic, int nb_threads);
+void picoquic_set_async_sign_wake_up(picoquic_quic_t* quic, picoquic_async_sign_wake_up_fn wake_up_fn, void* wake_up_ctx);
+int picoquic_process_async_sign(picoquic_quic_t* quic, uint64_t current_time);
+int picoquic_wait_async_sign(picoquic_quic_t* quic, uint64_t max_wait_microsec);
+
 /* Set the verify certificate callback and context. */
 void picoquic_set_verify_certificate_callback(picoquic_quic_t* quic, 
     ptls_verify_certificate_t * cb, picoquic_free_verify_certificate_ctx free_fn);
@@ -823,6 +959,34 @@ void picoquic_close_immediate(picoquic_cnx_t* cnx);
 
 void picoquic_delete_cnx(picoquic_cnx_t* cnx);
 
+/* Moving a connection between QUIC contexts, for example to rebalance
+ * connections between worker threads that each own a QUIC context.
+ *
+ * The function "picoquic_cnx_detach" removes the connection from its
+ * QUIC context: list of connections, wake up list and the tables used to
+ * find the connection from incoming packets. After that, the connection
+ * is not owned by any context. The only valid operation on a detached
+ * connection is "picoquic_cnx_attach". Detaching is only possible after
+ * the handshake completed and before the connection is disconnected,
+ * otherwise the function returns PICOQUIC_ERROR_UNEXPECTED_STATE.
+ *
+ * The function "picoquic_cnx_attach" enters a detached connection in the
+ * QUIC context "quic". The new context must use the same length of
+ * local connection identifiers. It should use the same reset seed and
+ * TLS configuration as the old one, since the peer received stateless reset
+ * tokens computed by the old context. If one of the connection identifiers or
+ * addresses of the connection is already used in the new context, the
+ * function returns an error and the connection remains detached; it can then
+ * be attached back to its previous context.
+ *
+ * The two contexts are typically used by different threads. Detach in the
+ * thread owning the old context, pass the connection pointer to the other
+ * thread, and attach there. The application shall take care of
+ * forwarding packets received for that connection to the new thread.
+ */
+int picoquic_cnx_detach(picoquic_cnx_t* cnx);
+int picoquic_cnx_attach(picoquic_quic_t* quic, picoquic_cnx_t* cnx);
+
 /* set the app wake up time (or cancel it by setting it to zero) */
 void picoquic_set_app_wake_time(picoquic_cnx_t* cnx, uint64_t app_wake_time);
 
@@ -987,6 +1151,21 @@ picoquic_cnx_t* picoquic_get_earliest_cnx_to_wake(picoquic_quic_t* quic, uint64_
 
 uint64_t picoquic_get_next_wake_time(picoquic_quic_t* quic, uint64_t current_time);
 
+/* Select the structure used to keep the connections sorted by wake time.
+ * The default splay tree is fine for moderate numbers of connections.
+ * Servers handling a very large number of connections should use the
+ * 4-ary heap, which makes rescheduling a connection much cheaper.
+ * This is meant to be called just after picoquic_create, but connections
+ * already created are moved to the new structure. Returns PICOQUIC_ERROR_MEMORY
+ * if the heap cannot be allocated, in which case nothing changes.
+ */
+typedef enum {
+    picoquic_wake_scheduler_splay = 0,
+    picoquic_wake_scheduler_heap = 1
+} picoquic_wake_scheduler_enum;
+
+int picoquic_set_wake_scheduler(picoquic_quic_t* quic, picoquic_wake_scheduler_enum scheduler);
+
 picoquic_state_enum picoquic_get_cnx_state(picoquic_cnx_t* cnx);
 
 void picoquic_cnx_set_padding_policy(picoquic_cnx_t * cnx, uint32_t padding_multiple, uint32_t padding_minsize);
@@ -1194,6 +1373,11 @@ int picoquic_mark_active_stream(picoquic_cnx_t* cnx,
  * select the stream on which data was least recently sent. If it is
  * one, picoquic implements FIFO scheduling and selects the stream with
  * the lowest stream id.
+ * In both cases, streams on which a RESET_STREAM or STOP_SENDING frame
+ * is pending are served before the other streams of the same level.
+ * Selecting the next stream does not depend on the number of idle
+ * streams: each level keeps a queue of the streams that have data
+ * to send, sorted in the order in which they will be served.
  * 
  * There is no formal association between priority level and stream
  * content. Application developers can pick whatever convention they
@@ -1293,6 +1477,18 @@ void picoquic_reset_stream_ctx(picoquic_cnx_t* cnx, uint64_t stream_id);
  */
 int picoquic_add_to_stream_with_ctx(picoquic_cnx_t * cnx, uint64_t stream_id, const uint8_t * data, size_t length, int set_fin, void * app_stream_ctx);
 
+/* Same as "picoquic_add_to_stream_with_ctx", but without copy. The transport
+ * takes ownership of the data buffer, keeps a reference to it until the
+ * data is sent or the stream is abandoned, and then calls "free_fn" with the
+ * buffer and "free_ctx" as arguments. If "free_fn" is NULL, the buffer is
+ * never released and the application must keep it valid until the stream
+ * is closed. If the function returns an error, the buffer is not referenced
+ * and stays owned by the application.
+ */
+typedef void (*picoquic_stream_data_free_fn)(uint8_t* data, void* free_ctx);
+int picoquic_add_to_stream_owned(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* data, size_t length, int set_fin,
+    void* app_stream_ctx, picoquic_stream_data_free_fn free_fn, void* free_ctx);
+
 /* Reset a stream, indicating that no more data will be sent on 
  * that stream and that any data currently queued can be abandoned. */
 int picoquic_reset_stream(picoquic_cnx_t* cnx,
@@ -1415,6 +1611,17 @@ void picoquic_set_optimistic_ack_policy(picoquic_quic_t* quic, uint32_t sequence
 void picoquic_set_preemptive_repeat_policy(picoquic_quic_t* quic, int do_repeat);
 void picoquic_set_preemptive_repeat_per_cnx(picoquic_cnx_t* cnx, int do_repeat);
 
+/* Enable or disable compact retransmit records.
+ * By default, each packet waiting for acknowledgement is kept as a full size
+ * copy of the plaintext. In compact mode, data queued with "picoquic_add_to_stream"
+ * or "picoquic_add_to_stream_owned" is kept in the stream until acknowledged,
+ * and the copies of sent packets only keep references to the stream data,
+ * which are expanded again if the packet has to be repeated. This reduces
+ * memory usage for large congestion windows, at the cost of an extra copy
+ * on losses. Data provided "just in time" by active streams is not affected.
+ */
+void picoquic_set_compact_retransmit(picoquic_quic_t* quic, int use_compact_retransmit);
+
 /* Enables keep alive for a connection.
  * Keep alive interval is expressed in microseconds.
  * If `interval` is `0`, it is set to `idle_timeout / 2`.
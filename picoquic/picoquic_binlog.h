@@ -59,8 +59,42 @@ typedef enum {
 
     picoquic_log_event_frame_sent = 0x0082,
     picoquic_log_event_frame_recv = 0x0083,
+
+    picoquic_log_event_index = 0x00f0,
+    picoquic_log_event_index_end = 0x00f1,
 } picoquic_log_event_type;
 
+/* Binary log format, version 2.
+ *
+ * The file starts with a 16 bytes header: 'qlog', flags (16 bits),
+ * version (16 bits) and creation time (64 bits). The header is followed
+ * by a sequence of events, each encoded as a 32 bits length followed by
+ * the connection ID, time, path ID, event type and event data.
+ *
+ * When the connection closes, an index is appended as a set of events
+ * of type picoquic_log_event_index:
+ * - kind 0: a connection ID and the offset of its first event,
+ * - kind 1: up to PICOQUIC_BINLOG_SYNC_PER_EVENT sync points, each
+ *   encoded as a time and an event offset. Events before that offset
+ *   have a time lower or equal, events after it a time higher or equal.
+ * The file ends with an event of type picoquic_log_event_index_end,
+ * whose last 8 bytes are the offset of the first index event. Readers
+ * use the index to seek to a time window without scanning the file.
+ * Files of version 1, and files that were not closed properly, have no
+ * index and are read sequentially.
+ *
+ * Sync points are recorded every PICOQUIC_BINLOG_SYNC_EVENTS events, or
+ * when PICOQUIC_BINLOG_SYNC_INTERVAL microseconds elapsed since the
+ * previous one. Sync points across which events are out of time order
+ * are not written in the index.
+ */
+#define PICOQUIC_BINLOG_VERSION 2
+#define PICOQUIC_BINLOG_SYNC_EVENTS 1024
+#define PICOQUIC_BINLOG_SYNC_INTERVAL 1000000
+#define PICOQUIC_BINLOG_SYNC_PER_EVENT 128
+#define PICOQUIC_BINLOG_INDEX_KIND_CID 0
+#define PICOQUIC_BINLOG_INDEX_KIND_SYNC 1
+
 /* Log PDU arrival or departure */
 void binlog_pdu(FILE * f, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
     const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length);
@@ -112,6 +146,54 @@ int picoquic_set_binlog(picoquic_quic_t* quic, char const* binlog_dir);
 /* Enable binary logs, e.g. if autoqlog is requests */
 void picoquic_enable_binlog(picoquic_quic_t* quic);
 
+/* Asynchronous binary log writer.
+ *
+ * By default, binary log events are written to the per connection log
+ * file as they happen, on the thread that runs the connection. When a
+ * writer is set, the QUIC context instead copies the events to a ring
+ * buffer, and a background thread writes them to the log files. Each
+ * QUIC context gets its own ring, so the network threads never take a
+ * lock or wait for the disk. If a ring is full, events are dropped and
+ * counted in the writer statistics; the log files remain well formed.
+ * The next event of the connection is preceded by an info message giving
+ * the number of events dropped, and the connection close waits for room
+ * in the ring so the close event and the index are not lost.
+ *
+ * The same writer can be shared by several QUIC contexts, e.g., one per
+ * network thread. It must be deleted after these contexts are freed.
+ * Deleting the writer writes all pending events and closes the files.
+ */
+#define PICOQUIC_BINLOG_RING_SIZE_DEFAULT 0x100000
+
+typedef struct st_picoquic_binlog_writer_t picoquic_binlog_writer_t;
+
+typedef struct st_picoquic_binlog_writer_stats_t {
+    uint64_t nb_events_written;
+    uint64_t nb_bytes_written;
+    uint64_t nb_events_dropped;
+    uint64_t nb_bytes_dropped;
+} picoquic_binlog_writer_stats_t;
+
+/* Create a writer and start its thread. The ring size is rounded up to a
+ * power of 2, and applies to each QUIC context using the writer. */
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size);
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer);
+void picoquic_binlog_writer_get_stats(picoquic_binlog_writer_t* writer, picoquic_binlog_writer_stats_t* stats);
+
+/* Suspend or resume the writer thread. While the writer is paused, events
+ * are queued in the rings, and dropped once the rings are full. This is
+ * used in tests to simulate a stalled disk. Deleting the writer resumes it.
+ */
+void picoquic_binlog_writer_pause(picoquic_binlog_writer_t* writer, int is_paused);
+
+/* Write the binary logs of the QUIC context asynchronously through the
+ * writer, or synchronously if the writer is NULL. This also enables the
+ * binary log functions, as picoquic_enable_binlog. Connections already
+ * logging switch to the new mode once the events already queued for
+ * them are written.
+ */
+int picoquic_set_binlog_writer(picoquic_quic_t* quic, picoquic_binlog_writer_t* writer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,7 @@
 #endif
 
 #include "picohash.h"
+#include "picoheap.h"
 #include "picosplay.h"
 #include "picoquic.h"
 #include "picoquic_utils.h"
@@ -48,6 +49,10 @@ extern "C" {
 #define PICOQUIC_NB_PATH_TARGET 8
 #define PICOQUIC_NB_PATH_DEFAULT 2
 #define PICOQUIC_MAX_PACKETS_IN_POOL 0x2000
+#define PICOQUIC_DATA_NODE_NB_CLASSES 4
+#define PICOQUIC_MAX_OBJECTS_IN_POOL 0x100
+#define PICOQUIC_PENDING_RING_MIN 64
+#define PICOQUIC_PENDING_RING_MAX 0x100000
 #define PICOQUIC_STORED_IP_MAX 16
 
 #define PICOQUIC_INITIAL_RTT 250000ull /* 250 ms */
@@ -95,6 +100,12 @@ extern "C" {
 
 #define PICOQUIC_DEFAULT_SIMULTANEOUS_LOGS 32
 #define PICOQUIC_DEFAULT_HALF_OPEN_RETRY_THRESHOLD 64
+#define PICOQUIC_STATELESS_PACKET_RING_SIZE 32 /* Preallocated stateless packets per context */
+#define PICOQUIC_STATELESS_PACKET_MAX_ALLOCATED 224 /* Heap allocated stateless packets, in addition to the ring */
+#define PICOQUIC_ADMISSION_TABLE_SIZE 1024 /* Number of per prefix rate limiting buckets */
+#define PICOQUIC_ADMISSION_TABLE_WAYS 4 /* Buckets per set in the rate limiting table */
+#define PICOQUIC_ADMISSION_PREFIX_IPV4 3 /* bytes of the address used as prefix, i.e., /24 */
+#define PICOQUIC_ADMISSION_PREFIX_IPV6 7 /* bytes of the address used as prefix, i.e., /56 */
 
 #define PICOQUIC_PN_RANDOM_MIN 0xffff
 #define PICOQUIC_PN_RANDOM_RANGE 0x10000
@@ -164,7 +175,8 @@ typedef enum {
     picoquic_frame_type_max_path_id = 0x15228c0c,
     picoquic_frame_type_path_blocked = 0x15228c0d,
     picoquic_frame_type_observed_address_v4 = 0x9f81a6,
-    picoquic_frame_type_observed_address_v6 = 0x9f81a7
+    picoquic_frame_type_observed_address_v6 = 0x9f81a7,
+    picoquic_frame_type_stream_reference = 0x3fff5e0f /* internal only, never sent, see picoquic_compact_sent_packets */
 } picoquic_frame_type_enum_t;
 
 /* PMTU discovery requirement status */
@@ -336,6 +348,7 @@ extern picoquic_spinbit_def_t picoquic_spin_function_table[];
 
 typedef struct st_picoquic_stateless_packet_t {
     struct st_picoquic_stateless_packet_t* next_packet;
+    struct st_picoquic_quic_t* quic; /* Context accounting for the packet, NULL if allocated from the heap */
     struct sockaddr_storage addr_to;
     struct sockaddr_storage addr_local;
     int if_index_local;
@@ -349,13 +362,53 @@ typedef struct st_picoquic_stateless_packet_t {
     uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
 } picoquic_stateless_packet_t;
 
-/* Handling of stateless packets */
+/* Handling of stateless packets.
+ * Packets created for a QUIC context come from a ring of preallocated
+ * packets, or from the heap up to a fixed limit; if that limit is reached,
+ * the creation fails and the stateless reply is not sent. Packets created
+ * with a NULL context are allocated from the heap without limit.
+ */
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic);
 void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp);
 picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t* quic);
 void picoquic_delete_stateless_packet(picoquic_stateless_packet_t* sp);
 
-/* Data structure used to hold chunk of stream data before in sequence delivery */
+/* Free lists of the fixed size objects allocated by connections: streams,
+ * paths, local connection IDs and connection contexts. Objects are allocated
+ * individually rather than carved from larger chunks, because a connection
+ * and the objects it holds can be moved to another QUIC context by
+ * picoquic_cnx_attach. The counts are transferred to the new context
+ * when that happens, as are those of the packets and stream data nodes
+ * held by the connection. Free objects are linked through their first bytes.
+ */
+typedef struct st_picoquic_object_pool_t {
+    void* first_free;
+    size_t object_size;
+    int nb_in_pool;
+    int nb_allocated; /* In use or in the pool */
+    int nb_allocated_max;
+} picoquic_object_pool_t;
+
+void* picoquic_object_pool_alloc(picoquic_object_pool_t* pool);
+void picoquic_object_pool_release(picoquic_quic_t* quic, picoquic_object_pool_t* pool, void* object);
+void picoquic_object_pool_clear(picoquic_object_pool_t* pool);
+
+/* Memory budget, see picoquic_set_memory_budget. The memory in use excludes
+ * the objects kept in free lists. The pressure is 0 below 3/4 of the budget
+ * or if there is no budget, 1 below the budget, and 2 above it. */
+size_t picoquic_memory_in_use(picoquic_quic_t* quic);
+int picoquic_memory_pressure(picoquic_quic_t* quic);
+uint64_t picoquic_receive_window_increase(picoquic_cnx_t* cnx, uint64_t previous_window);
+
+/* Refresh the gauges in quic->metrics, if PICOQUIC_METRICS_GAUGE_INTERVAL has elapsed */
+void picoquic_update_quic_gauges(picoquic_quic_t* quic, uint64_t current_time);
+
+/* Data structure used to hold chunk of stream data before in sequence delivery.
+ * Nodes are allocated in size classes. Full size nodes hold a complete packet,
+ * and are used for decryption. Out of order fragments that have to be copied
+ * use the smallest class that fits, in which case only "data_size" bytes of
+ * "data" are allocated, and adjacent fragments are merged into larger extents.
+ */
 typedef struct st_picoquic_stream_data_node_t {
     picosplay_node_t stream_data_node;
     picoquic_quic_t* quic;
@@ -363,16 +416,24 @@ typedef struct st_picoquic_stream_data_node_t {
     uint64_t offset;  /* Stream offset of the first octet in "bytes" */
     size_t length;    /* Number of octets in "bytes" */
     const uint8_t* bytes;
-    uint8_t data[PICOQUIC_MAX_PACKET_SIZE];
+    int size_class;   /* Index of the size class, full size is PICOQUIC_DATA_NODE_NB_CLASSES - 1 */
+    size_t data_size; /* Number of octets allocated for "data" */
+    uint8_t data[PICOQUIC_MAX_PACKET_SIZE]; /* must be last, may be truncated */
 } picoquic_stream_data_node_t;
 
-/* Data structure used to hold chunk of stream data queued by application */
+/* Data structure used to hold chunk of stream data queued by application.
+ * Copied data is held in the same allocation, right after the node. Data
+ * passed with "picoquic_add_to_stream_owned" is referenced in place, and
+ * released with "free_fn" once sent or abandoned. */
 typedef struct st_picoquic_stream_queue_node_t {
     picoquic_quic_t* quic;
     struct st_picoquic_stream_queue_node_t* next_stream_data;
     uint64_t offset;  /* Stream offset of the first octet in "bytes" */
     size_t length;    /* Number of octets in "bytes" */
     uint8_t* bytes;
+    uint64_t stream_offset; /* Stream offset of bytes[0] */
+    picoquic_stream_data_free_fn free_fn;
+    void* free_ctx;
 } picoquic_stream_queue_node_t;
 
 /*
@@ -423,8 +484,11 @@ typedef struct st_picoquic_packet_t {
     unsigned int is_queued_for_retransmit : 1;
     unsigned int is_queued_for_spurious_detection : 1;
     unsigned int is_queued_for_data_repeat : 1;
+    unsigned int is_compaction_checked : 1;
+    unsigned int is_compacted : 1;
+    size_t compacted_length; /* end of the frames in a compacted packet, see picoquic_compact_sent_packets */
 
-    uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE]; /* must be last, truncated if the packet is compacted */
 } picoquic_packet_t;
 
 picoquic_packet_t* picoquic_create_packet(picoquic_quic_t* quic);
@@ -601,6 +665,22 @@ typedef int (*picoquic_autoqlog_fn)(picoquic_cnx_t * cnx);
  */
 typedef int (*picoquic_performance_log_fn)(picoquic_quic_t* quic, picoquic_cnx_t* cnx, int should_delete);
 
+/* Header protection masks computed in advance for a batch of short header
+ * packets, such as the datagrams returned by one recvmmsg call. The samples
+ * of consecutive packets for the same connection are encrypted in a single
+ * ECB call. The masks are used, in order, by picoquic_remove_header_protection.
+ */
+#define PICOQUIC_HEADER_MASK_BATCH_MAX 256
+
+typedef struct st_picoquic_header_mask_batch_t {
+    size_t nb_masks;
+    size_t next_mask;
+    const uint8_t* sample[PICOQUIC_HEADER_MASK_BATCH_MAX];
+    void* pn_dec_ecb[PICOQUIC_HEADER_MASK_BATCH_MAX];
+    uint8_t samples[PICOQUIC_HEADER_MASK_BATCH_MAX * 16];
+    uint8_t masks[PICOQUIC_HEADER_MASK_BATCH_MAX * 16];
+} picoquic_header_mask_batch_t;
+
 /* QUIC context, defining the tables of connections,
  * open sockets, etc.
  */
@@ -639,6 +719,7 @@ typedef struct st_picoquic_quic_t {
     uint32_t current_number_connections;
     uint32_t tentative_max_number_connections;
     uint32_t max_number_connections;
+    uint64_t nb_cnx_deleted; /* Lets the socket loop check that a saved connection pointer is still valid */
     uint64_t stateless_reset_next_time; /* Next time Stateless Reset or VN packet can be sent */
     uint64_t stateless_reset_min_interval; /* Enforced interval between two stateless reset packets */
     uint64_t cwin_max; /* max value of cwin per connection */
@@ -662,6 +743,8 @@ typedef struct st_picoquic_quic_t {
     unsigned int use_constant_challenges : 1; /* Use predictable challenges when producing constant logs. */
     unsigned int use_low_memory : 1; /* if possible, use low memory alternatives, e.g. for AES */
     unsigned int is_preemptive_repeat_enabled : 1; /* enable premptive repeat on new connections */
+    unsigned int use_compact_retransmit : 1; /* keep compact records of sent packets, see picoquic_set_compact_retransmit */
+    unsigned int use_wake_heap : 1; /* schedule connections with cnx_wake_heap, see picoquic_set_wake_scheduler */
     unsigned int default_send_receive_bdp_frame : 1; /* enable sending and receiving BDP frame */
     unsigned int enforce_client_only : 1; /* Do not authorize incoming connections */
     unsigned int test_large_server_flight : 1; /* Use TP to ensure server flight is at least 8K */
@@ -669,6 +752,13 @@ typedef struct st_picoquic_quic_t {
     unsigned int are_path_callbacks_enabled : 1; /* Enable path specific callbacks by default */
     unsigned int use_predictable_random : 1; /* For logging tests */
     picoquic_stateless_packet_t* pending_stateless_packet;
+    picoquic_stateless_packet_t* stateless_packet_ring; /* Preallocated on first use */
+    picoquic_stateless_packet_t* first_free_stateless_packet;
+    uint32_t nb_stateless_packets_allocated; /* Heap allocated packets in use */
+    /* Admission of incoming connections, see picoquic_set_initial_rate_limit */
+    struct st_picoquic_admission_bucket_t* admission_table; /* Allocated on first use */
+    uint32_t initial_rate_per_prefix; /* Initial packets per second from a prefix, 0 if no limit */
+    uint32_t initial_burst_per_prefix;
 
     picoquic_congestion_algorithm_t const* default_congestion_alg;
     uint64_t wifi_shadow_rtt;
@@ -677,8 +767,10 @@ typedef struct st_picoquic_quic_t {
     struct st_picoquic_cnx_t* cnx_list;
     struct st_picoquic_cnx_t* cnx_last;
     picosplay_tree_t cnx_wake_tree;
+    picoheap_t cnx_wake_heap; /* used instead of cnx_wake_tree if use_wake_heap is set */
 
     struct st_picoquic_cnx_t* cnx_in_progress;
+    picoquic_header_mask_batch_t* header_mask_batch; /* set between compute and clear, see picoquic_header_mask_batch_compute */
 
     picohash_table* table_cnx_by_id;
     picohash_table* table_cnx_by_net;
@@ -695,11 +787,23 @@ typedef struct st_picoquic_quic_t {
     int nb_packets_allocated;
     int nb_packets_allocated_max;
 
-    picoquic_stream_data_node_t* p_first_data_node;
+    picoquic_stream_data_node_t* p_first_data_node[PICOQUIC_DATA_NODE_NB_CLASSES];
+    int nb_data_nodes_in_class_pool[PICOQUIC_DATA_NODE_NB_CLASSES];
+    int nb_data_nodes_in_class_allocated[PICOQUIC_DATA_NODE_NB_CLASSES];
     int nb_data_nodes_in_pool;
     int nb_data_nodes_allocated;
     int nb_data_nodes_allocated_max;
 
+    picoquic_object_pool_t stream_pool;
+    picoquic_object_pool_t path_pool;
+    picoquic_object_pool_t local_cnxid_pool;
+    picoquic_object_pool_t cnx_pool;
+    size_t memory_budget; /* 0 if no budget, see picoquic_set_memory_budget */
+
+    /* Updated with picoquic_counter_add_uint64, read by picoquic_get_quic_metrics */
+    picoquic_quic_metrics_t metrics;
+    uint64_t metrics_gauge_time; /* Next refresh of the gauges */
+
     picoquic_connection_id_cb_fn cnx_id_callback_fn;
     void* cnx_id_callback_ctx;
 
@@ -734,6 +838,8 @@ typedef struct st_picoquic_quic_t {
     picoquic_autoqlog_fn autoqlog_fn;
     struct st_picoquic_unified_logging_t* text_log_fns;
     struct st_picoquic_unified_logging_t* bin_log_fns;
+    struct st_picoquic_binlog_ring_t* binlog_ring; /* set if binlogs are written asynchronously */
+    struct st_picoquic_async_sign_t* async_sign; /* set if certificates are signed by worker threads */
     struct st_picoquic_unified_logging_t* qlog_fns;
     picoquic_performance_log_fn perflog_fn;
     void* v_perflog_ctx;
@@ -803,6 +909,9 @@ typedef struct st_picoquic_stream_head_t {
     picosplay_node_t stream_node; /* splay of streams in connection context */
     struct st_picoquic_stream_head_t * next_output_stream; /* link in the list of output streams */
     struct st_picoquic_stream_head_t * previous_output_stream;
+    struct st_picoquic_stream_head_t * next_ready_stream; /* link in the ready or blocked queue */
+    struct st_picoquic_stream_head_t * previous_ready_stream;
+    struct st_picoquic_stream_ready_level_t * ready_level; /* priority level holding the stream, NULL if not queued */
     picoquic_cnx_t * cnx;
     uint64_t stream_id;
     struct st_picoquic_path_t * affinity_path; /* Path for which affinity is set, or NULL if none */
@@ -819,6 +928,9 @@ typedef struct st_picoquic_stream_head_t {
     picosplay_tree_t stream_data_tree; /* splay of received stream segments */
     uint64_t sent_offset; /* Amount of data sent in the stream */
     picoquic_stream_queue_node_t* send_queue; /* if the stream is not "active", list of data segments ready to send */
+    picoquic_stream_queue_node_t* send_queue_last; /* last segment in the send queue, for O(1) append */
+    picoquic_stream_queue_node_t* send_retained; /* segments sent but not yet acked, kept in compact retransmit mode */
+    picoquic_stream_queue_node_t* send_retained_last;
     void * app_stream_ctx;
     picoquic_stream_direct_receive_fn direct_receive_fn; /* direct receive function, if not NULL */
     void* direct_receive_ctx; /* direct receive context */
@@ -843,10 +955,30 @@ typedef struct st_picoquic_stream_head_t {
     unsigned int max_stream_updated : 1; /* After stream was closed in both directions, the max stream id number was updated */
     unsigned int stream_data_blocked_sent : 1; /* If stream_data_blocked has been sent to peer, and no data sent on stream since */
     unsigned int is_output_stream : 1; /* If stream is listed in the output list */
+    unsigned int is_ready_urgent : 1; /* Stream is queued in the urgent queue of its priority level */
+    unsigned int is_ready_blocked : 1; /* Stream is queued in the flow control blocked list */
     unsigned int is_closed : 1; /* Stream is closed, closure is accouted for */
     unsigned int is_discarded : 1; /* There should be no more callback for that stream, the application has discarded it */
 } picoquic_stream_head_t;
 
+/*
+ * Ready queues for the stream scheduler. There is one level per stream priority
+ * in use, kept in a list sorted by priority. Each level holds an urgent queue
+ * of streams with pending RESET_STREAM or STOP_SENDING frames, and a ready
+ * queue of streams with data to send. The ready queue is sorted by stream ID
+ * for FIFO levels (odd priority), and by time of last transmission then
+ * stream ID for round robin levels (even priority), so that the next stream
+ * to serve is at the head of the queue.
+ */
+typedef struct st_picoquic_stream_ready_level_t {
+    struct st_picoquic_stream_ready_level_t* next_level;
+    picoquic_stream_head_t* first_urgent_stream;
+    picoquic_stream_head_t* last_urgent_stream;
+    picoquic_stream_head_t* first_ready_stream;
+    picoquic_stream_head_t* last_ready_stream;
+    uint8_t stream_priority;
+} picoquic_stream_ready_level_t;
+
 #define IS_CLIENT_STREAM_ID(id) (unsigned int)(((id) & 1) == 0)
 #define IS_BIDIR_STREAM_ID(id)  (unsigned int)(((id) & 2) == 0)
 #define IS_LOCAL_STREAM_ID(id, client_mode)  (unsigned int)(((id)^(client_mode)) & 1)
@@ -893,6 +1025,8 @@ typedef struct st_picoquic_packet_context_t {
     uint64_t highest_acknowledged_time; /* time at which the highest ack was received */
     picoquic_packet_t* pending_last;
     picoquic_packet_t* pending_first;
+    picoquic_packet_t** pending_ring; /* pending packets indexed by sequence number modulo ring size */
+    size_t pending_ring_size; /* power of 2, or 0 if the ring is not allocated */
     picoquic_packet_t* retransmitted_newest;
     picoquic_packet_t* retransmitted_oldest;
     picoquic_packet_t* preemptive_repeat_ptr;
@@ -1236,8 +1370,27 @@ typedef struct st_picoquic_crypto_context_t {
     void* aead_decrypt;
     void* pn_enc; /* Used for PN encryption */
     void* pn_dec; /* Used for PN decryption */
+    void* pn_dec_ecb; /* AES suites only: ECB context for computing masks in batches */
 } picoquic_crypto_context_t;
 
+/* Index of a binary log, accumulated while the log is written and
+* appended to the file when the connection closes. Each sync point
+* records the time and file offset of the event that follows it.
+*/
+typedef struct st_picoquic_binlog_sync_t {
+    uint64_t time; /* Lowest time of the events logged after the sync point */
+    uint64_t max_time; /* Highest time of the events logged until the next sync point */
+    uint64_t offset;
+} picoquic_binlog_sync_t;
+
+typedef struct st_picoquic_binlog_index_t {
+    picoquic_binlog_sync_t* syncs;
+    size_t nb_syncs;
+    size_t nb_syncs_max;
+    uint64_t next_sync_time;
+    uint32_t nb_events_since_sync;
+} picoquic_binlog_index_t;
+
 /*
 * Per connection context.
 */
@@ -1372,6 +1525,7 @@ typedef struct st_picoquic_cnx_t {
     /* Next time sending data is expected */
     uint64_t next_wake_time;
     picosplay_node_t cnx_wake_node;
+    picoheap_node_t cnx_wake_heap_node;
     /* Wakeup time requested by the application */
     uint64_t app_wake_time;
     /* TLS context, TLS Send Buffer, streams, epochs */
@@ -1466,6 +1620,10 @@ typedef struct st_picoquic_cnx_t {
     picosplay_tree_t stream_tree;
     picoquic_stream_head_t * first_output_stream;
     picoquic_stream_head_t * last_output_stream;
+    picoquic_stream_ready_level_t* first_ready_level; /* Ready queues, by increasing priority number */
+    picoquic_stream_ready_level_t ready_level_fallback; /* Used if a level cannot be allocated, served after the others */
+    picoquic_stream_head_t* first_blocked_stream; /* Streams waiting for MAX_STREAM_DATA */
+    picoquic_stream_head_t* last_blocked_stream;
     uint64_t high_priority_stream_id;
     uint64_t next_stream_id[4];
     uint64_t priority_limit_for_bypass; /* Bypass CC if dtagram or stream priority lower than this, 0 means never */
@@ -1530,6 +1688,14 @@ typedef struct st_picoquic_cnx_t {
     uint16_t log_unique;
     FILE* f_binlog;
     char* binlog_file_name;
+    picoquic_binlog_index_t binlog_index;
+    /* Ring used to write the binlog asynchronously, position of the last
+     * event queued in that ring, size of the log written so far and number
+     * of events dropped since the last one queued. */
+    struct st_picoquic_binlog_ring_t* binlog_ring;
+    uint64_t binlog_ring_position;
+    uint64_t binlog_file_offset;
+    uint64_t binlog_nb_dropped;
 #ifdef PICOQUIC_MEMORY_LOG
     void (*memlog_call_back)(picoquic_cnx_t* cnx, picoquic_path_t* path, void* v_memlog, int op_code, uint64_t current_time);
     void *memlog_ctx;
@@ -1623,6 +1789,11 @@ picoquic_packet_t* picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx, picoq
     picoquic_packet_t* p, int should_free,
     int add_to_data_repeat_queue);
 void picoquic_dequeue_retransmitted_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p);
+picoquic_packet_t* picoquic_pending_ring_get(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number);
+picoquic_packet_t* picoquic_pending_ring_ceiling(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number);
+void picoquic_pending_ring_free(picoquic_packet_context_t* pkt_ctx);
+void picoquic_compact_sent_packets(picoquic_cnx_t* cnx);
+picoquic_packet_t* picoquic_expand_compacted_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p);
 
 /* Reset the connection context, e.g. after retry */
 int picoquic_reset_cnx(picoquic_cnx_t* cnx, uint64_t current_time);
@@ -1736,6 +1907,10 @@ uint64_t picoquic_get_packet_number64(uint64_t highest, uint64_t mask, uint32_t
 
 void picoquic_log_pn_dec_trial(picoquic_cnx_t* cnx); /* For debugging potential PN_ENC corruption */
 
+void picoquic_header_mask_batch_add(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch, const uint8_t* bytes, size_t length);
+void picoquic_header_mask_batch_compute(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch);
+void picoquic_header_mask_batch_clear(picoquic_quic_t* quic, picoquic_header_mask_batch_t* batch);
+int picoquic_remove_header_protection(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* decrypted_bytes, picoquic_packet_header* ph);
 int picoquic_remove_header_protection_inner(uint8_t* bytes, size_t length, uint8_t* decrypted_bytes, picoquic_packet_header* ph, void* pn_enc, unsigned int is_loss_bit_enabled_incoming, uint64_t sack_list_last);
 
 size_t picoquic_pad_to_target_length(uint8_t* bytes, size_t length, size_t target);
@@ -1871,6 +2046,14 @@ picoquic_stream_head_t * picoquic_stream_from_node(picosplay_node_t * node);
 void picoquic_insert_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t * stream);
 void picoquic_remove_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t * stream);
 void picoquic_reorder_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream);
+int picoquic_is_stream_exhausted(picoquic_stream_head_t* stream);
+int picoquic_stream_has_pending_data(picoquic_stream_head_t* stream);
+void picoquic_queue_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream);
+void picoquic_dequeue_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream);
+void picoquic_block_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream);
+void picoquic_free_ready_levels(picoquic_cnx_t* cnx);
+picoquic_stream_ready_level_t* picoquic_first_ready_level(picoquic_cnx_t* cnx);
+picoquic_stream_ready_level_t* picoquic_next_ready_level(picoquic_cnx_t* cnx, picoquic_stream_ready_level_t* level);
 picoquic_stream_head_t * picoquic_first_stream(picoquic_cnx_t * cnx);
 picoquic_stream_head_t * picoquic_last_stream(picoquic_cnx_t * cnx);
 picoquic_stream_head_t * picoquic_next_stream(picoquic_stream_head_t * stream);
@@ -1910,6 +2093,7 @@ void picoquic_queue_data_repeat_packet(
 void picoquic_dequeue_data_repeat_packet(
     picoquic_cnx_t* cnx, picoquic_packet_t* packet);
 picoquic_packet_t* picoquic_first_data_repeat_packet(picoquic_cnx_t* cnx);
+void* picoquic_queue_data_repeat_node_value(picosplay_node_t* node);
 uint8_t* picoquic_copy_stream_frame_for_retransmit(
     picoquic_cnx_t* cnx, picoquic_packet_t* packet,
     uint8_t* bytes_next, uint8_t* bytes_max);
@@ -1956,6 +2140,10 @@ typedef struct st_picoquic_stream_data_buffer_argument_t {
 int picoquic_is_stream_frame_unlimited(const uint8_t* bytes);
 
 uint8_t* picoquic_format_stream_frame_header(uint8_t* bytes, uint8_t* bytes_max, uint64_t stream_id, uint64_t offset);
+uint8_t* picoquic_format_stream_reference_frame(uint8_t* bytes, const uint8_t* bytes_max,
+    uint8_t flags, uint64_t stream_id, uint64_t offset, uint64_t length);
+const uint8_t* picoquic_parse_stream_reference_frame(const uint8_t* bytes, const uint8_t* bytes_max,
+    uint8_t* flags, uint64_t* stream_id, uint64_t* offset, uint64_t* length);
 
 int picoquic_parse_stream_header(
     const uint8_t* bytes, size_t bytes_max,
@@ -1979,7 +2167,15 @@ uint8_t* picoquic_format_max_stream_data_frame(picoquic_cnx_t* cnx, picoquic_str
 uint64_t picoquic_cc_increased_window(picoquic_cnx_t* cnx, uint64_t previous_window); /* Trigger sending more data if window increases */
 uint8_t* picoquic_format_max_streams_frame_if_needed(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
 void picoquic_stream_data_node_recycle(picoquic_stream_data_node_t* stream_data);
+int picoquic_stream_queue_add(picoquic_stream_head_t* stream, uint8_t* data, size_t length,
+    int copy_data, picoquic_stream_data_free_fn free_fn, void* free_ctx);
+void picoquic_stream_queue_pop(picoquic_stream_head_t* stream, int retain_data);
+void picoquic_stream_queue_free(picoquic_stream_head_t* stream);
+void picoquic_stream_release_acked_data(picoquic_stream_head_t* stream);
+int picoquic_stream_copy_sent_data(picoquic_stream_head_t* stream, uint64_t offset, size_t length, uint8_t* bytes,
+    uint64_t* copied_offset);
 picoquic_stream_data_node_t* picoquic_stream_data_node_alloc(picoquic_quic_t* quic);
+picoquic_stream_data_node_t* picoquic_stream_data_node_alloc_ex(picoquic_quic_t* quic, size_t min_size);
 void picoquic_clear_stream(picoquic_stream_head_t* stream);
 void picoquic_delete_stream(picoquic_cnx_t * cnx, picoquic_stream_head_t * stream);
 picoquic_local_cnxid_list_t* picoquic_find_or_create_local_cnxid_list(picoquic_cnx_t* cnx, uint64_t unique_path_id, int do_create);
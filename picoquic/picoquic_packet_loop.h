@@ -34,6 +34,8 @@ extern "C" {
 #define PICOQUIC_PACKET_LOOP_RECV_MAX 10
 #define PICOQUIC_PACKET_LOOP_SEND_MAX 10
 #define PICOQUIC_PACKET_LOOP_SEND_DELAY_MAX 2500
+#define PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX 16
+#define PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX 16
 
 typedef struct st_picoquic_socket_ctx_t {
     SOCKET_TYPE fd;
@@ -133,6 +135,17 @@ typedef struct st_picoquic_packet_loop_param_t {
     int extra_socket_required;
     int simulate_eio;
     size_t send_length_max;
+    /* Linux only: receive batches of datagrams with recvmmsg,
+     * and request UDP_GRO coalescing unless do_not_use_gso is set.
+     * Ignored on platforms that do not support recvmmsg. */
+    int use_recv_batch;
+    /* Linux only: collect the packets prepared for several connections
+     * and send them with a single call to sendmmsg. Each message keeps
+     * its own destination and GSO segment size. */
+    int use_send_batch;
+    /* Set SO_REUSEPORT before binding the sockets, so several loops
+     * can share the same port. Used by the sharded server. */
+    int reuse_port;
 } picoquic_packet_loop_param_t;
 
 int picoquic_packet_loop_v2(picoquic_quic_t* quic,
@@ -161,6 +174,8 @@ typedef int (*picoquic_custom_thread_create_fn)(void** thread_id, picoquic_threa
 typedef void (*picoquic_custom_thread_setname_fn)(char const* thread_name);
 typedef void (*picoquic_custom_thread_delete_fn)(void** thread_id);
 
+struct st_picoquic_shard_t;
+
 typedef struct st_picoquic_network_thread_ctx_t {
     picoquic_quic_t* quic;
     picoquic_packet_loop_param_t* param;
@@ -181,6 +196,9 @@ typedef struct st_picoquic_network_thread_ctx_t {
     volatile int thread_should_close;
     volatile int thread_is_closed;
     int return_code;
+    struct st_picoquic_shard_t* shard; /* Set if the thread is part of a sharded server */
+    picoquic_mpsc_queue_t command_queue; /* Commands posted by application threads */
+    volatile int command_signaled; /* Set when a wake up was requested for posted commands */
 } picoquic_network_thread_ctx_t;
 
 picoquic_network_thread_ctx_t* picoquic_start_network_thread(
@@ -193,6 +211,44 @@ picoquic_network_thread_ctx_t* picoquic_start_network_thread(
 int picoquic_wake_up_network_thread(picoquic_network_thread_ctx_t* thread_ctx);
 void picoquic_delete_network_thread(picoquic_network_thread_ctx_t* thread_ctx);
 
+/* Posting commands to the network thread.
+* 
+* Application threads can use these functions instead of calling the
+* corresponding picoquic APIs from the wake up callback. Each call
+* allocates a command, pushes it on a lock-free queue attached to the
+* thread context, and wakes up the network thread if that was not already
+* requested. The network thread executes the queued commands in order of
+* arrival when it wakes up, before calling the application with
+* `picoquic_packet_loop_wake_up` and before preparing new packets.
+* There is no lock, so many application threads can post commands to the
+* same network thread without contention.
+* 
+* The functions return 0 if the command was queued, or an error code if
+* the command could not be allocated or the network thread could not be
+* woken up. Errors occurring when the command is executed are not reported.
+* The data passed to picoquic_network_thread_add_to_stream or to
+* picoquic_network_thread_queue_datagram is copied, and can be released
+* as soon as the function returns.
+* 
+* The connection context must remain valid until the command is executed.
+* Since connections are deleted in the network thread, the application
+* shall stop posting commands for a connection once it has posted a close
+* command or received a close notification for it.
+*/
+int picoquic_network_thread_add_to_stream(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t stream_id, const uint8_t* data, size_t length, int set_fin);
+int picoquic_network_thread_mark_active_stream(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t stream_id, int is_active, void* v_stream_ctx);
+int picoquic_network_thread_queue_datagram(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, const uint8_t* bytes, size_t length);
+int picoquic_network_thread_close(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t application_reason_code);
+/* Execute the commands posted so far. This is called by the packet loop
+* when the thread wakes up, and must only be called from the thread that
+* runs the loop, or from tests when no loop is running.
+*/
+void picoquic_network_thread_drain_commands(picoquic_network_thread_ctx_t* thread_ctx);
+
 /* The function picoquic_start_network_thread creates a background thread using
 * the "native" threading APIs, CreateThread in Windows or pthread_create in
 * Unix/Posix systems. This will not work in some environments, if for example
@@ -280,6 +336,51 @@ int picoquic_internal_thread_create(void** pthread,
 void picoquic_internal_thread_delete(void** pthread);
 void picoquic_internal_thread_setname(char const * thread_name);
 
+/* Sharded server.
+* 
+* A single network thread can only use one core. Servers that need to
+* scale further can run several "shards", each with its own network thread,
+* its own QUIC context and its own sockets, all bound to the same port
+* using SO_REUSEPORT. The kernel spreads the incoming packets between the
+* shard sockets based on the hash of the address tuple, which means that
+* packets for a given connection normally reach the same shard.
+* 
+* The tuple can change during the connection, for example after a NAT
+* rebinding or a migration. To handle that, the shard number is encoded
+* in the connection identifiers. If a shard receives a short header packet
+* for a CID that belongs to another shard, it forwards the packet to that
+* shard through an internal queue, and wakes up the owner's thread.
+* 
+* The application creates and configures one QUIC context per shard, and
+* passes the array of contexts to picoquic_start_sharded_server. Unless the
+* application already configured the load balancer CID generation with
+* picoquic_lb_compat_cid_config, the shards are configured to encode the
+* shard number in clear text in the first byte after the CID header byte.
+* If the application configured the load balancer option, the server ID
+* must be equal to the shard number. If the application configured some other
+* CID generation callback, packets are never forwarded between shards.
+* 
+* The loop parameters must specify a local port. The same loop callback
+* and callback context are used for all shards; the callback can use the
+* QUIC context argument to find out which shard is calling.
+* 
+* The function picoquic_delete_sharded_server stops all the network
+* threads, and releases the resources allocated by the sharded server.
+* The QUIC contexts are not deleted, this is the responsibility of the
+* application.
+*/
+typedef struct st_picoquic_sharded_server_t picoquic_sharded_server_t;
+
+picoquic_sharded_server_t* picoquic_start_sharded_server(
+    picoquic_quic_t** quic,
+    int nb_shards,
+    picoquic_packet_loop_param_t* param,
+    picoquic_packet_loop_cb_fn loop_callback,
+    void* loop_callback_ctx,
+    int* ret);
+int picoquic_sharded_server_is_ready(picoquic_sharded_server_t* sharded_server);
+void picoquic_delete_sharded_server(picoquic_sharded_server_t* sharded_server);
+
 /* Legacy versions the packet loop, one portable and one specialized
  * for winsock. Keeping these API for compatibility, but the implementation
  * redirects to picoquic_packet_loop_v2.
@@ -307,6 +408,17 @@ int picoquic_packet_loop_win(picoquic_quic_t* quic,
 void picoquic_packet_loop_close_socket(picoquic_socket_ctx_t* s_ctx);
 int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
     int do_not_use_gso, picoquic_socket_ctx_t* s_ctx);
+int picoquic_packet_loop_open_sockets_ex(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
+    int do_not_use_gso, int reuse_port, picoquic_socket_ctx_t* s_ctx);
+int picoquic_sharded_server_find_shard(picoquic_quic_t* quic, int nb_shards, const uint8_t* bytes, size_t length);
+#if defined(__linux__)
+struct st_picoquic_recv_batch_t* picoquic_recv_batch_create(int use_gro);
+void picoquic_recv_batch_delete(struct st_picoquic_recv_batch_t* recv_batch);
+int picoquic_recv_batch_add_message(struct st_picoquic_recv_batch_t* recv_batch, const uint8_t* bytes, size_t length,
+    const struct sockaddr* addr_from, const struct sockaddr* addr_dest, size_t udp_coalesced_size);
+int picoquic_packet_loop_submit_batch(picoquic_network_thread_ctx_t* thread_ctx,
+    struct st_picoquic_recv_batch_t* recv_batch, picoquic_cnx_t** last_cnx, uint64_t current_time);
+#endif
 
 #ifdef __cplusplus
 }
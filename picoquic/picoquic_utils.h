@@ -227,6 +227,44 @@ void picoquic_delete_event(picoquic_event_t* event);
 int picoquic_signal_event(picoquic_event_t* event);
 int picoquic_wait_for_event(picoquic_event_t* event, uint64_t microsec_wait);
 
+/* Atomic operations, used for lock-free exchanges between threads.
+ * The exchange functions have full barrier semantics, the loads have at
+ * least acquire semantics and the store at least release semantics.
+ */
+void* picoquic_atomic_exchange_ptr(void* volatile* target, void* value);
+void* picoquic_atomic_load_ptr(void* volatile* target);
+int picoquic_atomic_exchange_int(volatile int* target, int value);
+uint64_t picoquic_atomic_load_uint64(volatile uint64_t* target);
+void picoquic_atomic_store_uint64(volatile uint64_t* target, uint64_t value);
+
+/* Add to a counter that a single thread updates and other threads may read
+ * with picoquic_atomic_load_uint64. This is not an atomic add: it does not
+ * require a locked instruction, but concurrent calls from several threads
+ * would lose updates. */
+void picoquic_counter_add_uint64(volatile uint64_t* target, uint64_t value);
+
+/* Lock-free multiple producers, single consumer queue, after the
+ * intrusive queue design of Dmitry Vyukov. The node is embedded in the
+ * queued object, pushing never allocates memory or takes a lock.
+ * Any thread may push; only one thread at a time may pop. The pop
+ * function may return NULL while a push is in progress in another thread,
+ * even if the queue is not empty. The producer should then signal the
+ * consumer after the push completes.
+ */
+typedef struct st_picoquic_mpsc_node_t {
+    struct st_picoquic_mpsc_node_t* volatile next;
+} picoquic_mpsc_node_t;
+
+typedef struct st_picoquic_mpsc_queue_t {
+    picoquic_mpsc_node_t* volatile last; /* Updated by producers */
+    picoquic_mpsc_node_t* first; /* Only accessed by the consumer */
+    picoquic_mpsc_node_t stub;
+} picoquic_mpsc_queue_t;
+
+void picoquic_mpsc_init(picoquic_mpsc_queue_t* queue);
+void picoquic_mpsc_push(picoquic_mpsc_queue_t* queue, picoquic_mpsc_node_t* node);
+picoquic_mpsc_node_t* picoquic_mpsc_pop(picoquic_mpsc_queue_t* queue);
+
 /* Simple portable random number generation
  */
 uint64_t picoquic_uniform_random(uint64_t rnd_max);
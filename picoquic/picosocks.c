@@ -241,6 +241,42 @@ int picoquic_socket_set_pmtud_options(SOCKET_TYPE sd, int af)
     return ret;
 }
 
+/* Request UDP generic receive offload (GRO) on Linux. When it is
+ * enabled, the kernel may coalesce several datagrams received from
+ * the same peer into a single buffer, and documents the segment
+ * size in an UDP_GRO control message. Returns -1 if not supported.
+ */
+int picoquic_socket_set_udp_gro(SOCKET_TYPE sd)
+{
+    int ret = -1;
+#if defined(UDP_GRO)
+    int val = 1;
+    ret = setsockopt(sd, SOL_UDP, UDP_GRO, &val, sizeof(int));
+#else
+#ifdef UNREFERENCED_PARAMETER
+    UNREFERENCED_PARAMETER(sd);
+#endif
+#endif
+    return ret;
+}
+
+/* Allow several sockets to bind to the same port, and let the kernel
+ * distribute the incoming packets between them. Returns -1 if not supported.
+ */
+int picoquic_socket_set_reuse_port(SOCKET_TYPE sd)
+{
+    int ret = -1;
+#if defined(SO_REUSEPORT)
+    int val = 1;
+    ret = setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, (const char*)&val, sizeof(int));
+#else
+#ifdef UNREFERENCED_PARAMETER
+    UNREFERENCED_PARAMETER(sd);
+#endif
+#endif
+    return ret;
+}
+
 SOCKET_TYPE picoquic_open_client_socket(int af)
 {
 #ifdef _WINDOWS
@@ -474,6 +510,15 @@ void picoquic_socks_cmsg_parse(
                 }
             }
         }
+#if defined(UDP_GRO)
+        else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            if (udp_coalesced_size != NULL) {
+                int gro_size = 0;
+                memcpy(&gro_size, CMSG_DATA(cmsg), sizeof(int));
+                *udp_coalesced_size = (size_t)gro_size;
+            }
+        }
+#endif
     }
 #endif
 }
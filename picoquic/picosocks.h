@@ -185,6 +185,8 @@ void picoquic_close_server_sockets(picoquic_server_sockets_t* sockets);
 int picoquic_socket_set_pkt_info(SOCKET_TYPE sd, int af);
 int picoquic_socket_set_ecn_options(SOCKET_TYPE sd, int af, int * recv_set, int * send_set);
 int picoquic_socket_set_pmtud_options(SOCKET_TYPE sd, int af);
+int picoquic_socket_set_udp_gro(SOCKET_TYPE sd);
+int picoquic_socket_set_reuse_port(SOCKET_TYPE sd);
 
 int picoquic_select(SOCKET_TYPE* sockets, int nb_sockets,
     struct sockaddr_storage* addr_from,
@@ -648,6 +648,10 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
         quic->crypto_epoch_length_max = 0;
         quic->max_simultaneous_logs = PICOQUIC_DEFAULT_SIMULTANEOUS_LOGS;
         quic->max_half_open_before_retry = PICOQUIC_DEFAULT_HALF_OPEN_RETRY_THRESHOLD;
+        quic->stream_pool.object_size = sizeof(picoquic_stream_head_t);
+        quic->path_pool.object_size = sizeof(picoquic_path_t);
+        quic->local_cnxid_pool.object_size = sizeof(picoquic_local_cnxid_t);
+        quic->cnx_pool.object_size = sizeof(picoquic_cnx_t);
         quic->default_lossbit_policy = 0; /* For compatibility with old behavior. Consider 0 */
         quic->local_cnxid_ttl = UINT64_MAX;
         quic->stateless_reset_next_time = current_time;
@@ -951,6 +955,9 @@ void picoquic_free(picoquic_quic_t* quic)
         /* Deelete the reused tokens tree */
         picosplay_empty_tree(&quic->token_reuse_tree);
 
+        /* Release the wake heap, which is empty after deleting all connections */
+        picoheap_clear(&quic->cnx_wake_heap);
+
         /* delete packets in pool */
         while (quic->p_first_packet != NULL) {
             picoquic_packet_t * p = quic->p_first_packet->packet_previous;
@@ -961,19 +968,40 @@ void picoquic_free(picoquic_quic_t* quic)
         }
 
         /* delete data nodes in pool */
-        while (quic->p_first_data_node != NULL) {
-            picoquic_stream_data_node_t* p = quic->p_first_data_node->next_stream_data;
-            free(quic->p_first_data_node);
-            quic->p_first_data_node = p;
-            quic->nb_data_nodes_allocated--;
-            quic->nb_data_nodes_in_pool--;
+        for (int size_class = 0; size_class < PICOQUIC_DATA_NODE_NB_CLASSES; size_class++) {
+            while (quic->p_first_data_node[size_class] != NULL) {
+                picoquic_stream_data_node_t* p = quic->p_first_data_node[size_class]->next_stream_data;
+                free(quic->p_first_data_node[size_class]);
+                quic->p_first_data_node[size_class] = p;
+                quic->nb_data_nodes_allocated--;
+                quic->nb_data_nodes_in_pool--;
+                quic->nb_data_nodes_in_class_pool[size_class]--;
+                quic->nb_data_nodes_in_class_allocated[size_class]--;
+            }
         }
 
+        /* delete the objects in the connection pools */
+        picoquic_object_pool_clear(&quic->stream_pool);
+        picoquic_object_pool_clear(&quic->path_pool);
+        picoquic_object_pool_clear(&quic->local_cnxid_pool);
+        picoquic_object_pool_clear(&quic->cnx_pool);
+
         /* delete all pending stateless packets */
         while (quic->pending_stateless_packet != NULL) {
             picoquic_stateless_packet_t* to_delete = quic->pending_stateless_packet;
             quic->pending_stateless_packet = to_delete->next_packet;
-            free(to_delete);
+            picoquic_delete_stateless_packet(to_delete);
+        }
+
+        if (quic->stateless_packet_ring != NULL) {
+            free(quic->stateless_packet_ring);
+            quic->stateless_packet_ring = NULL;
+            quic->first_free_stateless_packet = NULL;
+        }
+
+        if (quic->admission_table != NULL) {
+            free(quic->admission_table);
+            quic->admission_table = NULL;
         }
 
         if (quic->table_cnx_by_id != NULL) {
@@ -1060,17 +1088,77 @@ uint32_t picoquic_get_max_half_open_retry_threshold(picoquic_quic_t* quic)
     return quic->max_half_open_before_retry;
 }
 
+void picoquic_set_initial_rate_limit(picoquic_quic_t* quic, uint32_t max_per_second, uint32_t max_burst)
+{
+    quic->initial_rate_per_prefix = max_per_second;
+    quic->initial_burst_per_prefix = (max_burst == 0) ? 1 : max_burst;
+}
+
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic)
 {
-#ifdef _WINDOWS
-    UNREFERENCED_PARAMETER(quic);
-#endif
-    return (picoquic_stateless_packet_t*)malloc(sizeof(picoquic_stateless_packet_t));
+    picoquic_stateless_packet_t* sp = NULL;
+
+    if (quic == NULL) {
+        sp = (picoquic_stateless_packet_t*)malloc(sizeof(picoquic_stateless_packet_t));
+        if (sp != NULL) {
+            sp->quic = NULL;
+        }
+    }
+    else {
+        if (quic->stateless_packet_ring == NULL) {
+            quic->stateless_packet_ring = (picoquic_stateless_packet_t*)malloc(
+                sizeof(picoquic_stateless_packet_t) * PICOQUIC_STATELESS_PACKET_RING_SIZE);
+            if (quic->stateless_packet_ring != NULL) {
+                for (int i = 0; i < PICOQUIC_STATELESS_PACKET_RING_SIZE; i++) {
+                    quic->stateless_packet_ring[i].next_packet = (i + 1 < PICOQUIC_STATELESS_PACKET_RING_SIZE) ?
+                        &quic->stateless_packet_ring[i + 1] : NULL;
+                }
+                quic->first_free_stateless_packet = &quic->stateless_packet_ring[0];
+            }
+        }
+
+        if ((sp = quic->first_free_stateless_packet) != NULL) {
+            quic->first_free_stateless_packet = sp->next_packet;
+        }
+        else if (quic->nb_stateless_packets_allocated < PICOQUIC_STATELESS_PACKET_MAX_ALLOCATED &&
+            (sp = (picoquic_stateless_packet_t*)malloc(sizeof(picoquic_stateless_packet_t))) != NULL) {
+            quic->nb_stateless_packets_allocated++;
+        }
+        else {
+            /* Too many stateless packets waiting, e.g., during a flood of Initial packets */
+            picoquic_counter_add_uint64(&quic->metrics.nb_stateless_packets_dropped, 1);
+        }
+
+        if (sp != NULL) {
+            sp->quic = quic;
+        }
+    }
+
+    if (sp != NULL) {
+        sp->next_packet = NULL;
+    }
+
+    return sp;
 }
 
 void picoquic_delete_stateless_packet(picoquic_stateless_packet_t* sp)
 {
-    free(sp);
+    picoquic_quic_t* quic = sp->quic;
+
+    if (quic == NULL) {
+        free(sp);
+    }
+    else if (quic->stateless_packet_ring != NULL && sp >= quic->stateless_packet_ring &&
+        sp < quic->stateless_packet_ring + PICOQUIC_STATELESS_PACKET_RING_SIZE) {
+        sp->next_packet = quic->first_free_stateless_packet;
+        quic->first_free_stateless_packet = sp;
+    }
+    else {
+        if (quic->nb_stateless_packets_allocated > 0) {
+            quic->nb_stateless_packets_allocated--;
+        }
+        free(sp);
+    }
 }
 
 void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp)
@@ -1127,10 +1215,9 @@ int picoquic_register_cnx_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, picoqui
 void picoquic_unregister_net_id(picoquic_cnx_t* cnx, picoquic_path_t* path_x)
 {
     if (path_x->net_id_hash_item.key != NULL) {
-        picohash_item* item = picohash_retrieve(cnx->quic->table_cnx_by_net, path_x);
-        if (item != NULL) {
-            picohash_delete_item(cnx->quic->table_cnx_by_net, item, 0);
-        }
+        /* The key is only set while the path is entered in the table */
+        picohash_delete_item(cnx->quic->table_cnx_by_net, &path_x->net_id_hash_item, 0);
+        path_x->net_id_hash_item.key = NULL;
         memset(&path_x->registered_peer_addr, 0, sizeof(struct sockaddr_storage));
     }
 }
@@ -1291,7 +1378,7 @@ static void picoquic_insert_cnx_in_list(picoquic_quic_t* quic, picoquic_cnx_t* c
     quic->current_number_connections++;
 }
 
-static void picoquic_remove_cnx_from_list(picoquic_cnx_t* cnx)
+static void picoquic_unlink_cnx_from_list(picoquic_cnx_t* cnx)
 {
     if (cnx->next_in_table == NULL) {
         cnx->quic->cnx_last = cnx->previous_in_table;
@@ -1305,14 +1392,25 @@ static void picoquic_remove_cnx_from_list(picoquic_cnx_t* cnx)
     else {
         cnx->previous_in_table->next_in_table = cnx->next_in_table;
     }
+    cnx->next_in_table = NULL;
+    cnx->previous_in_table = NULL;
+
+    cnx->quic->current_number_connections--;
+}
 
+static void picoquic_remove_cnx_from_list(picoquic_cnx_t* cnx)
+{
+    picoquic_unlink_cnx_from_list(cnx);
     picoquic_unregister_net_icid(cnx);
     picoquic_unregister_net_secret(cnx);
-
-    cnx->quic->current_number_connections--;
 }
 
-/* Management of the list of connections, sorted by wake time */
+/* Management of the list of connections, sorted by wake time.
+ * By default, the connections are kept in a splay tree. If "use_wake_heap"
+ * is set, they are kept in a 4-ary heap instead, see picoquic_set_wake_scheduler.
+ * The heap is reserved when connections are created, so that inserting
+ * a connection in the heap never fails.
+ */
 
 static void* picoquic_wake_list_node_value(picosplay_node_t* cnx_wake_node)
 {
@@ -1344,28 +1442,97 @@ static void picoquic_wake_list_init(picoquic_quic_t * quic)
 {
     picosplay_init_tree(&quic->cnx_wake_tree, picoquic_wake_list_compare,
         picoquic_wake_list_create_node, picoquic_wake_list_delete_node, picoquic_wake_list_node_value);
+    picoheap_init(&quic->cnx_wake_heap);
+}
+
+static picoquic_cnx_t* picoquic_wake_heap_node_value(picoheap_node_t* cnx_wake_heap_node)
+{
+    return (cnx_wake_heap_node == NULL) ? NULL :
+        (picoquic_cnx_t*)((char*)cnx_wake_heap_node - offsetof(struct st_picoquic_cnx_t, cnx_wake_heap_node));
 }
 
 static void picoquic_remove_cnx_from_wake_list(picoquic_cnx_t* cnx)
 {
-    picosplay_delete_hint(&cnx->quic->cnx_wake_tree, &cnx->cnx_wake_node);
+    if (cnx->quic->use_wake_heap) {
+        picoheap_remove(&cnx->quic->cnx_wake_heap, &cnx->cnx_wake_heap_node);
+    }
+    else {
+        picosplay_delete_hint(&cnx->quic->cnx_wake_tree, &cnx->cnx_wake_node);
+    }
 }
 
 static void picoquic_insert_cnx_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
 {
-    picosplay_insert(&quic->cnx_wake_tree, cnx);
+    if (quic->use_wake_heap) {
+        if (picoheap_insert(&quic->cnx_wake_heap, &cnx->cnx_wake_heap_node, cnx->next_wake_time) != 0) {
+            /* Should not happen, since the heap is reserved when the connection is created */
+            DBG_PRINTF("%s", "Cannot insert connection in wake heap");
+        }
+    }
+    else {
+        picosplay_insert(&quic->cnx_wake_tree, cnx);
+    }
 }
 
 void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint64_t next_time)
 {
-    picoquic_remove_cnx_from_wake_list(cnx);
-    cnx->next_wake_time = next_time;
-    picoquic_insert_cnx_by_wake_time(quic, cnx);
+    if (quic->use_wake_heap && picoheap_is_in_heap(&cnx->cnx_wake_heap_node)) {
+        /* Move the connection in place, without removing it */
+        cnx->next_wake_time = next_time;
+        picoheap_update(&quic->cnx_wake_heap, &cnx->cnx_wake_heap_node, next_time);
+    }
+    else {
+        picoquic_remove_cnx_from_wake_list(cnx);
+        cnx->next_wake_time = next_time;
+        picoquic_insert_cnx_by_wake_time(quic, cnx);
+    }
+}
+
+int picoquic_set_wake_scheduler(picoquic_quic_t* quic, picoquic_wake_scheduler_enum scheduler)
+{
+    int ret = 0;
+    unsigned int use_wake_heap = (scheduler == picoquic_wake_scheduler_heap) ? 1 : 0;
+
+    if (use_wake_heap != quic->use_wake_heap) {
+        if (use_wake_heap &&
+            picoheap_reserve(&quic->cnx_wake_heap, (size_t)quic->current_number_connections + 1) != 0) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            picoquic_cnx_t* cnx = quic->cnx_list;
+
+            while (cnx != NULL) {
+                picoquic_remove_cnx_from_wake_list(cnx);
+                cnx = cnx->next_in_table;
+            }
+            quic->use_wake_heap = use_wake_heap;
+            cnx = quic->cnx_list;
+            while (cnx != NULL) {
+                picoquic_insert_cnx_by_wake_time(quic, cnx);
+                cnx = cnx->next_in_table;
+            }
+            if (!use_wake_heap) {
+                picoheap_clear(&quic->cnx_wake_heap);
+            }
+        }
+    }
+
+    return ret;
+}
+
+static picoquic_cnx_t* picoquic_get_first_cnx_by_wake_time(picoquic_quic_t* quic)
+{
+    if (quic->use_wake_heap) {
+        return picoquic_wake_heap_node_value(picoheap_first(&quic->cnx_wake_heap));
+    }
+    else {
+        return (picoquic_cnx_t*)picoquic_wake_list_node_value(picosplay_first(&quic->cnx_wake_tree));
+    }
 }
 
 picoquic_cnx_t* picoquic_get_earliest_cnx_to_wake(picoquic_quic_t* quic, uint64_t max_wake_time)
 {
-    picoquic_cnx_t* cnx = (picoquic_cnx_t *)picoquic_wake_list_node_value(picosplay_first(&quic->cnx_wake_tree));
+    picoquic_cnx_t* cnx = picoquic_get_first_cnx_by_wake_time(quic);
     if (cnx != NULL && max_wake_time != 0 && cnx->next_wake_time > max_wake_time)
     {
         cnx = NULL;
@@ -1382,14 +1549,20 @@ uint64_t picoquic_get_next_wake_time(picoquic_quic_t* quic, uint64_t current_tim
         wake_time = current_time;
     }
     else{
-        picoquic_cnx_t* cnx_wake_first = (picoquic_cnx_t*)picoquic_wake_list_node_value(
-            picosplay_first(&quic->cnx_wake_tree));
+        picoquic_cnx_t* cnx_wake_first = picoquic_get_first_cnx_by_wake_time(quic);
 
         if (cnx_wake_first != NULL) {
             wake_time = cnx_wake_first->next_wake_time;
         }
     }
 
+    if (quic->async_sign != NULL) {
+        uint64_t sign_wake_time = picoquic_async_sign_wake_time(quic, current_time);
+        if (sign_wake_time < wake_time) {
+            wake_time = sign_wake_time;
+        }
+    }
+
     return wake_time;
 }
 
@@ -1567,7 +1740,7 @@ int picoquic_create_path(picoquic_cnx_t* cnx, uint64_t start_time, const struct
     {
         uint64_t unique_path_id = picoquic_find_avalaible_unique_path_id(cnx, requested_id);
         picoquic_path_t * path_x = (unique_path_id == UINT64_MAX)?NULL:
-            (picoquic_path_t *)malloc(sizeof(picoquic_path_t));
+            (picoquic_path_t *)picoquic_object_pool_alloc(&cnx->quic->path_pool);
 
         if (path_x != NULL)
         {
@@ -1644,7 +1817,7 @@ static void picoquic_clear_path_data(picoquic_cnx_t* cnx, picoquic_path_t * path
     }
 
     /* Free the record */
-    free(path_x);
+    picoquic_object_pool_release(cnx->quic, &cnx->quic->path_pool, path_x);
 }
 
 void picoquic_delete_path(picoquic_cnx_t* cnx, int path_index)
@@ -2951,17 +3124,196 @@ void* picoquic_stream_data_node_value(picosplay_node_t* node)
     return (void*)((char*)node - offsetof(struct st_picoquic_stream_data_node_t, stream_data_node));
 }
 
+/* Size classes of stream data nodes. The largest class holds a full packet. */
+static const size_t picoquic_data_node_class_size[PICOQUIC_DATA_NODE_NB_CLASSES] = {
+    64, 256, 768, PICOQUIC_MAX_PACKET_SIZE };
+
+/* Object pools, used for the fixed size objects created by connections.
+ * The objects are not zeroed when allocated; callers initialize them.
+ */
+void* picoquic_object_pool_alloc(picoquic_object_pool_t* pool)
+{
+    void* object = pool->first_free;
+
+    if (object != NULL) {
+        pool->first_free = *(void**)object;
+        pool->nb_in_pool--;
+    }
+    else if ((object = malloc(pool->object_size)) != NULL) {
+        pool->nb_allocated++;
+        if (pool->nb_allocated > pool->nb_allocated_max) {
+            pool->nb_allocated_max = pool->nb_allocated;
+        }
+    }
+
+    return object;
+}
+
+void picoquic_object_pool_release(picoquic_quic_t* quic, picoquic_object_pool_t* pool, void* object)
+{
+    if (pool->nb_in_pool < PICOQUIC_MAX_OBJECTS_IN_POOL && picoquic_memory_pressure(quic) == 0) {
+        *(void**)object = pool->first_free;
+        pool->first_free = object;
+        pool->nb_in_pool++;
+    }
+    else {
+        pool->nb_allocated--;
+        free(object);
+    }
+}
+
+void picoquic_object_pool_clear(picoquic_object_pool_t* pool)
+{
+    while (pool->first_free != NULL) {
+        void* next = *(void**)pool->first_free;
+        free(pool->first_free);
+        pool->first_free = next;
+        pool->nb_allocated--;
+        pool->nb_in_pool--;
+    }
+}
+
+static void picoquic_set_memory_usage_pool(picoquic_memory_usage_t* usage, picoquic_memory_type_enum t,
+    picoquic_object_pool_t* pool)
+{
+    usage->nb_allocated[t] = (size_t)pool->nb_allocated;
+    usage->nb_in_pool[t] = (size_t)pool->nb_in_pool;
+    usage->bytes[t] = (size_t)pool->nb_allocated * pool->object_size;
+    usage->in_pool_bytes += (size_t)pool->nb_in_pool * pool->object_size;
+}
+
+void picoquic_get_memory_usage(picoquic_quic_t* quic, picoquic_memory_usage_t* usage)
+{
+    picoquic_stateless_packet_t* sp = quic->first_free_stateless_packet;
+
+    memset(usage, 0, sizeof(picoquic_memory_usage_t));
+
+    usage->nb_allocated[picoquic_memory_packets] = (size_t)quic->nb_packets_allocated;
+    usage->nb_in_pool[picoquic_memory_packets] = (size_t)quic->nb_packets_in_pool;
+    usage->bytes[picoquic_memory_packets] = (size_t)quic->nb_packets_allocated * sizeof(picoquic_packet_t);
+    usage->in_pool_bytes = (size_t)quic->nb_packets_in_pool * sizeof(picoquic_packet_t);
+
+    usage->nb_allocated[picoquic_memory_data_nodes] = (size_t)quic->nb_data_nodes_allocated;
+    usage->nb_in_pool[picoquic_memory_data_nodes] = (size_t)quic->nb_data_nodes_in_pool;
+    for (int size_class = 0; size_class < PICOQUIC_DATA_NODE_NB_CLASSES; size_class++) {
+        usage->bytes[picoquic_memory_data_nodes] += (size_t)quic->nb_data_nodes_in_class_allocated[size_class] *
+            (offsetof(picoquic_stream_data_node_t, data) + picoquic_data_node_class_size[size_class]);
+        usage->in_pool_bytes += (size_t)quic->nb_data_nodes_in_class_pool[size_class] *
+            (offsetof(picoquic_stream_data_node_t, data) + picoquic_data_node_class_size[size_class]);
+    }
+
+    usage->nb_allocated[picoquic_memory_stateless_packets] = quic->nb_stateless_packets_allocated;
+    if (quic->stateless_packet_ring != NULL) {
+        usage->nb_allocated[picoquic_memory_stateless_packets] += PICOQUIC_STATELESS_PACKET_RING_SIZE;
+    }
+    while (sp != NULL) {
+        usage->nb_in_pool[picoquic_memory_stateless_packets]++;
+        sp = sp->next_packet;
+    }
+    usage->bytes[picoquic_memory_stateless_packets] = usage->nb_allocated[picoquic_memory_stateless_packets] *
+        sizeof(picoquic_stateless_packet_t);
+    usage->in_pool_bytes += usage->nb_in_pool[picoquic_memory_stateless_packets] * sizeof(picoquic_stateless_packet_t);
+
+    picoquic_set_memory_usage_pool(usage, picoquic_memory_streams, &quic->stream_pool);
+    picoquic_set_memory_usage_pool(usage, picoquic_memory_paths, &quic->path_pool);
+    picoquic_set_memory_usage_pool(usage, picoquic_memory_cnx_ids, &quic->local_cnxid_pool);
+    picoquic_set_memory_usage_pool(usage, picoquic_memory_cnx, &quic->cnx_pool);
+
+    for (int t = 0; t < picoquic_memory_nb_types; t++) {
+        usage->total_bytes += usage->bytes[t];
+    }
+}
+
+size_t picoquic_memory_in_use(picoquic_quic_t* quic)
+{
+    picoquic_memory_usage_t usage;
+
+    picoquic_get_memory_usage(quic, &usage);
+
+    return usage.total_bytes - usage.in_pool_bytes;
+}
+
+void picoquic_update_quic_gauges(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_memory_usage_t usage;
+
+    picoquic_get_memory_usage(quic, &usage);
+
+    picoquic_atomic_store_uint64(&quic->metrics.nb_connections, quic->current_number_connections);
+    picoquic_atomic_store_uint64(&quic->metrics.nb_half_open, quic->current_number_half_open);
+    picoquic_atomic_store_uint64(&quic->metrics.memory_bytes, usage.total_bytes);
+    for (int t = 0; t < picoquic_memory_nb_types; t++) {
+        picoquic_atomic_store_uint64(&quic->metrics.nb_allocated[t], usage.nb_allocated[t]);
+        picoquic_atomic_store_uint64(&quic->metrics.nb_in_pool[t], usage.nb_in_pool[t]);
+    }
+
+    quic->metrics_gauge_time = current_time + PICOQUIC_METRICS_GAUGE_INTERVAL;
+}
+
+void picoquic_set_memory_budget(picoquic_quic_t* quic, size_t max_bytes)
+{
+    quic->memory_budget = max_bytes;
+}
+
+int picoquic_memory_pressure(picoquic_quic_t* quic)
+{
+    int pressure = 0;
+
+    if (quic->memory_budget > 0) {
+        size_t in_use = picoquic_memory_in_use(quic);
+
+        if (in_use >= quic->memory_budget) {
+            pressure = 2;
+        }
+        else if (in_use >= quic->memory_budget - quic->memory_budget / 4) {
+            pressure = 1;
+        }
+    }
+
+    return pressure;
+}
+
+/* Compute by how much a receive window shall increase once half of it
+ * was consumed. Under memory pressure, the increase is limited to a
+ * quarter of the previous window, so that the amount of data the peer
+ * may send before the application consumes it shrinks. Above the
+ * budget, no new credit is granted.
+ */
+uint64_t picoquic_receive_window_increase(picoquic_cnx_t* cnx, uint64_t previous_window)
+{
+    uint64_t new_window;
+
+    switch (picoquic_memory_pressure(cnx->quic)) {
+    case 0:
+        new_window = picoquic_cc_increased_window(cnx, previous_window);
+        break;
+    case 1:
+        new_window = previous_window / 4;
+        break;
+    default:
+        new_window = 0;
+        break;
+    }
+
+    return new_window;
+}
+
 void picoquic_stream_data_node_recycle(picoquic_stream_data_node_t* stream_data)
 {
-    if (stream_data->quic->nb_data_nodes_in_pool < PICOQUIC_MAX_PACKETS_IN_POOL) {
-        stream_data->next_stream_data = stream_data->quic->p_first_data_node;
-        stream_data->quic->p_first_data_node = stream_data;
-        stream_data->quic->nb_data_nodes_in_pool++;
-        //printf("pool: %d, allocated: %d\n", stream_data->quic->nb_data_nodes_in_pool, stream_data->quic->nb_data_nodes_allocated);
+    picoquic_quic_t* quic = stream_data->quic;
+    int size_class = stream_data->size_class;
+
+    /* The pool limit applies to the sum of all classes, so the pooled
+     * memory stays below that of a single pool of full size nodes. */
+    if (quic->nb_data_nodes_in_pool < PICOQUIC_MAX_PACKETS_IN_POOL) {
+        stream_data->next_stream_data = quic->p_first_data_node[size_class];
+        quic->p_first_data_node[size_class] = stream_data;
+        quic->nb_data_nodes_in_class_pool[size_class]++;
+        quic->nb_data_nodes_in_pool++;
     }
     else {
-        stream_data->quic->nb_data_nodes_allocated--;
-        //printf("FUORI\n");
+        quic->nb_data_nodes_allocated--;
+        quic->nb_data_nodes_in_class_allocated[size_class]--;
         free(stream_data);
     }
 }
@@ -2973,36 +3325,53 @@ void picoquic_stream_data_node_delete(void* tree, picosplay_node_t* node)
     picoquic_stream_data_node_recycle(stream_data);
 }
 
-picoquic_stream_data_node_t* picoquic_stream_data_node_alloc(picoquic_quic_t* quic)
+/* Allocate a node from the smallest size class that can hold min_size bytes */
+picoquic_stream_data_node_t* picoquic_stream_data_node_alloc_ex(picoquic_quic_t* quic, size_t min_size)
 {
-    picoquic_stream_data_node_t* stream_data = quic->p_first_data_node;
-    
+    int size_class = 0;
+    picoquic_stream_data_node_t* stream_data;
+
+    while (size_class < PICOQUIC_DATA_NODE_NB_CLASSES - 1 && picoquic_data_node_class_size[size_class] < min_size) {
+        size_class++;
+    }
+    stream_data = quic->p_first_data_node[size_class];
+
     if (stream_data == NULL) {
-        stream_data = (picoquic_stream_data_node_t*)
-            malloc(sizeof(picoquic_stream_data_node_t));
+        size_t node_size = offsetof(picoquic_stream_data_node_t, data) + picoquic_data_node_class_size[size_class];
+
+        stream_data = (picoquic_stream_data_node_t*)malloc(node_size);
 
         if (stream_data != NULL) {
             /* It might be sufficient to zero the metadata, but zeroing everything
              * appears safer, and does not confuse checkers like valgrind.
              */
-            memset(stream_data, 0, sizeof(picoquic_stream_data_node_t));
+            memset(stream_data, 0, node_size);
             stream_data->quic = quic;
+            stream_data->size_class = size_class;
+            stream_data->data_size = picoquic_data_node_class_size[size_class];
             quic->nb_data_nodes_allocated++;
+            quic->nb_data_nodes_in_class_allocated[size_class]++;
             if (quic->nb_data_nodes_allocated > quic->nb_data_nodes_allocated_max) {
                 quic->nb_data_nodes_allocated_max = quic->nb_data_nodes_allocated;
             }
         }
     }
     else {
-        quic->p_first_data_node = stream_data->next_stream_data;
+        quic->p_first_data_node[size_class] = stream_data->next_stream_data;
         stream_data->next_stream_data = NULL;
         stream_data->bytes = NULL;
+        quic->nb_data_nodes_in_class_pool[size_class]--;
         quic->nb_data_nodes_in_pool--;
     }
 
     return stream_data;
 }
 
+picoquic_stream_data_node_t* picoquic_stream_data_node_alloc(picoquic_quic_t* quic)
+{
+    return picoquic_stream_data_node_alloc_ex(quic, PICOQUIC_MAX_PACKET_SIZE);
+}
+
 
 /* Stream splay management */
 
@@ -3023,19 +3392,177 @@ static void * picoquic_stream_node_value(picosplay_node_t * node)
     return (void*)((char*)node - offsetof(struct st_picoquic_stream_head_t, stream_node));
 }
 
-void picoquic_clear_stream(picoquic_stream_head_t* stream)
+/* Queue management for data sent with "picoquic_add_to_stream".
+ * Segments are appended at the tail, so queuing many small chunks is not
+ * quadratic, and removed from the head once sent. */
+int picoquic_stream_queue_add(picoquic_stream_head_t* stream, uint8_t* data, size_t length,
+    int copy_data, picoquic_stream_data_free_fn free_fn, void* free_ctx)
 {
-    picoquic_stream_queue_node_t* ready = stream->send_queue;
-    picoquic_stream_queue_node_t* next;
+    int ret = 0;
+    size_t node_size = sizeof(picoquic_stream_queue_node_t) + ((copy_data) ? length : 0);
+    picoquic_stream_queue_node_t* stream_data = NULL;
+
+    if (node_size >= sizeof(picoquic_stream_queue_node_t)) {
+        stream_data = (picoquic_stream_queue_node_t*)malloc(node_size);
+    }
 
-    while ((next = ready) != NULL) {
-        ready = next->next_stream_data;
-        if (next->bytes != NULL) {
-            free(next->bytes);
+    if (stream_data == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(stream_data, 0, sizeof(picoquic_stream_queue_node_t));
+        if (copy_data) {
+            stream_data->bytes = (uint8_t*)(stream_data + 1);
+            memcpy(stream_data->bytes, data, length);
+        }
+        else {
+            stream_data->bytes = data;
+            stream_data->free_fn = free_fn;
+            stream_data->free_ctx = free_ctx;
+        }
+        stream_data->length = length;
+
+        if (stream->send_queue == NULL) {
+            stream_data->stream_offset = stream->sent_offset;
+            stream->send_queue = stream_data;
         }
-        free(next);
+        else {
+            stream_data->stream_offset = stream->send_queue_last->stream_offset + stream->send_queue_last->length;
+            stream->send_queue_last->next_stream_data = stream_data;
+        }
+        stream->send_queue_last = stream_data;
+    }
+
+    return ret;
+}
+
+static void picoquic_stream_queue_node_free(picoquic_stream_queue_node_t* stream_data)
+{
+    if (stream_data->free_fn != NULL) {
+        stream_data->free_fn(stream_data->bytes, stream_data->free_ctx);
     }
-    stream->send_queue = NULL;
+    free(stream_data);
+}
+
+/* Remove the first node of the send queue, once all its data has been sent.
+ * If "retain_data" is set, the node is moved to the "send_retained" list,
+ * where it stays until the data is acknowledged. This allows repeating
+ * the data from the stream instead of keeping a copy in the sent packets.
+ */
+void picoquic_stream_queue_pop(picoquic_stream_head_t* stream, int retain_data)
+{
+    picoquic_stream_queue_node_t* stream_data = stream->send_queue;
+
+    if (stream_data != NULL) {
+        stream->send_queue = stream_data->next_stream_data;
+        if (stream->send_queue == NULL) {
+            stream->send_queue_last = NULL;
+        }
+        if (retain_data) {
+            stream_data->next_stream_data = NULL;
+            if (stream->send_retained == NULL) {
+                stream->send_retained = stream_data;
+            }
+            else {
+                stream->send_retained_last->next_stream_data = stream_data;
+            }
+            stream->send_retained_last = stream_data;
+        }
+        else {
+            picoquic_stream_queue_node_free(stream_data);
+        }
+    }
+}
+
+void picoquic_stream_queue_free(picoquic_stream_head_t* stream)
+{
+    while (stream->send_queue != NULL) {
+        picoquic_stream_queue_pop(stream, 0);
+    }
+    while (stream->send_retained != NULL) {
+        picoquic_stream_queue_node_t* stream_data = stream->send_retained;
+        stream->send_retained = stream_data->next_stream_data;
+        picoquic_stream_queue_node_free(stream_data);
+    }
+    stream->send_retained_last = NULL;
+}
+
+/* Release the retained nodes whose data is entirely acknowledged,
+ * i.e., ends before the end of the first acknowledged range.
+ */
+void picoquic_stream_release_acked_data(picoquic_stream_head_t* stream)
+{
+    if (stream->send_retained != NULL) {
+        picoquic_sack_item_t* first_range = picoquic_sack_first_item(&stream->sack_list);
+
+        if (first_range != NULL && first_range->start_of_sack_range == 0) {
+            uint64_t acked_offset = first_range->end_of_sack_range + 1;
+
+            while (stream->send_retained != NULL &&
+                stream->send_retained->stream_offset + stream->send_retained->length <= acked_offset) {
+                picoquic_stream_queue_node_t* stream_data = stream->send_retained;
+                stream->send_retained = stream_data->next_stream_data;
+                picoquic_stream_queue_node_free(stream_data);
+            }
+            if (stream->send_retained == NULL) {
+                stream->send_retained_last = NULL;
+            }
+        }
+    }
+}
+
+/* Copy previously sent data from the retained nodes or from the send queue.
+ * The part of the range that is already acknowledged is skipped: the
+ * function sets "copied_offset" to the stream offset of the first copied
+ * byte, and returns the number of bytes copied. Returns 0 if the data is
+ * acknowledged, and -1 if some of the data is not available any more.
+ */
+int picoquic_stream_copy_sent_data(picoquic_stream_head_t* stream, uint64_t offset, size_t length,
+    uint8_t* bytes, uint64_t* copied_offset)
+{
+    int ret = 0;
+    picoquic_sack_item_t* first_range = picoquic_sack_first_item(&stream->sack_list);
+    uint64_t end_offset = offset + length;
+    uint64_t current = offset;
+    size_t copied = 0;
+
+    if (first_range != NULL && first_range->start_of_sack_range == 0 &&
+        first_range->end_of_sack_range + 1 > current) {
+        current = first_range->end_of_sack_range + 1;
+    }
+    *copied_offset = current;
+
+    for (int i = 0; i < 2 && current < end_offset && ret == 0; i++) {
+        picoquic_stream_queue_node_t* stream_data = (i == 0) ? stream->send_retained : stream->send_queue;
+
+        while (stream_data != NULL && current < end_offset) {
+            uint64_t node_end = stream_data->stream_offset + stream_data->length;
+
+            if (stream_data->stream_offset > current) {
+                /* Gap in the available data */
+                ret = -1;
+                break;
+            }
+            else if (node_end > current) {
+                size_t available = (size_t)(((node_end < end_offset) ? node_end : end_offset) - current);
+                memcpy(bytes + copied, stream_data->bytes + (size_t)(current - stream_data->stream_offset), available);
+                copied += available;
+                current += available;
+            }
+            stream_data = stream_data->next_stream_data;
+        }
+    }
+
+    if (ret == 0 && current < end_offset) {
+        ret = -1;
+    }
+
+    return (ret == 0) ? (int)copied : ret;
+}
+
+void picoquic_clear_stream(picoquic_stream_head_t* stream)
+{
+    picoquic_stream_queue_free(stream);
     if (stream->is_output_stream) {
         picoquic_remove_output_stream(stream->cnx, stream);
     }
@@ -3050,7 +3577,7 @@ static void picoquic_stream_node_delete(void * tree, picosplay_node_t * node)
 
     picoquic_clear_stream(stream);
 
-    free(stream);
+    picoquic_object_pool_release(stream->cnx->quic, &stream->cnx->quic->stream_pool, stream);
 }
 
 /* Management of streams */
@@ -3158,10 +3685,16 @@ void picoquic_insert_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t*
 
         stream->is_output_stream = 1;
     }
+
+    if (stream->is_output_stream) {
+        picoquic_queue_ready_stream(cnx, stream);
+    }
 }
 
 void picoquic_remove_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t * stream)
 {
+    picoquic_dequeue_ready_stream(cnx, stream);
+
     if (stream->is_output_stream) {
         stream->is_output_stream = 0;
 
@@ -3199,9 +3732,231 @@ void picoquic_reorder_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t*
             stream->is_output_stream = 0;
             picoquic_insert_output_stream(cnx, stream);
         }
+        else {
+            /* The priority level may have changed even if the list order did not */
+            picoquic_queue_ready_stream(cnx, stream);
+        }
     }
 }
 
+/* Management of the ready queues.
+ * A stream is queued in its priority level when it may have something to send.
+ * Callers invoke picoquic_queue_ready_stream each time the state of the stream
+ * changes in a way that may make it ready: data or FIN queued, stream marked
+ * active, reset or stop sending requested, flow control credit received,
+ * priority changed. The scheduler in picoquic_find_ready_stream_path removes
+ * the streams that turn out to have nothing to send, so there is no need to
+ * track the transitions to idle. If the level for a priority cannot be
+ * allocated, the stream is queued in a fallback level embedded in the
+ * connection context and served after all the other levels, so its data
+ * does not stall. The next call will try again to place it in its level.
+ */
+static int picoquic_is_stream_urgent(picoquic_stream_head_t* stream)
+{
+    return (stream->reset_requested && !stream->reset_sent) ||
+        (stream->stop_sending_requested && !stream->stop_sending_sent);
+}
+
+int picoquic_is_stream_exhausted(picoquic_stream_head_t* stream)
+{
+    return ((stream->fin_requested && stream->fin_sent) || (stream->reset_requested && stream->reset_sent)) &&
+        (!stream->stop_sending_requested || stream->stop_sending_sent);
+}
+
+int picoquic_stream_has_pending_data(picoquic_stream_head_t* stream)
+{
+    return stream->is_active ||
+        (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
+        (stream->fin_requested && !stream->fin_sent);
+}
+
+/* Streams are sorted by stream ID in FIFO levels, and by time of last
+ * transmission in round robin levels, oldest first. */
+static int picoquic_compare_ready_stream(picoquic_stream_head_t* stream, picoquic_stream_head_t* other)
+{
+    int ret = 0;
+
+    if ((stream->stream_priority & 1) == 0 && stream->last_time_data_sent != other->last_time_data_sent) {
+        ret = (stream->last_time_data_sent < other->last_time_data_sent) ? -1 : 1;
+    }
+    else if (stream->stream_id != other->stream_id) {
+        ret = (stream->stream_id < other->stream_id) ? -1 : 1;
+    }
+
+    return ret;
+}
+
+static void picoquic_ready_list_insert_after(picoquic_stream_head_t** first, picoquic_stream_head_t** last,
+    picoquic_stream_head_t* previous, picoquic_stream_head_t* stream)
+{
+    stream->previous_ready_stream = previous;
+    if (previous == NULL) {
+        stream->next_ready_stream = *first;
+        *first = stream;
+    }
+    else {
+        stream->next_ready_stream = previous->next_ready_stream;
+        previous->next_ready_stream = stream;
+    }
+    if (stream->next_ready_stream == NULL) {
+        *last = stream;
+    }
+    else {
+        stream->next_ready_stream->previous_ready_stream = stream;
+    }
+}
+
+static void picoquic_ready_list_remove(picoquic_stream_head_t** first, picoquic_stream_head_t** last,
+    picoquic_stream_head_t* stream)
+{
+    if (stream->previous_ready_stream == NULL) {
+        *first = stream->next_ready_stream;
+    }
+    else {
+        stream->previous_ready_stream->next_ready_stream = stream->next_ready_stream;
+    }
+    if (stream->next_ready_stream == NULL) {
+        *last = stream->previous_ready_stream;
+    }
+    else {
+        stream->next_ready_stream->previous_ready_stream = stream->previous_ready_stream;
+    }
+    stream->previous_ready_stream = NULL;
+    stream->next_ready_stream = NULL;
+}
+
+static picoquic_stream_ready_level_t* picoquic_get_ready_level(picoquic_cnx_t* cnx, uint8_t stream_priority)
+{
+    picoquic_stream_ready_level_t* previous = NULL;
+    picoquic_stream_ready_level_t* level = cnx->first_ready_level;
+
+    while (level != NULL && level->stream_priority < stream_priority) {
+        previous = level;
+        level = level->next_level;
+    }
+
+    if (level == NULL || level->stream_priority != stream_priority) {
+        picoquic_stream_ready_level_t* new_level = (picoquic_stream_ready_level_t*)malloc(sizeof(picoquic_stream_ready_level_t));
+
+        if (new_level != NULL) {
+            memset(new_level, 0, sizeof(picoquic_stream_ready_level_t));
+            new_level->stream_priority = stream_priority;
+            new_level->next_level = level;
+            if (previous == NULL) {
+                cnx->first_ready_level = new_level;
+            }
+            else {
+                previous->next_level = new_level;
+            }
+        }
+        level = new_level;
+    }
+
+    return level;
+}
+
+void picoquic_dequeue_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+{
+    if (stream->ready_level != NULL) {
+        if (stream->is_ready_urgent) {
+            picoquic_ready_list_remove(&stream->ready_level->first_urgent_stream, &stream->ready_level->last_urgent_stream, stream);
+        }
+        else {
+            picoquic_ready_list_remove(&stream->ready_level->first_ready_stream, &stream->ready_level->last_ready_stream, stream);
+        }
+    }
+    else if (stream->is_ready_blocked) {
+        picoquic_ready_list_remove(&cnx->first_blocked_stream, &cnx->last_blocked_stream, stream);
+    }
+    stream->ready_level = NULL;
+    stream->is_ready_urgent = 0;
+    stream->is_ready_blocked = 0;
+}
+
+/* Park a stream that has data but no stream flow control credit. It will be
+ * queued again when a MAX_STREAM_DATA frame is received. */
+void picoquic_block_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+{
+    picoquic_dequeue_ready_stream(cnx, stream);
+    picoquic_ready_list_insert_after(&cnx->first_blocked_stream, &cnx->last_blocked_stream, cnx->last_blocked_stream, stream);
+    stream->is_ready_blocked = 1;
+}
+
+void picoquic_queue_ready_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+{
+    int is_urgent;
+
+    if (!stream->is_output_stream) {
+        return;
+    }
+    /* Exhausted streams go to the urgent queue, so the scheduler can promptly remove them */
+    is_urgent = picoquic_is_stream_urgent(stream) || picoquic_is_stream_exhausted(stream);
+
+    if (!is_urgent && !picoquic_stream_has_pending_data(stream)) {
+        picoquic_dequeue_ready_stream(cnx, stream);
+    }
+    else if (!is_urgent && stream->is_ready_blocked && stream->sent_offset >= stream->maxdata_remote) {
+        /* Still waiting for flow control credit */
+    }
+    else if (stream->ready_level != NULL && stream->ready_level != &cnx->ready_level_fallback &&
+        stream->ready_level->stream_priority == stream->stream_priority &&
+        stream->is_ready_urgent == (unsigned int)is_urgent &&
+        (is_urgent || ((stream->previous_ready_stream == NULL || picoquic_compare_ready_stream(stream, stream->previous_ready_stream) > 0) &&
+            (stream->next_ready_stream == NULL || picoquic_compare_ready_stream(stream, stream->next_ready_stream) < 0)))) {
+        /* Already queued at the right place */
+    }
+    else {
+        picoquic_stream_ready_level_t* level;
+
+        picoquic_dequeue_ready_stream(cnx, stream);
+
+        if ((level = picoquic_get_ready_level(cnx, stream->stream_priority)) == NULL) {
+            DBG_PRINTF("Cannot allocate ready level %d for stream %" PRIu64, stream->stream_priority, stream->stream_id);
+            level = &cnx->ready_level_fallback;
+        }
+
+        if (is_urgent) {
+            picoquic_ready_list_insert_after(&level->first_urgent_stream, &level->last_urgent_stream, level->last_urgent_stream, stream);
+            stream->ready_level = level;
+            stream->is_ready_urgent = 1;
+        }
+        else {
+            /* Common case is appending at the tail, for new streams in FIFO levels or
+             * after transmission in round robin levels. */
+            picoquic_stream_head_t* previous = level->last_ready_stream;
+
+            while (previous != NULL && picoquic_compare_ready_stream(stream, previous) < 0) {
+                previous = previous->previous_ready_stream;
+            }
+            picoquic_ready_list_insert_after(&level->first_ready_stream, &level->last_ready_stream, previous, stream);
+            stream->ready_level = level;
+        }
+    }
+}
+
+void picoquic_free_ready_levels(picoquic_cnx_t* cnx)
+{
+    while (cnx->first_ready_level != NULL) {
+        picoquic_stream_ready_level_t* level = cnx->first_ready_level;
+        cnx->first_ready_level = level->next_level;
+        free(level);
+    }
+    memset(&cnx->ready_level_fallback, 0, sizeof(picoquic_stream_ready_level_t));
+    cnx->first_blocked_stream = NULL;
+    cnx->last_blocked_stream = NULL;
+}
+
+picoquic_stream_ready_level_t* picoquic_first_ready_level(picoquic_cnx_t* cnx)
+{
+    return (cnx->first_ready_level != NULL) ? cnx->first_ready_level : &cnx->ready_level_fallback;
+}
+
+picoquic_stream_ready_level_t* picoquic_next_ready_level(picoquic_cnx_t* cnx, picoquic_stream_ready_level_t* level)
+{
+    return (level->next_level == NULL && level != &cnx->ready_level_fallback) ?
+        &cnx->ready_level_fallback : level->next_level;
+}
+
 picoquic_stream_head_t * picoquic_next_stream(picoquic_stream_head_t * stream)
 {
     return (picoquic_stream_head_t *)picosplay_next((picosplay_node_t *)stream);
@@ -3236,7 +3991,7 @@ void picoquic_add_output_streams(picoquic_cnx_t* cnx, uint64_t old_limit, uint64
 
 picoquic_stream_head_t* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t stream_id)
 {
-    picoquic_stream_head_t* stream = (picoquic_stream_head_t*)malloc(sizeof(picoquic_stream_head_t));
+    picoquic_stream_head_t* stream = (picoquic_stream_head_t*)picoquic_object_pool_alloc(&cnx->quic->stream_pool);
     if (stream != NULL) {
         memset(stream, 0, sizeof(picoquic_stream_head_t));
         picoquic_sack_list_init(&stream->sack_list);
@@ -3400,7 +4155,7 @@ picoquic_local_cnxid_t* picoquic_create_local_cnxid(picoquic_cnx_t* cnx,
     int is_unique = 0;
 
     if (local_cnxid_list != NULL) {
-        l_cid = (picoquic_local_cnxid_t*)malloc(sizeof(picoquic_local_cnxid_t));
+        l_cid = (picoquic_local_cnxid_t*)picoquic_object_pool_alloc(&cnx->quic->local_cnxid_pool);
 
         if (l_cid != NULL) {
             memset(l_cid, 0, sizeof(picoquic_local_cnxid_t));
@@ -3453,7 +4208,7 @@ picoquic_local_cnxid_t* picoquic_create_local_cnxid(picoquic_cnx_t* cnx,
                 }
             }
             else {
-                free(l_cid);
+                picoquic_object_pool_release(cnx->quic, &cnx->quic->local_cnxid_pool, l_cid);
                 l_cid = NULL;
             }
         }
@@ -3513,7 +4268,7 @@ void picoquic_delete_local_cnxid_listed(picoquic_cnx_t* cnx,
     }
 
     /* Delete and done */
-    free(l_cid);
+    picoquic_object_pool_release(cnx->quic, &cnx->quic->local_cnxid_pool, l_cid);
 }
 
 void picoquic_delete_local_cnxid(picoquic_cnx_t* cnx,  picoquic_local_cnxid_t* l_cid)
@@ -3633,7 +4388,7 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
     const struct sockaddr* addr_to, uint64_t start_time, uint32_t preferred_version,
     char const* sni, char const* alpn, char client_mode)
 {
-    picoquic_cnx_t* cnx = (picoquic_cnx_t*)malloc(sizeof(picoquic_cnx_t));
+    picoquic_cnx_t* cnx = (picoquic_cnx_t*)picoquic_object_pool_alloc(&quic->cnx_pool);
 
     if (cnx != NULL) {
         int ret;
@@ -3669,6 +4424,11 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
             ret = picoquic_init_cnxid_stash(cnx);
         }
 
+        if (ret == 0 && quic->use_wake_heap &&
+            picoheap_reserve(&quic->cnx_wake_heap, (size_t)quic->current_number_connections + 1) != 0) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+
         if (ret != 0 || cnxid0 == NULL) {
             picoquic_delete_cnx(cnx);
             /* free(cnx); */
@@ -3770,6 +4530,9 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
 
         for (int epoch = 0; epoch < PICOQUIC_NUMBER_OF_EPOCHS; epoch++) {
             cnx->tls_stream[epoch].send_queue = NULL;
+            cnx->tls_stream[epoch].send_queue_last = NULL;
+            cnx->tls_stream[epoch].send_retained = NULL;
+            cnx->tls_stream[epoch].send_retained_last = NULL;
         }
 
         /* Perform different initializations for clients and servers */
@@ -4404,6 +5167,7 @@ void picoquic_reset_packet_context(picoquic_cnx_t* cnx,
     }
 
     pkt_ctx->retransmitted_oldest = NULL;
+    picoquic_pending_ring_free(pkt_ctx);
 
     /* Reset the ECN data */
     pkt_ctx->ecn_ect0_total_remote = 0;
@@ -4601,6 +5365,7 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
 
         picoquic_remove_cnx_from_list(cnx);
         picoquic_remove_cnx_from_wake_list(cnx);
+        cnx->quic->nb_cnx_deleted++;
 
         for (int i = 0; i < PICOQUIC_NUMBER_OF_EPOCHS; i++) {
             picoquic_crypto_context_free(&cnx->crypto_context[i]);
@@ -4630,6 +5395,7 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
         }
 
         picosplay_empty_tree(&cnx->stream_tree);
+        picoquic_free_ready_levels(cnx);
 
         if (cnx->tls_ctx != NULL) {
             picoquic_tlscontext_free(cnx->tls_ctx);
@@ -4652,10 +5418,297 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
 
         picoquic_unregister_net_icid(cnx);
 
-        free(cnx);
+        picoquic_object_pool_release(cnx->quic, &cnx->quic->cnx_pool, cnx);
+    }
+}
+
+/* Moving a connection to another QUIC context.
+ * The connection is removed from the list of connections, the wake list and
+ * the hash tables of its current context, then entered in the same tables
+ * in the new context. The keys of the hash tables are kept in the connection
+ * context while it is detached, so nothing needs to be recomputed on attach.
+ */
+static void picoquic_cnx_unregister_tables(picoquic_cnx_t* cnx)
+{
+    picoquic_quic_t* quic = cnx->quic;
+    picoquic_local_cnxid_list_t* local_cnxid_list = cnx->first_local_cnxid_list;
+
+    while (local_cnxid_list != NULL) {
+        picoquic_local_cnxid_t* l_cid = local_cnxid_list->local_cnxid_first;
+        while (l_cid != NULL) {
+            if (l_cid->registered_cnx != NULL) {
+                picohash_delete_item(quic->table_cnx_by_id, &l_cid->hash_item, 0);
+            }
+            l_cid = l_cid->next;
+        }
+        local_cnxid_list = local_cnxid_list->next_list;
+    }
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        if (cnx->path[i]->net_id_hash_item.key != NULL) {
+            picohash_delete_item(quic->table_cnx_by_net, &cnx->path[i]->net_id_hash_item, 0);
+        }
+    }
+
+    if (cnx->registered_icid_item.key != 0) {
+        picohash_delete_item(quic->table_cnx_by_icid, &cnx->registered_icid_item, 0);
+    }
+
+    if (cnx->registered_secret_addr.ss_family != 0) {
+        picohash_delete_key(quic->table_cnx_by_secret, cnx, 0);
     }
 }
 
+static int picoquic_cnx_check_tables(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
+{
+    int ret = 0;
+    picoquic_local_cnxid_list_t* local_cnxid_list = cnx->first_local_cnxid_list;
+
+    while (ret == 0 && local_cnxid_list != NULL) {
+        picoquic_local_cnxid_t* l_cid = local_cnxid_list->local_cnxid_first;
+        while (ret == 0 && l_cid != NULL) {
+            if (l_cid->cnx_id.id_len != quic->local_cnxid_length) {
+                ret = PICOQUIC_ERROR_CNXID_SEGMENT;
+            }
+            else if (l_cid->registered_cnx != NULL && picohash_retrieve(quic->table_cnx_by_id, l_cid) != NULL) {
+                ret = PICOQUIC_ERROR_CNXID_NOT_AVAILABLE;
+            }
+            l_cid = l_cid->next;
+        }
+        local_cnxid_list = local_cnxid_list->next_list;
+    }
+
+    for (int i = 0; ret == 0 && i < cnx->nb_paths; i++) {
+        if (cnx->path[i]->net_id_hash_item.key != NULL &&
+            picohash_retrieve(quic->table_cnx_by_net, cnx->path[i]) != NULL) {
+            ret = PICOQUIC_ERROR_CNXID_NOT_AVAILABLE;
+        }
+    }
+
+    return ret;
+}
+
+static void picoquic_cnx_register_tables(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
+{
+    picoquic_local_cnxid_list_t* local_cnxid_list = cnx->first_local_cnxid_list;
+
+    while (local_cnxid_list != NULL) {
+        picoquic_local_cnxid_t* l_cid = local_cnxid_list->local_cnxid_first;
+        while (l_cid != NULL) {
+            if (l_cid->registered_cnx != NULL) {
+                (void)picohash_insert(quic->table_cnx_by_id, l_cid);
+            }
+            l_cid = l_cid->next;
+        }
+        local_cnxid_list = local_cnxid_list->next_list;
+    }
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        if (cnx->path[i]->net_id_hash_item.key != NULL) {
+            (void)picohash_insert(quic->table_cnx_by_net, cnx->path[i]);
+        }
+    }
+
+    /* Collisions on the initial CID or the reset secret are ignored, as they
+     * are when the connection is first registered. */
+    if (cnx->registered_icid_item.key != 0) {
+        if (picohash_retrieve(quic->table_cnx_by_icid, cnx) == NULL) {
+            (void)picohash_insert(quic->table_cnx_by_icid, cnx);
+        }
+        else {
+            memset(&cnx->registered_icid_addr, 0, sizeof(struct sockaddr_storage));
+            memset(&cnx->registered_icid_item, 0, sizeof(picohash_item));
+        }
+    }
+
+    if (cnx->registered_secret_addr.ss_family != 0) {
+        if (picohash_retrieve(quic->table_cnx_by_secret, cnx) == NULL) {
+            (void)picohash_insert(quic->table_cnx_by_secret, cnx);
+        }
+        else {
+            memset(&cnx->registered_secret_addr, 0, sizeof(struct sockaddr_storage));
+        }
+    }
+}
+
+/* The objects of a moving connection were allocated from the pools of the
+ * old context, and will be released to those of the new one. Move their
+ * counts, so that the memory usage of both contexts remains accurate.
+ * This includes the packets and the stream data nodes held by the connection.
+ */
+static void picoquic_pool_count_move(picoquic_object_pool_t* pool, int delta)
+{
+    pool->nb_allocated += delta;
+    if (pool->nb_allocated > pool->nb_allocated_max) {
+        pool->nb_allocated_max = pool->nb_allocated;
+    }
+}
+
+/* Packets held by a packet context: sent and not acknowledged yet, or kept
+ * after being declared lost to detect spurious losses */
+static int picoquic_pkt_ctx_count_packets(picoquic_packet_context_t* pkt_ctx)
+{
+    int nb_packets = 0;
+    picoquic_packet_t* packet = pkt_ctx->pending_first;
+
+    while (packet != NULL) {
+        nb_packets++;
+        packet = packet->packet_next;
+    }
+    packet = pkt_ctx->retransmitted_newest;
+    while (packet != NULL) {
+        nb_packets++;
+        packet = packet->packet_next;
+    }
+
+    return nb_packets;
+}
+
+static int picoquic_cnx_count_packets(picoquic_cnx_t* cnx)
+{
+    int nb_packets = 0;
+    picoquic_remote_cnxid_stash_t* stash = cnx->first_remote_cnxid_stash;
+    picosplay_node_t* node = picosplay_first(&cnx->queue_data_repeat_tree);
+
+    for (picoquic_packet_context_enum pc = 0; pc < picoquic_nb_packet_context; pc++) {
+        nb_packets += picoquic_pkt_ctx_count_packets(&cnx->pkt_ctx[pc]);
+    }
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        nb_packets += picoquic_pkt_ctx_count_packets(&cnx->path[i]->pkt_ctx);
+    }
+    while (stash != NULL) {
+        picoquic_remote_cnxid_t* remote_cnxid = stash->cnxid_stash_first;
+        while (remote_cnxid != NULL) {
+            nb_packets += picoquic_pkt_ctx_count_packets(&remote_cnxid->pkt_ctx);
+            remote_cnxid = remote_cnxid->next;
+        }
+        stash = stash->next_stash;
+    }
+    /* Packets waiting for their data to be repeated may also be in one of the lists */
+    while (node != NULL) {
+        picoquic_packet_t* packet = (picoquic_packet_t*)picoquic_queue_data_repeat_node_value(node);
+        if (!packet->is_queued_for_retransmit && !packet->is_queued_for_spurious_detection) {
+            nb_packets++;
+        }
+        node = picosplay_next(node);
+    }
+
+    return nb_packets;
+}
+
+/* Data nodes are released to the context recorded in the node, so the nodes
+ * of a moving connection are handed over to the new context on attach */
+static void picoquic_data_nodes_move(picoquic_quic_t* quic, picosplay_tree_t* tree, int sign)
+{
+    picosplay_node_t* node = picosplay_first(tree);
+
+    while (node != NULL) {
+        picoquic_stream_data_node_t* stream_data = (picoquic_stream_data_node_t*)picoquic_stream_data_node_value(node);
+
+        quic->nb_data_nodes_allocated += sign;
+        quic->nb_data_nodes_in_class_allocated[stream_data->size_class] += sign;
+        if (sign > 0) {
+            stream_data->quic = quic;
+        }
+        node = picosplay_next(node);
+    }
+    if (quic->nb_data_nodes_allocated > quic->nb_data_nodes_allocated_max) {
+        quic->nb_data_nodes_allocated_max = quic->nb_data_nodes_allocated;
+    }
+}
+
+static void picoquic_cnx_move_pool_counts(picoquic_cnx_t* cnx, int sign)
+{
+    picoquic_quic_t* quic = cnx->quic;
+    picoquic_local_cnxid_list_t* local_cnxid_list = cnx->first_local_cnxid_list;
+    picoquic_stream_head_t* stream = picoquic_first_stream(cnx);
+    int nb_local_cnxid = 0;
+    int nb_streams = 0;
+
+    while (local_cnxid_list != NULL) {
+        nb_local_cnxid += local_cnxid_list->nb_local_cnxid;
+        local_cnxid_list = local_cnxid_list->next_list;
+    }
+    while (stream != NULL) {
+        nb_streams++;
+        picoquic_data_nodes_move(quic, &stream->stream_data_tree, sign);
+        stream = picoquic_next_stream(stream);
+    }
+    for (int epoch = 0; epoch < PICOQUIC_NUMBER_OF_EPOCHS; epoch++) {
+        picoquic_data_nodes_move(quic, &cnx->tls_stream[epoch].stream_data_tree, sign);
+    }
+
+    picoquic_pool_count_move(&quic->cnx_pool, sign);
+    picoquic_pool_count_move(&quic->path_pool, sign * cnx->nb_paths);
+    picoquic_pool_count_move(&quic->local_cnxid_pool, sign * nb_local_cnxid);
+    picoquic_pool_count_move(&quic->stream_pool, sign * nb_streams);
+
+    quic->nb_packets_allocated += sign * picoquic_cnx_count_packets(cnx);
+    if (quic->nb_packets_allocated > quic->nb_packets_allocated_max) {
+        quic->nb_packets_allocated_max = quic->nb_packets_allocated;
+    }
+}
+
+int picoquic_cnx_detach(picoquic_cnx_t* cnx)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = cnx->quic;
+
+    if (quic == NULL || quic->cnx_in_progress == cnx ||
+        cnx->cnx_state < picoquic_state_client_ready_start ||
+        cnx->cnx_state >= picoquic_state_disconnected) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_STATE;
+    }
+    else {
+        picoquic_cnx_unregister_tables(cnx);
+        picoquic_unlink_cnx_from_list(cnx);
+        picoquic_remove_cnx_from_wake_list(cnx);
+
+        if (cnx->is_half_open && quic->current_number_half_open > 0) {
+            quic->current_number_half_open--;
+        }
+        if (cnx->f_binlog != NULL && quic->current_number_of_open_logs > 0) {
+            quic->current_number_of_open_logs--;
+        }
+        picoquic_cnx_move_pool_counts(cnx, -1);
+        cnx->quic = NULL;
+    }
+
+    return ret;
+}
+
+int picoquic_cnx_attach(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
+{
+    int ret = 0;
+
+    if (cnx->quic != NULL) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_STATE;
+    }
+    else if ((ret = picoquic_cnx_check_tables(quic, cnx)) == 0) {
+        if (quic->use_wake_heap &&
+            picoheap_reserve(&quic->cnx_wake_heap, (size_t)quic->current_number_connections + 1) != 0) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            cnx->quic = quic;
+            picoquic_cnx_register_tables(quic, cnx);
+            picoquic_insert_cnx_in_list(quic, cnx);
+            picoquic_insert_cnx_by_wake_time(quic, cnx);
+            picoquic_tlscontext_set_master(quic, cnx);
+
+            if (cnx->is_half_open) {
+                quic->current_number_half_open++;
+            }
+            if (cnx->f_binlog != NULL) {
+                quic->current_number_of_open_logs++;
+            }
+            picoquic_cnx_move_pool_counts(cnx, 1);
+        }
+    }
+
+    return ret;
+}
+
 int picoquic_is_handshake_error(uint64_t error_code)
 {
     return ((error_code & 0xFF00) == PICOQUIC_TRANSPORT_CRYPTO_ERROR(0) ||
@@ -4842,6 +5895,11 @@ void picoquic_set_preemptive_repeat_per_cnx(picoquic_cnx_t* cnx, int do_repeat)
     cnx->is_preemptive_repeat_enabled = (do_repeat) ? 1 : 0;
 }
 
+void picoquic_set_compact_retransmit(picoquic_quic_t* quic, int use_compact_retransmit)
+{
+    quic->use_compact_retransmit = (use_compact_retransmit) ? 1 : 0;
+}
+
 void picoquic_set_congestion_algorithm(picoquic_cnx_t* cnx, picoquic_congestion_algorithm_t const* alg)
 {
     if (cnx->congestion_alg != NULL) {
@@ -148,6 +148,7 @@ int picoquic_mark_active_stream(picoquic_cnx_t* cnx,
                 stream->app_stream_ctx = app_stream_ctx;
                 if (!stream->is_active) {
                     stream->is_active = 1;
+                    picoquic_queue_ready_stream(cnx, stream);
                     picoquic_reinsert_by_wake_time(cnx->quic, cnx, picoquic_get_quic_time(cnx->quic));
                 }
             }
@@ -209,8 +210,9 @@ int picoquic_mark_high_priority_stream(picoquic_cnx_t * cnx, uint64_t stream_id,
     return ret;
 }
 
-int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
-    const uint8_t* data, size_t length, int set_fin, void * app_stream_ctx)
+static int picoquic_add_to_stream_ex(picoquic_cnx_t* cnx, uint64_t stream_id,
+    uint8_t* data, size_t length, int set_fin, void * app_stream_ctx,
+    int copy_data, picoquic_stream_data_free_fn free_fn, void* free_ctx)
 {
     int ret = 0;
     picoquic_stream_head_t* stream = picoquic_find_stream_for_writing(cnx, stream_id, &ret);
@@ -232,34 +234,7 @@ int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
     }
 
     if (ret == 0 && length > 0) {
-        picoquic_stream_queue_node_t* stream_data = (picoquic_stream_queue_node_t*)
-            malloc(sizeof(picoquic_stream_queue_node_t));
-        if (stream_data == 0) {
-            ret = -1;
-        } else {
-            stream_data->bytes = (uint8_t*)malloc(length);
-
-            if (stream_data->bytes == NULL) {
-                free(stream_data);
-                stream_data = NULL;
-                ret = -1;
-            } else {
-                picoquic_stream_queue_node_t** pprevious = &stream->send_queue;
-                picoquic_stream_queue_node_t* next = stream->send_queue;
-
-                memcpy(stream_data->bytes, data, length);
-                stream_data->length = length;
-                stream_data->offset = 0;
-                stream_data->next_stream_data = NULL;
-
-                while (next != NULL) {
-                    pprevious = &next->next_stream_data;
-                    next = next->next_stream_data;
-                }
-
-                *pprevious = stream_data;
-            }
-        }
+        ret = picoquic_stream_queue_add(stream, data, length, copy_data, free_fn, free_ctx);
 
         picoquic_reinsert_by_wake_time(cnx->quic, cnx, picoquic_get_quic_time(cnx->quic));
     }
@@ -268,11 +243,28 @@ int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
         cnx->nb_bytes_queued += length;
         stream->is_active = 0;
         stream->app_stream_ctx = app_stream_ctx;
+        picoquic_queue_ready_stream(cnx, stream);
+        if (length == 0 && !copy_data && data != NULL && free_fn != NULL) {
+            /* Nothing was queued, release the buffer now */
+            free_fn(data, free_ctx);
+        }
     }
 
     return ret;
 }
 
+int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
+    const uint8_t* data, size_t length, int set_fin, void* app_stream_ctx)
+{
+    return picoquic_add_to_stream_ex(cnx, stream_id, (uint8_t*)data, length, set_fin, app_stream_ctx, 1, NULL, NULL);
+}
+
+int picoquic_add_to_stream_owned(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* data, size_t length, int set_fin,
+    void* app_stream_ctx, picoquic_stream_data_free_fn free_fn, void* free_ctx)
+{
+    return picoquic_add_to_stream_ex(cnx, stream_id, data, length, set_fin, app_stream_ctx, 0, free_fn, free_ctx);
+}
+
 int picoquic_add_to_stream(picoquic_cnx_t* cnx, uint64_t stream_id,
     const uint8_t* data, size_t length, int set_fin)
 {
@@ -342,6 +334,7 @@ int picoquic_reset_stream(picoquic_cnx_t* cnx,
         else if (!stream->reset_requested) {
             stream->local_error = local_stream_error;
             stream->reset_requested = 1;
+            picoquic_queue_ready_stream(cnx, stream);
         }
     }
 
@@ -496,7 +489,8 @@ picoquic_packet_t* picoquic_create_packet(picoquic_quic_t * quic)
 void picoquic_recycle_packet(picoquic_quic_t * quic, picoquic_packet_t* packet)
 {
     if (packet != NULL) {
-        if (quic->nb_packets_in_pool >= PICOQUIC_MAX_PACKETS_IN_POOL) {
+        if (packet->is_compacted || quic->nb_packets_in_pool >= PICOQUIC_MAX_PACKETS_IN_POOL) {
+            /* Compacted packets are truncated, they cannot be reused. */
             free(packet);
             quic->nb_packets_allocated--;
         }
@@ -806,6 +800,18 @@ size_t picoquic_get_checksum_length(picoquic_cnx_t* cnx, picoquic_epoch_enum epo
     return ret;
 }
 
+static void picoquic_apply_header_mask(uint8_t* send_buffer, size_t pn_offset, uint8_t first_mask, const uint8_t* mask_bytes)
+{
+    /* Encode the first byte */
+    uint8_t pn_l = (send_buffer[0] & 3) + 1;
+    send_buffer[0] ^= (mask_bytes[0] & first_mask);
+
+    /* Packet encoding is 1 to 4 bytes */
+    for (uint8_t i = 0; i < pn_l; i++) {
+        send_buffer[pn_offset + i] ^= mask_bytes[i + 1];
+    }
+}
+
 void picoquic_protect_packet_header(uint8_t * send_buffer, size_t pn_offset, uint8_t first_mask, void* pn_enc)
 {
     /* The sample is located after the pn_offset */
@@ -815,17 +821,9 @@ void picoquic_protect_packet_header(uint8_t * send_buffer, size_t pn_offset, uin
     {
         /* This is always true, as we use pn_length = 4 */
         uint8_t mask_bytes[5] = { 0, 0, 0, 0, 0 };
-        uint8_t pn_l;
 
         picoquic_pn_encrypt(pn_enc, send_buffer + sample_offset, mask_bytes, mask_bytes, 5);
-        /* Encode the first byte */
-        pn_l = (send_buffer[0] & 3) + 1;
-        send_buffer[0] ^= (mask_bytes[0] & first_mask);
-
-        /* Packet encoding is 1 to 4 bytes */
-        for (uint8_t i = 0; i < pn_l; i++) {
-            send_buffer[pn_offset+i] ^= mask_bytes[i+1];
-        }
+        picoquic_apply_header_mask(send_buffer, pn_offset, first_mask, mask_bytes);
     }
 }
 
@@ -844,6 +842,7 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
     size_t pn_length = 0;
     size_t aead_checksum_length = picoquic_aead_get_checksum_length(aead_context);
     uint8_t first_mask = 0x0F;
+    uint8_t mask_bytes[16];
 
     /* Create the packet header just before encrypting the content */
     h_length = picoquic_create_packet_header(cnx, ptype,
@@ -890,17 +889,13 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         }
     }
 
-    /* Encrypt the packet */
-    if (cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected) {
-        send_length = picoquic_aead_encrypt_mp(send_buffer + /* header_length */ h_length,
-            bytes + header_length, length - header_length, path_x->unique_path_id,
-            sequence_number, send_buffer, /* header_length */ h_length, aead_context);
-    }
-    else {
-        send_length = picoquic_aead_encrypt_generic(send_buffer + /* header_length */ h_length,
-            bytes + header_length, length - header_length,
-            sequence_number, send_buffer, /* header_length */ h_length, aead_context);
-    }
+    /* Encrypt the packet, and compute the header protection mask in the same
+     * pass. The sample is located after the pn_offset, in the encrypted payload. */
+    send_length = picoquic_aead_encrypt_with_mask(send_buffer + /* header_length */ h_length,
+        bytes + header_length, length - header_length,
+        cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected, path_x->unique_path_id,
+        sequence_number, send_buffer, /* header_length */ h_length, aead_context,
+        pn_enc, send_buffer + pn_offset + 4, mask_bytes);
 
     send_length += /* header_length */ h_length;
 
@@ -909,8 +904,8 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         bytes, sequence_number, pn_length, length,
         send_buffer, send_length, current_time);
 
-    /* Next, encrypt the PN -- The sample is located after the pn_offset */
-    picoquic_protect_packet_header(send_buffer, pn_offset, first_mask, pn_enc);
+    /* Next, apply the mask to the first byte and the PN */
+    picoquic_apply_header_mask(send_buffer, pn_offset, first_mask, mask_bytes);
 
     return send_length;
 }
@@ -919,6 +914,119 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
  * Final steps in packet transmission: queue for retransmission, etc
  */
 
+/* Ring of pending packets.
+ * The packets waiting for acknowledgement are chained in order of sequence
+ * numbers, from pending_first to pending_last. The ring provides direct
+ * access to a pending packet from its sequence number, which is used when
+ * processing ACK frames. The slot of a packet is its sequence number modulo
+ * the size of the ring. The ring is always larger than the span of sequence
+ * numbers between the first and last pending packets, so each pending packet
+ * has its own slot. Slots are cleared when packets are dequeued.
+ * If the span exceeds PICOQUIC_PENDING_RING_MAX, or if memory is short,
+ * the ring is released and lookups fall back to scanning the list.
+ */
+void picoquic_pending_ring_free(picoquic_packet_context_t* pkt_ctx)
+{
+    if (pkt_ctx->pending_ring != NULL) {
+        free(pkt_ctx->pending_ring);
+        pkt_ctx->pending_ring = NULL;
+    }
+    pkt_ctx->pending_ring_size = 0;
+}
+
+static void picoquic_pending_ring_resize(picoquic_packet_context_t* pkt_ctx, uint64_t span)
+{
+    size_t ring_size = PICOQUIC_PENDING_RING_MIN;
+    picoquic_packet_t** ring = NULL;
+
+    while ((uint64_t)ring_size < 2 * span && ring_size < PICOQUIC_PENDING_RING_MAX) {
+        ring_size *= 2;
+    }
+
+    picoquic_pending_ring_free(pkt_ctx);
+
+    if ((uint64_t)ring_size >= span &&
+        (ring = (picoquic_packet_t**)malloc(ring_size * sizeof(picoquic_packet_t*))) != NULL) {
+        picoquic_packet_t* p = pkt_ctx->pending_first;
+
+        memset(ring, 0, ring_size * sizeof(picoquic_packet_t*));
+        while (p != NULL) {
+            ring[p->sequence_number & (ring_size - 1)] = p;
+            p = p->packet_next;
+        }
+        pkt_ctx->pending_ring = ring;
+        pkt_ctx->pending_ring_size = ring_size;
+    }
+}
+
+static void picoquic_pending_ring_insert(picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* packet)
+{
+    uint64_t span = packet->sequence_number - pkt_ctx->pending_first->sequence_number + 1;
+
+    if (span > (uint64_t)pkt_ctx->pending_ring_size) {
+        /* Rebuilding a ring also enters the new packet */
+        if (span <= PICOQUIC_PENDING_RING_MAX) {
+            picoquic_pending_ring_resize(pkt_ctx, span);
+        }
+        else if (pkt_ctx->pending_ring != NULL) {
+            picoquic_pending_ring_free(pkt_ctx);
+        }
+    }
+    else {
+        pkt_ctx->pending_ring[packet->sequence_number & (pkt_ctx->pending_ring_size - 1)] = packet;
+    }
+}
+
+static void picoquic_pending_ring_set(picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* old_p, picoquic_packet_t* new_p)
+{
+    if (pkt_ctx->pending_ring != NULL) {
+        size_t slot = (size_t)(old_p->sequence_number & (pkt_ctx->pending_ring_size - 1));
+
+        if (pkt_ctx->pending_ring[slot] == old_p) {
+            pkt_ctx->pending_ring[slot] = new_p;
+        }
+    }
+}
+
+picoquic_packet_t* picoquic_pending_ring_get(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number)
+{
+    picoquic_packet_t* p = NULL;
+
+    if (pkt_ctx->pending_ring != NULL) {
+        p = pkt_ctx->pending_ring[sequence_number & (pkt_ctx->pending_ring_size - 1)];
+        if (p != NULL && p->sequence_number != sequence_number) {
+            p = NULL;
+        }
+    }
+    return p;
+}
+
+/* Find the first pending packet with a sequence number larger than or equal to the
+ * specified value, or the last pending packet if there is no such packet. */
+picoquic_packet_t* picoquic_pending_ring_ceiling(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number)
+{
+    picoquic_packet_t* packet = pkt_ctx->pending_first;
+
+    if (packet == NULL || packet->sequence_number >= sequence_number) {
+        /* Nothing to search */
+    }
+    else if (pkt_ctx->pending_last->sequence_number <= sequence_number) {
+        packet = pkt_ctx->pending_last;
+    }
+    else if (pkt_ctx->pending_ring != NULL) {
+        /* Both the first and last packets are in the ring, so the loop terminates */
+        while ((packet = picoquic_pending_ring_get(pkt_ctx, sequence_number)) == NULL) {
+            sequence_number++;
+        }
+    }
+    else {
+        while (packet->packet_next != NULL && packet->sequence_number < sequence_number) {
+            packet = packet->packet_next;
+        }
+    }
+    return packet;
+}
+
 void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x, picoquic_packet_t* packet,
     size_t length, uint64_t current_time)
 {
@@ -942,6 +1050,7 @@ void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x
     }
     pkt_ctx->pending_last = packet;
     packet->is_queued_for_retransmit = 1;
+    picoquic_pending_ring_insert(pkt_ctx, packet);
 
     if (!packet->is_ack_trap) {
         /* Account for bytes in transit, for congestion control */
@@ -974,6 +1083,7 @@ picoquic_packet_t* picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx,
             p->packet_previous->packet_next = p->packet_next;
         }
         p->is_queued_for_retransmit = 0;
+        picoquic_pending_ring_set(pkt_ctx, p, NULL);
     }
 
     /* Account for bytes in transit, for congestion control */
@@ -1198,7 +1308,11 @@ int picoquic_is_pkt_ctx_backlog_empty(picoquic_packet_context_t* pkt_ctx)
 
         byte_index = p->offset;
 
-        if (!p->is_ack_trap && !p->is_multipath_probe && !p->is_mtu_probe) {
+        if (p->is_compacted) {
+            /* Compacted packets always contain stream data */
+            backlog_empty = 0;
+        }
+        else if (!p->is_ack_trap && !p->is_multipath_probe && !p->is_mtu_probe) {
             while (ret == 0 && byte_index < p->length) {
                 ret = picoquic_skip_frame(&p->bytes[byte_index],
                     p->length - p->offset, &frame_length, &frame_is_pure_ack);
@@ -1238,6 +1352,294 @@ int picoquic_is_cnx_backlog_empty(picoquic_cnx_t* cnx)
     return backlog_empty;
 }
 
+/* Compact retransmit records.
+ * When "use_compact_retransmit" is set, the data queued by the application
+ * with picoquic_add_to_stream or picoquic_add_to_stream_owned is retained
+ * in the stream until it is acknowledged. The copies of sent 1-RTT packets
+ * waiting in the retransmit queue then do not need to hold a copy of the
+ * stream data: after the packets are sent, the stream frames are replaced
+ * by "stream reference" frames, and the packet record is reallocated with
+ * just the required size. The compacted packets are expanded back into
+ * regular packets if they have to be repeated.
+ *
+ * Compaction happens at the end of picoquic_prepare_packet_ex, so that the
+ * packet records never move while the packet is being prepared.
+ */
+static int picoquic_is_stream_data_retained(picoquic_stream_head_t* stream, uint64_t offset, size_t length)
+{
+    uint64_t current = offset;
+    uint64_t end_offset = offset + length;
+
+    for (int i = 0; i < 2 && current < end_offset; i++) {
+        picoquic_stream_queue_node_t* stream_data = (i == 0) ? stream->send_retained : stream->send_queue;
+
+        while (stream_data != NULL && current < end_offset) {
+            if (stream_data->stream_offset > current) {
+                return 0;
+            }
+            if (stream_data->stream_offset + stream_data->length > current) {
+                current = stream_data->stream_offset + stream_data->length;
+            }
+            stream_data = stream_data->next_stream_data;
+        }
+    }
+
+    return (current >= end_offset);
+}
+
+/* Replace "old_p" by "new_p" in the list of packets pending acknowledgement */
+static void picoquic_replace_pending_packet(picoquic_packet_context_t* pkt_ctx,
+    picoquic_packet_t* old_p, picoquic_packet_t* new_p)
+{
+    if (old_p->packet_previous == NULL) {
+        pkt_ctx->pending_first = new_p;
+    }
+    else {
+        old_p->packet_previous->packet_next = new_p;
+    }
+    if (old_p->packet_next == NULL) {
+        pkt_ctx->pending_last = new_p;
+    }
+    else {
+        old_p->packet_next->packet_previous = new_p;
+    }
+    if (pkt_ctx->preemptive_repeat_ptr == old_p) {
+        pkt_ctx->preemptive_repeat_ptr = new_p;
+    }
+    picoquic_pending_ring_set(pkt_ctx, old_p, new_p);
+}
+
+static picoquic_packet_t* picoquic_compact_sent_packet(picoquic_cnx_t* cnx,
+    picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p)
+{
+    uint8_t compact_bytes[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t* bytes = compact_bytes + p->offset;
+    uint8_t* bytes_max = compact_bytes + sizeof(compact_bytes);
+    size_t byte_index = p->offset;
+    int nb_references = 0;
+    int is_ack_eliciting = 0;
+    int ret = 0;
+
+    while (ret == 0 && bytes != NULL && byte_index < p->length) {
+        size_t frame_length = 0;
+        int frame_is_pure_ack = 0;
+        int is_referenced = 0;
+
+        if ((ret = picoquic_skip_frame(&p->bytes[byte_index], p->length - byte_index,
+            &frame_length, &frame_is_pure_ack)) != 0) {
+            break;
+        }
+        is_ack_eliciting |= !frame_is_pure_ack;
+        if (p->bytes[byte_index] == picoquic_frame_type_padding) {
+            /* Padding does not need to be remembered */
+        }
+        else {
+            if (PICOQUIC_IN_RANGE(p->bytes[byte_index], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+                uint64_t stream_id;
+                uint64_t offset;
+                size_t data_length;
+                size_t consumed;
+                int fin;
+
+                /* Frames carrying the FIN bit are kept as is, which keeps the expansion logic simple */
+                if (picoquic_parse_stream_header(&p->bytes[byte_index], p->length - byte_index,
+                    &stream_id, &offset, &data_length, &fin, &consumed) == 0 && !fin && data_length > 0) {
+                    picoquic_stream_head_t* stream = picoquic_find_stream(cnx, stream_id);
+
+                    if (stream != NULL && picoquic_is_stream_data_retained(stream, offset, data_length)) {
+                        bytes = picoquic_format_stream_reference_frame(bytes, bytes_max, p->bytes[byte_index] & 2,
+                            stream_id, offset, data_length);
+                        is_referenced = 1;
+                        nb_references++;
+                    }
+                }
+            }
+            if (!is_referenced) {
+                if (bytes + frame_length <= bytes_max) {
+                    memcpy(bytes, &p->bytes[byte_index], frame_length);
+                    bytes += frame_length;
+                }
+                else {
+                    bytes = NULL;
+                }
+            }
+        }
+        byte_index += frame_length;
+    }
+
+    if (ret == 0 && bytes != NULL && nb_references > 0) {
+        size_t compacted_length = bytes - compact_bytes;
+        picoquic_packet_t* compact_p = (picoquic_packet_t*)malloc(
+            offsetof(struct st_picoquic_packet_t, bytes) + compacted_length);
+
+        if (compact_p != NULL) {
+            memcpy(compact_p, p, offsetof(struct st_picoquic_packet_t, bytes));
+            memcpy(compact_p->bytes, p->bytes, p->offset);
+            memcpy(compact_p->bytes + p->offset, compact_bytes + p->offset, compacted_length - p->offset);
+            compact_p->is_compacted = 1;
+            compact_p->compacted_length = compacted_length;
+            /* The frames will not be readable after compaction, so record the evaluation now */
+            compact_p->is_ack_eliciting = is_ack_eliciting;
+            compact_p->is_evaluated = 1;
+            cnx->quic->nb_packets_allocated++;
+
+            picoquic_replace_pending_packet(pkt_ctx, p, compact_p);
+            picoquic_recycle_packet(cnx->quic, p);
+            p = compact_p;
+        }
+    }
+
+    return p;
+}
+
+static void picoquic_compact_sent_packets_in_context(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx)
+{
+    picoquic_packet_t* p = pkt_ctx->pending_last;
+
+    while (p != NULL && !p->is_compaction_checked) {
+        picoquic_packet_t* p_previous = p->packet_previous;
+
+        p->is_compaction_checked = 1;
+        if (p->ptype == picoquic_packet_1rtt_protected && !p->is_ack_trap && !p->is_mtu_probe &&
+            !p->is_multipath_probe && p->length > p->offset) {
+            (void)picoquic_compact_sent_packet(cnx, pkt_ctx, p);
+        }
+        p = p_previous;
+    }
+}
+
+void picoquic_compact_sent_packets(picoquic_cnx_t* cnx)
+{
+    if (cnx->is_multipath_enabled) {
+        for (int i = 0; i < cnx->nb_paths; i++) {
+            picoquic_compact_sent_packets_in_context(cnx, &cnx->path[i]->pkt_ctx);
+        }
+    }
+    else {
+        picoquic_compact_sent_packets_in_context(cnx, &cnx->pkt_ctx[picoquic_packet_context_application]);
+    }
+}
+
+/* Rebuild a regular packet from a compacted packet, before it is repeated.
+ * Stream data that was acknowledged in the meantime is not copied. If the
+ * rebuilt frames are shorter than the packet, they are preceded by padding,
+ * so that the packet length, used for congestion control, does not change.
+ * The padding is placed before the frames because the last stream frame
+ * may not have a length field.
+ * Returns NULL if the packet cannot be rebuilt.
+ */
+picoquic_packet_t* picoquic_expand_compacted_packet(picoquic_cnx_t* cnx,
+    picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p)
+{
+    picoquic_packet_t* new_p = picoquic_create_packet(cnx->quic);
+    size_t byte_index = p->offset;
+    uint8_t* bytes;
+    uint8_t* bytes_max;
+    int ret = 0;
+
+    if (new_p == NULL) {
+        return NULL;
+    }
+
+    memcpy(new_p, p, offsetof(struct st_picoquic_packet_t, bytes));
+    memcpy(new_p->bytes, p->bytes, p->offset);
+    new_p->is_compacted = 0;
+    new_p->compacted_length = 0;
+    bytes = new_p->bytes + p->offset;
+    bytes_max = new_p->bytes + PICOQUIC_MAX_PACKET_SIZE;
+
+    while (ret == 0 && byte_index < p->compacted_length) {
+        const uint8_t* frame = &p->bytes[byte_index];
+        const uint8_t* frame_max = &p->bytes[p->compacted_length];
+        uint64_t ftype = 0;
+
+        if (picoquic_frames_varint_decode(frame, frame_max, &ftype) == NULL) {
+            ret = -1;
+        }
+        else if (ftype == picoquic_frame_type_stream_reference) {
+            uint8_t flags = 0;
+            uint64_t stream_id = 0;
+            uint64_t offset = 0;
+            uint64_t length = 0;
+            const uint8_t* next_frame = picoquic_parse_stream_reference_frame(frame, frame_max,
+                &flags, &stream_id, &offset, &length);
+
+            if (next_frame == NULL) {
+                ret = -1;
+            }
+            else {
+                picoquic_stream_head_t* stream = picoquic_find_stream(cnx, stream_id);
+
+                if (stream != NULL && !stream->reset_sent) {
+                    uint8_t* frame_start = bytes;
+                    uint64_t copied_offset = offset;
+                    uint8_t copy_buffer[PICOQUIC_MAX_PACKET_SIZE];
+                    int copied = picoquic_stream_copy_sent_data(stream, offset, (size_t)length, copy_buffer, &copied_offset);
+
+                    if (copied < 0) {
+                        ret = -1;
+                    }
+                    else if (copied > 0) {
+                        if ((bytes = picoquic_format_stream_frame_header(bytes, bytes_max, stream_id, copied_offset)) != NULL &&
+                            (flags & 2) != 0) {
+                            *frame_start |= 2;
+                            bytes = picoquic_frames_varint_encode(bytes, bytes_max, (uint64_t)copied);
+                        }
+                        if (bytes != NULL && bytes + copied <= bytes_max) {
+                            memcpy(bytes, copy_buffer, copied);
+                            bytes += copied;
+                        }
+                        else {
+                            ret = -1;
+                        }
+                    }
+                }
+                byte_index = next_frame - p->bytes;
+            }
+        }
+        else {
+            size_t frame_length = 0;
+            int frame_is_pure_ack = 0;
+
+            if (picoquic_skip_frame(frame, frame_max - frame, &frame_length, &frame_is_pure_ack) != 0 ||
+                bytes + frame_length > bytes_max) {
+                ret = -1;
+            }
+            else {
+                memcpy(bytes, frame, frame_length);
+                bytes += frame_length;
+                byte_index += frame_length;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        size_t new_length = bytes - new_p->bytes;
+
+        if (new_length < p->length) {
+            size_t padding_length = p->length - new_length;
+            memmove(new_p->bytes + p->offset + padding_length, new_p->bytes + p->offset, new_length - p->offset);
+            memset(new_p->bytes + p->offset, picoquic_frame_type_padding, padding_length);
+        }
+        else if (new_length > p->length) {
+            /* Acknowledging a few bytes at the beginning of a frame can increase the
+             * size of the frame header. Account for the larger packet in transit. */
+            if (p->send_path != NULL) {
+                p->send_path->bytes_in_transit += new_length - p->length;
+            }
+            new_p->length = new_length;
+        }
+        picoquic_replace_pending_packet(pkt_ctx, p, new_p);
+        picoquic_recycle_packet(cnx->quic, p);
+    }
+    else {
+        picoquic_recycle_packet(cnx->quic, new_p);
+        new_p = NULL;
+    }
+
+    return new_p;
+}
+
 /* Management of preemptive repeats.
  * This function only perform preemptive repeat for packets that contain
  * at least on frame that triggers premptive repeat, such as a stream
@@ -1271,7 +1673,8 @@ static int picoquic_preemptive_retransmit_packet(picoquic_packet_t* old_p,
 
     if (!old_p->is_mtu_probe &&
         !old_p->is_ack_trap &&
-        !old_p->is_multipath_probe) {
+        !old_p->is_multipath_probe &&
+        !old_p->is_compacted) {
         /* Copy the relevant bytes from one packet to the next */
         byte_index = old_p->offset;
 
@@ -2676,7 +3079,10 @@ void picoquic_client_almost_ready_transition(picoquic_cnx_t* cnx)
         picoquic_packet_context_t* o_pkt_ctx = &cnx->pkt_ctx[0];
         picoquic_packet_context_t* n_pkt_ctx = &cnx->path[0]->pkt_ctx;
 
+        picoquic_pending_ring_free(n_pkt_ctx);
         *n_pkt_ctx = *o_pkt_ctx;
+        o_pkt_ctx->pending_ring = NULL;
+        o_pkt_ctx->pending_ring_size = 0;
         picoquic_init_packet_ctx(cnx, o_pkt_ctx, picoquic_packet_context_application);
     }
 }
@@ -3525,15 +3931,19 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                 /* If necessary, encode the max data frame */
                 if (ret == 0){
                     if (cnx->quic->max_data_limit != 0) {
-                        if (cnx->data_received + ((3 * cnx->quic->max_data_limit) / 4) > cnx->maxdata_local) {
+                        if (cnx->data_received + ((3 * cnx->quic->max_data_limit) / 4) > cnx->maxdata_local &&
+                            picoquic_memory_pressure(cnx->quic) < 2) {
                             uint64_t max_data_increase = cnx->data_received + cnx->quic->max_data_limit - cnx->maxdata_local;
                             bytes_next = picoquic_format_max_data_frame(cnx, bytes_next, bytes_max, &more_data, &is_pure_ack,
                                 max_data_increase);
                         }
                     }
                     else if (2 * cnx->data_received > cnx->maxdata_local) {
-                        bytes_next = picoquic_format_max_data_frame(cnx, bytes_next, bytes_max, &more_data, &is_pure_ack,
-                            picoquic_cc_increased_window(cnx, cnx->maxdata_local));
+                        uint64_t max_data_increase = picoquic_receive_window_increase(cnx, cnx->maxdata_local);
+                        if (max_data_increase > 0) {
+                            bytes_next = picoquic_format_max_data_frame(cnx, bytes_next, bytes_max, &more_data, &is_pure_ack,
+                                max_data_increase);
+                        }
                     }
                 }
 
@@ -4550,9 +4960,17 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
         }
         if (*send_length > 0) {
             cnx->nb_trains_sent++;
+            /* Several QUIC packets may be coalesced in a datagram, count the datagrams */
+            picoquic_counter_add_uint64(&cnx->quic->metrics.nb_packets_sent, (send_msg_size == NULL || *send_msg_size == 0) ? 1 :
+                (*send_length + *send_msg_size - 1) / *send_msg_size);
+            picoquic_counter_add_uint64(&cnx->quic->metrics.nb_bytes_sent, *send_length);
         }
     }
 
+    if (ret == 0 && cnx->quic->use_compact_retransmit) {
+        picoquic_compact_sent_packets(cnx);
+    }
+
     if (ret == 0) {
         ret = picoquic_program_app_wake_time(cnx, &next_wake_time);
     }
@@ -4617,12 +5035,23 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
     picoquic_connection_id_t * log_cid, picoquic_cnx_t** p_last_cnx, size_t * send_msg_size)
 {
     int ret = 0;
-    picoquic_stateless_packet_t* sp = picoquic_dequeue_stateless_packet(quic);
+    picoquic_stateless_packet_t* sp;
 
     if (p_last_cnx) {
         *p_last_cnx = NULL;
     }
 
+    if (quic->async_sign != NULL) {
+        /* Resume the handshakes for which the certificate signature is ready */
+        (void)picoquic_process_async_sign(quic, current_time);
+    }
+
+    if (current_time >= quic->metrics_gauge_time) {
+        picoquic_update_quic_gauges(quic, current_time);
+    }
+
+    sp = picoquic_dequeue_stateless_packet(quic);
+
     if (sp != NULL) {
         if (sp->length > send_buffer_max) {
             *send_length = 0;
@@ -4630,6 +5059,9 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
         else {
             memcpy(send_buffer, sp->bytes, sp->length);
             *send_length = sp->length;
+            picoquic_counter_add_uint64(&quic->metrics.nb_stateless_packets_sent, 1);
+            picoquic_counter_add_uint64(&quic->metrics.nb_packets_sent, 1);
+            picoquic_counter_add_uint64(&quic->metrics.nb_bytes_sent, sp->length);
             picoquic_store_addr(p_addr_to, (struct sockaddr*) & sp->addr_to);
             picoquic_store_addr(p_addr_from, (struct sockaddr*) & sp->addr_local);
             *if_index = sp->if_index_local;
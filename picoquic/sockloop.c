@@ -28,7 +28,6 @@
  * loop will terminate if the callback return code is not zero -- except for special processing
  * of the migration testing code.
  * TODO: in Windows, use WSA asynchronous calls instead of sendmsg, allowing for multiple parallel sends.
- * TODO: in Linux, use multiple send per call API
  * TDOO: trim the #define list.
  * TODO: support the QuicDoq scenario, manage extra socket.
  */
@@ -59,6 +58,9 @@
 
 #else /* Linux */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg */
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -108,6 +110,7 @@
 #include "picoquic_internal.h"
 #include "picoquic_packet_loop.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_lb.h"
 
 #if defined(_WINDOWS)
 #ifdef UDP_SEND_MSG_SIZE
@@ -342,7 +345,7 @@ void picoquic_packet_loop_close_socket(picoquic_socket_ctx_t* s_ctx)
 #endif
 }
 
-int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
+int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso, int reuse_port,
     picoquic_socket_ctx_t* s_ctx)
 {
     int ret = 0;
@@ -371,6 +374,7 @@ int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
         /* TODO: set option IPv6 only */
         picoquic_socket_set_ecn_options(s_ctx->fd, s_ctx->af, &recv_set, &send_set) != 0 ||
         picoquic_socket_set_pkt_info(s_ctx->fd, s_ctx->af) != 0 ||
+        (reuse_port && picoquic_socket_set_reuse_port(s_ctx->fd) != 0) ||
         picoquic_bind_to_port(s_ctx->fd,s_ctx->af, s_ctx->port) != 0 ||
         picoquic_get_local_address(s_ctx->fd, &local_address) != 0 ||
         picoquic_socket_set_pmtud_options(s_ctx->fd, s_ctx->af) != 0)
@@ -429,6 +433,13 @@ int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
 
 int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
     int do_not_use_gso, picoquic_socket_ctx_t* s_ctx)
+{
+    return picoquic_packet_loop_open_sockets_ex(local_port, local_af, socket_buffer_size, extra_socket_required,
+        do_not_use_gso, 0, s_ctx);
+}
+
+int picoquic_packet_loop_open_sockets_ex(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
+    int do_not_use_gso, int reuse_port, picoquic_socket_ctx_t* s_ctx)
 {
     int nb_sockets = 0;
 
@@ -450,7 +461,7 @@ int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int soc
         }
     }
     for (int i = 0; i < nb_sockets; i++) {
-        if (picoquic_packet_loop_open_socket(socket_buffer_size, do_not_use_gso, &s_ctx[i]) != 0) {
+        if (picoquic_packet_loop_open_socket(socket_buffer_size, do_not_use_gso, reuse_port, &s_ctx[i]) != 0) {
             DBG_PRINTF("Cannot set socket (af=%d, port = %d)\n", s_ctx[i].af, s_ctx[i].port);
             for (int j = 0; j < i; j++) {
                 picoquic_packet_loop_close_socket(&s_ctx[j]);
@@ -463,6 +474,320 @@ int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int soc
     return nb_sockets;
 }
 
+/* Sharded server support.
+* Each shard holds a queue of packets forwarded by the other shards.
+* The queue is protected by a mutex. The shard's thread is woken up
+* when the queue transitions from empty to non empty.
+*/
+typedef struct st_picoquic_shard_packet_t {
+    struct st_picoquic_shard_packet_t* next_packet;
+    struct sockaddr_storage addr_from;
+    struct sockaddr_storage addr_to;
+    int if_index;
+    unsigned char received_ecn;
+    size_t length;
+    uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
+} picoquic_shard_packet_t;
+
+typedef struct st_picoquic_shard_t {
+    picoquic_sharded_server_t* sharded_server;
+    int shard_id;
+    int lb_config_created;
+    picoquic_quic_t* quic;
+    picoquic_network_thread_ctx_t* thread_ctx;
+    picoquic_network_thread_ctx_t* stopped_thread_ctx; /* Set when the shard is stopped, until the thread is deleted */
+    picoquic_packet_loop_param_t param;
+    picoquic_mutex_t queue_mutex;
+    int queue_mutex_created;
+    picoquic_shard_packet_t* first_packet;
+    picoquic_shard_packet_t* last_packet;
+    uint64_t nb_packets_forwarded;
+} picoquic_shard_t;
+
+struct st_picoquic_sharded_server_t {
+    int nb_shards;
+    picoquic_shard_t* shards;
+};
+
+int picoquic_sharded_server_find_shard(picoquic_quic_t* quic, int nb_shards, const uint8_t* bytes, size_t length)
+{
+    int shard_id = -1;
+
+    /* Only short header packets are forwarded. The DCID of long header packets
+    * may have been chosen by the client, and would not encode a shard number. */
+    if (length > (size_t)quic->local_cnxid_length + 1 && (bytes[0] & 0x80) == 0 &&
+        quic->cnx_id_callback_fn == picoquic_lb_compat_cid_generate &&
+        quic->cnx_id_callback_ctx != NULL) {
+        picoquic_connection_id_t cnx_id;
+        uint64_t server_id64;
+
+        (void)picoquic_parse_connection_id(bytes + 1, quic->local_cnxid_length, &cnx_id);
+        server_id64 = picoquic_lb_compat_cid_verify(quic, quic->cnx_id_callback_ctx, &cnx_id);
+        if (server_id64 < (uint64_t)nb_shards) {
+            shard_id = (int)server_id64;
+        }
+    }
+
+    return shard_id;
+}
+
+static int picoquic_shard_forward_packet(picoquic_shard_t* shard, uint8_t* bytes, size_t length,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index, unsigned char received_ecn)
+{
+    int ret = 0;
+    picoquic_shard_packet_t* packet = (picoquic_shard_packet_t*)malloc(sizeof(picoquic_shard_packet_t));
+
+    if (packet == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        int was_empty;
+
+        packet->next_packet = NULL;
+        picoquic_store_addr(&packet->addr_from, addr_from);
+        picoquic_store_addr(&packet->addr_to, addr_to);
+        packet->if_index = if_index;
+        packet->received_ecn = received_ecn;
+        packet->length = length;
+        memcpy(packet->bytes, bytes, length);
+
+        picoquic_lock_mutex(&shard->queue_mutex);
+        if (shard->thread_ctx == NULL) {
+            /* The shard is closing. Drop the packet. */
+            free(packet);
+        }
+        else {
+            was_empty = (shard->first_packet == NULL);
+            if (was_empty) {
+                shard->first_packet = packet;
+            }
+            else {
+                shard->last_packet->next_packet = packet;
+            }
+            shard->last_packet = packet;
+            shard->nb_packets_forwarded++;
+            if (was_empty) {
+                ret = picoquic_wake_up_network_thread(shard->thread_ctx);
+            }
+        }
+        picoquic_unlock_mutex(&shard->queue_mutex);
+    }
+
+    return ret;
+}
+
+static int picoquic_shard_drain_packets(picoquic_shard_t* shard, picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    int ret = 0;
+    picoquic_shard_packet_t* packet;
+
+    picoquic_lock_mutex(&shard->queue_mutex);
+    packet = shard->first_packet;
+    shard->first_packet = NULL;
+    shard->last_packet = NULL;
+    picoquic_unlock_mutex(&shard->queue_mutex);
+
+    while (packet != NULL) {
+        picoquic_shard_packet_t* next_packet = packet->next_packet;
+
+        if (ret == 0) {
+            ret = picoquic_incoming_packet_ex(shard->quic, packet->bytes, packet->length,
+                (struct sockaddr*)&packet->addr_from, (struct sockaddr*)&packet->addr_to,
+                packet->if_index, packet->received_ecn, last_cnx, current_time);
+        }
+        free(packet);
+        packet = next_packet;
+    }
+
+    return ret;
+}
+
+/* Submit an incoming packet, or forward it to the owning shard if the
+ * loop is part of a sharded server.
+ */
+static int picoquic_packet_loop_incoming(picoquic_network_thread_ctx_t* thread_ctx, uint8_t* bytes, size_t length,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index, unsigned char received_ecn,
+    picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    picoquic_shard_t* shard = thread_ctx->shard;
+
+    if (shard != NULL) {
+        int nb_shards = shard->sharded_server->nb_shards;
+        int shard_id = picoquic_sharded_server_find_shard(thread_ctx->quic, nb_shards, bytes, length);
+
+        if (shard_id >= 0 && shard_id != shard->shard_id) {
+            return picoquic_shard_forward_packet(&shard->sharded_server->shards[shard_id],
+                bytes, length, addr_from, addr_to, if_index, received_ecn);
+        }
+    }
+
+    return picoquic_incoming_packet_ex(thread_ctx->quic, bytes, length, addr_from, addr_to,
+        if_index, received_ecn, last_cnx, current_time);
+}
+
+/* Commands posted by application threads.
+* The data of add to stream and datagram commands is allocated in the
+* same block as the command. For add to stream, the whole block is then
+* passed to the stream with picoquic_add_to_stream_owned, and released
+* when the data has been sent, which avoids a second copy.
+*/
+typedef enum {
+    picoquic_network_command_add_to_stream = 0,
+    picoquic_network_command_mark_active_stream,
+    picoquic_network_command_queue_datagram,
+    picoquic_network_command_close
+} picoquic_network_command_enum;
+
+typedef struct st_picoquic_network_command_t {
+    picoquic_mpsc_node_t node;
+    picoquic_network_command_enum command;
+    picoquic_cnx_t* cnx;
+    uint64_t stream_id;
+    uint64_t code;
+    void* v_stream_ctx;
+    size_t length;
+    uint8_t* data;
+} picoquic_network_command_t;
+
+static picoquic_network_command_t* picoquic_network_command_create(picoquic_network_command_enum command,
+    picoquic_cnx_t* cnx, const uint8_t* data, size_t length)
+{
+    picoquic_network_command_t* cmd = (picoquic_network_command_t*)malloc(sizeof(picoquic_network_command_t) + length);
+
+    if (cmd != NULL) {
+        memset(cmd, 0, sizeof(picoquic_network_command_t));
+        cmd->command = command;
+        cmd->cnx = cnx;
+        cmd->length = length;
+        cmd->data = (uint8_t*)(cmd + 1);
+        if (length > 0) {
+            memcpy(cmd->data, data, length);
+        }
+    }
+    return cmd;
+}
+
+static void picoquic_network_command_free(uint8_t* data, void* free_ctx)
+{
+    (void)data;
+    free(free_ctx);
+}
+
+static int picoquic_network_command_post(picoquic_network_thread_ctx_t* thread_ctx, picoquic_network_command_t* cmd)
+{
+    int ret = 0;
+
+    if (cmd == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        picoquic_mpsc_push(&thread_ctx->command_queue, &cmd->node);
+        /* Only wake up the thread if no wake up is pending yet. */
+        if (picoquic_atomic_exchange_int(&thread_ctx->command_signaled, 1) == 0) {
+            ret = picoquic_wake_up_network_thread(thread_ctx);
+        }
+    }
+    return ret;
+}
+
+int picoquic_network_thread_add_to_stream(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t stream_id, const uint8_t* data, size_t length, int set_fin)
+{
+    picoquic_network_command_t* cmd = picoquic_network_command_create(picoquic_network_command_add_to_stream,
+        cnx, data, length);
+    if (cmd != NULL) {
+        cmd->stream_id = stream_id;
+        cmd->code = (uint64_t)set_fin;
+    }
+    return picoquic_network_command_post(thread_ctx, cmd);
+}
+
+int picoquic_network_thread_mark_active_stream(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t stream_id, int is_active, void* v_stream_ctx)
+{
+    picoquic_network_command_t* cmd = picoquic_network_command_create(picoquic_network_command_mark_active_stream,
+        cnx, NULL, 0);
+    if (cmd != NULL) {
+        cmd->stream_id = stream_id;
+        cmd->code = (uint64_t)is_active;
+        cmd->v_stream_ctx = v_stream_ctx;
+    }
+    return picoquic_network_command_post(thread_ctx, cmd);
+}
+
+int picoquic_network_thread_queue_datagram(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, const uint8_t* bytes, size_t length)
+{
+    return picoquic_network_command_post(thread_ctx,
+        picoquic_network_command_create(picoquic_network_command_queue_datagram, cnx, bytes, length));
+}
+
+int picoquic_network_thread_close(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_cnx_t* cnx, uint64_t application_reason_code)
+{
+    picoquic_network_command_t* cmd = picoquic_network_command_create(picoquic_network_command_close,
+        cnx, NULL, 0);
+    if (cmd != NULL) {
+        cmd->code = application_reason_code;
+    }
+    return picoquic_network_command_post(thread_ctx, cmd);
+}
+
+static void picoquic_network_command_execute(picoquic_network_command_t* cmd)
+{
+    int ret = 0;
+
+    switch (cmd->command) {
+    case picoquic_network_command_add_to_stream:
+        ret = picoquic_add_to_stream_owned(cmd->cnx, cmd->stream_id, cmd->data, cmd->length, (int)cmd->code,
+            NULL, picoquic_network_command_free, cmd);
+        if (ret == 0) {
+            /* The command is now owned by the stream */
+            return;
+        }
+        break;
+    case picoquic_network_command_mark_active_stream:
+        ret = picoquic_mark_active_stream(cmd->cnx, cmd->stream_id, (int)cmd->code, cmd->v_stream_ctx);
+        break;
+    case picoquic_network_command_queue_datagram:
+        ret = picoquic_queue_datagram_frame(cmd->cnx, cmd->length, cmd->data);
+        break;
+    case picoquic_network_command_close:
+        ret = picoquic_close(cmd->cnx, cmd->code);
+        break;
+    default:
+        ret = -1;
+        break;
+    }
+
+    if (ret != 0) {
+        DBG_PRINTF("Network command %d fails, ret = 0x%x", (int)cmd->command, ret);
+    }
+    free(cmd);
+}
+
+/* Execute the commands posted so far. The signal is reset before
+* reading the queue, so a command posted after that will cause a new wake up.
+*/
+void picoquic_network_thread_drain_commands(picoquic_network_thread_ctx_t* thread_ctx)
+{
+    picoquic_mpsc_node_t* node;
+
+    (void)picoquic_atomic_exchange_int(&thread_ctx->command_signaled, 0);
+    while ((node = picoquic_mpsc_pop(&thread_ctx->command_queue)) != NULL) {
+        picoquic_network_command_execute((picoquic_network_command_t*)node);
+    }
+}
+
+static void picoquic_network_commands_release(picoquic_network_thread_ctx_t* thread_ctx)
+{
+    picoquic_mpsc_node_t* node;
+
+    while ((node = picoquic_mpsc_pop(&thread_ctx->command_queue)) != NULL) {
+        free(node);
+    }
+}
+
 /*
 * Windows: use asynchronous receive. Asynchronous receive requires
 * declaring an overlap context and event per socket, as well as a
@@ -565,6 +890,198 @@ int picoquic_packet_loop_wait(picoquic_socket_ctx_t* s_ctx,
     return bytes_recv;
 }
 #else 
+struct st_picoquic_recv_batch_t;
+
+#if defined(__linux__)
+/* Batch receive on Linux.
+* When the option "use_recv_batch" is set, the loop reads all the datagrams
+* available on a socket with a single call to recvmmsg, up to
+* PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX messages. If UDP_GRO is enabled on
+* the socket, each message may contain several coalesced datagrams of
+* the same size (except for the last one), which are split before being
+* submitted to picoquic_incoming_packet_ex.
+*/
+typedef struct st_picoquic_recv_batch_msg_t {
+    struct iovec iov;
+    struct sockaddr_storage addr_from;
+    struct sockaddr_storage addr_dest;
+    size_t length;
+    int dest_if;
+    unsigned char received_ecn;
+    size_t udp_coalesced_size;
+    char cmsg_buffer[256];
+} picoquic_recv_batch_msg_t;
+
+typedef struct st_picoquic_recv_batch_t {
+    size_t msg_buffer_size;
+    int nb_msg;
+    uint8_t* buffer;
+    struct mmsghdr mmsg[PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX];
+    picoquic_recv_batch_msg_t msg[PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX];
+    picoquic_header_mask_batch_t header_masks;
+} picoquic_recv_batch_t;
+
+picoquic_recv_batch_t* picoquic_recv_batch_create(int use_gro)
+{
+    picoquic_recv_batch_t* recv_batch = (picoquic_recv_batch_t*)malloc(sizeof(picoquic_recv_batch_t));
+
+    if (recv_batch != NULL) {
+        memset(recv_batch, 0, sizeof(picoquic_recv_batch_t));
+        recv_batch->msg_buffer_size = (use_gro) ? 0x10000 : PICOQUIC_MAX_PACKET_SIZE;
+        recv_batch->buffer = (uint8_t*)malloc(recv_batch->msg_buffer_size * PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX);
+        if (recv_batch->buffer == NULL) {
+            free(recv_batch);
+            recv_batch = NULL;
+        }
+    }
+    return recv_batch;
+}
+
+void picoquic_recv_batch_delete(picoquic_recv_batch_t* recv_batch)
+{
+    if (recv_batch != NULL) {
+        if (recv_batch->buffer != NULL) {
+            free(recv_batch->buffer);
+        }
+        free(recv_batch);
+    }
+}
+
+static int picoquic_packet_loop_recv_batch(picoquic_socket_ctx_t* s_ctx, picoquic_recv_batch_t* recv_batch)
+{
+    int bytes_recv = 0;
+    int nb_msg;
+
+    for (int i = 0; i < PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX; i++) {
+        struct msghdr* msg = &recv_batch->mmsg[i].msg_hdr;
+
+        recv_batch->msg[i].iov.iov_base = recv_batch->buffer + i * recv_batch->msg_buffer_size;
+        recv_batch->msg[i].iov.iov_len = recv_batch->msg_buffer_size;
+        memset(msg, 0, sizeof(struct msghdr));
+        msg->msg_name = (struct sockaddr*)&recv_batch->msg[i].addr_from;
+        msg->msg_namelen = sizeof(struct sockaddr_storage);
+        msg->msg_iov = &recv_batch->msg[i].iov;
+        msg->msg_iovlen = 1;
+        msg->msg_control = (void*)recv_batch->msg[i].cmsg_buffer;
+        msg->msg_controllen = sizeof(recv_batch->msg[i].cmsg_buffer);
+        recv_batch->mmsg[i].msg_len = 0;
+    }
+
+    nb_msg = recvmmsg(s_ctx->fd, recv_batch->mmsg, PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX, MSG_DONTWAIT, NULL);
+
+    if (nb_msg <= 0) {
+        recv_batch->nb_msg = 0;
+        /* A spurious wake up is not an error, the loop will just proceed to sending. */
+        bytes_recv = (nb_msg < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? 0 : -1;
+    }
+    else {
+        recv_batch->nb_msg = nb_msg;
+        for (int i = 0; i < nb_msg; i++) {
+            picoquic_recv_batch_msg_t* msg = &recv_batch->msg[i];
+
+            msg->length = (size_t)recv_batch->mmsg[i].msg_len;
+            memset(&msg->addr_dest, 0, sizeof(msg->addr_dest));
+            msg->dest_if = 0;
+            msg->received_ecn = 0;
+            msg->udp_coalesced_size = 0;
+            picoquic_socks_cmsg_parse(&recv_batch->mmsg[i].msg_hdr, &msg->addr_dest, &msg->dest_if,
+                &msg->received_ecn, &msg->udp_coalesced_size);
+            /* Document incoming port */
+            if (msg->addr_dest.ss_family == AF_INET6) {
+                ((struct sockaddr_in6*)&msg->addr_dest)->sin6_port = htons(s_ctx->port);
+            }
+            else if (msg->addr_dest.ss_family == AF_INET) {
+                ((struct sockaddr_in*)&msg->addr_dest)->sin_port = htons(s_ctx->port);
+            }
+            bytes_recv += (int)msg->length;
+        }
+    }
+
+    return bytes_recv;
+}
+
+/* Add a message to the batch, as if received from the socket. Used in tests
+ * to simulate the reception of datagrams coalesced by UDP GRO.
+ */
+int picoquic_recv_batch_add_message(picoquic_recv_batch_t* recv_batch, const uint8_t* bytes, size_t length,
+    const struct sockaddr* addr_from, const struct sockaddr* addr_dest, size_t udp_coalesced_size)
+{
+    int ret = 0;
+
+    if (recv_batch->nb_msg >= PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX || length > recv_batch->msg_buffer_size) {
+        ret = -1;
+    }
+    else {
+        picoquic_recv_batch_msg_t* msg = &recv_batch->msg[recv_batch->nb_msg];
+
+        msg->iov.iov_base = recv_batch->buffer + recv_batch->nb_msg * recv_batch->msg_buffer_size;
+        msg->iov.iov_len = recv_batch->msg_buffer_size;
+        memcpy(msg->iov.iov_base, bytes, length);
+        msg->length = length;
+        picoquic_store_addr(&msg->addr_from, addr_from);
+        picoquic_store_addr(&msg->addr_dest, addr_dest);
+        msg->dest_if = 0;
+        msg->received_ecn = 0;
+        msg->udp_coalesced_size = udp_coalesced_size;
+        recv_batch->nb_msg++;
+    }
+
+    return ret;
+}
+
+/* Submit the messages received in a batch to the quic context, splitting
+ * the GRO coalesced messages into individual datagrams. The header protection
+ * masks of all the short header packets in the batch are computed first,
+ * so that packets of the same connection share a single ECB call.
+ */
+int picoquic_packet_loop_submit_batch(picoquic_network_thread_ctx_t* thread_ctx,
+    picoquic_recv_batch_t* recv_batch, picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    int ret = 0;
+
+    for (int i = 0; i < recv_batch->nb_msg; i++) {
+        picoquic_recv_batch_msg_t* msg = &recv_batch->msg[i];
+        size_t recv_bytes = 0;
+
+        while (recv_bytes < msg->length) {
+            size_t recv_length = msg->length - recv_bytes;
+
+            if (msg->udp_coalesced_size > 0 && recv_length > msg->udp_coalesced_size) {
+                recv_length = msg->udp_coalesced_size;
+            }
+            picoquic_header_mask_batch_add(thread_ctx->quic, &recv_batch->header_masks,
+                (uint8_t*)msg->iov.iov_base + recv_bytes, recv_length);
+            recv_bytes += recv_length;
+        }
+    }
+
+    picoquic_header_mask_batch_compute(thread_ctx->quic, &recv_batch->header_masks);
+
+    for (int i = 0; ret == 0 && i < recv_batch->nb_msg; i++) {
+        picoquic_recv_batch_msg_t* msg = &recv_batch->msg[i];
+        size_t recv_bytes = 0;
+        uint8_t* msg_bytes = (uint8_t*)msg->iov.iov_base;
+
+        while (recv_bytes < msg->length && ret == 0) {
+            size_t recv_length = msg->length - recv_bytes;
+
+            if (msg->udp_coalesced_size > 0 && recv_length > msg->udp_coalesced_size) {
+                recv_length = msg->udp_coalesced_size;
+            }
+            ret = picoquic_packet_loop_incoming(thread_ctx, msg_bytes + recv_bytes, recv_length,
+                (struct sockaddr*)&msg->addr_from, (struct sockaddr*)&msg->addr_dest,
+                msg->dest_if, msg->received_ecn, last_cnx, current_time);
+            recv_bytes += recv_length;
+        }
+    }
+
+    picoquic_header_mask_batch_clear(thread_ctx->quic, &recv_batch->header_masks);
+    recv_batch->nb_msg = 0;
+
+    return ret;
+}
+#endif
+
 int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
     int nb_sockets,
     struct sockaddr_storage* addr_from,
@@ -575,7 +1092,8 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
     int64_t delta_t,
     int * is_wake_up_event,
     picoquic_network_thread_ctx_t * thread_ctx,
-    int * socket_rank)
+    int * socket_rank,
+    struct st_picoquic_recv_batch_t * recv_batch)
 {
     fd_set readfds;
     struct timeval tv;
@@ -642,6 +1160,16 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
             for (int i = 0; i < nb_sockets; i++) {
                 if (FD_ISSET(s_ctx[i].fd, &readfds)) {
                     *socket_rank = i;
+#if defined(__linux__)
+                    if (recv_batch != NULL) {
+                        bytes_recv = picoquic_packet_loop_recv_batch(&s_ctx[i], recv_batch);
+                        if (bytes_recv < 0) {
+                            DBG_PRINTF("Could not receive batch on UDP socket[%d]= %d!\n",
+                                i, (int)s_ctx[i].fd);
+                        }
+                        break;
+                    }
+#endif
                     bytes_recv = picoquic_recvmsg(s_ctx[i].fd, addr_from,
                         addr_dest, dest_if, received_ecn,
                         buffer, buffer_max);
@@ -670,6 +1198,193 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
 }
 #endif
 
+/* Handling of send errors, shared between the single message and batch
+ * send code.
+ */
+static void picoquic_packet_loop_send_error(picoquic_quic_t* quic, picoquic_cnx_t* last_cnx,
+    picoquic_connection_id_t* log_cid, SOCKET_TYPE send_socket,
+    struct sockaddr_storage* peer_addr, struct sockaddr_storage* local_addr, int if_index,
+    uint8_t* send_buffer, size_t send_length, size_t send_msg_size,
+    int sock_ret, int sock_err, size_t** send_msg_ptr, uint64_t current_time)
+{
+    /* TODO: add a test in which the socket fails. */
+    if (last_cnx == NULL) {
+        picoquic_log_context_free_app_message(quic, log_cid, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
+            peer_addr->ss_family, local_addr->ss_family, if_index, sock_ret, sock_err);
+    }
+    else {
+        picoquic_log_app_message(last_cnx, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
+            peer_addr->ss_family, local_addr->ss_family, if_index, sock_ret, sock_err);
+
+        if (picoquic_socket_error_implies_unreachable(sock_err)) {
+            picoquic_notify_destination_unreachable(last_cnx, current_time,
+                (struct sockaddr*)peer_addr, (struct sockaddr*)local_addr, if_index,
+                sock_err);
+        }
+        else if (sock_err == EIO) {
+            /* TODO: this is an error encountered if the system supports GSO, but
+             * the specific interface driver does not. Main example is Mininet.
+             * Not sure that we can treat that correctly. Try to minimize the
+             * amount of untested code? Rely on config flag? Rely on error
+             * recovery? */
+            size_t packet_index = 0;
+            size_t packet_size = send_msg_size;
+
+            while (packet_index < send_length) {
+                if (packet_index + packet_size > send_length) {
+                    packet_size = send_length - packet_index;
+                }
+                sock_ret = picoquic_sendmsg(send_socket,
+                    (struct sockaddr*)peer_addr, (struct sockaddr*)local_addr, if_index,
+                    (const char*)(send_buffer + packet_index), (int)packet_size, 0, &sock_err);
+                if (sock_ret > 0) {
+                    packet_index += packet_size;
+                }
+                else {
+                    picoquic_log_app_message(last_cnx, "Retry with packet size=%zu fails at index %zu, ret=%d, err=%d.",
+                        packet_size, packet_index, sock_ret, sock_err);
+                    break;
+                }
+            }
+            if (sock_ret > 0) {
+                picoquic_log_app_message(last_cnx, "Retry of %zu bytes by chunks of %zu bytes succeeds.",
+                    send_length, send_msg_size);
+            }
+            if (*send_msg_ptr != NULL) {
+                /* Make sure that we do not use GSO anymore in this run */
+                *send_msg_ptr = NULL;
+                picoquic_log_app_message(last_cnx, "%s", "UDP GSO was disabled");
+            }
+        }
+    }
+}
+
+#if defined(__linux__)
+/* Batch send on Linux.
+* When the option "use_send_batch" is set, the loop collects the packets
+* prepared for several connections, each with its own destination, source
+* address and GSO segment size, and sends them with a single call to
+* sendmmsg per socket. The connection pointer is only kept for error
+* handling. Connections may be deleted while the batch is filled, so
+* the pointer is only used if no connection was deleted since the
+* message was queued.
+*/
+typedef struct st_picoquic_send_batch_msg_t {
+    uint8_t* bytes;
+    size_t length;
+    size_t send_msg_size;
+    struct sockaddr_storage peer_addr;
+    struct sockaddr_storage local_addr;
+    int if_index;
+    SOCKET_TYPE send_socket;
+    picoquic_cnx_t* cnx;
+    uint64_t nb_cnx_deleted;
+    picoquic_connection_id_t log_cid;
+    struct iovec iov;
+    char cmsg_buffer[256];
+} picoquic_send_batch_msg_t;
+
+typedef struct st_picoquic_send_batch_t {
+    size_t msg_buffer_size;
+    int nb_msg;
+    uint8_t* buffer;
+    struct mmsghdr mmsg[PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX];
+    picoquic_send_batch_msg_t msg[PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX];
+} picoquic_send_batch_t;
+
+static picoquic_send_batch_t* picoquic_send_batch_create(size_t msg_buffer_size)
+{
+    picoquic_send_batch_t* send_batch = (picoquic_send_batch_t*)malloc(sizeof(picoquic_send_batch_t));
+
+    if (send_batch != NULL) {
+        memset(send_batch, 0, sizeof(picoquic_send_batch_t));
+        send_batch->msg_buffer_size = msg_buffer_size;
+        send_batch->buffer = (uint8_t*)malloc(msg_buffer_size * PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX);
+        if (send_batch->buffer == NULL) {
+            free(send_batch);
+            send_batch = NULL;
+        }
+        else {
+            for (int i = 0; i < PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX; i++) {
+                send_batch->msg[i].bytes = send_batch->buffer + i * msg_buffer_size;
+            }
+        }
+    }
+    return send_batch;
+}
+
+static void picoquic_send_batch_delete(picoquic_send_batch_t* send_batch)
+{
+    if (send_batch != NULL) {
+        if (send_batch->buffer != NULL) {
+            free(send_batch->buffer);
+        }
+        free(send_batch);
+    }
+}
+
+static picoquic_cnx_t* picoquic_send_batch_get_cnx(picoquic_quic_t* quic, picoquic_send_batch_msg_t* msg)
+{
+    /* If any connection was deleted since the message was queued, the pointer
+     * may be dangling. This is rare, the error is then logged without context. */
+    return (msg->nb_cnx_deleted == quic->nb_cnx_deleted) ? msg->cnx : NULL;
+}
+
+static void picoquic_send_batch_flush(picoquic_quic_t* quic, picoquic_send_batch_t* send_batch,
+    size_t** send_msg_ptr, uint64_t current_time)
+{
+    int msg_index = 0;
+
+    for (int i = 0; i < send_batch->nb_msg; i++) {
+        picoquic_send_batch_msg_t* msg = &send_batch->msg[i];
+        struct msghdr* msg_hdr = &send_batch->mmsg[i].msg_hdr;
+
+        msg->iov.iov_base = msg->bytes;
+        msg->iov.iov_len = msg->length;
+        memset(msg_hdr, 0, sizeof(struct msghdr));
+        msg_hdr->msg_name = (struct sockaddr*)&msg->peer_addr;
+        msg_hdr->msg_namelen = picoquic_addr_length((struct sockaddr*)&msg->peer_addr);
+        msg_hdr->msg_iov = &msg->iov;
+        msg_hdr->msg_iovlen = 1;
+        msg_hdr->msg_control = (void*)msg->cmsg_buffer;
+        msg_hdr->msg_controllen = sizeof(msg->cmsg_buffer);
+        picoquic_socks_cmsg_format(msg_hdr, msg->length, msg->send_msg_size,
+            (struct sockaddr*)&msg->local_addr, msg->if_index);
+        send_batch->mmsg[i].msg_len = 0;
+    }
+
+    while (msg_index < send_batch->nb_msg) {
+        /* Send all consecutive messages that use the same socket in a single call */
+        SOCKET_TYPE send_socket = send_batch->msg[msg_index].send_socket;
+        int nb_same_socket = 1;
+        int nb_sent;
+
+        while (msg_index + nb_same_socket < send_batch->nb_msg &&
+            send_batch->msg[msg_index + nb_same_socket].send_socket == send_socket) {
+            nb_same_socket++;
+        }
+        nb_sent = sendmmsg(send_socket, &send_batch->mmsg[msg_index], nb_same_socket, 0);
+
+        if (nb_sent > 0) {
+            /* If only part of the messages were sent, the next iteration
+             * resends the tail. The error, if any, will be reported then. */
+            msg_index += nb_sent;
+        }
+        else {
+            /* The message at msg_index could not be sent. Process the error, then skip it. */
+            int sock_err = errno;
+            picoquic_send_batch_msg_t* msg = &send_batch->msg[msg_index];
+
+            picoquic_packet_loop_send_error(quic, picoquic_send_batch_get_cnx(quic, msg), &msg->log_cid,
+                msg->send_socket, &msg->peer_addr, &msg->local_addr, msg->if_index,
+                msg->bytes, msg->length, msg->send_msg_size, -1, sock_err, send_msg_ptr, current_time);
+            msg_index++;
+        }
+    }
+    send_batch->nb_msg = 0;
+}
+#endif
+
 static int monitor_system_call_duration(packet_loop_system_call_duration_t* sc_duration, uint64_t current_time, uint64_t previous_time)
 {
     uint64_t duration = current_time - previous_time;
@@ -699,6 +1414,12 @@ static int monitor_system_call_duration(packet_loop_system_call_duration_t* sc_d
 }
 
 
+/* Called by the certificate signing threads when a signature is ready */
+static void picoquic_packet_loop_async_sign_wake_up(void* wake_up_ctx)
+{
+    (void)picoquic_wake_up_network_thread((picoquic_network_thread_ctx_t*)wake_up_ctx);
+}
+
 #ifdef _WINDOWS
     DWORD WINAPI picoquic_packet_loop_v3(LPVOID v_ctx)
 #else
@@ -718,6 +1439,10 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     int if_index_to;
 #ifndef _WINDOWS
     uint8_t buffer[1536];
+    struct st_picoquic_recv_batch_t* recv_batch = NULL;
+#endif
+#if defined(__linux__)
+    picoquic_send_batch_t* send_batch = NULL;
 #endif
     uint8_t* send_buffer = NULL;
     size_t send_length = 0;
@@ -750,9 +1475,9 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     }
 
     memset(s_ctx, 0, sizeof(s_ctx));
-    if ((nb_sockets = picoquic_packet_loop_open_sockets(param->local_port,
+    if ((nb_sockets = picoquic_packet_loop_open_sockets_ex(param->local_port,
         param->local_af, param->socket_buffer_size,
-        param->extra_socket_required, param->do_not_use_gso, s_ctx)) <= 0) {
+        param->extra_socket_required, param->do_not_use_gso, param->reuse_port, s_ctx)) <= 0) {
         ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
     }
     else if (loop_callback != NULL) {
@@ -781,7 +1506,33 @@ void* picoquic_packet_loop_v3(void* v_ctx)
         }
     }
 
+#if defined(__linux__)
+    if (ret == 0 && param->use_recv_batch) {
+        int use_gro = 0;
+
+        if (!param->do_not_use_gso) {
+            for (int i = 0; i < nb_sockets; i++) {
+                if (picoquic_socket_set_udp_gro(s_ctx[i].fd) == 0) {
+                    s_ctx[i].supports_udp_recv_coalesced = 1;
+                    use_gro = 1;
+                }
+            }
+        }
+        if ((recv_batch = picoquic_recv_batch_create(use_gro)) == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && param->use_send_batch) {
+        if ((send_batch = picoquic_send_batch_create(send_buffer_size)) == NULL) {
+            ret = -1;
+        }
+    }
+#endif
+
     if (ret == 0) {
+        if (thread_ctx->wake_up_defined) {
+            picoquic_set_async_sign_wake_up(quic, picoquic_packet_loop_async_sign_wake_up, thread_ctx);
+        }
         thread_ctx->thread_is_ready = 1;
     }
     else {
@@ -841,10 +1592,14 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             &addr_from,
             &addr_to, &if_index_to, &received_ecn,
             buffer, sizeof(buffer),
-            delta_t, &is_wake_up_event, thread_ctx, &socket_rank);
+            delta_t, &is_wake_up_event, thread_ctx, &socket_rank, recv_batch);
         received_buffer = buffer;
 #endif
         current_time = picoquic_current_time();
+        if (delta_t == 0) {
+            /* The select call did not wait, its duration is system call time */
+            picoquic_counter_add_uint64(&quic->metrics.time_syscalls, current_time - previous_time);
+        }
         if (options.do_system_call_duration && delta_t == 0 &&
             monitor_system_call_duration(&sc_duration, current_time, previous_time)) {
             ret = loop_callback(quic, picoquic_packet_loop_system_call_duration,
@@ -856,10 +1611,18 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             ret = (thread_ctx->thread_should_close) ? PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP : -1;
         }
         else if (bytes_recv == 0 && is_wake_up_event) {
-            ret = loop_callback(quic, picoquic_packet_loop_wake_up, loop_callback_ctx, NULL);
+            picoquic_network_thread_drain_commands(thread_ctx);
+            if (thread_ctx->shard != NULL) {
+                ret = picoquic_shard_drain_packets(thread_ctx->shard, &last_cnx, current_time);
+            }
+            if (ret == 0) {
+                ret = loop_callback(quic, picoquic_packet_loop_wake_up, loop_callback_ctx, NULL);
+            }
         }
         else {
             uint64_t loop_time = current_time;
+            uint64_t send_start_time;
+            uint64_t send_syscall_time = 0;
             size_t bytes_sent = 0;
             size_t nb_packets_sent = 0;
 
@@ -874,7 +1637,7 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                         recv_length = s_ctx[socket_rank].udp_coalesced_size;
                     }
                     /* Submit the packet to the client */
-                    ret = picoquic_incoming_packet_ex(quic, s_ctx[socket_rank].recv_buffer + recv_bytes,
+                    ret = picoquic_packet_loop_incoming(thread_ctx, s_ctx[socket_rank].recv_buffer + recv_bytes,
                         recv_length, (struct sockaddr*)&addr_from,
                         (struct sockaddr*)&addr_to,
                         s_ctx[socket_rank].dest_if,
@@ -885,13 +1648,22 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                     ret = picoquic_win_recvmsg_async_start(&s_ctx[socket_rank]);
                 }
 #else
-                /* Submit the packet to the server */
-                ret = picoquic_incoming_packet_ex(quic, received_buffer,
-                    (size_t)bytes_recv, (struct sockaddr*)&addr_from,
-                    (struct sockaddr*)&addr_to, if_index_to, received_ecn,
-                    &last_cnx, current_time);
+#if defined(__linux__)
+                if (recv_batch != NULL) {
+                    /* Submit all the packets received in the batch */
+                    ret = picoquic_packet_loop_submit_batch(thread_ctx, recv_batch, &last_cnx, current_time);
+                }
+                else
 #endif
-
+                {
+                    /* Submit the packet to the server */
+                    ret = picoquic_packet_loop_incoming(thread_ctx, received_buffer,
+                        (size_t)bytes_recv, (struct sockaddr*)&addr_from,
+                        (struct sockaddr*)&addr_to, if_index_to, received_ecn,
+                        &last_cnx, current_time);
+                }
+#endif
+                picoquic_counter_add_uint64(&quic->metrics.time_receive, picoquic_current_time() - current_time);
 
                 if (loop_callback != NULL) {
                     size_t b_recvd = (size_t)bytes_recv;
@@ -928,16 +1700,30 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             * the code will not spend a lot of time sending packets while
             * packets may be adding in the receive queue.
              */
+            size_t nb_packets_max = PICOQUIC_PACKET_LOOP_SEND_MAX;
+#if defined(__linux__)
+            if (send_batch != NULL) {
+                nb_packets_max = PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX;
+            }
+#endif
 
-            while (ret == 0 && nb_packets_sent < PICOQUIC_PACKET_LOOP_SEND_MAX) {
+            send_start_time = picoquic_current_time();
+            while (ret == 0 && nb_packets_sent < nb_packets_max) {
                 struct sockaddr_storage peer_addr;
                 struct sockaddr_storage local_addr = { 0 };
                 int if_index = param->dest_if;
                 int sock_ret = 0;
                 int sock_err = 0;
+                uint8_t* packet_buffer = send_buffer;
 
+#if defined(__linux__)
+                if (send_batch != NULL) {
+                    packet_buffer = send_batch->msg[send_batch->nb_msg].bytes;
+                }
+#endif
+                send_msg_size = 0;
                 ret = picoquic_prepare_next_packet_ex(quic, loop_time,
-                    send_buffer, send_buffer_size, &send_length,
+                    packet_buffer, send_buffer_size, &send_length,
                     &peer_addr, &local_addr, &if_index, &log_cid, &last_cnx,
                     send_msg_ptr);
 
@@ -982,69 +1768,58 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                         sock_err = EIO;
                         param->simulate_eio = 0;
                     }
+#if defined(__linux__)
+                    else if (send_batch != NULL) {
+                        /* Queue the message, and send the batch when it is full */
+                        picoquic_send_batch_msg_t* msg = &send_batch->msg[send_batch->nb_msg];
+
+                        msg->length = send_length;
+                        msg->send_msg_size = send_msg_size;
+                        picoquic_store_addr(&msg->peer_addr, (struct sockaddr*)&peer_addr);
+                        picoquic_store_addr(&msg->local_addr, (struct sockaddr*)&local_addr);
+                        msg->if_index = if_index;
+                        msg->send_socket = send_socket;
+                        msg->cnx = last_cnx;
+                        msg->nb_cnx_deleted = quic->nb_cnx_deleted;
+                        msg->log_cid = log_cid;
+                        send_batch->nb_msg++;
+                        if (send_batch->nb_msg >= PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX) {
+                            uint64_t syscall_start = picoquic_current_time();
+                            picoquic_send_batch_flush(quic, send_batch, &send_msg_ptr, current_time);
+                            send_syscall_time += picoquic_current_time() - syscall_start;
+                        }
+                        sock_ret = (int)send_length;
+                    }
+#endif
                     else {
+                        uint64_t syscall_start = picoquic_current_time();
                         sock_ret = picoquic_sendmsg(send_socket,
                             (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                            (const char*)send_buffer, (int)send_length, (int)send_msg_size, &sock_err);
+                            (const char*)packet_buffer, (int)send_length, (int)send_msg_size, &sock_err);
+                        send_syscall_time += picoquic_current_time() - syscall_start;
                     }
 
                     if (sock_ret <= 0) {
-                        /* TODO: add a test in which the socket fails. */
-                        if (last_cnx == NULL) {
-                            picoquic_log_context_free_app_message(quic, &log_cid, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
-                                peer_addr.ss_family, local_addr.ss_family, if_index, sock_ret, sock_err);
-                        }
-                        else {
-                            picoquic_log_app_message(last_cnx, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
-                                peer_addr.ss_family, local_addr.ss_family, if_index, sock_ret, sock_err);
-
-                            if (picoquic_socket_error_implies_unreachable(sock_err)) {
-                                picoquic_notify_destination_unreachable(last_cnx, current_time,
-                                    (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                    sock_err);
-                            }
-                            else if (sock_err == EIO) {
-                                /* TODO: this is an error encountered if the system supports GSO, but
-                                 * the specific interface driver does not. Main example is Mininet.
-                                 * Not sure that we can treat that correctly. Try to minimize the
-                                 * amount of untested code? Rely on config flag? Rely on error
-                                 * recovery? */
-                                size_t packet_index = 0;
-                                size_t packet_size = send_msg_size;
-
-                                while (packet_index < send_length) {
-                                    if (packet_index + packet_size > send_length) {
-                                        packet_size = send_length - packet_index;
-                                    }
-                                    sock_ret = picoquic_sendmsg(send_socket,
-                                        (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                        (const char*)(send_buffer + packet_index), (int)packet_size, 0, &sock_err);
-                                    if (sock_ret > 0) {
-                                        packet_index += packet_size;
-                                    }
-                                    else {
-                                        picoquic_log_app_message(last_cnx, "Retry with packet size=%zu fails at index %zu, ret=%d, err=%d.",
-                                            packet_size, packet_index, sock_ret, sock_err);
-                                        break;
-                                    }
-                                }
-                                if (sock_ret > 0) {
-                                    picoquic_log_app_message(last_cnx, "Retry of %zu bytes by chunks of %zu bytes succeeds.",
-                                        send_length, send_msg_size);
-                                }
-                                if (send_msg_ptr != NULL) {
-                                    /* Make sure that we do not use GSO anymore in this run */
-                                    send_msg_ptr = NULL;
-                                    picoquic_log_app_message(last_cnx, "%s", "UDP GSO was disabled");
-                                }
-                            }
-                        }
+                        picoquic_packet_loop_send_error(quic, last_cnx, &log_cid, send_socket,
+                            &peer_addr, &local_addr, if_index, packet_buffer, send_length, send_msg_size,
+                            sock_ret, sock_err, &send_msg_ptr, current_time);
                     }
                 }
                 else {
                     break;
                 }
             }
+#if defined(__linux__)
+            if (send_batch != NULL && send_batch->nb_msg > 0) {
+                uint64_t syscall_start = picoquic_current_time();
+                picoquic_send_batch_flush(quic, send_batch, &send_msg_ptr, current_time);
+                send_syscall_time += picoquic_current_time() - syscall_start;
+            }
+#endif
+            /* The rest of the send loop is spent preparing packets */
+            picoquic_counter_add_uint64(&quic->metrics.time_syscalls, send_syscall_time);
+            picoquic_counter_add_uint64(&quic->metrics.time_prepare,
+                picoquic_current_time() - send_start_time - send_syscall_time);
 
             if (ret == 0 && loop_callback != NULL) {
                 ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
@@ -1053,6 +1828,7 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     }
 
     thread_ctx->thread_is_ready = 0;
+    picoquic_set_async_sign_wake_up(quic, NULL, NULL);
 
     if (ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP) {
         /* Normal termination requested by the application, returns no error */
@@ -1067,6 +1843,10 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     if (send_buffer != NULL) {
         free(send_buffer);
     }
+#if defined(__linux__)
+    picoquic_recv_batch_delete(recv_batch);
+    picoquic_send_batch_delete(send_batch);
+#endif
     thread_ctx->return_code = ret;
 #ifdef _WINDOWS
     return (DWORD)ret;
@@ -1089,6 +1869,7 @@ int picoquic_packet_loop_v2(picoquic_quic_t* quic,
     thread_ctx.param = param;
     thread_ctx.loop_callback = loop_callback;
     thread_ctx.loop_callback_ctx = loop_callback_ctx;
+    picoquic_mpsc_init(&thread_ctx.command_queue);
 
     (void)picoquic_packet_loop_v3((void*)&thread_ctx);
     return thread_ctx.return_code;
@@ -1193,10 +1974,10 @@ void picoquic_internal_thread_delete(void** v_thread_id)
     picoquic_delete_thread((picoquic_thread_t *)v_thread_id);
 }
 
-picoquic_network_thread_ctx_t* picoquic_start_custom_network_thread(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+static picoquic_network_thread_ctx_t* picoquic_start_network_thread_ex(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
     picoquic_custom_thread_create_fn thread_create_fn, picoquic_custom_thread_delete_fn thread_delete_fn,
     picoquic_custom_thread_setname_fn thread_setname_fn, char const* thread_name,
-    picoquic_packet_loop_cb_fn loop_callback, void* loop_callback_ctx, int* ret)
+    picoquic_packet_loop_cb_fn loop_callback, void* loop_callback_ctx, picoquic_shard_t* shard, int* ret)
 {
     picoquic_network_thread_ctx_t* thread_ctx = (picoquic_network_thread_ctx_t*)malloc(sizeof(picoquic_network_thread_ctx_t));
     *ret = 0;
@@ -1211,6 +1992,8 @@ picoquic_network_thread_ctx_t* picoquic_start_custom_network_thread(picoquic_qui
         thread_ctx->param = param;
         thread_ctx->loop_callback = loop_callback;
         thread_ctx->loop_callback_ctx = loop_callback_ctx;
+        thread_ctx->shard = shard;
+        picoquic_mpsc_init(&thread_ctx->command_queue);
         /* Open the wake up pipe or event */
         picoquic_open_network_wake_up(thread_ctx, ret);
         /* Start thread at specified entry point */
@@ -1237,6 +2020,15 @@ picoquic_network_thread_ctx_t* picoquic_start_custom_network_thread(picoquic_qui
     return thread_ctx;
 }
 
+picoquic_network_thread_ctx_t* picoquic_start_custom_network_thread(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+    picoquic_custom_thread_create_fn thread_create_fn, picoquic_custom_thread_delete_fn thread_delete_fn,
+    picoquic_custom_thread_setname_fn thread_setname_fn, char const* thread_name,
+    picoquic_packet_loop_cb_fn loop_callback, void* loop_callback_ctx, int* ret)
+{
+    return picoquic_start_network_thread_ex(quic, param, thread_create_fn, thread_delete_fn, thread_setname_fn,
+        thread_name, loop_callback, loop_callback_ctx, NULL, ret);
+}
+
 picoquic_network_thread_ctx_t* picoquic_start_network_thread(picoquic_quic_t* quic,
     picoquic_packet_loop_param_t* param, picoquic_packet_loop_cb_fn loop_callback, void* loop_callback_ctx, int* ret)
 {
@@ -1287,6 +2079,160 @@ void picoquic_delete_network_thread(picoquic_network_thread_ctx_t* thread_ctx)
     if (thread_ctx->is_threaded) {
         thread_ctx->thread_delete_fn((void**)&thread_ctx->pthread);
     }
+    /* Free the commands that were not executed */
+    picoquic_network_commands_release(thread_ctx);
     /* Free the context */
     free(thread_ctx);
-}
\ No newline at end of file
+}
+
+/* Management of the sharded server */
+
+/* Detach the network thread from the shard, so that the other shards
+ * stop forwarding packets to this one. The thread keeps running until
+ * it is deleted. */
+static void picoquic_shard_stop(picoquic_shard_t* shard)
+{
+    if (shard->queue_mutex_created) {
+        picoquic_lock_mutex(&shard->queue_mutex);
+        shard->stopped_thread_ctx = shard->thread_ctx;
+        shard->thread_ctx = NULL;
+        picoquic_unlock_mutex(&shard->queue_mutex);
+    }
+}
+
+/* Release the resources of the shard. This must only be called after
+ * all the network threads are deleted, since any of them may still
+ * access the queue and the mutex. */
+static void picoquic_shard_release(picoquic_shard_t* shard)
+{
+    /* Free the packets that were not processed */
+    while (shard->first_packet != NULL) {
+        picoquic_shard_packet_t* packet = shard->first_packet;
+        shard->first_packet = packet->next_packet;
+        free(packet);
+    }
+    shard->last_packet = NULL;
+    if (shard->queue_mutex_created) {
+        (void)picoquic_delete_mutex(&shard->queue_mutex);
+        shard->queue_mutex_created = 0;
+    }
+    if (shard->lb_config_created) {
+        picoquic_lb_compat_cid_config_free(shard->quic);
+        shard->lb_config_created = 0;
+    }
+}
+
+static int picoquic_shard_config_cid(picoquic_shard_t* shard)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = shard->quic;
+
+    if (quic->cnx_id_callback_fn == NULL) {
+        picoquic_load_balancer_config_t lb_config;
+
+        memset(&lb_config, 0, sizeof(lb_config));
+        lb_config.method = picoquic_load_balancer_cid_clear;
+        lb_config.server_id_length = 1;
+        lb_config.connection_id_length = (quic->local_cnxid_length < 2) ? 8 : quic->local_cnxid_length;
+        lb_config.server_id64 = (uint64_t)shard->shard_id;
+        if ((ret = picoquic_lb_compat_cid_config(quic, &lb_config)) == 0) {
+            shard->lb_config_created = 1;
+        }
+    }
+    return ret;
+}
+
+picoquic_sharded_server_t* picoquic_start_sharded_server(picoquic_quic_t** quic, int nb_shards,
+    picoquic_packet_loop_param_t* param, picoquic_packet_loop_cb_fn loop_callback, void* loop_callback_ctx, int* ret)
+{
+    picoquic_sharded_server_t* sharded_server = NULL;
+
+    *ret = 0;
+    if (nb_shards <= 0 || nb_shards > 256 || param->local_port == 0) {
+        DBG_PRINTF("Cannot start %d shards on port %d", nb_shards, param->local_port);
+        *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+    }
+    else if ((sharded_server = (picoquic_sharded_server_t*)malloc(sizeof(picoquic_sharded_server_t))) == NULL ||
+        (sharded_server->shards = (picoquic_shard_t*)malloc(nb_shards * sizeof(picoquic_shard_t))) == NULL) {
+        *ret = PICOQUIC_ERROR_MEMORY;
+        if (sharded_server != NULL) {
+            free(sharded_server);
+            sharded_server = NULL;
+        }
+    }
+    else {
+        sharded_server->nb_shards = nb_shards;
+        memset(sharded_server->shards, 0, nb_shards * sizeof(picoquic_shard_t));
+
+        /* Configure all shards before starting the threads, since
+         * any thread may forward packets to any shard */
+        for (int i = 0; *ret == 0 && i < nb_shards; i++) {
+            picoquic_shard_t* shard = &sharded_server->shards[i];
+
+            shard->sharded_server = sharded_server;
+            shard->shard_id = i;
+            shard->quic = quic[i];
+            shard->param = *param;
+            shard->param.reuse_port = 1;
+            if ((*ret = picoquic_create_mutex(&shard->queue_mutex)) == 0) {
+                shard->queue_mutex_created = 1;
+                *ret = picoquic_shard_config_cid(shard);
+            }
+        }
+        for (int i = 0; *ret == 0 && i < nb_shards; i++) {
+            picoquic_shard_t* shard = &sharded_server->shards[i];
+            picoquic_network_thread_ctx_t* thread_ctx = picoquic_start_network_thread_ex(shard->quic, &shard->param,
+                NULL, NULL, NULL, NULL, loop_callback, loop_callback_ctx, shard, ret);
+
+            if (thread_ctx == NULL) {
+                if (*ret == 0) {
+                    *ret = PICOQUIC_ERROR_MEMORY;
+                }
+            }
+            else {
+                picoquic_lock_mutex(&shard->queue_mutex);
+                shard->thread_ctx = thread_ctx;
+                picoquic_unlock_mutex(&shard->queue_mutex);
+            }
+        }
+        if (*ret != 0) {
+            picoquic_delete_sharded_server(sharded_server);
+            sharded_server = NULL;
+        }
+    }
+
+    return sharded_server;
+}
+
+int picoquic_sharded_server_is_ready(picoquic_sharded_server_t* sharded_server)
+{
+    int is_ready = 1;
+
+    for (int i = 0; is_ready && i < sharded_server->nb_shards; i++) {
+        picoquic_network_thread_ctx_t* thread_ctx = sharded_server->shards[i].thread_ctx;
+        is_ready = (thread_ctx != NULL && thread_ctx->thread_is_ready);
+    }
+    return is_ready;
+}
+
+void picoquic_delete_sharded_server(picoquic_sharded_server_t* sharded_server)
+{
+    /* Stop forwarding to all shards first, then delete all the threads,
+     * and only then release the queues and mutexes. */
+    for (int i = 0; i < sharded_server->nb_shards; i++) {
+        picoquic_shard_stop(&sharded_server->shards[i]);
+    }
+    for (int i = 0; i < sharded_server->nb_shards; i++) {
+        picoquic_shard_t* shard = &sharded_server->shards[i];
+
+        if (shard->stopped_thread_ctx != NULL) {
+            picoquic_delete_network_thread(shard->stopped_thread_ctx);
+            shard->stopped_thread_ctx = NULL;
+        }
+    }
+    for (int i = 0; i < sharded_server->nb_shards; i++) {
+        picoquic_shard_release(&sharded_server->shards[i]);
+    }
+    free(sharded_server->shards);
+    free(sharded_server);
+}
@@ -86,6 +86,7 @@ typedef struct st_picoquic_tls_ctx_t {
     size_t ext_data_size;
     uint8_t app_secret_enc[PTLS_MAX_DIGEST_SIZE];
     uint8_t app_secret_dec[PTLS_MAX_DIGEST_SIZE];
+    int async_sign_pending; /* handshake parked until the certificate signature is computed */
 } picoquic_tls_ctx_t;
 
 struct st_picoquic_log_event_t {
@@ -552,15 +553,20 @@ int picoquic_set_private_key_from_file(picoquic_quic_t* quic, char const* file_n
 
 /* Clear certificate objects allocated by the crypto stack for a certficate
 */
+static void picoquic_free_sign_certificate(ptls_sign_certificate_t* sign_certificate)
+{
+    if (picoquic_dispose_sign_certificate_fn != NULL) {
+        /* we expect the dispose function to free dependencies,
+         * but not the certificate itself. */
+        picoquic_dispose_sign_certificate_fn(sign_certificate);
+    }
+    free(sign_certificate);
+}
+
 void picoquic_dispose_sign_certificate(ptls_context_t* ctx)
 {
     if (ctx->sign_certificate != NULL) {
-        if (picoquic_dispose_sign_certificate_fn != NULL) {
-            /* we expect the dispose function to free dependencies,
-             * but not the certificate itself. */
-            picoquic_dispose_sign_certificate_fn(ctx->sign_certificate);
-        }
-        free(ctx->sign_certificate);
+        picoquic_free_sign_certificate(ctx->sign_certificate);
         ctx->sign_certificate = NULL;
     }
 }
@@ -1216,7 +1222,27 @@ static int picoquic_set_aead_from_secret(void ** v_aead,ptls_cipher_suite_t * ci
     return ret;
 }
 
-static int picoquic_set_pn_enc_from_secret(void ** v_pn_enc, ptls_cipher_suite_t * cipher, int is_enc, const void *secret, const char *prefix_label)
+/* Check that an ECB context encrypts several blocks in a single call.
+ * Some backends only process the first block, in which case the header
+ * protection masks are computed one packet at a time.
+ */
+static int picoquic_pn_ecb_is_multi_block(ptls_cipher_context_t* pn_ecb)
+{
+    uint8_t input[32];
+    uint8_t batched[32];
+    uint8_t single[32];
+
+    memset(input, 0, 16);
+    memset(input + 16, 0xff, 16);
+    memset(batched, 0, sizeof(batched));
+    ptls_cipher_encrypt(pn_ecb, single, input, 16);
+    ptls_cipher_encrypt(pn_ecb, single + 16, input + 16, 16);
+    ptls_cipher_encrypt(pn_ecb, batched, input, 32);
+
+    return memcmp(batched, single, sizeof(single)) == 0;
+}
+
+static int picoquic_set_pn_enc_from_secret(void ** v_pn_enc, void** v_pn_ecb, ptls_cipher_suite_t * cipher, int is_enc, const void *secret, const char *prefix_label)
 {
     uint8_t pnekey[PTLS_MAX_SECRET_SIZE];
     int ret;
@@ -1226,12 +1252,32 @@ static int picoquic_set_pn_enc_from_secret(void ** v_pn_enc, ptls_cipher_suite_t
         *v_pn_enc = NULL;
     }
 
+    if (v_pn_ecb != NULL && *v_pn_ecb != NULL) {
+        ptls_cipher_free((ptls_cipher_context_t*)*v_pn_ecb);
+        *v_pn_ecb = NULL;
+    }
+
     if ((ret = ptls_hkdf_expand_label(cipher->hash, pnekey, 
         cipher->aead->ctr_cipher->key_size, ptls_iovec_init(secret, cipher->hash->digest_size), 
         PICOQUIC_LABEL_HP, ptls_iovec_init(NULL, 0), prefix_label)) == 0) {
         if ((*v_pn_enc = ptls_cipher_new(cipher->aead->ctr_cipher, is_enc, pnekey)) == NULL) {
             ret = PTLS_ERROR_NO_MEMORY;
         }
+        else if (v_pn_ecb != NULL && cipher->aead->ecb_cipher != NULL) {
+            /* With AES, the header protection mask is the ECB encryption of the sample.
+             * The ECB context is optional: if it cannot be used, masks are computed
+             * with the CTR context. */
+            ptls_cipher_context_t* pn_ecb = ptls_cipher_new(cipher->aead->ecb_cipher, 1, pnekey);
+
+            if (pn_ecb != NULL) {
+                if (picoquic_pn_ecb_is_multi_block(pn_ecb)) {
+                    *v_pn_ecb = pn_ecb;
+                }
+                else {
+                    ptls_cipher_free(pn_ecb);
+                }
+            }
+        }
     }
     
     return ret;
@@ -1247,7 +1293,10 @@ void picoquic_aes128_ecb_encrypt(void* v_aesecb, uint8_t * output, const uint8_t
     ptls_cipher_encrypt((ptls_cipher_context_t*)v_aesecb, output, input, len);
 }
 
-static int picoquic_set_key_from_secret(ptls_cipher_suite_t * cipher, int is_enc, int is_rotation, picoquic_crypto_context_t * ctx, const void *secret, const char *prefix_label)
+/* The ECB context used for batch header masks is only created for the 1-RTT
+ * decryption keys, since received batches only contain short header packets.
+ */
+static int picoquic_set_key_from_secret(ptls_cipher_suite_t * cipher, int is_enc, int is_rotation, int is_1rtt, picoquic_crypto_context_t * ctx, const void *secret, const char *prefix_label)
 {
     int ret = 0;
 
@@ -1255,13 +1304,13 @@ static int picoquic_set_key_from_secret(ptls_cipher_suite_t * cipher, int is_enc
         ret = picoquic_set_aead_from_secret(&ctx->aead_encrypt, cipher, is_enc, secret, prefix_label);
         
         if (ret == 0 && !is_rotation) {
-            ret = picoquic_set_pn_enc_from_secret(&ctx->pn_enc, cipher, is_enc, secret, prefix_label);
+            ret = picoquic_set_pn_enc_from_secret(&ctx->pn_enc, NULL, cipher, is_enc, secret, prefix_label);
         }
     } else {
         ret = picoquic_set_aead_from_secret(&ctx->aead_decrypt, cipher, is_enc, secret, prefix_label);
         
         if (ret == 0 && !is_rotation) {
-            ret = picoquic_set_pn_enc_from_secret(&ctx->pn_dec, cipher, is_enc, secret, prefix_label);
+            ret = picoquic_set_pn_enc_from_secret(&ctx->pn_dec, (is_1rtt) ? &ctx->pn_dec_ecb : NULL, cipher, is_enc, secret, prefix_label);
         }
     }
 
@@ -1304,7 +1353,7 @@ static int picoquic_update_traffic_key_callback(ptls_update_traffic_key_t * self
     UNREFERENCED_PARAMETER(self);
     const char *prefix_label = picoquic_supported_versions[cnx->version_index].tls_prefix_label;
 
-    int ret = picoquic_set_key_from_secret(cipher, is_enc, 0, &cnx->crypto_context[epoch], secret, prefix_label);
+    int ret = picoquic_set_key_from_secret(cipher, is_enc, 0, epoch == picoquic_epoch_1rtt, &cnx->crypto_context[epoch], secret, prefix_label);
     if (cnx->cnx_state < picoquic_state_ready) {
         cnx->recycle_sooner_needed = 1;
     }
@@ -1426,10 +1475,10 @@ int picoquic_setup_initial_traffic_keys(picoquic_cnx_t* cnx)
             secret2 = server_secret;
         }
         
-        ret = picoquic_set_key_from_secret(cipher, 1, 0, &cnx->crypto_context[0], secret1, prefix_label);
+        ret = picoquic_set_key_from_secret(cipher, 1, 0, 0, &cnx->crypto_context[0], secret1, prefix_label);
 
         if (ret == 0) {
-            ret = picoquic_set_key_from_secret(cipher, 0, 0, &cnx->crypto_context[0], secret2, prefix_label);
+            ret = picoquic_set_key_from_secret(cipher, 0, 0, 0, &cnx->crypto_context[0], secret2, prefix_label);
         }
     }
 
@@ -1462,7 +1511,7 @@ int picoquic_get_initial_aead_context(picoquic_quic_t * quic, int version_index,
 
         ret = picoquic_set_aead_from_secret(aead_ctx, cipher, is_enc, selected_secret, prefix_label);
         if (ret == 0) {
-            ret = picoquic_set_pn_enc_from_secret(pn_enc_ctx, cipher, is_enc, selected_secret, prefix_label);
+            ret = picoquic_set_pn_enc_from_secret(pn_enc_ctx, NULL, cipher, is_enc, selected_secret, prefix_label);
         }
     }
     return ret;
@@ -1549,7 +1598,7 @@ int picoquic_compute_new_rotated_keys(picoquic_cnx_t * cnx)
     }
 
     if (ret == 0) {
-        ret = picoquic_set_key_from_secret(cipher, 1, 1, &cnx->crypto_context_new, tls_ctx->app_secret_enc, prefix_label);
+        ret = picoquic_set_key_from_secret(cipher, 1, 1, 1, &cnx->crypto_context_new, tls_ctx->app_secret_enc, prefix_label);
     }
 
     if (ret == 0) {
@@ -1567,7 +1616,7 @@ int picoquic_compute_new_rotated_keys(picoquic_cnx_t * cnx)
     }
 
     if (ret == 0) {
-        ret = picoquic_set_key_from_secret(cipher, 0, 1, &cnx->crypto_context_new, tls_ctx->app_secret_dec, prefix_label);
+        ret = picoquic_set_key_from_secret(cipher, 0, 1, 1, &cnx->crypto_context_new, tls_ctx->app_secret_dec, prefix_label);
     }
 
     return (ret == 0)?0: PICOQUIC_ERROR_CANNOT_COMPUTE_KEY;
@@ -1624,6 +1673,11 @@ void picoquic_crypto_context_free(picoquic_crypto_context_t * ctx)
         ptls_cipher_free((ptls_cipher_context_t *)ctx->pn_dec);
         ctx->pn_dec = NULL;
     }
+
+    if (ctx->pn_dec_ecb != NULL) {
+        ptls_cipher_free((ptls_cipher_context_t*)ctx->pn_dec_ecb);
+        ctx->pn_dec_ecb = NULL;
+    }
 }
 
 /*
@@ -1792,6 +1846,9 @@ void picoquic_master_tlscontext_free(picoquic_quic_t* quic)
 
         free_certificates_list(ctx->certificates.list, ctx->certificates.count);
 
+        /* Stop the signing threads and restore the original signer */
+        picoquic_async_sign_delete(quic);
+
         picoquic_dispose_sign_certificate(ctx);
 
         picoquic_dispose_verify_certificate_callback(quic);
@@ -2097,6 +2154,19 @@ void picoquic_tlscontext_trim_after_handshake(picoquic_cnx_t * cnx)
     }
 }
 
+/* When a connection moves to another QUIC context, the TLS state shall
+ * refer to the master context of the new owner, so that key updates,
+ * tickets and logging do not depend on the old context any more.
+ */
+void picoquic_tlscontext_set_master(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
+{
+    picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
+
+    if (ctx != NULL && ctx->tls != NULL && quic->tls_master_ctx != NULL) {
+        ptls_set_context(ctx->tls, (ptls_context_t*)quic->tls_master_ctx);
+    }
+}
+
 char const* picoquic_tls_get_negotiated_alpn(picoquic_cnx_t* cnx)
 {
     picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
@@ -2129,36 +2199,7 @@ static int picoquic_add_to_tls_stream(picoquic_cnx_t* cnx, const uint8_t* data,
     picoquic_stream_head_t* stream = &cnx->tls_stream[epoch];
 
     if (length > 0) {
-        picoquic_stream_queue_node_t* stream_data = (picoquic_stream_queue_node_t*)
-            malloc(sizeof(picoquic_stream_queue_node_t));
-        if (stream_data == 0) {
-            ret = -1;
-        }
-        else {
-            stream_data->bytes = (uint8_t*)malloc(length);
-
-            if (stream_data->bytes == NULL) {
-                free(stream_data);
-                stream_data = NULL;
-                ret = -1;
-            }
-            else {
-                picoquic_stream_queue_node_t** pprevious = &stream->send_queue;
-                picoquic_stream_queue_node_t* next = stream->send_queue;
-
-                memcpy(stream_data->bytes, data, length);
-                stream_data->length = length;
-                stream_data->offset = 0;
-                stream_data->next_stream_data = NULL;
-
-                while (next != NULL) {
-                    pprevious = &next->next_stream_data;
-                    next = next->next_stream_data;
-                }
-
-                *pprevious = stream_data;
-            }
-        }
+        ret = picoquic_stream_queue_add(stream, (uint8_t*)data, length, 1, NULL, NULL);
     }
 
     return ret;
@@ -2307,7 +2348,7 @@ void * picoquic_pn_enc_create_for_test(const uint8_t * secret, const char *prefi
     ptls_cipher_suite_t *cipher = picoquic_get_aes128gcm_sha256(1);
     void *v_pn_enc = NULL;
     
-    (void)picoquic_set_pn_enc_from_secret(&v_pn_enc, cipher, 1, secret, prefix_label);
+    (void)picoquic_set_pn_enc_from_secret(&v_pn_enc, NULL, cipher, 1, secret, prefix_label);
 
     return v_pn_enc;
 }
@@ -2466,6 +2507,36 @@ size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t in
     return encrypted;
 }
 
+/* Encrypt a packet and compute its header protection mask in a single pass.
+ * The sample is read from the encrypted output, and the mask is returned in
+ * the 16 bytes of "mask". Backends such as "fusion" interleave the mask
+ * computation with the AES-GCM pipeline; other backends compute the mask
+ * after the payload is encrypted, as a separate call to the PN cipher would.
+ */
+size_t picoquic_aead_encrypt_with_mask(uint8_t* output, const uint8_t* input, size_t input_length,
+    int use_path_id, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length,
+    void* aead_context, void* pn_enc, const uint8_t* sample, uint8_t* mask)
+{
+    ptls_aead_context_t* aead = (ptls_aead_context_t*)aead_context;
+    ptls_aead_supplementary_encryption_t supp;
+    uint8_t seq32[4];
+
+    supp.ctx = (ptls_cipher_context_t*)pn_enc;
+    supp.input = sample;
+
+    if (use_path_id) {
+        picoformat_32(seq32, (uint32_t)path_id);
+        ptls_aead_xor_iv(aead, seq32, sizeof(seq32));
+    }
+    ptls_aead_encrypt_s(aead, output, input, input_length, seq_num, auth_data, auth_data_length, &supp);
+    if (use_path_id) {
+        ptls_aead_xor_iv(aead, seq32, sizeof(seq32));
+    }
+    memcpy(mask, supp.output, sizeof(supp.output));
+
+    return input_length + aead->algo->tag_size;
+}
+
 /* management of version specific salt, for initial packet encryption.
  */
 
@@ -2500,10 +2571,15 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
     picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
     size_t next_epoch = 0;
 
+    if (ctx->async_sign_pending) {
+        /* The TLS data stays queued until the handshake is resumed */
+        return 0;
+    }
+
     /* Provide indication of current connection for later callbacks */
     cnx->quic->cnx_in_progress = cnx;
 
-    for (size_t epoch = 0; epoch < PICOQUIC_NUMBER_OF_EPOCHS && ret == 0; epoch++) {
+    for (size_t epoch = 0; epoch < PICOQUIC_NUMBER_OF_EPOCHS && ret == 0 && !ctx->async_sign_pending; epoch++) {
         picoquic_stream_head_t* stream = &cnx->tls_stream[epoch];
         picoquic_stream_data_node_t* data = (picoquic_stream_data_node_t*)picosplay_first(&stream->stream_data_tree);
         size_t processed = 0;
@@ -2528,7 +2604,7 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
             }
         }
 
-        while ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) &&
+        while ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) && !ctx->async_sign_pending &&
             data != NULL && data->offset <= stream->consumed_offset) {
             struct st_ptls_buffer_t sendbuf;
             size_t start = (size_t)(stream->consumed_offset - data->offset);
@@ -2547,6 +2623,15 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
 
             ret = ptls_handle_message(ctx->tls, &sendbuf, send_offset, epoch,
                 data->bytes + start, epoch_data, &ctx->handshake_properties);
+#ifdef PTLS_ERROR_ASYNC_OPERATION
+            if (ret == PTLS_ERROR_ASYNC_OPERATION) {
+                /* The certificate is being signed by a worker thread. The messages
+                 * produced so far are sent, the handshake resumes in
+                 * picoquic_async_sign_process when the signature is ready. */
+                ctx->async_sign_pending = 1;
+                ret = PTLS_ERROR_IN_PROGRESS;
+            }
+#endif
 
             if ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS ||
                 ret == PTLS_ERROR_STATELESS_RETRY)) {
@@ -2700,6 +2785,494 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
     return ret;
 }
 
+/*
+ * Asynchronous signature of the server certificate.
+ *
+ * The signature of the CertificateVerify message is the most expensive
+ * part of the server handshake. When asynchronous signing is enabled, the
+ * signing callback of the TLS context is replaced by a wrapper. On the
+ * first call, the wrapper queues a job for a pool of worker threads and
+ * returns PTLS_ERROR_ASYNC_OPERATION. The handshake is parked: the messages
+ * produced so far are sent, and new TLS data stays in the crypto streams.
+ * The worker calls the original signing callback, then queues the job on
+ * a lock-free completion queue and calls the wake up function, typically
+ * waking up the network thread. The network thread resumes the handshake
+ * in picoquic_async_sign_process; picotls calls the wrapper again, which
+ * returns the computed signature.
+ *
+ * Jobs are referenced by the TLS context, until picotls destroys them, and
+ * by the completion queue. Both references are released in the network
+ * thread. If a connection is deleted while a worker is signing, the
+ * deletion waits for the signature to complete, since the original
+ * callback may access the TLS context.
+ */
+#ifdef PTLS_ERROR_ASYNC_OPERATION
+#define PICOQUIC_ASYNC_SIGN_WORKER_WAIT 10000
+#define PICOQUIC_ASYNC_SIGN_POLL_INTERVAL 1000
+
+typedef struct st_picoquic_async_sign_job_t {
+    picoquic_mpsc_node_t node;
+    ptls_async_job_t super;
+    struct st_picoquic_async_sign_t* async_sign;
+    struct st_picoquic_async_sign_job_t* next_pending;
+    picoquic_cnx_t* cnx;
+    ptls_t* tls;
+    int nb_references;
+    int is_running;
+    int is_abandoned;
+    int sign_ret;
+    uint16_t selected_algorithm;
+    ptls_buffer_t output;
+    uint16_t* algorithms;
+    size_t num_algorithms;
+    uint8_t* input;
+    size_t input_len;
+} picoquic_async_sign_job_t;
+
+typedef struct st_picoquic_async_sign_t {
+    ptls_sign_certificate_t super;
+    ptls_sign_certificate_t* sign_certificate; /* the actual signer */
+    picoquic_quic_t* quic;
+    picoquic_mutex_t mutex;
+    picoquic_event_t wake_event; /* signaled when jobs are queued */
+    picoquic_event_t done_event; /* signaled when a worker completes a job */
+    picoquic_thread_t* threads;
+    int nb_threads;
+    volatile int should_stop;
+    picoquic_async_sign_job_t* first_pending;
+    picoquic_async_sign_job_t* last_pending;
+    picoquic_mpsc_queue_t completed;
+    picoquic_async_sign_wake_up_fn wake_up_fn;
+    void* wake_up_ctx;
+    uint64_t nb_submitted; /* only updated by the network thread */
+    volatile uint64_t nb_completed; /* updated by the workers */
+    uint64_t nb_resumed;
+} picoquic_async_sign_t;
+
+static void picoquic_async_sign_job_release(picoquic_async_sign_job_t* job)
+{
+    job->nb_references--;
+    if (job->nb_references <= 0) {
+        ptls_buffer_dispose(&job->output);
+        free(job);
+    }
+}
+
+/* Called by picotls when the job is no longer needed, either after the
+ * handshake resumed or when the TLS context is freed. */
+static void picoquic_async_sign_job_destroy(ptls_async_job_t* self)
+{
+    picoquic_async_sign_job_t* job = container_of(self, picoquic_async_sign_job_t, super);
+    picoquic_async_sign_t* async_sign = job->async_sign;
+
+    (void)picoquic_lock_mutex(&async_sign->mutex);
+    job->is_abandoned = 1;
+    job->cnx = NULL;
+    while (job->is_running) {
+        (void)picoquic_unlock_mutex(&async_sign->mutex);
+        (void)picoquic_wait_for_event(&async_sign->done_event, PICOQUIC_ASYNC_SIGN_POLL_INTERVAL);
+        (void)picoquic_lock_mutex(&async_sign->mutex);
+    }
+    job->tls = NULL;
+    (void)picoquic_unlock_mutex(&async_sign->mutex);
+
+    picoquic_async_sign_job_release(job);
+}
+
+static picoquic_thread_return_t picoquic_async_sign_worker(void* arg)
+{
+    picoquic_async_sign_t* async_sign = (picoquic_async_sign_t*)arg;
+
+    while (1) {
+        picoquic_async_sign_job_t* job = NULL;
+        int should_stop = async_sign->should_stop;
+
+        (void)picoquic_lock_mutex(&async_sign->mutex);
+        if ((job = async_sign->first_pending) != NULL) {
+            if ((async_sign->first_pending = job->next_pending) == NULL) {
+                async_sign->last_pending = NULL;
+            }
+            job->next_pending = NULL;
+            job->is_running = !job->is_abandoned;
+        }
+        (void)picoquic_unlock_mutex(&async_sign->mutex);
+
+        if (job != NULL) {
+            if (job->is_running) {
+                job->sign_ret = async_sign->sign_certificate->cb(async_sign->sign_certificate, job->tls, NULL,
+                    &job->selected_algorithm, &job->output, ptls_iovec_init(job->input, job->input_len),
+                    job->algorithms, job->num_algorithms);
+            }
+            else {
+                job->sign_ret = PTLS_ERROR_NOT_AVAILABLE;
+            }
+
+            (void)picoquic_lock_mutex(&async_sign->mutex);
+            job->is_running = 0;
+            picoquic_atomic_store_uint64(&async_sign->nb_completed, async_sign->nb_completed + 1);
+            /* The job may be released by the network thread as soon as it is queued */
+            picoquic_mpsc_push(&async_sign->completed, &job->node);
+            if (async_sign->wake_up_fn != NULL) {
+                async_sign->wake_up_fn(async_sign->wake_up_ctx);
+            }
+            (void)picoquic_unlock_mutex(&async_sign->mutex);
+            (void)picoquic_signal_event(&async_sign->done_event);
+        }
+        else if (should_stop) {
+            break;
+        }
+        else {
+            (void)picoquic_wait_for_event(&async_sign->wake_event, PICOQUIC_ASYNC_SIGN_WORKER_WAIT);
+        }
+    }
+
+    picoquic_thread_do_return;
+}
+
+static int picoquic_async_sign_certificate(ptls_sign_certificate_t* self, ptls_t* tls, ptls_async_job_t** async,
+    uint16_t* selected_algorithm, ptls_buffer_t* output, ptls_iovec_t input, const uint16_t* algorithms, size_t num_algorithms)
+{
+    picoquic_async_sign_t* async_sign = (picoquic_async_sign_t*)self;
+    int ret = 0;
+
+    if (async == NULL) {
+        /* Asynchronous operation not supported in this context, e.g., client authentication */
+        ret = async_sign->sign_certificate->cb(async_sign->sign_certificate, tls, NULL, selected_algorithm,
+            output, input, algorithms, num_algorithms);
+    }
+    else if (*async == NULL) {
+        size_t job_size = sizeof(picoquic_async_sign_job_t) + num_algorithms * sizeof(uint16_t) + input.len;
+        picoquic_async_sign_job_t* job = (picoquic_async_sign_job_t*)malloc(job_size);
+
+        if (job == NULL) {
+            ret = PTLS_ERROR_NO_MEMORY;
+        }
+        else {
+            memset(job, 0, sizeof(picoquic_async_sign_job_t));
+            job->super.destroy_ = picoquic_async_sign_job_destroy;
+            job->async_sign = async_sign;
+            job->cnx = (picoquic_cnx_t*)*ptls_get_data_ptr(tls);
+            job->tls = tls;
+            /* One reference for the TLS context, one for the completion queue */
+            job->nb_references = 2;
+            ptls_buffer_init(&job->output, "", 0);
+            job->algorithms = (uint16_t*)(job + 1);
+            job->num_algorithms = num_algorithms;
+            if (num_algorithms > 0) {
+                memcpy(job->algorithms, algorithms, num_algorithms * sizeof(uint16_t));
+            }
+            job->input = ((uint8_t*)job->algorithms) + num_algorithms * sizeof(uint16_t);
+            job->input_len = input.len;
+            if (input.len > 0) {
+                memcpy(job->input, input.base, input.len);
+            }
+
+            (void)picoquic_lock_mutex(&async_sign->mutex);
+            if (async_sign->last_pending == NULL) {
+                async_sign->first_pending = job;
+            }
+            else {
+                async_sign->last_pending->next_pending = job;
+            }
+            async_sign->last_pending = job;
+            (void)picoquic_unlock_mutex(&async_sign->mutex);
+            (void)picoquic_signal_event(&async_sign->wake_event);
+
+            async_sign->nb_submitted++;
+            *async = &job->super;
+            ret = PTLS_ERROR_ASYNC_OPERATION;
+        }
+    }
+    else {
+        /* Resuming the handshake after the worker completed the signature */
+        picoquic_async_sign_job_t* job = container_of(*async, picoquic_async_sign_job_t, super);
+
+        if ((ret = job->sign_ret) == 0) {
+            *selected_algorithm = job->selected_algorithm;
+            ret = ptls_buffer__do_pushv(output, job->output.base, job->output.off);
+        }
+        *async = NULL;
+        job->super.destroy_(&job->super);
+    }
+
+    return ret;
+}
+
+/* Resume a handshake parked while the certificate was signed */
+static void picoquic_async_sign_resume(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
+    struct st_ptls_buffer_t sendbuf;
+    size_t send_offset[PICOQUIC_NUMBER_OF_EPOCH_OFFSETS] = { 0, 0, 0, 0, 0 };
+    int ret;
+
+    ctx->async_sign_pending = 0;
+    cnx->quic->cnx_in_progress = cnx;
+    ptls_buffer_init(&sendbuf, "", 0);
+    picoquic_clear_crypto_errors();
+
+    ret = ptls_handle_message(ctx->tls, &sendbuf, send_offset, 0, NULL, 0, &ctx->handshake_properties);
+
+    if (ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) {
+        for (int i = 0; i < PICOQUIC_NUMBER_OF_EPOCHS && ret != -1; i++) {
+            if (send_offset[i] < send_offset[i + 1]) {
+                if (picoquic_add_to_tls_stream(cnx,
+                    sendbuf.base + send_offset[i], send_offset[i + 1] - send_offset[i], i) != 0) {
+                    ret = -1;
+                }
+            }
+        }
+        if (ret != -1 && (cnx->cnx_state == picoquic_state_server_init ||
+            cnx->cnx_state == picoquic_state_server_handshake) &&
+            (ret == 0 || ptls_handshake_is_complete(ctx->tls)) &&
+            cnx->crypto_context[3].aead_encrypt != NULL) {
+            cnx->cnx_state = picoquic_state_server_almost_ready;
+        }
+    }
+
+    if (ret != 0 && ret != PTLS_ERROR_IN_PROGRESS) {
+        uint16_t error_code = PICOQUIC_TRANSPORT_INTERNAL_ERROR;
+
+        picoquic_log_crypto_errors(cnx, ret);
+        if (PTLS_ERROR_GET_CLASS(ret) == PTLS_ERROR_CLASS_SELF_ALERT) {
+            error_code = PICOQUIC_TRANSPORT_CRYPTO_ERROR(ret);
+        }
+        DBG_PRINTF("Resumed handshake failed, ret = 0x%x.\n", ret);
+        (void)picoquic_connection_error(cnx, error_code, 0);
+    }
+
+    ptls_buffer_dispose(&sendbuf);
+    cnx->quic->cnx_in_progress = NULL;
+
+    /* Process the TLS data received while the handshake was parked */
+    if (cnx->cnx_state < picoquic_state_disconnecting) {
+        (void)picoquic_tls_stream_process(cnx, NULL, current_time);
+    }
+    picoquic_reinsert_by_wake_time(cnx->quic, cnx, current_time);
+}
+
+int picoquic_process_async_sign(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_async_sign_t* async_sign = quic->async_sign;
+    int nb_resumed = 0;
+
+    if (async_sign != NULL && picoquic_atomic_load_uint64(&async_sign->nb_completed) != async_sign->nb_resumed) {
+        picoquic_mpsc_node_t* node;
+
+        while ((node = picoquic_mpsc_pop(&async_sign->completed)) != NULL) {
+            picoquic_async_sign_job_t* job = (picoquic_async_sign_job_t*)node;
+
+            async_sign->nb_resumed++;
+            if (!job->is_abandoned && job->cnx != NULL) {
+                picoquic_cnx_t* cnx = job->cnx;
+                /* The job may be destroyed during the resumption, release the queue reference first */
+                picoquic_async_sign_job_release(job);
+                picoquic_async_sign_resume(cnx, current_time);
+                nb_resumed++;
+            }
+            else {
+                picoquic_async_sign_job_release(job);
+            }
+        }
+    }
+
+    return nb_resumed;
+}
+
+uint64_t picoquic_async_sign_wake_time(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_async_sign_t* async_sign = quic->async_sign;
+    uint64_t wake_time = UINT64_MAX;
+    uint64_t nb_completed = picoquic_atomic_load_uint64(&async_sign->nb_completed);
+
+    if (nb_completed != async_sign->nb_resumed) {
+        wake_time = current_time;
+    }
+    else if (async_sign->nb_submitted != nb_completed && async_sign->wake_up_fn == NULL) {
+        /* Without wake up function, poll for completed signatures */
+        wake_time = current_time + PICOQUIC_ASYNC_SIGN_POLL_INTERVAL;
+    }
+
+    return wake_time;
+}
+
+int picoquic_wait_async_sign(picoquic_quic_t* quic, uint64_t max_wait_microsec)
+{
+    picoquic_async_sign_t* async_sign = quic->async_sign;
+    int ret = 0;
+
+    if (async_sign != NULL) {
+        uint64_t start_time = picoquic_current_time();
+
+        while (picoquic_atomic_load_uint64(&async_sign->nb_completed) != async_sign->nb_submitted) {
+            uint64_t now = picoquic_current_time();
+            if (now - start_time >= max_wait_microsec) {
+                ret = -1;
+                break;
+            }
+            (void)picoquic_wait_for_event(&async_sign->done_event, PICOQUIC_ASYNC_SIGN_POLL_INTERVAL);
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_set_async_sign_wake_up(picoquic_quic_t* quic, picoquic_async_sign_wake_up_fn wake_up_fn, void* wake_up_ctx)
+{
+    picoquic_async_sign_t* async_sign = quic->async_sign;
+
+    if (async_sign != NULL) {
+        (void)picoquic_lock_mutex(&async_sign->mutex);
+        async_sign->wake_up_fn = wake_up_fn;
+        async_sign->wake_up_ctx = wake_up_ctx;
+        (void)picoquic_unlock_mutex(&async_sign->mutex);
+    }
+}
+
+void picoquic_async_sign_delete(picoquic_quic_t* quic)
+{
+    picoquic_async_sign_t* async_sign = quic->async_sign;
+
+    if (async_sign != NULL) {
+        ptls_context_t* ctx = (ptls_context_t*)quic->tls_master_ctx;
+        picoquic_mpsc_node_t* node;
+
+        (void)picoquic_atomic_exchange_int(&async_sign->should_stop, 1);
+        (void)picoquic_signal_event(&async_sign->wake_event);
+        for (int i = 0; i < async_sign->nb_threads; i++) {
+            (void)picoquic_wait_thread(async_sign->threads[i]);
+        }
+        /* All connections are deleted at this point, so all the jobs were destroyed
+         * by picotls and only the queue references are left. */
+        while ((node = picoquic_mpsc_pop(&async_sign->completed)) != NULL) {
+            picoquic_async_sign_job_release((picoquic_async_sign_job_t*)node);
+        }
+        if (ctx != NULL && ctx->sign_certificate == &async_sign->super) {
+            ctx->sign_certificate = async_sign->sign_certificate;
+        }
+        else if (async_sign->sign_certificate != NULL) {
+            /* A new key was installed after enabling asynchronous signing. The
+             * wrapper is not used anymore, and the original signer, kept for the
+             * jobs already submitted, is only referenced here. */
+            picoquic_free_sign_certificate(async_sign->sign_certificate);
+        }
+        picoquic_delete_event(&async_sign->done_event);
+        picoquic_delete_event(&async_sign->wake_event);
+        (void)picoquic_delete_mutex(&async_sign->mutex);
+        free(async_sign->threads);
+        free(async_sign);
+        quic->async_sign = NULL;
+    }
+}
+
+int picoquic_enable_async_sign(picoquic_quic_t* quic, int nb_threads)
+{
+    int ret = 0;
+    ptls_context_t* ctx = (ptls_context_t*)quic->tls_master_ctx;
+    picoquic_async_sign_t* async_sign = NULL;
+
+    if (nb_threads <= 0 || quic->async_sign != NULL) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_STATE;
+    }
+    else if (ctx == NULL || ctx->sign_certificate == NULL) {
+        ret = PICOQUIC_ERROR_TLS_SERVER_CON_WITHOUT_CERT;
+    }
+    else if ((async_sign = (picoquic_async_sign_t*)malloc(sizeof(picoquic_async_sign_t))) == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        memset(async_sign, 0, sizeof(picoquic_async_sign_t));
+        async_sign->super.cb = picoquic_async_sign_certificate;
+        async_sign->sign_certificate = ctx->sign_certificate;
+        async_sign->quic = quic;
+        picoquic_mpsc_init(&async_sign->completed);
+
+        if (picoquic_create_mutex(&async_sign->mutex) != 0) {
+            free(async_sign);
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else if (picoquic_create_event(&async_sign->wake_event) != 0) {
+            (void)picoquic_delete_mutex(&async_sign->mutex);
+            free(async_sign);
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else if (picoquic_create_event(&async_sign->done_event) != 0) {
+            picoquic_delete_event(&async_sign->wake_event);
+            (void)picoquic_delete_mutex(&async_sign->mutex);
+            free(async_sign);
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            /* From here on, picoquic_async_sign_delete handles the cleanup */
+            quic->async_sign = async_sign;
+            ctx->sign_certificate = &async_sign->super;
+
+            if ((async_sign->threads = (picoquic_thread_t*)malloc(sizeof(picoquic_thread_t) * nb_threads)) == NULL) {
+                ret = PICOQUIC_ERROR_MEMORY;
+            }
+            else {
+                while (async_sign->nb_threads < nb_threads &&
+                    picoquic_create_thread(&async_sign->threads[async_sign->nb_threads], picoquic_async_sign_worker, async_sign) == 0) {
+                    async_sign->nb_threads++;
+                }
+                if (async_sign->nb_threads == 0) {
+                    DBG_PRINTF("%s", "Cannot start the certificate signing threads.\n");
+                    ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+                }
+            }
+
+            if (ret != 0) {
+                picoquic_async_sign_delete(quic);
+            }
+        }
+    }
+
+    return ret;
+}
+#else
+/* The version of picotls does not support asynchronous operations.
+ * Certificates are signed synchronously in the network thread. */
+int picoquic_process_async_sign(picoquic_quic_t* quic, uint64_t current_time)
+{
+    UNREFERENCED_PARAMETER(quic);
+    UNREFERENCED_PARAMETER(current_time);
+    return 0;
+}
+
+uint64_t picoquic_async_sign_wake_time(picoquic_quic_t* quic, uint64_t current_time)
+{
+    UNREFERENCED_PARAMETER(quic);
+    UNREFERENCED_PARAMETER(current_time);
+    return UINT64_MAX;
+}
+
+int picoquic_wait_async_sign(picoquic_quic_t* quic, uint64_t max_wait_microsec)
+{
+    UNREFERENCED_PARAMETER(quic);
+    UNREFERENCED_PARAMETER(max_wait_microsec);
+    return 0;
+}
+
+void picoquic_set_async_sign_wake_up(picoquic_quic_t* quic, picoquic_async_sign_wake_up_fn wake_up_fn, void* wake_up_ctx)
+{
+    UNREFERENCED_PARAMETER(quic);
+    UNREFERENCED_PARAMETER(wake_up_fn);
+    UNREFERENCED_PARAMETER(wake_up_ctx);
+}
+
+void picoquic_async_sign_delete(picoquic_quic_t* quic)
+{
+    UNREFERENCED_PARAMETER(quic);
+}
+
+int picoquic_enable_async_sign(picoquic_quic_t* quic, int nb_threads)
+{
+    UNREFERENCED_PARAMETER(quic);
+    UNREFERENCED_PARAMETER(nb_threads);
+    return PICOQUIC_ERROR_UNEXPECTED_STATE;
+}
+#endif
+
 /*
  * Test whether the TLS handshake is complete according to TLS stack
  */
@@ -56,11 +56,16 @@ void picoquic_tlscontext_free(void* ctx);
 
 void picoquic_tlscontext_trim_after_handshake(picoquic_cnx_t* cnx);
 
+void picoquic_tlscontext_set_master(picoquic_quic_t* quic, picoquic_cnx_t* cnx);
+
 void picoquic_tlscontext_remove_ticket(picoquic_cnx_t* cnx);
 
 int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int* data_consumed, uint64_t current_time);
 int picoquic_is_tls_complete(picoquic_cnx_t* cnx);
 
+uint64_t picoquic_async_sign_wake_time(picoquic_quic_t* quic, uint64_t current_time);
+void picoquic_async_sign_delete(picoquic_quic_t* quic);
+
 int picoquic_initialize_tls_stream(picoquic_cnx_t* cnx, uint64_t current_time);
 
 uint64_t picoquic_get_tls_time(picoquic_quic_t* quic);
@@ -86,6 +91,10 @@ size_t picoquic_aead_decrypt_mp(uint8_t* output, const uint8_t* input, size_t in
 size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t input_length, uint64_t path_id,
     uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context);
 
+size_t picoquic_aead_encrypt_with_mask(uint8_t* output, const uint8_t* input, size_t input_length,
+    int use_path_id, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length,
+    void* aead_context, void* pn_enc, const uint8_t* sample, uint8_t* mask);
+
 uint64_t picoquic_aead_integrity_limit(void* aead_ctx);
 uint64_t picoquic_aead_confidentiality_limit(void* aead_ctx);
 
@@ -1224,6 +1224,115 @@ int picoquic_wait_for_event(picoquic_event_t* event, uint64_t microsec_wait)
     return ret;
 }
 
+void* picoquic_atomic_exchange_ptr(void* volatile* target, void* value)
+{
+#ifdef _WINDOWS
+    return InterlockedExchangePointer((PVOID volatile*)target, value);
+#else
+    return __atomic_exchange_n(target, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+void* picoquic_atomic_load_ptr(void* volatile* target)
+{
+#ifdef _WINDOWS
+    return InterlockedCompareExchangePointer((PVOID volatile*)target, NULL, NULL);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+int picoquic_atomic_exchange_int(volatile int* target, int value)
+{
+#ifdef _WINDOWS
+    return (int)InterlockedExchange((LONG volatile*)target, (LONG)value);
+#else
+    return __atomic_exchange_n(target, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+uint64_t picoquic_atomic_load_uint64(volatile uint64_t* target)
+{
+#ifdef _WINDOWS
+    return (uint64_t)InterlockedCompareExchange64((LONG64 volatile*)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void picoquic_atomic_store_uint64(volatile uint64_t* target, uint64_t value)
+{
+#ifdef _WINDOWS
+    (void)InterlockedExchange64((LONG64 volatile*)target, (LONG64)value);
+#else
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+void picoquic_counter_add_uint64(volatile uint64_t* target, uint64_t value)
+{
+    /* Only the calling thread writes the counter, so reading it does not need
+     * to be atomic; the store is, for the other threads that read it. */
+    picoquic_atomic_store_uint64(target, *target + value);
+}
+
+/* Lock-free MPSC queue.
+ * Producers swap the "last" pointer, then link the previous last node
+ * to the new node. Between these two steps, the chain starting at "first"
+ * is interrupted, which is why pop may return NULL for a non-empty queue.
+ * The stub node is reinserted when the consumer reaches the last node,
+ * so that "last" never points to a node that was returned by pop.
+ */
+void picoquic_mpsc_init(picoquic_mpsc_queue_t* queue)
+{
+    queue->stub.next = NULL;
+    queue->first = &queue->stub;
+    queue->last = &queue->stub;
+}
+
+void picoquic_mpsc_push(picoquic_mpsc_queue_t* queue, picoquic_mpsc_node_t* node)
+{
+    picoquic_mpsc_node_t* previous;
+
+    node->next = NULL;
+    previous = (picoquic_mpsc_node_t*)picoquic_atomic_exchange_ptr((void* volatile*)&queue->last, node);
+    (void)picoquic_atomic_exchange_ptr((void* volatile*)&previous->next, node);
+}
+
+picoquic_mpsc_node_t* picoquic_mpsc_pop(picoquic_mpsc_queue_t* queue)
+{
+    picoquic_mpsc_node_t* first = queue->first;
+    picoquic_mpsc_node_t* next = (picoquic_mpsc_node_t*)picoquic_atomic_load_ptr((void* volatile*)&first->next);
+
+    if (first == &queue->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        queue->first = next;
+        first = next;
+        next = (picoquic_mpsc_node_t*)picoquic_atomic_load_ptr((void* volatile*)&next->next);
+    }
+
+    if (next != NULL) {
+        queue->first = next;
+        return first;
+    }
+
+    if (first != (picoquic_mpsc_node_t*)picoquic_atomic_load_ptr((void* volatile*)&queue->last)) {
+        /* A push is in progress */
+        return NULL;
+    }
+
+    picoquic_mpsc_push(queue, &queue->stub);
+    next = (picoquic_mpsc_node_t*)picoquic_atomic_load_ptr((void* volatile*)&first->next);
+    if (next != NULL) {
+        queue->first = next;
+        return first;
+    }
+
+    return NULL;
+}
+
 
 /* Pseudo random generation suitable for tests. Guaranties that the
 * same seed will produce the same sequence, allows for specific
@@ -626,6 +626,13 @@ void ptls_mbedtls_aead_do_encrypt(struct st_ptls_aead_context_t* _ctx, void* out
     in_v.len = inlen;
 
     ptls_mbedtls_aead_do_encrypt_v(_ctx, output, &in_v, 1, seq, aad, aadlen);
+
+    if (supp != NULL) {
+        /* Compute the header protection mask from the encrypted sample */
+        ptls_cipher_init(supp->ctx, supp->input);
+        memset(supp->output, 0, sizeof(supp->output));
+        ptls_cipher_encrypt(supp->ctx, supp->output, supp->output, sizeof(supp->output));
+    }
 }
 
 size_t ptls_mbedtls_aead_do_decrypt(struct st_ptls_aead_context_t* _ctx, void* output, const void* input, size_t inlen, uint64_t seq,
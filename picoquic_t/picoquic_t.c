@@ -48,8 +48,13 @@ static const picoquic_test_def_t test_table[] = {
     { "sprintf", util_sprintf_test },
     { "memcmp", util_memcmp_test },
     { "threading", util_threading_test },
+    { "mpsc", util_mpsc_test },
     { "picohash", picohash_test },
     { "picohash_embedded", picohash_embedded_test },
+    { "picohash_grow", picohash_grow_test },
+    { "picohash_bench", picohash_bench_test },
+    { "picoheap", picoheap_test },
+    { "picoheap_bench", picoheap_bench_test },
     { "bytestream", bytestream_test },
     { "sockloop_basic", sockloop_basic_test },
     { "sockloop_eio", sockloop_eio_test },
@@ -59,9 +64,16 @@ static const picoquic_test_def_t test_table[] = {
     { "sockloop_nat", sockloop_nat_test },
     { "sockloop_thread", sockloop_thread_test },
     { "sockloop_thread_name", sockloop_thread_name_test },
+    { "sockloop_thread_command", sockloop_thread_command_test },
+    { "sockloop_recv_batch", sockloop_recv_batch_test },
+    { "sockloop_recv_gro", sockloop_recv_gro_test },
+    { "sockloop_send_batch", sockloop_send_batch_test },
+    { "sockloop_shard_cid", sockloop_shard_cid_test },
+    { "sockloop_sharded_server", sockloop_sharded_server_test },
     { "splay", splay_test },
     { "create_cnx", create_cnx_test },
     { "create_quic", create_quic_test },
+    { "wake_scheduler", wake_scheduler_test },
     { "parseheader", parseheadertest },
     { "incoming_initial", incoming_initial_test },
     { "header_length", header_length_test },
@@ -77,11 +89,16 @@ static const picoquic_test_def_t test_table[] = {
     { "frames_format", frames_format_test },
     { "logger", logger_test },
     { "binlog", binlog_test },
+    { "binlog_index", binlog_index_test },
+    { "binlog_async", binlog_async_test },
+    { "qlog_multi", qlog_multi_test },
+    { "picolog_batch", picolog_batch_test },
     { "app_message_overflow", app_message_overflow_test },
     { "TlsStreamFrame", TlsStreamFrameTest },
     { "StreamZeroFrame", StreamZeroFrameTest },
     { "stream_splay", stream_splay_test },
     { "stream_output", stream_output_test },
+    { "stream_ready_queue", stream_ready_queue_test },
     { "stream_retransmit_copy", test_copy_for_retransmit },
     { "dataqueue_copy", dataqueue_copy_test },
     { "dataqueue_packet", dataqueue_packet_test },
@@ -98,6 +115,8 @@ static const picoquic_test_def_t test_table[] = {
     { "clear_text_aead", cleartext_aead_test },
     { "pn_ctr", pn_ctr_test },
     { "cleartext_pn_enc", cleartext_pn_enc_test },
+    { "packet_mask", packet_mask_test },
+    { "header_mask_batch", header_mask_batch_test },
     { "cid_for_lb", cid_for_lb_test },
     { "cid_for_lb_cli", cid_for_lb_cli_test },
     { "retry_protection_vector", retry_protection_vector_test },
@@ -118,6 +137,7 @@ static const picoquic_test_def_t test_table[] = {
 #endif
     { "tls_api", tls_api_test },
     { "tls_api_inject_hs_ack", tls_api_inject_hs_ack_test },
+    { "async_sign", async_sign_test },
     { "null_sni", null_sni_test },
     { "silence_test", tls_api_silence_test },
     { "code_version", code_version_test },
@@ -145,6 +165,8 @@ static const picoquic_test_def_t test_table[] = {
     { "ddos_amplification", ddos_amplification_test },
     { "ddos_amplification_0rtt", ddos_amplification_0rtt_test },
     { "ddos_amplification_8k", ddos_amplification_8k_test },
+    { "initial_flood", initial_flood_test },
+    { "initial_flood_prefixes", initial_flood_prefixes_test },
     { "blackhole", blackhole_test },
     { "no_ack_frequency", no_ack_frequency_test },
     { "immediate_ack", immediate_ack_test },
@@ -259,6 +281,7 @@ static const picoquic_test_def_t test_table[] = {
     { "cnxid_transmit_r_early", transmit_cnxid_retire_early_test },
     { "probe_api", probe_api_test },
     { "migration" , migration_test },
+    { "cnx_attach", cnx_attach_test },
     { "migration_long", migration_test_long },
     { "migration_with_loss", migration_test_loss },
     { "migration_zero", migration_zero_test },
@@ -270,6 +293,8 @@ static const picoquic_test_def_t test_table[] = {
     { "retire_cnxid", retire_cnxid_test },
     { "not_before_cnxid", not_before_cnxid_test },
     { "server_busy", server_busy_test },
+    { "memory_budget", memory_budget_test },
+    { "quic_metrics", quic_metrics_test },
     { "initial_close", initial_close_test },
     { "initial_server_close", initial_server_close_test },
     { "new_rotated_key", new_rotated_key_test },
@@ -378,8 +403,12 @@ static const picoquic_test_def_t test_table[] = {
     { "limited_batch", limited_batch_test },
     { "limited_safe", limited_safe_test },
     { "send_stream_blocked", send_stream_blocked_test },
+    { "stream_owned", stream_owned_test },
+    { "compact_retransmit", compact_retransmit_test },
+    { "pending_ring", pending_ring_test },
     { "stream_ack", stream_ack_test },
     { "queue_network_input", queue_network_input_test },
+    { "queue_network_fragments", queue_network_fragments_test },
     { "pacing_update", pacing_update_test },
     { "quality_update", quality_update_test },
     { "direct_receive", direct_receive_test },
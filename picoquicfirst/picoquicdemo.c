@@ -294,6 +294,14 @@ int quic_server(const char* server_name, picoquic_quic_config_t * config, int ju
     picoquic_file_param.web_folder = config->www_dir;
     picoquic_file_param.path_table = path_item_list;
     picoquic_file_param.path_table_nb = 2;
+    if (config->www_dir != NULL) {
+        /* Files are shared by all the connections served by this context */
+        picoquic_file_param.file_cache = h3zero_file_cache_create(H3ZERO_FILE_CACHE_DEFAULT_MAX_OPEN, 1);
+        if (picoquic_file_param.file_cache == NULL) {
+            fprintf(stderr, "Could not create the file cache for %s\n", config->www_dir);
+            ret = -1;
+        }
+    }
 
     memset(&loop_cb_ctx, 0, sizeof(server_loop_cb_t));
     loop_cb_ctx.just_once = just_once;
@@ -376,6 +384,9 @@ int quic_server(const char* server_name, picoquic_quic_config_t * config, int ju
     if (qserver != NULL) {
         picoquic_free(qserver);
     }
+    if (picoquic_file_param.file_cache != NULL) {
+        h3zero_file_cache_delete(picoquic_file_param.file_cache);
+    }
 
     return ret;
 }
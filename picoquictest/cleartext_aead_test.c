@@ -27,6 +27,7 @@
 #include "picoquic_utils.h"
 #include "picotls.h"
 #include "picoquic_lb.h"
+#include <stdlib.h>
 #include <string.h>
 #include "picoquictest_internal.h"
 
@@ -210,6 +211,230 @@ int cleartext_aead_test()
     return ret;
 }
 
+/*
+ * Verify that encrypting a packet and computing the header protection mask
+ * in one pass produces the same result as the separate AEAD and PN calls.
+ */
+int packet_mask_test()
+{
+    int ret = 0;
+    uint8_t clear_text[1536];
+    uint8_t ref_text[1536];
+    uint8_t test_text[1536];
+    uint32_t seqnum = 0xdeadbeef;
+    size_t clear_length = 1200;
+    picoquic_packet_header ph_init;
+    struct sockaddr_in test_addr_c;
+    picoquic_cnx_t* cnx_client = NULL;
+    picoquic_quic_t* qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, 0, NULL, NULL, NULL, 0);
+
+    if (qclient == NULL) {
+        DBG_PRINTF("%s", "Could not create Quic context.\n");
+        ret = -1;
+    }
+    else {
+        memset(&test_addr_c, 0, sizeof(struct sockaddr_in));
+        test_addr_c.sin_family = AF_INET;
+        memcpy(&test_addr_c.sin_addr, addr1, 4);
+        test_addr_c.sin_port = 12345;
+
+        cnx_client = picoquic_create_cnx(qclient, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_addr_c, 0, 0, NULL, NULL, 1);
+        if (cnx_client == NULL) {
+            DBG_PRINTF("%s", "Could not create client connection context.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        cleartext_aead_packet_init_header(&ph_init,
+            cnx_client->initial_cnxid, seqnum, cnx_client->proposed_version,
+            picoquic_packet_initial);
+        cleartext_aead_init_packet(&ph_init, clear_text, clear_length);
+    }
+
+    /* Test the single path and the multipath nonce */
+    for (int use_path_id = 0; ret == 0 && use_path_id < 2; use_path_id++) {
+        uint8_t ref_mask[5] = { 0, 0, 0, 0, 0 };
+        uint8_t test_mask[16];
+        size_t ref_length;
+        size_t test_length;
+        void* aead = cnx_client->crypto_context[0].aead_encrypt;
+        void* pn_enc = cnx_client->crypto_context[0].pn_enc;
+
+        memcpy(ref_text, clear_text, ph_init.offset);
+        memcpy(test_text, clear_text, ph_init.offset);
+        if (use_path_id) {
+            ref_length = picoquic_aead_encrypt_mp(ref_text + ph_init.offset,
+                clear_text + ph_init.offset, clear_length - ph_init.offset, 1,
+                seqnum, ref_text, ph_init.offset, aead);
+        }
+        else {
+            ref_length = picoquic_aead_encrypt_generic(ref_text + ph_init.offset,
+                clear_text + ph_init.offset, clear_length - ph_init.offset,
+                seqnum, ref_text, ph_init.offset, aead);
+        }
+        picoquic_pn_encrypt(pn_enc, ref_text + ph_init.pn_offset + 4, ref_mask, ref_mask, sizeof(ref_mask));
+
+        test_length = picoquic_aead_encrypt_with_mask(test_text + ph_init.offset,
+            clear_text + ph_init.offset, clear_length - ph_init.offset, use_path_id, 1,
+            seqnum, test_text, ph_init.offset, aead, pn_enc, test_text + ph_init.pn_offset + 4, test_mask);
+
+        if (test_length != ref_length || memcmp(test_text, ref_text, ph_init.offset + ref_length) != 0) {
+            DBG_PRINTF("Encrypted packet does not match, use_path_id = %d.\n", use_path_id);
+            ret = -1;
+        }
+        else if (memcmp(test_mask, ref_mask, sizeof(ref_mask)) != 0) {
+            DBG_PRINTF("Header protection mask does not match, use_path_id = %d.\n", use_path_id);
+            ret = -1;
+        }
+    }
+
+    if (cnx_client != NULL) {
+        picoquic_delete_cnx(cnx_client);
+    }
+
+    if (qclient != NULL) {
+        picoquic_free(qclient);
+    }
+
+    return ret;
+}
+
+/*
+ * Verify that header protection masks computed in a batch give the same
+ * result as the masks computed one packet at a time. The test installs
+ * AES header protection keys in the 1-RTT context, so short header packets
+ * can be processed without completing a handshake. The initial context has
+ * no ECB context, since batches only contain 1-RTT packets.
+ */
+#define HEADER_MASK_BATCH_TEST_NB 8
+
+int header_mask_batch_test()
+{
+    int ret = 0;
+    struct sockaddr_in test_addr_c;
+    picoquic_cnx_t* cnx_client = NULL;
+    picoquic_quic_t* qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, 0, NULL, NULL, NULL, 0);
+    picoquic_header_mask_batch_t* batch = (picoquic_header_mask_batch_t*)malloc(sizeof(picoquic_header_mask_batch_t));
+    uint8_t packets[HEADER_MASK_BATCH_TEST_NB + 1][128];
+    uint8_t ref_bytes[128];
+    uint8_t test_bytes[128];
+    size_t packet_length = sizeof(packets[0]);
+    uint8_t hp_key[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    ptls_aead_algorithm_t* aead = (ptls_aead_algorithm_t*)picoquic_get_aes128gcm_v(0);
+
+    if (qclient == NULL || batch == NULL || aead == NULL) {
+        DBG_PRINTF("%s", "Could not create Quic context.\n");
+        ret = -1;
+    }
+    else {
+        memset(batch, 0, sizeof(picoquic_header_mask_batch_t));
+        memset(&test_addr_c, 0, sizeof(struct sockaddr_in));
+        test_addr_c.sin_family = AF_INET;
+        memcpy(&test_addr_c.sin_addr, addr1, 4);
+        test_addr_c.sin_port = 12345;
+
+        cnx_client = picoquic_create_cnx(qclient, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_addr_c, 0, 0, NULL, NULL, 1);
+        if (cnx_client == NULL) {
+            DBG_PRINTF("%s", "Could not create client connection context.\n");
+            ret = -1;
+        }
+        else if (cnx_client->crypto_context[picoquic_epoch_initial].pn_dec_ecb != NULL) {
+            DBG_PRINTF("%s", "Unexpected ECB context for the initial keys.\n");
+            ret = -1;
+        }
+        else if (aead->ecb_cipher == NULL ||
+            (cnx_client->crypto_context[picoquic_epoch_1rtt].pn_dec = ptls_cipher_new(aead->ctr_cipher, 0, hp_key)) == NULL ||
+            (cnx_client->crypto_context[picoquic_epoch_1rtt].pn_dec_ecb = ptls_cipher_new(aead->ecb_cipher, 1, hp_key)) == NULL) {
+            DBG_PRINTF("%s", "Could not create the header protection contexts.\n");
+            ret = -1;
+        }
+    }
+
+    /* Create short header packets, plus one packet with an unknown CID */
+    if (ret == 0) {
+        uint64_t seed = 0xdeadbeef;
+
+        for (int i = 0; i <= HEADER_MASK_BATCH_TEST_NB; i++) {
+            size_t byte_index = 0;
+            picoquic_connection_id_t dcid = cnx_client->path[0]->p_local_cnxid->cnx_id;
+
+            if (i == HEADER_MASK_BATCH_TEST_NB) {
+                dcid.id[0] ^= 0xff;
+            }
+            packets[i][byte_index++] = 0x43;
+            byte_index += picoquic_format_connection_id(&packets[i][byte_index], packet_length - byte_index, dcid);
+            picoformat_32(&packets[i][byte_index], 0x10 + i);
+            byte_index += 4;
+            while (byte_index < packet_length) {
+                seed *= 101;
+                packets[i][byte_index++] = (uint8_t)(seed >> 24);
+            }
+            picoquic_header_mask_batch_add(qclient, batch, packets[i], packet_length);
+        }
+
+        if ((int)batch->nb_masks != HEADER_MASK_BATCH_TEST_NB) {
+            DBG_PRINTF("Batch contains %d packets instead of %d.\n", (int)batch->nb_masks, HEADER_MASK_BATCH_TEST_NB);
+            ret = -1;
+        }
+        else {
+            picoquic_header_mask_batch_compute(qclient, batch);
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < HEADER_MASK_BATCH_TEST_NB; i++) {
+        picoquic_packet_header ph_ref;
+        picoquic_packet_header ph_test;
+        picoquic_cnx_t* pcnx = NULL;
+
+        if (picoquic_parse_packet_header(qclient, packets[i], packet_length, (struct sockaddr*)&test_addr_c, &ph_ref, &pcnx, 1) != 0 ||
+            pcnx != cnx_client || ph_ref.ptype != picoquic_packet_1rtt_protected) {
+            DBG_PRINTF("Cannot parse packet %d.\n", i);
+            ret = -1;
+            break;
+        }
+        memcpy(&ph_test, &ph_ref, sizeof(picoquic_packet_header));
+        /* The reference removes the protection without using the batch */
+        ret = picoquic_remove_header_protection_inner(packets[i], packet_length, ref_bytes, &ph_ref,
+            cnx_client->crypto_context[picoquic_epoch_1rtt].pn_dec, cnx_client->is_loss_bit_enabled_incoming,
+            picoquic_sack_list_last(picoquic_sack_list_from_cnx_context(cnx_client, ph_ref.pc, ph_ref.l_cid)));
+        if (ret == 0) {
+            ret = picoquic_remove_header_protection(cnx_client, packets[i], test_bytes, &ph_test);
+        }
+        if (ret != 0 || ph_test.pn64 != ph_ref.pn64 || ph_test.offset != ph_ref.offset ||
+            ph_test.payload_length != ph_ref.payload_length || memcmp(test_bytes, ref_bytes, ph_ref.offset) != 0) {
+            DBG_PRINTF("Header protection of packet %d does not match.\n", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && (int)batch->next_mask != HEADER_MASK_BATCH_TEST_NB) {
+        DBG_PRINTF("Used %d precomputed masks instead of %d.\n", (int)batch->next_mask, HEADER_MASK_BATCH_TEST_NB);
+        ret = -1;
+    }
+
+    if (batch != NULL) {
+        if (qclient != NULL) {
+            picoquic_header_mask_batch_clear(qclient, batch);
+        }
+        free(batch);
+    }
+
+    if (cnx_client != NULL) {
+        picoquic_delete_cnx(cnx_client);
+    }
+
+    if (qclient != NULL) {
+        picoquic_free(qclient);
+    }
+
+    return ret;
+}
+
 static int cleartext_iv_cmp(void * void_aead, uint8_t * ref_iv, size_t iv_length)
 {
 #if 0
@@ -511,32 +511,189 @@ int qpack_huffman_base_test()
         }
     }
 
-    /* Second, test a set of valid terminators */
+    /* Second, verify that padding of 8 bits or more is rejected, as required by RFC 7541 */
     for (size_t i = 1; ret == 0 && i < 4; i++) {
         input_length = 0;
         for (size_t l = 0; l < i; l++) {
             input[input_length++] = 0xFF;
         }
 
-        ret = hzero_qpack_huffman_decode(
+        if (hzero_qpack_huffman_decode(
             input,
             input + input_length,
-            data, sizeof(data), &nb_data);
-        if (ret == 0) {
-            if (nb_data != 0) {
-                DBG_PRINTF("Huffman eof test %d bad length (%d vs %d)\n", (int)i,
-                    (int)nb_data, 0);
+            data, sizeof(data), &nb_data) == 0) {
+            DBG_PRINTF("Huffman accepts %d octets of padding\n", (int)i);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+
+/* Test of QPACK Huffman encoding. The encoding of the test strings
+ * must match the test vectors, all octet values must survive a round
+ * trip, and the decoder must reject invalid padding and EOS.
+ */
+static uint8_t qpack_huffman_bad_padding[] = { 0x18 }; /* "a" padded with 0 */
+static uint8_t qpack_huffman_eos[] = { 0xff, 0xff, 0xff, 0xff };
+static uint8_t qpack_huffman_eos_inside[] = { 0x07, 0xff, 0xff, 0xff, 0xff }; /* "0" followed by EOS */
+static uint8_t qpack_huffman_long_padding[] = { 0xff }; /* empty string padded with 8 bits */
+static uint8_t qpack_huffman_long_padding_2[] = { 0x1f, 0xff }; /* "a" padded with 11 bits */
+
+int qpack_huffman_encode_test()
+{
+    int ret = 0;
+    uint8_t encoded[1024];
+    uint8_t data[512];
+    uint8_t all_octets[256];
+    size_t nb_data;
+    uint8_t* bytes;
+
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_test_case; i++) {
+        bytes = h3zero_qpack_huffman_encode(encoded, encoded + sizeof(encoded),
+            qpack_huffman_test_case[i].result, qpack_huffman_test_case[i].result_size);
+        if (bytes == NULL) {
+            DBG_PRINTF("Huffman cannot encode test %d\n", (int)i);
+            ret = -1;
+        }
+        else if ((size_t)(bytes - encoded) != qpack_huffman_test_case[i].test_size ||
+            h3zero_qpack_huffman_encoded_length(qpack_huffman_test_case[i].result,
+                qpack_huffman_test_case[i].result_size) != qpack_huffman_test_case[i].test_size) {
+            DBG_PRINTF("Huffman encode test %d bad length (%d vs %d)\n", (int)i,
+                (int)(bytes - encoded), (int)qpack_huffman_test_case[i].test_size);
+            ret = -1;
+        }
+        else if (memcmp(encoded, qpack_huffman_test_case[i].test, qpack_huffman_test_case[i].test_size) != 0) {
+            DBG_PRINTF("Huffman encode test %d does not match\n", (int)i);
+            ret = -1;
+        }
+        else if (h3zero_qpack_huffman_encode(encoded, encoded + qpack_huffman_test_case[i].test_size - 1,
+            qpack_huffman_test_case[i].result, qpack_huffman_test_case[i].result_size) != NULL) {
+            DBG_PRINTF("Huffman encode test %d does not detect overflow\n", (int)i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        for (size_t i = 0; i < sizeof(all_octets); i++) {
+            all_octets[i] = (uint8_t)(255 - i);
+        }
+        bytes = h3zero_qpack_huffman_encode(encoded, encoded + sizeof(encoded), all_octets, sizeof(all_octets));
+        if (bytes == NULL ||
+            hzero_qpack_huffman_decode(encoded, bytes, data, sizeof(data), &nb_data) != 0 ||
+            nb_data != sizeof(all_octets) || memcmp(data, all_octets, nb_data) != 0) {
+            DBG_PRINTF("%s", "Huffman round trip of all octets fails\n");
+            ret = -1;
+        }
+        else if (hzero_qpack_huffman_decode(encoded, bytes, data, sizeof(all_octets) - 1, &nb_data) == 0) {
+            DBG_PRINTF("%s", "Huffman decode does not detect overflow\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 &&
+        (hzero_qpack_huffman_decode(qpack_huffman_bad_padding, qpack_huffman_bad_padding + sizeof(qpack_huffman_bad_padding),
+            data, sizeof(data), &nb_data) == 0 ||
+        hzero_qpack_huffman_decode(qpack_huffman_eos, qpack_huffman_eos + sizeof(qpack_huffman_eos),
+            data, sizeof(data), &nb_data) == 0 ||
+        hzero_qpack_huffman_decode(qpack_huffman_eos_inside, qpack_huffman_eos_inside + sizeof(qpack_huffman_eos_inside),
+            data, sizeof(data), &nb_data) == 0 ||
+        hzero_qpack_huffman_decode(qpack_huffman_long_padding, qpack_huffman_long_padding + sizeof(qpack_huffman_long_padding),
+            data, sizeof(data), &nb_data) == 0 ||
+        hzero_qpack_huffman_decode(qpack_huffman_long_padding_2, qpack_huffman_long_padding_2 + sizeof(qpack_huffman_long_padding_2),
+            data, sizeof(data), &nb_data) == 0)) {
+        DBG_PRINTF("%s", "Huffman decode accepts invalid input\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Micro benchmark of QPACK Huffman coding, using a set of header values
+ * typical of small object requests and responses. The test verifies the
+ * round trip, and prints the encoding and decoding throughput.
+ */
+static char const* qpack_huffman_bench_headers[] = {
+    "/", "/index.html", "/static/js/main.4f2c8a1b.chunk.js", "/images/thumbnails/img_00042.jpg",
+    "/api/v1/objects?id=1234567&fields=name,size,mtime",
+    "www.example.com", "cdn.example.net:443", "https://www.example.com",
+    "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0",
+    "H3Zero/1.0", "text/html; charset=utf-8", "application/json", "image/webp,image/apng,*/*;q=0.8",
+    "gzip, deflate, br", "en-US,en;q=0.9", "max-age=31536000, immutable",
+    "Wed, 21 Oct 2015 07:28:00 GMT", "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"",
+    "session=38afes7a8; theme=dark; lang=en", "bytes=0-1023"
+};
+
+#define QPACK_HUFFMAN_BENCH_ROUNDS 10000
+#define QPACK_HUFFMAN_BENCH_MAX_HEADERS 32
+
+int qpack_huffman_bench_test()
+{
+    int ret = 0;
+    size_t nb_headers = sizeof(qpack_huffman_bench_headers) / sizeof(char const*);
+    uint8_t encoded[QPACK_HUFFMAN_BENCH_MAX_HEADERS][128];
+    size_t encoded_length[QPACK_HUFFMAN_BENCH_MAX_HEADERS];
+    uint8_t decoded[256];
+    size_t nb_decoded = 0;
+    size_t raw_bytes = 0;
+    size_t huffman_bytes = 0;
+    uint64_t start_time;
+    uint64_t encode_time = 0;
+    uint64_t decode_time = 0;
+
+    /* Verify the round trip for each header */
+    for (size_t i = 0; ret == 0 && i < nb_headers && i < QPACK_HUFFMAN_BENCH_MAX_HEADERS; i++) {
+        size_t length = strlen(qpack_huffman_bench_headers[i]);
+        uint8_t* bytes = h3zero_qpack_huffman_encode(encoded[i], encoded[i] + sizeof(encoded[i]),
+            (const uint8_t*)qpack_huffman_bench_headers[i], length);
+
+        if (bytes == NULL) {
+            DBG_PRINTF("Cannot encode header %d\n", (int)i);
+            ret = -1;
+        }
+        else {
+            encoded_length[i] = bytes - encoded[i];
+            if (hzero_qpack_huffman_decode(encoded[i], bytes, decoded, sizeof(decoded), &nb_decoded) != 0 ||
+                nb_decoded != length || memcmp(decoded, qpack_huffman_bench_headers[i], length) != 0) {
+                DBG_PRINTF("Cannot decode header %d\n", (int)i);
                 ret = -1;
             }
+            raw_bytes += length;
+            huffman_bytes += encoded_length[i];
         }
-        else {
-            DBG_PRINTF("Huffman cannot decode eof test %d\n", (int)i);
+    }
+
+    if (ret == 0 && huffman_bytes >= raw_bytes) {
+        DBG_PRINTF("Huffman encoding does not compress header values, %zu vs %zu\n", huffman_bytes, raw_bytes);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        start_time = picoquic_current_time();
+        for (int round = 0; round < QPACK_HUFFMAN_BENCH_ROUNDS; round++) {
+            for (size_t i = 0; i < nb_headers; i++) {
+                (void)h3zero_qpack_huffman_encode(encoded[i], encoded[i] + sizeof(encoded[i]),
+                    (const uint8_t*)qpack_huffman_bench_headers[i], strlen(qpack_huffman_bench_headers[i]));
+            }
         }
+        encode_time = picoquic_current_time() - start_time;
+
+        start_time = picoquic_current_time();
+        for (int round = 0; ret == 0 && round < QPACK_HUFFMAN_BENCH_ROUNDS; round++) {
+            for (size_t i = 0; ret == 0 && i < nb_headers; i++) {
+                ret = hzero_qpack_huffman_decode(encoded[i], encoded[i] + encoded_length[i],
+                    decoded, sizeof(decoded), &nb_decoded);
+            }
+        }
+        decode_time = picoquic_current_time() - start_time;
+
+        DBG_PRINTF("Huffman bench, %d rounds of %zu bytes (%zu encoded): encode %" PRIu64 " us, decode %" PRIu64 " us\n",
+            QPACK_HUFFMAN_BENCH_ROUNDS, raw_bytes, huffman_bytes, encode_time, decode_time);
     }
+
     return ret;
 }
 
-
 #define QPACK_HUFFMAN_TXT "qpack_huffman.txt"
 
 /* Test decoding of basic QPACK messages */
@@ -553,10 +710,12 @@ int qpack_huffman_base_test()
 #define QPACK_TEST_HEADER_STATUS_LEN 7
 #define QPACK_TEST_HEADER_QPACK_PATH 0xFD, 0xFD, 0xFD 
 #define QPACK_TEST_HEADER_DEQPACK_PATH 'Z', 'Z', 'Z'
-#define QPACK_TEST_HEADER_HOST 0x50, 0x0b, 'e', 'x', 'a', 'm', 'p', 'l', 'e', '.', 'c', 'o', 'm'
+/* Authority: example.com, Huffman encoded */
+#define QPACK_TEST_HEADER_HOST 0x50, 0x80 | 8, 0x2f, 0x91, 0xd3, 0x5d, 0x05, 0x5c, 0x87, 0xa7
 #define QPACK_TEST_HEADER_ALLOW_GET_POST 
-#define QPACK_TEST_ALLOWED_METHODS 'G', 'E', 'T', ',', ' ', 'P', 'O', 'S', 'T', ',', ' ', 'C', 'O', 'N', 'N', 'E', 'C', 'T'
-#define QPACK_TEST_ALLOWED_METHODS_LEN 18
+/* "GET, POST, CONNECT", Huffman encoded */
+#define QPACK_TEST_ALLOWED_METHODS 0xc5, 0x83, 0x7f, 0xd2, 0x9a, 0xf5, 0x6e, 0xdf, 0xf4, 0xa5, 0xed, 0x5a, 0x74, 0xe0, 0xbd, 0xbf
+#define QPACK_TEST_ALLOWED_METHODS_LEN (0x80 | 16)
 #define QPACK_TEST_VALUE_RANGE10 'b', 'y', 't', 'e', 's', '=', '1', '-', '1', '0'
 #define QPACK_TEST_VALUE_RANGE10_LEN 10
 static uint8_t qpack_test_get_slash[] = {
@@ -959,11 +1118,12 @@ int h3zero_prepare_qpack_test()
 /* Check that the user agent string is correctly set.
  */
 
-#define QPACK_TEST_UA_STRING 'H', '3', 'Z', 'e', 'r', 'o', '/', '1', '.', '0'
-#define QPACK_TEST_UA_STRING_LEN 10
-#define QPACK_TEST_UA_STRING_TEST 'T', 'e', 's', 't', '/', '1', '.', '0'
-#define QPACK_TEST_UA_STRING_TEST_LEN 8
-char const h3zero_test_ua_string[] = { QPACK_TEST_UA_STRING_TEST, 0 };
+/* "H3Zero/1.0" and "Test/1.0", Huffman encoded */
+#define QPACK_TEST_UA_STRING 0xc6, 0xcf, 0xe9, 0x6c, 0x3b, 0x01, 0x5c, 0x1f
+#define QPACK_TEST_UA_STRING_LEN (0x80 | 8)
+#define QPACK_TEST_UA_STRING_TEST 0xde, 0x54, 0x25, 0x80, 0xae, 0x0f
+#define QPACK_TEST_UA_STRING_TEST_LEN (0x80 | 6)
+char const h3zero_test_ua_string[] = { 'T', 'e', 's', 't', '/', '1', '.', '0', 0 };
 char const h3zero_test_ua_post_path[] = { QPACK_TEST_HEADER_DEQPACK_PATH, 0 };
 
 static uint8_t qpack_test_get_slash_ua[] = {
@@ -1105,6 +1265,706 @@ int h3zero_user_agent_test()
     return ret;
 }
 
+/* Test of the QPACK dynamic table.
+ * An encoder context prepares a series of request headers. The instructions
+ * queued for the encoder stream are passed to a decoder context one byte at
+ * a time, the header frames are parsed by the decoder, and the instructions
+ * queued for the decoder stream are passed back to the encoder.
+ */
+#define QPACK_DYNAMIC_TEST_PATH "/index.html"
+#define QPACK_DYNAMIC_TEST_HOST "api.gateway.example.com"
+#define QPACK_DYNAMIC_TEST_UA "Mozilla/5.0 (X11; Linux x86_64) H3Zero/1.0"
+
+static int qpack_dynamic_test_encoder_stream(h3zero_qpack_ctx_t* encoder, h3zero_qpack_ctx_t* decoder)
+{
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < encoder->encoder_out.length; i++) {
+        ret = h3zero_qpack_receive_encoder_stream(decoder, encoder->encoder_out.bytes + i, 1);
+    }
+    encoder->encoder_out.length = 0;
+
+    return ret;
+}
+
+static int qpack_dynamic_test_decoder_stream(h3zero_qpack_ctx_t* encoder, h3zero_qpack_ctx_t* decoder)
+{
+    int ret = h3zero_qpack_receive_decoder_stream(encoder, decoder->decoder_out.bytes, decoder->decoder_out.length);
+    decoder->decoder_out.length = 0;
+
+    return ret;
+}
+
+static uint8_t* qpack_dynamic_test_build(uint8_t* buffer, size_t buffer_size, h3zero_qpack_ctx_t* encoder,
+    uint64_t stream_id, char const* host)
+{
+    return h3zero_create_request_header_frame_qpack(buffer, buffer + buffer_size,
+        (uint8_t const*)QPACK_DYNAMIC_TEST_PATH, strlen(QPACK_DYNAMIC_TEST_PATH), NULL, 0,
+        host, QPACK_DYNAMIC_TEST_UA, encoder, stream_id);
+}
+
+static int qpack_dynamic_test_parse(uint8_t* buffer, uint8_t* bytes, h3zero_qpack_ctx_t* decoder, uint64_t stream_id)
+{
+    int ret = 0;
+    h3zero_header_parts_t parts;
+    uint8_t* parsed = h3zero_parse_qpack_header_frame_ex(buffer, bytes, decoder, stream_id, &parts);
+
+    if (parsed != bytes || parts.method != h3zero_method_get ||
+        parts.path_length != strlen(QPACK_DYNAMIC_TEST_PATH) ||
+        memcmp(parts.path, QPACK_DYNAMIC_TEST_PATH, parts.path_length) != 0) {
+        ret = -1;
+    }
+    h3zero_release_header_parts(&parts);
+
+    return ret;
+}
+
+static int qpack_dynamic_test_entry(h3zero_qpack_table_t* table, uint64_t index, http_header_enum_t header, char const* value)
+{
+    h3zero_qpack_entry_t* entry = h3zero_qpack_table_get(table, index);
+
+    return (entry == NULL || entry->header != header || entry->value_length != strlen(value) ||
+        memcmp(entry->value, value, entry->value_length) != 0) ? -1 : 0;
+}
+
+static int qpack_dynamic_test_sequence()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer[256];
+    uint8_t* bytes;
+    size_t first_length = 0;
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (uint64_t i = 0; ret == 0 && i < 8; i++) {
+        uint64_t stream_id = 4 * i;
+
+        if ((bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id, QPACK_DYNAMIC_TEST_HOST)) == NULL) {
+            DBG_PRINTF("Cannot build request %d", (int)i);
+            ret = -1;
+        }
+        else if (i == 0) {
+            /* Entries are not acknowledged yet, and the decoder does not accept blocked streams */
+            first_length = bytes - buffer;
+            if (buffer[0] != 0) {
+                DBG_PRINTF("%s", "First request references the dynamic table");
+                ret = -1;
+            }
+        }
+        else if (buffer[0] == 0 || (size_t)(bytes - buffer) >= first_length) {
+            DBG_PRINTF("Request %d does not use the dynamic table, %zu bytes vs %zu", (int)i, (size_t)(bytes - buffer), first_length);
+            ret = -1;
+        }
+
+        if (ret == 0 && (ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0) {
+            DBG_PRINTF("Encoder stream error 0x%x, request %d", ret, (int)i);
+        }
+        if (ret == 0 && (ret = qpack_dynamic_test_parse(buffer, bytes, &decoder, stream_id)) != 0) {
+            DBG_PRINTF("Cannot parse request %d", (int)i);
+        }
+        if (ret == 0 && (ret = qpack_dynamic_test_decoder_stream(&encoder, &decoder)) != 0) {
+            DBG_PRINTF("Decoder stream error 0x%x, request %d", ret, (int)i);
+        }
+    }
+
+    if (ret == 0 && (encoder.encoder_table.insert_count != 2 || decoder.decoder_table.insert_count != 2 ||
+        encoder.known_received_count != 2 || encoder.nb_sections != 0 ||
+        qpack_dynamic_test_entry(&decoder.decoder_table, 0, http_pseudo_header_authority, QPACK_DYNAMIC_TEST_HOST) != 0 ||
+        qpack_dynamic_test_entry(&decoder.decoder_table, 1, http_header_user_agent, QPACK_DYNAMIC_TEST_UA) != 0)) {
+        DBG_PRINTF("%s", "Unexpected state of the dynamic tables");
+        ret = -1;
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+/* If the peer allows one blocked stream, the first request references the
+ * new entries immediately, but a second request sent before the entries
+ * are acknowledged shall not.
+ */
+static int qpack_dynamic_test_blocked()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer_a[256];
+    uint8_t buffer_b[256];
+    uint8_t* bytes_a = NULL;
+    uint8_t* bytes_b = NULL;
+    h3zero_header_parts_t parts;
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 1) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+    else if ((bytes_a = qpack_dynamic_test_build(buffer_a, sizeof(buffer_a), &encoder, 0, QPACK_DYNAMIC_TEST_HOST)) == NULL ||
+        (bytes_b = qpack_dynamic_test_build(buffer_b, sizeof(buffer_b), &encoder, 4, QPACK_DYNAMIC_TEST_HOST)) == NULL) {
+        DBG_PRINTF("%s", "Cannot build the requests");
+        ret = -1;
+    }
+    else if (buffer_a[0] == 0 || buffer_b[0] != 0) {
+        DBG_PRINTF("Unexpected insert counts, %d and %d", buffer_a[0], buffer_b[0]);
+        ret = -1;
+    }
+    else if (h3zero_parse_qpack_header_frame_ex(buffer_a, bytes_a, &decoder, 0, &parts) != NULL) {
+        DBG_PRINTF("%s", "Blocked request parsed before the entries are received");
+        ret = -1;
+    }
+    h3zero_release_header_parts(&parts);
+
+    if (ret == 0 && ((ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0 ||
+        (ret = qpack_dynamic_test_parse(buffer_a, bytes_a, &decoder, 0)) != 0 ||
+        (ret = qpack_dynamic_test_parse(buffer_b, bytes_b, &decoder, 4)) != 0 ||
+        (ret = qpack_dynamic_test_decoder_stream(&encoder, &decoder)) != 0)) {
+        DBG_PRINTF("%s", "Cannot process the blocked requests");
+    }
+
+    if (ret == 0 && (encoder.nb_sections != 0 || encoder.known_received_count != 2)) {
+        DBG_PRINTF("%s", "Sections not acknowledged");
+        ret = -1;
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+/* With a small table, new entries cause the eviction of old ones, and the
+ * encoder and decoder tables stay synchronized.
+ */
+static int qpack_dynamic_test_eviction()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer[256];
+    uint8_t* bytes;
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, 128) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < 20; i++) {
+        char host[64];
+        uint64_t stream_id = 4 * (uint64_t)i;
+        size_t host_length = 0;
+
+        (void)picoquic_sprintf(host, sizeof(host), &host_length, "host%d.example.com", i % 5);
+
+        if ((bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id, host)) == NULL ||
+            (ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0 ||
+            (ret = qpack_dynamic_test_parse(buffer, bytes, &decoder, stream_id)) != 0 ||
+            (ret = qpack_dynamic_test_decoder_stream(&encoder, &decoder)) != 0) {
+            DBG_PRINTF("Request %d fails", i);
+            ret = -1;
+        }
+        else if (encoder.encoder_table.size > encoder.encoder_table.capacity ||
+            encoder.encoder_table.size != decoder.decoder_table.size ||
+            encoder.encoder_table.insert_count != decoder.decoder_table.insert_count ||
+            encoder.encoder_table.nb_entries != decoder.decoder_table.nb_entries) {
+            DBG_PRINTF("Tables not synchronized after request %d", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && encoder.encoder_table.insert_count <= encoder.encoder_table.nb_entries) {
+        DBG_PRINTF("%s", "No entry was evicted");
+        ret = -1;
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+/* Entries that the decoder has not acknowledged yet cannot be evicted, even
+ * if no section references them: the decoder may not have received them yet.
+ * Fill a small table before any Insert Count Increment arrives, then check that
+ * the decoder can still process the encoder stream.
+ */
+static int qpack_dynamic_test_unacked()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer[256];
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, 128) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < 8; i++) {
+        char host[64];
+        size_t host_length = 0;
+
+        (void)picoquic_sprintf(host, sizeof(host), &host_length, "host%d.example.com", i);
+        if (qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, 4 * (uint64_t)i, host) == NULL) {
+            DBG_PRINTF("Cannot build request %d", i);
+            ret = -1;
+        }
+        else if (encoder.encoder_table.insert_count != encoder.encoder_table.nb_entries) {
+            DBG_PRINTF("Unacknowledged entry evicted by request %d", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && ((ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0 ||
+        encoder.encoder_table.insert_count != decoder.decoder_table.insert_count ||
+        encoder.encoder_table.nb_entries != decoder.decoder_table.nb_entries)) {
+        DBG_PRINTF("%s", "Tables not synchronized");
+        ret = -1;
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+/* Client requests built with the connection's QPACK context refer to the
+ * entries that the peer acknowledged.
+ */
+static int qpack_dynamic_test_client()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer[256];
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (uint64_t stream_id = 0; ret == 0 && stream_id < 8; stream_id += 4) {
+        size_t consumed = 0;
+        size_t header_offset = 0;
+
+        if (h3zero_client_create_stream_request_qpack(buffer, sizeof(buffer),
+            (uint8_t const*)QPACK_DYNAMIC_TEST_PATH, strlen(QPACK_DYNAMIC_TEST_PATH), NULL, 0, 0,
+            QPACK_DYNAMIC_TEST_HOST, &consumed, &encoder, stream_id) != 0) {
+            DBG_PRINTF("Cannot build request on stream %" PRIu64, stream_id);
+            ret = -1;
+        }
+        else {
+            header_offset = ((buffer[1] & 0xC0) == 0) ? 2 : 3;
+            if ((stream_id == 0) != (buffer[header_offset] == 0)) {
+                DBG_PRINTF("Unexpected required insert count on stream %" PRIu64, stream_id);
+                ret = -1;
+            }
+            else if ((ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0 ||
+                (ret = qpack_dynamic_test_parse(buffer + header_offset, buffer + consumed, &decoder, stream_id)) != 0 ||
+                (ret = qpack_dynamic_test_decoder_stream(&encoder, &decoder)) != 0) {
+                DBG_PRINTF("Cannot process request on stream %" PRIu64, stream_id);
+                ret = -1;
+            }
+        }
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+/* Sections sent on streams that are reset are never acknowledged by the peer.
+ * Without cancellation they accumulate until H3ZERO_QPACK_MAX_SECTIONS, after
+ * which the dynamic table is not used anymore.
+ */
+static int qpack_dynamic_test_cancel()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint8_t buffer[256];
+    uint8_t* bytes = NULL;
+    uint64_t stream_id = 0;
+
+    if (h3zero_qpack_init(&encoder, 0) != 0 || h3zero_qpack_init(&decoder, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, decoder.decoder_table.max_capacity, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+    else if ((bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id, QPACK_DYNAMIC_TEST_HOST)) == NULL ||
+        (ret = qpack_dynamic_test_encoder_stream(&encoder, &decoder)) != 0 ||
+        (ret = qpack_dynamic_test_parse(buffer, bytes, &decoder, stream_id)) != 0 ||
+        (ret = qpack_dynamic_test_decoder_stream(&encoder, &decoder)) != 0) {
+        DBG_PRINTF("%s", "Cannot process the first request");
+        ret = -1;
+    }
+
+    /* Fill the section list with requests that are never acknowledged */
+    for (int i = 0; ret == 0 && i < H3ZERO_QPACK_MAX_SECTIONS; i++) {
+        stream_id += 4;
+        if ((bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id, QPACK_DYNAMIC_TEST_HOST)) == NULL ||
+            buffer[0] == 0) {
+            DBG_PRINTF("Request %d does not use the dynamic table", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && (encoder.nb_sections != H3ZERO_QPACK_MAX_SECTIONS ||
+        (bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id + 4, QPACK_DYNAMIC_TEST_HOST)) == NULL ||
+        buffer[0] != 0)) {
+        DBG_PRINTF("Expected %d pending sections, got %zu", H3ZERO_QPACK_MAX_SECTIONS, encoder.nb_sections);
+        ret = -1;
+    }
+
+    /* Reset all the streams, the dynamic table is used again */
+    for (uint64_t reset_id = 4; ret == 0 && reset_id <= stream_id; reset_id += 4) {
+        h3zero_qpack_cancel_stream(&encoder, reset_id);
+    }
+
+    if (ret == 0 && (encoder.nb_sections != 0 ||
+        (bytes = qpack_dynamic_test_build(buffer, sizeof(buffer), &encoder, stream_id + 8, QPACK_DYNAMIC_TEST_HOST)) == NULL ||
+        buffer[0] == 0 || encoder.nb_sections != 1)) {
+        DBG_PRINTF("%s", "Sections of reset streams not dropped");
+        ret = -1;
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+static int qpack_dynamic_test_errors()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t qpack;
+    h3zero_header_parts_t parts;
+    uint8_t capacity_too_large[] = { 0x3F, 0xE1, 0x3F };
+    uint8_t insert_bad_index[] = { 0x80, 0x01, 'a' };
+    uint8_t section_unknown_ref[] = { 0x02, 0x00, 0x80 };
+    uint8_t ack_unknown_stream[] = { 0x84 };
+    uint8_t increment_too_large[] = { 0x01 };
+
+    if (h3zero_qpack_init(&qpack, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0) {
+        ret = -1;
+    }
+    else if (h3zero_parse_qpack_header_frame_ex(section_unknown_ref, section_unknown_ref + sizeof(section_unknown_ref),
+        &qpack, 0, &parts) != NULL) {
+        DBG_PRINTF("%s", "Reference to missing entry not detected");
+        ret = -1;
+    }
+    h3zero_release_header_parts(&parts);
+
+    if (ret == 0 && h3zero_parse_qpack_header_frame(section_unknown_ref, section_unknown_ref + sizeof(section_unknown_ref),
+        &parts) != NULL) {
+        DBG_PRINTF("%s", "Dynamic reference accepted without dynamic table");
+        ret = -1;
+    }
+    h3zero_release_header_parts(&parts);
+
+    if (ret == 0 && h3zero_qpack_receive_encoder_stream(&qpack, capacity_too_large, sizeof(capacity_too_large)) !=
+        H3ZERO_QPACK_ENCODER_STREAM_ERROR) {
+        DBG_PRINTF("%s", "Excessive capacity not detected");
+        ret = -1;
+    }
+    h3zero_qpack_release(&qpack);
+
+    if (ret == 0 && (h3zero_qpack_init(&qpack, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_receive_encoder_stream(&qpack, insert_bad_index, sizeof(insert_bad_index)) !=
+        H3ZERO_QPACK_ENCODER_STREAM_ERROR)) {
+        DBG_PRINTF("%s", "Insertion with bad name reference not detected");
+        ret = -1;
+    }
+    h3zero_qpack_release(&qpack);
+
+    if (ret == 0 && (h3zero_qpack_init(&qpack, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_receive_decoder_stream(&qpack, ack_unknown_stream, sizeof(ack_unknown_stream)) !=
+        H3ZERO_QPACK_DECODER_STREAM_ERROR)) {
+        DBG_PRINTF("%s", "Acknowledgement of unknown section not detected");
+        ret = -1;
+    }
+    h3zero_qpack_release(&qpack);
+
+    if (ret == 0 && (h3zero_qpack_init(&qpack, H3ZERO_QPACK_DEFAULT_TABLE_CAPACITY) != 0 ||
+        h3zero_qpack_receive_decoder_stream(&qpack, increment_too_large, sizeof(increment_too_large)) !=
+        H3ZERO_QPACK_DECODER_STREAM_ERROR)) {
+        DBG_PRINTF("%s", "Excessive insert count increment not detected");
+        ret = -1;
+    }
+    h3zero_qpack_release(&qpack);
+
+    return ret;
+}
+
+int h3zero_qpack_dynamic_test()
+{
+    int ret = qpack_dynamic_test_sequence();
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_blocked();
+    }
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_eviction();
+    }
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_unacked();
+    }
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_client();
+    }
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_cancel();
+    }
+
+    if (ret == 0) {
+        ret = qpack_dynamic_test_errors();
+    }
+
+    return ret;
+}
+
+/* Test of the cache of open files used by the server.
+ * Streams requesting the same file share the same entry, released entries
+ * are kept open up to the limit, and files that change on disk are reopened.
+ */
+#define FILE_CACHE_TEST_NB_FILES 3
+#define FILE_CACHE_TEST_LENGTH 5000
+
+static int file_cache_test_write(char const* file_name, size_t length, uint8_t seed)
+{
+    int ret = 0;
+    FILE* F = picoquic_file_open(file_name, "wb");
+
+    if (F == NULL) {
+        ret = -1;
+    }
+    else {
+        for (size_t i = 0; ret == 0 && i < length; i++) {
+            if (fputc((uint8_t)(seed + i * 7), F) == EOF) {
+                ret = -1;
+            }
+        }
+        (void)picoquic_file_close(F);
+    }
+
+    return ret;
+}
+
+static int file_cache_test_check(h3zero_file_entry_t* entry, size_t length, uint8_t seed)
+{
+    int ret = 0;
+    uint8_t buffer[1024];
+
+    if (entry == NULL || entry->file_length != length) {
+        ret = -1;
+    }
+
+    for (size_t offset = 0; ret == 0 && offset < length; offset += sizeof(buffer)) {
+        size_t chunk = (length - offset > sizeof(buffer)) ? sizeof(buffer) : length - offset;
+
+        if (h3zero_file_entry_read(entry, offset, buffer, chunk) != 0) {
+            ret = -1;
+        }
+        for (size_t i = 0; ret == 0 && i < chunk; i++) {
+            if (buffer[i] != (uint8_t)(seed + (offset + i) * 7)) {
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0 && h3zero_file_entry_read(entry, length - 10, buffer, 11) == 0) {
+        /* Reading past the end of file shall fail */
+        ret = -1;
+    }
+
+    return ret;
+}
+
+static int file_cache_test_one(int use_mmap)
+{
+    int ret = 0;
+    char const* file_names[FILE_CACHE_TEST_NB_FILES] = {
+        "h3zero_file_cache_test_0.bin", "h3zero_file_cache_test_1.bin", "h3zero_file_cache_test_2.bin" };
+    h3zero_file_entry_t* entries[FILE_CACHE_TEST_NB_FILES] = { NULL, NULL, NULL };
+    h3zero_file_entry_t* shared = NULL;
+    h3zero_file_cache_t* cache = h3zero_file_cache_create(2, use_mmap);
+
+    if (cache == NULL) {
+        DBG_PRINTF("%s", "Cannot create file cache");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < FILE_CACHE_TEST_NB_FILES; i++) {
+        ret = file_cache_test_write(file_names[i], FILE_CACHE_TEST_LENGTH + i, (uint8_t)i);
+    }
+
+    /* Two streams requesting the same file share the entry */
+    if (ret == 0) {
+        entries[0] = h3zero_file_cache_open(cache, file_names[0]);
+        shared = h3zero_file_cache_open(cache, file_names[0]);
+        if (entries[0] == NULL || shared != entries[0] || entries[0]->ref_count != 2 || cache->nb_open_files != 1 ||
+            file_cache_test_check(entries[0], FILE_CACHE_TEST_LENGTH, 0) != 0) {
+            DBG_PRINTF("%s", "Shared entry not found");
+            ret = -1;
+        }
+        if (shared != NULL) {
+            h3zero_file_cache_release(shared);
+        }
+    }
+
+    /* All entries in use stay open, even above the limit */
+    for (int i = 1; ret == 0 && i < FILE_CACHE_TEST_NB_FILES; i++) {
+        entries[i] = h3zero_file_cache_open(cache, file_names[i]);
+        if (file_cache_test_check(entries[i], FILE_CACHE_TEST_LENGTH + i, (uint8_t)i) != 0) {
+            DBG_PRINTF("Cannot read file %d", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && cache->nb_open_files != FILE_CACHE_TEST_NB_FILES) {
+        DBG_PRINTF("Expected %d open files, got %zu", FILE_CACHE_TEST_NB_FILES, cache->nb_open_files);
+        ret = -1;
+    }
+
+    /* Released entries are closed in LRU order when above the limit */
+    for (int i = 0; i < FILE_CACHE_TEST_NB_FILES; i++) {
+        if (entries[i] != NULL) {
+            h3zero_file_cache_release(entries[i]);
+            entries[i] = NULL;
+        }
+    }
+
+    if (ret == 0 && (cache->nb_open_files != 2 || cache->lru_first == NULL ||
+        strcmp(cache->lru_first->file_path, file_names[1]) != 0)) {
+        DBG_PRINTF("%s", "Unexpected LRU state");
+        ret = -1;
+    }
+
+    /* Reopening a cached file does not open a new descriptor */
+    if (ret == 0) {
+        entries[2] = h3zero_file_cache_open(cache, file_names[2]);
+        if (entries[2] == NULL || cache->nb_open_files != 2 || cache->lru_first == entries[2]) {
+            DBG_PRINTF("%s", "Cached file was not reused");
+            ret = -1;
+        }
+    }
+
+    /* A file that changed on disk is reopened, the old entry remains valid until released */
+    if (ret == 0 && (ret = file_cache_test_write(file_names[2], 2 * FILE_CACHE_TEST_LENGTH, 0x55)) == 0) {
+        h3zero_file_entry_t* updated = h3zero_file_cache_open(cache, file_names[2]);
+
+        if (updated == NULL || updated == entries[2] || !entries[2]->is_stale ||
+            file_cache_test_check(updated, 2 * FILE_CACHE_TEST_LENGTH, 0x55) != 0) {
+            DBG_PRINTF("%s", "Updated file not reopened");
+            ret = -1;
+        }
+        if (updated != NULL) {
+            h3zero_file_cache_release(updated);
+        }
+    }
+
+    if (entries[2] != NULL) {
+        h3zero_file_cache_release(entries[2]);
+    }
+
+    if (ret == 0 && h3zero_file_cache_open(cache, "h3zero_file_cache_test_none.bin") != NULL) {
+        DBG_PRINTF("%s", "Missing file not detected");
+        ret = -1;
+    }
+
+    if (ret == 0 && cache->nb_open_files > cache->max_open_files) {
+        DBG_PRINTF("Too many files left open: %zu", cache->nb_open_files);
+        ret = -1;
+    }
+
+    if (cache != NULL) {
+        h3zero_file_cache_delete(cache);
+    }
+
+    for (int i = 0; i < FILE_CACHE_TEST_NB_FILES; i++) {
+        (void)remove(file_names[i]);
+    }
+
+    return ret;
+}
+
+/* A cache created with a maximum of zero, as used per connection when the
+ * server does not provide a shared cache, keeps no idle file open.
+ */
+static int file_cache_test_no_idle()
+{
+    int ret = 0;
+    char const* file_name = "h3zero_file_cache_test_idle.bin";
+    h3zero_file_entry_t* entry = NULL;
+    h3zero_file_entry_t* shared = NULL;
+    h3zero_file_cache_t* cache = h3zero_file_cache_create(0, 1);
+
+    if (cache == NULL) {
+        DBG_PRINTF("%s", "Cannot create file cache");
+        ret = -1;
+    }
+    else if ((ret = file_cache_test_write(file_name, FILE_CACHE_TEST_LENGTH, 7)) == 0) {
+        entry = h3zero_file_cache_open(cache, file_name);
+        shared = h3zero_file_cache_open(cache, file_name);
+        if (entry == NULL || shared != entry || cache->nb_open_files != 1 ||
+            file_cache_test_check(entry, FILE_CACHE_TEST_LENGTH, 7) != 0) {
+            DBG_PRINTF("%s", "Concurrent streams do not share the entry");
+            ret = -1;
+        }
+        if (shared != NULL) {
+            h3zero_file_cache_release(shared);
+        }
+        if (ret == 0 && cache->nb_open_files != 1) {
+            DBG_PRINTF("%s", "File in use was closed");
+            ret = -1;
+        }
+        if (entry != NULL) {
+            h3zero_file_cache_release(entry);
+        }
+        if (ret == 0 && (cache->nb_open_files != 0 || cache->lru_first != NULL)) {
+            DBG_PRINTF("Idle files left open: %zu", cache->nb_open_files);
+            ret = -1;
+        }
+    }
+
+    if (cache != NULL) {
+        h3zero_file_cache_delete(cache);
+    }
+    (void)remove(file_name);
+
+    return ret;
+}
+
+int h3zero_file_cache_test()
+{
+    int ret = file_cache_test_one(0);
+
+    if (ret == 0) {
+        ret = file_cache_test_one(1);
+    }
+
+    if (ret == 0) {
+        ret = file_cache_test_no_idle();
+    }
+
+    return ret;
+}
+
 int h3zero_null_sni_test()
 {
     int ret = 0;
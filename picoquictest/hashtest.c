@@ -200,3 +200,200 @@ int picohash_embedded_test()
 {
     return(picohash_test_one(1));
 }
+
+/* Check that the table keeps working when it grows far beyond the initial
+ * sizing hint, including deletions while the incremental migration is
+ * in progress. */
+#define HASHTEST_GROW_NB_KEYS 20000
+
+int picohash_grow_test()
+{
+    int ret = 0;
+    struct hashtestkey* keys = (struct hashtestkey*)malloc(sizeof(struct hashtestkey) * HASHTEST_GROW_NB_KEYS);
+    picohash_table* t = picohash_create_ex(4, hashtest_hash, hashtest_compare, hashtest_key_to_item);
+
+    if (keys == NULL || t == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the hash table or the keys\n");
+        ret = -1;
+    }
+    else {
+        struct hashtestkey hk;
+        size_t nb_deleted = 0;
+
+        memset(keys, 0, sizeof(struct hashtestkey) * HASHTEST_GROW_NB_KEYS);
+        /* Use multiples of 32 to create many collisions in the low order bits */
+        for (size_t i = 0; ret == 0 && i < HASHTEST_GROW_NB_KEYS; i++) {
+            keys[i].x = 32 * (uint64_t)i + 1;
+            if (picohash_insert(t, &keys[i]) != 0) {
+                DBG_PRINTF("picohash_insert(%"PRIst") failed\n", i);
+                ret = -1;
+            }
+            else if ((i % 3) == 2) {
+                /* Delete one of the recent items, which may not be migrated yet */
+                hk.x = keys[i - 1].x;
+                picohash_delete_key(t, &hk, 0);
+                nb_deleted++;
+            }
+        }
+
+        if (ret == 0 && t->count != HASHTEST_GROW_NB_KEYS - nb_deleted) {
+            DBG_PRINTF("picohash table count %"PRIst", expected %"PRIst"\n", t->count, HASHTEST_GROW_NB_KEYS - nb_deleted);
+            ret = -1;
+        }
+
+        if (ret == 0 && t->nb_slots < t->count) {
+            DBG_PRINTF("picohash table did not grow, %"PRIst" slots for %"PRIst" items\n", t->nb_slots, t->count);
+            ret = -1;
+        }
+
+        for (size_t i = 0; ret == 0 && i < HASHTEST_GROW_NB_KEYS; i++) {
+            picohash_item* pi;
+            hk.x = keys[i].x;
+            pi = picohash_retrieve(t, &hk);
+
+            if ((i % 3) == 1 && i + 1 < HASHTEST_GROW_NB_KEYS) {
+                if (pi != NULL) {
+                    DBG_PRINTF("picohash_retrieve(%"PRIst") deleted value still found\n", i);
+                    ret = -1;
+                }
+            }
+            else if (pi == NULL || pi->key != &keys[i]) {
+                DBG_PRINTF("picohash_retrieve(%"PRIst") failed\n", i);
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            size_t cursor = 0;
+            size_t nb_items = 0;
+
+            while (picohash_next_item(t, &cursor) != NULL) {
+                nb_items++;
+            }
+            if (nb_items != t->count) {
+                DBG_PRINTF("picohash iteration found %"PRIst" items, expected %"PRIst"\n", nb_items, t->count);
+                ret = -1;
+            }
+        }
+    }
+
+    if (t != NULL) {
+        picohash_delete(t, 0);
+    }
+    if (keys != NULL) {
+        free(keys);
+    }
+
+    return ret;
+}
+
+/* Micro benchmark, comparing the open addressing table to the chained bins
+ * that picohash used before. Both are sized for 32 bins, as in the basic
+ * test, then loaded with many more items, which is what happens to the
+ * connection tables when max_nb_connections is set low. The timings are
+ * only reported; the test fails if the two tables disagree. */
+#define HASHTEST_BENCH_NB_KEYS 16384
+#define HASHTEST_BENCH_NB_BINS 32
+
+typedef struct st_hashtest_chained_t {
+    struct st_hashtest_chained_t* next_in_bin;
+    uint64_t hash;
+    const void* key;
+} hashtest_chained_t;
+
+static int hashtest_chained_insert(hashtest_chained_t** bins, hashtest_chained_t* item, const void* key)
+{
+    uint64_t hash = hashtest_hash(key);
+    uint32_t bin = (uint32_t)(hash % HASHTEST_BENCH_NB_BINS);
+
+    item->hash = hash;
+    item->key = key;
+    item->next_in_bin = bins[bin];
+    bins[bin] = item;
+
+    return 0;
+}
+
+static const void* hashtest_chained_retrieve(hashtest_chained_t** bins, const void* key)
+{
+    uint64_t hash = hashtest_hash(key);
+    uint32_t bin = (uint32_t)(hash % HASHTEST_BENCH_NB_BINS);
+    hashtest_chained_t* item = bins[bin];
+
+    while (item != NULL && hashtest_compare(key, item->key) != 0) {
+        item = item->next_in_bin;
+    }
+
+    return (item == NULL) ? NULL : item->key;
+}
+
+int picohash_bench_test()
+{
+    int ret = 0;
+    hashtest_chained_t* bins[HASHTEST_BENCH_NB_BINS];
+    hashtest_chained_t* chained = (hashtest_chained_t*)malloc(sizeof(hashtest_chained_t) * HASHTEST_BENCH_NB_KEYS);
+    struct hashtestkey* keys = (struct hashtestkey*)malloc(sizeof(struct hashtestkey) * HASHTEST_BENCH_NB_KEYS);
+    picohash_table* t = picohash_create_ex(HASHTEST_BENCH_NB_BINS, hashtest_hash, hashtest_compare, hashtest_key_to_item);
+
+    memset(bins, 0, sizeof(bins));
+
+    if (chained == NULL || keys == NULL || t == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the benchmark tables\n");
+        ret = -1;
+    }
+    else {
+        uint64_t chained_time;
+        uint64_t open_time;
+        uint64_t time_start;
+        struct hashtestkey hk;
+
+        memset(keys, 0, sizeof(struct hashtestkey) * HASHTEST_BENCH_NB_KEYS);
+        for (size_t i = 0; i < HASHTEST_BENCH_NB_KEYS; i++) {
+            keys[i].x = 7 * (uint64_t)i + 1;
+        }
+
+        time_start = picoquic_current_time();
+        for (size_t i = 0; ret == 0 && i < HASHTEST_BENCH_NB_KEYS; i++) {
+            ret = hashtest_chained_insert(bins, &chained[i], &keys[i]);
+        }
+        /* Look up every key, then as many absent keys */
+        for (uint64_t x = 0; ret == 0 && x < 14 * (uint64_t)HASHTEST_BENCH_NB_KEYS; x++) {
+            hk.x = x;
+            if ((hashtest_chained_retrieve(bins, &hk) != NULL) != ((x % 7) == 1 && x < 7 * (uint64_t)HASHTEST_BENCH_NB_KEYS)) {
+                DBG_PRINTF("Chained table, unexpected lookup result for %" PRIu64 "\n", x);
+                ret = -1;
+            }
+        }
+        chained_time = picoquic_current_time() - time_start;
+
+        time_start = picoquic_current_time();
+        for (size_t i = 0; ret == 0 && i < HASHTEST_BENCH_NB_KEYS; i++) {
+            ret = picohash_insert(t, &keys[i]);
+        }
+        for (uint64_t x = 0; ret == 0 && x < 14 * (uint64_t)HASHTEST_BENCH_NB_KEYS; x++) {
+            hk.x = x;
+            if ((picohash_retrieve(t, &hk) != NULL) != ((x % 7) == 1 && x < 7 * (uint64_t)HASHTEST_BENCH_NB_KEYS)) {
+                DBG_PRINTF("Open table, unexpected lookup result for %" PRIu64 "\n", x);
+                ret = -1;
+            }
+        }
+        open_time = picoquic_current_time() - time_start;
+
+        if (ret == 0) {
+            DBG_PRINTF("Hash benchmark, %d keys: chained bins %" PRIu64 " us, open addressing %" PRIu64 " us\n",
+                HASHTEST_BENCH_NB_KEYS, chained_time, open_time);
+        }
+    }
+
+    if (t != NULL) {
+        picohash_delete(t, 0);
+    }
+    if (keys != NULL) {
+        free(keys);
+    }
+    if (chained != NULL) {
+        free(chained);
+    }
+
+    return ret;
+}
@@ -0,0 +1,337 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2026, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoheap.h"
+#include "picosplay.h"
+#include "picoquictest_internal.h"
+
+typedef struct st_heaptest_node_t {
+    uint64_t wake_time;
+    picoheap_node_t heap_node;
+    picosplay_node_t splay_node;
+} heaptest_node_t;
+
+static heaptest_node_t* heaptest_heap_node_value(picoheap_node_t* heap_node)
+{
+    return (heap_node == NULL) ? NULL :
+        (heaptest_node_t*)((char*)heap_node - offsetof(struct st_heaptest_node_t, heap_node));
+}
+
+/* Verify that every entry is consistent with its node, and not smaller than its parent */
+static int heaptest_check(picoheap_t* heap)
+{
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < heap->size; i++) {
+        heaptest_node_t* node = heaptest_heap_node_value(heap->entries[i].node);
+
+        if (node->heap_node.index != i + 1 || node->wake_time != heap->entries[i].key) {
+            DBG_PRINTF("Inconsistent heap entry %" PRIst, i);
+            ret = -1;
+        }
+        else if (i > 0 && heap->entries[(i - 1) / 4].key > heap->entries[i].key) {
+            DBG_PRINTF("Heap entry %" PRIst " is smaller than its parent", i);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+#define HEAPTEST_NB_NODES 1000
+
+int picoheap_test()
+{
+    int ret = 0;
+    picoheap_t heap;
+    heaptest_node_t* nodes = (heaptest_node_t*)malloc(sizeof(heaptest_node_t) * HEAPTEST_NB_NODES);
+    uint64_t random_ctx = 0xdeadbeefbaadf00dull;
+
+    picoheap_init(&heap);
+
+    if (nodes == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(nodes, 0, sizeof(heaptest_node_t) * HEAPTEST_NB_NODES);
+        /* Insert all the nodes, with many duplicate keys */
+        for (int i = 0; ret == 0 && i < HEAPTEST_NB_NODES; i++) {
+            nodes[i].wake_time = picoquic_test_random(&random_ctx) % 500;
+            ret = picoheap_insert(&heap, &nodes[i].heap_node, nodes[i].wake_time);
+        }
+        if (ret == 0 && (heap.size != HEAPTEST_NB_NODES || heaptest_check(&heap) != 0)) {
+            ret = -1;
+        }
+        /* Update half of the nodes, and remove a quarter */
+        for (int i = 0; ret == 0 && i < HEAPTEST_NB_NODES; i += 2) {
+            nodes[i].wake_time = picoquic_test_random(&random_ctx) % 500;
+            picoheap_update(&heap, &nodes[i].heap_node, nodes[i].wake_time);
+            if ((i % 4) == 0) {
+                picoheap_remove(&heap, &nodes[i + 1].heap_node);
+                if (picoheap_is_in_heap(&nodes[i + 1].heap_node)) {
+                    ret = -1;
+                }
+            }
+        }
+        if (ret == 0 && (heap.size != HEAPTEST_NB_NODES - HEAPTEST_NB_NODES / 4 || heaptest_check(&heap) != 0)) {
+            DBG_PRINTF("Heap size %" PRIst " after updates and removals", heap.size);
+            ret = -1;
+        }
+        /* Removing a node that is not in the heap has no effect */
+        if (ret == 0) {
+            picoheap_remove(&heap, &nodes[1].heap_node);
+            if (heap.size != HEAPTEST_NB_NODES - HEAPTEST_NB_NODES / 4) {
+                ret = -1;
+            }
+        }
+        /* Pop all the nodes, in order */
+        if (ret == 0) {
+            uint64_t previous_time = 0;
+            size_t nb_popped = 0;
+            picoheap_node_t* first;
+
+            while (ret == 0 && (first = picoheap_first(&heap)) != NULL) {
+                heaptest_node_t* node = heaptest_heap_node_value(first);
+
+                if (node->wake_time < previous_time || picoheap_first_key(&heap) != node->wake_time) {
+                    DBG_PRINTF("Node %" PRIst " popped out of order", nb_popped);
+                    ret = -1;
+                }
+                previous_time = node->wake_time;
+                picoheap_remove(&heap, first);
+                nb_popped++;
+                if (nb_popped % 64 == 0) {
+                    ret = heaptest_check(&heap);
+                }
+            }
+            if (ret == 0 && (nb_popped != HEAPTEST_NB_NODES - HEAPTEST_NB_NODES / 4 ||
+                picoheap_first_key(&heap) != UINT64_MAX)) {
+                ret = -1;
+            }
+        }
+    }
+
+    picoheap_clear(&heap);
+    if (nodes != NULL) {
+        free(nodes);
+    }
+
+    return ret;
+}
+
+/* Benchmark the wake scheduling structures with a large number of connections.
+ * Each step wakes up the first connection and reschedules it a little later,
+ * as the packet loop does, and also reschedules a random connection, as happens
+ * when a packet is received. The wake times are made unique by encoding the
+ * connection index in the low order part, so that both structures process
+ * exactly the same sequence.
+ */
+#define HEAPTEST_BENCH_NB_CNX 1000000
+#define HEAPTEST_BENCH_NB_STEPS 200000
+#define HEAPTEST_BENCH_MAX_DELAY 100000
+
+static void* heaptest_splay_node_value(picosplay_node_t* splay_node)
+{
+    return (splay_node == NULL) ? NULL : (void*)((char*)splay_node - offsetof(struct st_heaptest_node_t, splay_node));
+}
+
+static int64_t heaptest_splay_compare(void* l, void* r)
+{
+    const uint64_t ltime = ((heaptest_node_t*)l)->wake_time;
+    const uint64_t rtime = ((heaptest_node_t*)r)->wake_time;
+    if (ltime < rtime) return -1;
+    if (ltime > rtime) return 1;
+    return 0;
+}
+
+static picosplay_node_t* heaptest_splay_create(void* value)
+{
+    return &((heaptest_node_t*)value)->splay_node;
+}
+
+static void heaptest_splay_delete(void* tree, picosplay_node_t* node)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(tree);
+#endif
+    memset(node, 0, sizeof(picosplay_node_t));
+}
+
+int picoheap_bench_test()
+{
+    int ret = 0;
+    heaptest_node_t* nodes = (heaptest_node_t*)malloc(sizeof(heaptest_node_t) * HEAPTEST_BENCH_NB_CNX);
+    picoheap_t heap;
+    picosplay_tree_t tree;
+
+    picoheap_init(&heap);
+    picosplay_init_tree(&tree, heaptest_splay_compare, heaptest_splay_create, heaptest_splay_delete, heaptest_splay_node_value);
+
+    if (nodes == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the benchmark nodes\n");
+        ret = -1;
+    }
+    else {
+        uint64_t splay_time;
+        uint64_t heap_time;
+        uint64_t time_start;
+        uint64_t random_ctx = 0x0123456789abcdefull;
+        uint64_t splay_checksum = 0;
+        uint64_t heap_checksum = 0;
+
+        memset(nodes, 0, sizeof(heaptest_node_t) * HEAPTEST_BENCH_NB_CNX);
+
+        time_start = picoquic_current_time();
+        for (size_t i = 0; i < HEAPTEST_BENCH_NB_CNX; i++) {
+            nodes[i].wake_time = (picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_MAX_DELAY) * HEAPTEST_BENCH_NB_CNX + i;
+            picosplay_insert(&tree, &nodes[i]);
+        }
+        for (size_t i = 0; i < HEAPTEST_BENCH_NB_STEPS; i++) {
+            heaptest_node_t* first = (heaptest_node_t*)heaptest_splay_node_value(picosplay_first(&tree));
+            heaptest_node_t* other = &nodes[picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_NB_CNX];
+
+            splay_checksum += first->wake_time;
+            picosplay_delete_hint(&tree, &first->splay_node);
+            first->wake_time += (1 + picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_MAX_DELAY) * HEAPTEST_BENCH_NB_CNX;
+            picosplay_insert(&tree, first);
+            picosplay_delete_hint(&tree, &other->splay_node);
+            other->wake_time = (first->wake_time / HEAPTEST_BENCH_NB_CNX - 1) * HEAPTEST_BENCH_NB_CNX + (other - nodes);
+            picosplay_insert(&tree, other);
+        }
+        splay_time = picoquic_current_time() - time_start;
+        picosplay_empty_tree(&tree);
+
+        /* Same sequence, with the heap */
+        random_ctx = 0x0123456789abcdefull;
+        time_start = picoquic_current_time();
+        if (picoheap_reserve(&heap, HEAPTEST_BENCH_NB_CNX) != 0) {
+            ret = -1;
+        }
+        for (size_t i = 0; ret == 0 && i < HEAPTEST_BENCH_NB_CNX; i++) {
+            nodes[i].wake_time = (picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_MAX_DELAY) * HEAPTEST_BENCH_NB_CNX + i;
+            ret = picoheap_insert(&heap, &nodes[i].heap_node, nodes[i].wake_time);
+        }
+        for (size_t i = 0; ret == 0 && i < HEAPTEST_BENCH_NB_STEPS; i++) {
+            heaptest_node_t* first = heaptest_heap_node_value(picoheap_first(&heap));
+            heaptest_node_t* other = &nodes[picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_NB_CNX];
+
+            heap_checksum += first->wake_time;
+            first->wake_time += (1 + picoquic_test_random(&random_ctx) % HEAPTEST_BENCH_MAX_DELAY) * HEAPTEST_BENCH_NB_CNX;
+            picoheap_update(&heap, &first->heap_node, first->wake_time);
+            other->wake_time = (first->wake_time / HEAPTEST_BENCH_NB_CNX - 1) * HEAPTEST_BENCH_NB_CNX + (other - nodes);
+            picoheap_update(&heap, &other->heap_node, other->wake_time);
+        }
+        heap_time = picoquic_current_time() - time_start;
+
+        if (ret == 0 && heap_checksum != splay_checksum) {
+            DBG_PRINTF("Heap and splay disagree on wake times, %" PRIu64 " vs %" PRIu64, heap_checksum, splay_checksum);
+            ret = -1;
+        }
+        if (ret == 0) {
+            DBG_PRINTF("Wake scheduling benchmark, %d connections, %d steps: splay %" PRIu64 " us, heap %" PRIu64 " us\n",
+                HEAPTEST_BENCH_NB_CNX, HEAPTEST_BENCH_NB_STEPS, splay_time, heap_time);
+        }
+    }
+
+    picoheap_clear(&heap);
+    if (nodes != NULL) {
+        free(nodes);
+    }
+
+    return ret;
+}
+
+/* Verify that connections are woken in the same order with either scheduler,
+ * and when switching from one scheduler to the other.
+ */
+#define WAKE_SCHEDULER_NB_CNX 16
+
+int wake_scheduler_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = picoquic_create(WAKE_SCHEDULER_NB_CNX, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time, &simulated_time, NULL, NULL, 0);
+    picoquic_cnx_t* cnx[WAKE_SCHEDULER_NB_CNX];
+    struct sockaddr_storage addr;
+
+    memset(cnx, 0, sizeof(cnx));
+
+    if (quic == NULL || picoquic_set_wake_scheduler(quic, picoquic_wake_scheduler_heap) != 0) {
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < WAKE_SCHEDULER_NB_CNX; i++) {
+        if ((ret = picoquic_store_text_addr(&addr, "10.0.0.1", (uint16_t)(1000 + i))) == 0 &&
+            (cnx[i] = picoquic_create_client_cnx(quic, (struct sockaddr*)&addr, simulated_time, 0,
+                PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, NULL, NULL)) == NULL) {
+            ret = -1;
+        }
+    }
+
+    for (int pass = 0; ret == 0 && pass < 2; pass++) {
+        if (pass == 1) {
+            /* Switch to the splay, which should find the same order */
+            ret = picoquic_set_wake_scheduler(quic, picoquic_wake_scheduler_splay);
+        }
+        for (int i = 0; ret == 0 && i < WAKE_SCHEDULER_NB_CNX; i++) {
+            picoquic_reinsert_by_wake_time(quic, cnx[i], 1000 + ((7 * (uint64_t)i + 3 * pass) % WAKE_SCHEDULER_NB_CNX) * 10);
+        }
+        for (int i = 0; ret == 0 && i < WAKE_SCHEDULER_NB_CNX; i++) {
+            picoquic_cnx_t* first = picoquic_get_earliest_cnx_to_wake(quic, 0);
+            uint64_t expected_time = 1000 + 10 * (uint64_t)i;
+
+            if (first == NULL || first->next_wake_time != expected_time ||
+                picoquic_get_next_wake_time(quic, 0) != expected_time ||
+                picoquic_get_earliest_cnx_to_wake(quic, expected_time - 1) != NULL) {
+                DBG_PRINTF("Pass %d, unexpected connection at rank %d", pass, i);
+                ret = -1;
+            }
+            else {
+                /* Send the connection to the end of the queue */
+                picoquic_reinsert_by_wake_time(quic, first, UINT64_MAX);
+            }
+        }
+    }
+
+    /* Deleting connections removes them from the heap */
+    if (ret == 0 && (ret = picoquic_set_wake_scheduler(quic, picoquic_wake_scheduler_heap)) == 0) {
+        picoquic_reinsert_by_wake_time(quic, cnx[0], 10);
+        picoquic_reinsert_by_wake_time(quic, cnx[1], 20);
+        picoquic_delete_cnx(cnx[0]);
+        if (picoquic_get_earliest_cnx_to_wake(quic, 0) != cnx[1] ||
+            quic->cnx_wake_heap.size != WAKE_SCHEDULER_NB_CNX - 1) {
+            ret = -1;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
@@ -40,8 +40,14 @@ int util_connection_id_parse_test();
 int util_sprintf_test();
 int util_memcmp_test();
 int util_threading_test();
+int util_mpsc_test();
 int picohash_test();
 int picohash_embedded_test();
+int picohash_grow_test();
+int picohash_bench_test();
+int picoheap_test();
+int picoheap_bench_test();
+int wake_scheduler_test();
 int bytestream_test();
 int create_cnx_test();
 int create_quic_test();
@@ -62,6 +68,7 @@ int tls_api_connect_test();
 #endif
 int tls_api_test();
 int tls_api_inject_hs_ack_test();
+int async_sign_test();
 int tls_api_silence_test();
 int tls_api_loss_test(uint64_t mask);
 int tls_api_client_first_loss_test();
@@ -109,6 +116,10 @@ int skip_frame_test();
 int keep_alive_test();
 int logger_test();
 int binlog_test();
+int binlog_index_test();
+int binlog_async_test();
+int qlog_multi_test();
+int picolog_batch_test();
 int app_message_overflow_test();
 int socket_test();
 int test_stateless_blowback();
@@ -136,6 +147,8 @@ int mtu_drop_newreno_test();
 int spurious_retransmit_test();
 int pn_ctr_test();
 int cleartext_pn_enc_test();
+int packet_mask_test();
+int header_mask_batch_test();
 int pn_enc_1rtt_test();
 int tls_zero_share_test();
 int transport_param_log_test();
@@ -175,6 +188,8 @@ int cnx_stress_unit_test();
 int cnx_stress_do_test(uint64_t duration, int nb_clients, int do_report);
 int cnx_ddos_unit_test();
 int cnx_ddos_test_loop(int nb_connections, uint64_t ddos_interval, const char* qlogdir);
+int initial_flood_test();
+int initial_flood_prefixes_test();
 int sockloop_basic_test();
 int sockloop_eio_test();
 int sockloop_errsock_test();
@@ -183,6 +198,12 @@ int sockloop_migration_test();
 int sockloop_nat_test();
 int sockloop_thread_test();
 int sockloop_thread_name_test();
+int sockloop_thread_command_test();
+int sockloop_recv_batch_test();
+int sockloop_recv_gro_test();
+int sockloop_send_batch_test();
+int sockloop_shard_cid_test();
+int sockloop_sharded_server_test();
 int splay_test();
 int TlsStreamFrameTest();
 int draft17_vector_test();
@@ -203,6 +224,7 @@ int transmit_cnxid_retire_disable_test();
 int transmit_cnxid_retire_early_test();
 int probe_api_test();
 int migration_test();
+int cnx_attach_test();
 int migration_test_long(); 
 int migration_test_loss();
 int migration_zero_test();
@@ -210,6 +232,8 @@ int migration_fail_test();
 int cnxid_renewal_test();
 int retire_cnxid_test();
 int server_busy_test();
+int memory_budget_test();
+int quic_metrics_test();
 int initial_close_test();
 int fuzz_initial_test();
 int new_rotated_key_test();
@@ -294,9 +318,13 @@ int h3zero_varint_stream_test();
 int h3zero_incoming_unidir_test();
 int qpack_huffman_test();
 int qpack_huffman_base_test();
+int qpack_huffman_encode_test();
+int qpack_huffman_bench_test();
 int h3zero_parse_qpack_test();
 int h3zero_prepare_qpack_test();
 int h3zero_user_agent_test();
+int h3zero_qpack_dynamic_test();
+int h3zero_file_cache_test();
 int h3zero_uri_test();
 int h3zero_null_sni_test();
 int h3zero_qpack_fuzz_test();
@@ -328,12 +356,17 @@ int bad_coalesce_test();
 int bad_cnxid_test();
 int stream_splay_test();
 int stream_output_test();
+int stream_ready_queue_test();
 int stream_rank_test();
 int provide_stream_buffer_test();
 int not_before_cnxid_test();
 int send_stream_blocked_test();
+int stream_owned_test();
+int compact_retransmit_test();
+int pending_ring_test();
 int stream_ack_test();
 int queue_network_input_test();
+int queue_network_fragments_test();
 int fastcc_test();
 int fastcc_jitter_test();
 int bbr_test();
@@ -29,6 +29,8 @@
 #include "picoquic_binlog.h"
 #include "picoquic_logger.h"
 #include "qlog.h"
+#include "picoquic_unified_log.h"
+#include "logbatch.h"
 
 /*
  * Test of the skip frame API.
@@ -1065,6 +1067,126 @@ int parse_frame_0rtt_test(picoquic_quic_t* qclient, struct sockaddr* saddr, uint
 }
 
 
+/* Only PADDING, PING, ACK, CRYPTO and CONNECTION_CLOSE are allowed in Initial
+ * and Handshake packets. Other frames shall cause a protocol violation. */
+int parse_frame_handshake_test(picoquic_quic_t* qclient, struct sockaddr* saddr, uint64_t simulated_time,
+    uint8_t* buffer, size_t buffer_size)
+{
+    int ret = 0;
+
+    for (int epoch = picoquic_epoch_initial; ret == 0 && epoch <= picoquic_epoch_handshake; epoch += 2) {
+        for (size_t i = 0; ret == 0 && i < nb_test_skip_list; i++) {
+            uint64_t frame_type = 0;
+            if (picoquic_frames_varint_decode(test_skip_list[i].val, test_skip_list[i].val + test_skip_list[i].len, &frame_type) != NULL) {
+                int ack_needed = 0;
+                uint64_t err = 0;
+                size_t len = test_skip_list[i].len;
+                int l_ret = 0;
+
+                switch (frame_type) {
+                case picoquic_frame_type_padding:
+                case picoquic_frame_type_ping:
+                case picoquic_frame_type_ack:
+                case picoquic_frame_type_ack_ecn:
+                case picoquic_frame_type_crypto_hs:
+                case picoquic_frame_type_connection_close:
+                    break;
+                default:
+                    memcpy(buffer, test_skip_list[i].val, len);
+                    l_ret = parse_test_packet(qclient, saddr, simulated_time, buffer, len,
+                        epoch, &ack_needed, &err, test_skip_list[i].mpath);
+                    if (l_ret == 0 || err != PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION) {
+                        DBG_PRINTF("Frame <%s> in epoch %d, ret = %d, err = 0x%" PRIx64 "\n",
+                            test_skip_list[i].name, epoch, l_ret, err);
+                        ret = -1;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+/* Verify that 1-RTT packets made of ACK and STREAM frames are decoded properly,
+ * including when they are followed by other frames. */
+int parse_frame_fast_path_test(picoquic_quic_t* qclient, struct sockaddr* saddr, uint64_t simulated_time,
+    uint8_t* buffer, size_t buffer_size)
+{
+    int ret = 0;
+    const test_skip_frames_t* frame_ack = NULL;
+    const test_skip_frames_t* frame_stream = NULL;
+    const test_skip_frames_t* frame_last = NULL;
+    const test_skip_frames_t* frame_other = NULL;
+
+    for (size_t i = 0; i < nb_test_skip_list; i++) {
+        if (strcmp(test_skip_list[i].name, "ack") == 0) {
+            frame_ack = &test_skip_list[i];
+        }
+        else if (strcmp(test_skip_list[i].name, "stream_max") == 0) {
+            frame_stream = &test_skip_list[i];
+        }
+        else if (strcmp(test_skip_list[i].name, "stream_min") == 0) {
+            frame_last = &test_skip_list[i];
+        }
+        else if (strcmp(test_skip_list[i].name, "max_data") == 0) {
+            frame_other = &test_skip_list[i];
+        }
+    }
+
+    if (frame_ack == NULL || frame_stream == NULL || frame_last == NULL || frame_other == NULL) {
+        ret = -1;
+    }
+
+    for (int test_mode = 0; ret == 0 && test_mode < 4; test_mode++) {
+        const test_skip_frames_t* frames[4];
+        size_t nb_frames = 0;
+        size_t len = 0;
+        int ack_needed = 0;
+        uint64_t err = 0;
+
+        frames[nb_frames++] = frame_ack;
+        switch (test_mode) {
+        case 0:
+            /* Pure ACK */
+            break;
+        case 1:
+            frames[nb_frames++] = frame_stream;
+            frames[nb_frames++] = frame_last;
+            break;
+        case 2:
+            frames[nb_frames++] = frame_stream;
+            frames[nb_frames++] = frame_other;
+            frames[nb_frames++] = frame_last;
+            break;
+        default:
+            frames[nb_frames++] = frame_other;
+            frames[nb_frames++] = frame_stream;
+            break;
+        }
+
+        for (size_t i = 0; i < nb_frames; i++) {
+            if (len + frames[i]->len > buffer_size) {
+                ret = -1;
+                break;
+            }
+            memcpy(buffer + len, frames[i]->val, frames[i]->len);
+            len += frames[i]->len;
+        }
+
+        if (ret == 0) {
+            ret = parse_test_packet(qclient, saddr, simulated_time, buffer, len,
+                picoquic_epoch_1rtt, &ack_needed, &err, 0);
+            if (ret != 0 || ack_needed != (test_mode != 0)) {
+                DBG_PRINTF("Fast path test %d, ret = %d, ack_needed = %d\n", test_mode, ret, ack_needed);
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
 int parse_frame_test()
 {
     int ret = 0;
@@ -1135,6 +1257,18 @@ int parse_frame_test()
             buffer, sizeof(buffer));
     }
 
+    /* Verify that frames are restricted in Initial and Handshake packets */
+    if (ret == 0) {
+        ret = parse_frame_handshake_test(qclient, (struct sockaddr*)&saddr, simulated_time,
+            buffer, sizeof(buffer));
+    }
+
+    /* Verify the decoding of packets made of ACK and STREAM frames */
+    if (ret == 0) {
+        ret = parse_frame_fast_path_test(qclient, (struct sockaddr*)&saddr, simulated_time,
+            buffer, sizeof(buffer));
+    }
+
     /* Decode a series of known bad packets */
     for (size_t i = 0; ret == 0 && i < nb_test_frame_error_list; i++) {
         for (int sharp_end = 0; ret == 0 && sharp_end < 2; sharp_end++) {
@@ -2262,1041 +2396,2163 @@ int binlog_test()
     return ret;
 }
 
-/* Basic test of connection ID stash, part of migration support  */
-static const picoquic_remote_cnxid_t stash_test_case[] = {
-    { NULL,  1,{ { 0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
-{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 } },
-{ NULL,  2,{ { 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
-{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 } },
-{ NULL,  3,{ { 2, 3, 4, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
-{ 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17 } }
-};
+/* Log packets at regular intervals, with some events out of time order, so
+ * that the index contains several sync points. Converting a time window
+ * shall report every packet logged in that window. */
+#define BINLOG_WINDOW_NB_PACKETS 1000
+#define BINLOG_WINDOW_SPACING 10000
 
-static const picoquic_connection_id_t stash_test_init_local =
-    { { 11, 11, 11, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 };
+static uint64_t binlog_window_packet_time(size_t i)
+{
+    uint64_t t = BINLOG_WINDOW_SPACING * (uint64_t)i;
 
-static const picoquic_connection_id_t stash_test_init_remote =
-{ { 99, 99, 99, 99, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 };
+    if (i % 37 == 0) {
+        /* Event with a later time, logged before the events that precede it */
+        t += 300000;
+    }
+    else if (i % 53 == 0 && t >= 200000) {
+        /* Event with an earlier time, logged after the events that follow it */
+        t -= 200000;
+    }
+    return t;
+}
 
-static const size_t nb_stash_test_case = sizeof(stash_test_case) / sizeof(picoquic_remote_cnxid_t);
+typedef struct st_binlog_window_count_t {
+    uint64_t nb_packets;
+} binlog_window_count_t;
 
-static int cnxid_stash_compare(int test_mode, picoquic_remote_cnxid_t * stashed, size_t i)
+static int binlog_window_connection_start(uint64_t time, const picoquic_connection_id_t* cid, int client_mode,
+    uint32_t proposed_version, const picoquic_connection_id_t* remote_cnxid, void* ptr)
 {
-    int ret = 0;
+    return 0;
+}
 
-    if (stashed == NULL) {
-        DBG_PRINTF("Test %d, cannot dequeue cnxid %d.\n", test_mode, i);
-        ret = -1;
-    }
-    else if (stashed->sequence != stash_test_case[i].sequence) {
-        DBG_PRINTF("Test %d, cnxid %d, sequence %d instead of %d.\n", test_mode, i,
-            stashed->sequence, stash_test_case[i].sequence);
-        ret = -1;
-    }
-    else if (picoquic_compare_connection_id(&stashed->cnx_id, &stash_test_case[i].cnx_id) != 0) {
-        DBG_PRINTF("Test %d, cnxid %d, CNXID values do not match.\n", test_mode, i);
-        ret = -1;
-    }
-    else if (memcmp(&stashed->reset_secret, &stash_test_case[i].reset_secret, PICOQUIC_RESET_SECRET_SIZE) != 0) {
-        DBG_PRINTF("Test %d, cnxid %d, secrets do not match.\n", test_mode, i);
-        ret = -1;
-    }
+static int binlog_window_stream(uint64_t time, bytestream* s, void* ptr)
+{
+    return 0;
+}
 
-    return ret;
+static int binlog_window_pdu(uint64_t time, int rxtx, bytestream* s, void* ptr)
+{
+    return 0;
 }
 
-int cnxid_stash_test()
+static int binlog_window_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const picoquic_packet_header* ph,
+    int rxtx, void* ptr)
+{
+    ((binlog_window_count_t*)ptr)->nb_packets++;
+    return 0;
+}
+
+static int binlog_window_packet_frame(bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int binlog_window_packet_end(void* ptr)
+{
+    return 0;
+}
+
+static int binlog_window_path_event(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int binlog_window_connection_end(uint64_t time, void* ptr)
+{
+    return 0;
+}
+
+static int binlog_index_window_test()
 {
     int ret = 0;
     uint64_t simulated_time = 0;
-    struct sockaddr_in saddr;
-    picoquic_quic_t * qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+    const picoquic_connection_id_t initial_cid = {
+        { 1, 2, 3, 4 }, 4
+    };
+    const picoquic_connection_id_t dest_cid = {
+        { 5, 6, 7, 8 }, 4
+    };
+    const uint64_t windows[][2] = {
+        { 0, UINT64_MAX }, { 1500000, 2500000 }, { 2990000, 3010000 }, { 3700000, 5100000 },
+        { 5000000, 5000000 }, { 7770000, 8230000 }, { 9500000, UINT64_MAX }, { 9900000, 10300000 } };
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL, simulated_time,
         &simulated_time, NULL, NULL, 0);
 
-
-    memset(&saddr, 0, sizeof(struct sockaddr_in));
-    if (qclient == NULL) {
+    if (quic == NULL) {
         DBG_PRINTF("%s", "Cannot create QUIC context\n");
         ret = -1;
     }
+    else {
+        struct sockaddr_in saddr;
+        picoquic_cnx_t* cnx;
 
-    /* First test: enqueue and dequeue immediately */
-    /* Second test: enqueue all and then dequeue - verify order */
-    /* Third test: enqueue all and then delete the connection */
-    for (int test_mode = 0; ret == 0 && test_mode < 3; test_mode++) {
-        picoquic_cnx_t * cnx = picoquic_create_cnx(qclient,
-            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
-            simulated_time, 0, "test-sni", "test-alpn", 1);
-
-        picoquic_remote_cnxid_t * stashed = NULL;
-
-        if (cnx == NULL) {
+        picoquic_set_binlog(quic, ".");
+        picoquic_set_default_spinbit_policy(quic, picoquic_spinbit_null);
+        memset(&saddr, 0, sizeof(struct sockaddr_in));
+        if ((cnx = picoquic_create_cnx(quic, initial_cid, dest_cid, (struct sockaddr*)&saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL) {
             DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
             ret = -1;
-        } else {
-            /* init the various connection id to a length compatible with test */
-            cnx->path[0]->p_local_cnxid->cnx_id = stash_test_init_local;
-            cnx->path[0]->p_remote_cnxid->cnx_id = stash_test_init_remote;
         }
+        else {
+            picoquic_log_new_connection(cnx);
+            for (size_t i = 0; i < BINLOG_WINDOW_NB_PACKETS; i++) {
+                picoquic_packet_header ph;
+                memset(&ph, 0, sizeof(ph));
 
-        for (size_t i = 0; ret == 0 && i < nb_stash_test_case; i++) {
-            uint64_t transport_error = picoquic_stash_remote_cnxid(cnx, 0, 0,
-                stash_test_case[i].sequence, stash_test_case[i].cnx_id.id_len,
-                stash_test_case[i].cnx_id.id, stash_test_case[i].reset_secret, &stashed);
-            if (transport_error != 0) {
-                DBG_PRINTF("Test %d, cannot stash cnxid %d, err 0x%" PRIx64 ".\n", test_mode, i, transport_error);
-                ret = -1;
-            } else {
-                if (stashed == NULL) {
-                    DBG_PRINTF("Test %d, cannot stash cnxid %d (duplicate).\n", test_mode, i);
-                    ret = -1;
-                }
-                else if (test_mode == 0) {
-                    stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
-                    stashed->nb_path_references++;
-                    ret = cnxid_stash_compare(test_mode, stashed, i);
-                }
+                ph.ptype = picoquic_packet_1rtt_protected;
+                ph.pn64 = i;
+                ph.dest_cnx_id = initial_cid;
+                ph.srce_cnx_id = dest_cid;
+                ph.payload_length = test_skip_list[0].len;
+
+                picoquic_log_packet(cnx, cnx->path[0], 1, binlog_window_packet_time(i), &ph,
+                    test_skip_list[0].val, test_skip_list[0].len);
             }
+            simulated_time = BINLOG_WINDOW_SPACING * BINLOG_WINDOW_NB_PACKETS;
+            picoquic_delete_cnx(cnx);
         }
+        picoquic_free(quic);
+    }
 
-        /* Dequeue all in mode 1, verify order */
-        if (test_mode == 1) {
-            for (size_t i = 0; ret == 0 && i < nb_stash_test_case; i++) {
-                stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
-                stashed->nb_path_references++;
-                ret = cnxid_stash_compare(test_mode, stashed, i);
+    for (size_t w = 0; ret == 0 && w < sizeof(windows) / sizeof(windows[0]); w++) {
+        binlog_window_count_t count = { 0 };
+        binlog_convert_cb_t callbacks;
+        uint64_t expected = 0;
+        FILE* f_binlog = picoquic_file_open(binlog_test_file, "rb");
+
+        memset(&callbacks, 0, sizeof(callbacks));
+        callbacks.connection_start = binlog_window_connection_start;
+        callbacks.alpn_update = binlog_window_stream;
+        callbacks.param_update = binlog_window_stream;
+        callbacks.pdu = binlog_window_pdu;
+        callbacks.packet_start = binlog_window_packet_start;
+        callbacks.packet_frame = binlog_window_packet_frame;
+        callbacks.packet_end = binlog_window_packet_end;
+        callbacks.packet_lost = binlog_window_path_event;
+        callbacks.packet_dropped = binlog_window_path_event;
+        callbacks.packet_buffered = binlog_window_path_event;
+        callbacks.cc_update = binlog_window_path_event;
+        callbacks.info_message = binlog_window_stream;
+        callbacks.connection_end = binlog_window_connection_end;
+        callbacks.ptr = &count;
+
+        for (size_t i = 0; i < BINLOG_WINDOW_NB_PACKETS; i++) {
+            uint64_t t = binlog_window_packet_time(i);
+            if (t >= windows[w][0] && t <= windows[w][1]) {
+                expected++;
             }
         }
 
-        /* Verify nothing left in queue in mode 0, 1 */
-        if (test_mode < 2) {
-            stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
-            if (stashed != NULL) {
-                DBG_PRINTF("Test %d, unexpected cnxid left, #%d.\n", test_mode, (int)stashed->sequence);
+        if (f_binlog == NULL) {
+            DBG_PRINTF("Cannot open file %s.\n", binlog_test_file);
+            ret = -1;
+        }
+        else {
+            if (w == 0) {
+                binlog_reader_t reader;
+
+                if (binlog_reader_open(&reader, f_binlog) != 0 || !reader.has_index || reader.nb_syncs < 4) {
+                    DBG_PRINTF("Expected several sync points, got %zu\n", reader.nb_syncs);
+                    ret = -1;
+                }
+                for (size_t i = 1; ret == 0 && i < reader.nb_syncs; i++) {
+                    if (reader.syncs[i].time < reader.syncs[i - 1].time || reader.syncs[i].offset <= reader.syncs[i - 1].offset) {
+                        DBG_PRINTF("Sync point %zu out of order\n", i);
+                        ret = -1;
+                    }
+                }
+                binlog_reader_close(&reader);
+            }
+            if (ret == 0 && binlog_convert_ex(f_binlog, &initial_cid, windows[w][0], windows[w][1], &callbacks) != 0) {
+                DBG_PRINTF("Cannot convert window %zu\n", w);
+                ret = -1;
+            }
+            else if (ret == 0 && count.nb_packets != expected) {
+                DBG_PRINTF("Window %zu: %" PRIu64 " packets instead of %" PRIu64 "\n", w, count.nb_packets, expected);
                 ret = -1;
             }
+            (void)picoquic_file_close(f_binlog);
         }
+    }
 
-        /* Delete the connecton and free the stash */
-        picoquic_delete_cnx(cnx);
+    return ret;
+}
+
+/* Verify that the index appended to the reference binary log is loaded,
+ * and that time windows map to the expected ranges of offsets. */
+int binlog_index_test()
+{
+    int ret = 0;
+    char log_test_ref[512];
+    FILE* f_binlog = NULL;
+    binlog_reader_t reader;
+    const picoquic_connection_id_t initial_cid = {
+        { 1, 2, 3, 4 }, 4
+    };
+
+    memset(&reader, 0, sizeof(reader));
+
+    if (picoquic_get_input_path(log_test_ref, sizeof(log_test_ref), picoquic_solution_dir, BINLOG_TEST_REF) != 0) {
+        DBG_PRINTF("%s", "Cannot set the log ref file name.\n");
+        ret = -1;
+    }
+    else if ((f_binlog = picoquic_file_open(log_test_ref, "rb")) == NULL) {
+        DBG_PRINTF("Cannot open file %s.\n", log_test_ref);
+        ret = -1;
+    }
+    else if (binlog_reader_open(&reader, f_binlog) != 0) {
+        DBG_PRINTF("%s", "Cannot open the binary log reader.\n");
+        ret = -1;
+    }
+    else if (!reader.has_index || reader.nb_cids != 1 || reader.nb_syncs != 1) {
+        DBG_PRINTF("Unexpected index, has_index: %d, cids: %zu, syncs: %zu\n",
+            reader.has_index, reader.nb_cids, reader.nb_syncs);
+        ret = -1;
+    }
+    else if (picoquic_compare_connection_id(&reader.cids[0].cid, &initial_cid) != 0 ||
+        reader.cids[0].first_offset != 16 || reader.syncs[0].offset != 16) {
+        DBG_PRINTF("%s", "Unexpected content of the binary log index.\n");
+        ret = -1;
     }
+    else {
+        uint64_t start_offset = 0;
+        uint64_t end_offset = 0;
 
-    if (qclient != NULL) {
-        picoquic_free(qclient);
+        /* The events end where the index starts, right after the close event */
+        binlog_reader_find_window(&reader, 0, UINT64_MAX, &start_offset, &end_offset);
+        if (start_offset != 16 || end_offset != 2811 || reader.events_end != 2811) {
+            DBG_PRINTF("Unexpected window [%" PRIu64 ", %" PRIu64 "]\n", start_offset, end_offset);
+            ret = -1;
+        }
+    }
+
+    binlog_reader_close(&reader);
+    (void)picoquic_file_close(f_binlog);
+
+    if (ret == 0) {
+        ret = binlog_index_window_test();
     }
 
     return ret;
 }
 
-int new_cnxid_test()
+/* Write the same events to a binary log synchronously, then through the
+ * asynchronous writer, and verify that both logs are identical. */
+#define BINLOG_ASYNC_SYNC_FILE "binlog_async_ref.log"
+#define BINLOG_ASYNC_NB_ROUNDS 64 /* Enough events to create several sync points in the index */
+
+static int binlog_async_one(picoquic_binlog_writer_t* writer, int nb_rounds, int is_stalled)
 {
     int ret = 0;
     uint64_t simulated_time = 0;
-    struct sockaddr_in saddr;
-    picoquic_quic_t * qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+    const picoquic_connection_id_t initial_cid = {
+        { 1, 2, 3, 4 }, 4
+    };
+    const picoquic_connection_id_t dest_cid = {
+        { 5, 6, 7, 8 }, 4
+    };
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL, simulated_time,
         &simulated_time, NULL, NULL, 0);
-    picoquic_cnx_t * cnx = NULL;
-    uint8_t frame_buffer[256];
-    size_t consumed = 0;
 
-    memset(&saddr, 0, sizeof(struct sockaddr_in));
-    saddr.sin_family = AF_INET;
-    saddr.sin_port = 1000;
-
-    if (qclient == NULL) {
+    if (quic == NULL) {
         DBG_PRINTF("%s", "Cannot create QUIC context\n");
         ret = -1;
-    } else {
-        cnx = picoquic_create_cnx(qclient,
-            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
-            simulated_time, 0, "test-sni", "test-alpn", 1);
+    }
+    else {
+        struct sockaddr_in saddr;
+        picoquic_cnx_t* cnx;
 
-        if (cnx == NULL) {
+        picoquic_set_binlog(quic, ".");
+        picoquic_set_default_spinbit_policy(quic, picoquic_spinbit_null);
+        picoquic_set_log_level(quic, 1);
+        if (writer != NULL && picoquic_set_binlog_writer(quic, writer) != 0) {
+            DBG_PRINTF("%s", "Cannot set the binlog writer\n");
+            ret = -1;
+        }
+        else if (is_stalled) {
+            picoquic_binlog_writer_pause(writer, 1);
+        }
+        memset(&saddr, 0, sizeof(struct sockaddr_in));
+        if (ret == 0 && (cnx = picoquic_create_cnx(quic, initial_cid, dest_cid, (struct sockaddr*)&saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL) {
             DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
             ret = -1;
         }
-        else {
-            /* Create a new local CID */
-            picoquic_local_cnxid_t* local_cid = picoquic_create_local_cnxid(cnx, 0, NULL, simulated_time);
-            picoquic_local_cnxid_list_t* local_cid_list = cnx->first_local_cnxid_list;
-            
-            if (local_cid == NULL || local_cid_list == NULL) {
-                DBG_PRINTF("%s", "Cannot create local cnxid\n");
-                ret = -1;
+        else if (ret == 0) {
+            picoquic_log_new_connection(cnx);
+            for (int round = 0; round < nb_rounds; round++) {
+                for (size_t i = 0; i < nb_test_skip_list; i++) {
+                    picoquic_packet_header ph;
+                    memset(&ph, 0, sizeof(ph));
+
+                    ph.ptype = picoquic_packet_1rtt_protected;
+                    ph.pn64 = round * nb_test_skip_list + i;
+                    ph.dest_cnx_id = initial_cid;
+                    ph.srce_cnx_id = dest_cid;
+                    ph.payload_length = test_skip_list[i].len;
+
+                    picoquic_log_packet(cnx, cnx->path[0], 1, simulated_time, &ph,
+                        test_skip_list[i].val, test_skip_list[i].len);
+                    simulated_time += 1000;
+                }
+                picoquic_log_app_message(cnx, "Round %d", round);
             }
+            if (is_stalled) {
+                picoquic_binlog_writer_pause(writer, 0);
+            }
+            picoquic_delete_cnx(cnx);
+        }
+        picoquic_free(quic);
+    }
 
-            if (local_cid_list->nb_local_cnxid != 2) {
-                DBG_PRINTF("Expected 2 CID, got %d\n", local_cid_list->nb_local_cnxid);
+    return ret;
+}
+
+/* Fill the ring while the writer is stalled. The events that do not fit
+ * are dropped and counted. The log records how many were dropped, and
+ * still ends with the connection close event and the index. */
+typedef struct st_binlog_overflow_ctx_t {
+    int nb_markers;
+    int nb_close;
+    uint64_t nb_dropped;
+} binlog_overflow_ctx_t;
+
+static int binlog_overflow_cb(bytestream* s, void* cbptr)
+{
+    binlog_overflow_ctx_t* ctx = (binlog_overflow_ctx_t*)cbptr;
+    picoquic_connection_id_t cid;
+    uint64_t time = 0;
+    uint64_t path_id = 0;
+    uint64_t id = 0;
+    int ret = byteread_cid(s, &cid);
+
+    ret |= byteread_vint(s, &time);
+    ret |= byteread_vint(s, &path_id);
+    ret |= byteread_vint(s, &id);
+
+    if (ret == 0 && id == picoquic_log_event_info_message) {
+        char text[256];
+        size_t length = bytestream_remain(s);
+
+        if (length >= sizeof(text)) {
+            length = sizeof(text) - 1;
+        }
+        memcpy(text, bytestream_ptr(s), length);
+        text[length] = 0;
+        if (strstr(text, " events dropped") != NULL) {
+            ctx->nb_markers++;
+            ctx->nb_dropped += strtoull(text, NULL, 10);
+        }
+    }
+    else if (ret == 0 && id == picoquic_log_event_connection_close) {
+        ctx->nb_close++;
+    }
+
+    return ret;
+}
+
+static int binlog_async_overflow_test()
+{
+    int ret = 0;
+    picoquic_binlog_writer_stats_t stats;
+    picoquic_binlog_writer_t* writer = picoquic_binlog_writer_create(0);
+
+    if (writer == NULL) {
+        DBG_PRINTF("%s", "Cannot create the binlog writer\n");
+        ret = -1;
+    }
+    else {
+        ret = binlog_async_one(writer, BINLOG_ASYNC_NB_ROUNDS, 1);
+        picoquic_binlog_writer_get_stats(writer, &stats);
+        picoquic_binlog_writer_delete(writer);
+    }
+
+    if (ret == 0 && stats.nb_events_dropped == 0) {
+        DBG_PRINTF("%s", "No event dropped by the stalled writer\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags = 0;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(binlog_test_file, &flags, &log_time);
+        binlog_reader_t reader;
+        binlog_overflow_ctx_t ctx;
+
+        memset(&ctx, 0, sizeof(ctx));
+        if (f_binlog == NULL) {
+            DBG_PRINTF("Cannot open %s.\n", binlog_test_file);
+            ret = -1;
+        }
+        else {
+            if (binlog_reader_open(&reader, f_binlog) != 0 || !reader.has_index) {
+                DBG_PRINTF("%s", "No index at the end of the overflowed log\n");
                 ret = -1;
             }
-            else if (local_cid_list->local_cnxid_first == NULL || local_cid_list->local_cnxid_first->next == NULL) {
-                DBG_PRINTF("%s", "Pointer to CID is NULL in cnx context\n");
+            binlog_reader_close(&reader);
+            if (ret == 0 && fileread_binlog(f_binlog, binlog_overflow_cb, &ctx) != 0) {
+                DBG_PRINTF("%s", "Cannot read the overflowed log\n");
                 ret = -1;
             }
+            (void)picoquic_file_close(f_binlog);
+        }
 
-            if (ret == 0) {
-                int more_data = 0;
-                int is_pure_ack = 1;
-                uint8_t* bytes_next = picoquic_format_new_connection_id_frame(cnx, local_cid_list, frame_buffer, frame_buffer + sizeof(frame_buffer),
-                    &more_data, &is_pure_ack, local_cid);
+        if (ret == 0 && (ctx.nb_markers == 0 || ctx.nb_dropped != stats.nb_events_dropped || ctx.nb_close != 1)) {
+            DBG_PRINTF("Found %d drop markers for %" PRIu64 " events instead of %" PRIu64 ", %d close events\n",
+                ctx.nb_markers, ctx.nb_dropped, stats.nb_events_dropped, ctx.nb_close);
+            ret = -1;
+        }
+    }
 
-                consumed = bytes_next - frame_buffer;
+    return ret;
+}
 
-                if (consumed == 0) {
-                    ret = -1;
-                    DBG_PRINTF("Cannot encode new connection ID frame, ret = %x\n", ret);
-                }
-            }
+int binlog_async_test()
+{
+    int ret = binlog_async_one(NULL, BINLOG_ASYNC_NB_ROUNDS, 0);
 
-            if (ret == 0) {
-                size_t skipped = 0;
-                int pure_ack = 0;
+    if (ret == 0) {
+        (void)remove(BINLOG_ASYNC_SYNC_FILE);
+        if (rename(binlog_test_file, BINLOG_ASYNC_SYNC_FILE) != 0) {
+            DBG_PRINTF("Cannot rename %s\n", binlog_test_file);
+            ret = -1;
+        }
+    }
 
-                ret = picoquic_skip_frame(frame_buffer, sizeof(frame_buffer), &skipped, &pure_ack);
+    if (ret == 0) {
+        picoquic_binlog_writer_t* writer = picoquic_binlog_writer_create(PICOQUIC_BINLOG_RING_SIZE_DEFAULT);
 
-                if (ret != 0) {
-                    DBG_PRINTF("Cannot skip connection ID frame, ret = %x\n", ret);
-                }
-                else if (skipped != consumed) {
-                    DBG_PRINTF("Skipped %d bytes instead of %d\n", (int)skipped, (int)consumed);
-                    ret = -1;
-                }
-                else if (pure_ack != 0) {
-                    DBG_PRINTF("Pure ACK = %d instead of 0\n", (int)pure_ack);
-                    ret = -1;
-                }
+        if (writer == NULL) {
+            DBG_PRINTF("%s", "Cannot create the binlog writer\n");
+            ret = -1;
+        }
+        else {
+            picoquic_binlog_writer_stats_t stats;
+
+            ret = binlog_async_one(writer, BINLOG_ASYNC_NB_ROUNDS, 0);
+            picoquic_binlog_writer_get_stats(writer, &stats);
+            picoquic_binlog_writer_delete(writer);
+
+            if (ret == 0 && stats.nb_events_dropped != 0) {
+                DBG_PRINTF("%" PRIu64 " events dropped\n", stats.nb_events_dropped);
+                ret = -1;
             }
-            /* Delete the connecton and free the stash */
-            picoquic_delete_cnx(cnx);
         }
+    }
 
-        picoquic_free(qclient);
+    if (ret == 0 && picoquic_test_compare_binary_files(binlog_test_file, BINLOG_ASYNC_SYNC_FILE) != 0) {
+        DBG_PRINTF("%s", "Asynchronous log differs from synchronous log\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = binlog_async_overflow_test();
     }
 
     return ret;
 }
 
-/*
- * Test the copy for retransmit function
- */
-
-#define SPLIT_FRAME_TEST_SOURCE_CONTENT_67 \
-    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, \
-   11, 12, 13, 14, 15, 16, 17, 18, 19, 20, \
-   21, 22, 23, 24, 25, 26, 27, 28, 29, 30, \
-   31, 32, 33, 34, 35, 36, 37, 38, 39, 40, \
-   41, 42, 43, 44, 45, 46, 47, 48, 49, 50, \
-   51, 52, 53, 54, 55, 56, 57, 58, 59, 60, \
-   61, 62, 63, 64, 65, 66, 67
+/* Convert a binary log with many events to QLOG, and compare with the
+ * reference. The reference was produced by the qlog writer that used
+ * fprintf for each field, so this verifies that the buffered writer
+ * produces the same output. */
+#define QLOG_MULTI_TEST_REF "picoquictest" PICOQUIC_FILE_SEPARATOR "binlog_multi_ref.qlog"
+#define QLOG_MULTI_TEST_FILE "binlog_multi_test.qlog"
+#define QLOG_MULTI_NB_ROUNDS 4
 
-#define SPLIT_FRAME_TEST_SOURCE_CONTENT_INIT_32 \
-    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, \
-   11, 12, 13, 14, 15, 16, 17, 18, 19, 20, \
-   21, 22, 23, 24, 25, 26, 27, 28, 29, 30, \
-   31, 32
+int qlog_multi_test()
+{
+    int ret = 0;
+    char qlog_test_ref[512];
+    const picoquic_connection_id_t initial_cid = {
+        { 1, 2, 3, 4 }, 4
+    };
 
-#define SPLIT_FRAME_TEST_SOURCE_CONTENT_LAST_35 \
-   33, 34, 35, 36, 37, 38, 39, 40, \
-   41, 42, 43, 44, 45, 46, 47, 48, 49, 50, \
-   51, 52, 53, 54, 55, 56, 57, 58, 59, 60, \
-   61, 62, 63, 64, 65, 66, 67
+    if (picoquic_get_input_path(qlog_test_ref, sizeof(qlog_test_ref), picoquic_solution_dir, QLOG_MULTI_TEST_REF) != 0) {
+        DBG_PRINTF("%s", "Cannot set the qlog ref file name.\n");
+        ret = -1;
+    }
+    else {
+        ret = binlog_async_one(NULL, QLOG_MULTI_NB_ROUNDS, 0);
+    }
 
-#define COPY_PACKET_CID_DEST 1,2,3,4,5,6,7,8
+    if (ret == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags = 0;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(binlog_test_file, &flags, &log_time);
 
-#define SIZEOF_CID_DEST 8
+        if (f_binlog == NULL) {
+            DBG_PRINTF("Cannot open %s.\n", binlog_test_file);
+            ret = -1;
+        }
+        else {
+            ret = qlog_convert(&initial_cid, f_binlog, binlog_test_file, QLOG_MULTI_TEST_FILE, ".", flags);
+            (void)picoquic_file_close(f_binlog);
+            if (ret != 0) {
+                DBG_PRINTF("%s", "Cannot convert the binary log into QLOG.\n");
+            }
+            else if (picoquic_test_compare_text_files(QLOG_MULTI_TEST_FILE, qlog_test_ref) != 0) {
+                DBG_PRINTF("%s", "Unexpected content in QLOG log file.\n");
+                ret = -1;
+            }
+        }
+    }
 
-#define COPY_PACKET_HEADER_1RTT 0x43, COPY_PACKET_CID_DEST, 0, 0, 0, 1
+    return ret;
+}
 
-#define SIZEOF_1RTT_HEADER (SIZEOF_CID_DEST + 5)
+/* Convert two binary logs in batch mode, as done by picolog with several
+ * inputs, and verify that each produces a qlog and an svg named after the
+ * log file. */
+#define PICOLOG_BATCH_TEST_LOG "picolog_batch_test.client.log"
+#define PICOLOG_BATCH_TEST_QLOG "picolog_batch_test.client.qlog"
+#define PICOLOG_BATCH_CID_QLOG "01020304.client.qlog"
+#define PICOLOG_BATCH_TEST_SVG "picolog_batch_test.client.svg"
+#define PICOLOG_BATCH_CID_SVG "01020304.client.svg"
+#define PICOLOG_BATCH_TEMPLATE "picolog_batch_template.txt"
+#define PICOLOG_BATCH_TEMPLATE_HEAD "<svg>\n"
+
+static int picolog_batch_test_svg(app_conversion_context_t* appctx, picolog_file_list_t* files)
+{
+    int ret = 0;
+    char const* svg_names[2] = { PICOLOG_BATCH_TEST_SVG, PICOLOG_BATCH_CID_SVG };
+    FILE* F = picoquic_file_open(PICOLOG_BATCH_TEMPLATE, "w");
 
-#define SPLIT_FRAME_TEST_SOURCE_68_77 68,69,70,71,72,73,74,75,76,77
+    for (int i = 0; i < 2; i++) {
+        (void)remove(svg_names[i]);
+    }
 
-static uint8_t ct_stream0_data[] = { SPLIT_FRAME_TEST_SOURCE_CONTENT_67, SPLIT_FRAME_TEST_SOURCE_68_77 };
+    if (F == NULL) {
+        DBG_PRINTF("Cannot create %s\n", PICOLOG_BATCH_TEMPLATE);
+        ret = -1;
+    }
+    else {
+        fprintf(F, "%s#\n</svg>\n", PICOLOG_BATCH_TEMPLATE_HEAD);
+        (void)picoquic_file_close(F);
+        appctx->out_format = "svg";
+        appctx->template_name = PICOLOG_BATCH_TEMPLATE;
+        if (convert_batch(appctx, &picoquic_null_connection_id, files, 2) != 0) {
+            DBG_PRINTF("%s", "Batch svg conversion failed\n");
+            ret = -1;
+        }
+    }
 
-static uint8_t ct_test_packet1[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min | 2, 0x00, 0x40, 67,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
-};
+    for (int i = 0; ret == 0 && i < 2; i++) {
+        char line[256];
 
-static uint8_t ct_test_packet2[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min, 0x00,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_67 };
+        if ((F = picoquic_file_open(svg_names[i], "r")) == NULL) {
+            DBG_PRINTF("Cannot open %s\n", svg_names[i]);
+            ret = -1;
+        }
+        else {
+            if (fgets(line, sizeof(line), F) == NULL || strcmp(line, PICOLOG_BATCH_TEMPLATE_HEAD) != 0) {
+                DBG_PRINTF("Unexpected content in %s\n", svg_names[i]);
+                ret = -1;
+            }
+            (void)picoquic_file_close(F);
+        }
+    }
 
-static uint8_t ct_test_packet3[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min, 0x00,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_67, SPLIT_FRAME_TEST_SOURCE_68_77
-};
+    return ret;
+}
 
-static uint8_t ct_test_packet4[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
-    SPLIT_FRAME_TEST_SOURCE_68_77,
-    picoquic_frame_type_stream_range_min, 0x00,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
-};
+int picolog_batch_test()
+{
+    int ret = 0;
+    char qlog_test_ref[512];
+    picolog_file_list_t files;
+    app_conversion_context_t appctx;
+    char const* qlog_names[2] = { PICOLOG_BATCH_TEST_QLOG, PICOLOG_BATCH_CID_QLOG };
 
-uint8_t ct_test_packet4_first_frame[] = {
-    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
-    SPLIT_FRAME_TEST_SOURCE_68_77 };
+    memset(&files, 0, sizeof(files));
+    memset(&appctx, 0, sizeof(appctx));
+    appctx.out_format = "qlog";
+    appctx.out_dir = ".";
+    appctx.window_end = UINT64_MAX;
 
-static uint8_t ct_test_packet5[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
-    SPLIT_FRAME_TEST_SOURCE_68_77,
-    picoquic_frame_type_stream_range_min | 2, 0x00, 0x40, 67,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
-};
+    for (int i = 0; i < 2; i++) {
+        (void)remove(qlog_names[i]);
+    }
 
-static uint8_t ct_test_packet6[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
-    SPLIT_FRAME_TEST_SOURCE_68_77,
-    picoquic_frame_type_stream_range_min, 0x00,
-    SPLIT_FRAME_TEST_SOURCE_CONTENT_INIT_32
-};
+    if (picoquic_get_input_path(qlog_test_ref, sizeof(qlog_test_ref), picoquic_solution_dir, QLOG_MULTI_TEST_REF) != 0) {
+        DBG_PRINTF("%s", "Cannot set the qlog ref file name.\n");
+        ret = -1;
+    }
+    else if ((ret = binlog_async_one(NULL, QLOG_MULTI_NB_ROUNDS, 0)) == 0) {
+        (void)remove(PICOLOG_BATCH_TEST_LOG);
+        if (rename(binlog_test_file, PICOLOG_BATCH_TEST_LOG) != 0) {
+            DBG_PRINTF("Cannot rename %s\n", binlog_test_file);
+            ret = -1;
+        }
+        else {
+            ret = binlog_async_one(NULL, QLOG_MULTI_NB_ROUNDS, 0);
+        }
+    }
 
-static uint8_t ct_test_mtu_probe[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_ping,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+    if (ret == 0 && (picolog_add_file(&files, PICOLOG_BATCH_TEST_LOG) != 0 ||
+        picolog_add_file(&files, binlog_test_file) != 0)) {
+        DBG_PRINTF("%s", "Cannot create the list of files\n");
+        ret = -1;
+    }
 
-static uint8_t ct_test_ack[] = {
-    COPY_PACKET_HEADER_1RTT,
-    picoquic_frame_type_ack,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    if (ret == 0 && convert_batch(&appctx, &picoquic_null_connection_id, &files, 2) != 0) {
+        DBG_PRINTF("%s", "Batch conversion failed\n");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < 2; i++) {
+        if (picoquic_test_compare_text_files(qlog_names[i], qlog_test_ref) != 0) {
+            DBG_PRINTF("Unexpected content in %s\n", qlog_names[i]);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = picolog_batch_test_svg(&appctx, &files);
+    }
+
+    picolog_free_files(&files);
+
+    return ret;
+}
+
+/* Basic test of connection ID stash, part of migration support  */
+static const picoquic_remote_cnxid_t stash_test_case[] = {
+    { NULL,  1,{ { 0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
+{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 } },
+{ NULL,  2,{ { 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
+{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 } },
+{ NULL,  3,{ { 2, 3, 4, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
+{ 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17 } }
 };
 
-typedef struct st_copy_retransmit_test_case_t {
-    uint8_t* packet;
-    uint32_t packet_length;
-    uint32_t offset;
-    int is_mtu_probe;
-    int is_ack_trap;
-    size_t copy_max;
-    uint8_t* b1_expected;
-    size_t b1_length;
-    size_t b1_offset;
-    uint8_t* b2_expected;
-    size_t b2_length;
-    uint8_t* b3_expected;
-    size_t b3_length;
-    int is_pure_ack_expected;
-} copy_retransmit_test_case_t;
+static const picoquic_connection_id_t stash_test_init_local =
+    { { 11, 11, 11, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 };
 
-static copy_retransmit_test_case_t copy_retransmit_case[] = {
-    {
-        ct_test_packet1,
-        (uint32_t) sizeof(ct_test_packet1),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        PICOQUIC_MAX_PACKET_SIZE,
-        ct_test_packet1,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet1 + SIZEOF_1RTT_HEADER,
-        sizeof(ct_test_packet1) - SIZEOF_1RTT_HEADER,
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet2,
-        (uint32_t)sizeof(ct_test_packet2),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        PICOQUIC_MAX_PACKET_SIZE,
-        ct_test_packet1,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet2 + SIZEOF_1RTT_HEADER,
-        sizeof(ct_test_packet2) - SIZEOF_1RTT_HEADER,
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet2,
-        (uint32_t)sizeof(ct_test_packet2),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        (uint32_t) sizeof(ct_test_packet2),
-        ct_test_packet2,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet2 + SIZEOF_1RTT_HEADER,
-        sizeof(ct_test_packet2) - SIZEOF_1RTT_HEADER,
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet3,
-        (uint32_t) sizeof(ct_test_packet3),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        (uint32_t) sizeof(ct_test_packet3),
-        ct_test_packet3,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet3 + SIZEOF_1RTT_HEADER,
-        sizeof(ct_test_packet3) - SIZEOF_1RTT_HEADER,
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet4,
-        (uint32_t) sizeof(ct_test_packet4),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        (uint32_t) sizeof(ct_test_packet4),
-        ct_test_packet4,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet4_first_frame,
-        sizeof(ct_test_packet4_first_frame),
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet4,
-        (uint32_t) sizeof(ct_test_packet4),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        PICOQUIC_MAX_PACKET_SIZE,
-        ct_test_packet5,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet4_first_frame,
-        sizeof(ct_test_packet4_first_frame),
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_packet4,
-        (uint32_t) sizeof(ct_test_packet4),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        0,
-        0,
-        (uint32_t) sizeof(ct_test_packet6),
-        ct_test_packet6,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        ct_test_packet4_first_frame,
-        sizeof(ct_test_packet4_first_frame),
-        NULL,
-        0,
-        0
-    },
-    {
-        ct_test_mtu_probe,
-        (uint32_t) sizeof(ct_test_mtu_probe),
-        (uint32_t) SIZEOF_1RTT_HEADER,
-        1,
-        0,
-        PICOQUIC_MAX_PACKET_SIZE,
-        NULL, 0, 0,
-        NULL, 0,
-        NULL, 0,
-        1
-    },
-    {
-        ct_test_ack,
-        (uint32_t)sizeof(ct_test_ack),
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        0,
-        1,
-        (uint32_t)SIZEOF_1RTT_HEADER,
-        NULL, 0, 0,
-        NULL, 0,
-        NULL, 0,
-        1
-    },
-    {
-        NULL,
-        0,
-        0,
-        0,
-        1,
-        PICOQUIC_MAX_PACKET_SIZE,
-        NULL, 0, 0,
-        NULL, 0,
-        NULL, 0,
-        1
+static const picoquic_connection_id_t stash_test_init_remote =
+{ { 99, 99, 99, 99, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 };
+
+static const size_t nb_stash_test_case = sizeof(stash_test_case) / sizeof(picoquic_remote_cnxid_t);
+
+static int cnxid_stash_compare(int test_mode, picoquic_remote_cnxid_t * stashed, size_t i)
+{
+    int ret = 0;
+
+    if (stashed == NULL) {
+        DBG_PRINTF("Test %d, cannot dequeue cnxid %d.\n", test_mode, i);
+        ret = -1;
+    }
+    else if (stashed->sequence != stash_test_case[i].sequence) {
+        DBG_PRINTF("Test %d, cnxid %d, sequence %d instead of %d.\n", test_mode, i,
+            stashed->sequence, stash_test_case[i].sequence);
+        ret = -1;
+    }
+    else if (picoquic_compare_connection_id(&stashed->cnx_id, &stash_test_case[i].cnx_id) != 0) {
+        DBG_PRINTF("Test %d, cnxid %d, CNXID values do not match.\n", test_mode, i);
+        ret = -1;
+    }
+    else if (memcmp(&stashed->reset_secret, &stash_test_case[i].reset_secret, PICOQUIC_RESET_SECRET_SIZE) != 0) {
+        DBG_PRINTF("Test %d, cnxid %d, secrets do not match.\n", test_mode, i);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int cnxid_stash_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+    picoquic_quic_t * qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+
+
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    if (qclient == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        ret = -1;
+    }
+
+    /* First test: enqueue and dequeue immediately */
+    /* Second test: enqueue all and then dequeue - verify order */
+    /* Third test: enqueue all and then delete the connection */
+    for (int test_mode = 0; ret == 0 && test_mode < 3; test_mode++) {
+        picoquic_cnx_t * cnx = picoquic_create_cnx(qclient,
+            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1);
+
+        picoquic_remote_cnxid_t * stashed = NULL;
+
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
+            ret = -1;
+        } else {
+            /* init the various connection id to a length compatible with test */
+            cnx->path[0]->p_local_cnxid->cnx_id = stash_test_init_local;
+            cnx->path[0]->p_remote_cnxid->cnx_id = stash_test_init_remote;
+        }
+
+        for (size_t i = 0; ret == 0 && i < nb_stash_test_case; i++) {
+            uint64_t transport_error = picoquic_stash_remote_cnxid(cnx, 0, 0,
+                stash_test_case[i].sequence, stash_test_case[i].cnx_id.id_len,
+                stash_test_case[i].cnx_id.id, stash_test_case[i].reset_secret, &stashed);
+            if (transport_error != 0) {
+                DBG_PRINTF("Test %d, cannot stash cnxid %d, err 0x%" PRIx64 ".\n", test_mode, i, transport_error);
+                ret = -1;
+            } else {
+                if (stashed == NULL) {
+                    DBG_PRINTF("Test %d, cannot stash cnxid %d (duplicate).\n", test_mode, i);
+                    ret = -1;
+                }
+                else if (test_mode == 0) {
+                    stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
+                    stashed->nb_path_references++;
+                    ret = cnxid_stash_compare(test_mode, stashed, i);
+                }
+            }
+        }
+
+        /* Dequeue all in mode 1, verify order */
+        if (test_mode == 1) {
+            for (size_t i = 0; ret == 0 && i < nb_stash_test_case; i++) {
+                stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
+                stashed->nb_path_references++;
+                ret = cnxid_stash_compare(test_mode, stashed, i);
+            }
+        }
+
+        /* Verify nothing left in queue in mode 0, 1 */
+        if (test_mode < 2) {
+            stashed = picoquic_obtain_stashed_cnxid(cnx, 0);
+            if (stashed != NULL) {
+                DBG_PRINTF("Test %d, unexpected cnxid left, #%d.\n", test_mode, (int)stashed->sequence);
+                ret = -1;
+            }
+        }
+
+        /* Delete the connecton and free the stash */
+        picoquic_delete_cnx(cnx);
+    }
+
+    if (qclient != NULL) {
+        picoquic_free(qclient);
+    }
+
+    return ret;
+}
+
+int new_cnxid_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+    picoquic_quic_t * qclient = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    picoquic_cnx_t * cnx = NULL;
+    uint8_t frame_buffer[256];
+    size_t consumed = 0;
+
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 1000;
+
+    if (qclient == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        ret = -1;
+    } else {
+        cnx = picoquic_create_cnx(qclient,
+            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1);
+
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
+            ret = -1;
+        }
+        else {
+            /* Create a new local CID */
+            picoquic_local_cnxid_t* local_cid = picoquic_create_local_cnxid(cnx, 0, NULL, simulated_time);
+            picoquic_local_cnxid_list_t* local_cid_list = cnx->first_local_cnxid_list;
+            
+            if (local_cid == NULL || local_cid_list == NULL) {
+                DBG_PRINTF("%s", "Cannot create local cnxid\n");
+                ret = -1;
+            }
+
+            if (local_cid_list->nb_local_cnxid != 2) {
+                DBG_PRINTF("Expected 2 CID, got %d\n", local_cid_list->nb_local_cnxid);
+                ret = -1;
+            }
+            else if (local_cid_list->local_cnxid_first == NULL || local_cid_list->local_cnxid_first->next == NULL) {
+                DBG_PRINTF("%s", "Pointer to CID is NULL in cnx context\n");
+                ret = -1;
+            }
+
+            if (ret == 0) {
+                int more_data = 0;
+                int is_pure_ack = 1;
+                uint8_t* bytes_next = picoquic_format_new_connection_id_frame(cnx, local_cid_list, frame_buffer, frame_buffer + sizeof(frame_buffer),
+                    &more_data, &is_pure_ack, local_cid);
+
+                consumed = bytes_next - frame_buffer;
+
+                if (consumed == 0) {
+                    ret = -1;
+                    DBG_PRINTF("Cannot encode new connection ID frame, ret = %x\n", ret);
+                }
+            }
+
+            if (ret == 0) {
+                size_t skipped = 0;
+                int pure_ack = 0;
+
+                ret = picoquic_skip_frame(frame_buffer, sizeof(frame_buffer), &skipped, &pure_ack);
+
+                if (ret != 0) {
+                    DBG_PRINTF("Cannot skip connection ID frame, ret = %x\n", ret);
+                }
+                else if (skipped != consumed) {
+                    DBG_PRINTF("Skipped %d bytes instead of %d\n", (int)skipped, (int)consumed);
+                    ret = -1;
+                }
+                else if (pure_ack != 0) {
+                    DBG_PRINTF("Pure ACK = %d instead of 0\n", (int)pure_ack);
+                    ret = -1;
+                }
+            }
+            /* Delete the connecton and free the stash */
+            picoquic_delete_cnx(cnx);
+        }
+
+        picoquic_free(qclient);
+    }
+
+    return ret;
+}
+
+/*
+ * Test the copy for retransmit function
+ */
+
+#define SPLIT_FRAME_TEST_SOURCE_CONTENT_67 \
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, \
+   11, 12, 13, 14, 15, 16, 17, 18, 19, 20, \
+   21, 22, 23, 24, 25, 26, 27, 28, 29, 30, \
+   31, 32, 33, 34, 35, 36, 37, 38, 39, 40, \
+   41, 42, 43, 44, 45, 46, 47, 48, 49, 50, \
+   51, 52, 53, 54, 55, 56, 57, 58, 59, 60, \
+   61, 62, 63, 64, 65, 66, 67
+
+#define SPLIT_FRAME_TEST_SOURCE_CONTENT_INIT_32 \
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, \
+   11, 12, 13, 14, 15, 16, 17, 18, 19, 20, \
+   21, 22, 23, 24, 25, 26, 27, 28, 29, 30, \
+   31, 32
+
+#define SPLIT_FRAME_TEST_SOURCE_CONTENT_LAST_35 \
+   33, 34, 35, 36, 37, 38, 39, 40, \
+   41, 42, 43, 44, 45, 46, 47, 48, 49, 50, \
+   51, 52, 53, 54, 55, 56, 57, 58, 59, 60, \
+   61, 62, 63, 64, 65, 66, 67
+
+#define COPY_PACKET_CID_DEST 1,2,3,4,5,6,7,8
+
+#define SIZEOF_CID_DEST 8
+
+#define COPY_PACKET_HEADER_1RTT 0x43, COPY_PACKET_CID_DEST, 0, 0, 0, 1
+
+#define SIZEOF_1RTT_HEADER (SIZEOF_CID_DEST + 5)
+
+#define SPLIT_FRAME_TEST_SOURCE_68_77 68,69,70,71,72,73,74,75,76,77
+
+static uint8_t ct_stream0_data[] = { SPLIT_FRAME_TEST_SOURCE_CONTENT_67, SPLIT_FRAME_TEST_SOURCE_68_77 };
+
+static uint8_t ct_test_packet1[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min | 2, 0x00, 0x40, 67,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
+};
+
+static uint8_t ct_test_packet2[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min, 0x00,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_67 };
+
+static uint8_t ct_test_packet3[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min, 0x00,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_67, SPLIT_FRAME_TEST_SOURCE_68_77
+};
+
+static uint8_t ct_test_packet4[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
+    SPLIT_FRAME_TEST_SOURCE_68_77,
+    picoquic_frame_type_stream_range_min, 0x00,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
+};
+
+uint8_t ct_test_packet4_first_frame[] = {
+    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
+    SPLIT_FRAME_TEST_SOURCE_68_77 };
+
+static uint8_t ct_test_packet5[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
+    SPLIT_FRAME_TEST_SOURCE_68_77,
+    picoquic_frame_type_stream_range_min | 2, 0x00, 0x40, 67,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_67
+};
+
+static uint8_t ct_test_packet6[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_stream_range_min | 6, 0x00, 0x40, 67, 0x0A,
+    SPLIT_FRAME_TEST_SOURCE_68_77,
+    picoquic_frame_type_stream_range_min, 0x00,
+    SPLIT_FRAME_TEST_SOURCE_CONTENT_INIT_32
+};
+
+static uint8_t ct_test_mtu_probe[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_ping,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static uint8_t ct_test_ack[] = {
+    COPY_PACKET_HEADER_1RTT,
+    picoquic_frame_type_ack,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+typedef struct st_copy_retransmit_test_case_t {
+    uint8_t* packet;
+    uint32_t packet_length;
+    uint32_t offset;
+    int is_mtu_probe;
+    int is_ack_trap;
+    size_t copy_max;
+    uint8_t* b1_expected;
+    size_t b1_length;
+    size_t b1_offset;
+    uint8_t* b2_expected;
+    size_t b2_length;
+    uint8_t* b3_expected;
+    size_t b3_length;
+    int is_pure_ack_expected;
+} copy_retransmit_test_case_t;
+
+static copy_retransmit_test_case_t copy_retransmit_case[] = {
+    {
+        ct_test_packet1,
+        (uint32_t) sizeof(ct_test_packet1),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        PICOQUIC_MAX_PACKET_SIZE,
+        ct_test_packet1,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet1 + SIZEOF_1RTT_HEADER,
+        sizeof(ct_test_packet1) - SIZEOF_1RTT_HEADER,
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet2,
+        (uint32_t)sizeof(ct_test_packet2),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        PICOQUIC_MAX_PACKET_SIZE,
+        ct_test_packet1,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet2 + SIZEOF_1RTT_HEADER,
+        sizeof(ct_test_packet2) - SIZEOF_1RTT_HEADER,
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet2,
+        (uint32_t)sizeof(ct_test_packet2),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        (uint32_t) sizeof(ct_test_packet2),
+        ct_test_packet2,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet2 + SIZEOF_1RTT_HEADER,
+        sizeof(ct_test_packet2) - SIZEOF_1RTT_HEADER,
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet3,
+        (uint32_t) sizeof(ct_test_packet3),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        (uint32_t) sizeof(ct_test_packet3),
+        ct_test_packet3,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet3 + SIZEOF_1RTT_HEADER,
+        sizeof(ct_test_packet3) - SIZEOF_1RTT_HEADER,
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet4,
+        (uint32_t) sizeof(ct_test_packet4),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        (uint32_t) sizeof(ct_test_packet4),
+        ct_test_packet4,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet4_first_frame,
+        sizeof(ct_test_packet4_first_frame),
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet4,
+        (uint32_t) sizeof(ct_test_packet4),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        PICOQUIC_MAX_PACKET_SIZE,
+        ct_test_packet5,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet4_first_frame,
+        sizeof(ct_test_packet4_first_frame),
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_packet4,
+        (uint32_t) sizeof(ct_test_packet4),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        0,
+        0,
+        (uint32_t) sizeof(ct_test_packet6),
+        ct_test_packet6,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        ct_test_packet4_first_frame,
+        sizeof(ct_test_packet4_first_frame),
+        NULL,
+        0,
+        0
+    },
+    {
+        ct_test_mtu_probe,
+        (uint32_t) sizeof(ct_test_mtu_probe),
+        (uint32_t) SIZEOF_1RTT_HEADER,
+        1,
+        0,
+        PICOQUIC_MAX_PACKET_SIZE,
+        NULL, 0, 0,
+        NULL, 0,
+        NULL, 0,
+        1
+    },
+    {
+        ct_test_ack,
+        (uint32_t)sizeof(ct_test_ack),
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        0,
+        1,
+        (uint32_t)SIZEOF_1RTT_HEADER,
+        NULL, 0, 0,
+        NULL, 0,
+        NULL, 0,
+        1
+    },
+    {
+        NULL,
+        0,
+        0,
+        0,
+        1,
+        PICOQUIC_MAX_PACKET_SIZE,
+        NULL, 0, 0,
+        NULL, 0,
+        NULL, 0,
+        1
+    }
+};
+
+size_t nb_copy_retransmit_case = sizeof(copy_retransmit_case) / sizeof(copy_retransmit_test_case_t);
+
+int test_copy_for_retransmit()
+{
+    picoquic_quic_t * qtest = NULL;
+    picoquic_cnx_t * cnx = NULL;
+    int ret = 0;
+    picoquic_packet_t old_p;
+    uint8_t new_bytes[PICOQUIC_MAX_PACKET_SIZE];
+    size_t length = 0;
+    int packet_is_pure_ack = 0;
+    int do_not_detect_spurious = 1;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+
+    /* Initialize the connection context */
+    qtest = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    if (qtest == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        ret = -1;
+    }
+
+    /* Perform the tests */
+    for (size_t i = 0; ret == 0 && i < nb_copy_retransmit_case; i++) {
+        int add_to_data_repeat_queue = 0;
+
+        cnx = picoquic_create_cnx(qtest,
+            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1);
+
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
+            ret = -1;
+            break;
+        }
+        /* Initialize stream 0 */
+        if ((ret = picoquic_add_to_stream(cnx, 0, ct_stream0_data, sizeof(ct_stream0_data), 0)) != 0) {
+            DBG_PRINTF("%s", "Cannot initialize stream 0\n");
+            ret = -1;
+            break;
+        }
+
+        /* Initialize the old packet */
+        memset(&old_p, 0, sizeof(picoquic_packet_t));
+        if (copy_retransmit_case[i].packet_length > 0) {
+            memcpy(old_p.bytes, copy_retransmit_case[i].packet, copy_retransmit_case[i].packet_length);
+            old_p.length = copy_retransmit_case[i].packet_length;
+        }
+        old_p.offset = copy_retransmit_case[i].offset;
+        old_p.is_mtu_probe = copy_retransmit_case[i].is_mtu_probe;
+        old_p.is_ack_trap = copy_retransmit_case[i].is_ack_trap;
+        old_p.send_path = cnx->path[0];
+
+        length = copy_retransmit_case[i].b1_offset;
+
+        ret = picoquic_copy_before_retransmit(&old_p, cnx, new_bytes,
+            copy_retransmit_case[i].copy_max,
+            &packet_is_pure_ack,
+            &do_not_detect_spurious, 0,
+            &length,
+            &add_to_data_repeat_queue);
+
+        if (ret != 0) {
+            DBG_PRINTF("Cannot perform copy for test[%d]\n", i);
+        } else if (packet_is_pure_ack != copy_retransmit_case[i].is_pure_ack_expected) {
+            /* Check whether pure ack matches expectation */
+            DBG_PRINTF("Is pure ack mismatch on test[%d], got %d\n", i,
+                packet_is_pure_ack);
+            ret = -1;
+        }
+        else if (!packet_is_pure_ack) {
+            /* Compare bytes and length to expected */
+            if (length != copy_retransmit_case[i].b1_length) {
+                DBG_PRINTF("Length mismatch on test[%d], got %d vs %d\n", i,
+                    packet_is_pure_ack, length,
+                    copy_retransmit_case[i].b1_length);
+                ret = -1;
+            }
+            else if (memcmp(new_bytes + copy_retransmit_case[i].b1_offset,
+                copy_retransmit_case[i].b1_expected + copy_retransmit_case[i].b1_offset,
+                length - copy_retransmit_case[i].b1_offset) != 0) {
+                DBG_PRINTF("Value mismatch on test[%d]\n", i);
+                ret = -1;
+            }
+            else {
+                if (copy_retransmit_case[i].b2_expected == NULL) {
+                    if (add_to_data_repeat_queue) {
+                        DBG_PRINTF("Unexpected stream frame in test[%d]\n", i);
+                        ret = -1;
+                    }
+                }
+                else if (!add_to_data_repeat_queue) {
+                    DBG_PRINTF("Missing stream frame in test[%d]\n", i);
+                    ret = -1;
+                }
+
+                if (ret == 0) {
+                    if (copy_retransmit_case[i].b3_expected == NULL) {
+                        if (cnx->first_misc_frame != NULL) {
+                            DBG_PRINTF("Unexpected misc frame in test[%d]\n", i);
+                            ret = -1;
+                        }
+                    }
+                    else if (cnx->first_misc_frame == NULL) {
+                        DBG_PRINTF("Missing misc frame in test[%d]\n", i);
+                        ret = -1;
+                    }
+                    else if (copy_retransmit_case[i].b3_length != cnx->first_misc_frame->length) {
+                        DBG_PRINTF("Mismatching misc frame lenght in test[%d]\n", i);
+                        ret = -1;
+                    }
+                    else if (memcmp(((uint8_t*)cnx->first_misc_frame) + sizeof(picoquic_misc_frame_header_t),
+                        copy_retransmit_case[i].b3_expected, cnx->first_misc_frame->length) != 0) {
+                        DBG_PRINTF("Mismatching misc frame in test[%d]\n", i);
+                        ret = -1;
+                    }
+                }
+            }
+        }
+        /* Free the extra frames */
+        if (cnx != NULL) {
+            picoquic_delete_cnx(cnx);
+        }
+    }
+
+    /* Free the connection context */
+    if (qtest != NULL) {
+        picoquic_free(qtest);
+    }
+    return ret;
+}
+
+
+/* Test the formatting of frames queued in retransmit packets.
+ * We assume an API that looks inside the queued packet, find the
+ * next stream frame, and copy the next data for that frame.
+ * We need to consider the following cases:
+ * 
+ * 1- Just one data frame in the packet, and it fits.
+ * 2- Data frame does not fit in the packet, can only
+ *    encode the first bytes, update the index.
+ * 3- First bytes of data frame already sent, the
+ *    reminder fits, send it all.
+ * 4- First bytes of data frame already sent, the
+ *    reminder does not fit, send first bytes only.
+ * 5- Zero data, but need to send the FIN bit.
+ * Add: same as 3..5, but without explicit length.
+ * Add: same as 3..4, but FIN bit
+ * Add: same as 3..4, no length, FIN bit.
+ * Add: variants in which the outgoing frame must
+ * use zero-length encoding.
+ * Add: variants in which the outgoing frame must
+ * use zero-length encoding and one extra pad byte.
+ */
+
+static size_t dataqueue_prepare_packet(
+    picoquic_packet_t* packet, int has_length, int has_fin,
+    uint64_t stream_id, uint64_t offset, size_t frame_data_length)
+{
+    uint8_t* bytes = packet->bytes;
+    uint8_t* bytes_max = bytes + sizeof(packet->bytes);
+    size_t copied_index;
+
+    memset(packet, 0, sizeof(picoquic_packet_t));
+    packet->offset = 12;
+    packet->data_repeat_frame = 17;
+    packet->data_repeat_index = 17;
+    bytes += packet->data_repeat_frame;
+    *bytes = picoquic_frame_type_stream_range_min;
+    if (has_length) {
+        *bytes |= 2;
+    }
+    if (has_fin) {
+        *bytes |= 1;
+    }
+    *bytes++ |= 4;
+    bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id);
+    bytes = picoquic_frames_varint_encode(bytes, bytes_max, offset);
+    if (has_length) {
+        bytes = picoquic_frames_varint_encode(bytes, bytes_max, frame_data_length);
+    }
+    copied_index =  packet->data_repeat_frame + (bytes - (packet->bytes + packet->data_repeat_frame));
+    for (size_t i = 0; i < frame_data_length; i++) {
+        *bytes++ = (uint8_t)(i + 1);
+    }
+    packet->length = bytes - packet->bytes;
+
+    return copied_index;
+}
+
+static int dataqueue_prepare_test(int basic_case, int has_length, int has_fin,
+    picoquic_packet_t* packet,
+    size_t * next_frame, size_t * next_index, size_t * buffer_size, size_t * frame_length,
+    uint8_t* data, size_t length_max)
+{
+    int ret = 0;
+    /* Prepare the packet header before the call.
+     *  -1: point to frame. If "no length", set length at final byte.
+     *      If length, add padding.
+     *      next frame and index point after the length.
+     *  -2: same as 1. Must limit the available buffer size.
+     *      next frame pointer unchanged, index after sent byte.
+     *  -3: init same as 1. Index before points to data.
+     *      next frame and index point after the length.
+     *      datasize must be limited.
+     *  -4: init same as 1. Index before points to data.
+     *      Must limit the available buffer size.
+     *      next frame pointer unchanged, index after sent byte.
+     *  -5: init just a header. either last byte or not.
+     * 
+     */
+    uint8_t* bytes;
+    uint8_t* bytes_max;
+    uint8_t* frame_data;
+    uint64_t offset = 1023;
+    uint64_t copied_index = 0;
+    uint64_t copied_offset = offset;
+    uint64_t stream_id = 8;
+    size_t frame_data_length = 2 * 65;
+    size_t copied_length;
+    size_t extra_byte = 0;
+    int copied_fin = has_fin;
+    int constrained_buffer = 0;
+
+    if (basic_case == 5) {
+        frame_data_length = 0;
+    }
+
+    copied_index = dataqueue_prepare_packet(packet, has_length, has_fin,
+        stream_id, offset, frame_data_length);
+    frame_data = packet->bytes + copied_index;
+
+    switch (basic_case) {
+    case 2:
+        copied_length = frame_data_length/2;
+        *next_frame = packet->data_repeat_frame;
+        *next_index = (frame_data + copied_length) - packet->bytes;
+        copied_fin = 0;
+        constrained_buffer = 1;
+        break;
+    case 3:
+        packet->data_repeat_index = (frame_data + frame_data_length/2) - packet->bytes;
+        copied_index += frame_data_length/2;
+        copied_offset += frame_data_length/2;
+        copied_length = frame_data_length - frame_data_length/2;
+        *next_frame = packet->length;
+        *next_index = packet->length;
+        break;
+    case 4:
+        constrained_buffer = 1;
+        copied_length = frame_data_length;
+        *next_frame = packet->length;
+        *next_index = packet->length;
+        break;
+    case 6:
+        constrained_buffer = 1;
+        copied_length = frame_data_length;
+        *next_frame = packet->length;
+        *next_index = packet->length;
+        extra_byte = 1;
+        break;
+    case 1:
+    default:
+        copied_length = frame_data_length;
+        *next_frame = packet->length;
+        *next_index = packet->length;
+        break;
+    }
+
+    /* Prepare the outcoming buffer: */
+    *buffer_size = 0;
+    *frame_length = 0;
+    bytes = data;
+    bytes_max = data + length_max;
+    ret = -1;
+    if (bytes + extra_byte < bytes_max) {
+        if (extra_byte) {
+            *bytes++ = 0;
+        }
+        *bytes = picoquic_frame_type_stream_range_min;
+        if (!constrained_buffer) {
+            /* Use length encoding */
+            *bytes |= 2;
+        }
+        if (copied_fin) {
+            *bytes |= 1;
+        }
+        *bytes++ |= 4;
+        if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id)) != NULL &&
+            (bytes = picoquic_frames_varint_encode(bytes, bytes_max, copied_offset)) != NULL) {
+            if (!constrained_buffer) {
+                bytes = picoquic_frames_varint_encode(bytes, bytes_max, copied_length);
+            }
+        }
+        if (bytes != NULL && bytes + copied_length < bytes_max) {
+            memcpy(bytes, packet->bytes + copied_index, copied_length);
+            bytes += copied_length;
+            ret = 0;
+        }
+        else {
+            bytes = NULL;
+            ret = -1;
+        }
+    }
+    if (ret == 0){
+        *frame_length = bytes - data;
+        if (!constrained_buffer) {
+            for (int i = 0; i < 4 && bytes < bytes_max; i++) {
+                *bytes++ = 1; /* add a ping frame... */
+            }
+        }
+        *buffer_size = bytes - data;
     }
-};
 
-size_t nb_copy_retransmit_case = sizeof(copy_retransmit_case) / sizeof(copy_retransmit_test_case_t);
+    return ret;
+}
 
-int test_copy_for_retransmit()
+static size_t dataqueue_verify_test(picoquic_packet_t* packet,
+    size_t next_frame, size_t next_index, size_t frame_length,
+    uint8_t* data, uint8_t *output, size_t output_length)
 {
-    picoquic_quic_t * qtest = NULL;
-    picoquic_cnx_t * cnx = NULL;
     int ret = 0;
-    picoquic_packet_t old_p;
-    uint8_t new_bytes[PICOQUIC_MAX_PACKET_SIZE];
-    size_t length = 0;
-    int packet_is_pure_ack = 0;
-    int do_not_detect_spurious = 1;
-    uint64_t simulated_time = 0;
-    struct sockaddr_in saddr;
+    if (packet->data_repeat_frame != next_frame) {
+        DBG_PRINTF("Expected frame at %zu, got %zu", packet->data_repeat_frame, next_frame);
+        ret = -1;
+    }
+    else if (packet->data_repeat_index != next_index) {
+        DBG_PRINTF("Expected index at %zu, got %zu", packet->data_repeat_index, next_index);
+        ret = -1;
+    }
+    else if (output_length != frame_length) {
+        DBG_PRINTF("Expected frame length %zu, got %zu", frame_length, output_length);
+        ret = -1;
+    }
+    else if (memcmp(data, output, output_length) != 0) {
+        DBG_PRINTF("%s", "Produced frame does not match");
+        ret = -1;
+    }
+    return ret;
+}
 
-    memset(&saddr, 0, sizeof(struct sockaddr_in));
+int dataqueue_copy_test()
+{
+    int ret = 0;
+    picoquic_packet_t packet;
+    uint8_t data[1536];
+    uint8_t output[1536];
+    size_t length_max = 1536;
 
-    /* Initialize the connection context */
-    qtest = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
-        NULL, NULL, NULL, NULL, simulated_time,
-        &simulated_time, NULL, NULL, 0);
-    if (qtest == NULL) {
-        DBG_PRINTF("%s", "Cannot create QUIC context\n");
-        ret = -1;
+    for (int case_opt = 0; ret == 0 && case_opt < 5; case_opt++) {
+        int has_length = (case_opt & 1) == 0;
+        int has_fin = (case_opt & 2) == 2;
+
+        for (int basic_case = 1; ret == 0 && basic_case <= 6; basic_case++) {
+            size_t next_frame = 0;
+            size_t next_index = 0;
+            size_t buffer_size = 0;
+            size_t frame_length = 0;
+
+            ret = dataqueue_prepare_test(basic_case, has_length, has_fin, &packet,
+                &next_frame, &next_index, &buffer_size, &frame_length, data, length_max);
+
+            if (ret != 0) {
+                DBG_PRINTF("Prepare test fails for case %d, option &x", basic_case, case_opt);
+                ret = -1;
+            }
+            else {
+                uint8_t* next_byte = picoquic_copy_stream_frame_for_retransmit(
+                    NULL, &packet, output, output + buffer_size);
+                if (next_byte == NULL) {
+                    DBG_PRINTF("Copy stream frame fails for case %d, option &x", basic_case, case_opt);
+                    ret = -1;
+                }
+                else
+                {
+                    size_t output_length = next_byte - output;
+                    if (dataqueue_verify_test(&packet, next_frame, next_index, frame_length, data, output, output_length) != 0) {
+                        DBG_PRINTF("Verify data fails for case %d, option &x", basic_case, case_opt);
+                        ret = -1;
+                    }
+                }
+            }
+        }
     }
 
-    /* Perform the tests */
-    for (size_t i = 0; ret == 0 && i < nb_copy_retransmit_case; i++) {
-        int add_to_data_repeat_queue = 0;
+    return ret;
+}
 
-        cnx = picoquic_create_cnx(qtest,
-            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr *) &saddr,
-            simulated_time, 0, "test-sni", "test-alpn", 1);
+/* Test the API picoquic_copy_stream_frames_for_retransmit
+* Create a connection.
+* Create a data queue packet with 256 bytes of data.
+* First call: buffer size < min size. Expect "more data" to
+* be set, but no data sent. ACK only is expected.
+* Second call: buffer size < packet size. Expect buffer to
+* be filled with data. More data should be set. ACK only = 0.
+* Third call: large buffer size. Expect large packet. More data
+* should not be set. ACK only = 0. 
+* Fourth call: large buffer size. Expect no data, more data=0,
+* ACK only = 1.
+* Add another packet in the queue, or maybe two.
+* Clean everything. The ASAN/UBSAN run will detect any memory leak.
+ */
 
-        if (cnx == NULL) {
-            DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
+int dataqueue_packet_test_iterate(int test_id, picoquic_cnx_t* cnx, size_t buffer_size, int expect_data, int expect_more_data, int expect_is_pure_ack)
+{
+    int ret = 0;
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    int more_data = 0;
+    int is_pure_ack = 1;
+    uint8_t* next_bytes = picoquic_copy_stream_frames_for_retransmit(cnx, buffer, buffer + buffer_size, UINT64_MAX, &more_data, &is_pure_ack);
+
+    if (next_bytes == NULL) {
+        DBG_PRINTF("Test %d, returns NULL", test_id);
+        ret = -1;
+    }
+    else {
+        int has_data = next_bytes > buffer;
+
+        if (has_data && !expect_data) {
+            DBG_PRINTF("Test %d, got data, not expected", test_id);
             ret = -1;
-            break;
-        }
-        /* Initialize stream 0 */
-        if ((ret = picoquic_add_to_stream(cnx, 0, ct_stream0_data, sizeof(ct_stream0_data), 0)) != 0) {
-            DBG_PRINTF("%s", "Cannot initialize stream 0\n");
+        } else if (!has_data && expect_data) {
+            DBG_PRINTF("Test %d, no data, some expected", test_id);
+            ret = -1;
+        } else if (more_data && !expect_more_data) {
+            DBG_PRINTF("Test %d, more data not expected", test_id);
+            ret = -1;
+        }  else if (!more_data && expect_more_data) {
+            DBG_PRINTF("Test %d, more data expected", test_id);
+            ret = -1;
+        } else if (is_pure_ack && !expect_is_pure_ack) {
+            DBG_PRINTF("Test %d, unexpected pure ACK", test_id);
+            ret = -1;
+        } else if (!is_pure_ack && expect_is_pure_ack) {
+            DBG_PRINTF("Test %d, pure ACK expected", test_id);
             ret = -1;
-            break;
-        }
-
-        /* Initialize the old packet */
-        memset(&old_p, 0, sizeof(picoquic_packet_t));
-        if (copy_retransmit_case[i].packet_length > 0) {
-            memcpy(old_p.bytes, copy_retransmit_case[i].packet, copy_retransmit_case[i].packet_length);
-            old_p.length = copy_retransmit_case[i].packet_length;
         }
-        old_p.offset = copy_retransmit_case[i].offset;
-        old_p.is_mtu_probe = copy_retransmit_case[i].is_mtu_probe;
-        old_p.is_ack_trap = copy_retransmit_case[i].is_ack_trap;
-        old_p.send_path = cnx->path[0];
+    }
+    return ret;
+}
 
-        length = copy_retransmit_case[i].b1_offset;
+int dataqueue_packet_test()
+{
+    picoquic_quic_t* qtest = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
 
-        ret = picoquic_copy_before_retransmit(&old_p, cnx, new_bytes,
-            copy_retransmit_case[i].copy_max,
-            &packet_is_pure_ack,
-            &do_not_detect_spurious, 0,
-            &length,
-            &add_to_data_repeat_queue);
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
 
-        if (ret != 0) {
-            DBG_PRINTF("Cannot perform copy for test[%d]\n", i);
-        } else if (packet_is_pure_ack != copy_retransmit_case[i].is_pure_ack_expected) {
-            /* Check whether pure ack matches expectation */
-            DBG_PRINTF("Is pure ack mismatch on test[%d], got %d\n", i,
-                packet_is_pure_ack);
+    /* Initialize the connection context */
+    if (ret == 0) {
+        qtest = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+            NULL, NULL, NULL, NULL, simulated_time,
+            &simulated_time, NULL, NULL, 0);
+        if (qtest == NULL) {
+            DBG_PRINTF("%s", "Cannot create QUIC context\n");
             ret = -1;
         }
-        else if (!packet_is_pure_ack) {
-            /* Compare bytes and length to expected */
-            if (length != copy_retransmit_case[i].b1_length) {
-                DBG_PRINTF("Length mismatch on test[%d], got %d vs %d\n", i,
-                    packet_is_pure_ack, length,
-                    copy_retransmit_case[i].b1_length);
-                ret = -1;
-            }
-            else if (memcmp(new_bytes + copy_retransmit_case[i].b1_offset,
-                copy_retransmit_case[i].b1_expected + copy_retransmit_case[i].b1_offset,
-                length - copy_retransmit_case[i].b1_offset) != 0) {
-                DBG_PRINTF("Value mismatch on test[%d]\n", i);
+        else {
+            cnx = picoquic_create_cnx(qtest,
+                picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*) & saddr,
+                simulated_time, 0, "test-sni", "test-alpn", 1);
+
+            if (cnx == NULL) {
                 ret = -1;
             }
             else {
-                if (copy_retransmit_case[i].b2_expected == NULL) {
-                    if (add_to_data_repeat_queue) {
-                        DBG_PRINTF("Unexpected stream frame in test[%d]\n", i);
-                        ret = -1;
-                    }
-                }
-                else if (!add_to_data_repeat_queue) {
-                    DBG_PRINTF("Missing stream frame in test[%d]\n", i);
+                /* Create stream 0 so the later tests succeed */
+                uint8_t new_bytes[256];
+                memset(new_bytes, 0, sizeof(new_bytes));
+                if ((ret = picoquic_add_to_stream(cnx, 0, new_bytes, sizeof(new_bytes), 0)) != 0) {
+                    DBG_PRINTF("%s", "Cannot initialize stream 0\n");
                     ret = -1;
                 }
-
-                if (ret == 0) {
-                    if (copy_retransmit_case[i].b3_expected == NULL) {
-                        if (cnx->first_misc_frame != NULL) {
-                            DBG_PRINTF("Unexpected misc frame in test[%d]\n", i);
-                            ret = -1;
-                        }
-                    }
-                    else if (cnx->first_misc_frame == NULL) {
-                        DBG_PRINTF("Missing misc frame in test[%d]\n", i);
-                        ret = -1;
-                    }
-                    else if (copy_retransmit_case[i].b3_length != cnx->first_misc_frame->length) {
-                        DBG_PRINTF("Mismatching misc frame lenght in test[%d]\n", i);
-                        ret = -1;
-                    }
-                    else if (memcmp(((uint8_t*)cnx->first_misc_frame) + sizeof(picoquic_misc_frame_header_t),
-                        copy_retransmit_case[i].b3_expected, cnx->first_misc_frame->length) != 0) {
-                        DBG_PRINTF("Mismatching misc frame in test[%d]\n", i);
-                        ret = -1;
-                    }
-                }
             }
         }
-        /* Free the extra frames */
-        if (cnx != NULL) {
-            picoquic_delete_cnx(cnx);
+    }
+
+    if (ret == 0) {
+        /* Create a packet and chain it to the data queue */
+        picoquic_packet_t* packet = picoquic_create_packet(qtest);
+        if (packet == NULL) {
+            ret = -1;
+        }
+        else {
+            (void)dataqueue_prepare_packet(packet, 1, 0, 0, 0, 256);
+            picoquic_queue_data_repeat_packet(cnx, packet);
+        }
+    }
+
+    if (ret == 0 &&
+        (ret = dataqueue_packet_test_iterate(1, cnx, 2, 0, 1, 1)) == 0 &&
+        (ret = dataqueue_packet_test_iterate(2, cnx, 128, 1, 1, 0)) == 0 &&
+        (ret = dataqueue_packet_test_iterate(3, cnx, 1024, 1, 0, 0)) == 0) {
+        ret = dataqueue_packet_test_iterate(4, cnx, 1024, 0, 0, 1);
+    }
+
+    if (ret == 0) {
+        /* Create a packet and chain it to the data queue */
+        picoquic_packet_t* packet = picoquic_create_packet(qtest);
+        if (packet == NULL) {
+            ret = -1;
+        }
+        else {
+            (void)dataqueue_prepare_packet(packet, 1, 0, 0, 0, 256);
+            picoquic_dequeue_data_repeat_packet(cnx, packet);
         }
     }
 
     /* Free the connection context */
+    if (cnx != NULL) {
+        picoquic_delete_cnx(cnx);
+    }
+
     if (qtest != NULL) {
         picoquic_free(qtest);
     }
     return ret;
 }
 
+/* Testing the sending of blocked frames */
+struct st_stream_blocked_test_t {
+    uint64_t stream_id;
+    int is_id_blocked;
+    int is_data_blocked;
+    int is_client;
+    int expect_bidir_blocked;
+    int expect_unidir_blocked;
+    int expect_data_blocked;
+};
 
-/* Test the formatting of frames queued in retransmit packets.
- * We assume an API that looks inside the queued packet, find the
- * next stream frame, and copy the next data for that frame.
- * We need to consider the following cases:
- * 
- * 1- Just one data frame in the packet, and it fits.
- * 2- Data frame does not fit in the packet, can only
- *    encode the first bytes, update the index.
- * 3- First bytes of data frame already sent, the
- *    reminder fits, send it all.
- * 4- First bytes of data frame already sent, the
- *    reminder does not fit, send first bytes only.
- * 5- Zero data, but need to send the FIN bit.
- * Add: same as 3..5, but without explicit length.
- * Add: same as 3..4, but FIN bit
- * Add: same as 3..4, no length, FIN bit.
- * Add: variants in which the outgoing frame must
- * use zero-length encoding.
- * Add: variants in which the outgoing frame must
- * use zero-length encoding and one extra pad byte.
- */
-
-static size_t dataqueue_prepare_packet(
-    picoquic_packet_t* packet, int has_length, int has_fin,
-    uint64_t stream_id, uint64_t offset, size_t frame_data_length)
-{
-    uint8_t* bytes = packet->bytes;
-    uint8_t* bytes_max = bytes + sizeof(packet->bytes);
-    size_t copied_index;
-
-    memset(packet, 0, sizeof(picoquic_packet_t));
-    packet->offset = 12;
-    packet->data_repeat_frame = 17;
-    packet->data_repeat_index = 17;
-    bytes += packet->data_repeat_frame;
-    *bytes = picoquic_frame_type_stream_range_min;
-    if (has_length) {
-        *bytes |= 2;
-    }
-    if (has_fin) {
-        *bytes |= 1;
-    }
-    *bytes++ |= 4;
-    bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id);
-    bytes = picoquic_frames_varint_encode(bytes, bytes_max, offset);
-    if (has_length) {
-        bytes = picoquic_frames_varint_encode(bytes, bytes_max, frame_data_length);
-    }
-    copied_index =  packet->data_repeat_frame + (bytes - (packet->bytes + packet->data_repeat_frame));
-    for (size_t i = 0; i < frame_data_length; i++) {
-        *bytes++ = (uint8_t)(i + 1);
-    }
-    packet->length = bytes - packet->bytes;
+static const struct st_stream_blocked_test_t stream_blocked_test[] = {
+    { 4, 1, 0, 1, 1, 0, 0},
+    { 4, 1, 1, 0, 0, 0, 1},
+    { 4, 0, 1, 0, 0, 0, 1}
+};
 
-    return copied_index;
-}
+static const size_t nb_stream_blocked_test = sizeof(stream_blocked_test) / sizeof(struct st_stream_blocked_test_t);
 
-static int dataqueue_prepare_test(int basic_case, int has_length, int has_fin,
-    picoquic_packet_t* packet,
-    size_t * next_frame, size_t * next_index, size_t * buffer_size, size_t * frame_length,
-    uint8_t* data, size_t length_max)
+int send_stream_blocked_test_one(const struct st_stream_blocked_test_t * test)
 {
     int ret = 0;
-    /* Prepare the packet header before the call.
-     *  -1: point to frame. If "no length", set length at final byte.
-     *      If length, add padding.
-     *      next frame and index point after the length.
-     *  -2: same as 1. Must limit the available buffer size.
-     *      next frame pointer unchanged, index after sent byte.
-     *  -3: init same as 1. Index before points to data.
-     *      next frame and index point after the length.
-     *      datasize must be limited.
-     *  -4: init same as 1. Index before points to data.
-     *      Must limit the available buffer size.
-     *      next frame pointer unchanged, index after sent byte.
-     *  -5: init just a header. either last byte or not.
-     * 
-     */
-    uint8_t* bytes;
-    uint8_t* bytes_max;
-    uint8_t* frame_data;
-    uint64_t offset = 1023;
-    uint64_t copied_index = 0;
-    uint64_t copied_offset = offset;
-    uint64_t stream_id = 8;
-    size_t frame_data_length = 2 * 65;
-    size_t copied_length;
-    size_t extra_byte = 0;
-    int copied_fin = has_fin;
-    int constrained_buffer = 0;
+    uint8_t buf[1024];
+    uint8_t bytes[1024];
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    picoquic_cnx_t * cnx = NULL;
+    struct sockaddr_storage addr;
+    picoquic_stream_head_t* stream = NULL;
 
-    if (basic_case == 5) {
-        frame_data_length = 0;
+    if (quic == NULL) {
+        ret = -1;
+    }
+    else {
+        ret = picoquic_store_text_addr(&addr, "10.0.0.1", 1234);
+        if (ret == 0) {
+            cnx = picoquic_create_client_cnx(quic, (struct sockaddr*) & addr, simulated_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, NULL, NULL);
+            if (cnx == NULL) {
+                ret = -1;
+            }
+        }
     }
 
-    copied_index = dataqueue_prepare_packet(packet, has_length, has_fin,
-        stream_id, offset, frame_data_length);
-    frame_data = packet->bytes + copied_index;
+    if (ret == 0) {
+        /* Setup the initial conditions */
+        if (!test->is_client) {
+            cnx->client_mode = 0;
+        }
+        if (test->is_id_blocked) {
+            cnx->remote_parameters.initial_max_stream_id_bidir = 1;
+            cnx->remote_parameters.initial_max_stream_id_unidir = 0;
+        }
+        else {
+            cnx->remote_parameters.initial_max_stream_id_bidir = 64;
+            cnx->remote_parameters.initial_max_stream_id_unidir = 64;
+        }
 
-    switch (basic_case) {
-    case 2:
-        copied_length = frame_data_length/2;
-        *next_frame = packet->data_repeat_frame;
-        *next_index = (frame_data + copied_length) - packet->bytes;
-        copied_fin = 0;
-        constrained_buffer = 1;
-        break;
-    case 3:
-        packet->data_repeat_index = (frame_data + frame_data_length/2) - packet->bytes;
-        copied_index += frame_data_length/2;
-        copied_offset += frame_data_length/2;
-        copied_length = frame_data_length - frame_data_length/2;
-        *next_frame = packet->length;
-        *next_index = packet->length;
-        break;
-    case 4:
-        constrained_buffer = 1;
-        copied_length = frame_data_length;
-        *next_frame = packet->length;
-        *next_index = packet->length;
-        break;
-    case 6:
-        constrained_buffer = 1;
-        copied_length = frame_data_length;
-        *next_frame = packet->length;
-        *next_index = packet->length;
-        extra_byte = 1;
-        break;
-    case 1:
-    default:
-        copied_length = frame_data_length;
-        *next_frame = packet->length;
-        *next_index = packet->length;
-        break;
-    }
+        cnx->max_stream_id_bidir_remote = STREAM_ID_FROM_RANK(
+            cnx->remote_parameters.initial_max_stream_id_bidir, cnx->client_mode, 0);
+        cnx->max_stream_id_unidir_remote = STREAM_ID_FROM_RANK(
+            cnx->remote_parameters.initial_max_stream_id_unidir, cnx->client_mode, 1);
 
-    /* Prepare the outcoming buffer: */
-    *buffer_size = 0;
-    *frame_length = 0;
-    bytes = data;
-    bytes_max = data + length_max;
-    ret = -1;
-    if (bytes + extra_byte < bytes_max) {
-        if (extra_byte) {
-            *bytes++ = 0;
+        if (test->is_data_blocked) {
+            cnx->remote_parameters.initial_max_stream_data_bidi_local = 0;
+            cnx->remote_parameters.initial_max_stream_data_bidi_remote = 0;
+            cnx->remote_parameters.initial_max_stream_data_uni = 0;
+            cnx->remote_parameters.initial_max_data = PICOQUIC_DEFAULT_0RTT_WINDOW;
         }
-        *bytes = picoquic_frame_type_stream_range_min;
-        if (!constrained_buffer) {
-            /* Use length encoding */
-            *bytes |= 2;
+        else {
+            cnx->remote_parameters.initial_max_stream_data_bidi_local = 100000;
+            cnx->remote_parameters.initial_max_stream_data_bidi_remote = 100000;
+            cnx->remote_parameters.initial_max_stream_data_uni = 100000;
+            cnx->remote_parameters.initial_max_data = 1000000;
         }
-        if (copied_fin) {
-            *bytes |= 1;
+        cnx->maxdata_remote = cnx->remote_parameters.initial_max_data;
+
+        /* Create the stream so it picks the required parameters */
+        stream = picoquic_create_stream(cnx, test->stream_id);
+        if (stream != NULL) {
+            memset(buf, 0, sizeof(buf));
+            ret = picoquic_add_to_stream(cnx, test->stream_id, buf, sizeof(buf), 0);
         }
-        *bytes++ |= 4;
-        if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id)) != NULL &&
-            (bytes = picoquic_frames_varint_encode(bytes, bytes_max, copied_offset)) != NULL) {
-            if (!constrained_buffer) {
-                bytes = picoquic_frames_varint_encode(bytes, bytes_max, copied_length);
+        if (stream == NULL) {
+            DBG_PRINTF("Could not find stream #%d", (int)test->stream_id);
+            ret = -1;
+        }
+        if (ret == 0) {
+            /* Call the blocked frame API */
+            uint8_t* bytes_next;
+            int is_pure_ack = 1;
+            int more_data = 0;
+
+            bytes_next = picoquic_format_one_blocked_frame(cnx, bytes, bytes + sizeof(bytes), &more_data, &is_pure_ack, stream);
+
+            if (bytes_next != bytes && (is_pure_ack || more_data)) {
+                DBG_PRINTF("Error formatting blocked frames, stream: %" PRIu64", length: %zu, more: %d, pure ack: %d",
+                    test->stream_id, bytes_next - bytes, more_data, is_pure_ack);
+                ret = -1;
             }
         }
-        if (bytes != NULL && bytes + copied_length < bytes_max) {
-            memcpy(bytes, packet->bytes + copied_index, copied_length);
-            bytes += copied_length;
-            ret = 0;
+
+        if (ret == 0 &&
+            test->expect_bidir_blocked != cnx->stream_blocked_bidir_sent){
+            DBG_PRINTF("Stream blocked bidir: %d vs %d", test->expect_bidir_blocked, cnx->stream_blocked_bidir_sent);
+            ret = -1;
         }
-        else {
-            bytes = NULL;
+
+        if (ret == 0 &&
+            test->expect_unidir_blocked != cnx->stream_blocked_unidir_sent) {
+            DBG_PRINTF("Stream blocked bidir: %d vs %d", test->expect_unidir_blocked, cnx->stream_blocked_unidir_sent);
             ret = -1;
         }
-    }
-    if (ret == 0){
-        *frame_length = bytes - data;
-        if (!constrained_buffer) {
-            for (int i = 0; i < 4 && bytes < bytes_max; i++) {
-                *bytes++ = 1; /* add a ping frame... */
-            }
+
+        if (ret == 0 &&
+            test->expect_data_blocked != stream->stream_data_blocked_sent) {
+            DBG_PRINTF("Stream data blocked: %d vs %d", test->expect_data_blocked, stream->stream_data_blocked_sent);
+            ret = -1;
         }
-        *buffer_size = bytes - data;
+
+    }
+    
+
+    if (quic != NULL) {
+        picoquic_free(quic);
     }
 
     return ret;
 }
 
-static size_t dataqueue_verify_test(picoquic_packet_t* packet,
-    size_t next_frame, size_t next_index, size_t frame_length,
-    uint8_t* data, uint8_t *output, size_t output_length)
+int send_stream_blocked_test()
 {
     int ret = 0;
-    if (packet->data_repeat_frame != next_frame) {
-        DBG_PRINTF("Expected frame at %zu, got %zu", packet->data_repeat_frame, next_frame);
-        ret = -1;
-    }
-    else if (packet->data_repeat_index != next_index) {
-        DBG_PRINTF("Expected index at %zu, got %zu", packet->data_repeat_index, next_index);
-        ret = -1;
-    }
-    else if (output_length != frame_length) {
-        DBG_PRINTF("Expected frame length %zu, got %zu", frame_length, output_length);
-        ret = -1;
-    }
-    else if (memcmp(data, output, output_length) != 0) {
-        DBG_PRINTF("%s", "Produced frame does not match");
-        ret = -1;
+
+    for (size_t i = 0; ret == 0 && i < nb_stream_blocked_test; i++) {
+        if ((ret = send_stream_blocked_test_one(&stream_blocked_test[i])) != 0) {
+            DBG_PRINTF("Stream blocked test %d failed", (int)i);
+        }
     }
+
     return ret;
 }
 
-int dataqueue_copy_test()
+/* Verify that data queued with picoquic_add_to_stream and picoquic_add_to_stream_owned
+ * is sent in order, that owned buffers are referenced without copy, and that
+ * they are released exactly once, whether sent or abandoned. */
+#define STREAM_OWNED_NB_CHUNKS 64
+#define STREAM_OWNED_CHUNK_SIZE 100
+
+static void stream_owned_test_free(uint8_t* data, void* free_ctx)
+{
+    int* nb_freed = (int*)free_ctx;
+
+    (*nb_freed)++;
+    free(data);
+}
+
+int stream_owned_test()
 {
     int ret = 0;
-    picoquic_packet_t packet;
-    uint8_t data[1536];
-    uint8_t output[1536];
-    size_t length_max = 1536;
+    uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    picoquic_cnx_t* cnx = NULL;
+    struct sockaddr_storage addr;
+    picoquic_stream_head_t* stream = NULL;
+    int nb_owned = 0;
+    int nb_freed = 0;
 
-    for (int case_opt = 0; ret == 0 && case_opt < 5; case_opt++) {
-        int has_length = (case_opt & 1) == 0;
-        int has_fin = (case_opt & 2) == 2;
+    if (quic == NULL) {
+        ret = -1;
+    }
+    else {
+        ret = picoquic_store_text_addr(&addr, "10.0.0.1", 1234);
+        if (ret == 0) {
+            cnx = picoquic_create_client_cnx(quic, (struct sockaddr*) & addr, simulated_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, NULL, NULL);
+            if (cnx == NULL) {
+                ret = -1;
+            }
+        }
+    }
 
-        for (int basic_case = 1; ret == 0 && basic_case <= 6; basic_case++) {
-            size_t next_frame = 0;
-            size_t next_index = 0;
-            size_t buffer_size = 0;
-            size_t frame_length = 0;
+    if (ret == 0) {
+        cnx->remote_parameters.initial_max_stream_id_bidir = 64;
+        cnx->max_stream_id_bidir_remote = STREAM_ID_FROM_RANK(
+            cnx->remote_parameters.initial_max_stream_id_bidir, cnx->client_mode, 0);
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = 1000000;
+        cnx->remote_parameters.initial_max_data = 1000000;
+        cnx->maxdata_remote = cnx->remote_parameters.initial_max_data;
 
-            ret = dataqueue_prepare_test(basic_case, has_length, has_fin, &packet,
-                &next_frame, &next_index, &buffer_size, &frame_length, data, length_max);
+        if ((stream = picoquic_create_stream(cnx, 4)) == NULL) {
+            ret = -1;
+        }
+    }
 
-            if (ret != 0) {
-                DBG_PRINTF("Prepare test fails for case %d, option &x", basic_case, case_opt);
-                ret = -1;
+    /* Alternate copied and owned chunks */
+    for (int i = 0; ret == 0 && i < STREAM_OWNED_NB_CHUNKS; i++) {
+        uint8_t* chunk = (uint8_t*)malloc(STREAM_OWNED_CHUNK_SIZE);
+
+        if (chunk == NULL) {
+            ret = -1;
+        }
+        else {
+            memset(chunk, i, STREAM_OWNED_CHUNK_SIZE);
+            if ((i & 1) == 0) {
+                ret = picoquic_add_to_stream(cnx, 4, chunk, STREAM_OWNED_CHUNK_SIZE, 0);
+                free(chunk);
+            }
+            else if ((ret = picoquic_add_to_stream_owned(cnx, 4, chunk, STREAM_OWNED_CHUNK_SIZE, 0, NULL,
+                stream_owned_test_free, &nb_freed)) != 0) {
+                free(chunk);
             }
             else {
-                uint8_t* next_byte = picoquic_copy_stream_frame_for_retransmit(
-                    NULL, &packet, output, output + buffer_size);
-                if (next_byte == NULL) {
-                    DBG_PRINTF("Copy stream frame fails for case %d, option &x", basic_case, case_opt);
+                nb_owned++;
+                if (stream->send_queue_last == NULL || stream->send_queue_last->bytes != chunk ||
+                    stream->send_queue_last->next_stream_data != NULL) {
+                    DBG_PRINTF("Owned chunk %d is not referenced at the tail of the queue", i);
                     ret = -1;
                 }
-                else
-                {
-                    size_t output_length = next_byte - output;
-                    if (dataqueue_verify_test(&packet, next_frame, next_index, frame_length, data, output, output_length) != 0) {
-                        DBG_PRINTF("Verify data fails for case %d, option &x", basic_case, case_opt);
-                        ret = -1;
-                    }
-                }
             }
         }
     }
 
-    return ret;
-}
+    /* Send everything, and check that the data arrives in order */
+    while (ret == 0 && stream->send_queue != NULL) {
+        int more_data = 0;
+        int is_pure_ack = 1;
+        int is_still_active = 0;
+        uint64_t sent_offset = stream->sent_offset;
+        uint8_t* bytes_next = picoquic_format_stream_frame(cnx, stream, bytes, bytes + sizeof(bytes),
+            &more_data, &is_pure_ack, &is_still_active, &ret);
+        size_t sent_length = (size_t)(stream->sent_offset - sent_offset);
 
-/* Test the API picoquic_copy_stream_frames_for_retransmit
-* Create a connection.
-* Create a data queue packet with 256 bytes of data.
-* First call: buffer size < min size. Expect "more data" to
-* be set, but no data sent. ACK only is expected.
-* Second call: buffer size < packet size. Expect buffer to
-* be filled with data. More data should be set. ACK only = 0.
-* Third call: large buffer size. Expect large packet. More data
-* should not be set. ACK only = 0. 
-* Fourth call: large buffer size. Expect no data, more data=0,
-* ACK only = 1.
-* Add another packet in the queue, or maybe two.
-* Clean everything. The ASAN/UBSAN run will detect any memory leak.
- */
+        if (ret != 0 || bytes_next == NULL || sent_length == 0) {
+            DBG_PRINTF("Cannot format stream frame at offset %" PRIu64, sent_offset);
+            ret = -1;
+        }
+        else {
+            const uint8_t* data = bytes_next - sent_length;
 
-int dataqueue_packet_test_iterate(int test_id, picoquic_cnx_t* cnx, size_t buffer_size, int expect_data, int expect_more_data, int expect_is_pure_ack)
-{
-    int ret = 0;
-    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
-    int more_data = 0;
-    int is_pure_ack = 1;
-    uint8_t* next_bytes = picoquic_copy_stream_frames_for_retransmit(cnx, buffer, buffer + buffer_size, UINT64_MAX, &more_data, &is_pure_ack);
+            for (size_t i = 0; ret == 0 && i < sent_length; i++) {
+                if (data[i] != (uint8_t)((sent_offset + i) / STREAM_OWNED_CHUNK_SIZE)) {
+                    DBG_PRINTF("Unexpected data at offset %" PRIu64, sent_offset + i);
+                    ret = -1;
+                }
+            }
+        }
+    }
 
-    if (next_bytes == NULL) {
-        DBG_PRINTF("Test %d, returns NULL", test_id);
+    if (ret == 0 && (stream->send_queue_last != NULL ||
+        stream->sent_offset != STREAM_OWNED_NB_CHUNKS * STREAM_OWNED_CHUNK_SIZE)) {
+        DBG_PRINTF("Sent %" PRIu64 " bytes, queue tail %s", stream->sent_offset,
+            (stream->send_queue_last == NULL) ? "empty" : "not empty");
         ret = -1;
     }
-    else {
-        int has_data = next_bytes > buffer;
 
-        if (has_data && !expect_data) {
-            DBG_PRINTF("Test %d, got data, not expected", test_id);
-            ret = -1;
-        } else if (!has_data && expect_data) {
-            DBG_PRINTF("Test %d, no data, some expected", test_id);
-            ret = -1;
-        } else if (more_data && !expect_more_data) {
-            DBG_PRINTF("Test %d, more data not expected", test_id);
-            ret = -1;
-        }  else if (!more_data && expect_more_data) {
-            DBG_PRINTF("Test %d, more data expected", test_id);
-            ret = -1;
-        } else if (is_pure_ack && !expect_is_pure_ack) {
-            DBG_PRINTF("Test %d, unexpected pure ACK", test_id);
-            ret = -1;
-        } else if (!is_pure_ack && expect_is_pure_ack) {
-            DBG_PRINTF("Test %d, pure ACK expected", test_id);
+    if (ret == 0 && nb_freed != nb_owned) {
+        DBG_PRINTF("Released %d owned buffers out of %d", nb_freed, nb_owned);
+        ret = -1;
+    }
+
+    /* Buffers still queued when the connection is deleted are released too */
+    if (ret == 0) {
+        uint8_t* chunk = (uint8_t*)malloc(STREAM_OWNED_CHUNK_SIZE);
+
+        if (chunk == NULL) {
             ret = -1;
         }
+        else if ((ret = picoquic_add_to_stream_owned(cnx, 8, chunk, STREAM_OWNED_CHUNK_SIZE, 0, NULL,
+            stream_owned_test_free, &nb_freed)) != 0) {
+            free(chunk);
+        }
+        else {
+            nb_owned++;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    if (ret == 0 && nb_freed != nb_owned) {
+        DBG_PRINTF("Released %d owned buffers out of %d after deleting the connection", nb_freed, nb_owned);
+        ret = -1;
     }
+
     return ret;
 }
 
-int dataqueue_packet_test()
+/* Test compact retransmit records: stream frames in the sent packets are
+ * replaced by references to the data retained in the stream, the retained
+ * data is released as acknowledgements arrive, and the packets are rebuilt
+ * identically if they need to be repeated.
+ */
+#define COMPACT_TEST_NB_CHUNKS 4
+#define COMPACT_TEST_CHUNK_SIZE 1000
+#define COMPACT_TEST_HEADER_SIZE 10
+#define COMPACT_TEST_PAYLOAD_SIZE 600
+#define COMPACT_TEST_MAX_PACKETS 16
+
+int compact_retransmit_test()
 {
-    picoquic_quic_t* qtest = NULL;
-    picoquic_cnx_t* cnx = NULL;
     int ret = 0;
     uint64_t simulated_time = 0;
-    struct sockaddr_in saddr;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    picoquic_cnx_t* cnx = NULL;
+    struct sockaddr_storage addr;
+    picoquic_stream_head_t* stream = NULL;
+    picoquic_packet_context_t* pkt_ctx = NULL;
+    uint8_t chunk[COMPACT_TEST_CHUNK_SIZE];
+    uint8_t original[COMPACT_TEST_MAX_PACKETS][PICOQUIC_MAX_PACKET_SIZE];
+    size_t original_length[COMPACT_TEST_MAX_PACKETS];
+    uint64_t original_offset[COMPACT_TEST_MAX_PACKETS];
+    int nb_packets = 0;
 
-    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    if (quic == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_set_compact_retransmit(quic, 1);
+        ret = picoquic_store_text_addr(&addr, "10.0.0.1", 1234);
+        if (ret == 0) {
+            cnx = picoquic_create_client_cnx(quic, (struct sockaddr*) & addr, simulated_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, NULL, NULL);
+            if (cnx == NULL) {
+                ret = -1;
+            }
+        }
+    }
 
-    /* Initialize the connection context */
     if (ret == 0) {
-        qtest = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
-            NULL, NULL, NULL, NULL, simulated_time,
-            &simulated_time, NULL, NULL, 0);
-        if (qtest == NULL) {
-            DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        cnx->remote_parameters.initial_max_stream_id_bidir = 64;
+        cnx->max_stream_id_bidir_remote = STREAM_ID_FROM_RANK(
+            cnx->remote_parameters.initial_max_stream_id_bidir, cnx->client_mode, 0);
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = 1000000;
+        cnx->remote_parameters.initial_max_data = 1000000;
+        cnx->maxdata_remote = cnx->remote_parameters.initial_max_data;
+        pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+
+        if ((stream = picoquic_create_stream(cnx, 4)) == NULL) {
             ret = -1;
         }
-        else {
-            cnx = picoquic_create_cnx(qtest,
-                picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*) & saddr,
-                simulated_time, 0, "test-sni", "test-alpn", 1);
+    }
 
-            if (cnx == NULL) {
-                ret = -1;
-            }
-            else {
-                /* Create stream 0 so the later tests succeed */
-                uint8_t new_bytes[256];
-                memset(new_bytes, 0, sizeof(new_bytes));
-                if ((ret = picoquic_add_to_stream(cnx, 0, new_bytes, sizeof(new_bytes), 0)) != 0) {
-                    DBG_PRINTF("%s", "Cannot initialize stream 0\n");
-                    ret = -1;
-                }
-            }
+    for (int i = 0; ret == 0 && i < COMPACT_TEST_NB_CHUNKS; i++) {
+        memset(chunk, i + 1, sizeof(chunk));
+        ret = picoquic_add_to_stream(cnx, 4, chunk, sizeof(chunk), 0);
+    }
+
+    /* Send the data in packets made of a PING and a stream frame */
+    while (ret == 0 && stream->send_queue != NULL) {
+        picoquic_packet_t* packet = picoquic_create_packet(quic);
+        int more_data = 0;
+        int is_pure_ack = 1;
+        int is_still_active = 0;
+        uint8_t* bytes_next;
+
+        if (packet == NULL || nb_packets >= COMPACT_TEST_MAX_PACKETS) {
+            picoquic_recycle_packet(quic, packet);
+            ret = -1;
+            break;
         }
+        packet->ptype = picoquic_packet_1rtt_protected;
+        packet->pc = picoquic_packet_context_application;
+        packet->sequence_number = nb_packets;
+        packet->send_path = cnx->path[0];
+        packet->offset = COMPACT_TEST_HEADER_SIZE;
+        memset(packet->bytes, 0x40, COMPACT_TEST_HEADER_SIZE);
+        packet->bytes[COMPACT_TEST_HEADER_SIZE] = picoquic_frame_type_ping;
+        original_offset[nb_packets] = stream->sent_offset;
+        bytes_next = picoquic_format_stream_frame(cnx, stream, packet->bytes + COMPACT_TEST_HEADER_SIZE + 1,
+            packet->bytes + COMPACT_TEST_HEADER_SIZE + 1 + COMPACT_TEST_PAYLOAD_SIZE,
+            &more_data, &is_pure_ack, &is_still_active, &ret);
+        if (ret != 0 || bytes_next == NULL) {
+            picoquic_recycle_packet(quic, packet);
+            ret = -1;
+            break;
+        }
+        packet->length = bytes_next - packet->bytes;
+        memcpy(original[nb_packets], packet->bytes, packet->length);
+        original_length[nb_packets] = packet->length;
+        picoquic_queue_for_retransmit(cnx, cnx->path[0], packet, packet->length, simulated_time);
+        nb_packets++;
+    }
+
+    if (ret == 0 && (nb_packets < 4 || stream->send_retained == NULL)) {
+        DBG_PRINTF("Sent %d packets, retained data: %s", nb_packets, (stream->send_retained == NULL) ? "no" : "yes");
+        ret = -1;
     }
 
+    /* Add a packet that does not elicit an ACK, which shall not be compacted */
     if (ret == 0) {
-        /* Create a packet and chain it to the data queue */
-        picoquic_packet_t* packet = picoquic_create_packet(qtest);
+        picoquic_packet_t* packet = picoquic_create_packet(quic);
+
         if (packet == NULL) {
             ret = -1;
         }
         else {
-            (void)dataqueue_prepare_packet(packet, 1, 0, 0, 0, 256);
-            picoquic_queue_data_repeat_packet(cnx, packet);
+            packet->ptype = picoquic_packet_1rtt_protected;
+            packet->pc = picoquic_packet_context_application;
+            packet->sequence_number = nb_packets;
+            packet->send_path = cnx->path[0];
+            packet->offset = COMPACT_TEST_HEADER_SIZE;
+            memset(packet->bytes, 0x40, COMPACT_TEST_HEADER_SIZE);
+            memset(packet->bytes + COMPACT_TEST_HEADER_SIZE, picoquic_frame_type_padding, 32);
+            packet->length = COMPACT_TEST_HEADER_SIZE + 32;
+            picoquic_queue_for_retransmit(cnx, cnx->path[0], packet, packet->length, simulated_time);
         }
     }
 
-    if (ret == 0 &&
-        (ret = dataqueue_packet_test_iterate(1, cnx, 2, 0, 1, 1)) == 0 &&
-        (ret = dataqueue_packet_test_iterate(2, cnx, 128, 1, 1, 0)) == 0 &&
-        (ret = dataqueue_packet_test_iterate(3, cnx, 1024, 1, 0, 0)) == 0) {
-        ret = dataqueue_packet_test_iterate(4, cnx, 1024, 0, 0, 1);
+    /* Compact the packets */
+    if (ret == 0) {
+        picoquic_packet_t* packet;
+        int nb_compacted = 0;
+
+        picoquic_compact_sent_packets(cnx);
+
+        packet = pkt_ctx->pending_first;
+        while (packet != NULL) {
+            if (packet->is_compacted && packet->length == original_length[nb_compacted] &&
+                packet->compacted_length < COMPACT_TEST_HEADER_SIZE + 32 &&
+                packet->is_evaluated && packet->is_ack_eliciting) {
+                nb_compacted++;
+            }
+            packet = packet->packet_next;
+        }
+        if (nb_compacted != nb_packets) {
+            DBG_PRINTF("Compacted %d packets out of %d", nb_compacted, nb_packets);
+            ret = -1;
+        }
+        else if ((packet = pkt_ctx->pending_last) == NULL || packet->is_compacted ||
+            (packet->is_evaluated && packet->is_ack_eliciting)) {
+            DBG_PRINTF("%s", "Packet without stream data compacted or marked ack eliciting");
+            ret = -1;
+        }
+    }
+
+    /* Acknowledge the first two packets, which covers the first chunk */
+    for (int i = 0; ret == 0 && i < 2; i++) {
+        picoquic_packet_t* packet = pkt_ctx->pending_first;
+
+        picoquic_process_ack_of_frames(cnx, packet, 0, simulated_time);
+        (void)picoquic_dequeue_retransmit_packet(cnx, pkt_ctx, packet, 1, 0);
     }
 
+    if (ret == 0 && (!picoquic_check_sack_list(&stream->sack_list, 0, original_offset[2] - 1) ||
+        stream->send_retained == NULL || stream->send_retained->stream_offset != COMPACT_TEST_CHUNK_SIZE)) {
+        DBG_PRINTF("%s", "Acknowledged data not released");
+        ret = -1;
+    }
+
+    /* Pretend that the first bytes of the third packet were acknowledged by a repeat */
     if (ret == 0) {
-        /* Create a packet and chain it to the data queue */
-        picoquic_packet_t* packet = picoquic_create_packet(qtest);
-        if (packet == NULL) {
+        (void)picoquic_update_sack_list(&stream->sack_list, original_offset[2], original_offset[2] + 9, 0);
+    }
+
+    /* Expand the packets, verify that they are rebuilt as sent */
+    for (int i = 2; ret == 0 && i < nb_packets; i++) {
+        picoquic_packet_t* packet = picoquic_expand_compacted_packet(cnx, pkt_ctx, pkt_ctx->pending_first);
+
+        if (packet == NULL || packet != pkt_ctx->pending_first || packet->is_compacted ||
+            packet->length != original_length[i]) {
+            DBG_PRINTF("Cannot expand packet %d", i);
             ret = -1;
         }
-        else {
-            (void)dataqueue_prepare_packet(packet, 1, 0, 0, 0, 256);
-            picoquic_dequeue_data_repeat_packet(cnx, packet);
+        else if (i == 2) {
+            uint64_t stream_id;
+            uint64_t offset;
+            size_t data_length;
+            size_t consumed;
+            int fin;
+            size_t byte_index = COMPACT_TEST_HEADER_SIZE;
+
+            /* The frames are preceded by padding, since the packet became shorter */
+            while (byte_index < packet->length && packet->bytes[byte_index] == picoquic_frame_type_padding) {
+                byte_index++;
+            }
+            if (byte_index == COMPACT_TEST_HEADER_SIZE || byte_index >= packet->length ||
+                packet->bytes[byte_index++] != picoquic_frame_type_ping ||
+                picoquic_parse_stream_header(packet->bytes + byte_index, packet->length - byte_index,
+                &stream_id, &offset, &data_length, &fin, &consumed) != 0 || stream_id != 4 ||
+                offset != original_offset[2] + 10 ||
+                memcmp(packet->bytes + byte_index + consumed, original[2] + original_length[2] - data_length, data_length) != 0) {
+                DBG_PRINTF("%s", "Partially acknowledged frame not trimmed");
+                ret = -1;
+            }
+        }
+        else if (memcmp(packet->bytes, original[i], packet->length) != 0) {
+            DBG_PRINTF("Packet %d not rebuilt as sent", i);
+            ret = -1;
+        }
+        if (ret == 0) {
+            (void)picoquic_dequeue_retransmit_packet(cnx, pkt_ctx, packet, 1, 0);
         }
     }
 
-    /* Free the connection context */
-    if (cnx != NULL) {
-        picoquic_delete_cnx(cnx);
+    if (quic != NULL) {
+        picoquic_free(quic);
     }
 
-    if (qtest != NULL) {
-        picoquic_free(qtest);
-    }
     return ret;
 }
 
-/* Testing the sending of blocked frames */
-struct st_stream_blocked_test_t {
-    uint64_t stream_id;
-    int is_id_blocked;
-    int is_data_blocked;
-    int is_client;
-    int expect_bidir_blocked;
-    int expect_unidir_blocked;
-    int expect_data_blocked;
-};
-
-static const struct st_stream_blocked_test_t stream_blocked_test[] = {
-    { 4, 1, 0, 1, 1, 0, 0},
-    { 4, 1, 1, 0, 0, 0, 1},
-    { 4, 0, 1, 0, 0, 0, 1}
-};
+/* Verify that pending packets are indexed by sequence number, and that
+ * acknowledgements remove exactly the acknowledged packets. Packets are
+ * numbered with even sequence numbers, to leave holes in the index.
+ */
+#define PENDING_RING_TEST_NB_PACKETS 1000
 
-static const size_t nb_stream_blocked_test = sizeof(stream_blocked_test) / sizeof(struct st_stream_blocked_test_t);
+const uint8_t* picoquic_decode_ack_frame(picoquic_cnx_t* cnx, const uint8_t* bytes,
+    const uint8_t* bytes_max, uint64_t current_time, int epoch, int is_ecn, int has_path_id, picoquic_packet_data_t* packet_data);
 
-int send_stream_blocked_test_one(const struct st_stream_blocked_test_t * test)
+int pending_ring_test()
 {
     int ret = 0;
-    uint8_t buf[1024];
-    uint8_t bytes[1024];
     uint64_t simulated_time = 0;
     picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL, simulated_time,
         &simulated_time, NULL, NULL, 0);
-    picoquic_cnx_t * cnx = NULL;
+    picoquic_cnx_t* cnx = NULL;
     struct sockaddr_storage addr;
-    picoquic_stream_head_t* stream = NULL;
+    picoquic_packet_context_t* pkt_ctx = NULL;
+    /* ACK of 500-599 and 300-399 */
+    uint8_t ack_frame[] = { picoquic_frame_type_ack, 0x42, 0x57, 0, 1, 0x40, 99, 0x40, 99, 0x40, 99 };
 
     if (quic == NULL) {
         ret = -1;
@@ -3308,87 +4564,95 @@ int send_stream_blocked_test_one(const struct st_stream_blocked_test_t * test)
             if (cnx == NULL) {
                 ret = -1;
             }
+            else {
+                pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+            }
         }
     }
 
-    if (ret == 0) {
-        /* Setup the initial conditions */
-        if (!test->is_client) {
-            cnx->client_mode = 0;
-        }
-        if (test->is_id_blocked) {
-            cnx->remote_parameters.initial_max_stream_id_bidir = 1;
-            cnx->remote_parameters.initial_max_stream_id_unidir = 0;
-        }
-        else {
-            cnx->remote_parameters.initial_max_stream_id_bidir = 64;
-            cnx->remote_parameters.initial_max_stream_id_unidir = 64;
+    for (int i = 0; ret == 0 && i < PENDING_RING_TEST_NB_PACKETS; i++) {
+        picoquic_packet_t* packet = picoquic_create_packet(quic);
+
+        if (packet == NULL) {
+            ret = -1;
+            break;
         }
+        packet->ptype = picoquic_packet_1rtt_protected;
+        packet->pc = picoquic_packet_context_application;
+        packet->sequence_number = 2 * (uint64_t)i;
+        packet->send_path = cnx->path[0];
+        packet->offset = COMPACT_TEST_HEADER_SIZE;
+        memset(packet->bytes, 0x40, COMPACT_TEST_HEADER_SIZE);
+        packet->bytes[COMPACT_TEST_HEADER_SIZE] = picoquic_frame_type_ping;
+        packet->length = COMPACT_TEST_HEADER_SIZE + 1;
+        picoquic_queue_for_retransmit(cnx, cnx->path[0], packet, packet->length, simulated_time);
+        pkt_ctx->send_sequence = packet->sequence_number + 1;
+    }
+
+    if (ret == 0 && pkt_ctx->pending_ring_size < 2 * PENDING_RING_TEST_NB_PACKETS) {
+        DBG_PRINTF("Ring size %zu, expected at least %d", pkt_ctx->pending_ring_size, 2 * PENDING_RING_TEST_NB_PACKETS);
+        ret = -1;
+    }
 
-        cnx->max_stream_id_bidir_remote = STREAM_ID_FROM_RANK(
-            cnx->remote_parameters.initial_max_stream_id_bidir, cnx->client_mode, 0);
-        cnx->max_stream_id_unidir_remote = STREAM_ID_FROM_RANK(
-            cnx->remote_parameters.initial_max_stream_id_unidir, cnx->client_mode, 1);
+    /* Check exact lookups and ceiling searches */
+    for (uint64_t seq = 0; ret == 0 && seq < 2 * PENDING_RING_TEST_NB_PACKETS; seq++) {
+        picoquic_packet_t* packet = picoquic_pending_ring_get(pkt_ctx, seq);
+        picoquic_packet_t* ceiling = picoquic_pending_ring_ceiling(pkt_ctx, seq);
+        uint64_t expected_ceiling = (seq + 1) & ~(uint64_t)1;
 
-        if (test->is_data_blocked) {
-            cnx->remote_parameters.initial_max_stream_data_bidi_local = 0;
-            cnx->remote_parameters.initial_max_stream_data_bidi_remote = 0;
-            cnx->remote_parameters.initial_max_stream_data_uni = 0;
-            cnx->remote_parameters.initial_max_data = PICOQUIC_DEFAULT_0RTT_WINDOW;
+        if (expected_ceiling >= 2 * PENDING_RING_TEST_NB_PACKETS) {
+            expected_ceiling = pkt_ctx->pending_last->sequence_number;
         }
-        else {
-            cnx->remote_parameters.initial_max_stream_data_bidi_local = 100000;
-            cnx->remote_parameters.initial_max_stream_data_bidi_remote = 100000;
-            cnx->remote_parameters.initial_max_stream_data_uni = 100000;
-            cnx->remote_parameters.initial_max_data = 1000000;
+        if ((seq & 1) != 0 && packet != NULL) {
+            DBG_PRINTF("Unexpected packet found for %" PRIu64, seq);
+            ret = -1;
         }
-        cnx->maxdata_remote = cnx->remote_parameters.initial_max_data;
-
-        /* Create the stream so it picks the required parameters */
-        stream = picoquic_create_stream(cnx, test->stream_id);
-        if (stream != NULL) {
-            memset(buf, 0, sizeof(buf));
-            ret = picoquic_add_to_stream(cnx, test->stream_id, buf, sizeof(buf), 0);
+        else if ((seq & 1) == 0 && (packet == NULL || packet->sequence_number != seq)) {
+            DBG_PRINTF("Packet %" PRIu64 " not found", seq);
+            ret = -1;
         }
-        if (stream == NULL) {
-            DBG_PRINTF("Could not find stream #%d", (int)test->stream_id);
+        else if (ceiling == NULL || ceiling->sequence_number != expected_ceiling) {
+            DBG_PRINTF("Ceiling of %" PRIu64 " not found", seq);
             ret = -1;
         }
-        if (ret == 0) {
-            /* Call the blocked frame API */
-            uint8_t* bytes_next;
-            int is_pure_ack = 1;
-            int more_data = 0;
-
-            bytes_next = picoquic_format_one_blocked_frame(cnx, bytes, bytes + sizeof(bytes), &more_data, &is_pure_ack, stream);
+    }
 
-            if (bytes_next != bytes && (is_pure_ack || more_data)) {
-                DBG_PRINTF("Error formatting blocked frames, stream: %" PRIu64", length: %zu, more: %d, pure ack: %d",
-                    test->stream_id, bytes_next - bytes, more_data, is_pure_ack);
-                ret = -1;
-            }
-        }
+    /* Acknowledge two ranges, then check that the ring tracks the list */
+    if (ret == 0) {
+        picoquic_packet_data_t packet_data;
 
-        if (ret == 0 &&
-            test->expect_bidir_blocked != cnx->stream_blocked_bidir_sent){
-            DBG_PRINTF("Stream blocked bidir: %d vs %d", test->expect_bidir_blocked, cnx->stream_blocked_bidir_sent);
+        memset(&packet_data, 0, sizeof(packet_data));
+        simulated_time += 10000;
+        if (picoquic_decode_ack_frame(cnx, ack_frame, ack_frame + sizeof(ack_frame), simulated_time,
+            picoquic_epoch_1rtt, 0, 0, &packet_data) != ack_frame + sizeof(ack_frame)) {
+            DBG_PRINTF("%s", "Cannot decode the ACK frame");
             ret = -1;
         }
+    }
 
-        if (ret == 0 &&
-            test->expect_unidir_blocked != cnx->stream_blocked_unidir_sent) {
-            DBG_PRINTF("Stream blocked bidir: %d vs %d", test->expect_unidir_blocked, cnx->stream_blocked_unidir_sent);
+    for (uint64_t seq = 0; ret == 0 && seq < 2 * PENDING_RING_TEST_NB_PACKETS; seq += 2) {
+        int is_acked = (seq >= 300 && seq <= 399) || (seq >= 500 && seq <= 599);
+        picoquic_packet_t* packet = picoquic_pending_ring_get(pkt_ctx, seq);
+
+        if ((packet == NULL) != is_acked) {
+            DBG_PRINTF("Packet %" PRIu64 " %s", seq, (is_acked) ? "not removed" : "missing");
             ret = -1;
         }
+    }
 
-        if (ret == 0 &&
-            test->expect_data_blocked != stream->stream_data_blocked_sent) {
-            DBG_PRINTF("Stream data blocked: %d vs %d", test->expect_data_blocked, stream->stream_data_blocked_sent);
+    if (ret == 0) {
+        int nb_pending = 0;
+        picoquic_packet_t* packet = pkt_ctx->pending_first;
+
+        while (packet != NULL) {
+            nb_pending++;
+            packet = packet->packet_next;
+        }
+        if (nb_pending != PENDING_RING_TEST_NB_PACKETS - 100) {
+            DBG_PRINTF("Found %d pending packets instead of %d", nb_pending, PENDING_RING_TEST_NB_PACKETS - 100);
             ret = -1;
         }
-
     }
-    
 
     if (quic != NULL) {
         picoquic_free(quic);
@@ -3397,19 +4661,6 @@ int send_stream_blocked_test_one(const struct st_stream_blocked_test_t * test)
     return ret;
 }
 
-int send_stream_blocked_test()
-{
-    int ret = 0;
-
-    for (size_t i = 0; ret == 0 && i < nb_stream_blocked_test; i++) {
-        if ((ret = send_stream_blocked_test_one(&stream_blocked_test[i])) != 0) {
-            DBG_PRINTF("Stream blocked test %d failed", (int)i);
-        }
-    }
-
-    return ret;
-}
-
 int picoquic_queue_network_input(picoquic_quic_t * quic, picosplay_tree_t* tree, uint64_t consumed_offset,
     uint64_t stream_ofs, const uint8_t* bytes, size_t length, int is_last_frame, picoquic_stream_data_node_t* received_data, int* new_data_available);
 
@@ -3427,10 +4678,10 @@ int queue_network_input_test()
         NULL, NULL, NULL, NULL, simulated_time,
         &simulated_time, NULL, NULL, 0);
 
-    const size_t expected_length[3] = { 4, 2, 4 };
-    const uint8_t expected[3][4] = {
-        { 0, 1, 2, 3 },
-        { 4, 5 },
+    /* The chunk 4..5 is merged with the adjacent copied chunk 0..3 */
+    const size_t expected_length[2] = { 6, 4 };
+    const uint8_t expected[2][6] = {
+        { 0, 1, 2, 3, 4, 5 },
         { 6, 7, 8, 9 }
     };
 
@@ -3497,9 +4748,9 @@ int queue_network_input_test()
 
     if (ret == 0) {
         picoquic_stream_data_node_t* next = (picoquic_stream_data_node_t*)picosplay_first(tree);
-        for (int i = 0; i < 3; ++i) {
+        for (int i = 0; i < 2; ++i) {
             if (next == NULL) {
-                DBG_PRINTF("tree does not contain enough data (%d chunks vs 3 exptected)", i);
+                DBG_PRINTF("tree does not contain enough data (%d chunks vs 2 exptected)", i);
                 ret = 1;
                 break;
             }
@@ -3513,6 +4764,145 @@ int queue_network_input_test()
             }
             next = (picoquic_stream_data_node_t*)picosplay_next(&next->stream_data_node);
         }
+        if (ret == 0 && next != NULL) {
+            DBG_PRINTF("%s", "tree contains more than 2 chunks");
+            ret = 1;
+        }
+    }
+
+    if (tree != NULL) {
+        picosplay_empty_tree(tree);
+        free(tree);
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+/* Release more nodes than the pool can hold, spread over two size classes.
+ * The nodes kept in the pools of all classes shall not exceed the limit. */
+static int data_node_pool_limit_test(picoquic_quic_t* quic)
+{
+    int ret = 0;
+    int nb_nodes = PICOQUIC_MAX_PACKETS_IN_POOL + 16;
+    picoquic_stream_data_node_t** nodes = (picoquic_stream_data_node_t**)malloc(nb_nodes * sizeof(picoquic_stream_data_node_t*));
+
+    if (nodes == NULL) {
+        ret = -1;
+    }
+    else {
+        int nb_allocated = 0;
+
+        while (nb_allocated < nb_nodes) {
+            /* The last nodes are full size, the others are small */
+            nodes[nb_allocated] = picoquic_stream_data_node_alloc_ex(quic, (nb_allocated < PICOQUIC_MAX_PACKETS_IN_POOL) ? 1 : PICOQUIC_MAX_PACKET_SIZE);
+            if (nodes[nb_allocated] == NULL) {
+                ret = -1;
+                break;
+            }
+            nb_allocated++;
+        }
+        for (int i = 0; i < nb_allocated; i++) {
+            picoquic_stream_data_node_recycle(nodes[i]);
+        }
+        free(nodes);
+
+        if (ret == 0 && (quic->nb_data_nodes_in_pool > PICOQUIC_MAX_PACKETS_IN_POOL ||
+            quic->nb_data_nodes_allocated != quic->nb_data_nodes_in_pool)) {
+            DBG_PRINTF("%d data nodes allocated, %d in pool", quic->nb_data_nodes_allocated, quic->nb_data_nodes_in_pool);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+/* Simulate a gap followed by many short fragments arriving in order, as happens
+ * under loss. Each fragment is received in its own packet node. The short
+ * fragments shall be copied in compact nodes and merged into extents, so
+ * the packet nodes are all returned to the pool. */
+#define FRAGMENT_TEST_NB 400
+#define FRAGMENT_TEST_LENGTH 20
+
+int queue_network_fragments_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+    picosplay_tree_t* tree = picosplay_new_tree(
+        picoquic_stream_data_node_compare,
+        picoquic_stream_data_node_create,
+        picoquic_stream_data_node_delete,
+        picoquic_stream_data_node_value);
+    int nb_nodes = 0;
+
+    if (quic == NULL || tree == NULL) {
+        ret = -1;
+    }
+
+    /* Data starting at offset 0 is missing, fragments arrive from FRAGMENT_TEST_LENGTH */
+    for (int i = 1; ret == 0 && i <= FRAGMENT_TEST_NB; i++) {
+        int new_data_available = 0;
+        picoquic_stream_data_node_t* packet_node = picoquic_stream_data_node_alloc(quic);
+
+        if (packet_node == NULL) {
+            ret = -1;
+        }
+        else {
+            uint8_t* fragment = packet_node->data + 32;
+            memset(fragment, i, FRAGMENT_TEST_LENGTH);
+
+            if ((ret = picoquic_queue_network_input(quic, tree, 0, (uint64_t)i * FRAGMENT_TEST_LENGTH,
+                fragment, FRAGMENT_TEST_LENGTH, 1, packet_node, &new_data_available)) != 0) {
+                DBG_PRINTF("picoquic_queue_network_input(fragment %d) failed (%d)", i, ret);
+            }
+            else if (new_data_available == 0) {
+                DBG_PRINTF("new_data_available doesn't signal fragment %d", i);
+                ret = -1;
+            }
+            if (packet_node->bytes == NULL) {
+                picoquic_stream_data_node_recycle(packet_node);
+            }
+            else {
+                DBG_PRINTF("Fragment %d kept in the packet node", i);
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_stream_data_node_t* next = (picoquic_stream_data_node_t*)picosplay_first(tree);
+        uint64_t expected_offset = FRAGMENT_TEST_LENGTH;
+
+        while (ret == 0 && next != NULL) {
+            if (next->offset != expected_offset || next->bytes != next->data || next->length > next->data_size) {
+                DBG_PRINTF("Unexpected chunk at offset %" PRIu64 ", length %zu", next->offset, next->length);
+                ret = -1;
+            }
+            for (size_t i = 0; ret == 0 && i < next->length; i++) {
+                if (next->bytes[i] != (uint8_t)((next->offset + i) / FRAGMENT_TEST_LENGTH)) {
+                    DBG_PRINTF("Unexpected data at offset %" PRIu64, next->offset + i);
+                    ret = -1;
+                }
+            }
+            expected_offset += next->length;
+            nb_nodes++;
+            next = (picoquic_stream_data_node_t*)picosplay_next(&next->stream_data_node);
+        }
+
+        if (ret == 0 && expected_offset != (FRAGMENT_TEST_NB + 1) * FRAGMENT_TEST_LENGTH) {
+            DBG_PRINTF("Tree holds data up to %" PRIu64, expected_offset);
+            ret = -1;
+        }
+        if (ret == 0 && nb_nodes > 1 + (FRAGMENT_TEST_NB * FRAGMENT_TEST_LENGTH) / PICOQUIC_MAX_PACKET_SIZE) {
+            DBG_PRINTF("Fragments held in %d nodes", nb_nodes);
+            ret = -1;
+        }
     }
 
     if (tree != NULL) {
@@ -3521,6 +4911,13 @@ int queue_network_input_test()
     }
 
     if (quic != NULL) {
+        if (ret == 0 && quic->nb_data_nodes_allocated != quic->nb_data_nodes_in_pool) {
+            DBG_PRINTF("%d data nodes allocated, %d in pool", quic->nb_data_nodes_allocated, quic->nb_data_nodes_in_pool);
+            ret = -1;
+        }
+        if (ret == 0) {
+            ret = data_node_pool_limit_test(quic);
+        }
         picoquic_free(quic);
     }
 
@@ -28,6 +28,7 @@
 #include "picoquictest_internal.h"
 #include "autoqlog.h"
 #include "picoquic_packet_loop.h"
+#include "picoquic_lb.h"
 #include "picosocks.h"
 
 
@@ -61,6 +62,9 @@ typedef struct st_sockloop_test_spec_t {
     int double_bind;
     int extra_socket_required;
     int force_migration;
+    int use_recv_batch;
+    int use_send_batch;
+    int close_by_command;
 } sockloop_test_spec_t;
 
 typedef struct st_sockloop_test_cb_t {
@@ -81,6 +85,8 @@ typedef struct st_sockloop_test_cb_t {
     picoquic_connection_id_t server_cid_before_migration;
     picoquic_connection_id_t client_cid_before_migration;
     picoquic_packet_loop_param_t* param;
+    uint64_t nb_datagrams_received;
+    uint64_t max_datagrams_per_receive;
 } sockloop_test_cb_t;
 
 int sockloop_test_received_finished(picoquic_test_tls_api_ctx_t* test_ctx)
@@ -145,6 +151,10 @@ int sockloop_test_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode
         }
         case picoquic_packet_loop_after_receive:
             /* Post receive callback */
+            if (quic->metrics.nb_packets_received - cb_ctx->nb_datagrams_received > cb_ctx->max_datagrams_per_receive) {
+                cb_ctx->max_datagrams_per_receive = quic->metrics.nb_packets_received - cb_ctx->nb_datagrams_received;
+            }
+            cb_ctx->nb_datagrams_received = quic->metrics.nb_packets_received;
             if (cnx_client->cnx_state == picoquic_state_disconnected) {
                 DBG_PRINTF("%s", "The connection is closed!\n");
                 ret = PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP;
@@ -234,8 +244,11 @@ int sockloop_test_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode
             break;
         }
         case picoquic_packet_loop_wake_up: {
-            ret = picoquic_start_client_cnx(cnx_client);
-            DBG_PRINTF("Starting the client connection, returns: %d", ret);
+            /* Later wake ups are caused by commands posted to the thread */
+            if (cnx_client->cnx_state == picoquic_state_client_init) {
+                ret = picoquic_start_client_cnx(cnx_client);
+                DBG_PRINTF("Starting the client connection, returns: %d", ret);
+            }
             break;
         }
 
@@ -488,6 +501,8 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
             param.do_not_use_gso = spec->do_not_use_gso;
             param.simulate_eio = spec->simulate_eio;
             param.extra_socket_required = spec->extra_socket_required;
+            param.use_recv_batch = spec->use_recv_batch;
+            param.use_send_batch = spec->use_send_batch;
 
             loop_cb.force_migration = spec->force_migration;
             loop_cb.param = &param;
@@ -534,6 +549,20 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
                                 SLEEP(100);
                             }
                         }
+                        if (spec->close_by_command) {
+                            if ((ret = picoquic_network_thread_close(thread_ctx, test_ctx->cnx_client, 0)) != 0) {
+                                DBG_PRINTF("Cannot post close command, ret = 0x%x", ret);
+                            }
+                            else {
+                                for (int i = 0; i < 50 && test_ctx->cnx_client->cnx_state < picoquic_state_disconnecting; i++) {
+                                    SLEEP(10);
+                                }
+                                if (test_ctx->cnx_client->cnx_state < picoquic_state_disconnecting) {
+                                    DBG_PRINTF("%s", "Close command not executed after 500ms");
+                                    ret = -1;
+                                }
+                            }
+                        }
                     }
                     picoquic_delete_network_thread(thread_ctx);
                 }
@@ -555,6 +584,10 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
         else if (spec->force_migration != 0 && sockloop_test_verify_migration(&loop_cb, test_ctx->cnx_client) != 0) {
             ret = -1;
         }
+        else if (spec->use_recv_batch && loop_cb.max_datagrams_per_receive < 2) {
+            DBG_PRINTF("%s", "No receive call returned more than one datagram");
+            ret = -1;
+        }
         else {
             ret = tls_api_one_scenario_verify(test_ctx);
         }
@@ -694,4 +727,260 @@ int sockloop_thread_name_test()
     spec.thread_name = "picoquic loop";
 
     return(sockloop_test_one(&spec));
-}
\ No newline at end of file
+}
+
+int sockloop_thread_command_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 11);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.use_background_thread = 1;
+    spec.close_by_command = 1;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_recv_batch_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 9);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.use_recv_batch = 1;
+
+    return(sockloop_test_one(&spec));
+}
+
+/* Verify that datagrams coalesced by UDP GRO are split in segments
+ * of the announced size before being submitted to the QUIC context.
+ */
+int sockloop_recv_gro_test()
+{
+    int ret = 0;
+#if defined(__linux__)
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, 0, NULL, NULL, NULL, 0);
+    struct st_picoquic_recv_batch_t* recv_batch = picoquic_recv_batch_create(1);
+
+    if (quic == NULL || recv_batch == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_network_thread_ctx_t thread_ctx = { 0 };
+        struct sockaddr_storage addr_from;
+        struct sockaddr_storage addr_dest;
+        picoquic_cnx_t* last_cnx = NULL;
+        uint8_t buffer[4 * PICOQUIC_INITIAL_MTU_IPV6];
+        /* Three full segments and a shorter one, then a datagram that was not coalesced */
+        size_t segment_size = PICOQUIC_INITIAL_MTU_IPV6;
+        size_t gro_length = 3 * segment_size + 500;
+        size_t single_length = 700;
+
+        thread_ctx.quic = quic;
+        (void)picoquic_store_loopback_addr(&addr_from, AF_INET, 1234);
+        (void)picoquic_store_loopback_addr(&addr_dest, AF_INET, 4433);
+        /* Short header packets with unknown CIDs, so they are all dropped. */
+        memset(buffer, 0x5a, sizeof(buffer));
+        for (size_t i = 0; i < sizeof(buffer); i += segment_size) {
+            buffer[i] = 0x40;
+        }
+
+        if (picoquic_recv_batch_add_message(recv_batch, buffer, gro_length,
+            (struct sockaddr*)&addr_from, (struct sockaddr*)&addr_dest, segment_size) != 0 ||
+            picoquic_recv_batch_add_message(recv_batch, buffer, single_length,
+            (struct sockaddr*)&addr_from, (struct sockaddr*)&addr_dest, 0) != 0) {
+            DBG_PRINTF("%s", "Cannot add messages to the batch");
+            ret = -1;
+        }
+        else if ((ret = picoquic_packet_loop_submit_batch(&thread_ctx, recv_batch, &last_cnx,
+            picoquic_get_quic_time(quic))) != 0) {
+            DBG_PRINTF("Submit batch returns 0x%x", ret);
+        }
+        else if (quic->metrics.nb_packets_received != 5 ||
+            quic->metrics.nb_bytes_received != gro_length + single_length) {
+            DBG_PRINTF("Expected 5 datagrams, %zu bytes, got %" PRIu64 ", %" PRIu64,
+                gro_length + single_length, quic->metrics.nb_packets_received, quic->metrics.nb_bytes_received);
+            ret = -1;
+        }
+        else if (quic->metrics.nb_packets_dropped[picoquic_drop_reason_unknown_cid] != 5) {
+            DBG_PRINTF("Expected 5 datagrams dropped, got %" PRIu64,
+                quic->metrics.nb_packets_dropped[picoquic_drop_reason_unknown_cid]);
+            ret = -1;
+        }
+    }
+
+    picoquic_recv_batch_delete(recv_batch);
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+#endif
+    return ret;
+}
+
+int sockloop_send_batch_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 10);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.use_send_batch = 1;
+
+    return(sockloop_test_one(&spec));
+}
+
+/* Verify that short header packets are steered to the shard
+ * encoded in the connection ID, and that other packets are not.
+ */
+int sockloop_shard_cid_test()
+{
+    int ret = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, 0, NULL, NULL, NULL, 0);
+
+    if (quic == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_load_balancer_config_t lb_config = { 0 };
+        picoquic_connection_id_t cnx_id = { { 0 }, 0 };
+        picoquic_connection_id_t null_cid = picoquic_null_connection_id;
+        uint8_t packet[64];
+        int shard_id;
+
+        memset(packet, 0x55, sizeof(packet));
+        /* Without load balancer configuration, packets are never forwarded */
+        packet[0] = 0x40;
+        if ((shard_id = picoquic_sharded_server_find_shard(quic, 4, packet, sizeof(packet))) != -1) {
+            DBG_PRINTF("Unconfigured context returns shard %d", shard_id);
+            ret = -1;
+        }
+        if (ret == 0) {
+            lb_config.method = picoquic_load_balancer_cid_clear;
+            lb_config.server_id_length = 1;
+            lb_config.connection_id_length = 8;
+            lb_config.server_id64 = 3;
+            ret = picoquic_lb_compat_cid_config(quic, &lb_config);
+        }
+        if (ret == 0) {
+            cnx_id.id_len = 8;
+            picoquic_lb_compat_cid_generate(quic, null_cid, null_cid, quic->cnx_id_callback_ctx, &cnx_id);
+            packet[0] = 0x40;
+            (void)picoquic_format_connection_id(packet + 1, sizeof(packet) - 1, cnx_id);
+            if ((shard_id = picoquic_sharded_server_find_shard(quic, 4, packet, sizeof(packet))) != 3) {
+                DBG_PRINTF("Short header packet steered to shard %d instead of 3", shard_id);
+                ret = -1;
+            }
+            else if ((shard_id = picoquic_sharded_server_find_shard(quic, 2, packet, sizeof(packet))) != -1) {
+                DBG_PRINTF("Shard number out of range, returns %d", shard_id);
+                ret = -1;
+            }
+            else if ((shard_id = picoquic_sharded_server_find_shard(quic, 4, packet, 8)) != -1) {
+                DBG_PRINTF("Short packet returns shard %d", shard_id);
+                ret = -1;
+            }
+            else {
+                packet[0] = 0xc0;
+                if ((shard_id = picoquic_sharded_server_find_shard(quic, 4, packet, sizeof(packet))) != -1) {
+                    DBG_PRINTF("Long header packet steered to shard %d", shard_id);
+                    ret = -1;
+                }
+            }
+        }
+        picoquic_lb_compat_cid_config_free(quic);
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+static int sockloop_sharded_server_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode,
+    void* callback_ctx, void* callback_arg)
+{
+    return 0;
+}
+
+/* Start a sharded server with several threads sharing the same port,
+ * verify that all threads start and that the CID generation is configured,
+ * then stop the server.
+ */
+int sockloop_sharded_server_test()
+{
+#if defined(SO_REUSEPORT)
+    int ret = 0;
+    picoquic_quic_t* quic[3] = { NULL, NULL, NULL };
+    int nb_shards = (int)(sizeof(quic) / sizeof(picoquic_quic_t*));
+    picoquic_packet_loop_param_t param = { 0 };
+    picoquic_sharded_server_t* sharded_server = NULL;
+
+    for (int i = 0; ret == 0 && i < nb_shards; i++) {
+        if ((quic[i] = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+            NULL, NULL, NULL, 0, NULL, NULL, NULL, 0)) == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        param.local_port = 3457;
+        param.local_af = AF_INET;
+        sharded_server = picoquic_start_sharded_server(quic, nb_shards, &param,
+            sockloop_sharded_server_cb, NULL, &ret);
+        if (sharded_server == NULL) {
+            DBG_PRINTF("Cannot start sharded server, ret = %d", ret);
+            if (ret == 0) {
+                ret = -1;
+            }
+        }
+    }
+    if (ret == 0) {
+        for (int i = 0; i < 2000; i++) {
+            if (picoquic_sharded_server_is_ready(sharded_server)) {
+                break;
+            }
+            SLEEP(1);
+        }
+        if (!picoquic_sharded_server_is_ready(sharded_server)) {
+            DBG_PRINTF("%s", "Cannot start the sharded server in 2000ms");
+            ret = -1;
+        }
+        for (int i = 0; ret == 0 && i < nb_shards; i++) {
+            picoquic_connection_id_t cnx_id = { { 0 }, 0 };
+
+            cnx_id.id_len = quic[i]->local_cnxid_length;
+            if (quic[i]->cnx_id_callback_fn != picoquic_lb_compat_cid_generate) {
+                DBG_PRINTF("CID generation not configured for shard %d", i);
+                ret = -1;
+            }
+            else {
+                quic[i]->cnx_id_callback_fn(quic[i], picoquic_null_connection_id, picoquic_null_connection_id,
+                    quic[i]->cnx_id_callback_ctx, &cnx_id);
+                if (picoquic_lb_compat_cid_verify(quic[i], quic[i]->cnx_id_callback_ctx, &cnx_id) != (uint64_t)i) {
+                    DBG_PRINTF("CID of shard %d does not encode the shard number", i);
+                    ret = -1;
+                }
+            }
+        }
+    }
+    if (sharded_server != NULL) {
+        picoquic_delete_sharded_server(sharded_server);
+        for (int i = 0; ret == 0 && i < nb_shards; i++) {
+            if (quic[i]->cnx_id_callback_fn != NULL) {
+                DBG_PRINTF("CID configuration of shard %d not released", i);
+                ret = -1;
+            }
+        }
+    }
+    for (int i = 0; i < nb_shards; i++) {
+        if (quic[i] != NULL) {
+            picoquic_free(quic[i]);
+        }
+    }
+
+    return ret;
+#else
+    /* SO_REUSEPORT is not supported on this platform */
+    return 0;
+#endif
+}
@@ -853,6 +853,191 @@ int stream_output_test()
     return ret;
 }
 
+/* Test that the ready queues serve the streams in the expected order:
+ * urgent streams first, FIFO levels by stream ID, round robin levels by
+ * time of last transmission, and that idle or flow blocked streams do not
+ * stay in the queues.
+ */
+const uint8_t* picoquic_decode_max_stream_data_frame(picoquic_cnx_t* cnx, const uint8_t* bytes, const uint8_t* bytes_max);
+
+static int stream_ready_queue_send(picoquic_cnx_t* cnx, uint64_t expected_id, uint64_t* simulated_time)
+{
+    int ret = 0;
+    picoquic_stream_head_t* stream = picoquic_find_ready_stream(cnx);
+
+    if (stream == NULL) {
+        DBG_PRINTF("Expected stream %d, got NULL\n", (int)expected_id);
+        ret = -1;
+    }
+    else if (stream->stream_id != expected_id) {
+        DBG_PRINTF("Expected stream %d, got %d\n", (int)expected_id, (int)stream->stream_id);
+        ret = -1;
+    }
+    else {
+        uint8_t bytes[128];
+        int more_data = 0;
+        int is_pure_ack = 1;
+        int is_still_active = 0;
+
+        *simulated_time += 1000;
+        if (picoquic_format_stream_frame(cnx, stream, bytes, bytes + sizeof(bytes), &more_data, &is_pure_ack,
+            &is_still_active, &ret) == bytes || ret != 0) {
+            DBG_PRINTF("Could not send data on stream %d\n", (int)expected_id);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+static size_t stream_ready_queue_count(picoquic_cnx_t* cnx)
+{
+    size_t nb_queued = 0;
+    picoquic_stream_ready_level_t* level = picoquic_first_ready_level(cnx);
+
+    while (level != NULL) {
+        picoquic_stream_head_t* stream = level->first_urgent_stream;
+        while (stream != NULL) {
+            nb_queued++;
+            stream = stream->next_ready_stream;
+        }
+        stream = level->first_ready_stream;
+        while (stream != NULL) {
+            nb_queued++;
+            stream = stream->next_ready_stream;
+        }
+        level = picoquic_next_ready_level(cnx, level);
+    }
+
+    return nb_queued;
+}
+
+int stream_ready_queue_test()
+{
+    int ret = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+    uint8_t data[1024];
+    uint64_t fifo_order[] = { 160, 160, 400 };
+    uint64_t rr_order[] = { 8, 12, 16, 8, 12, 16 };
+    uint8_t max_stream_data[] = { picoquic_frame_type_max_stream_data, 0x08, 0x80, 0x01, 0x00, 0x00 };
+
+    memset(data, 0x5a, sizeof(data));
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 1000;
+
+    quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        ret = -1;
+    }
+    else if ((cnx = picoquic_create_cnx(quic,
+        picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*)&saddr,
+        simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create connection\n");
+        ret = -1;
+    }
+    else {
+        picoquic_set_callback(cnx, stream_output_test_callback, NULL);
+        cnx->maxdata_remote = 1000000;
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = 4096;
+        cnx->max_stream_id_bidir_remote = 4000;
+
+        /* Create many idle streams, then queue data on a few of them */
+        for (uint64_t stream_id = 0; ret == 0 && stream_id < 4000; stream_id += 4) {
+            if (picoquic_create_stream(cnx, stream_id) == NULL) {
+                ret = -1;
+            }
+        }
+
+        if (ret == 0 && stream_ready_queue_count(cnx) != 0) {
+            DBG_PRINTF("%s", "Idle streams are queued\n");
+            ret = -1;
+        }
+
+        for (int i = 0; ret == 0 && i < 3; i++) {
+            ret = picoquic_set_stream_priority(cnx, 8 + 4 * i, 4);
+        }
+
+        if (ret == 0 &&
+            ((ret = picoquic_add_to_stream(cnx, 400, data, 200, 0)) != 0 ||
+            (ret = picoquic_add_to_stream(cnx, 160, data, 200, 1)) != 0 ||
+            (ret = picoquic_add_to_stream(cnx, 16, data, sizeof(data), 0)) != 0 ||
+            (ret = picoquic_add_to_stream(cnx, 12, data, sizeof(data), 0)) != 0 ||
+            (ret = picoquic_add_to_stream(cnx, 8, data, sizeof(data), 0)) != 0)) {
+            DBG_PRINTF("%s", "Cannot queue data\n");
+        }
+
+        if (ret == 0 && stream_ready_queue_count(cnx) != 5) {
+            DBG_PRINTF("Expected 5 queued streams, got %d\n", (int)stream_ready_queue_count(cnx));
+            ret = -1;
+        }
+
+        /* Priority 4 is round robin, and served before priority 9 */
+        for (size_t i = 0; ret == 0 && i < sizeof(rr_order) / sizeof(uint64_t); i++) {
+            ret = stream_ready_queue_send(cnx, rr_order[i], &simulated_time);
+        }
+
+        /* A reset takes precedence within the level */
+        if (ret == 0 && (ret = picoquic_reset_stream(cnx, 16, 0)) == 0) {
+            picoquic_stream_head_t* stream = picoquic_find_ready_stream(cnx);
+            if (stream == NULL || stream->stream_id != 16) {
+                DBG_PRINTF("%s", "Reset stream not served first\n");
+                ret = -1;
+            }
+            else {
+                stream->reset_sent = 1;
+            }
+        }
+
+        /* Streams that exhausted their flow control credit are parked until MAX_STREAM_DATA */
+        if (ret == 0) {
+            picoquic_stream_head_t* stream = picoquic_find_stream(cnx, 8);
+            stream->maxdata_remote = stream->sent_offset;
+            stream = picoquic_find_stream(cnx, 12);
+            stream->maxdata_remote = stream->sent_offset;
+
+            for (size_t i = 0; ret == 0 && i < sizeof(fifo_order) / sizeof(uint64_t); i++) {
+                ret = stream_ready_queue_send(cnx, fifo_order[i], &simulated_time);
+            }
+            if (ret == 0 && (!picoquic_find_stream(cnx, 8)->is_ready_blocked || cnx->first_blocked_stream == NULL)) {
+                DBG_PRINTF("%s", "Blocked stream not parked\n");
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            if (picoquic_decode_max_stream_data_frame(cnx, max_stream_data, max_stream_data + sizeof(max_stream_data)) == NULL) {
+                DBG_PRINTF("%s", "Cannot decode max stream data\n");
+                ret = -1;
+            }
+            else {
+                ret = stream_ready_queue_send(cnx, 8, &simulated_time);
+            }
+        }
+
+        /* Stream 160 has sent its FIN and stream 16 its reset, only 8, 12 and 400 are left */
+        if (ret == 0 && (picoquic_find_ready_stream(cnx) == NULL ||
+            stream_ready_queue_count(cnx) != 2 || cnx->first_blocked_stream == NULL ||
+                cnx->first_blocked_stream->stream_id != 12)) {
+            DBG_PRINTF("Expected 2 queued streams, got %d\n", (int)stream_ready_queue_count(cnx));
+            ret = -1;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
 /* Test the STREAM ID and STREAM RANK macros
  */
 
@@ -2208,6 +2208,91 @@ int tls_api_test()
     return tls_api_test_with_loss(NULL, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN);
 }
 
+/*
+ * Verify that the handshake completes when the server certificate is
+ * signed by worker threads. To keep the simulation deterministic, the
+ * test waits for the signatures after each round, then resumes the
+ * parked handshakes before simulating the next event.
+ */
+int async_sign_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int nb_resumed = 0;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret != 0)
+    {
+        DBG_PRINTF("Could not create the QUIC test contexts for V=%x\n", PICOQUIC_INTERNAL_TEST_VERSION_1);
+    }
+    else if ((ret = picoquic_enable_async_sign(test_ctx->qserver, 2)) != 0) {
+#ifdef PTLS_ERROR_ASYNC_OPERATION
+        DBG_PRINTF("Cannot enable asynchronous signatures, ret = 0x%x\n", ret);
+#else
+        /* Not supported by this version of picotls, the handshake completes synchronously */
+        ret = 0;
+        nb_resumed = -1;
+#endif
+    }
+    else if (picoquic_enable_async_sign(test_ctx->qserver, 2) != PICOQUIC_ERROR_UNEXPECTED_STATE) {
+        DBG_PRINTF("%s", "Asynchronous signatures enabled twice.\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        int nb_trials = 0;
+        int nb_inactive = 0;
+
+        while (ret == 0 && nb_trials < 1024 && nb_inactive < 512 && (!TEST_CLIENT_READY || (test_ctx->cnx_server == NULL || !TEST_SERVER_READY))) {
+            int was_active = 0;
+            nb_trials++;
+
+            ret = tls_api_one_sim_round(test_ctx, &simulated_time, 0, &was_active);
+
+            if (ret == 0 && nb_resumed >= 0) {
+                if ((ret = picoquic_wait_async_sign(test_ctx->qserver, 5000000)) != 0) {
+                    DBG_PRINTF("%s", "Certificate signature not completed after 5 seconds.\n");
+                }
+                else {
+                    nb_resumed += picoquic_process_async_sign(test_ctx->qserver, simulated_time);
+                }
+            }
+
+            if (test_ctx->cnx_client->cnx_state == picoquic_state_disconnected &&
+                (test_ctx->cnx_server == NULL || test_ctx->cnx_server->cnx_state == picoquic_state_disconnected)) {
+                break;
+            }
+
+            if (was_active) {
+                nb_inactive = 0;
+            }
+            else {
+                nb_inactive++;
+            }
+        }
+
+        if (ret != 0)
+        {
+            DBG_PRINTF("Connection loop returns %d\n", ret);
+        }
+        else if (nb_resumed == 0) {
+            DBG_PRINTF("%s", "No handshake resumed after asynchronous signature.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_test_with_loss_final(test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
 int tls_api_inject_hs_ack_test()
 {
     uint64_t simulated_time = 0;
@@ -7246,6 +7331,307 @@ int server_busy_test()
     return ret;
 }
 
+/*
+ * Memory budget. Verify that the memory usage accounts for the connection objects,
+ * that a server over budget refuses connections as if busy, that the objects of
+ * deleted connections are reused, that receive windows shrink under pressure, and
+ * that the pressure drops once connections are closed.
+ */
+
+int memory_budget_test()
+{
+    uint64_t loss_mask = 0;
+    uint64_t simulated_time = 0;
+    picoquic_memory_usage_t usage;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0) {
+        picoquic_get_memory_usage(test_ctx->qclient, &usage);
+        if (usage.nb_allocated[picoquic_memory_cnx] != 1 || usage.nb_allocated[picoquic_memory_paths] != 1 ||
+            usage.nb_allocated[picoquic_memory_cnx_ids] != 1 ||
+            usage.bytes[picoquic_memory_cnx] != sizeof(picoquic_cnx_t) ||
+            usage.total_bytes < sizeof(picoquic_cnx_t) + sizeof(picoquic_path_t) + sizeof(picoquic_local_cnxid_t)) {
+            DBG_PRINTF("Client usage: %zu cnx, %zu paths, %zu cnx ids, %zu bytes",
+                usage.nb_allocated[picoquic_memory_cnx], usage.nb_allocated[picoquic_memory_paths],
+                usage.nb_allocated[picoquic_memory_cnx_ids], usage.total_bytes);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Hold a stateless packet, so that the server is over a 1 byte budget */
+        picoquic_stateless_packet_t* sp = picoquic_create_stateless_packet(test_ctx->qserver);
+        if (sp == NULL) {
+            ret = -1;
+        }
+        else {
+            picoquic_set_memory_budget(test_ctx->qserver, 1);
+            (void)tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+            picoquic_delete_stateless_packet(sp);
+
+            if (test_ctx->cnx_server != NULL && test_ctx->cnx_server->cnx_state != picoquic_state_disconnected) {
+                DBG_PRINTF("Server state: %d, local error: %" PRIx64, test_ctx->cnx_server->cnx_state, test_ctx->cnx_server->local_error);
+                ret = -1;
+            }
+            else if (test_ctx->cnx_client->cnx_state != picoquic_state_disconnected ||
+                test_ctx->cnx_client->remote_error != PICOQUIC_TRANSPORT_SERVER_BUSY ||
+                test_ctx->qserver->metrics.nb_initial_refused_memory == 0) {
+                DBG_PRINTF("Client state: %d, remote error: %" PRIx64, test_ctx->cnx_client->cnx_state, test_ctx->cnx_client->remote_error);
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_set_memory_budget(test_ctx->qserver, 0);
+
+        if (test_ctx->cnx_server != NULL) {
+            picoquic_delete_cnx(test_ctx->cnx_server);
+            test_ctx->cnx_server = NULL;
+        }
+        picoquic_delete_cnx(test_ctx->cnx_client);
+        test_ctx->cnx_client = NULL;
+
+        /* The objects of the deleted connection are kept for reuse */
+        picoquic_get_memory_usage(test_ctx->qclient, &usage);
+        if (usage.nb_allocated[picoquic_memory_cnx] != 1 || usage.nb_in_pool[picoquic_memory_cnx] != 1 ||
+            usage.nb_in_pool[picoquic_memory_paths] != usage.nb_allocated[picoquic_memory_paths]) {
+            DBG_PRINTF("Client pool: %zu cnx, %zu in pool", usage.nb_allocated[picoquic_memory_cnx],
+                usage.nb_in_pool[picoquic_memory_cnx]);
+            ret = -1;
+        }
+        else if ((test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient,
+            picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_ctx->server_addr, simulated_time,
+            0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1)) == NULL) {
+            ret = -1;
+        }
+        else if (test_ctx->qclient->cnx_pool.nb_allocated != 1 || test_ctx->qclient->cnx_pool.nb_in_pool != 0) {
+            DBG_PRINTF("Connection context not reused, %d allocated", test_ctx->qclient->cnx_pool.nb_allocated);
+            ret = -1;
+        }
+        else {
+            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        /* Receive windows grow normally without budget, slowly near the budget, not at all above it */
+        size_t in_use = picoquic_memory_in_use(test_ctx->qserver);
+        uint64_t window = 0x10000;
+
+        if (picoquic_receive_window_increase(test_ctx->cnx_server, window) !=
+            picoquic_cc_increased_window(test_ctx->cnx_server, window)) {
+            ret = -1;
+        }
+        picoquic_set_memory_budget(test_ctx->qserver, in_use + in_use / 8);
+        if (ret == 0 && picoquic_receive_window_increase(test_ctx->cnx_server, window) != window / 4) {
+            ret = -1;
+        }
+        picoquic_set_memory_budget(test_ctx->qserver, in_use);
+        if (ret == 0 && picoquic_receive_window_increase(test_ctx->cnx_server, window) != 0) {
+            ret = -1;
+        }
+        picoquic_set_memory_budget(test_ctx->qserver, 0);
+        if (ret != 0) {
+            DBG_PRINTF("Unexpected window increase with %zu bytes in use", in_use);
+        }
+    }
+
+    if (ret == 0) {
+        /* Go over budget, then delete the connections. The objects kept in free lists
+         * do not count against the budget, so the pressure drops and a new connection
+         * gets credit again. The stateless packets held while setting the budget leave
+         * room for the new connection, which uses about as much memory as the old one. */
+        picoquic_stateless_packet_t* held[8];
+        int nb_held = 0;
+
+        while (nb_held < 8 && (held[nb_held] = picoquic_create_stateless_packet(test_ctx->qserver)) != NULL) {
+            nb_held++;
+        }
+        picoquic_set_memory_budget(test_ctx->qserver, picoquic_memory_in_use(test_ctx->qserver));
+        if (nb_held < 8 || picoquic_memory_pressure(test_ctx->qserver) != 2) {
+            DBG_PRINTF("Pressure %d over budget", picoquic_memory_pressure(test_ctx->qserver));
+            ret = -1;
+        }
+        while (nb_held > 0) {
+            picoquic_delete_stateless_packet(held[--nb_held]);
+        }
+
+        if (test_ctx->cnx_server != NULL) {
+            picoquic_delete_cnx(test_ctx->cnx_server);
+            test_ctx->cnx_server = NULL;
+        }
+        picoquic_delete_cnx(test_ctx->cnx_client);
+        test_ctx->cnx_client = NULL;
+
+        if (ret == 0 && picoquic_memory_pressure(test_ctx->qserver) != 0) {
+            DBG_PRINTF("Pressure %d after closing, %zu bytes in use", picoquic_memory_pressure(test_ctx->qserver),
+                picoquic_memory_in_use(test_ctx->qserver));
+            ret = -1;
+        }
+        else if (ret == 0 && ((test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient,
+            picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_ctx->server_addr, simulated_time,
+            0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1)) == NULL ||
+            picoquic_start_client_cnx(test_ctx->cnx_client) != 0)) {
+            ret = -1;
+        }
+
+        if (ret == 0 && (ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time)) == 0 &&
+            (test_ctx->cnx_server == NULL || picoquic_receive_window_increase(test_ctx->cnx_server, 0x10000) == 0)) {
+            DBG_PRINTF("No credit granted after closing, %zu bytes in use", picoquic_memory_in_use(test_ctx->qserver));
+            ret = -1;
+        }
+        picoquic_set_memory_budget(test_ctx->qserver, 0);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+/*
+ * QUIC metrics. Verify that the counters follow the packets exchanged during a
+ * connection, that dropped packets are counted, that the gauges reflect the
+ * connections, and that the exporter writes the metrics in Prometheus format.
+ */
+
+#define QUIC_METRICS_TEST_FILE "quic_metrics_test.prom"
+
+int quic_metrics_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_quic_metrics_t client_metrics;
+    picoquic_quic_metrics_t server_metrics;
+    uint64_t nb_dropped_before = 0;
+    uint64_t nb_dropped_after = 0;
+    char text[PICOQUIC_METRICS_TEXT_SIZE];
+    size_t text_length = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, 0, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        picoquic_get_quic_metrics(test_ctx->qclient, &client_metrics);
+        picoquic_get_quic_metrics(test_ctx->qserver, &server_metrics);
+
+        if (client_metrics.nb_packets_sent == 0 || server_metrics.nb_packets_received == 0 ||
+            server_metrics.nb_packets_received > client_metrics.nb_packets_sent ||
+            server_metrics.nb_bytes_received > client_metrics.nb_bytes_sent ||
+            client_metrics.nb_packets_received > server_metrics.nb_packets_sent ||
+            client_metrics.nb_bytes_sent < PICOQUIC_ENFORCED_INITIAL_MTU) {
+            DBG_PRINTF("Client sent %" PRIu64 " packets, server received %" PRIu64,
+                client_metrics.nb_packets_sent, server_metrics.nb_packets_received);
+            ret = -1;
+        }
+        for (int i = 0; i < picoquic_drop_reason_nb; i++) {
+            nb_dropped_before += server_metrics.nb_packets_dropped[i];
+        }
+    }
+
+    if (ret == 0) {
+        /* A short header packet for an unknown connection is dropped */
+        uint8_t bogus[64];
+
+        memset(bogus, 0x5a, sizeof(bogus));
+        bogus[0] = 0x40;
+        (void)picoquic_incoming_packet(test_ctx->qserver, bogus, sizeof(bogus),
+            (struct sockaddr*)&test_ctx->client_addr, (struct sockaddr*)&test_ctx->server_addr, 0, 0, simulated_time);
+        picoquic_get_quic_metrics(test_ctx->qserver, &server_metrics);
+        for (int i = 0; i < picoquic_drop_reason_nb; i++) {
+            nb_dropped_after += server_metrics.nb_packets_dropped[i];
+        }
+        if (nb_dropped_after != nb_dropped_before + 1 ||
+            server_metrics.nb_packets_dropped[picoquic_drop_reason_unknown_cid] == 0) {
+            DBG_PRINTF("Dropped packets: %" PRIu64 " before, %" PRIu64 " after", nb_dropped_before, nb_dropped_after);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_update_quic_gauges(test_ctx->qserver, simulated_time);
+        picoquic_get_quic_metrics(test_ctx->qserver, &server_metrics);
+        if (server_metrics.nb_connections != 1 || server_metrics.nb_allocated[picoquic_memory_cnx] != 1 ||
+            server_metrics.memory_bytes == 0) {
+            DBG_PRINTF("Server gauges: %" PRIu64 " connections, %" PRIu64 " bytes",
+                server_metrics.nb_connections, server_metrics.memory_bytes);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        char expected[128];
+
+        (void)picoquic_sprintf(expected, sizeof(expected), NULL, "\npicoquic_packets_received_total %" PRIu64 "\n",
+            server_metrics.nb_packets_received);
+        if (picoquic_format_quic_metrics(&server_metrics, text, sizeof(text), &text_length) != 0 ||
+            text_length != strlen(text) || strstr(text, expected) == NULL ||
+            strstr(text, "picoquic_packets_dropped_total{reason=\"unknown_cid\"} ") == NULL) {
+            DBG_PRINTF("%s", "Unexpected metrics text.\n");
+            ret = -1;
+        }
+        else if (picoquic_format_quic_metrics(&server_metrics, text, 256, NULL) == 0) {
+            DBG_PRINTF("%s", "Metrics text does not fit in 256 bytes, but no error.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The exporter writes the file at least once */
+        picoquic_metrics_exporter_t* exporter = picoquic_metrics_exporter_create(test_ctx->qserver,
+            QUIC_METRICS_TEST_FILE, 1000000);
+
+        if (exporter == NULL) {
+            ret = -1;
+        }
+        else {
+            FILE* F;
+            picoquic_metrics_exporter_delete(exporter);
+
+            if ((F = picoquic_file_open(QUIC_METRICS_TEST_FILE, "r")) == NULL) {
+                DBG_PRINTF("Cannot open %s\n", QUIC_METRICS_TEST_FILE);
+                ret = -1;
+            }
+            else {
+                size_t nb_read = fread(text, 1, sizeof(text) - 1, F);
+                text[nb_read] = 0;
+                if (strstr(text, "# TYPE picoquic_packets_received_total counter\n") == NULL) {
+                    DBG_PRINTF("%s", "Unexpected metrics file.\n");
+                    ret = -1;
+                }
+                (void)picoquic_file_close(F);
+            }
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
 /*
  * Initial close test. Check what happens when the client closes a connection without waiting for the full establishment
  */
@@ -12006,6 +12392,270 @@ int cnx_ddos_unit_test()
     return cnx_ddos_test_loop(1000, 1000, NULL);
 }
 
+/* Initial flood.
+ * Verify the admission checks performed before creating connection contexts:
+ * rate limiting per source prefix, Retry without connection context when
+ * tokens are required, and the limit on queued stateless packets. Then verify
+ * that a regular client can still connect through a Retry.
+ */
+
+static int initial_flood_create_initial(picoquic_quic_t* qflood, picoquic_test_tls_api_ctx_t* test_ctx,
+    uint64_t simulated_time, picoquictest_sim_packet_t* packet)
+{
+    int ret = 0;
+    int if_index = 0;
+    picoquic_connection_id_t log_cid;
+    picoquic_cnx_t* last_cnx;
+    picoquic_cnx_t* flood_cnx = picoquic_create_cnx(qflood, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&test_ctx->server_addr, simulated_time, 0, PICOQUIC_TEST_SNI,
+        PICOQUIC_TEST_ALPN, 1);
+
+    if (flood_cnx == NULL) {
+        ret = -1;
+    }
+    else {
+        if (picoquic_start_client_cnx(flood_cnx) != 0 ||
+            picoquic_prepare_next_packet(qflood, simulated_time,
+                packet->bytes, sizeof(packet->bytes), &packet->length,
+                &packet->addr_to, &packet->addr_from, &if_index, &log_cid, &last_cnx) != 0 ||
+            packet->length == 0) {
+            ret = -1;
+        }
+        picoquic_delete_cnx(flood_cnx);
+    }
+
+    return ret;
+}
+
+static int initial_flood_send(picoquic_quic_t* qflood, picoquic_test_tls_api_ctx_t* test_ctx,
+    uint64_t simulated_time, picoquictest_sim_packet_t* packet, int nb_packets, uint32_t first_addr, uint32_t addr_increment)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < nb_packets; i++) {
+        struct sockaddr_in addr_from;
+
+        picoquic_set_test_address(&addr_from, first_addr + i * addr_increment, 0x8421);
+        if ((ret = initial_flood_create_initial(qflood, test_ctx, simulated_time, packet)) != 0) {
+            DBG_PRINTF("Cannot create initial #%d", i);
+        }
+        else {
+            (void)picoquic_incoming_packet(test_ctx->qserver, packet->bytes, packet->length,
+                (struct sockaddr*)&addr_from, (struct sockaddr*)&test_ctx->server_addr, 0, 0, simulated_time);
+        }
+    }
+
+    return ret;
+}
+
+static int initial_flood_count_pending(picoquic_quic_t* quic, picoquic_packet_type_enum ptype)
+{
+    int nb_pending = 0;
+    picoquic_stateless_packet_t* sp = quic->pending_stateless_packet;
+
+    while (sp != NULL) {
+        if (sp->ptype == ptype) {
+            nb_pending++;
+        }
+        sp = sp->next_packet;
+    }
+
+    return nb_pending;
+}
+
+int initial_flood_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* qflood = picoquic_create(8, NULL, NULL, NULL, PICOQUIC_TEST_ALPN, NULL, NULL,
+        NULL, NULL, NULL, 0, &simulated_time, NULL, NULL, 0);
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0 && (test_ctx == NULL || packet == NULL || qflood == NULL)) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* A burst of 40 Initial packets from the same /24 prefix, with a limit of 5 */
+        picoquic_set_initial_rate_limit(test_ctx->qserver, 10, 5);
+        ret = initial_flood_send(qflood, test_ctx, simulated_time, packet, 40, 0x0B000001, 1);
+        if (ret == 0 && (test_ctx->qserver->current_number_connections != 5 ||
+            test_ctx->qserver->metrics.nb_initial_rate_limited != 35)) {
+            DBG_PRINTF("Rate limit: %u connections, %" PRIu64 " limited instead of 5, 35",
+                test_ctx->qserver->current_number_connections, test_ctx->qserver->metrics.nb_initial_rate_limited);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The bucket refills at 10 packets per second */
+        simulated_time += 200000;
+        ret = initial_flood_send(qflood, test_ctx, simulated_time, packet, 4, 0x0B000001, 1);
+        if (ret == 0 && (test_ctx->qserver->current_number_connections != 7 ||
+            test_ctx->qserver->metrics.nb_initial_rate_limited != 37)) {
+            DBG_PRINTF("Rate refill: %u connections, %" PRIu64 " limited instead of 7, 37",
+                test_ctx->qserver->current_number_connections, test_ctx->qserver->metrics.nb_initial_rate_limited);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* When tokens are required, Initial packets get a Retry without creating a context.
+         * Each packet comes from a different prefix, so the rate limit does not apply. */
+        picoquic_set_cookie_mode(test_ctx->qserver, 1);
+        ret = initial_flood_send(qflood, test_ctx, simulated_time, packet, 20, 0x0C000001, 0x100);
+        if (ret == 0 && (test_ctx->qserver->current_number_connections != 7 ||
+            test_ctx->qserver->metrics.nb_initial_early_retry != 20 ||
+            initial_flood_count_pending(test_ctx->qserver, picoquic_packet_retry) != 20)) {
+            DBG_PRINTF("Early retry: %u connections, %" PRIu64 " retries instead of 7, 20",
+                test_ctx->qserver->current_number_connections, test_ctx->qserver->metrics.nb_initial_early_retry);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* The number of queued stateless packets is bounded */
+        int max_pending = PICOQUIC_STATELESS_PACKET_RING_SIZE + PICOQUIC_STATELESS_PACKET_MAX_ALLOCATED;
+        int nb_pending_before = initial_flood_count_pending(test_ctx->qserver, picoquic_packet_retry);
+
+        ret = initial_flood_send(qflood, test_ctx, simulated_time, packet, max_pending, 0x0D000001, 0x100);
+        if (ret == 0 && (initial_flood_count_pending(test_ctx->qserver, picoquic_packet_retry) != max_pending ||
+            test_ctx->qserver->metrics.nb_stateless_packets_dropped != (uint64_t)nb_pending_before)) {
+            DBG_PRINTF("Stateless packets: %d pending, %" PRIu64 " dropped instead of %d, %d",
+                initial_flood_count_pending(test_ctx->qserver, picoquic_packet_retry),
+                test_ctx->qserver->metrics.nb_stateless_packets_dropped, max_pending, nb_pending_before);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Drain the queue, then verify that the ring can be reused */
+        picoquic_stateless_packet_t* sp;
+
+        while ((sp = picoquic_dequeue_stateless_packet(test_ctx->qserver)) != NULL) {
+            picoquic_delete_stateless_packet(sp);
+        }
+        if (test_ctx->qserver->nb_stateless_packets_allocated != 0 ||
+            (sp = picoquic_create_stateless_packet(test_ctx->qserver)) == NULL) {
+            DBG_PRINTF("%s", "Stateless packets not recycled.\n");
+            ret = -1;
+        }
+        else {
+            picoquic_delete_stateless_packet(sp);
+        }
+    }
+
+    if (ret == 0) {
+        /* A regular client still connects, after receiving a Retry */
+        ret = tls_api_connection_loop(test_ctx, 0, 0, &simulated_time);
+        if (ret == 0 && (!TEST_CLIENT_READY || test_ctx->cnx_server == NULL || !TEST_SERVER_READY ||
+            !test_ctx->cnx_client->original_cnxid.id_len)) {
+            DBG_PRINTF("%s", "Connection after flood failed.\n");
+            ret = -1;
+        }
+    }
+
+    if (packet != NULL) {
+        free(packet);
+    }
+
+    if (qflood != NULL) {
+        picoquic_free(qflood);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+    }
+
+    return ret;
+}
+
+
+/* Initial flood from many prefixes.
+ * Spread a flood over more source prefixes than the admission table holds,
+ * and verify that it is still rate limited as a whole. The Initial packets
+ * differ only by their destination connection ID: they fail decryption once
+ * admitted, which keeps the test cheap and leaves the counts exact.
+ */
+static void initial_flood_prefixes_send(picoquic_test_tls_api_ctx_t* test_ctx, uint64_t simulated_time,
+    picoquictest_sim_packet_t* packet, int nb_packets, uint32_t first_addr)
+{
+    for (int i = 0; i < nb_packets; i++) {
+        struct sockaddr_in addr_from;
+        uint32_t cid_index = first_addr + i;
+
+        /* The destination connection ID starts at byte 6 of the long header */
+        packet->bytes[6] = (uint8_t)(cid_index >> 24);
+        packet->bytes[7] = (uint8_t)(cid_index >> 16);
+        packet->bytes[8] = (uint8_t)(cid_index >> 8);
+        packet->bytes[9] = (uint8_t)cid_index;
+        picoquic_set_test_address(&addr_from, first_addr + i * 0x100, 0x8421);
+        (void)picoquic_incoming_packet(test_ctx->qserver, packet->bytes, packet->length,
+            (struct sockaddr*)&addr_from, (struct sockaddr*)&test_ctx->server_addr, 0, 0, simulated_time);
+    }
+}
+
+int initial_flood_prefixes_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* qflood = picoquic_create(8, NULL, NULL, NULL, PICOQUIC_TEST_ALPN, NULL, NULL,
+        NULL, NULL, NULL, 0, &simulated_time, NULL, NULL, 0);
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int nb_prefixes = 4 * PICOQUIC_ADMISSION_TABLE_SIZE;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0 && (test_ctx == NULL || packet == NULL || qflood == NULL)) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = initial_flood_create_initial(qflood, test_ctx, simulated_time, packet);
+    }
+
+    if (ret == 0) {
+        /* One packet per prefix and per second. At most one packet per bucket is admitted. */
+        picoquic_set_initial_rate_limit(test_ctx->qserver, 1, 1);
+        initial_flood_prefixes_send(test_ctx, simulated_time, packet, nb_prefixes, 0x0E000001);
+        if (test_ctx->qserver->metrics.nb_initial_rate_limited <
+            (uint64_t)(nb_prefixes - PICOQUIC_ADMISSION_TABLE_SIZE)) {
+            DBG_PRINTF("Flood over %d prefixes: %" PRIu64 " limited instead of at least %d",
+                nb_prefixes, test_ctx->qserver->metrics.nb_initial_rate_limited,
+                nb_prefixes - PICOQUIC_ADMISSION_TABLE_SIZE);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Once the buckets are refilled, new prefixes are admitted again */
+        uint64_t nb_limited = test_ctx->qserver->metrics.nb_initial_rate_limited;
+
+        simulated_time += 1000000;
+        initial_flood_prefixes_send(test_ctx, simulated_time, packet, PICOQUIC_ADMISSION_TABLE_SIZE / 8, 0x0F000001);
+        if (test_ctx->qserver->metrics.nb_initial_rate_limited != nb_limited) {
+            DBG_PRINTF("After refill: %" PRIu64 " limited instead of 0",
+                test_ctx->qserver->metrics.nb_initial_rate_limited - nb_limited);
+            ret = -1;
+        }
+    }
+
+    if (packet != NULL) {
+        free(packet);
+    }
+
+    if (qflood != NULL) {
+        picoquic_free(qflood);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+    }
+
+    return ret;
+}
 
 /*
  * Test randomization of initial packet number
@@ -13056,4 +13706,158 @@ int immediate_ack_test()
     }
 
     return ret;
-}
\ No newline at end of file
+}
+/* Move the server side of a connection to a new QUIC context after
+ * the handshake, and verify that the transfer completes in the new context.
+ * The old context is freed right after the move, and the packets and data
+ * nodes held by the connection are accounted in the new context.
+ */
+static void cnx_attach_count_in_use(picoquic_quic_t* quic, int* nb_packets, int* nb_data_nodes)
+{
+    *nb_packets = quic->nb_packets_allocated - quic->nb_packets_in_pool;
+    *nb_data_nodes = quic->nb_data_nodes_allocated - quic->nb_data_nodes_in_pool;
+}
+
+int cnx_attach_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_quic_t* qserver_new = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+
+    if (ret == 0) {
+        qserver_new = picoquic_create(8,
+            test_server_cert_file, test_server_key_file, test_server_cert_store_file,
+            PICOQUIC_TEST_ALPN, test_api_callback, (void*)&test_ctx->server_callback, NULL, NULL, NULL,
+            simulated_time, &simulated_time, NULL,
+            test_ticket_encrypt_key, sizeof(test_ticket_encrypt_key));
+        if (qserver_new == NULL) {
+            ret = -1;
+        }
+        else if (picoquic_cnx_detach(test_ctx->cnx_client) == 0) {
+            DBG_PRINTF("%s", "Connection detached before the handshake.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_connect(test_ctx, &simulated_time, 0, 0, 0);
+    }
+
+    if (ret == 0 && picoquic_cnx_attach(qserver_new, test_ctx->cnx_server) == 0) {
+        DBG_PRINTF("%s", "Attached a connection that was not detached.\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        picoquic_cnx_t* cnx = test_ctx->cnx_server;
+        picoquic_connection_id_t cid = cnx->path[0]->p_local_cnxid->cnx_id;
+        picoquic_quic_t* qserver = test_ctx->qserver;
+        int is_attached = 0;
+        int nb_packets = 0;
+        int nb_data_nodes = 0;
+        int nb_packets_moved = 0;
+        int nb_data_nodes_moved = 0;
+
+        cnx_attach_count_in_use(qserver, &nb_packets_moved, &nb_data_nodes_moved);
+
+        if ((ret = picoquic_cnx_detach(cnx)) != 0) {
+            DBG_PRINTF("Cannot detach connection, ret = 0x%x\n", ret);
+        }
+        else {
+            if (picoquic_get_first_cnx(qserver) != NULL ||
+                picoquic_current_number_connections(qserver) != 0 ||
+                picoquic_cnx_by_id(qserver, cid, NULL) != NULL ||
+                picoquic_get_earliest_cnx_to_wake(qserver, 0) != NULL) {
+                DBG_PRINTF("%s", "Connection still visible in old context.\n");
+                ret = -1;
+            }
+            else if ((ret = picoquic_cnx_attach(qserver_new, cnx)) != 0) {
+                DBG_PRINTF("Cannot attach connection, ret = 0x%x\n", ret);
+            }
+            else {
+                is_attached = 1;
+                if (cnx->quic != qserver_new || picoquic_get_first_cnx(qserver_new) != cnx ||
+                    picoquic_current_number_connections(qserver_new) != 1 ||
+                    picoquic_cnx_by_id(qserver_new, cid, NULL) != cnx ||
+                    picoquic_get_earliest_cnx_to_wake(qserver_new, UINT64_MAX) != cnx) {
+                    DBG_PRINTF("%s", "Connection not registered in new context.\n");
+                    ret = -1;
+                }
+                else {
+                    cnx_attach_count_in_use(qserver_new, &nb_packets, &nb_data_nodes);
+                    if (nb_packets != nb_packets_moved || nb_data_nodes != nb_data_nodes_moved) {
+                        DBG_PRINTF("New context has %d packets, %d data nodes in use instead of %d, %d\n",
+                            nb_packets, nb_data_nodes, nb_packets_moved, nb_data_nodes_moved);
+                        ret = -1;
+                    }
+                    else {
+                        cnx_attach_count_in_use(qserver, &nb_packets, &nb_data_nodes);
+                        if (nb_packets != 0 || nb_data_nodes != 0) {
+                            DBG_PRINTF("Old context has %d packets, %d data nodes in use\n", nb_packets, nb_data_nodes);
+                            ret = -1;
+                        }
+                    }
+                }
+            }
+
+            if (is_attached) {
+                /* The connection now belongs to the new context, which replaces the old one in the test.
+                 * Free the old context now, so that any remaining reference to it is caught. */
+                test_ctx->qserver = qserver_new;
+                qserver_new = NULL;
+                picoquic_free(qserver);
+            }
+            else if (picoquic_cnx_attach(qserver, cnx) != 0) {
+                /* Give the connection back to the old context, so it is freed with it */
+                DBG_PRINTF("%s", "Cannot reattach connection to old context.\n");
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_q_and_r, sizeof(test_scenario_q_and_r));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        /* Once the connection is deleted, its packets and data nodes are all back in the pools */
+        int nb_packets = 0;
+        int nb_data_nodes = 0;
+
+        while (picoquic_get_first_cnx(test_ctx->qserver) != NULL) {
+            picoquic_delete_cnx(picoquic_get_first_cnx(test_ctx->qserver));
+        }
+        test_ctx->cnx_server = NULL;
+        cnx_attach_count_in_use(test_ctx->qserver, &nb_packets, &nb_data_nodes);
+        if (nb_packets != 0 || nb_data_nodes != 0) {
+            DBG_PRINTF("New context has %d packets, %d data nodes in use after closing\n", nb_packets, nb_data_nodes);
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    if (qserver_new != NULL) {
+        picoquic_free(qserver_new);
+    }
+
+    return ret;
+}
@@ -20,6 +20,7 @@
 */
 
 #include "picoquic_internal.h"
+#include "picoquic_packet_loop.h"
 #include <stdlib.h>
 #ifdef _WINDOWS
 #include <malloc.h>
@@ -395,4 +396,207 @@ int util_threading_test()
     }
 
     return ret;
-}
\ No newline at end of file
+}
+
+/* Testing the lock-free MPSC queue.
+ * Several threads push numbered nodes while the main thread pops them.
+ * Each node must be received exactly once, and the nodes pushed by
+ * each thread must arrive in order.
+ */
+#define MPSC_TEST_NB_THREADS 4
+#define MPSC_TEST_NB_NODES 20000
+
+typedef struct st_mpsc_test_node_t {
+    picoquic_mpsc_node_t node;
+    int thread_id;
+    int rank;
+} mpsc_test_node_t;
+
+typedef struct st_mpsc_test_thread_t {
+    picoquic_mpsc_queue_t* queue;
+    mpsc_test_node_t* nodes;
+    int thread_id;
+} mpsc_test_thread_t;
+
+static picoquic_thread_return_t mpsc_test_function(void* vctx)
+{
+    mpsc_test_thread_t* ctx = (mpsc_test_thread_t*)vctx;
+
+    for (int i = 0; i < MPSC_TEST_NB_NODES; i++) {
+        ctx->nodes[i].thread_id = ctx->thread_id;
+        ctx->nodes[i].rank = i;
+        picoquic_mpsc_push(ctx->queue, &ctx->nodes[i].node);
+    }
+
+    picoquic_thread_do_return;
+}
+
+/* Commands posted to a network thread are queued, then executed in order
+ * when the thread drains its queue. The thread context is not started; it
+ * is marked as already signaled, so posting does not try to wake it up.
+ */
+static int mpsc_command_test_callback(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(cnx);
+    UNREFERENCED_PARAMETER(stream_id);
+    UNREFERENCED_PARAMETER(bytes);
+    UNREFERENCED_PARAMETER(length);
+    UNREFERENCED_PARAMETER(fin_or_event);
+    UNREFERENCED_PARAMETER(callback_ctx);
+    UNREFERENCED_PARAMETER(v_stream_ctx);
+#endif
+    return 0;
+}
+
+static int mpsc_command_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_network_thread_ctx_t thread_ctx;
+    picoquic_cnx_t* cnx = NULL;
+    picoquic_stream_head_t* stream;
+    struct sockaddr_in saddr;
+    uint8_t data[32];
+    int stream_ctx = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, mpsc_command_test_callback, NULL,
+        NULL, NULL, NULL, simulated_time, &simulated_time, NULL, NULL, 0);
+
+    memset(&thread_ctx, 0, sizeof(thread_ctx));
+    picoquic_mpsc_init(&thread_ctx.command_queue);
+    thread_ctx.command_signaled = 1;
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin_family = AF_INET;
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    if (quic == NULL || (cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&saddr, simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the connection");
+        ret = -1;
+    }
+    else if (picoquic_network_thread_add_to_stream(&thread_ctx, cnx, 0, data, sizeof(data), 1) != 0 ||
+        picoquic_network_thread_mark_active_stream(&thread_ctx, cnx, 4, 1, &stream_ctx) != 0 ||
+        picoquic_network_thread_queue_datagram(&thread_ctx, cnx, data, 16) != 0) {
+        DBG_PRINTF("%s", "Cannot post the commands");
+        ret = -1;
+    }
+    else if (picoquic_find_stream(cnx, 0) != NULL || picoquic_find_stream(cnx, 4) != NULL ||
+        cnx->first_datagram != NULL) {
+        DBG_PRINTF("%s", "Commands executed before the queue is drained");
+        ret = -1;
+    }
+    else {
+        picoquic_network_thread_drain_commands(&thread_ctx);
+
+        if ((stream = picoquic_find_stream(cnx, 0)) == NULL || stream->send_queue == NULL ||
+            stream->send_queue->length != sizeof(data) || memcmp(stream->send_queue->bytes, data, sizeof(data)) != 0 ||
+            !stream->fin_requested) {
+            DBG_PRINTF("%s", "Add to stream command not executed");
+            ret = -1;
+        }
+        else if ((stream = picoquic_find_stream(cnx, 4)) == NULL || !stream->is_active ||
+            stream->app_stream_ctx != &stream_ctx) {
+            DBG_PRINTF("%s", "Mark active stream command not executed");
+            ret = -1;
+        }
+        else if (cnx->first_datagram == NULL || cnx->first_datagram->length < 16 ||
+            memcmp((uint8_t*)(cnx->first_datagram + 1) + cnx->first_datagram->length - 16, data, 16) != 0) {
+            DBG_PRINTF("%s", "Queue datagram command not executed");
+            ret = -1;
+        }
+        else if (thread_ctx.command_signaled || picoquic_mpsc_pop(&thread_ctx.command_queue) != NULL) {
+            DBG_PRINTF("%s", "Command queue not reset after drain");
+            ret = -1;
+        }
+    }
+
+    /* Release the commands that were not executed */
+    picoquic_network_thread_drain_commands(&thread_ctx);
+    if (cnx != NULL) {
+        picoquic_delete_cnx(cnx);
+    }
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+int util_mpsc_test()
+{
+    int ret = 0;
+    picoquic_mpsc_queue_t queue;
+    mpsc_test_thread_t ctx[MPSC_TEST_NB_THREADS];
+    picoquic_thread_t thread[MPSC_TEST_NB_THREADS];
+    int next_rank[MPSC_TEST_NB_THREADS];
+    int nb_threads = 0;
+    int nb_received = 0;
+    int nb_loops = 0;
+    mpsc_test_node_t* nodes = (mpsc_test_node_t*)malloc(sizeof(mpsc_test_node_t) * MPSC_TEST_NB_THREADS * MPSC_TEST_NB_NODES);
+
+    picoquic_mpsc_init(&queue);
+    memset(next_rank, 0, sizeof(next_rank));
+
+    if (nodes == NULL) {
+        ret = -1;
+    }
+    else if (picoquic_mpsc_pop(&queue) != NULL) {
+        DBG_PRINTF("%s", "Pop from empty queue returns a node");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < MPSC_TEST_NB_THREADS; i++) {
+        ctx[i].queue = &queue;
+        ctx[i].nodes = nodes + (size_t)i * MPSC_TEST_NB_NODES;
+        ctx[i].thread_id = i;
+        ret = picoquic_create_thread(&thread[i], mpsc_test_function, &ctx[i]);
+        if (ret != 0) {
+            DBG_PRINTF("Create thread returns %d (0x%x)", ret, ret);
+        }
+        else {
+            nb_threads++;
+        }
+    }
+
+    while (ret == 0 && nb_received < MPSC_TEST_NB_THREADS * MPSC_TEST_NB_NODES) {
+        mpsc_test_node_t* node = (mpsc_test_node_t*)picoquic_mpsc_pop(&queue);
+
+        if (node == NULL) {
+            if (++nb_loops > 100000000) {
+                DBG_PRINTF("Only %d nodes received", nb_received);
+                ret = -1;
+            }
+        }
+        else if (node->thread_id < 0 || node->thread_id >= MPSC_TEST_NB_THREADS ||
+            node->rank != next_rank[node->thread_id]) {
+            DBG_PRINTF("Unexpected node %d from thread %d", node->rank, node->thread_id);
+            ret = -1;
+        }
+        else {
+            next_rank[node->thread_id]++;
+            nb_received++;
+        }
+    }
+
+    for (int i = 0; i < nb_threads; i++) {
+        picoquic_delete_thread(&thread[i]);
+    }
+
+    if (ret == 0 && picoquic_mpsc_pop(&queue) != NULL) {
+        DBG_PRINTF("%s", "Queue not empty after all nodes received");
+        ret = -1;
+    }
+
+    if (nodes != NULL) {
+        free(nodes);
+    }
+
+    if (ret == 0) {
+        ret = mpsc_command_test();
+    }
+
+    return ret;
+}